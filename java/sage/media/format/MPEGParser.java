@@ -38,6 +38,8 @@ public class MPEGParser
     }
   }
   public static native String getMediaAVInf0(String filename, long searchSize, boolean activeFile, long channel);
+  // Same as getMediaAVInf0 for each file, the files are probed on a pool of native threads (threads 0 picks it by CPUs)
+  public static native String[] getMediaAVInfBatch0(String[] filenames, long[] searchSizes, boolean[] activeFiles, long channel, int threads);
 
   public static Remuxer openRemuxer(int mode, java.io.OutputStream outStream)
   {
@@ -51,6 +53,16 @@ public class MPEGParser
     else
       return null;
   }
+  // The remuxed data are written into direct ByteBuffers given with the input, no callback into Java for
+  // each output block. Use Remuxer.pushData(byte[], int, int, ByteBuffer).
+  public static Remuxer openDirectRemuxer(int mode, int channel)
+  {
+    long ptr = openRemuxer0(mode, channel, null);
+    if (ptr != 0)
+      return new Remuxer(ptr, mode, channel, null);
+    else
+      return null;
+  }
 
   public static boolean remuxFile(java.io.File inputFile, java.io.File outputFile, int mode)
   {
@@ -112,6 +124,13 @@ public class MPEGParser
   private static native long pushRemuxData0(long ptr, byte[] buf, int offset, int length);
   private static native String initRemuxDataDone0(long ptr, byte[] buf, int offset, int length);
   private static native void flushRemuxer0(long ptr);
+  // Direct output into outLength bytes at outOffset of a direct ByteBuffer (at least 8K when there's input).
+  // Input is taken only while the region has room; returns the input bytes taken in the high 32 bits and the
+  // output bytes written in the low 32 bits. Output of the last parse step that didn't fit goes out first on
+  // the next call, a null buf only takes that out.
+  private static native long pushRemuxDataDirect0(long ptr, byte[] buf, int offset, int length,
+      java.nio.ByteBuffer outBuf, int outOffset, int outLength);
+  private static native long getRemuxLastPTS0(long ptr);
 
   // NOTE: When you close the remuxer it does NOT close the outStream as well. This needs
   // to be done by the caller.
@@ -134,10 +153,39 @@ public class MPEGParser
 
     public void pushData(byte[] buf, int offset, int length)
     {
+      if (outStream == null)
+        throw new IllegalStateException("direct remuxer, use pushData(byte[], int, int, ByteBuffer)");
       if (ptr != 0)
         lastPTS = pushRemuxData0(ptr, buf, offset, length);
       pushedBytes += length;
     }
+    // For a direct remuxer; the output goes into out, a direct buffer with at least 8K free, from its position
+    // up to its limit and the position is moved past it. Input is taken only while out has room; returns the
+    // bytes of buf taken, push the rest again after out is sent.
+    public int pushData(byte[] buf, int offset, int length, java.nio.ByteBuffer out)
+    {
+      if (outStream != null)
+        throw new IllegalStateException("stream remuxer, use pushData(byte[], int, int)");
+      if (!out.isDirect())
+        throw new IllegalArgumentException("output isn't a direct ByteBuffer");
+      // a closed remuxer takes everything, as the stream API does
+      int taken = (buf != null) ? length : 0;
+      if (ptr != 0)
+      {
+        long rv = pushRemuxDataDirect0(ptr, buf, offset, length, out, out.position(), out.remaining());
+        taken = (int)(rv >>> 32);
+        out.position(out.position() + (int)rv);
+      }
+      pushedBytes += taken;
+      return taken;
+    }
+    // Takes out what a direct remuxer kept because out was full, returns the bytes written; call it until 0
+    public int drainData(java.nio.ByteBuffer out)
+    {
+      int pos = out.position();
+      pushData(null, 0, 0, out);
+      return out.position() - pos;
+    }
     public ContainerFormat pushInitData(byte[] buf, int offset, int length)
     {
       if (ptr != 0)
@@ -154,6 +202,8 @@ public class MPEGParser
     }
     public long getLastPTSMsec()
     {
+      if (outStream == null && ptr != 0)
+        lastPTS = getRemuxLastPTS0(ptr);
       return lastPTS/90;
     }
     public void seek(long newTimeMilli)
@@ -81,6 +81,47 @@ public class MsgManager implements Runnable
     }
   }
 
+  /**
+   * Posts a batch of messages from the native message queue of the capture plugins. The buffer
+   * holds len bytes of records in the layout of the socket protocol below: 32-bit type, 32-bit
+   * priority, 32-bit source length, source, 32-bit data length, data. The buffer is reused by the
+   * caller once this returns.
+   */
+  public static void postMessages(java.nio.ByteBuffer buf, int len)
+  {
+    getInstance().postMessagesImpl(buf, len);
+  }
+
+  protected void postMessagesImpl(java.nio.ByteBuffer buf, int len)
+  {
+    buf.clear();
+    buf.limit(len);
+    java.util.ArrayList msgs = new java.util.ArrayList();
+    try
+    {
+      while (buf.remaining() >= 16)
+      {
+        int type = buf.getInt();
+        int priority = buf.getInt();
+        byte[] srcData = new byte[buf.getInt()];
+        buf.get(srcData);
+        byte[] rawData = new byte[buf.getInt()];
+        buf.get(rawData);
+        msgs.add(new SageMsg(type, new String(srcData), rawData, priority));
+      }
+    }
+    catch (RuntimeException e)
+    {
+      System.out.println("ERROR invalid native message batch of " + len + " bytes:" + e);
+    }
+    if (msgs.isEmpty()) return;
+    synchronized (queue)
+    {
+      queue.addAll(msgs);
+      queue.notifyAll();
+    }
+  }
+
   public static void sendMessage(SageMsg msg)
   {
     getInstance().sendMessageImpl(msg);
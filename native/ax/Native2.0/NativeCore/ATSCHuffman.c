@@ -0,0 +1,321 @@
+/*
+ * Copyright 2015 The SageTV Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "NativeCore.h"
+#include "ATSCHuffman.h"
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+//A/65 Annex C: a string is coded in the tree of its previous character (0 at start), a leaf of 27 escapes
+//the next 8 bits as an uncompressed character, the character 0 ends the string. A table is a header of
+//128 tree offsets, a tree node is a left and a right child byte, a child with bit 7 set is a leaf.
+extern unsigned char title_huffman_tbl[];
+extern unsigned char program_huffman_tbl[];
+extern int title_huffman_tbl_size;
+extern int program_huffman_tbl_size;
+
+#define HUFFMAN_STEP_BITS  8
+#define HUFFMAN_ESCAPE     27
+#define HUFFMAN_LONG_CODE  0x8000	//code runs over a step, entry is the tree node reached by the step
+
+//a step entry of a previous character and the next 8 bits: (code bits<<8)|character, or
+//HUFFMAN_LONG_CODE|node of a longer code; both tables are built once, by the first caller
+static unsigned short huffman_step[2][128][1<<HUFFMAN_STEP_BITS];
+static int huffman_engine = ATSC_HUFFMAN_TABLE;
+
+static unsigned char GetNext8Bits( unsigned char* pData, int pos, unsigned char bit )
+{
+	int i;
+	unsigned char ch;
+	ch = 0;
+	for ( i = 0; i<8; i++ )
+	{
+		bit >>= 1;
+		ch <<= 1;
+		if ( bit == 0 ) 	
+		{    pos++; 
+		     bit = 0x80; 
+		} 
+		if ( bit & pData[pos] ) ch |= 1;
+	}
+	return ch;
+}
+static int UncompressHuffmanTree( int Type, unsigned char* pOut, int MaxSize, unsigned char* pData, int Length )
+{
+	int i, bytes;
+	unsigned char *huffman, *tree_root;
+	unsigned char lch, cch, ch;
+	unsigned char bit;
+	int offset, index;
+
+	if ( Length <= 0 || pData == NULL  || MaxSize <= 1 )
+		return 0;
+
+	if ( Type == 1  ) 
+		huffman = title_huffman_tbl;
+	else
+	if ( Type == 2  ) 
+		huffman = program_huffman_tbl;
+	else
+	{
+		//unknow format, just output
+		bytes = _MIN( Length, MaxSize );
+		memcpy( pOut, pData, bytes );
+		return bytes;
+	}
+
+	bytes = 0;	i = 0;
+	index = 0;
+	lch = 0; bit = 0; cch = 0;
+	index = (huffman[lch*2]<<8)|huffman[lch*2+1];
+	tree_root = &huffman[index];
+	offset = 0;
+	while ( bytes < MaxSize  )
+	{
+		unsigned char node;
+
+		if ( i >= Length && bit == 0 )
+			break;
+
+		if ( bit == 0 ) 
+		{
+			cch = pData[i++];
+			bit = 0x80;
+		}
+
+		if ( bit & cch )
+			node = tree_root[offset+1];  //right child branch
+		else
+			node = tree_root[offset];    //left child branch
+
+		if ( node & 0x80 )
+		{
+			ch = node & 0x7f;
+			if ( ch == 27 )
+			{
+				lch = GetNext8Bits( pData, i-1, bit );  //get uncompressed 8 bits to output
+				cch = pData[i++];  //skip 8 bits
+			} else
+			{
+				lch = ch; 
+			}
+			*pOut++ = lch;
+			bytes++;
+			
+			if ( bytes >= MaxSize )
+			{
+				//printf( "uncompress buffer is too small\n" );
+			}
+
+			if ( lch == 0 )
+				break;
+
+			index = (huffman[lch*2]<<8)|huffman[lch*2+1];
+			tree_root = &huffman[index];
+
+			if ( (Type == 2 && index > 1781) || (Type == 1 && index > 1939) ) 
+			{
+				//printf( "Error uncompress\n" );
+				return bytes;
+			}
+			offset = 0;
+
+		}
+		else
+		{
+			offset = node*2 ;
+		}
+
+		bit >>= 1;
+		
+	}
+
+	return bytes;
+}
+
+static int TreeIndex( unsigned char* pHuffman, int nChar )
+{
+	return ( pHuffman[nChar*2]<<8 )|pHuffman[nChar*2+1];
+}
+
+static void InitStepTable( int nType, unsigned char* pHuffman )
+{
+	int i, w, b;
+	for ( i = 0; i<128; i++ )
+	{
+		unsigned char* tree_root = pHuffman + TreeIndex( pHuffman, i );
+		for ( w = 0; w<(1<<HUFFMAN_STEP_BITS); w++ )
+		{
+			unsigned short entry = 0;
+			int offset = 0;
+			for ( b = 0; b<HUFFMAN_STEP_BITS; b++ )
+			{
+				unsigned char node = tree_root[ offset + ( ( w>>(HUFFMAN_STEP_BITS-1-b) )&1 ) ];
+				if ( node & 0x80 )
+				{
+					entry = ( (b+1)<<8 )|( node&0x7f );
+					break;
+				}
+				offset = node*2;
+			}
+			if ( b == HUFFMAN_STEP_BITS )
+				entry = HUFFMAN_LONG_CODE | ( offset/2 );
+			huffman_step[nType-1][i][w] = entry;
+		}
+	}
+}
+
+static void InitStepTables( )
+{
+	InitStepTable( 1, title_huffman_tbl );
+	InitStepTable( 2, program_huffman_tbl );
+}
+
+#ifdef WIN32
+static INIT_ONCE huffman_step_once = INIT_ONCE_STATIC_INIT;
+static BOOL CALLBACK InitStepTablesOnce( PINIT_ONCE pOnce, PVOID pParam, PVOID* ppContext )
+{
+	InitStepTables( );
+	return TRUE;
+}
+#define StepTablesReady( )	InitOnceExecuteOnce( &huffman_step_once, InitStepTablesOnce, NULL, NULL )
+#else
+static pthread_once_t huffman_step_once = PTHREAD_ONCE_INIT;
+#define StepTablesReady( )	pthread_once( &huffman_step_once, InitStepTables )
+#endif
+
+//8 bits at a bit position, bits past the data are 0
+static unsigned int PeekByte( const unsigned char* pData, int nLength, int nPos )
+{
+	int k = nPos>>3;
+	unsigned int v = ( k < nLength ? pData[k]<<8 : 0 )|( k+1 < nLength ? pData[k+1] : 0 );
+	return ( v >> ( 8-(nPos&7) ) ) & 0xff;
+}
+
+//walks a code a bit at a time from a tree node, -1 when data runs out inside the code
+static int WalkTree( unsigned char* pTreeRoot, int nOffset, const unsigned char* pData, int nLength, int* pPos )
+{
+	int pos = *pPos;
+	unsigned char node;
+	do {
+		int k = pos>>3;
+		if ( ( pos & 7 ) == 0 && k >= nLength )
+			return -1;
+		node = pTreeRoot[ nOffset + ( k < nLength ? ( pData[k]>>(7-(pos&7)) )&1 : 0 ) ];
+		nOffset = node*2;
+		pos++;
+	} while ( !( node & 0x80 ) );
+	*pPos = pos;
+	return node & 0x7f;
+}
+
+//decodes as the tree walker does: decoding stops on a byte boundary at or past the end of data, and an
+//escape takes 8 bits even when they run past it (they are 0 here, the tree walker reads beyond data)
+static int UncompressHuffmanTable( int nType, unsigned char* pOut, int nMaxSize, const unsigned char* pData, int nLength )
+{
+	unsigned char* huffman = nType == 1 ? title_huffman_tbl : program_huffman_tbl;
+	int tbl_size = nType == 1 ? title_huffman_tbl_size : program_huffman_tbl_size;
+	unsigned short (*step)[1<<HUFFMAN_STEP_BITS] = huffman_step[nType-1];
+	int bytes = 0, pos = 0, bits = nLength*8, lch = 0, end;
+	unsigned short entry = 0;
+
+	StepTablesReady( );
+
+	while ( bytes < nMaxSize )
+	{
+		int ch;
+		end = ( (pos+7)&~7 ) > bits ? (pos+7)&~7 : bits;
+		if ( pos >= end )
+			break;
+
+		if ( lch < 128 && ( entry = step[lch][PeekByte( pData, nLength, pos )] ) < HUFFMAN_LONG_CODE )
+		{
+			if ( pos + (entry>>8) > end )
+				break;
+			pos += entry>>8;
+			ch = entry & 0x7f;
+		} else
+		{
+			//a long code, or a tree of an escaped character beyond 127
+			int offset = 0;
+			if ( lch < 128 )
+			{
+				if ( pos + HUFFMAN_STEP_BITS > end )
+					break;
+				pos += HUFFMAN_STEP_BITS;
+				offset = ( entry & 0x7f )*2;
+			}
+			if ( ( ch = WalkTree( huffman+TreeIndex( huffman, lch ), offset, pData, nLength, &pos ) ) < 0 )
+				break;
+		}
+
+		if ( ch == HUFFMAN_ESCAPE )
+		{
+			ch = PeekByte( pData, nLength, pos );
+			pos += 8;
+		}
+		pOut[bytes++] = ch;
+		if ( ch == 0 )
+			break;
+
+		//trees of characters below 128 are in tables, an escaped character may point out of them
+		lch = ch;
+		if ( lch >= 128 && TreeIndex( huffman, lch ) >= tbl_size )
+			break;
+	}
+	return bytes;
+}
+
+int UncompressATSCHuffman( int nType, unsigned char* pOut, int nMaxSize, const unsigned char* pData, int nLength )
+{
+	if ( nLength <= 0 || pData == NULL || nMaxSize <= 1 )
+		return 0;
+
+	if ( nType != 1 && nType != 2 )
+	{
+		//unknow format, just output
+		int bytes = _MIN( nLength, nMaxSize );
+		memcpy( pOut, pData, bytes );
+		return bytes;
+	}
+
+	if ( huffman_engine == ATSC_HUFFMAN_TREE )
+		return UncompressHuffmanTree( nType, pOut, nMaxSize, (unsigned char*)pData, nLength );
+	return UncompressHuffmanTable( nType, pOut, nMaxSize, pData, nLength );
+}
+
+int ATSCHuffmanEngine( )
+{
+	return huffman_engine;
+}
+
+//force the tree walker (test and benchmark)
+void SetupATSCHuffmanEngine( int nEngine )
+{
+	huffman_engine = nEngine == ATSC_HUFFMAN_TREE ? ATSC_HUFFMAN_TREE : ATSC_HUFFMAN_TABLE;
+}
+
+char* ATSCHuffmanEngineName( int nEngine )
+{
+	if ( nEngine == ATSC_HUFFMAN_TREE ) return "tree";
+	return "table";
+}
@@ -0,0 +1,42 @@
+/*
+ * Copyright 2015 The SageTV Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef ATSC_HUFFMAN_H
+#define ATSC_HUFFMAN_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//ATSC A/65 multiple_string_structure compression 1 (title) and 2 (program description) Huffman decoders,
+//a bit at a time tree walker, and a table decoder that looks up a code of 8 bits a step in a table of
+//the previous character's tree
+#define ATSC_HUFFMAN_TREE   0x00
+#define ATSC_HUFFMAN_TABLE  0x01
+
+//decoded bytes of a nLength bytes segment at most (a code is 1 bit at least, an escape may run 2 bytes over)
+#define ATSC_HUFFMAN_MAX_BYTES( nLength )  ( (nLength)*8+16 )
+
+int   UncompressATSCHuffman( int nType, unsigned char* pOut, int nMaxSize, const unsigned char* pData, int nLength );
+int   ATSCHuffmanEngine( );
+void  SetupATSCHuffmanEngine( int nEngine );
+char* ATSCHuffmanEngineName( int nEngine );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
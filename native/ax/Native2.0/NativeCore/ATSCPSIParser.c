@@ -23,6 +23,7 @@
 #include "TSFilter.h"
 #include "PSIParser.h"
 #include "TSCRC32.h"
+#include "ATSCHuffman.h"
 #include "ATSCPSIParser.h"
 
 #define TAG_EXTENDED_CHANNEL_NAME  0xA0
@@ -38,8 +39,6 @@ unsigned char* _FillDescData_( DESC_DATA *pDesc, unsigned char* pData, int nByte
 int UnpackMultipleString( unsigned char* p, int Bytes, int nCol, int nRow, STRING* pString  );
 int UnpackMultipleString256( unsigned char* p, int Bytes, int nCol, int nRow, STRING256* pString  );
 static unsigned char* GetStringFromMutilString( unsigned char* p, int Bytes, int nCol, int nRow, int *pStringLen );
-static int UncompressHuffman( int Type, unsigned char* pOut, int MaxSize, unsigned char* pData, int Length );
-static int GetUncompressBytes( int Type, unsigned char* pData, int Length );
 
 //DESC_DATA* CreateDesc( );
 //void ReleaseDesc( DESC_DATA* pDsec );
@@ -55,6 +54,8 @@ ATSC_PSI* CreateATSCPSI( PSI_PARSER* pPSIParser )
 	pATSCPSI->psi_parser = pPSIParser;
 
 	pATSCPSI->atsc_psi_section = CreateSection();
+	AttachSectionCache( pATSCPSI->atsc_psi_section, pPSIParser->ts_filter->section_cache, 0x1ffb );
+	ResetSectionCache( pPSIParser->ts_filter->section_cache );
 
 	SageLog(( _LOG_TRACE, 3, TEXT("It's an ATSC Stream") ));
 	SageLog(( _LOG_TRACE, 4, TEXT("Memory footprint of PSIP of ATSC %d"), sizeof(ATSC_PSI) ));
@@ -96,7 +97,7 @@ void ResetATSCPSI( ATSC_PSI* pATSCPSI )
 	pATSCPSI->mgt_section_crc32 = 0;
 	pATSCPSI->vct_section_crc32 = 0;
 	pATSCPSI->rtt_section_crc32 = 0;
-
+	ResetSectionCache( pATSCPSI->atsc_psi_section->cache );
 }
 
 static void UnpackSTT( ATSC_PSI* pATSCPSI, TS_SECTION* pSection )
@@ -150,6 +151,7 @@ static void UnpackMGT( ATSC_PSI* pATSCPSI, TS_SECTION* pSection )
 	//we may use version to check MGT updating, but ...
 	pATSCPSI->mgt_update_flag  = pATSCPSI->mgt_section_crc32 != pSection->crc32;
 	pATSCPSI->mgt_section_crc32 = pSection->crc32;
+	CacheSection( pSection );
 	if ( pATSCPSI->mgt_update_flag == 0 ) //mgt unchange, skip it
 		return;
 
@@ -196,7 +198,10 @@ static void UnpackVCT( ATSC_PSI* pATSCPSI, TS_SECTION* pSection )
 	pATSCPSI->vct_update_flag  = pATSCPSI->vct_section_crc32 != pSection->crc32;
 	pATSCPSI->vct_section_crc32 = pSection->crc32;
 	if ( pATSCPSI->vct_update_flag == 0 ) //pat unchange, skip it
+	{
+		CacheSection( pSection );
 		return;
+	}
 
 	if ( pATSCPSI->psi_parser->sub_format == 0 ) 
 	{
@@ -303,6 +308,7 @@ static void UnpackVCT( ATSC_PSI* pATSCPSI, TS_SECTION* pSection )
 	{
 		ReleaseEitCells( pATSCPSI );
 		CreateEitCells( pATSCPSI, pATSCPSI->vct_num+4 ); 
+		ResetSectionCache( pSection->cache ); //EIT and ETT sections are unpacked again
 	}
 
  	//dump channel information here
@@ -311,6 +317,8 @@ static void UnpackVCT( ATSC_PSI* pATSCPSI, TS_SECTION* pSection )
 		int i, ret;
 		CHANNEL_DATA channel_data={0};
 		channel_data.update_flag   = update_flag;
+		channel_data.section_number = section_header.section_number;
+		channel_data.last_section_number = section_header.last_section_number;
 		channel_data.stream_format = ATSC_STREAM;
 		channel_data.sub_format  = pATSCPSI->psi_parser->sub_format;
 		channel_data.num_channel = pATSCPSI->vct_num;
@@ -334,6 +342,8 @@ static void UnpackVCT( ATSC_PSI* pATSCPSI, TS_SECTION* pSection )
 		if (  channel_data.command != 1  )
 			pATSCPSI->vct_section_crc32 = 0; 
 	}
+	if ( pATSCPSI->vct_section_crc32 )
+		CacheSection( pSection );
 }
 
 static int GetChannelNum( ATSC_PSI* pATSCPSI, int nSourceId )
@@ -363,6 +373,7 @@ static int UnpackRTT( ATSC_PSI* pATSCPSI, TS_SECTION* pSection )
 
 	pATSCPSI->rtt_update_flag  = pATSCPSI->rtt_section_crc32 != pSection->crc32;
 	pATSCPSI->rtt_section_crc32 = pSection->crc32;
+	CacheSection( pSection );
 	if ( pATSCPSI->rtt_update_flag == 0 ) //pat unchange, skip it
 		return 1;
 
@@ -409,7 +420,7 @@ static int UnpackRTT( ATSC_PSI* pATSCPSI, TS_SECTION* pSection )
 	}
 	if ( pRTT->rating == NULL )
 	{
-		pRTT->rating = SAGETV_MALLOC( num * sizeof(RATING) );
+		pRTT->rating = SAGETV_MALLOC_TAG( num * sizeof(RATING), MEM_TAG_PSI );
 		pRTT->dimension_num = num;
 	}
 
@@ -642,7 +653,7 @@ static void MoveEitCell( EIT *pEitTar, EIT *pEitSrc )
 
 static void CreateEitCells( ATSC_PSI* pATSCPSI, int nChannelNum )
 {
-	pATSCPSI->eit_blk = SAGETV_MALLOC( sizeof(EIT_COL)* nChannelNum );
+	pATSCPSI->eit_blk = SAGETV_MALLOC_TAG( sizeof(EIT_COL)* nChannelNum, MEM_TAG_EPG );
 	pATSCPSI->eit_blk_num = nChannelNum;
 }
 
@@ -1041,7 +1052,7 @@ static int UnpackEIT( ATSC_PSI* pATSCPSI, TS_SECTION* pSection, int nType  )
 	SECTION_HEADER section_header;
 	unsigned short source_id;
 	int  num_event;
-	int  bytes, len, j, update_flag = 0;
+	int  bytes, len, j, update_flag = 0, lost_evnt = 0;
 	unsigned char* desc_ptr; 
 	int            desc_len;
 	unsigned short desc_length;
@@ -1058,7 +1069,10 @@ static int UnpackEIT( ATSC_PSI* pATSCPSI, TS_SECTION* pSection, int nType  )
 	pATSCPSI->eit_update_flag  = pATSCPSI->eit_section_crc32[nType] != pSection->crc32;
 	pATSCPSI->eit_section_crc32[nType] = pSection->crc32;
 	if ( pATSCPSI->eit_update_flag == 0 ) //pat unchange, skip it
+	{
+		CacheSection( pSection );
 		return 1;
+	}
 
 	source_id = section_header.tsid;
 	p = section_header.table_data;
@@ -1080,7 +1094,10 @@ static int UnpackEIT( ATSC_PSI* pATSCPSI, TS_SECTION* pSection, int nType  )
 			//SageLog(( _LOG_TRACE, 3, TEXT("EPG EIT src_id:%d evt_id%d"), source_id, event_id  ));
 		}
 		if ( pEit == NULL )
+		{
 			pEit = &eit_tmp;
+			lost_evnt++;
+		}
 		pEit->source_id  = source_id;
 		pEit->event_id   = event_id; 
 		pEit->start_time = ( p[2] << 24) | ( p[3]<<16 ) | ( p[4]<<8 ) | p[5];
@@ -1147,6 +1164,18 @@ static int UnpackEIT( ATSC_PSI* pATSCPSI, TS_SECTION* pSection, int nType  )
 	}
 	ReleaseEitCell( &eit_tmp );
 
+	//ETT of changed titles are dumped again with new titles, cached ETT sections of the EIT are dropped
+	if ( update_flag )
+	{
+		int i;
+		for ( i = 0; i<pATSCPSI->mgt_num; i++ )
+			if ( pATSCPSI->mgt[i].type == 0x200+nType )
+				UncacheSectionPid( pSection->cache, pATSCPSI->mgt[i].pid );
+	}
+
+	//a section of events out of cells is unpacked again when it repeats
+	if ( !lost_evnt )
+		CacheSection( pSection );
 	return 1;
 }
 
@@ -1168,7 +1197,10 @@ static int UnpackETT( ATSC_PSI* pATSCPSI, TS_SECTION* pSection, int nType )
 	pATSCPSI->ett_update_flag  = pATSCPSI->ett_section_crc32[nType] != pSection->crc32;
 	pATSCPSI->ett_section_crc32[nType] = pSection->crc32;
 	if ( pATSCPSI->ett_update_flag == 0 ) //pat unchange, skip it
+	{
+		CacheSection( pSection );
 		return 1;
+	}
 
 	ett.ett_ext_id = section_header.tsid;
 	p = section_header.table_data;
@@ -1219,6 +1251,7 @@ static int UnpackETT( ATSC_PSI* pATSCPSI, TS_SECTION* pSection, int nType )
 			}
 
 			ReleaseDescData( &program );
+			CacheSection( pSection );
 			return 1;
 		}
 	}
@@ -1239,9 +1272,13 @@ int ProcessATSCPSI( ATSC_PSI* pATSCPSI, TS_PACKET *pTSPacket )
 		if ( !CheckPacketContinuity( pTSPacket, &pATSCPSI->atsc_psi_section->counter ) )
 			return 0;
 
+		pATSCPSI->atsc_psi_section->pid = pid;
 		if ( !UnpackSection( pTSPacket->start, pATSCPSI->atsc_psi_section, payload_data, payload_size ) )
 			return 0;
 
+		if ( pATSCPSI->atsc_psi_section->cached ) //a repeat of unpacked section
+			return 1;
+
 		switch ( pATSCPSI->atsc_psi_section->section_type ) {
 		case 0xc5:  //STT
 			break;
@@ -1284,9 +1321,13 @@ int ProcessATSCPSI( ATSC_PSI* pATSCPSI, TS_PACKET *pTSPacket )
 				if ( !CheckPacketContinuity( pTSPacket, &pATSCPSI->atsc_psi_section->counter ) )
 					return 0;
 
+				pATSCPSI->atsc_psi_section->pid = pid;
 				if ( !UnpackSection( pTSPacket->start, pATSCPSI->atsc_psi_section, payload_data, payload_size ) )
 					return 0;
 
+				if ( pATSCPSI->atsc_psi_section->cached )
+					return 1;
+
 				if (  pATSCPSI->mgt[i].type == 0 ) 
 				{
 					if ( pATSCPSI->atsc_psi_section->section_type == 0xc8 )
@@ -1394,14 +1435,18 @@ int UnpackMultipleString( unsigned char* p, int Bytes, int nCol, int nRow, STRIN
 			if ( offset+len > (unsigned int)Bytes ) return 0;
 			if ( i == nCol && j == nRow && len )
 			{
+				unsigned char buf[ATSC_HUFFMAN_MAX_BYTES(255)];
 				unsigned char* data_p;
-				int size, num;
+				int num;
 				pString->language_code = language_code;
 				pString->charset_code =  (unsigned char*)"[set=UTF-8]";
 
-				size = GetUncompressBytes( compression, p+offset,len );
-				data_p = NewDescData( &pString->data, size+1 );
-				num = UncompressHuffman( compression, data_p, size, p+offset,len );
+				//decoded in one pass, a string of a byte (a bare terminator) is empty as it's always been
+				num = UncompressATSCHuffman( compression, buf, sizeof(buf), p+offset, len );
+				if ( num <= 1 )
+					num = 0;
+				data_p = NewDescData( &pString->data, num+1 );
+				memcpy( data_p, buf, num );
 				data_p[num] = 0x0;
 				pString->data.desc_bytes = num;
 				return num;
@@ -1440,7 +1485,7 @@ int UnpackMultipleString256( unsigned char* p, int Bytes, int nCol, int nRow, ST
 				pString->language_code = language_code;
 				pString->charset_code = (unsigned char*)"[set=UTF-8]";
 
-				num = UncompressHuffman( compression, pString->data, sizeof(pString->data), p+offset,len );
+				num = UncompressATSCHuffman( compression, pString->data, sizeof(pString->data), p+offset,len );
 				if ( sizeof(pString->data) > num ) 
 					pString->data[num] = 0x0;
 				pString->bytes = num;
@@ -1453,196 +1498,3 @@ int UnpackMultipleString256( unsigned char* p, int Bytes, int nCol, int nRow, ST
 
 }
 
-extern unsigned char program_huffman_tbl[];
-extern unsigned char title_huffman_tbl[];
-static unsigned char GetNext8Bits( unsigned char* pData, int pos, unsigned char bit )
-{
-	int i;
-	unsigned char ch;
-	ch = 0;
-	for ( i = 0; i<8; i++ )
-	{
-		bit >>= 1;
-		ch <<= 1;
-		if ( bit == 0 ) 	
-		{    pos++; 
-		     bit = 0x80; 
-		} 
-		if ( bit & pData[pos] ) ch |= 1;
-	}
-	return ch;
-}
-static int UncompressHuffman( int Type, unsigned char* pOut, int MaxSize, unsigned char* pData, int Length )
-{
-	int i, bytes;
-	unsigned char *huffman, *tree_root;
-	unsigned char lch, cch, ch;
-	unsigned char bit;
-	int offset, index;
-
-	if ( Length <= 0 || pData == NULL  || MaxSize <= 1 )
-		return 0;
-
-	if ( Type == 1  ) 
-		huffman = title_huffman_tbl;
-	else
-	if ( Type == 2  ) 
-		huffman = program_huffman_tbl;
-	else
-	{
-		//unknow format, just output
-		bytes = _MIN( Length, MaxSize );
-		memcpy( pOut, pData, bytes );
-		return bytes;
-	}
-
-	bytes = 0;	i = 0;
-	index = 0;
-	lch = 0; bit = 0; cch = 0;
-	index = (huffman[lch*2]<<8)|huffman[lch*2+1];
-	tree_root = &huffman[index];
-	offset = 0;
-	while ( bytes < MaxSize  )
-	{
-		unsigned char node;
-
-		if ( i >= Length && bit == 0 )
-			break;
-
-		if ( bit == 0 ) 
-		{
-			cch = pData[i++];
-			bit = 0x80;
-		}
-
-		if ( bit & cch )
-			node = tree_root[offset+1];  //right child branch
-		else
-			node = tree_root[offset];    //left child branch
-
-		if ( node & 0x80 )
-		{
-			ch = node & 0x7f;
-			if ( ch == 27 )
-			{
-				lch = GetNext8Bits( pData, i-1, bit );  //get uncompressed 8 bits to output
-				cch = pData[i++];  //skip 8 bits
-			} else
-			{
-				lch = ch; 
-			}
-			*pOut++ = lch;
-			bytes++;
-			
-			if ( bytes >= MaxSize )
-			{
-				//printf( "uncompress buffer is too small\n" );
-			}
-
-			if ( lch == 0 )
-				break;
-
-			index = (huffman[lch*2]<<8)|huffman[lch*2+1];
-			tree_root = &huffman[index];
-
-			if ( (Type == 2 && index > 1781) || (Type == 1 && index > 1939) ) 
-			{
-				//printf( "Error uncompress\n" );
-				return bytes;
-			}
-			offset = 0;
-
-		}
-		else
-		{
-			offset = node*2 ;
-		}
-
-		bit >>= 1;
-		
-	}
-
-	return bytes;
-}
-	
-static int GetUncompressBytes( int Type, unsigned char* pData, int Length )
-{
-	int i, bytes;
-	unsigned char *huffman, *tree_root;
-	unsigned char lch, cch, ch;
-	unsigned char bit;
-	int offset, index;
-
-	if ( Type == 1  ) 
-		huffman = title_huffman_tbl;
-	else
-	if ( Type == 2  ) 
-		huffman = program_huffman_tbl;
-	else
-	{
-		//unknow format, just output
-		return Length;
-	}
-
-	bytes = 0;	i = 0;
-	index = 0;
-	lch = 0; bit = 0; cch = 0;
-	index = (huffman[lch*2]<<8)|huffman[lch*2+1];
-	tree_root = &huffman[index];
-	offset = 0;
-	while ( 1  )
-	{
-		unsigned char node;
-		if ( i >= Length && bit == 0 )
-			break;
-
-		if ( bit == 0 ) 
-		{
-			cch = pData[i++];
-			bit = 0x80;
-		}
-
-		if ( bit & cch )
-			node = tree_root[offset+1];  //right child branch
-		else
-			node = tree_root[offset];    //left child branch
-
-		if ( node & 0x80 )
-		{
-			ch = node & 0x7f;
-			if ( ch == 27 )
-			{
-				lch = GetNext8Bits( pData, i-1, bit );  //get uncompressed 8 bits to output
-				cch = pData[i++];  //skip 8 bits
-			} else
-			{
-				lch = ch; 
-			}
-			
-			bytes++;
-			if ( lch == 0 )
-				break;
-
-			index = (huffman[lch*2]<<8)|huffman[lch*2+1];
-			tree_root = &huffman[index];
-
-			if ( (Type == 2 && index > 1781) || (Type == 1 && index > 1939) ) 
-			{
-				//printf( "Error uncompress\n" );
-				return bytes;
-			}
-			offset = 0;
-
-		}
-		else
-		{
-			offset = node*2 ;
-		}
-
-		bit >>= 1;
-		
-	}
-
-	return bytes;
-}
-
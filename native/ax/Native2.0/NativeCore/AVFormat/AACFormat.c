@@ -287,23 +287,22 @@ static int UnpackAACHEAudio( AAC_AUDIO *pAACAudio, const unsigned char * pbData,
 	unsigned short pack_frame_length;
 	int i, cfg_found = 0;
 	const unsigned char* pData;
+	const unsigned char* sync_p;
+	static const unsigned short loas_sync = 0x56e0;
 	int Size;
 
 	Size = nSize;
 	pData = pbData;
 
 	//search LOAS head
-	i = 0;
-	while ( i < Size-1 && !(pData[i] == 0x56 && ((pData[i+1] & 0xE0)==0xE0 )) )
-		i++;
-
-	if ( !(pData[i] == 0x56 && ((pData[i+1] & 0xE0)==0xE0 )) )
+	if ( (sync_p = SearchSyncWord( pData, Size, &loas_sync, 1, 0xffe0 )) == NULL )
 	{
 		pAACAudio->state = 0;
 		pAACAudio->format = 0;
 		return 0;
 	}
 	
+	i = (int)(sync_p - pData);
 	pbData += i;
 	nSize -= i;
 
@@ -196,13 +196,17 @@ int ReadDTS_AudioHeader( DTS_AUDIO *pDTSAudio, const unsigned char* pbData, int
 {
 	int i, ret=0;
 	const unsigned char* pData = pbData;
+	const unsigned char* sync_p;
+	//first 16 bits of 14 bits LE/BE and 16 bits BE/LE sync words
+	static const unsigned short dts_sync[4] = { 0xff1f, 0x1fff, 0x7ffe, 0xfe7f };
     unsigned char buf[DTS_HEADER_SIZE];
 
 	if ( Size < DTS_HEADER_SIZE )
 		return 0;
 
-	for ( i = 0; i<Size-DTS_HEADER_SIZE; i++  )
+	for ( i = 0; (sync_p = SearchSyncWord( pData+i, Size-DTS_HEADER_SIZE-i+1, dts_sync, 4, 0xffff )) != NULL; i++ )
 	{
+		i = (int)(sync_p - pData);
 		/* 14 bits,Little endian version of the bitstream */
 		if( pData[i+0] == 0xff && pData[i+1] == 0x1f &&
 			pData[i+2] == 0x00 && pData[i+3] == 0xe8 &&
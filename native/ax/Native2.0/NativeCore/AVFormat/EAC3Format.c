@@ -85,17 +85,15 @@ static int EAC3SyncInfo ( unsigned char* buf, int * sample_rate, int * bit_rate,
 int ReadEAC3AudioHeader( EAC3_AUDIO *pEAC3Audio, const unsigned char* pStart, int nSize )
 {
 	const unsigned char *p;
+	const unsigned char *sync_p;
+	static const unsigned short ac3_sync[2] = { 0x0B77, 0x770B };
 	int i;
 	int sample_rate, bit_rate, channels;
 	p = pStart;
 
 	//search for AC3 SYNC code 
-	for ( i = 0; i<nSize-1; i++ )
-	{
-		if ( ( p[i] == 0x0B && p[i+1] == 0x77 ) ||
-			 ( p[i] == 0x77 && p[i+1] == 0x0B ) )
-			 break;
-	}
+	sync_p = SearchSyncWord( p, nSize, ac3_sync, 2, 0xffff );
+	i = sync_p != NULL ? (int)(sync_p - p) : nSize-1;
 
 	if ( i >= nSize -6 )
 		return 0;
@@ -100,27 +100,6 @@ int H264AspectRatioDenoValue( unsigned short nomi, unsigned short deno, long wid
 
 
 
-static int NAL2RBSP( unsigned char* src, unsigned char* dst, int size )
-{
-	int si=0, di=0;
-    while(si<size)
-	{    
-        if(si+2<size && src[si]==0 && src[si+1]==0 && src[si+2]<=3){
-            if(src[si+2]==3){ //escape
-                dst[di++]= 0;
-                dst[di++]= 0;
-                si+=3;
-                continue;
-            }
-			//else //next start code
-   //             return di;
-        }
-
-        dst[di++]= src[si++];
-    }
-	return di;
-}
-
 static void skip_scaling_List(  int sizeOfScalingList, BITS_I *pBits )                                                                                
 {      
 	const unsigned char ZZ_SCAN[16]  =                                                                                                                                                                 
@@ -283,47 +262,38 @@ int ReadH264VideoHeader( H264_VIDEO *pH264Video, const unsigned char* pData, int
 {
 	const unsigned char* p;
 	unsigned char rbsp[256*2];
-	int zero_bytes;
+	const unsigned char* nal;
 	BITS_I bits;
-	zero_bytes  = 0;
 	p = pData;
 
 	bits.error_flag = 0;
 	
 	while ( 1 )
 	{
-		//start code prefix search
-		while ( p < pData+Size-1 )
+		//start code prefix search, zero_byte + 00 00 01 (3 or more zero bytes) leads SPS/PPS and an AU
+		while ( (nal = SearchZeroRunEnd( p, (int)(pData+Size-1-p), 3 )) != NULL )
 		{
-			if ( *p == 0 ) 
-				zero_bytes++;
-			if ( zero_bytes >= 3 && *p )
+			p = nal;
+			if ( *p != 1 && *p != 3 )
 			{
-				if ( *p != 1 && *p != 3 )
+				//illeag byte codes in H.264
+				if ( pH264Video->guessH264 > -200 ) pH264Video->guessH264 -= 20; //not H.264 stream
+				return 0;
+			} else
+			if ( *p == 1 ) 
+			{
+				if ( *(p+1) & 0x80 )  //forbidden bits
 				{
-					//illeag byte codes in H.264
-					if ( pH264Video->guessH264 > -200 ) pH264Video->guessH264 -= 20; //not H.264 stream
+					if ( pH264Video->guessH264 > -200 )  pH264Video->guessH264 -= 20; //not H.264 stream
 					return 0;
-				} else
-				if ( *p == 1 ) 
-				{
-					if ( *(p+1) & 0x80 )  //forbidden bits
-					{
-						if ( pH264Video->guessH264 > -200 )  pH264Video->guessH264 -= 20; //not H.264 stream
-						return 0;
-					} else
-					{
-						p++;
-						zero_bytes = 0;
-						break;                        //found HAL header
-					}
 				}
+				p++;
+				break;                        //found HAL header
 			}
-			if ( *p ) zero_bytes = 0;
 			p++;
 		}
 
-		if ( p < pData+Size-1 )
+		if ( nal != NULL && p < pData+Size-1 )
 		{
 			int nal_ref_idc, nal_unit_type;
 			int bit_num;
@@ -335,7 +305,7 @@ int ReadH264VideoHeader( H264_VIDEO *pH264Video, const unsigned char* pData, int
 			if ( nal_unit_type == NAL_SPS )
 			{
 				int bytes = ( Size-(int)(p-pData) < (int)sizeof(rbsp) ) ? Size-(int)(p-pData) : (int)sizeof(rbsp) ;
-				bytes = NAL2RBSP( (unsigned char*)p, (unsigned char*)rbsp, bytes );
+				bytes = RemoveEmulationPrevention( p, bytes, rbsp );
 				p += bytes;
 				if ( bytes < 4 )
 					return 0;  //too little data to parse information
@@ -548,7 +518,7 @@ int ReadH264VideoHeader( H264_VIDEO *pH264Video, const unsigned char* pData, int
 			{
 				int bytes = ( Size-(int)(p-pData) < (int)sizeof(rbsp) ) ? Size-(int)(p-pData) : (int)sizeof(rbsp) ;
 				//printf( "NALU SEI:%d\n", nal_unit_type );
-				bytes = NAL2RBSP( (unsigned char*)p, (unsigned char*)rbsp, bytes );
+				bytes = RemoveEmulationPrevention( p, bytes, rbsp );
 				p += bytes;
 			} else
 			{
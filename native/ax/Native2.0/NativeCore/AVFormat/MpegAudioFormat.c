@@ -46,18 +46,23 @@ int ReadMpegAudioHeader( MPEG_AUDIO *pMpegAudio, const unsigned char* pStart, in
 {
 	int Layer,i,MPGVersion, CRC_protected, BiteRateIndex, SampleRateIndex;
 	unsigned char LayerCode;
-	const unsigned char *pData;
+	const unsigned char *pData, *sync_p;
+	static const unsigned short mpa_sync = 0xfff0;
 	unsigned long Bitrate;
 
 	pData = pStart;
 
 	//search for SYNC bits (12bits of 1) of Mpeg 4 bytes audio header
 	//11 bits 1 if we supports MPEG-2.5 , I will add it suport in later versuin  ZQ. 
-	for ( i = 0; i<Size-2; i++, pData++ ) 
-		if ( *pData == 0xff && ( *(pData+1) & 0xf0 ) == 0xf0 && ( *(pData+2) & 0xf0 ) != 0xf0  )
+	for ( i = 0; (sync_p = SearchSyncWord( pStart+i, Size-1-i, &mpa_sync, 1, 0xfff0 )) != NULL; i++ )
+	{
+		i = (int)(sync_p - pStart);
+		if ( ( *(sync_p+2) & 0xf0 ) != 0xf0 )
 			break;
-	if ( i>Size-4 )
+	}
+	if ( sync_p == NULL || i>Size-4 )
 		return 0;
+	pData = sync_p;
 
 	//verify if it's a vaild header
 	if (((*(pData+2)	>> 2) &	3) == 3)	//Invalid sample rate
@@ -47,22 +47,10 @@ typedef struct MPEG_VIDEO
 
 } MPEG_VIDEO;
 
+//a code is taken only with a byte behind it (pos+4 < nBytes), callers read the header bytes that follow it
 inline static const unsigned char* SearchMPEGStartCode( const unsigned char* pData, int nBytes, unsigned long StartCode )
 {
-	unsigned long code;
-
-	if ( nBytes < 4 )
-		return NULL;
-
-	code = 0xffffff00 |*pData++;
-	while ( --nBytes )
-	{
-		if ( code == StartCode )
-			return pData - 4;
-		code = (( code << 8 )| *pData++ );
-	}
-
-	return NULL;
+	return SearchStartCode( pData, nBytes-1, (int)(StartCode & 0xff) );
 }
 
 
@@ -32,20 +32,7 @@
 
 inline unsigned char* SeekMPEG2StartCode( const unsigned char* pData, int nBytes, unsigned	long StartCode )
 {
-	unsigned long code;
-
-	if ( nBytes < 4 )
-		return NULL;
-
-	code = 0xffffff00 |*pData++;
-	while ( --nBytes )
-	{
-		if ( ( (code&0x00ffffff)==0x01 ) && *(pData)==StartCode  )
-			return (unsigned char* )pData-3;
-		code = (( code << 8 )| *pData++ );
-	}
-
-	return NULL;
+	return (unsigned char* )SearchStartCode( pData, nBytes, (int)StartCode );
 }
 
 int SeekFrameType( const unsigned char* pData, int Size, const unsigned char **ppStart )
@@ -44,6 +44,7 @@ FIFO_BUFFER* CreateFIFOBuffer( int nQueueNum, int nBlockSize )
 		pFIFOBuffer->block_buffer_pool[i].state = 0;
 		pFIFOBuffer->block_buffer_pool[i].index = i;
 		pFIFOBuffer->block_buffer_pool[i].fifo_index = 0xffff;
+		pFIFOBuffer->block_buffer_pool[i].fifo_buffer = pFIFOBuffer;
 	}
 	return pFIFOBuffer;
 }
@@ -63,11 +64,14 @@ void ResetFIFOBuffer( FIFO_BUFFER* pFIFOBuffer )
 	{
 		pFIFOBuffer->block_buffer_pool[i].state = FREE_BLOCK_STATE;
 		pFIFOBuffer->block_buffer_pool[i].fifo_index = 0xffff;
+		pFIFOBuffer->block_buffer_pool[i].ref_count = 0;
 	}
 
 	pFIFOBuffer->num_of_in_queue = 0;
 	pFIFOBuffer->block_buffer_inuse = 0;
 	pFIFOBuffer->num_of_out_queue = 0;
+	pFIFOBuffer->num_of_held = 0;
+	pFIFOBuffer->num_of_dropped = 0;
 }
 
 BLOCK_BUFFER* RequestFIFOBuffer( FIFO_BUFFER* pFIFOBuffer )
@@ -88,6 +92,7 @@ BLOCK_BUFFER* RequestFIFOBuffer( FIFO_BUFFER* pFIFOBuffer )
 	}
 
 	pFIFOBuffer->block_buffer_pool[i].state = INUSE_BLOCK_STATE;
+	pFIFOBuffer->block_buffer_pool[i].ref_count = 1;
 	pFIFOBuffer->block_buffer_pool[i].fifo_index = pFIFOBuffer->num_of_in_queue;
 	pFIFOBuffer->fifo_queue[pFIFOBuffer->num_of_in_queue++] = &pFIFOBuffer->block_buffer_pool[i];
 	pFIFOBuffer->block_buffer_inuse++;
@@ -98,9 +103,25 @@ BLOCK_BUFFER* RequestFIFOBuffer( FIFO_BUFFER* pFIFOBuffer )
 void ReleaseBlockBuffer( FIFO_BUFFER* pFIFOBuffer, BLOCK_BUFFER* pBlockBuffer )
 {
 	pBlockBuffer->state = FREE_BLOCK_STATE;
+	pBlockBuffer->ref_count = 0;
 	pFIFOBuffer->block_buffer_inuse--;
 }
 
+int HoldBlockBuffer( BLOCK_BUFFER* pBlockBuffer )
+{
+	if ( pBlockBuffer == NULL || pBlockBuffer->ref_count == 0 )
+		return 0;
+	pBlockBuffer->ref_count++;
+	return 1;
+}
+
+void DropBlockBuffer( BLOCK_BUFFER* pBlockBuffer )
+{
+	ASSERT( pBlockBuffer->ref_count > 0 );
+	if ( pBlockBuffer->ref_count > 0 && --pBlockBuffer->ref_count == 0 && pBlockBuffer->state == HELD_BLOCK_STATE )
+		pBlockBuffer->fifo_buffer->num_of_dropped++;
+}
+
 void PushBlockBuffer( FIFO_BUFFER* pFIFOBuffer, BLOCK_BUFFER* pBlockBuffer )
 {
 	if ( pBlockBuffer->fifo_index < pFIFOBuffer->total_queue_num && 
@@ -125,7 +146,7 @@ BLOCK_BUFFER* PopBlockBuffer( FIFO_BUFFER* pFIFOBuffer )
 	if ( pFIFOBuffer->fifo_queue[ 0 ]->state != READY_BLOCK_STATE )
 	{
 		//the FIFO queue is full, a es block is kicked out off FIFO queue
-		if ( pFIFOBuffer->num_of_in_queue+pFIFOBuffer->num_of_out_queue >= pFIFOBuffer->total_queue_num-2 )
+		if ( pFIFOBuffer->num_of_in_queue+pFIFOBuffer->num_of_out_queue+pFIFOBuffer->num_of_held >= pFIFOBuffer->total_queue_num-2 )
 		{
 			//SageLog(( _LOG_TRACE, 3, TEXT("WARNING:  FIFO queue is full, a es block is kicked out off FIFO queue" ) ));
 			while ( pFIFOBuffer->num_of_in_queue > 0)
@@ -167,4 +188,4 @@ BLOCK_BUFFER* PopBlockBuffer( FIFO_BUFFER* pFIFOBuffer )
 BLOCK_BUFFER* TopBlockBuffer( FIFO_BUFFER* pFIFOBuffer )
 {
 	return pFIFOBuffer->fifo_queue[ 0 ];
-}
\ No newline at end of file
+}
\ No newline at end of file
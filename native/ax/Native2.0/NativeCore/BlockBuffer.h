@@ -27,6 +27,7 @@ enum BLOCK_BUFFER_STATE {
 	FREE_BLOCK_STATE  = 0x0,
 	INUSE_BLOCK_STATE = 0x01,
 	READY_BLOCK_STATE = 0x02,
+	HELD_BLOCK_STATE  = 0x04,	//out of FIFO, a consumer still holds its data
 } ;
 
 
@@ -40,6 +41,8 @@ typedef struct BLOCK_BUFFER
 
 	unsigned short slot_index;
 	unsigned short track_index;
+	unsigned short ref_count;	//0: data can't be held (not a FIFO block), 1: owned by FIFO
+	struct FIFO_BUFFER *fifo_buffer;
 
 	PES	pes;
 	ULONGLONG start_cue;
@@ -58,6 +61,8 @@ typedef struct FIFO_BUFFER
 	unsigned short num_of_in_queue;
 	unsigned short num_of_out_queue;
 	unsigned short block_buffer_inuse;
+	unsigned short num_of_held;
+	unsigned short num_of_dropped; //held blocks the consumer has dropped, waiting for reclaim
 	BLOCK_BUFFER  *block_buffer_pool;
 	//unsigned char *all_buffer_data;
 	//unsigned long  all_buffer_size;
@@ -72,6 +77,12 @@ BLOCK_BUFFER* PopBlockBuffer( FIFO_BUFFER* pFIFOBuffer );
 BLOCK_BUFFER* TopBlockBuffer( FIFO_BUFFER* pFIFOBuffer );
 void ReleaseBlockBuffer( FIFO_BUFFER* pFIFOBuffer, BLOCK_BUFFER* pBlockBuffer );
 
+//a consumer of dumped data may hold a block to use its data after the dumper returns, the block memory is
+//reclaimed by the demuxer after the last drop. Hold and drop on the thread that pushes data; a slot has
+//FIFO_QUEUE_SIZE blocks, a consumer should hold no more than a quarter of them and drop all before a reset.
+int  HoldBlockBuffer( BLOCK_BUFFER* pBlockBuffer );
+void DropBlockBuffer( BLOCK_BUFFER* pBlockBuffer );
+
 #ifdef __cplusplus
 }
 #endif
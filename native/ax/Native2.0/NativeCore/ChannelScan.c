@@ -51,6 +51,9 @@ static void AssignTuneData( DVB_CHANNEL* pDVBChannel, TUNE_DAT* pTuneData );
 static int  AddProgrmToList( PROGRAM_LIST *pProgramList, unsigned short nTsid, unsigned short nProgramId, unsigned short nChannel );
 static void ChannelScanZero( SCAN* pScan  );
 static int  FindProgram( PROGRAM_LIST *pProgramList, int nChannel );
+static int  SectionSeen( unsigned char* pSections, int nSection, int nLastSection );
+static int  ScanTablesDone( SCAN* pScan );
+static void ResetScanTables( SCAN* pScan );
 int HasCADesc( unsigned char *pData, int nBytes );
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -71,6 +74,10 @@ static int ChannelDataDumper( void* pContext, unsigned char* pData, int nSize )
 		channel_data->u.atsc[0].physical_ch = pScan->tune.u.atsc.physical_ch;
 		InitScanData( pScan, channel_data->stream_format, channel_data->sub_format );
 		ret = AddChannelList( &pScan->channel_list, channel_data, &pScan->tune_list );
+		if ( SectionSeen( pScan->vct_section, channel_data->section_number, channel_data->last_section_number ) )
+			pScan->table_done |= SCAN_TABLE_VCT;
+		if ( (pScan->table_needed & SCAN_TABLE_VCT) && !(pScan->table_done & SCAN_TABLE_VCT) )
+			return 1; //the rest sections of VCT
 	
 		pScan->state = 0x03;
 		SageLog(( _LOG_TRACE, 3, TEXT("\t**** PSI ATSC/QAM scan channel ready.") ));
@@ -88,7 +95,10 @@ static int ChannelDataDumper( void* pContext, unsigned char* pData, int nSize )
 		}
 
 		ret = AddChannelList( &pScan->channel_list, channel_data, &pScan->tune_list );
-		if ( ret == 0 )
+		if ( SectionSeen( pScan->sdt_section, channel_data->section_number, channel_data->last_section_number ) )
+			pScan->table_done |= SCAN_TABLE_SDT;
+		//SDT repeats without a new channel, or all of its sections are seen
+		if ( ret == 0 || ( pScan->table_needed & pScan->table_done & SCAN_TABLE_SDT ) )
 		{
 			pScan->state |= 0x0001;
 			if ( CheckChannelStateReady( &pScan->channel_list ) )
@@ -194,6 +204,9 @@ static int TuneDataDumper( void* pContext, unsigned char* pData, int nSize )
 			}
 		}
 
+		if ( local_nit && SectionSeen( pScan->nit_section, tune_data->section_number, tune_data->last_section_number ) )
+			pScan->table_done |= SCAN_TABLE_NIT;
+
 		if (  ret > 0  ) 
 		{
 			tune_data->command = 0;
@@ -524,6 +537,7 @@ SCAN *CreateChannelScan(  void* pDemuxer, TUNE *pTune )
 	pScan->pmt_dump_enabled = 0;
 	pScan->last_time_clock = 0;
 	pScan->time_elapse = 0;
+	pScan->table_needed = SCAN_TABLE_DEFAULT;
 
 	DisableRebuildTSStream( pScan->demuxer );
 	return pScan;
@@ -580,6 +594,7 @@ void ResetChannelScan( SCAN* pScan )
 	pScan->nit_counter = 0;
 	pScan->stream_format = 0;
 	pScan->sub_format = 0;   
+	ResetScanTables( pScan );
 
 	ResetDemuxStream( pScan->demuxer );
 
@@ -658,12 +673,14 @@ void DoChannelScan( SCAN* pScan, int nTask )
 	}
 	pScan->command = 0;
 	pScan->state = 0;
+	ResetScanTables( pScan );
 }
 
 void ChannelScanTune( SCAN* pScan, TUNE *pTune )
 {
 	pScan->command = 0;
 	pScan->state = 0;
+	ResetScanTables( pScan );
 	pScan->tune = *pTune;
 	pScan->tune.u.atsc.minor_num = 0xffff;
 	pScan->tune.channel = 0;
@@ -736,9 +753,12 @@ int IsNakedStream( SCAN* pScan )
 
 int IsChannelInfoReady( SCAN* pScan )
 {
-	if ( (pScan->state & 0x0003)== 0x0003 )
+	if ( (pScan->state & 0x0003)== 0x0003 && ScanTablesDone( pScan ) )
 		return 2;  //psi channels is ready
 
+	if ( (pScan->table_needed & SCAN_TABLE_NIT) && (pScan->state & 0x0001) && ScanTablesDone( pScan ) )
+		return 2;  //complete NIT doesn't carry all channels
+
 	if ( (pScan->state & 0x0010) )
 		return 3;  //a naked channel ready
 
@@ -792,6 +812,45 @@ int UpdateTimeClock( SCAN* pScan, unsigned long lMillionSecond )
 	return pScan->time_elapse;
 }
 
+//returns 1 once all sections up to the last are seen
+static int SectionSeen( unsigned char* pSections, int nSection, int nLastSection )
+{
+	int i;
+	if ( nSection > nLastSection )
+		return 0;
+	pSections[nSection>>3] |= 1<<(nSection&7);
+	for ( i = 0; i<=nLastSection; i++ )
+		if ( !( pSections[i>>3] & (1<<(i&7)) ) )
+			return 0;
+	return 1;
+}
+
+static int ScanTablesDone( SCAN* pScan )
+{
+	unsigned short tables;
+	tables = pScan->stream_format == ATSC_STREAM ? SCAN_TABLE_VCT : SCAN_TABLE_SDT|SCAN_TABLE_NIT;
+	tables &= pScan->table_needed;
+	return ( pScan->table_done & tables ) == tables;
+}
+
+static void ResetScanTables( SCAN* pScan )
+{
+	pScan->table_done = 0;
+	memset( pScan->sdt_section, 0, sizeof(pScan->sdt_section) );
+	memset( pScan->nit_section, 0, sizeof(pScan->nit_section) );
+	memset( pScan->vct_section, 0, sizeof(pScan->vct_section) );
+}
+
+void ChannelScanNeedTables( SCAN* pScan, unsigned short nTables )
+{
+	pScan->table_needed = nTables;
+}
+
+int ChannelScanTablesDone( SCAN* pScan )
+{
+	return pScan->table_done;
+}
+
 int ChannelInfoState( SCAN* pScan )
 {
 	int data_avaliable;
@@ -925,6 +984,15 @@ static TUNE_DAT *GetTuneData( TUNE_LIST *pTuneList, unsigned short nOnid, unsign
 	return NULL;
 }
 
+static void ExpendTuneList( TUNE_LIST *pTuneList, int nExpendNum )
+{
+	TUNE_DAT *old_tune = pTuneList->tune;
+	pTuneList->tune = SAGETV_MALLOC( (pTuneList->total_list_num+nExpendNum)*sizeof( TUNE_DAT ) );
+	memcpy( pTuneList->tune, old_tune, pTuneList->total_list_num * sizeof(TUNE_DAT) );
+	pTuneList->total_list_num += nExpendNum;
+	SAGETV_FREE( old_tune );
+}
+
 static int AddTuneList( TUNE_LIST *pTuneList, TUNE_DATA *pTuneData, int *pUpdatedFlag )
 {
 	TUNE_DAT *tune_dat_p;
@@ -959,13 +1027,7 @@ static int AddTuneList( TUNE_LIST *pTuneList, TUNE_DATA *pTuneData, int *pUpdate
 
 	//expend table
 	if ( pTuneList->tune_num == pTuneList->total_list_num )
-	{
-		TUNE_DAT *old_tune = pTuneList->tune;
-		pTuneList->tune = SAGETV_MALLOC( (pTuneList->total_list_num+5)*sizeof( TUNE_DAT ) );
-		memcpy( pTuneList->tune, old_tune, pTuneList->total_list_num * sizeof(TUNE_DAT) );
-		pTuneList->total_list_num += 5;
-		SAGETV_FREE( old_tune );
-	}
+		ExpendTuneList( pTuneList, 5 );
 
 	tune_dat_p = &pTuneList->tune[ pTuneList->tune_num ];
 	i = pTuneList->tune_num++;
@@ -1001,6 +1063,23 @@ static int AddTuneList( TUNE_LIST *pTuneList, TUNE_DATA *pTuneData, int *pUpdate
 	return i;
 }
 
+void ChannelScanNetwork( SCAN* pScan, TUNE_LIST* pTuneList )
+{
+	int i;
+	if ( pTuneList == NULL || pTuneList->stream_format != DVB_STREAM )
+		return;
+	if ( pScan->tune_list.tune == NULL )
+		InitScanData( pScan, DVB_STREAM, pTuneList->sub_format );
+	for ( i = 0; i<pTuneList->tune_num; i++ )
+	{
+		if ( GetTuneData( &pScan->tune_list, pTuneList->tune[i].onid, pTuneList->tune[i].tsid ) != NULL )
+			continue;
+		if ( pScan->tune_list.tune_num == pScan->tune_list.total_list_num )
+			ExpendTuneList( &pScan->tune_list, pTuneList->tune_num-i );
+		pScan->tune_list.tune[ pScan->tune_list.tune_num++ ] = pTuneList->tune[i];
+	}
+}
+
 void AssignTuneData( DVB_CHANNEL* pDVBChannel, TUNE_DAT* pTuneData )
 {
 	ASSERT( sizeof(TERRESTRIAL_TUNE) <= sizeof(SATELLITE_TUNE) );
@@ -92,6 +92,13 @@ typedef struct PROGRAM_LIST
 
 #define SCAN_COMMAND_ZERO    1
 
+//PSI tables a scan waits for, a table is complete once every section of it is seen. The stream format
+//picks the ones that apply: VCT for ATSC/QAM, SDT actual and NIT actual for DVB.
+#define SCAN_TABLE_SDT		0x0001
+#define SCAN_TABLE_NIT		0x0002
+#define SCAN_TABLE_VCT		0x0004
+#define SCAN_TABLE_DEFAULT	(SCAN_TABLE_SDT|SCAN_TABLE_VCT)
+
 typedef struct SCAN
 {
 	unsigned short task; //1:psi channel scan; 2:naked channel scan
@@ -129,6 +136,12 @@ typedef struct SCAN
 	unsigned long  nit_counter;
 	int demuxer_myown_flag;
 	int fd;
+
+	unsigned short table_needed;	//SCAN_TABLE_xx, 0: fixed timeouts only
+	unsigned short table_done;
+	unsigned char  sdt_section[32];	//sections seen, a bit per section number
+	unsigned char  nit_section[32];
+	unsigned char  vct_section[32];
 } SCAN;
 
 
@@ -150,6 +163,13 @@ int  ChannelInfoState( SCAN* pScan );
 int  ChannelInfoChannelNum( SCAN* pScan );
 int  IsNakedStream( SCAN* pScan );
 int  UpdateTimeClock( SCAN* pScan, unsigned long lMillionSecond );
+//PSI scan is ready as soon as the tables it needs are complete (default SCAN_TABLE_DEFAULT), with 0 it waits for
+//a repeat of the channel table or the timeouts. Waiting for the NIT, the channels it doesn't carry go without
+//tune data. ChannelScanNetwork gives the NIT of the network found on another frequency, channels take tune
+//data from it.
+void ChannelScanNeedTables( SCAN* pScan, unsigned short nTables );
+int  ChannelScanTablesDone( SCAN* pScan );
+void ChannelScanNetwork( SCAN* pScan, TUNE_LIST* pTuneList );
 
 int	 PushScanStreamData( SCAN* pScan, unsigned char *pData, int nBytes, int *nExpectedBytes );
 
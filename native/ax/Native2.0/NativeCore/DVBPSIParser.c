@@ -98,11 +98,14 @@ DVB_PSI*  CreateDVBPSI( PSI_PARSER* pPSIParser )
 	pDVBPSI->nit_section = CreateSection( );
 	pDVBPSI->sdt_section = CreateSection( );
 	pDVBPSI->eit_section = CreateSection( );
+	AttachSectionCache( pDVBPSI->nit_section, pPSIParser->ts_filter->section_cache, 0x0010 );
+	AttachSectionCache( pDVBPSI->sdt_section, pPSIParser->ts_filter->section_cache, 0x0011 );
+	AttachSectionCache( pDVBPSI->eit_section, pPSIParser->ts_filter->section_cache, 0x0012 );
+	ResetSectionCache( pPSIParser->ts_filter->section_cache );
 
 	//pDVBPSI->language_code = pPSIParser->language_code;
 	pDVBPSI->not_save_epg_message = 1;
 
-	pDVBPSI->total_evnt_cell = 0;
 	pDVBPSI->disable_tune_inf = 0;
 	pDVBPSI->disable_channel_inf = 0;
 	
@@ -143,7 +146,7 @@ void ResetDVBPSI( DVB_PSI* pDVBPSI  )
 
 	ResetNitList( pDVBPSI );
 	ReleaseEnvtList( &pDVBPSI->evnt_list );
-	pDVBPSI->total_evnt_cell = 0;
+	ResetSectionCache( pDVBPSI->nit_section->cache );
 	pDVBPSI->disable_tune_inf = 0;
 	pDVBPSI->disable_channel_inf = 0;
 
@@ -163,7 +166,7 @@ static void ResetNitList( DVB_PSI* pDVBPSI )
 ////////////////////////////////////////////
 static NIT *CreateNit(  )
 {
-	NIT* pNit = SAGETV_MALLOC( sizeof(NIT) );
+	NIT* pNit = SAGETV_MALLOC_TAG( sizeof(NIT), MEM_TAG_PSI );
 	return pNit;
 }
 
@@ -185,7 +188,7 @@ static void AddNitToList( DVB_PSI* pDVBPSI, NIT *pNit )
 	if ( pDVBPSI->nit_list.nit_num >= pDVBPSI->nit_list.nit_total_num )
 	{
 		unsigned short new_list_num = pDVBPSI->nit_list.nit_total_num + NIT_LIST_NODE_NUM;	
-		NIT** new_list = (NIT**)SAGETV_MALLOC(  sizeof( NIT* )*new_list_num );
+		NIT** new_list = (NIT**)SAGETV_MALLOC_TAG(  sizeof( NIT* )*new_list_num, MEM_TAG_PSI );
 		memcpy( new_list, pDVBPSI->nit_list.nit_list,  sizeof( NIT* )*pDVBPSI->nit_list.nit_num );
 		SAGETV_FREE( pDVBPSI->nit_list.nit_list ); //release old one.
 		pDVBPSI->nit_list.nit_list = new_list;
@@ -220,7 +223,7 @@ void DumpAllNits( DVB_PSI* pDVBPSI )
 
 static SDT *CreateSdt( )
 {
-	SDT* pSdt = SAGETV_MALLOC( sizeof(SDT) );
+	SDT* pSdt = SAGETV_MALLOC_TAG( sizeof(SDT), MEM_TAG_PSI );
 	return pSdt;
 }
 
@@ -245,7 +248,7 @@ static void AddSdtToList( DVB_PSI* pDVBPSI, SDT *pSdt )
 	if ( pDVBPSI->sdt_list.sdt_num >= pDVBPSI->sdt_list.sdt_total_num )
 	{
 		unsigned short new_list_num = pDVBPSI->sdt_list.sdt_total_num + SDT_LIST_NODE_NUM;	
-		SDT** new_list = (SDT**)SAGETV_MALLOC(  sizeof( SDT* )*new_list_num );
+		SDT** new_list = (SDT**)SAGETV_MALLOC_TAG(  sizeof( SDT* )*new_list_num, MEM_TAG_PSI );
 		memcpy( new_list, pDVBPSI->sdt_list.sdt_list,  sizeof( SDT* )*pDVBPSI->sdt_list.sdt_num );
 		SAGETV_FREE( pDVBPSI->sdt_list.sdt_list ); //release old one.
 		pDVBPSI->sdt_list.sdt_list = new_list;
@@ -322,7 +325,7 @@ static int UnpackNIT( DVB_PSI* pDVBPSI, TS_SECTION* pSection )
 	unsigned char *desc_ptr;
 	int desc_len;
 	NIT *nit;
-	int i, drop_nit = 0;
+	int i, drop_nit = 0, dropped_nit = 0;
 	int nit_update_flag;
 
 	char  network_name[NETWORK_NAME_LEN];			
@@ -402,7 +405,7 @@ static int UnpackNIT( DVB_PSI* pDVBPSI, TS_SECTION* pSection )
 				unsigned char* p = desc_ptr +2;
 				int service_num = desc_len / 3;
 				int k=0;
-				nit->service_list = SAGETV_MALLOC( sizeof( NIT_SERVICE ) * service_num );
+				nit->service_list = SAGETV_MALLOC_TAG( sizeof( NIT_SERVICE ) * service_num, MEM_TAG_PSI );
 				for ( i = 0; i <service_num; i++, k++ )
 				{
 					nit->service_list[k].sevice_id =  (p[0]<<8) | p[1];
@@ -523,6 +526,8 @@ static int UnpackNIT( DVB_PSI* pDVBPSI, TS_SECTION* pSection )
 				TUNE_DATA tune_data={0};
 
 				tune_data.update_flag = nit_update_flag;
+				tune_data.section_number = section_header.section_number;
+				tune_data.last_section_number = section_header.last_section_number;
 				tune_data.stream_format = DVB_STREAM;
 				tune_data.sub_format = pDVBPSI->psi_parser->sub_format;
 				tune_data.u.dvb.onid     = nit->onid;
@@ -556,7 +561,10 @@ static int UnpackNIT( DVB_PSI* pDVBPSI, TS_SECTION* pSection )
 			if ( !drop_nit )
 				AddNitToList( pDVBPSI, nit );
 			else			
+			{
 				ReleaseNit( nit );
+				dropped_nit++;
+			}
 
 			nit = NULL;
 		}
@@ -568,7 +576,10 @@ static int UnpackNIT( DVB_PSI* pDVBPSI, TS_SECTION* pSection )
 		pData += desc_bytes;
 		i++;
 	}
-		
+
+	//a section the dumper dropped is unpacked again when it repeats
+	if ( !dropped_nit )
+		CacheSection( pSection );
 	return 1;
 }
 
@@ -716,7 +727,7 @@ static int UnpackSDT( DVB_PSI* pDVBPSI, TS_SECTION* pSection )
 		return 0;
 	}
 
-	sdt->service = SAGETV_MALLOC( sizeof(SERVICE)*n );
+	sdt->service = SAGETV_MALLOC_TAG( sizeof(SERVICE)*n, MEM_TAG_PSI );
 	sdt->service_num = n;
 
 //if ((_mem_loc = sagetv_mem_loc( sdt->service ))<0 )
@@ -741,7 +752,7 @@ static int UnpackSDT( DVB_PSI* pDVBPSI, TS_SECTION* pSection )
 		if ( ( desc_ptr = GetDescriptor( p+5, desc_bytes, LINKAGE_TAG, &desc_len ) )!= NULL )
 		{
 			if ( sdt->linkage == NULL )
-				sdt->linkage = SAGETV_MALLOC( sizeof(LINKAGE)*n );
+				sdt->linkage = SAGETV_MALLOC_TAG( sizeof(LINKAGE)*n, MEM_TAG_PSI );
 			ParserLinkage( &sdt->linkage[i], (char*)desc_ptr+2, desc_len );
 		}
 
@@ -759,6 +770,8 @@ static int UnpackSDT( DVB_PSI* pDVBPSI, TS_SECTION* pSection )
 		CHANNEL_DATA channel_data={0};
 
 		channel_data.update_flag = sdt_update_flag;
+		channel_data.section_number = section_header.section_number;
+		channel_data.last_section_number = section_header.last_section_number;
 		channel_data.stream_format = DVB_STREAM;
 		channel_data.sub_format = pDVBPSI->psi_parser->sub_format;
 		channel_data.num_channel = _MIN( sdt->service_num, MAX_DVB_CHANNEL );
@@ -814,6 +827,8 @@ static int UnpackSDT( DVB_PSI* pDVBPSI, TS_SECTION* pSection )
 		ReleaseSdt( sdt );
 	}
 
+	if ( found_sdt || !drop_sdt )
+		CacheSection( pSection );
 	return 1;
 }
 
@@ -821,7 +836,7 @@ static int UnpackSDT( DVB_PSI* pDVBPSI, TS_SECTION* pSection )
 static EVNT* CreateEvnt( )
 {
 	EVNT* pEvnt;
-	pEvnt = SAGETV_MALLOC( sizeof(EVNT) );
+	pEvnt = SAGETV_MALLOC_TAG( sizeof(EVNT), MEM_TAG_EPG );
 	return pEvnt;
 }
 
@@ -909,226 +924,201 @@ static void UpdateEvnt( EVNT *pEvnt1, EVNT *pEvnt2, int bNotSaveMesg )
 
 }
 
-static void ExpendEnvtRow( EVNT_COL *pEvntCol )
-{
-	int new_row_num;
-	EVNT *new_evnt_row;
-	new_row_num = pEvntCol->total_row_num + EVEN_COL_NUM;
-	new_evnt_row = SAGETV_MALLOC( sizeof(EVNT)*new_row_num ) ;
-	if ( pEvntCol->evnt )
-	{
-		memcpy( new_evnt_row, pEvntCol->evnt, sizeof(EVNT)*pEvntCol->total_row_num );
-		SAGETV_FREE( pEvntCol->evnt );
-	}
-	pEvntCol->evnt = new_evnt_row;
-	pEvntCol->total_row_num = new_row_num;
-}
+#define EVNT_KEY( onid, tsid, sid, event_id ) \
+	( ((ULONGLONG)(onid)<<48)|((ULONGLONG)(tsid)<<32)|((ULONGLONG)(sid)<<16)|(ULONGLONG)(event_id) )
+#define EIT_SECT_KEY( onid, tsid, sid, table_id, section_number ) \
+	( ((ULONGLONG)(onid)<<48)|((ULONGLONG)(tsid)<<32)|((ULONGLONG)(sid)<<16)|((table_id)<<8)|(section_number) )
 
-static void ReleaseEvntRow( EVNT_COL *pEvntCol )
+//Fibonacci hashing, sizes are power of 2
+static unsigned long HashSlot( ULONGLONG Key, unsigned long nSize )
 {
-	int i;
-	for ( i = 0; i<pEvntCol->row_num; i++ )
-	{
-		ReleaseEvntData( &pEvntCol->evnt[i] );
-	}
-	SAGETV_FREE( pEvntCol->evnt );
-	pEvntCol->evnt = NULL;
-	pEvntCol->row_num = 0;
-	pEvntCol->total_row_num = 0;
+	return (unsigned long)( ( Key * 0x9E3779B97F4A7C15ULL ) >> 32 ) & ( nSize-1 );
 }
 
-static EVNT* FindEvntCell( EVNT_COL *pEvntCol, unsigned short EventId )
-{
-	int i;
-	for ( i = 0; i<pEvntCol->row_num; i++ )
-	{
-		if ( pEvntCol->evnt[i].event_id == EventId )
-			return &pEvntCol->evnt[i];
-	}
-	return NULL;
-}
+#define EVNT_AT( list, i ) ( &(list)->evnt_block[(i)>>EVNT_BLOCK_BITS][(i)&((1<<EVNT_BLOCK_BITS)-1)] )
 
-static EVNT* AddEvnt( EVNT_COL *pEvntCol, unsigned short EeventId )
+static void RehashEvnt( EVNT_LIST *pEvntList, unsigned long nSize )
 {
-	int i, k;
-	for ( i = 0; i<pEvntCol->row_num; i++ )
-	{
-		if ( pEvntCol->evnt[i].event_id == EeventId )
-			return &pEvntCol->evnt[i];
-	}
-	if ( pEvntCol->row_num >= pEvntCol->total_row_num )
-		ExpendEnvtRow( pEvntCol );
-
-	k = pEvntCol->row_num++;
-	pEvntCol->evnt[k].event_id = EeventId;
-
-	return &pEvntCol->evnt[k];
+	unsigned long i, k;
+	unsigned int *hash;
+	hash = SAGETV_MALLOC_TAG( sizeof(unsigned int)*nSize, MEM_TAG_EPG );
+	for ( i = 0; i<pEvntList->evnt_num; i++ )
+	{
+		EVNT *evnt = EVNT_AT( pEvntList, i );
+		k = HashSlot( EVNT_KEY( evnt->onid, evnt->tsid, evnt->sid, evnt->event_id ), nSize );
+		while ( hash[k] )
+			k = ( k+1 ) & ( nSize-1 );
+		hash[k] = i+1;
+	}
+	SAGETV_FREE( pEvntList->evnt_hash );
+	pEvntList->evnt_hash = hash;
+	pEvntList->evnt_hash_size = nSize;
 }
 
 static void ExpendEnvtList( EVNT_LIST *pEvntList )
 {
-	int new_col_num;
-	EVNT_COL* new_evnt_list;
-	new_col_num = pEvntList->total_col_num + EVEN_COL_NUM;
-	new_evnt_list = SAGETV_MALLOC( sizeof(EVNT_COL)*new_col_num );
-	if ( pEvntList->evnt_col )
-	{
-		memcpy( new_evnt_list, pEvntList->evnt_col, sizeof(EVNT_COL)*pEvntList->total_col_num );
-		SAGETV_FREE( pEvntList->evnt_col );
+	unsigned long block = pEvntList->total_evnt_num >> EVNT_BLOCK_BITS;
+	if ( block >= pEvntList->evnt_block_num )
+	{
+		unsigned long new_block_num = pEvntList->evnt_block_num ? pEvntList->evnt_block_num*2 : 16;
+		EVNT** new_block = SAGETV_MALLOC_TAG( sizeof(EVNT*)*new_block_num, MEM_TAG_EPG );
+		if ( pEvntList->evnt_block )
+		{
+			memcpy( new_block, pEvntList->evnt_block, sizeof(EVNT*)*pEvntList->evnt_block_num );
+			SAGETV_FREE( pEvntList->evnt_block );
+		}
+		pEvntList->evnt_block = new_block;
+		pEvntList->evnt_block_num = new_block_num;
 	}
-	pEvntList->evnt_col = new_evnt_list;
-	pEvntList->total_col_num = new_col_num;
+	pEvntList->evnt_block[block] = SAGETV_MALLOC_TAG( sizeof(EVNT)<<EVNT_BLOCK_BITS, MEM_TAG_EPG );
+	pEvntList->total_evnt_num += 1<<EVNT_BLOCK_BITS;
+	if ( pEvntList->evnt_hash_size < pEvntList->total_evnt_num*2 )
+		RehashEvnt( pEvntList, pEvntList->evnt_hash_size ? pEvntList->evnt_hash_size*2 : EVNT_HASH_INIT );
 }
 
-
 static void ReleaseEnvtList( EVNT_LIST *pEvntList )
 {
-	int i;
-	for ( i = 0; i<pEvntList->col_num; i++ )
-	{
-		ReleaseEvntRow( &pEvntList->evnt_col[i] );
-	}
-	SAGETV_FREE( pEvntList->evnt_col );
-	pEvntList->evnt_col = NULL;
-	pEvntList->col_num = 0;
-	pEvntList->total_col_num = 0;
-
-	pEvntList->total_even_num = 0;
+	unsigned long i;
+	for ( i = 0; i<pEvntList->evnt_num; i++ )
+		ReleaseEvntData( EVNT_AT( pEvntList, i ) );
+	for ( i = 0; i<(pEvntList->total_evnt_num>>EVNT_BLOCK_BITS); i++ )
+		SAGETV_FREE( pEvntList->evnt_block[i] );
+	SAGETV_FREE( pEvntList->evnt_block );
+	SAGETV_FREE( pEvntList->evnt_hash );
+	SAGETV_FREE( pEvntList->sect_hash );
+	memset( pEvntList, 0, sizeof(EVNT_LIST) );
 }
 
-
 EVNT* FindEvnt( EVNT_LIST *pEvntList, unsigned short ONID, unsigned short TSID, unsigned short SID, unsigned short EeventId )
 {
-	int i;
-	for ( i = 0; i<pEvntList->col_num; i++ )
+	unsigned long k, i;
+	if ( pEvntList->evnt_hash == NULL )
+		return NULL;
+	k = HashSlot( EVNT_KEY( ONID, TSID, SID, EeventId ), pEvntList->evnt_hash_size );
+	while ( ( i = pEvntList->evnt_hash[k] ) != 0 )
 	{
-		if ( pEvntList->evnt_col[i].onid == ONID && pEvntList->evnt_col[i].tsid == TSID && pEvntList->evnt_col[i].sid == SID )
-		{
-			return FindEvntCell( &pEvntList->evnt_col[i], EeventId );
-		} 
+		EVNT *evnt = EVNT_AT( pEvntList, i-1 );
+		if ( evnt->event_id == EeventId && evnt->sid == SID && evnt->tsid == TSID && evnt->onid == ONID )
+			return evnt;
+		k = ( k+1 ) & ( pEvntList->evnt_hash_size-1 );
 	}
 	return NULL;
 }
 
 EVNT* AddNewEvnt( EVNT_LIST *pEvntList, unsigned short ONID, unsigned short TSID, unsigned short SID, unsigned short EeventId )
 {
-	int i, k;
-	for ( i = 0; i<pEvntList->col_num; i++ )
-	{
-		if ( pEvntList->evnt_col[i].onid == ONID && pEvntList->evnt_col[i].tsid == TSID && pEvntList->evnt_col[i].sid == SID )
-		{
-			return AddEvnt( &pEvntList->evnt_col[i], EeventId );
-		} 
-	}
-	if ( pEvntList->col_num >= pEvntList->total_col_num )
+	unsigned long k;
+	EVNT *evnt;
+	if ( ( evnt = FindEvnt( pEvntList, ONID, TSID, SID, EeventId ) ) != NULL )
+		return evnt;
+	if ( pEvntList->evnt_num >= pEvntList->total_evnt_num )
 		ExpendEnvtList( pEvntList );
-	
-	k = pEvntList->col_num++;
-	pEvntList->evnt_col[k].onid = ONID;
-	pEvntList->evnt_col[k].tsid = TSID;
-	pEvntList->evnt_col[k].sid  = SID;
 
-	return AddEvnt( &pEvntList->evnt_col[k], EeventId );
+	evnt = EVNT_AT( pEvntList, pEvntList->evnt_num );
+	pEvntList->evnt_num++;
+	evnt->onid = ONID;
+	evnt->tsid = TSID;
+	evnt->sid  = SID;
+	evnt->event_id = EeventId;
+	k = HashSlot( EVNT_KEY( ONID, TSID, SID, EeventId ), pEvntList->evnt_hash_size );
+	while ( pEvntList->evnt_hash[k] )
+		k = ( k+1 ) & ( pEvntList->evnt_hash_size-1 );
+	pEvntList->evnt_hash[k] = pEvntList->evnt_num;
+	return evnt;
 }
 
-int TotalEnvtNum( EVNT_LIST *pEvntList )
+static void RehashEitSect( EVNT_LIST *pEvntList, unsigned long nSize )
 {
-	int i, sum;
-	sum = 0;
-	for ( i = 0; i<pEvntList->col_num; i++ )
-		 sum += pEvntList->evnt_col[i].row_num;
-
-	return sum;
+	unsigned long i, k;
+	EIT_SECT *hash = SAGETV_MALLOC_TAG( sizeof(EIT_SECT)*nSize, MEM_TAG_EPG );
+	for ( i = 0; i<pEvntList->sect_hash_size; i++ )
+	{
+		if ( pEvntList->sect_hash[i].key == 0 )
+			continue;
+		k = HashSlot( pEvntList->sect_hash[i].key, nSize );
+		while ( hash[k].key )
+			k = ( k+1 ) & ( nSize-1 );
+		hash[k] = pEvntList->sect_hash[i];
+	}
+	SAGETV_FREE( pEvntList->sect_hash );
+	pEvntList->sect_hash = hash;
+	pEvntList->sect_hash_size = nSize;
 }
 
-int TotalEnvtCellNum( EVNT_LIST *pEvntList )
+//1 when a section has same version and crc as last time, else it's recorded and 0 returned
+static int EitSectUnchanged( EVNT_LIST *pEvntList, ULONGLONG Key, unsigned char Version, unsigned long Crc32 )
 {
-	int i, sum;
-	sum = 0;
-	for ( i = 0; i<pEvntList->total_col_num; i++ )
-		 sum += pEvntList->evnt_col[i].total_row_num;
+	EIT_SECT *sect;
+	unsigned long k;
+	if ( ( pEvntList->sect_num+1 )*2 > pEvntList->sect_hash_size )
+		RehashEitSect( pEvntList, pEvntList->sect_hash_size ? pEvntList->sect_hash_size*2 : EIT_SECT_INIT );
+
+	k = HashSlot( Key, pEvntList->sect_hash_size );
+	while ( pEvntList->sect_hash[k].key && pEvntList->sect_hash[k].key != Key )
+		k = ( k+1 ) & ( pEvntList->sect_hash_size-1 );
+	sect = &pEvntList->sect_hash[k];
+	if ( sect->key == Key && sect->version == Version && sect->crc32 == Crc32 )
+	{
+		pEvntList->sect_skipped++;
+		return 1;
+	}
+	if ( sect->key == 0 )
+	{
+		sect->key = Key;
+		pEvntList->sect_num++;
+	}
+	sect->version = Version;
+	sect->crc32 = Crc32;
+	pEvntList->sect_unpacked++;
+	return 0;
+}
 
-	return sum;
+int TotalEnvtNum( EVNT_LIST *pEvntList )
+{
+	return (int)pEvntList->evnt_num;
 }
 
-void SortEvntRow( EVNT_COL *pEvntCol )
+int TotalEnvtCellNum( EVNT_LIST *pEvntList )
 {
-	int i, j;
-	for ( i = 0; i<pEvntCol->row_num; i++ )
-	{
-		for ( j = i+1; j<pEvntCol->row_num; j++ )
-		{
-			if ( pEvntCol->evnt[i].start_time > pEvntCol->evnt[j].start_time )
-			{
-				EVNT e_swap;
-				e_swap = pEvntCol->evnt[i];
-				pEvntCol->evnt[i] = pEvntCol->evnt[j];
-				pEvntCol->evnt[j] = e_swap;
-			}
-		}
-	}
+	return (int)pEvntList->total_evnt_num;
 }
 
-void SortEvnts( EVNT_LIST *pEvntList )
+static int CompareEvntTime( const void* p1, const void* p2 )
 {
-	int i, j;
-	for ( i = 0; i<pEvntList->total_col_num; i++ )
-	{
-		
-		for ( j= i+1; j<pEvntList->total_col_num; j++ )
-		{
-			unsigned short onid1, tsid1, sid1;
-			unsigned short onid2, tsid2, sid2;
-			onid1 = pEvntList->evnt_col[i].onid;
-			tsid1 = pEvntList->evnt_col[i].tsid;
-			sid1 = pEvntList->evnt_col[i].sid;
-
-			onid2 = pEvntList->evnt_col[j].onid;
-			tsid2 = pEvntList->evnt_col[j].tsid;
-			sid2 = pEvntList->evnt_col[j].sid;
-
-			if ( onid1 && tsid1  && onid2 && tsid2  && 
-				 ( onid1 > onid2 || tsid1 > tsid2 || sid1 > sid2 ) )
-			{
-				EVNT_COL ec_swap;
-				ec_swap = pEvntList->evnt_col[i];
-				pEvntList->evnt_col[i] = pEvntList->evnt_col[j];
-				pEvntList->evnt_col[j] = ec_swap;
-			}
-		}
-		
-		SortEvntRow( &pEvntList->evnt_col[i] );
-	}
+	const EVNT *e1 = *(const EVNT**)p1, *e2 = *(const EVNT**)p2;
+	if ( e1->onid != e2->onid ) return e1->onid < e2->onid ? -1 : 1;
+	if ( e1->tsid != e2->tsid ) return e1->tsid < e2->tsid ? -1 : 1;
+	if ( e1->sid != e2->sid ) return e1->sid < e2->sid ? -1 : 1;
+	if ( e1->start_time != e2->start_time ) return e1->start_time < e2->start_time ? -1 : 1;
+	return 0;
 }
 
 int DVBFormatEPG( unsigned short onid, unsigned short tsid, unsigned short sid, unsigned long language_code, EVNT *evnt, DESC_DATA* desc );
 void DumpAllEvnts( DVB_PSI* pDVBPSI )
 {
-	int i,j;
-	EVNT *evnt;
+	unsigned long i;
+	EVNT **evnt;
 	DESC_DATA* desc= CreateDesc( );
 
-	SageLog(( _LOG_TRACE, 3, TEXT("EPG num:%d of total:%d"), 
-		        TotalEnvtNum(&pDVBPSI->evnt_list), TotalEnvtCellNum(&pDVBPSI->evnt_list) ));
+	SageLog(( _LOG_TRACE, 3, TEXT("EPG num:%d of total:%d, EIT sections unpacked:%lu unchanged:%lu"), 
+		        TotalEnvtNum(&pDVBPSI->evnt_list), TotalEnvtCellNum(&pDVBPSI->evnt_list),
+				pDVBPSI->evnt_list.sect_unpacked, pDVBPSI->evnt_list.sect_skipped ));
 
 	//if ( pDVBPSI->not_save_epg_message )
 	//	return;
 
-	SortEvnts( &pDVBPSI->evnt_list );
-	for ( i = 0; i<pDVBPSI->evnt_list.col_num; i++ )
+	//in order of service and start time
+	evnt = SAGETV_MALLOC_TAG( sizeof(EVNT*)*(pDVBPSI->evnt_list.evnt_num+1), MEM_TAG_EPG );
+	for ( i = 0; i<pDVBPSI->evnt_list.evnt_num; i++ )
+		evnt[i] = EVNT_AT( &pDVBPSI->evnt_list, i );
+	qsort( evnt, pDVBPSI->evnt_list.evnt_num, sizeof(EVNT*), CompareEvntTime );
+	for ( i = 0; i<pDVBPSI->evnt_list.evnt_num; i++ )
 	{
-		for ( j = 0; j<pDVBPSI->evnt_list.evnt_col[i].row_num; j++ )
-		{
-			unsigned short onid, tsid, sid;
-			onid = pDVBPSI->evnt_list.evnt_col[i].onid;
-			tsid = pDVBPSI->evnt_list.evnt_col[i].tsid;
-			sid =  pDVBPSI->evnt_list.evnt_col[i].sid;
-			evnt = &pDVBPSI->evnt_list.evnt_col[i].evnt[j];
-			DVBFormatEPG(  onid, tsid, sid, pDVBPSI->language_code, evnt, desc );
-			SageLog(( _LOG_TRACE, 3, TEXT("%s"), desc->desc_ptr ) );
-			ReleaseDescData( desc );
-		}
+		DVBFormatEPG(  evnt[i]->onid, evnt[i]->tsid, evnt[i]->sid, pDVBPSI->language_code, evnt[i], desc );
+		SageLog(( _LOG_TRACE, 3, TEXT("%s"), desc->desc_ptr ) );
+		ReleaseDescData( desc );
 	}
+	SAGETV_FREE( evnt );
 	ReleaseDesc( desc );
 
 }
@@ -1802,7 +1792,7 @@ static int UnpackDVBEIT( DVB_PSI* pDVBPSI, TS_SECTION* pSection )
 	//int _mem_loc;
 
 	UnpackSectionDataHeader( &section_header, pSection );
-	if ( section_header.table_id < 0x4e && section_header.table_id > 0x6f )
+	if ( section_header.table_id < 0x4e || section_header.table_id > 0x6f )
 		return 0;
 
 	//if ( section_header.table_id != 0x4e && section_header.table_id != 0x4f     //0x4e actual TS present/following EIT; 0x4f other TS present/following EIT; 
@@ -1814,14 +1804,22 @@ static int UnpackDVBEIT( DVB_PSI* pDVBPSI, TS_SECTION* pSection )
 	total_bytes = section_header.table_bytes;
 	if ( total_bytes <= 0 )		return 0;
 
-	evnt = CreateEvnt( );
-//if ((_mem_loc=sagetv_mem_loc( evnt ))< 0 )
-//SageLog(( _LOG_TRACE, 3, "ERROR: lost memory index %s.\r\n", _mem_loc ));
-
 	sid = section_header.tsid;
 	tsid       = ( pData[0] << 8 ) | pData[1];
 	onid       = ( pData[2] << 8 ) | pData[3];	
 	last_table_id = pData[4];
+
+	//the carousel repeats a section till its version changes, events of an unchanged one are known
+	//(it is still cached, the section cache may have been reset without the event store)
+	if ( EitSectUnchanged( &pDVBPSI->evnt_list, 
+		                   EIT_SECT_KEY( onid, tsid, sid, section_header.table_id, section_header.section_number ),
+						   section_header.version, pSection->crc32 ) )
+		return 1;
+
+	evnt = CreateEvnt( );
+//if ((_mem_loc=sagetv_mem_loc( evnt ))< 0 )
+//SageLog(( _LOG_TRACE, 3, "ERROR: lost memory index %s.\r\n", _mem_loc ));
+
 	p = pData + 6;
 	bytes = 6;
 	while ( bytes+10 < total_bytes )
@@ -2050,6 +2048,9 @@ int ProcessDVBPSI( DVB_PSI* pDVBPSI, TS_PACKET *pTSPacket )
 		if ( !UnpackSection( pTSPacket->start, pDVBPSI->nit_section, payload_data, payload_size ) )
 			return 0;
 
+		if ( pDVBPSI->nit_section->cached ) //a repeat of unpacked section
+			return 1;
+
 		UnpackNIT(  pDVBPSI, pDVBPSI->nit_section ); 
 
 		return 1;
@@ -2066,6 +2067,9 @@ int ProcessDVBPSI( DVB_PSI* pDVBPSI, TS_PACKET *pTSPacket )
 		if ( !UnpackSection( pTSPacket->start, pDVBPSI->sdt_section, payload_data, payload_size ) )
 			return 0;
 
+		if ( pDVBPSI->sdt_section->cached )
+			return 1;
+
 		UnpackSDT(  pDVBPSI, pDVBPSI->sdt_section ); 
 
 		return 1;
@@ -2081,7 +2085,11 @@ int ProcessDVBPSI( DVB_PSI* pDVBPSI, TS_PACKET *pTSPacket )
 		if ( !UnpackSection( pTSPacket->start, pDVBPSI->eit_section, payload_data, payload_size ) )
 			return 0;
 
-		UnpackDVBEIT(  pDVBPSI, pDVBPSI->eit_section ); 
+		if ( pDVBPSI->eit_section->cached )
+			return 1;
+
+		if ( UnpackDVBEIT(  pDVBPSI, pDVBPSI->eit_section ) )
+			CacheSection( pDVBPSI->eit_section );
 
 		return 1;
 
@@ -20,8 +20,9 @@
 #define SDT_LIST_NODE_NUM  32
 
 #define MAX_EVENT_NUM  (4096*3)     //maxuim DVB EPG cell number
-#define EVEN_ROW_NUM    24*3
-#define EVEN_COL_NUM    64
+#define EVNT_HASH_INIT  1024		//initial slots of event hash
+#define EVNT_BLOCK_BITS 8			//events are allocated in blocks of 256
+#define EIT_SECT_INIT   256			//initial slots of EIT section hash
 
 #define	NETWORK_NAME_LEN   32
 #define SERVICE_NAME_LEN   64
@@ -117,6 +118,9 @@ typedef struct
 
 typedef struct 
 {
+	unsigned short onid;
+	unsigned short tsid;
+	unsigned short sid;
 	unsigned short event_id;
 	unsigned long  start_time;
 	unsigned long  duration_length;
@@ -130,22 +134,29 @@ typedef struct
 	unsigned long  content_desc_crc32;
 } EVNT;
 
-typedef struct EVNT_COL
+//an EIT section seen, key is onid:tsid:sid:table_id:section_number (never 0, table_id >= 0x4e)
+typedef struct EIT_SECT
 {
-	unsigned short onid;
-	unsigned short tsid;
-	unsigned short sid;
-	unsigned short row_num;
-	unsigned short total_row_num;
-	EVNT *evnt;
-} EVNT_COL;
+	ULONGLONG	   key;
+	unsigned long  crc32;
+	unsigned char  version;
+} EIT_SECT;
 
+//events of all services in blocks that never move, open addressing hash on onid:tsid:sid:event_id indexes them.
+//Hash tables double when half full. A section of same version and crc as last time isn't unpacked again.
 typedef struct EVNT_LIST
 {
-	unsigned short col_num;
-	unsigned short total_col_num;
-	unsigned long  total_even_num;
-	EVNT_COL *evnt_col;
+	unsigned long  evnt_num;
+	unsigned long  total_evnt_num;		//allocated events
+	EVNT		 **evnt_block;
+	unsigned long  evnt_block_num;		//size of evnt_block
+	unsigned int  *evnt_hash;			//index+1 of an event, 0 is empty
+	unsigned long  evnt_hash_size;		//power of 2
+	unsigned long  sect_num;
+	unsigned long  sect_hash_size;		//power of 2
+	EIT_SECT      *sect_hash;
+	unsigned long  sect_skipped;		//unchanged sections not unpacked
+	unsigned long  sect_unpacked;
 } EVNT_LIST;
 
 typedef struct DVB_FILTER
@@ -173,7 +184,6 @@ typedef struct DVB_PSI
 	TS_SECTION     *eit_section;
 	//unsigned char	eit_update_flag;
 
-	unsigned short  total_evnt_cell;
 	EVNT_LIST		evnt_list;
 	DVB_PSI_FILTER	evnt_filter;
 
@@ -38,6 +38,7 @@
 
 #include "TSFilterDump.h"
 #include "Demuxer.h"
+#include "FileView.h"
 
 #ifndef _MAX_PATH
 #define _MAX_PATH      512
@@ -57,6 +58,7 @@ static int  ProcessESBuffer( DEMUXER* pDemuxer, TRACK* pTrack );
 static void FlushFIFOBuffer( DEMUXER* pDemuxer, TRACK* pTrack );
 //static void DisplayAVInf( DEMUXER* pDemuxer, int nSlot );
 static void ReleaseESBuffer( DEMUXER* pDemuxer, BLOCK_BUFFER *pBlockBuffer );
+static void ReclaimHeldESBuffer( DEMUXER* pDemuxer, int nSlot );
 
 static void _input_statistic( DEMUXER *pDemuxer );
 
@@ -604,6 +606,9 @@ static int RequestESBuffer( DEMUXER* pDemuxer, TRACK* pTrack )
 	pTrack->buffer_start = NULL;
 	pTrack->buffer_size = 0;
 
+	if ( pDemuxer->fifo_buffer[pTrack->slot_index]->num_of_dropped )
+		ReclaimHeldESBuffer( pDemuxer, pTrack->slot_index );
+
 	buffer_start = RequestBlockMemory( &pDemuxer->memory_alloc[pTrack->slot_index], 
 		                               pDemuxer->fifo_buffer[pTrack->slot_index]->block_buffer_size );
 	if ( buffer_start == NULL )
@@ -637,11 +642,36 @@ static int RequestESBuffer( DEMUXER* pDemuxer, TRACK* pTrack )
 
 static void ReleaseESBuffer( DEMUXER* pDemuxer,  BLOCK_BUFFER *pBlockBuffer )
 {
+	//the consumer holds the block, it's reclaimed after its last drop
+	if ( pBlockBuffer->ref_count > 1 )
+	{
+		pBlockBuffer->ref_count--;
+		pBlockBuffer->state = HELD_BLOCK_STATE;
+		pDemuxer->fifo_buffer[pBlockBuffer->slot_index]->num_of_held++;
+		return;
+	}
 	ReleaseBlockMemory( &pDemuxer->memory_alloc[pBlockBuffer->slot_index], (void*)pBlockBuffer->buffer_start );
 	ReleaseBlockBuffer( pDemuxer->fifo_buffer[pBlockBuffer->slot_index],  pBlockBuffer );
 	ASSERT( pDemuxer->fifo_buffer[pBlockBuffer->slot_index]->block_buffer_inuse == pDemuxer->memory_alloc[pBlockBuffer->slot_index].inuse_num );
 }
 
+static void ReclaimHeldESBuffer( DEMUXER* pDemuxer, int nSlot )
+{
+	FIFO_BUFFER *fifo_buffer = pDemuxer->fifo_buffer[nSlot];
+	int i;
+	for ( i = 0; i<fifo_buffer->total_queue_num && fifo_buffer->num_of_dropped; i++ )
+	{
+		BLOCK_BUFFER *block_buffer = &fifo_buffer->block_buffer_pool[i];
+		if ( block_buffer->state == HELD_BLOCK_STATE && block_buffer->ref_count == 0 )
+		{
+			fifo_buffer->num_of_held--;
+			fifo_buffer->num_of_dropped--;
+			ReleaseBlockMemory( &pDemuxer->memory_alloc[nSlot], (void*)block_buffer->buffer_start );
+			ReleaseBlockBuffer( fifo_buffer, block_buffer );
+		}
+	}
+}
+
 void raw_es_data_dump_file( DEMUXER *pDemuxer, TRACK *pTrack, int bGroupStart, unsigned char*p, int bytes  );
 static int ProcessESBuffer( DEMUXER* pDemuxer, TRACK* pTrack )
 {
@@ -678,6 +708,7 @@ static int ProcessESBuffer( DEMUXER* pDemuxer, TRACK* pTrack )
 	if ( pTrack->buffer_index == 0xffff )
 	{
 		tmp_block_buffer.state = 0;
+		tmp_block_buffer.ref_count = 0;
 		block_buffer = &tmp_block_buffer;
 		block_buffer->pes = pTrack->es_elmnt->pes;
 		block_buffer->buffer_start = pTrack->buffer_start;
@@ -695,7 +726,8 @@ static int ProcessESBuffer( DEMUXER* pDemuxer, TRACK* pTrack )
 	} else
 	{
 		ASSERT( pDemuxer->fifo_buffer[pTrack->slot_index]->block_buffer_inuse == 
-				pDemuxer->fifo_buffer[pTrack->slot_index]->num_of_in_queue + pDemuxer->fifo_buffer[pTrack->slot_index]->num_of_out_queue );
+				pDemuxer->fifo_buffer[pTrack->slot_index]->num_of_in_queue + pDemuxer->fifo_buffer[pTrack->slot_index]->num_of_out_queue +
+				pDemuxer->fifo_buffer[pTrack->slot_index]->num_of_held );
 		block_buffer = &pDemuxer->fifo_buffer[pTrack->slot_index]->block_buffer_pool[pTrack->buffer_index];
 		block_buffer->pes = pTrack->es_elmnt->pes;
 		block_buffer->data_start = p;
@@ -1153,6 +1185,23 @@ void FlushDemuxer( DEMUXER* pDemuxer, int nSlot )
 	}
 }
 
+static void SetupFileSourceBuffer( DEMUXER *pDemuxer, int nFileFormat )
+{
+	if ( IS_TS_TYPE( nFileFormat ) )
+	{
+		pDemuxer->input_buffer_size = BUFFER_SIZE-(BUFFER_SIZE%pDemuxer->ts_parser->packet_length); //
+		pDemuxer->input_buffer = SAGETV_MALLOC( pDemuxer->input_buffer_size );
+		pDemuxer->data = pDemuxer->input_buffer;
+		pDemuxer->size = pDemuxer->input_buffer_size;
+	} else
+	{
+		pDemuxer->input_buffer_size = BUFFER_SIZE+PACK_SPACE;
+		pDemuxer->input_buffer = SAGETV_MALLOC( pDemuxer->input_buffer_size );
+		pDemuxer->data = pDemuxer->input_buffer + PACK_SPACE;
+		pDemuxer->size = BUFFER_SIZE;
+	}
+}
+
 int OpenFileSource( DEMUXER *pDemuxer, char* pFileName, int nFileFormat,  TUNE* pTune )
 {
 	int ret;
@@ -1166,10 +1215,7 @@ int OpenFileSource( DEMUXER *pDemuxer, char* pFileName, int nFileFormat,  TUNE*
 			return 0;
 		}
 
-		pDemuxer->input_buffer_size = BUFFER_SIZE-(BUFFER_SIZE%pDemuxer->ts_parser->packet_length); //
-		pDemuxer->input_buffer = SAGETV_MALLOC( pDemuxer->input_buffer_size );
-		pDemuxer->data = pDemuxer->input_buffer;
-		pDemuxer->size = pDemuxer->input_buffer_size;
+		SetupFileSourceBuffer( pDemuxer, nFileFormat );
 
 	} else
 	//if it's PS format
@@ -1182,10 +1228,7 @@ int OpenFileSource( DEMUXER *pDemuxer, char* pFileName, int nFileFormat,  TUNE*
 			return 0;
 		}
 
-		pDemuxer->input_buffer_size = BUFFER_SIZE+PACK_SPACE;
-		pDemuxer->input_buffer = SAGETV_MALLOC( pDemuxer->input_buffer_size );
-		pDemuxer->data = pDemuxer->input_buffer + PACK_SPACE;
-		pDemuxer->size = BUFFER_SIZE;
+		SetupFileSourceBuffer( pDemuxer, nFileFormat );
 	}
 
 	pDemuxer->language_code = LanguageCode((unsigned char*)"eng");
@@ -1207,10 +1250,7 @@ int OpenFileSourceW( DEMUXER *pDemuxer, wchar_t* pFileName, int nFileFormat,  TU
 			return 0;
 		}
 
-		pDemuxer->input_buffer_size = BUFFER_SIZE-(BUFFER_SIZE%pDemuxer->ts_parser->packet_length); //
-		pDemuxer->input_buffer = SAGETV_MALLOC( pDemuxer->input_buffer_size );
-		pDemuxer->data = pDemuxer->input_buffer;
-		pDemuxer->size = pDemuxer->input_buffer_size;
+		SetupFileSourceBuffer( pDemuxer, nFileFormat );
 
 	} else
 	//if it's PS format
@@ -1223,10 +1263,7 @@ int OpenFileSourceW( DEMUXER *pDemuxer, wchar_t* pFileName, int nFileFormat,  TU
 			return 0;
 		}
 
-		pDemuxer->input_buffer_size = BUFFER_SIZE+PACK_SPACE;
-		pDemuxer->input_buffer = SAGETV_MALLOC( pDemuxer->input_buffer_size );
-		pDemuxer->data = pDemuxer->input_buffer + PACK_SPACE;
-		pDemuxer->size = BUFFER_SIZE;
+		SetupFileSourceBuffer( pDemuxer, nFileFormat );
 	}
 
 	pDemuxer->language_code = LanguageCode((unsigned char*)"eng");
@@ -1235,6 +1272,25 @@ int OpenFileSourceW( DEMUXER *pDemuxer, wchar_t* pFileName, int nFileFormat,  TU
 
 }
 
+//same as OpenFileSource on a file view, the view has to stay open till CloseFileSource()
+int OpenFileViewSource( DEMUXER *pDemuxer, FILE_VIEW* pView, int nFileFormat,  TUNE* pTune )
+{
+	if ( IS_TS_TYPE( nFileFormat ) )
+	{
+		if ( OpenTSChannel( pDemuxer->ts_parser, 0, pDemuxer->tracks[0], pTune ) == 0 )
+			return 0;
+	} else
+	if ( !IS_PS_TYPE( nFileFormat ) )
+		return 0;
+
+	pDemuxer->source_file = -1;
+	pDemuxer->source_view = pView;
+	SeekFileView( pView, 0, SEEK_SET );
+	SetupFileSourceBuffer( pDemuxer, nFileFormat );
+	pDemuxer->language_code = LanguageCode((unsigned char*)"eng");
+	return 1;
+}
+
 void CloseFileSource( DEMUXER *pDemuxer )
 {
 	if ( pDemuxer->source_file > 0 )
@@ -1340,6 +1396,13 @@ void SetupTSProgramDataDump( DEMUXER* pDemuxer, DUMP pfnProgramDataDump, void* p
 
 ////////////////////////////////////// Push File Data //////////////////////////////////////
 //return 0: data is used up; return 1: if pfnProgressCallback != NULL; avformat found
+static int ReadFileSource( DEMUXER *pDemuxer, unsigned char* pBuffer, int nBytes )
+{
+	if ( pDemuxer->source_view != NULL )
+		return ReadFileView( pDemuxer->source_view, pBuffer, nBytes );
+	return (int)read( pDemuxer->source_file, pBuffer, nBytes );
+}
+
 int PumpFileData( DEMUXER *pDemuxer, ULONGLONG lMaxLimitBytes, DUMP pfnProgressCallback, void* pCallbaclContext  )
 {
 	ULONGLONG total_bytes = 0;
@@ -1352,7 +1415,7 @@ int PumpFileData( DEMUXER *pDemuxer, ULONGLONG lMaxLimitBytes, DUMP pfnProgressC
 		read_offset = 0;
 		while ( 1 /*!eof( pDemuxer->source_file )*/ )
 		{ 
-			bytes = (int)read( pDemuxer->source_file, pDemuxer->data+read_offset, read_bytes  );
+			bytes = ReadFileSource( pDemuxer, pDemuxer->data+read_offset, read_bytes  );
 			if ( bytes == 0 )
 				return 0;
 
@@ -1389,7 +1452,7 @@ int PumpFileData( DEMUXER *pDemuxer, ULONGLONG lMaxLimitBytes, DUMP pfnProgressC
 		//while ( !eof( pDemuxer->source_file) )
 		while( 1 )
 		{ 
-			bytes = (int)read( pDemuxer->source_file, pDemuxer->data+read_offset, read_bytes  );
+			bytes = ReadFileSource( pDemuxer, pDemuxer->data+read_offset, read_bytes  );
 			if ( bytes == 0 )
 				return 0;
 
@@ -1631,6 +1694,8 @@ void ResetDemuxCommad( DEMUXER *pDemuxer )
 
 ULONGLONG DemuxSourceSeekPos( DEMUXER *pDemuxer, ULONGLONG lPos, int SeekSet )
 {
+	if ( pDemuxer->source_view != NULL )
+		return SeekFileView( pDemuxer->source_view, lPos, SeekSet );
 	return FSEEK( pDemuxer->source_file, lPos, SeekSet );
 }
 
@@ -1638,6 +1703,8 @@ ULONGLONG DemuxSourceLength( DEMUXER *pDemuxer )
 {
 	ULONGLONG end_pos;
 	ULONGLONG cur_pos;
+	if ( pDemuxer->source_view != NULL )
+		return pDemuxer->source_view->length;
 	cur_pos = FSEEK( pDemuxer->source_file, 0, SEEK_CUR );
 	end_pos = FSEEK( pDemuxer->source_file, 0, SEEK_END );
 	FSEEK( pDemuxer->source_file, cur_pos, SEEK_SET );
@@ -1647,6 +1714,8 @@ ULONGLONG DemuxSourceLength( DEMUXER *pDemuxer )
 
 ULONGLONG DemuxSourceCurPos( DEMUXER *pDemuxer )
 {
+	if ( pDemuxer->source_view != NULL )
+		return pDemuxer->source_view->pos;
 	return FTELL( pDemuxer->source_file );
 }
 
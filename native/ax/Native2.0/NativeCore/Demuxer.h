@@ -70,6 +70,7 @@ typedef struct DEMUXER
 	
 	int source_file;
 	int output_file;
+	struct FILE_VIEW *source_view;	//file source read through a view, not owned
 
 	//used for a file source, contain reading data from a file.
 	unsigned long size;
@@ -96,6 +97,7 @@ void ResetDemuxer( DEMUXER* pDemuxer, int nSlot );
 int  PumpFileData( DEMUXER *pDemuxer, ULONGLONG lMaxLimitBytes, DUMP pfnProgressCallback, void* pCallbaclContext  );
 int  OpenFileSource( DEMUXER *pDemuxer, char* pFileName, int nFileFormat,  TUNE* pTune );
 int  OpenFileSourceW( DEMUXER *pDemuxer, wchar_t* pFileName, int nFileFormat,  TUNE* pTune );
+int  OpenFileViewSource( DEMUXER *pDemuxer, struct FILE_VIEW* pView, int nFileFormat,  TUNE* pTune );
 void CloseFileSource( DEMUXER *pDemuxer );
 int  OpenStreamSource( DEMUXER *pDemuxer, int nFileFormat, TUNE* pTune );
 void CloseStreamSource( DEMUXER *pDemuxer );
@@ -0,0 +1,203 @@
+/*
+ * Copyright 2015 The SageTV Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "NativeCore.h"
+#include "FileView.h"
+
+#ifdef WIN32
+#include <io.h>
+#include <share.h>
+#else
+#include <unistd.h>
+#include <sys/mman.h>
+#define VIEW_MMAP
+#endif
+
+//a probe parses the first few MB of a file and steps back a block or two from its end, the kernel is asked to
+//read in that much at open, the rest of head window is read ahead as parser moves on.
+#define VIEW_HEAD_PREFETCH  (2*1024*1024)
+#define VIEW_TAIL_PREFETCH  (512*1024)
+
+static int ViewFileRead( int fd, ULONGLONG lPos, unsigned char* pBuffer, int nBytes )
+{
+#ifdef WIN32
+	if ( FSEEK( fd, lPos, SEEK_SET ) != lPos )
+		return -1;
+	return (int)read( fd, pBuffer, nBytes );
+#else
+	return (int)pread( fd, pBuffer, nBytes, (off_t)lPos );
+#endif
+}
+
+//off_t is 64 bits with _FILE_OFFSET_BITS=64
+static ULONGLONG ViewFileLength( int fd )
+{
+#ifdef WIN32
+	ULONGLONG length = FSEEK( fd, 0, SEEK_END );
+	FSEEK( fd, 0, SEEK_SET );
+	return length;
+#else
+	struct stat st;
+	if ( fstat( fd, &st ) != 0 )
+		return 0;
+	return (ULONGLONG)st.st_size;
+#endif
+}
+
+#ifdef VIEW_MMAP
+static unsigned char* MapViewWindow( int fd, ULONGLONG lOffset, unsigned long lBytes, int nAdvice,
+									 unsigned long lPrefetchOffset, unsigned long lPrefetchBytes )
+{
+	void* p = mmap( NULL, lBytes, PROT_READ, MAP_SHARED, fd, (off_t)lOffset );
+	if ( p == MAP_FAILED )
+	{
+		SageLog(( _LOG_TRACE, 3, TEXT("file view map failed at %d bytes:%d, errno:%d"), (unsigned long)lOffset, lBytes, errno ));
+		return NULL;
+	}
+	madvise( p, lBytes, nAdvice );
+	if ( lPrefetchBytes )
+		madvise( (unsigned char*)p+lPrefetchOffset, _MIN( lPrefetchBytes, lBytes-lPrefetchOffset ), MADV_WILLNEED );
+	return (unsigned char*)p;
+}
+#endif
+
+FILE_VIEW* OpenFileView( char* pFileName, unsigned long lHeadBytes, unsigned long lTailBytes )
+{
+	FILE_VIEW* pView;
+	int fd;
+#ifdef WIN32
+	fd = _sopen( pFileName, _O_RDONLY|_O_BINARY, _SH_DENYNO , _S_IREAD );
+#else
+#ifdef 	O_LARGEFILE
+	fd = open( pFileName, O_RDONLY|O_LARGEFILE );
+#else
+	fd = open( pFileName, O_RDONLY );
+#endif
+#endif
+	if ( fd < 0 )
+	{
+		SageLog(( _LOG_TRACE, 3, TEXT("file %s can't be open, errno:%d"), pFileName, errno ));
+		return NULL;
+	}
+	pView = SAGETV_MALLOC( sizeof(FILE_VIEW) );
+	if ( pView == NULL )
+	{
+		FCLOSE( fd );
+		return NULL;
+	}
+	pView->fd = fd;
+	pView->length = ViewFileLength( fd );
+
+#ifdef VIEW_MMAP
+	if ( pView->length > 0 && lHeadBytes > 0 )
+	{
+		unsigned long page = (unsigned long)sysconf( _SC_PAGESIZE );
+		//windows that meet each other are one window of the whole file
+		if ( (ULONGLONG)lHeadBytes + lTailBytes >= pView->length )
+		{
+			lHeadBytes = (unsigned long)pView->length;
+			lTailBytes = 0;
+		}
+		pView->head = MapViewWindow( fd, 0, lHeadBytes, MADV_SEQUENTIAL, 0, VIEW_HEAD_PREFETCH );
+		if ( pView->head != NULL )
+			pView->head_bytes = lHeadBytes;
+		if ( lTailBytes > 0 )
+		{
+			unsigned long prefetch;
+			pView->tail_start = ( pView->length - lTailBytes ) & ~(ULONGLONG)(page-1);
+			lTailBytes = (unsigned long)( pView->length - pView->tail_start );
+			prefetch = lTailBytes > VIEW_TAIL_PREFETCH ? ( lTailBytes - VIEW_TAIL_PREFETCH ) & ~(page-1) : 0;
+			pView->tail = MapViewWindow( fd, pView->tail_start, lTailBytes, MADV_RANDOM, prefetch, lTailBytes-prefetch );
+			if ( pView->tail != NULL )
+				pView->tail_bytes = lTailBytes;
+		}
+	}
+#endif
+	return pView;
+}
+
+void CloseFileView( FILE_VIEW* pView )
+{
+	if ( pView == NULL ) return;
+#ifdef VIEW_MMAP
+	if ( pView->head != NULL )
+		munmap( pView->head, pView->head_bytes );
+	if ( pView->tail != NULL )
+		munmap( pView->tail, pView->tail_bytes );
+#endif
+	FCLOSE( pView->fd );
+	SAGETV_FREE( pView );
+}
+
+int ReadFileViewAt( FILE_VIEW* pView, ULONGLONG lPos, unsigned char* pBuffer, int nBytes )
+{
+	int total = 0, bytes;
+	while ( nBytes > 0 )
+	{
+		if ( lPos < pView->head_bytes )
+		{
+			bytes = (int)_MIN( (ULONGLONG)nBytes, pView->head_bytes-lPos );
+			memcpy( pBuffer, pView->head+lPos, bytes );
+		} else
+		if ( pView->tail != NULL && lPos >= pView->tail_start && lPos < pView->tail_start+pView->tail_bytes )
+		{
+			bytes = (int)_MIN( (ULONGLONG)nBytes, pView->tail_start+pView->tail_bytes-lPos );
+			memcpy( pBuffer, pView->tail+(lPos-pView->tail_start), bytes );
+		} else
+		{
+			//out of windows, a file still growing is read past the end of tail window too
+			if ( pView->tail != NULL && lPos < pView->tail_start )
+				bytes = (int)_MIN( (ULONGLONG)nBytes, pView->tail_start-lPos );
+			else
+				bytes = nBytes;
+			bytes = ViewFileRead( pView->fd, lPos, pBuffer, bytes );
+			if ( bytes <= 0 )
+				return total ? total : bytes;
+		}
+		total   += bytes;
+		pBuffer += bytes;
+		nBytes  -= bytes;
+		lPos    += bytes;
+	}
+	return total;
+}
+
+int ReadFileView( FILE_VIEW* pView, unsigned char* pBuffer, int nBytes )
+{
+	int bytes = ReadFileViewAt( pView, pView->pos, pBuffer, nBytes );
+	if ( bytes > 0 )
+		pView->pos += bytes;
+	return bytes;
+}
+
+ULONGLONG SeekFileView( FILE_VIEW* pView, LONGLONG lOffset, int nSeekSet )
+{
+	if ( nSeekSet == SEEK_SET )
+		pView->pos = lOffset;
+	else
+	if ( nSeekSet == SEEK_CUR )
+		pView->pos += lOffset;
+	else
+	if ( nSeekSet == SEEK_END )
+		pView->pos = pView->length + lOffset;
+	return pView->pos;
+}
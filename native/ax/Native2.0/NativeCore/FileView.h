@@ -0,0 +1,50 @@
+/*
+ * Copyright 2015 The SageTV Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FILE_VIEW_H
+#define FILE_VIEW_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//read only view of a file for probing. The head and the tail windows are mapped and hinted to the kernel
+//when the view is opened, so reading both of them is in flight before a parser asks for data; a read out of
+//windows falls back to a file read. Without mmap (WIN32) every read is a file read.
+typedef struct FILE_VIEW
+{
+	int fd;
+	ULONGLONG length;
+	ULONGLONG pos;
+	unsigned char* head;		//mapped [0, head_bytes)
+	unsigned long  head_bytes;
+	unsigned char* tail;		//mapped [tail_start, length)
+	ULONGLONG      tail_start;
+	unsigned long  tail_bytes;
+} FILE_VIEW;
+
+FILE_VIEW* OpenFileView( char* pFileName, unsigned long lHeadBytes, unsigned long lTailBytes );
+void  CloseFileView( FILE_VIEW* pView );
+//read at current position and move it as read() does
+int   ReadFileView( FILE_VIEW* pView, unsigned char* pBuffer, int nBytes );
+int   ReadFileViewAt( FILE_VIEW* pView, ULONGLONG lPos, unsigned char* pBuffer, int nBytes );
+ULONGLONG SeekFileView( FILE_VIEW* pView, LONGLONG lOffset, int nSeekSet );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
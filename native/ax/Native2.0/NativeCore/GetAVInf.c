@@ -39,6 +39,15 @@
 #include "Demuxer.h"
 #include "GetAVInf.h"
 #include "TSInfoParser.h"
+#include "RecordIndex.h"
+#include "FileView.h"
+#include "LiveDuration.h"
+
+#ifndef WIN32
+#include <pthread.h>
+#include <unistd.h>
+#define AVINF_BATCH_THREAD
+#endif
 
 
 #define PTS2MT( x ) ( (x)*PTS_UNITS )   //PTS to Media Time ( 0.1 ms )
@@ -65,6 +74,9 @@ int DetectSagePVRFileW( wchar_t* pFileName, PVR_META_INF* pMetaInf );
 int DetectSagePVRFile( char* pFileName, PVR_META_INF* pMetaInf );
 int DetectPVRRecordingFile( char* pFileName );
 int DetectPVRRecordingFileW( wchar_t* pFileName );
+static int DetectPVRRecordingView( FILE_VIEW* pView );
+static int DetectSagePVRView( FILE_VIEW* pView, PVR_META_INF* pMetaInf );
+static int DetectFileTypeView( FILE_VIEW* pView );
 
 static int AVInfDataDumper( void* pContext, void* pData, int nSize )
 {
@@ -265,18 +277,26 @@ static int PTSInfProgressCallback( void* pContext, void* pData, int nSize )
 
 #define REWIND_BLOCK_SIZE 1024*128
 
-int _GetAVFormat( void* pFileName, int bWcharFileName, unsigned long nCheckMaxiumSize, int bStreamData, 
-			   int nRequestedTSChannel,   char* pFormatBuf, int nFormatSize, char* pDurationBuf, 
-			   int nDurationBufSize, int* nTotalChannel )
+static int DetectAVInfFileType( void* pFileName, int bWcharFileName, FILE_VIEW* pView, PVR_META_INF* pMetaInf,
+							    int* pSagePVRType, int* pPVRRecordingType )
 {
-	AVINF avinf={0};
-	TUNE tune={0};
-	unsigned long av_packets, check_size;
-	int sagepvr_type, pvr_recording_type, file_type, av_present=0, encrypted_data=0;
-	ULONGLONG last_pts;
-	int ret, channel=0, i, track_num;
-	PVR_META_INF MetaInf={0};
-
+	int sagepvr_type, pvr_recording_type, file_type;
+	if ( pView != NULL )
+	{
+		pvr_recording_type = DetectPVRRecordingView( pView );
+		if ( pvr_recording_type )
+		{
+			file_type = MPEG_TS;
+			sagepvr_type = 0;
+		} else
+		{
+			sagepvr_type = DetectSagePVRView( pView, pMetaInf );
+			if ( sagepvr_type != 0 )
+				file_type = MPEG_TS;
+			else
+				file_type = DetectFileTypeView( pView );
+		}
+	} else
 	if ( !bWcharFileName )
 	{
 		pvr_recording_type = DetectPVRRecordingFile( (char*)pFileName );
@@ -286,7 +306,7 @@ int _GetAVFormat( void* pFileName, int bWcharFileName, unsigned long nCheckMaxiu
 			sagepvr_type = 0;
 		} else
 		{
-			sagepvr_type = DetectSagePVRFile( (char*)pFileName, &MetaInf );
+			sagepvr_type = DetectSagePVRFile( (char*)pFileName, pMetaInf );
 			if ( sagepvr_type != 0 )
 			{
 				file_type = MPEG_TS;
@@ -306,7 +326,7 @@ int _GetAVFormat( void* pFileName, int bWcharFileName, unsigned long nCheckMaxiu
 			sagepvr_type = 0;
 		} else
 		{
-			sagepvr_type = DetectSagePVRFileW( (wchar_t*)pFileName, &MetaInf );
+			sagepvr_type = DetectSagePVRFileW( (wchar_t*)pFileName, pMetaInf );
 			if ( sagepvr_type != 0 )
 			{
 				file_type = MPEG_TS;
@@ -316,8 +336,10 @@ int _GetAVFormat( void* pFileName, int bWcharFileName, unsigned long nCheckMaxiu
 			}
 		}
 	}
+	*pSagePVRType = sagepvr_type;
+	*pPVRRecordingType = pvr_recording_type;
 	if ( file_type == 0 )
-		return -2;
+		return 0;
 
 	if ( pvr_recording_type )
 	{
@@ -326,56 +348,193 @@ int _GetAVFormat( void* pFileName, int bWcharFileName, unsigned long nCheckMaxiu
 	} else
 	if ( sagepvr_type )
 	{
-		SageLog(( _LOG_ERROR, 3, TEXT("It's a SagePVR recording. SagePVR Meta:%d tsid:%d program:%d\n"), 
-			                           MetaInf.state, MetaInf.tsid, MetaInf.program_num ));
+		SageLog(( _LOG_ERROR, 3, TEXT("It's a SagePVR recording. SagePVR Meta:%d tsid:%d program:%d\n"),
+			                           pMetaInf->state, pMetaInf->tsid, pMetaInf->program_num ));
+	}
+	return file_type;
+}
+
+static void SetupAVInfTune( TUNE* pTune, int nRequestedTSChannel, int nPVRRecordingType, int nSagePVRType, PVR_META_INF* pMetaInf )
+{
+	if ( nPVRRecordingType == 2 )
+	{
+		//if nRequestedTSChannel = 0; auto search first vaild channel.
+		pTune->tune_string_type = nRequestedTSChannel > 0 ? 1 : 0;
+		pTune->channel = nRequestedTSChannel;
+		pTune->stream_format = ATSC_STREAM;
+		pTune->sub_format = CABLE;
+	} else
+	//if it's a SagePVR
+	if ( nSagePVRType && pMetaInf->state > 0 )
+	{
+		pTune->tune_string_type = 15;
+		pTune->u.atsc.program_id = pMetaInf->program_num;
+		pTune->stream_format = ATSC_STREAM;
+	} else
+	{
+		//if nRequestedTSChannel = 0; auto search first vaild channel.
+		pTune->tune_string_type = nRequestedTSChannel > 0 ? 1 : 0;
+		pTune->u.unkn.data1 = nRequestedTSChannel;
+		pTune->stream_format = FREE_STREAM;
 	}
+}
 
-	avinf.max_check_bytes = nCheckMaxiumSize;
+static void CreateAVInfDemuxer( AVINF* pAVInf, int nFileType, unsigned long nCheckMaxiumSize, int bStreamData )
+{
+	int track_num;
+	pAVInf->max_check_bytes = nCheckMaxiumSize;
 
-	if ( file_type == MPEG_M2TS ) 
+	if ( nFileType == MPEG_M2TS )
 		 track_num = MAX_TRACK_NUM *2;
 	else
 		 track_num = MAX_TRACK_NUM;
-	avinf.demuxer = CreateDemuxer( file_type, track_num, ES_BUFFER_SIZE );
+	pAVInf->demuxer = CreateDemuxer( nFileType, track_num, ES_BUFFER_SIZE );
 
-	SetupBlockDataDumper( avinf.demuxer, AVInfDataDumper, &avinf );
-	SetupMessageDumper( avinf.demuxer, AVInfMEssageDumper, &avinf );
+	SetupBlockDataDumper( pAVInf->demuxer, AVInfDataDumper, pAVInf );
+	SetupMessageDumper( pAVInf->demuxer, AVInfMEssageDumper, pAVInf );
 
 	if ( bStreamData )
-		avinf.task = STREAM_AVINF;
+		pAVInf->task = STREAM_AVINF;
 	else
-		avinf.task = FILE_AVINF;
+		pAVInf->task = FILE_AVINF;
 
-	if ( pvr_recording_type == 2 )
+	if ( IS_TS_TYPE( nFileType ) )
 	{
-		//if nRequestedTSChannel = 0; auto search first vaild channel. 
-		tune.tune_string_type = nRequestedTSChannel > 0 ? 1 : 0;  
-		tune.channel = nRequestedTSChannel;
-		tune.stream_format = ATSC_STREAM;
-		tune.sub_format = CABLE;
-	} else
-	//if it's a SagePVR
-	if ( sagepvr_type && MetaInf.state > 0 )
+		DisableDemuxTSPSI( pAVInf->demuxer );
+		DisablePTSFix( pAVInf->demuxer );
+		pAVInf->demuxer->ts_parser->empty_sub_stream_threshold = nCheckMaxiumSize;
+		//pAVInf->demuxer->ts_parser->naked_stream_threshold = nCheckMaxiumSize;
+	}
+}
+
+//stream info is parsed out, lock on the channel and switch to PTS dumping for duration
+static void LockAVInfStream( AVINF* pAVInf, int nSagePVRType, int* pAVPresent, int* pEncryptedData, unsigned long* pAVPackets )
+{
+	if ( pAVInf->state == 1 ) //AVINF is not ready, check Attribute anyway
 	{
-		tune.tune_string_type = 15;
-		tune.u.atsc.program_id = MetaInf.program_num;
-		tune.stream_format = ATSC_STREAM;
+		TRACKS *tracks;
+		ULONGLONG pos = DemuxUsedBytes( pAVInf->demuxer );
+
+		SageLog(( _LOG_ERROR, 3, TEXT("***********  STREAM IS NOT READY (at bytes:%d, pos:%d), CHECK AVAILABLE STREAMS ***********" ),
+			   pAVInf->max_check_bytes, (unsigned long)pos ));
+		tracks = GetTracks( pAVInf->demuxer, 0 );
+
+		CheckTracksAttr( tracks , (unsigned long)LanguageCode((unsigned char*)"eng") );
+		TracksIndexing( tracks );
+		_display_av_inf( tracks );
+
 	} else
+	if ( pAVInf->state == 2 ) 	//AVINF is ready
 	{
-		//if nRequestedTSChannel = 0; auto search first vaild channel. 
-		tune.tune_string_type = nRequestedTSChannel > 0 ? 1 : 0;  
-		tune.u.unkn.data1 = nRequestedTSChannel;
-		tune.stream_format = FREE_STREAM;
 	}
 
-	if ( IS_TS_TYPE( file_type ) )
+	*pAVPresent = (IsVideoDataPresent( pAVInf->demuxer, 0 ) || IsAudioDataPresent( pAVInf->demuxer, 0 ));
+	*pEncryptedData = IsEncryptedData( pAVInf->demuxer, 0 ); //IsEncryptedTSChannel( pAVInf->demuxer, 0 );
+	*pAVPackets = GetInputVideoPacketCount( pAVInf->demuxer, 0 )+
+				  GetInputAudioPacketCount( pAVInf->demuxer, 0 );
+	pAVInf->last_pts = 0;
+	LockDemuxTSPPmt( pAVInf->demuxer );
+
+	// get duration to read last PTS
+	SetupPESDump( pAVInf->demuxer, PTSDataDumper, pAVInf );
+	if ( nSagePVRType )
+		SetupTSATSDump( pAVInf->demuxer, ATSDataDumper, pAVInf );
+}
+
+static void AVInfResult( AVINF* pAVInf, int bAVPresent, int bEncryptedData, unsigned long lAVPackets,
+						 char* pFormatBuf, int nFormatSize, char* pDurationBuf, int nDurationBufSize )
+{
+	TRACKS *tracks;
+	ULONGLONG dur=0;
 	{
-		DisableDemuxTSPSI( avinf.demuxer );
-		DisablePTSFix( avinf.demuxer );
-		avinf.demuxer->ts_parser->empty_sub_stream_threshold = nCheckMaxiumSize;
-		//avinf.demuxer->ts_parser->naked_stream_threshold = nCheckMaxiumSize;
-	} 
+		char first_pts_buf[64], last_pts_buf[64];;
+		long_long_hs( pAVInf->first_pts, first_pts_buf, sizeof(first_pts_buf) );
+		long_long_hs( pAVInf->last_pts, last_pts_buf, sizeof(last_pts_buf) );
+		SageLog(( _LOG_ERROR, 3, TEXT("*********** PTS: first:0x%s last:0x%s ***********" ), first_pts_buf, last_pts_buf ));
+	}
+
+	SetupPESDump( pAVInf->demuxer, NULL, NULL );
+	tracks = GetTracks( pAVInf->demuxer, 0 );
+	if ( tracks->number_track  )
+	{
+		TracksInfo( tracks,  pFormatBuf, nFormatSize );
+		//time_stamp_s( pAVInf->last_pts ,pDurationBuf, nDurationBufSize );
+		if ( pAVInf->last_pts > pAVInf->first_pts )
+			dur = (pAVInf->last_pts-pAVInf->first_pts); //*PTS_UNITS;
+		else
+		{
+			ULONGLONG last_pts;
+			last_pts = PTS_ROUND_UP( pAVInf->last_pts, pAVInf->first_pts );
+			if ( last_pts < pAVInf->first_pts )
+				dur = 0;
+			else
+				dur = last_pts - pAVInf->first_pts;
+		}
+		//time_stamp( dur, pDurationBuf, nDurationBufSize ); in format hh:mm:ss'nnn'xx
+		dur = PTS2MT( dur );
+		long_long_hs( dur, pDurationBuf, nDurationBufSize );
+	} else
+	{
+		if ( bEncryptedData  )
+		{
+			snprintf( pFormatBuf, nFormatSize, "ENCRYPTED;" );
+			snprintf( pDurationBuf, nDurationBufSize, "00" );
+		} else
+		if ( lAVPackets == 0 || !bAVPresent )
+		{
+			snprintf( pFormatBuf, nFormatSize, "NO-DATA;" );
+			snprintf( pDurationBuf, nDurationBufSize, "00" );
+		} else
+		{
+			int pos = 0;
+			pos += snprintf( pFormatBuf, nFormatSize, "UNKNOWN STREAM;" );
+			TracksInfo( tracks,  pFormatBuf+pos, nFormatSize-pos );
+			snprintf( pDurationBuf, nDurationBufSize, "00" );
+		}
+
+	}
+}
+
+//last video PTS from the keyframe index sidecar of a recording, 0 if there is none or it falls behind the file
+#define INDEX_BEHIND_BYTES (8*1024*1024)
+static ULONGLONG IndexLastPTS( char* pFileName, ULONGLONG lFileLength )
+{
+	char index_name[1024];
+	void* index;
+	ULONGLONG pts = 0;
+	if ( !RecordIndexFileName( pFileName, index_name, sizeof(index_name) ) )
+		return 0;
+	if ( ( index = OpenRecordIndexReader( index_name ) ) == NULL )
+		return 0;
+	if ( RecordIndexEntryNum( index ) > 0 && RecordIndexBytes( index ) + INDEX_BEHIND_BYTES >= lFileLength )
+		pts = RecordIndexLastPTS( index ) & 0x1ffffffffULL;
+	CloseRecordIndexReader( index );
+	return pts;
+}
+
+//GetAVFormat on a file, or on a view of it if pView isn't NULL
+static int GetSourceAVFormat( void* pFileName, int bWcharFileName, FILE_VIEW* pView, unsigned long nCheckMaxiumSize,
+			   int bStreamData, int nRequestedTSChannel,   char* pFormatBuf, int nFormatSize, char* pDurationBuf,
+			   int nDurationBufSize, int* nTotalChannel )
+{
+	AVINF avinf={0};
+	TUNE tune={0};
+	unsigned long av_packets, check_size;
+	int sagepvr_type, pvr_recording_type, file_type, av_present=0, encrypted_data=0;
+	ULONGLONG last_pts;
+	int ret, channel=0, i;
+	PVR_META_INF MetaInf={0};
+
+	file_type = DetectAVInfFileType( pFileName, bWcharFileName, pView, &MetaInf, &sagepvr_type, &pvr_recording_type );
+	if ( file_type == 0 )
+		return -2;
+
+	CreateAVInfDemuxer( &avinf, file_type, nCheckMaxiumSize, bStreamData );
+	SetupAVInfTune( &tune, nRequestedTSChannel, pvr_recording_type, sagepvr_type, &MetaInf );
 
+	if ( pView != NULL )
+		ret = OpenFileViewSource( avinf.demuxer, pView, file_type,  &tune );
+	else
 	if ( !bWcharFileName )
 		ret = OpenFileSource( avinf.demuxer, (char*)pFileName, file_type,  &tune );
 	else
@@ -390,47 +549,18 @@ int _GetAVFormat( void* pFileName, int bWcharFileName, unsigned long nCheckMaxiu
 	avinf.state = 0;
 
 	//*** looping pump data from file into demuxer ***end
-	PumpFileData( avinf.demuxer, avinf.max_check_bytes, AVInfProgressCallback, &avinf ); 
-
-	if ( avinf.state == 1 ) //AVINF is not ready, check Attribute anyway
-	{
-		TRACKS *tracks;
-		ULONGLONG pos = DemuxUsedBytes( avinf.demuxer );
-
-		SageLog(( _LOG_ERROR, 3, TEXT("***********  STREAM IS NOT READY (at bytes:%d, pos:%d), CHECK AVAILABLE STREAMS ***********" ), 
-			   avinf.max_check_bytes, (unsigned long)pos ));
-		tracks = GetTracks( avinf.demuxer, 0 );
-
-		CheckTracksAttr( tracks , (unsigned long)LanguageCode((unsigned char*)"eng") );
-		TracksIndexing( tracks );
-		_display_av_inf( tracks );
-
-	} else
-	if ( avinf.state == 2 ) 	//AVINF is ready
-	{
-	}
-
-	av_present = (IsVideoDataPresent( avinf.demuxer, 0 ) || IsAudioDataPresent( avinf.demuxer, 0 ));
-	encrypted_data = IsEncryptedData( avinf.demuxer, 0 ); //IsEncryptedTSChannel( avinf.demuxer, 0 );
-	av_packets = GetInputVideoPacketCount( avinf.demuxer, 0 )+
-				 GetInputAudioPacketCount( avinf.demuxer, 0 );
-	avinf.last_pts = 0;
-	LockDemuxTSPPmt( avinf.demuxer );
-	
+	PumpFileData( avinf.demuxer, avinf.max_check_bytes, AVInfProgressCallback, &avinf );
 
-	// get duration to read last PTS
-	SetupPESDump( avinf.demuxer, PTSDataDumper, &avinf );
-	if ( sagepvr_type )
-		SetupTSATSDump( avinf.demuxer, ATSDataDumper, &avinf );
+	LockAVInfStream( &avinf, sagepvr_type, &av_present, &encrypted_data, &av_packets );
 
 	//read first PTS
 	DemuxSourceSeekPos( avinf.demuxer, 0, SEEK_SET );
 	last_pts = avinf.last_pts;
 	avinf.last_pts = 0;
 	check_size = 0;
-	while ( av_present && !encrypted_data && avinf.last_pts == 0 ) 
+	while ( av_present && !encrypted_data && avinf.last_pts == 0 )
 	{
-		int ret = PumpFileData( avinf.demuxer,  REWIND_BLOCK_SIZE, PTSInfProgressCallback, &avinf ); 
+		int ret = PumpFileData( avinf.demuxer,  REWIND_BLOCK_SIZE, PTSInfProgressCallback, &avinf );
 		if  ( ret == 0 )
 			break;
 		check_size += REWIND_BLOCK_SIZE;
@@ -442,14 +572,16 @@ int _GetAVFormat( void* pFileName, int bWcharFileName, unsigned long nCheckMaxiu
 	avinf.last_pts = 0;
 	check_size = 0;
 	i = 1;
-	while ( av_present && !encrypted_data && avinf.last_pts == 0 ) 
+	if ( !bWcharFileName && av_present && !encrypted_data )
+		avinf.last_pts = IndexLastPTS( (char*)pFileName, DemuxSourceLength( avinf.demuxer ) );
+	while ( av_present && !encrypted_data && avinf.last_pts == 0 )
 	{
 		int ret;
 		ULONGLONG end_pos = DemuxSourceLength( avinf.demuxer );
 		unsigned long bytes_for_pts = REWIND_BLOCK_SIZE * i;
 		if ( end_pos > bytes_for_pts )
 				end_pos -= bytes_for_pts;
-		else 
+		else
 		{
 			avinf.last_pts = last_pts;
 			break;
@@ -457,93 +589,661 @@ int _GetAVFormat( void* pFileName, int bWcharFileName, unsigned long nCheckMaxiu
 		i++;
 		//SetZeroDemux( avinf.demuxer );
 		DemuxSourceSeekPos( avinf.demuxer, end_pos, SEEK_SET );
-		ret = PumpFileData( avinf.demuxer,  REWIND_BLOCK_SIZE, PTSInfProgressCallback, &avinf ); 
+		ret = PumpFileData( avinf.demuxer,  REWIND_BLOCK_SIZE, PTSInfProgressCallback, &avinf );
 		check_size += REWIND_BLOCK_SIZE;
 		if ( check_size > nCheckMaxiumSize )
 			break;
 
 	}
+
+	AVInfResult( &avinf, av_present, encrypted_data, av_packets, pFormatBuf, nFormatSize, pDurationBuf, nDurationBufSize );
+	*nTotalChannel = GetNumOfChannels( avinf.demuxer, 0 );
+	channel = GetChannelNumber( avinf.demuxer, 0 );
+
+	CloseFileSource( avinf.demuxer );
+	ReleaseDemuxer( avinf.demuxer );
+
+	return channel;
+
+}
+
+int _GetAVFormat( void* pFileName, int bWcharFileName, unsigned long nCheckMaxiumSize, int bStreamData,
+			   int nRequestedTSChannel,   char* pFormatBuf, int nFormatSize, char* pDurationBuf,
+			   int nDurationBufSize, int* nTotalChannel )
+{
+	return GetSourceAVFormat( pFileName, bWcharFileName, NULL, nCheckMaxiumSize, bStreamData,
+				  nRequestedTSChannel, pFormatBuf, nFormatSize, pDurationBuf, nDurationBufSize, nTotalChannel );
+}
+
+int GetAVFormat(  char* pFileName, unsigned long nCheckMaxiumSize, int bStreamData,
+			   int nRequestedTSChannel,   char* pFormatBuf, int nFormatSize, char* pDurationBuf,
+			   int nDurationBufSize, int* nTotalChannel )
+{
+	return _GetAVFormat(  pFileName, 0, nCheckMaxiumSize, bStreamData,
+				  nRequestedTSChannel,   pFormatBuf, nFormatSize, pDurationBuf,
+				  nDurationBufSize, nTotalChannel );
+}
+
+int GetAVFormatW(  wchar_t* pFileName, unsigned long nCheckMaxiumSize, int bStreamData,
+			   int nRequestedTSChannel,   char* pFormatBuf, int nFormatSize, char* pDurationBuf,
+			   int nDurationBufSize, int* nTotalChannel )
+{
+	return _GetAVFormat(  pFileName, 1, nCheckMaxiumSize, bStreamData,
+				  nRequestedTSChannel,   pFormatBuf, nFormatSize, pDurationBuf,
+				  nDurationBufSize, nTotalChannel );
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////  Program Probing  //////////////////////////////////////////////
+//Every program of a multi-program TS gets its own demuxer, all of them are fed from one read of the file.
+//Results are the same as calling GetAVFormat on each channel, without reopening and rereading the file per channel.
+
+typedef struct AVINF_SLOT
+{
+	AVINF avinf;
+	int  av_present;
+	int  encrypted_data;
+	unsigned long av_packets;
+	ULONGLONG first_pass_pts;
+	int  carry_bytes;
+	unsigned char carry[ASI_PACKET_LENGTH*2];
+} AVINF_SLOT;
+
+static AVINF_SLOT* OpenAVInfSlot( int nFileType, int nChannel, unsigned long nCheckMaxiumSize, int bStreamData,
+								  int nPVRRecordingType, int nSagePVRType, PVR_META_INF* pMetaInf )
+{
+	AVINF_SLOT *pSlot = SAGETV_MALLOC( sizeof(AVINF_SLOT) );
+	TUNE tune={0};
+	CreateAVInfDemuxer( &pSlot->avinf, nFileType, nCheckMaxiumSize, bStreamData );
+	SetupAVInfTune( &tune, nChannel, nPVRRecordingType, nSagePVRType, pMetaInf );
+	if ( !OpenStreamSource( pSlot->avinf.demuxer, nFileType, &tune ) )
 	{
-		char first_pts_buf[64], last_pts_buf[64];;
-		long_long_hs( avinf.first_pts, first_pts_buf, sizeof(first_pts_buf) );
-		long_long_hs( avinf.last_pts, last_pts_buf, sizeof(last_pts_buf) );
-		SageLog(( _LOG_ERROR, 3, TEXT("*********** PTS: first:0x%s last:0x%s ***********" ), first_pts_buf, last_pts_buf ));
+		ReleaseDemuxer( pSlot->avinf.demuxer );
+		SAGETV_FREE( pSlot );
+		return NULL;
 	}
+	return pSlot;
+}
+
+static void CloseAVInfSlot( AVINF_SLOT* pSlot )
+{
+	if ( pSlot == NULL ) return;
+	CloseStreamSource( pSlot->avinf.demuxer );
+	ReleaseDemuxer( pSlot->avinf.demuxer );
+	SAGETV_FREE( pSlot );
+}
 
-	SetupPESDump( avinf.demuxer, NULL, NULL );
+//push a block of file data into a slot, a partial packet at the end of block is carried over to the next block
+static void PushAVInfSlot( AVINF_SLOT* pSlot, unsigned char* pData, int nBytes )
+{
+	int used_bytes, expected_bytes;
+	if ( pSlot->carry_bytes > 0 )
 	{
-		TRACKS *tracks;
-		ULONGLONG dur=0;
-		tracks = GetTracks( avinf.demuxer, 0 );
-		if ( tracks->number_track  )
+		int bytes = _MIN( nBytes, (int)sizeof(pSlot->carry)-pSlot->carry_bytes );
+		memcpy( pSlot->carry+pSlot->carry_bytes, pData, bytes );
+		used_bytes = PushDemuxStreamData( pSlot->avinf.demuxer, pSlot->carry, pSlot->carry_bytes+bytes, &expected_bytes );
+		if ( used_bytes > pSlot->carry_bytes )
 		{
-			TracksInfo( tracks,  pFormatBuf, nFormatSize );
-			//time_stamp_s( avinf.last_pts ,pDurationBuf, nDurationBufSize );
-			if ( avinf.last_pts > avinf.first_pts )
-				dur = (avinf.last_pts-avinf.first_pts); //*PTS_UNITS;
-			else
+			pData  += used_bytes-pSlot->carry_bytes;
+			nBytes -= used_bytes-pSlot->carry_bytes;
+		}
+		pSlot->carry_bytes = 0;
+	}
+	used_bytes = PushDemuxStreamData( pSlot->avinf.demuxer, pData, nBytes, &expected_bytes );
+	if ( used_bytes < nBytes && nBytes-used_bytes <= (int)sizeof(pSlot->carry)/2 )
+	{
+		memcpy( pSlot->carry, pData+used_bytes, nBytes-used_bytes );
+		pSlot->carry_bytes = nBytes-used_bytes;
+	}
+}
+
+static int OpenAVInfFile( void* pFileName, int bWcharFileName )
+{
+	int fp;
+#ifdef WIN32
+	if ( !bWcharFileName )
+		fp = _sopen( (char*)pFileName, _O_RDONLY|_O_BINARY, _SH_DENYNO , _S_IREAD );
+	else
+		fp = _wsopen( (wchar_t*)pFileName, _O_RDONLY|_O_BINARY, _SH_DENYNO , _S_IREAD );
+#else
+#ifdef 	O_LARGEFILE
+	fp  = open( (char*)pFileName, O_RDONLY|O_LARGEFILE );
+#else
+	fp  = open( (char*)pFileName, O_RDONLY );
+#endif
+#endif
+	if ( fp < 0 )
+		SageLog(( _LOG_TRACE, 3, TEXT("file %s can't be open, errno:%d"), pFileName, errno ));
+	return fp;
+}
+
+//probing reads the view of a file if there is one, the file otherwise
+static int ReadAVInfFile( int fp, FILE_VIEW* pView, unsigned char* pBuffer, int nBytes )
+{
+	if ( pView != NULL )
+		return ReadFileView( pView, pBuffer, nBytes );
+	return (int)read( fp, pBuffer, nBytes );
+}
+
+static ULONGLONG SeekAVInfFile( int fp, FILE_VIEW* pView, LONGLONG lPos, int nSeekSet )
+{
+	LONGLONG pos;
+	if ( pView != NULL )
+		return SeekFileView( pView, lPos, nSeekSet );
+#ifdef WIN32
+	pos = FSEEK( fp, lPos, nSeekSet );
+#else
+	pos = lseek( fp, (off_t)lPos, nSeekSet ); //off_t is 64 bits with _FILE_OFFSET_BITS=64
+#endif
+	return pos < 0 ? 0 : (ULONGLONG)pos;
+}
+
+static int AVInfStatus( const char* pFormat )
+{
+	if ( pFormat[0] == 0x0 || strstr( pFormat, "UNKNOWN-TS;" ) || strstr( pFormat, "UNKNOWN-PS;" ) || strstr( pFormat, "NO-AV-TS;" ) )
+		return AVINF_UNKNOWN;
+	if ( strstr( pFormat, "ENCRYPTED;" ) || strstr( pFormat, "ENCRYPTED-TS;" ) )
+		return AVINF_ENCRYPTED;
+	if ( strstr( pFormat, "NO-DATA;" ) )
+		return AVINF_NO_DATA;
+	return AVINF_VALID;
+}
+
+static void SlotAVInfResult( AVINF_SLOT* pSlot, AV_PROGRAM_INF* pProgram )
+{
+	if ( pSlot == NULL )
+	{
+		pProgram->channel = -3;
+		pProgram->status = AVINF_UNKNOWN;
+		return;
+	}
+	AVInfResult( &pSlot->avinf, pSlot->av_present, pSlot->encrypted_data, pSlot->av_packets,
+				 pProgram->format, sizeof(pProgram->format), pProgram->duration, sizeof(pProgram->duration) );
+	pProgram->channel = GetChannelNumber( pSlot->avinf.demuxer, 0 );
+	pProgram->total_channel = GetNumOfChannels( pSlot->avinf.demuxer, 0 );
+	pProgram->status = AVInfStatus( pProgram->format );
+}
+
+static int PTSPending( AVINF_SLOT* pSlot )
+{
+	return pSlot != NULL && pSlot->av_present && !pSlot->encrypted_data && pSlot->avinf.last_pts == 0;
+}
+
+//read a block at the current file position into all slots that still wait for a PTS, PumpFileData() of a
+//REWIND_BLOCK_SIZE gives up after the second block, so does this.
+static void PumpAVInfPTS( int fp, FILE_VIEW* pView, unsigned char* pBlock, int nBlockSize, AVINF_SLOT** pSlots, int nSlotNum )
+{
+	int i, k, bytes, pending;
+	for ( i = 0; i<nSlotNum; i++ )
+		if ( pSlots[i] != NULL )
+			pSlots[i]->carry_bytes = 0;
+
+	for ( k = 0; k<2; k++ )
+	{
+		bytes = ReadAVInfFile( fp, pView, pBlock, nBlockSize );
+		if ( bytes <= 0 )
+			break;
+		pending = 0;
+		for ( i = 0; i<nSlotNum; i++ )
+			if ( PTSPending( pSlots[i] ) )
 			{
-				ULONGLONG last_pts;
-				last_pts = PTS_ROUND_UP( avinf.last_pts, avinf.first_pts );
-				if ( last_pts < avinf.first_pts )
-					dur = 0;
-				else
-					dur = last_pts - avinf.first_pts;
+				PushAVInfSlot( pSlots[i], pBlock, bytes );
+				pending += PTSPending( pSlots[i] );
 			}
-			//time_stamp( dur, pDurationBuf, nDurationBufSize ); in format hh:mm:ss'nnn'xx
-			dur = PTS2MT( dur );
-			long_long_hs( dur, pDurationBuf, nDurationBufSize );
-		} else
+		if ( pending == 0 )
+			break;
+	}
+}
+
+//probe nChannelNum channels from nFirstChannel, or all channels of the file if nChannelNum is 0
+static AV_PROBE_INF* _ProbeAVFormat( void* pFileName, int bWcharFileName, FILE_VIEW* pView, unsigned long nCheckMaxiumSize,
+									 int bStreamData, int nFirstChannel, int nChannelNum )
+{
+	AV_PROBE_INF *pProbeInf = SAGETV_MALLOC( sizeof(AV_PROBE_INF) );
+	AVINF_SLOT **slot;
+	PVR_META_INF MetaInf={0};
+	unsigned char *block, *head = NULL;
+	unsigned long head_bytes = 0, head_size = 0, total_bytes = 0, check_size;
+	int sagepvr_type, pvr_recording_type, file_type, fp, block_size, bytes;
+	int slot_num, program_num, i, n, ready;
+	ULONGLONG file_len;
+
+	if ( pProbeInf == NULL )
+		return NULL;
+	file_type = DetectAVInfFileType( pFileName, bWcharFileName, pView, &MetaInf, &sagepvr_type, &pvr_recording_type );
+	pProbeInf->file_type = file_type;
+	if ( file_type == 0 )
+	{
+		pProbeInf->error = -2;
+		return pProbeInf;
+	}
+
+	//a PS file, or a SagePVR recording that is tuned by program id, has one program only
+	if ( !IS_TS_TYPE( file_type ) || ( sagepvr_type && MetaInf.state > 0 ) )
+	{
+		AV_PROGRAM_INF *program = SAGETV_MALLOC( sizeof(AV_PROGRAM_INF) );
+		if ( program == NULL )
 		{
-			if ( encrypted_data  )
-			{
-				snprintf( pFormatBuf, nFormatSize, "ENCRYPTED;" );
-				snprintf( pDurationBuf, nDurationBufSize, "00" );
-			} else
-			if ( av_packets == 0 || !av_present )
+			pProbeInf->error = -3;
+			return pProbeInf;
+		}
+		program->channel = GetSourceAVFormat( pFileName, bWcharFileName, pView, nCheckMaxiumSize, bStreamData, nFirstChannel,
+						                 program->format, sizeof(program->format), program->duration, sizeof(program->duration),
+						                 &program->total_channel );
+		if ( program->channel <= -2 )
+		{
+			pProbeInf->error = program->channel;
+			SAGETV_FREE( program );
+			return pProbeInf;
+		}
+		program->status = AVInfStatus( program->format );
+		pProbeInf->program = program;
+		pProbeInf->program_num = 1;
+		return pProbeInf;
+	}
+
+	if ( pView != NULL )
+	{
+		fp = -1;
+		SeekFileView( pView, 0, SEEK_SET );
+	} else
+	if ( ( fp = OpenAVInfFile( pFileName, bWcharFileName ) ) < 0 )
+	{
+		pProbeInf->error = -3;
+		return pProbeInf;
+	}
+
+	//if channel number is unknown, the first channel is parsed alone to find out how many channels there are
+	slot_num = nChannelNum > 0 ? nChannelNum : 1;
+	program_num = nChannelNum;
+	slot = SAGETV_MALLOC( sizeof(AVINF_SLOT*)*slot_num );
+	if ( slot == NULL )
+	{
+		if ( pView == NULL )
+			FCLOSE( fp );
+		pProbeInf->error = -3;
+		return pProbeInf;
+	}
+	block_size = 0;
+	for ( i = 0; i<slot_num; i++ )
+	{
+		slot[i] = OpenAVInfSlot( file_type, nFirstChannel+i, nCheckMaxiumSize, bStreamData, pvr_recording_type, sagepvr_type, &MetaInf );
+		if ( slot[i] != NULL && block_size == 0 )
+			block_size = BUFFER_SIZE-(BUFFER_SIZE%TSPacketLength( slot[i]->avinf.demuxer ));
+	}
+	if ( block_size == 0 )
+	{
+		if ( pView == NULL )
+			FCLOSE( fp );
+		SAGETV_FREE( slot );
+		pProbeInf->error = -3;
+		return pProbeInf;
+	}
+	block = SAGETV_MALLOC( block_size );
+	if ( block == NULL )
+	{
+		for ( i = 0; i<slot_num; i++ )
+			CloseAVInfSlot( slot[i] );
+		if ( pView == NULL )
+			FCLOSE( fp );
+		SAGETV_FREE( slot );
+		pProbeInf->error = -3;
+		return pProbeInf;
+	}
+
+	//*** looping pump data from file into demuxers till all of them are ready ***
+	while ( 1 )
+	{
+		bytes = ReadAVInfFile( fp, pView, block, block_size );
+		if ( bytes <= 0 )
+			break;
+
+		//keep data read before channel number is known for channels that joins later
+		if ( program_num == 0 )
+		{
+			if ( head_bytes + bytes > head_size )
 			{
-				snprintf( pFormatBuf, nFormatSize, "NO-DATA;" );
-				snprintf( pDurationBuf, nDurationBufSize, "00" );
-			} else
+				unsigned char* p;
+				head_size = ( head_size ? head_size*2 : block_size*4 );
+				while ( head_size < head_bytes + bytes ) head_size *= 2;
+				if ( ( p = SAGETV_MALLOC( head_size ) ) == NULL )
+					break;
+				if ( head_bytes ) memcpy( p, head, head_bytes );
+				SAGETV_FREE( head );
+				head = p;
+			}
+			memcpy( head+head_bytes, block, bytes );
+			head_bytes += bytes;
+		}
+
+		for ( i = 0; i<slot_num; i++ )
+			if ( slot[i] != NULL && slot[i]->avinf.state != 2 )
+				PushAVInfSlot( slot[i], block, bytes );
+
+		if ( program_num == 0 && ( n = GetNumOfChannels( slot[0]->avinf.demuxer, 0 ) ) > 0 )
+		{
+			AVINF_SLOT **slots = SAGETV_MALLOC( sizeof(AVINF_SLOT*)*n );
+			if ( slots == NULL )
+				break;
+			program_num = n;
+			slots[0] = slot[0];
+			SAGETV_FREE( slot );
+			slot = slots;
+			for ( i = 1; i<n; i++ )
 			{
-				int pos = 0;
-				pos += snprintf( pFormatBuf, nFormatSize, "UNKNOWN STREAM;" );
-				TracksInfo( tracks,  pFormatBuf+pos, nFormatSize-pos );
-				snprintf( pDurationBuf, nDurationBufSize, "00" );
+				unsigned long offset;
+				slot[i] = OpenAVInfSlot( file_type, nFirstChannel+i, nCheckMaxiumSize, bStreamData, pvr_recording_type, sagepvr_type, &MetaInf );
+				if ( slot[i] == NULL )
+					continue;
+				for ( offset = 0; offset < head_bytes && slot[i]->avinf.state != 2; offset += block_size )
+					PushAVInfSlot( slot[i], head+offset, (int)_MIN( (unsigned long)block_size, head_bytes-offset ) );
 			}
+			slot_num = n;
+			SAGETV_FREE( head );
+			head = NULL;
+			SageLog(( _LOG_TRACE, 3, TEXT("Probe %d channels at pos:%d"), n, head_bytes ));
+		}
+
+		total_bytes += bytes;
+		if ( nCheckMaxiumSize && nCheckMaxiumSize <= total_bytes )
+			break;
+
+		//stream ready, stop parsing data.
+		for ( ready = 0, i = 0; i<slot_num; i++ )
+			ready += ( slot[i] == NULL || slot[i]->avinf.state == 2 );
+		if ( ready == slot_num )
+			break;
+	}
+	SAGETV_FREE( head );
 
+	for ( i = 0; i<slot_num; i++ )
+		if ( slot[i] != NULL )
+			LockAVInfStream( &slot[i]->avinf, sagepvr_type, &slot[i]->av_present, &slot[i]->encrypted_data, &slot[i]->av_packets );
+
+	//read first PTS
+	SeekAVInfFile( fp, pView, 0, SEEK_SET );
+	PumpAVInfPTS( fp, pView, block, block_size, slot, slot_num );
+	for ( i = 0; i<slot_num; i++ )
+		if ( slot[i] != NULL )
+		{
+			slot[i]->first_pass_pts = slot[i]->avinf.last_pts;
+			slot[i]->avinf.last_pts = 0;
 		}
 
-		*nTotalChannel = GetNumOfChannels( avinf.demuxer, 0 ); 
-		channel = GetChannelNumber( avinf.demuxer, 0 ); 
-		
+	//read last PTS, stepping backward from the end of file
+	file_len = SeekAVInfFile( fp, pView, 0, SEEK_END );
+	check_size = 0;
+	for ( n = 1; ; n++ )
+	{
+		unsigned long bytes_for_pts = REWIND_BLOCK_SIZE * n;
+		int pending = 0;
+		for ( i = 0; i<slot_num; i++ )
+			pending += PTSPending( slot[i] );
+		if ( pending == 0 )
+			break;
+		if ( file_len <= bytes_for_pts )
+		{
+			for ( i = 0; i<slot_num; i++ )
+				if ( PTSPending( slot[i] ) )
+					slot[i]->avinf.last_pts = slot[i]->first_pass_pts;
+			break;
+		}
+		SeekAVInfFile( fp, pView, file_len-bytes_for_pts, SEEK_SET );
+		PumpAVInfPTS( fp, pView, block, block_size, slot, slot_num );
+		check_size += REWIND_BLOCK_SIZE;
+		if ( check_size > nCheckMaxiumSize )
+			break;
 	}
 
-	CloseFileSource( avinf.demuxer );
-	ReleaseDemuxer( avinf.demuxer );
-	
-	return channel;
+	pProbeInf->program = SAGETV_MALLOC( sizeof(AV_PROGRAM_INF)*slot_num );
+	pProbeInf->program_num = pProbeInf->program != NULL ? slot_num : 0;
+	if ( pProbeInf->program == NULL )
+		pProbeInf->error = -3;
+	for ( i = 0; i<slot_num; i++ )
+	{
+		if ( pProbeInf->program != NULL )
+			SlotAVInfResult( slot[i], &pProbeInf->program[i] );
+		CloseAVInfSlot( slot[i] );
+	}
 
+	SAGETV_FREE( block );
+	SAGETV_FREE( slot );
+	if ( pView == NULL )
+		FCLOSE( fp );
+	return pProbeInf;
 }
 
-int GetAVFormat(  char* pFileName, unsigned long nCheckMaxiumSize, int bStreamData, 
-			   int nRequestedTSChannel,   char* pFormatBuf, int nFormatSize, char* pDurationBuf, 
-			   int nDurationBufSize, int* nTotalChannel )
+AV_PROBE_INF* ProbeAVFormat( char* pFileName, unsigned long nCheckMaxiumSize, int bStreamData )
 {
-	return _GetAVFormat(  pFileName, 0, nCheckMaxiumSize, bStreamData, 
-				  nRequestedTSChannel,   pFormatBuf, nFormatSize, pDurationBuf, 
-				  nDurationBufSize, nTotalChannel );
+	return _ProbeAVFormat( pFileName, 0, NULL, nCheckMaxiumSize, bStreamData, 1, 0 );
 }
 
-int GetAVFormatW(  wchar_t* pFileName, unsigned long nCheckMaxiumSize, int bStreamData, 
-			   int nRequestedTSChannel,   char* pFormatBuf, int nFormatSize, char* pDurationBuf, 
-			   int nDurationBufSize, int* nTotalChannel )
+AV_PROBE_INF* ProbeAVFormatW( wchar_t* pFileName, unsigned long nCheckMaxiumSize, int bStreamData )
 {
-	return _GetAVFormat(  pFileName, 1, nCheckMaxiumSize, bStreamData, 
-				  nRequestedTSChannel,   pFormatBuf, nFormatSize, pDurationBuf, 
-				  nDurationBufSize, nTotalChannel );
+	return _ProbeAVFormat( pFileName, 1, NULL, nCheckMaxiumSize, bStreamData, 1, 0 );
+}
+
+void ReleaseAVProbeInf( AV_PROBE_INF* pProbeInf )
+{
+	if ( pProbeInf == NULL ) return;
+	SAGETV_FREE( pProbeInf->program );
+	SAGETV_FREE( pProbeInf );
+}
+
+//Handle of a lazy probe for a program search. The first channel is probed alone, as it's valid in most of files;
+//if caller moves on, the rest channels are probed together in one pass. File name has to be valid till CloseAVProbe().
+typedef struct AV_PROBE
+{
+	void* file_name;
+	int   wchar_file_name;
+	FILE_VIEW* view;
+	unsigned long check_size;
+	int   stream_data;
+	AV_PROBE_INF* first;
+	AV_PROBE_INF* rest;
+} AV_PROBE;
+
+static void* _OpenAVProbe( void* pFileName, int bWcharFileName, FILE_VIEW* pView, unsigned long nCheckMaxiumSize, int bStreamData )
+{
+	AV_PROBE* pProbe = SAGETV_MALLOC( sizeof(AV_PROBE) );
+	pProbe->file_name = pFileName;
+	pProbe->wchar_file_name = bWcharFileName;
+	pProbe->view = pView;
+	pProbe->check_size = nCheckMaxiumSize;
+	pProbe->stream_data = bStreamData;
+	return pProbe;
+}
+
+void* OpenAVProbe( char* pFileName, unsigned long nCheckMaxiumSize, int bStreamData )
+{
+	return _OpenAVProbe( pFileName, 0, NULL, nCheckMaxiumSize, bStreamData );
+}
+
+void* OpenAVProbeW( wchar_t* pFileName, unsigned long nCheckMaxiumSize, int bStreamData )
+{
+	return _OpenAVProbe( pFileName, 1, NULL, nCheckMaxiumSize, bStreamData );
+}
+
+void CloseAVProbe( void* Handle )
+{
+	AV_PROBE* pProbe = (AV_PROBE*)Handle;
+	if ( pProbe == NULL ) return;
+	ReleaseAVProbeInf( pProbe->first );
+	ReleaseAVProbeInf( pProbe->rest );
+	SAGETV_FREE( pProbe );
+}
+
+//same output as GetAVFormat( nRequestedTSChannel = nIndex+1 )
+int GetProbeAVFormat( void* Handle, int nIndex, char* pFormatBuf, int nFormatSize, char* pDurationBuf,
+					  int nDurationBufSize, int* nTotalChannel )
+{
+	AV_PROBE* pProbe = (AV_PROBE*)Handle;
+	AV_PROBE_INF* pProbeInf;
+	AV_PROGRAM_INF* pProgram;
+	if ( pProbe == NULL )
+		return -3;
+
+	if ( pProbe->first == NULL )
+		pProbe->first = _ProbeAVFormat( pProbe->file_name, pProbe->wchar_file_name, pProbe->view, pProbe->check_size, pProbe->stream_data, 1, 1 );
+	if ( ( pProbeInf = pProbe->first ) == NULL )
+		return -3;
+	if ( nIndex > 0 && pProbeInf->program_num > 0 && pProbeInf->program[0].total_channel > 1 )
+	{
+		if ( pProbe->rest == NULL )
+			pProbe->rest = _ProbeAVFormat( pProbe->file_name, pProbe->wchar_file_name, pProbe->view, pProbe->check_size, pProbe->stream_data,
+									       2, pProbeInf->program[0].total_channel-1 );
+		if ( ( pProbeInf = pProbe->rest ) == NULL )
+			return -3;
+		nIndex--;
+	}
+	if ( pProbeInf->program_num == 0 )
+		return pProbeInf->error;
+
+	//a SagePVR recording is tuned by program id whatever channel is asked for
+	if ( nIndex >= pProbeInf->program_num ) nIndex = pProbeInf->program_num-1;
+	if ( nIndex < 0 ) nIndex = 0;
+	pProgram = &pProbeInf->program[nIndex];
+	snprintf( pFormatBuf, nFormatSize, "%s", pProgram->format );
+	snprintf( pDurationBuf, nDurationBufSize, "%s", pProgram->duration );
+	*nTotalChannel = pProgram->total_channel;
+	return pProgram->channel;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////  Batch Probing  ///////////////////////////////////////////////
+//A library scan asks for AV-INF of thousands of files. A batch is probed on a pool of worker threads, each file
+//through a view that maps its head and tail windows, hints them to the kernel, so both are being read in while
+//the file is opened and detected. Results are the same as GetMediaAVFormat of each file.
+
+#define AVINF_VIEW_SLACK   (2*1024*1024)   //PumpFileData overshoots check size by a block, tail steps back one more
+#define AVINF_VIEW_MAX     (256*1024*1024)
+#define MAX_AVINF_THREAD   32
+
+static int AVInfSkipChannel( const char* pFormat )
+{
+	return pFormat[0] == 0x0 || strstr( pFormat, "ENCRYPTED;" ) || strstr( pFormat, "NO-DATA;" ) ||
+		   strstr( pFormat, "UNKNOWN-TS;" ) || strstr( pFormat, "UNKNOWN-PS;" ) || strstr( pFormat, "NO-AV-TS;" );
+}
+
+static int GetSourceMediaAVFormat( char* pFileName, FILE_VIEW* pView, unsigned long nCheckMaxiumSize, int bStreamData,
+								   int nChannel, char* pFormatBuf, int nFormatSize, char* pDurationBuf, int nDurationBufSize,
+								   int* nTotalChannel )
+{
+	void* probe;
+	int ret;
+	pFormatBuf[0] = 0x0;
+	pDurationBuf[0] = 0x0;
+	*nTotalChannel = 0;
+	if ( nChannel >= 0 )
+		return GetSourceAVFormat( pFileName, 0, pView, nCheckMaxiumSize, bStreamData, nChannel+1,
+								  pFormatBuf, nFormatSize, pDurationBuf, nDurationBufSize, nTotalChannel );
+
+	//search the first valid channel, all channels after the first one are probed in one pass of file
+	probe = _OpenAVProbe( pFileName, 0, pView, nCheckMaxiumSize, bStreamData );
+	nChannel = 0;
+	do {
+		ret = GetProbeAVFormat( probe, nChannel, pFormatBuf, nFormatSize, pDurationBuf, nDurationBufSize, nTotalChannel );
+		if ( !AVInfSkipChannel( pFormatBuf ) )
+			break;
+		nChannel++;
+	} while ( nChannel < *nTotalChannel );
+	CloseAVProbe( probe );
+	return ret;
+}
+
+//AV-INF of getMediaAVInf0: channel nChannel (0 based), or the first valid channel if nChannel is negative.
+//Returns channel number as GetAVFormat does (1..n), negative on error.
+int GetMediaAVFormat( char* pFileName, unsigned long nCheckMaxiumSize, int bStreamData, int nChannel,
+					  char* pFormatBuf, int nFormatSize, char* pDurationBuf, int nDurationBufSize, int* nTotalChannel )
+{
+	//a recording that is done isn't tracked anymore
+	if ( !bStreamData )
+		ReleaseLiveDuration( pFileName );
+	return GetSourceMediaAVFormat( pFileName, NULL, nCheckMaxiumSize, bStreamData, nChannel,
+								   pFormatBuf, nFormatSize, pDurationBuf, nDurationBufSize, nTotalChannel );
+}
+
+static void ProbeAVInfBatchItem( AVINF_BATCH_ITEM* pItem )
+{
+	FILE_VIEW* view = NULL;
+	//a file in recording may be truncated under a mapping (circular buffer), it's read as a file.
+	//if a view can't be open, the file path reports the error as GetMediaAVFormat does.
+	if ( pItem->stream_data )
+	{
+		pItem->ret = GetLiveMediaAVFormat( pItem->file_name, pItem->check_size, pItem->channel,
+										   pItem->format, sizeof(pItem->format), pItem->duration, sizeof(pItem->duration),
+										   &pItem->total_channel );
+		return;
+	}
+	{
+		unsigned long window = _MIN( pItem->check_size, AVINF_VIEW_MAX ) + AVINF_VIEW_SLACK;
+		view = OpenFileView( pItem->file_name, window, window );
+	}
+	ReleaseLiveDuration( pItem->file_name );
+	pItem->ret = GetSourceMediaAVFormat( pItem->file_name, view, pItem->check_size, pItem->stream_data, pItem->channel,
+										 pItem->format, sizeof(pItem->format), pItem->duration, sizeof(pItem->duration),
+										 &pItem->total_channel );
+	CloseFileView( view );
+}
+
+typedef struct AVINF_BATCH
+{
+	AVINF_BATCH_ITEM* items;
+	int item_num;
+	volatile int next;
+} AVINF_BATCH;
+
+//workers take the next file as they are done with one, a slow file doesn't hold up the others
+static void* AVInfBatchWorker( void* pContext )
+{
+	AVINF_BATCH* pBatch = (AVINF_BATCH*)pContext;
+	int i;
+	for ( ;; )
+	{
+#ifdef AVINF_BATCH_THREAD
+		i = __sync_fetch_and_add( &pBatch->next, 1 );
+#else
+		i = pBatch->next++;
+#endif
+		if ( i >= pBatch->item_num )
+			break;
+		ProbeAVInfBatchItem( &pBatch->items[i] );
+	}
+	return NULL;
 }
 
+int GetMediaAVFormatBatch( AVINF_BATCH_ITEM* pItems, int nItemNum, int nThreads )
+{
+	AVINF_BATCH batch;
+#ifdef AVINF_BATCH_THREAD
+	pthread_t thread[MAX_AVINF_THREAD];
+	int i, started = 0;
+#endif
+	batch.items = pItems;
+	batch.item_num = nItemNum;
+	batch.next = 0;
+	if ( nItemNum <= 0 )
+		return 0;
+
+#ifdef AVINF_BATCH_THREAD
+	//probing waits on disk most of time, more workers than CPUs keep more reads in flight
+	if ( nThreads <= 0 )
+		nThreads = _MAX( 4, 2*(int)sysconf( _SC_NPROCESSORS_ONLN ) );
+	nThreads = _MIN( nThreads, _MIN( nItemNum, MAX_AVINF_THREAD ) );
+	for ( i = 1; i<nThreads; i++ )
+		if ( pthread_create( &thread[started], NULL, AVInfBatchWorker, &batch ) == 0 )
+			started++;
+	//caller's thread is one of workers
+	AVInfBatchWorker( &batch );
+	for ( i = 0; i<started; i++ )
+		pthread_join( thread[i], NULL );
+	SageLog(( _LOG_TRACE, 3, TEXT("AV-INF batch of %d files done by %d threads"), nItemNum, started+1 ));
+	return started+1;
+#else
+	AVInfBatchWorker( &batch );
+	return 1;
+#endif
+}
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////  PTS Retreving /////////////////////////////////////////////////
@@ -1450,6 +2150,74 @@ int DetectPVRRecordingFileW( wchar_t* pFileName )
 	return file_type;
 }
 
+//file type detection on a file view, blocks are checked as the file readers above do
+static int DetectPVRRecordingView( FILE_VIEW* pView )
+{
+	unsigned char buf[188*2];
+	int bytes = ReadFileViewAt( pView, 0, buf, 188 );
+	if ( bytes <= 0 )
+		return 0;
+	return CheckPVRTag( buf, bytes );
+}
+
+static int DetectSagePVRView( FILE_VIEW* pView, PVR_META_INF* pMetaInf )
+{
+	unsigned char buf[PVR_BUFFER_SIZE];
+	int bytes, count = 0, start_offset = 0, next_block, file_type = 0;
+	ULONGLONG pos = 0;
+
+	while ( count++ < 4 )
+	{
+		bytes = ReadFileViewAt( pView, pos, buf, sizeof(buf) );
+		if ( bytes <= 0 )
+			break;
+		file_type = CheckSagePVRData( buf, bytes );
+		if ( file_type != 0 )
+		{
+			start_offset = SearchPVRMetaInf( &next_block, buf, bytes );
+			break;
+		}
+		pos += bytes;
+	}
+
+	pos += start_offset;
+	pMetaInf->state = 0;
+	while ( file_type > 0 &&  count++ < 400 )
+	{
+		bytes = ReadFileViewAt( pView, pos, buf, 188 );
+		if ( bytes <= 0 )
+			break;
+		start_offset = SearchPVRMetaInf( &next_block, buf, bytes );
+		if ( start_offset >= 0 && GetPVRMetaInf( pMetaInf, buf ) > 0 )
+			break;
+		pos += next_block;
+	}
+	if ( file_type != 0 )
+		SageLog(( _LOG_TRACE, 3, TEXT("SageTV PVR format (view)") ));
+	return file_type;
+}
+
+static int DetectFileTypeView( FILE_VIEW* pView )
+{
+	unsigned char buf[32*1024];
+	int bytes, count = 0, file_type = 0;
+	ULONGLONG pos = 0;
+
+	while ( count++ < 10 )
+	{
+		bytes = ReadFileViewAt( pView, pos, buf, sizeof(buf) );
+		if ( bytes <= 0 )
+			break;
+		file_type = CheckFormat( buf, bytes );
+		if ( file_type != 0 )
+			break;
+		pos += bytes;
+	}
+	if ( file_type == 0 )
+		SageLog(( _LOG_TRACE, 3, TEXT("Unknown file format (view)") ));
+	return file_type;
+}
+
 static void _display_av_inf( TRACKS *pTracks )
 {
 	//int slot_index = 0;
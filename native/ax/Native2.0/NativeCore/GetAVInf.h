@@ -72,6 +72,53 @@ typedef struct AVPTS
 int GetAVFormat(  char* pFileName, unsigned long nCheckMaxiumSize, int bStreamData, 
 			   int nRequestedTSChannel,   char* pFormatBuf, int nFormatSize, char* pDurationBuf, 
 			   int nDurationBufSize, int* nTotalChannel );
+//probed information of each program in a file, see ProbeAVFormat()
+#define AVINF_VALID			0
+#define AVINF_ENCRYPTED		1
+#define AVINF_NO_DATA		2
+#define AVINF_UNKNOWN		3
+
+typedef struct AV_PROGRAM_INF
+{
+	int  channel;			//channel the program is locked on (1..n), as GetAVFormat returns
+	int  total_channel;
+	int  status;			//AVINF_VALID, AVINF_ENCRYPTED, ...
+	char format[2048];
+	char duration[32];
+} AV_PROGRAM_INF;
+
+typedef struct AV_PROBE_INF
+{
+	int error;				//-2:unknown file format; -3:file can't be open
+	int file_type;
+	int program_num;
+	AV_PROGRAM_INF *program;
+} AV_PROBE_INF;
+
+AV_PROBE_INF* ProbeAVFormat( char* pFileName, unsigned long nCheckMaxiumSize, int bStreamData );
+AV_PROBE_INF* ProbeAVFormatW( wchar_t* pFileName, unsigned long nCheckMaxiumSize, int bStreamData );
+void ReleaseAVProbeInf( AV_PROBE_INF* pProbeInf );
+
+//AV-INF of getMediaAVInf0 of MPEGParser: channel nChannel (0 based), or the first valid channel if nChannel is
+//negative. Returns the channel as GetAVFormat does (1..n), negative on error.
+int GetMediaAVFormat( char* pFileName, unsigned long nCheckMaxiumSize, int bStreamData, int nChannel,
+					  char* pFormatBuf, int nFormatSize, char* pDurationBuf, int nDurationBufSize, int* nTotalChannel );
+
+typedef struct AVINF_BATCH_ITEM
+{
+	char* file_name;
+	unsigned long check_size;
+	int  stream_data;
+	int  channel;			//as nChannel of GetMediaAVFormat
+	int  ret;				//results of GetMediaAVFormat
+	int  total_channel;
+	char format[2048];
+	char duration[32];
+} AVINF_BATCH_ITEM;
+
+//GetMediaAVFormat of many files on nThreads workers (0: by number of CPUs), head and tail of a file are read
+//through a mapped view. Returns number of threads used.
+int GetMediaAVFormatBatch( AVINF_BATCH_ITEM* pItems, int nItemNum, int nThreads );
 int GetAVPts( char* pFileName, char* pPTSFile, int nOption, unsigned long nCheckMaxiumSize, 
 			   int nRequestedTSChannel, int* nTotalChannel );
 
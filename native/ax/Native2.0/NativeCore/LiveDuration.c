@@ -0,0 +1,499 @@
+/*
+ * Copyright 2015 The SageTV Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include "NativeCore.h"
+#include "TSFilter.h"
+#include "TSParser.h"
+#include "Demuxer.h"
+#include "GetAVInf.h"
+#include "FileView.h"
+#include "LiveDuration.h"
+
+#ifdef WIN32
+#include <windows.h>
+static CRITICAL_SECTION live_lock;
+static volatile LONG live_lock_state = 0;
+static void LiveLock( )
+{
+	//initialized by the first caller, others wait for it
+	if ( InterlockedCompareExchange( &live_lock_state, 1, 0 ) == 0 )
+	{
+		InitializeCriticalSection( &live_lock );
+		live_lock_state = 2;
+	} else
+	while ( live_lock_state != 2 )
+		Sleep( 0 );
+	EnterCriticalSection( &live_lock );
+}
+#define LiveUnlock( )	LeaveCriticalSection( &live_lock )
+#else
+#include <pthread.h>
+static pthread_mutex_t live_lock = PTHREAD_MUTEX_INITIALIZER;
+#define LiveLock( )		pthread_mutex_lock( &live_lock )
+#define LiveUnlock( )	pthread_mutex_unlock( &live_lock )
+#endif
+
+//The UI polls duration of a recording in progress every few seconds, a full probe parses the file from its start
+//each time. A tracked file keeps the probe result and a clock of one stream (TS PID or PS stream id, video
+//preferred) that is the last DTS (PTS) of the stream. Appended bytes are scanned for PES headers of that stream only,
+//the clock moves on by a step between timestamps, a 33 bits wrap is a small step as well. A step over PTS-FIX
+//threshold is a discontinuity, like PtsFix moves pcr_start over it, the clock moves on by the byte rate of the
+//recording instead.
+
+#define LIVE_FILE_NUM       16
+#define LIVE_READ_BLOCK     (256*1024)
+#define LIVE_ANCHOR_BYTES   (256*1024) 			//end of file scanned for the clock after a probe
+#define LIVE_TAIL_SCAN      (256*1024)			//appended more than twice of it, only the last LIVE_TAIL_SCAN are scanned
+#define LIVE_RATE_SPAN      (2*MPEG_TIME_DIVISOR)
+#define LIVE_PTS_WRAP       ((LONGLONG)0x200000000LL)
+
+char* long_long_hs( ULONGLONG llVal, char* pBuffer, int nSize );
+char* long_long_s( ULONGLONG llVal, char* pBuffer, int nSize );
+
+typedef struct LIVE_FILE
+{
+	char* file_name;
+	int   channel;
+	int   busy;
+	unsigned long use;
+	ULONGLONG dev, ino;
+	ULONGLONG length;			//file length at last call
+	time_t    mtime;
+
+	//probe result
+	int  ret;
+	int  total_channel;
+	char format[2048];
+	ULONGLONG base_mt;			//duration of the probe (media time)
+
+	//clock
+	int  packet_length;			//TS: 188/192, PS: 0
+	unsigned short pid;
+	unsigned char  stream_id;
+	int  clock_valid;
+	ULONGLONG scan_pos;			//file offset where next scan starts
+	ULONGLONG clock;
+	ULONGLONG clock_pos;
+	LONGLONG  advance;			//PTS the clock moved since the probe
+	ULONGLONG rate;				//bytes*16384 per PTS tick
+	ULONGLONG rate_pos;
+	LONGLONG  rate_advance;
+} LIVE_FILE;
+
+static LIVE_FILE* live_file[LIVE_FILE_NUM];
+static unsigned long live_use = 0;
+
+static void FreeLiveFile( LIVE_FILE* pFile )
+{
+	SAGETV_FREE( pFile->file_name );
+	SAGETV_FREE( pFile );
+}
+
+static int FindLiveFile( char* pFileName, int nChannel )
+{
+	int i;
+	for ( i = 0; i<LIVE_FILE_NUM; i++ )
+		if ( live_file[i] != NULL && live_file[i]->channel == nChannel && !strcmp( live_file[i]->file_name, pFileName ) )
+			return i;
+	return -1;
+}
+
+static ULONGLONG LiveTimestamp( const unsigned char* p )
+{
+	return ((ULONGLONG)((p[0]>>1)&0x07)<<30) | (p[1]<<22) | ((p[2]>>1)<<15) | (p[3]<<7) | (p[4]>>1);
+}
+
+static int LiveStreamId( int nStreamId )
+{
+	return ( nStreamId >= 0xc0 && nStreamId <= 0xef ) || nStreamId == 0xbd;
+}
+
+//DTS, or PTS if there is no DTS, as PTSDataDumper takes; 0 if the PES header doesn't carry one
+static int PESTimestamp( const unsigned char* p, int nBytes, ULONGLONG* pTS )
+{
+	if ( nBytes < 14 || ( p[6] & 0xc0 ) != 0x80 || !( p[7] & 0x80 ) )
+		return 0;
+	if ( ( p[7] & 0xc0 ) == 0xc0 && nBytes >= 19 )
+		*pTS = LiveTimestamp( p+14 );
+	else
+		*pTS = LiveTimestamp( p+9 );
+	return 1;
+}
+
+static void LiveClockStep( LIVE_FILE* pFile, ULONGLONG lTS, ULONGLONG lPos )
+{
+	LONGLONG delta, est, threshold = MILLSECOND2PTS(PTS_FIX_THRESHOLD);
+	if ( !pFile->clock_valid )
+	{
+		pFile->clock = lTS;
+		pFile->clock_pos = lPos;
+		pFile->rate_pos = lPos;
+		pFile->rate_advance = pFile->advance;
+		pFile->clock_valid = 1;
+		return;
+	}
+	delta = (LONGLONG)lTS - (LONGLONG)pFile->clock;
+	if ( delta > LIVE_PTS_WRAP/2 )
+		delta -= LIVE_PTS_WRAP;
+	else
+	if ( delta < -LIVE_PTS_WRAP/2 )
+		delta += LIVE_PTS_WRAP;
+	est = pFile->rate ? (LONGLONG)( (lPos - pFile->clock_pos)*16384/pFile->rate ) : 0;
+
+	if ( ( delta >= -threshold && delta <= threshold ) ||
+		 ( pFile->rate && delta-est >= -threshold && delta-est <= threshold ) )
+	{
+		//B frame PTS, or a repeated one
+		if ( delta <= 0 )
+			return;
+		pFile->advance += delta;
+	} else
+	{
+		char tmp1[40], tmp2[40];
+		SageLog(( _LOG_TRACE, 3, TEXT("PTS-FIX: live duration clock is out of range at pos:%s, moved by byte rate %s."),
+				  long_long_s( lPos, tmp1, sizeof(tmp1) ), time_stamp_s( est, tmp2, sizeof(tmp2) ) ));
+		pFile->advance += est;
+		pFile->rate_pos = lPos;
+		pFile->rate_advance = pFile->advance;
+	}
+	pFile->clock = lTS;
+	pFile->clock_pos = lPos;
+	if ( pFile->advance - pFile->rate_advance >= LIVE_RATE_SPAN && lPos > pFile->rate_pos )
+	{
+		pFile->rate = (lPos - pFile->rate_pos)*16384/(pFile->advance - pFile->rate_advance);
+		pFile->rate_pos = lPos;
+		pFile->rate_advance = pFile->advance;
+	}
+}
+
+static int LiveTSSync( const unsigned char* pData, int nBytes, int nPacketLength )
+{
+	int sync = nPacketLength - TS_PACKET_LENGTH;
+	return pData[sync] == TS_SYNC &&
+		   ( nBytes < nPacketLength+sync+1 || pData[nPacketLength+sync] == TS_SYNC );
+}
+
+typedef void (*LIVE_PES_CALLBACK)( LIVE_FILE* pFile, int nKey, const unsigned char* pPES, int nBytes, ULONGLONG lPos );
+
+//walks PES headers of audio/video streams (TS: at payload unit start of packets of pid nKey, any pid if nKey is -1;
+//PS: nKey is stream id). Returns bytes walked, the rest are an incomplete packet (header) next walk starts with.
+static int WalkLivePES( LIVE_FILE* pFile, const unsigned char* pData, int nBytes, ULONGLONG lPos, int nKey,
+						LIVE_PES_CALLBACK pfnPES )
+{
+	int i = 0;
+	if ( pFile->packet_length )
+	{
+		int sync = pFile->packet_length - TS_PACKET_LENGTH;
+		while ( i + pFile->packet_length <= nBytes )
+		{
+			const unsigned char* p = pData+i+sync;
+			int pid, off = 4;
+			if ( !LiveTSSync( pData+i, nBytes-i, pFile->packet_length ) )
+			{
+				i++;
+				continue;
+			}
+			i += pFile->packet_length;
+			pid = ((p[1]&0x1f)<<8)|p[2];
+			if ( !( p[1] & 0x40 ) || !( p[3] & 0x10 ) || ( nKey >= 0 && pid != nKey ) )
+				continue;
+			if ( p[3] & 0x20 )
+				off += 1+p[4];
+			if ( off+19 > TS_PACKET_LENGTH || p[off] || p[off+1] || p[off+2] != 1 || !LiveStreamId( p[off+3] ) )
+				continue;
+			pfnPES( pFile, pid, p+off, TS_PACKET_LENGTH-off, lPos+i-pFile->packet_length );
+		}
+		return i;
+	}
+
+	while ( i + 19 <= nBytes )
+	{
+		const unsigned char* p = pData+i;
+		int id, len;
+		if ( p[0] || p[1] || p[2] != 1 )
+		{
+			i++;
+			continue;
+		}
+		id = p[3];
+		if ( id == 0xba )
+		{
+			i += ( p[4] & 0xc0 ) == 0x40 ? 14 + ( p[13] & 0x07 ) : 12;
+			continue;
+		}
+		if ( id < 0xbb )
+		{
+			i += 4;
+			continue;
+		}
+		len = (p[4]<<8)|p[5];
+		if ( LiveStreamId( id ) && ( nKey < 0 || id == nKey ) )
+			pfnPES( pFile, id, p, 19, lPos+i );
+		//unbounded video PES, its payload is walked for next start code
+		i += len ? 6+len : 6;
+	}
+	return i;
+}
+
+//the clock stream is the first video, else the first audio
+static void PickLivePES( LIVE_FILE* pFile, int nKey, const unsigned char* pPES, int nBytes, ULONGLONG lPos )
+{
+	ULONGLONG ts;
+	if ( !PESTimestamp( pPES, nBytes, &ts ) )
+		return;
+	if ( pPES[3] >= 0xe0 && ( pFile->stream_id < 0xe0 ) )
+	{
+		pFile->stream_id = pPES[3];
+		pFile->pid = nKey;
+	} else
+	if ( pFile->stream_id == 0 )
+	{
+		pFile->stream_id = pPES[3];
+		pFile->pid = nKey;
+	}
+}
+
+static void ClockLivePES( LIVE_FILE* pFile, int nKey, const unsigned char* pPES, int nBytes, ULONGLONG lPos )
+{
+	ULONGLONG ts;
+	if ( PESTimestamp( pPES, nBytes, &ts ) )
+		LiveClockStep( pFile, ts, lPos );
+}
+
+static int LiveClockKey( LIVE_FILE* pFile )
+{
+	return pFile->packet_length ? pFile->pid : pFile->stream_id;
+}
+
+static int LivePacketLength( const unsigned char* pData, int nBytes )
+{
+	int i;
+	for ( i = 0; i < M2TS_PACKET_LENGTH && i + 3*M2TS_PACKET_LENGTH < nBytes; i++ )
+	{
+		if ( pData[i] == TS_SYNC && pData[i+TS_PACKET_LENGTH] == TS_SYNC && pData[i+2*TS_PACKET_LENGTH] == TS_SYNC &&
+			 pData[i+3*TS_PACKET_LENGTH] == TS_SYNC )
+			return TS_PACKET_LENGTH;
+		if ( pData[i] == TS_SYNC && pData[i+M2TS_PACKET_LENGTH] == TS_SYNC && pData[i+2*M2TS_PACKET_LENGTH] == TS_SYNC &&
+			 pData[i+3*M2TS_PACKET_LENGTH] == TS_SYNC )
+			return M2TS_PACKET_LENGTH;
+	}
+	return 0;
+}
+
+//scans [scan_pos, lEnd). A high bitrate recording appends MBs between two polls, only its end is scanned, the clock
+//steps over the skipped data as timestamps say if they are close to what the byte rate says, else by the byte rate.
+static void ScanLiveFile( LIVE_FILE* pFile, FILE_VIEW* pView, ULONGLONG lEnd, unsigned char* pBuffer )
+{
+	ULONGLONG pos = pFile->scan_pos;
+	if ( lEnd > pos + 2*LIVE_TAIL_SCAN )
+		pos = lEnd - LIVE_TAIL_SCAN;
+	while ( pos < lEnd )
+	{
+		int want = (int)_MIN( (ULONGLONG)LIVE_READ_BLOCK, lEnd-pos );
+		int bytes = ReadFileViewAt( pView, pos, pBuffer, want );
+		if ( bytes <= 0 )
+			break;
+		pos += WalkLivePES( pFile, pBuffer, bytes, pos, LiveClockKey( pFile ), ClockLivePES );
+		if ( bytes < LIVE_READ_BLOCK )
+			break;
+	}
+	pFile->scan_pos = pos;
+}
+
+//the clock at the end of a probed file; the probe duration is at the clock.
+static LIVE_FILE* AnchorLiveFile( char* pFileName, FILE_VIEW* pView, ULONGLONG lLength, unsigned char* pBuffer )
+{
+	LIVE_FILE* file;
+	ULONGLONG start = lLength > LIVE_ANCHOR_BYTES ? lLength - LIVE_ANCHOR_BYTES : 0;
+	int bytes, used;
+	bytes = ReadFileViewAt( pView, start, pBuffer, (int)(lLength-start) );
+	if ( bytes <= 0 )
+		return NULL;
+	file = SAGETV_MALLOC( sizeof(LIVE_FILE) );
+	file->packet_length = LivePacketLength( pBuffer, bytes );
+	WalkLivePES( file, pBuffer, bytes, start, -1, PickLivePES );
+	if ( file->stream_id == 0 )
+	{
+		SAGETV_FREE( file );
+		return NULL;
+	}
+	used = WalkLivePES( file, pBuffer, bytes, start, LiveClockKey( file ), ClockLivePES );
+	if ( !file->clock_valid )
+	{
+		SAGETV_FREE( file );
+		return NULL;
+	}
+	file->scan_pos = start + used;
+	file->advance = 0;
+	file->rate_pos = file->clock_pos;
+	file->rate_advance = 0;
+	SageLog(( _LOG_TRACE, 3, TEXT("live duration of %s tracked by %s 0x%x, clock at %d."), pFileName,
+			  file->packet_length ? "pid" : "stream", file->packet_length ? file->pid : file->stream_id,
+			  (unsigned long)file->clock_pos ));
+	return file;
+}
+
+static void LiveDurationString( LIVE_FILE* pFile, char* pDurationBuf, int nDurationBufSize )
+{
+	ULONGLONG dur = pFile->base_mt + (ULONGLONG)pFile->advance*UNITS/MPEG_TIME_DIVISOR;
+	long_long_hs( dur, pDurationBuf, nDurationBufSize );
+}
+
+static void TrackLiveFile( LIVE_FILE* pFile )
+{
+	int i, k = -1;
+	LiveLock( );
+	i = FindLiveFile( pFile->file_name, pFile->channel );
+	if ( i >= 0 && live_file[i]->busy )
+	{
+		//another thread is updating it
+		LiveUnlock( );
+		FreeLiveFile( pFile );
+		return;
+	}
+	if ( i < 0 )
+	{
+		//a free one, else the least recently used one
+		for ( i = 0; i<LIVE_FILE_NUM; i++ )
+		{
+			if ( live_file[i] == NULL )
+				break;
+			if ( !live_file[i]->busy && ( k < 0 || live_file[i]->use < live_file[k]->use ) )
+				k = i;
+		}
+		if ( i == LIVE_FILE_NUM )
+			i = k;
+	}
+	if ( i >= 0 )
+	{
+		if ( live_file[i] != NULL )
+			FreeLiveFile( live_file[i] );
+		pFile->use = ++live_use;
+		live_file[i] = pFile;
+	} else
+		FreeLiveFile( pFile );
+	LiveUnlock( );
+}
+
+int GetLiveMediaAVFormat( char* pFileName, unsigned long nCheckMaxiumSize, int nChannel,
+						  char* pFormatBuf, int nFormatSize, char* pDurationBuf, int nDurationBufSize, int* nTotalChannel )
+{
+	struct stat st;
+	LIVE_FILE* file = NULL;
+	FILE_VIEW* view;
+	unsigned char* buffer;
+	int i, ret;
+
+	if ( stat( pFileName, &st ) )
+		return GetMediaAVFormat( pFileName, nCheckMaxiumSize, 1, nChannel, pFormatBuf, nFormatSize,
+								 pDurationBuf, nDurationBufSize, nTotalChannel );
+
+	LiveLock( );
+	i = FindLiveFile( pFileName, nChannel );
+	if ( i >= 0 && !live_file[i]->busy )
+	{
+		file = live_file[i];
+		//a new file of the same name, a shorter file, or a file written in place (circular) is probed again
+		if ( file->dev != (ULONGLONG)st.st_dev || file->ino != (ULONGLONG)st.st_ino ||
+			 (ULONGLONG)st.st_size < file->length || ( (ULONGLONG)st.st_size == file->length && st.st_mtime != file->mtime ) )
+		{
+			FreeLiveFile( file );
+			live_file[i] = NULL;
+			file = NULL;
+		} else
+		{
+			file->busy = 1;
+			file->use = ++live_use;
+		}
+	}
+	LiveUnlock( );
+
+	if ( file != NULL )
+	{
+		if ( (ULONGLONG)st.st_size > file->scan_pos && ( view = OpenFileView( pFileName, 0, 0 ) ) != NULL )
+		{
+			buffer = SAGETV_MALLOC( LIVE_READ_BLOCK );
+			ScanLiveFile( file, view, view->length, buffer );
+			SAGETV_FREE( buffer );
+			CloseFileView( view );
+		}
+		file->length = (ULONGLONG)st.st_size;
+		file->mtime = st.st_mtime;
+		snprintf( pFormatBuf, nFormatSize, "%s", file->format );
+		LiveDurationString( file, pDurationBuf, nDurationBufSize );
+		*nTotalChannel = file->total_channel;
+		ret = file->ret;
+		LiveLock( );
+		file->busy = 0;
+		LiveUnlock( );
+		return ret;
+	}
+
+	ret = GetMediaAVFormat( pFileName, nCheckMaxiumSize, 1, nChannel, pFormatBuf, nFormatSize,
+							pDurationBuf, nDurationBufSize, nTotalChannel );
+	//a file without streams or timestamps yet is probed again next time
+	if ( ret <= 0 || hs_long_long( pDurationBuf ) == 0 || st.st_size == 0 )
+		return ret;
+	if ( ( view = OpenFileView( pFileName, 0, 0 ) ) == NULL )
+		return ret;
+	buffer = SAGETV_MALLOC( LIVE_ANCHOR_BYTES );
+	file = AnchorLiveFile( pFileName, view, (ULONGLONG)st.st_size, buffer );
+	SAGETV_FREE( buffer );
+	CloseFileView( view );
+	if ( file == NULL )
+		return ret;
+
+	file->file_name = SAGETV_MALLOC( strlen( pFileName )+1 );
+	strcpy( file->file_name, pFileName );
+	file->channel = nChannel;
+	file->dev = (ULONGLONG)st.st_dev;
+	file->ino = (ULONGLONG)st.st_ino;
+	file->length = (ULONGLONG)st.st_size;
+	file->mtime = st.st_mtime;
+	file->ret = ret;
+	file->total_channel = *nTotalChannel;
+	snprintf( file->format, sizeof(file->format), "%s", pFormatBuf );
+	file->base_mt = hs_long_long( pDurationBuf );
+	{
+		ULONGLONG base_pts = file->base_mt*MPEG_TIME_DIVISOR/UNITS;
+		if ( base_pts )
+			file->rate = file->clock_pos*16384/base_pts;
+	}
+	TrackLiveFile( file );
+	return ret;
+}
+
+void ReleaseLiveDuration( char* pFileName )
+{
+	int i;
+	LiveLock( );
+	for ( i = 0; i<LIVE_FILE_NUM; i++ )
+	{
+		if ( live_file[i] == NULL || live_file[i]->busy )
+			continue;
+		if ( pFileName == NULL || !strcmp( live_file[i]->file_name, pFileName ) )
+		{
+			FreeLiveFile( live_file[i] );
+			live_file[i] = NULL;
+		}
+	}
+	LiveUnlock( );
+}
@@ -0,0 +1,36 @@
+/*
+ * Copyright 2015 The SageTV Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LIVE_DURATION_H
+#define LIVE_DURATION_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//AV-INF of a file still being recorded (bLiveFile of getMediaAVInf0). The first call of a file probes it as
+//GetMediaAVFormat does and keeps the result with the last timestamp at its end; later calls read only bytes
+//appended since then and move the duration on by timestamps found in them.
+int  GetLiveMediaAVFormat( char* pFileName, unsigned long nCheckMaxiumSize, int nChannel,
+						   char* pFormatBuf, int nFormatSize, char* pDurationBuf, int nDurationBufSize, int* nTotalChannel );
+//forget a file (it isn't recording anymore), all files if pFileName is NULL
+void ReleaseLiveDuration( char* pFileName );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
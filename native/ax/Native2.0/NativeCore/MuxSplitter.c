@@ -0,0 +1,709 @@
+/*
+ * Copyright 2015 The SageTV Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "NativeCore.h"
+#include "TSFilter.h"
+#include "AVTrack.h"
+#include "Remuxer.h"
+#include "MuxSplitter.h"
+
+#ifndef WIN32
+#include <pthread.h>
+#define SPLIT_THREAD
+#endif
+
+//Recording all programs of a mux. The pushing thread runs one TS filter that parses PAT and PMTs only, a pid
+//routing table built from them maps every packet to the channels it belongs to (PAT goes to all of them), and
+//packets are copied into a block of the channel. A full block is queued to the worker owning the channel, the
+//worker feeds it to the channel's remuxer, so ES assembly and PS/TS building of each program run in parallel
+//and a remuxer only sees packets of its own program. Blocks are recycled per channel, when all blocks of a
+//channel are queued the pushing thread waits for its worker.
+//Once a program is selected the splitter records selected programs only, a channel gets an output when its program
+//is selected and a deselected program stops independently of the others.
+
+#define SPLIT_BLOCK_PACKETS  256
+#define SPLIT_MAX_BLOCKS     16
+
+typedef struct SPLIT_BLOCK
+{
+	struct SPLIT_BLOCK* next;
+	unsigned short program;
+	int  bytes;
+	unsigned char* data;
+} SPLIT_BLOCK;
+
+typedef struct SPLIT_OUTPUT
+{
+	unsigned short channel;
+	unsigned short program;
+	void* remuxer;
+	struct MUX_SPLITTER* splitter;
+	struct SPLIT_WORKER* worker;
+	unsigned short pmt_pid;
+	SPLIT_BLOCK* fill;                //pushing thread only
+	SPLIT_BLOCK* queue_head;          //following fields guarded by worker lock
+	SPLIT_BLOCK* queue_tail;
+	SPLIT_BLOCK* free_list;
+	int  block_num;
+	unsigned short out_program;       //worker only
+	unsigned short stopped;           //program deselected, nothing is routed to it
+	ULONGLONG in_bytes;
+} SPLIT_OUTPUT;
+
+typedef struct SPLIT_WORKER
+{
+#ifdef SPLIT_THREAD
+	pthread_t thread;
+	pthread_mutex_t lock;
+	pthread_cond_t  wake;
+	pthread_cond_t  done;
+#endif
+	int running;
+	int stop;
+	int busy;
+	int queued;
+	int output_num;
+	int next_output;
+	SPLIT_OUTPUT* output[MAX_SPLIT_CHANNEL];
+} SPLIT_WORKER;
+
+typedef struct MUX_SPLITTER
+{
+	TS_FILTER* ts_filter;
+	int  input_format;
+	int  output_format;
+	int  packet_length;
+	int  block_size;
+	int  max_channel;
+	DUMP  output_dumper;
+	void* output_dumper_context;
+
+	int  thread_num;
+	SPLIT_WORKER worker[MAX_SPLIT_THREAD];    //without threads worker[0] remuxes inline
+
+	int  output_num;
+	SPLIT_OUTPUT* output[MAX_SPLIT_CHANNEL];
+	SPLIT_OUTPUT* channel_output[MAX_SPLIT_CHANNEL+1];
+	ULONGLONG route[0x2000];          //bit n: packet of the pid goes to output[n]
+
+	int  select_mode;                 //outputs of selected programs only
+	int  select_num;
+	unsigned short select_program[MAX_SPLIT_CHANNEL];
+
+	ULONGLONG input_packets;
+	ULONGLONG bad_packets;
+} MUX_SPLITTER;
+
+static void WorkerLock( SPLIT_WORKER* pWorker )
+{
+#ifdef SPLIT_THREAD
+	if ( pWorker->running ) pthread_mutex_lock( &pWorker->lock );
+#endif
+}
+
+static void WorkerUnlock( SPLIT_WORKER* pWorker )
+{
+#ifdef SPLIT_THREAD
+	if ( pWorker->running ) pthread_mutex_unlock( &pWorker->lock );
+#endif
+}
+
+static inline int LowBit( ULONGLONG lMask )
+{
+#if defined(__GNUC__)
+	return __builtin_ctzll( lMask );
+#else
+	int i = 0;
+	while ( !( lMask & 1 ) ) { lMask >>= 1; i++; }
+	return i;
+#endif
+}
+
+static int SplitOutputDumper( void* pContext, unsigned char* pData, int nSize )
+{
+	SPLIT_OUTPUT* output = (SPLIT_OUTPUT*)pContext;
+	MUX_SPLITTER* splitter = output->splitter;
+	OUTPUT_DATA *pOutputData = (OUTPUT_DATA *)pData;
+	MUX_OUTPUT_DATA output_data;
+	if ( splitter->output_dumper == NULL )
+		return pOutputData->bytes;
+	output_data.channel  = output->channel;
+	output_data.program  = output->out_program;
+	output_data.data_ptr = pOutputData->data_ptr;
+	output_data.bytes    = pOutputData->bytes;
+	splitter->output_dumper( splitter->output_dumper_context, &output_data, sizeof(output_data) );
+	return pOutputData->bytes;
+}
+
+static void RemuxBlock( SPLIT_OUTPUT* pOutput, SPLIT_BLOCK* pBlock )
+{
+	int offset = 0, expected_bytes;
+	pOutput->out_program = pBlock->program;
+	while ( offset < pBlock->bytes )
+	{
+		int used = PushRemuxStreamData( pOutput->remuxer, pBlock->data+offset, pBlock->bytes-offset, &expected_bytes );
+		if ( used <= 0 ) break;
+		offset += used;
+	}
+	pBlock->bytes = 0;
+}
+
+//take one queued block of each channel, remux them outside of lock, 0 when nothing is queued
+static int WorkerPass( SPLIT_WORKER* pWorker )
+{
+	SPLIT_BLOCK* block[MAX_SPLIT_CHANNEL];
+	SPLIT_OUTPUT* output[MAX_SPLIT_CHANNEL];
+	int i, k, num = 0;
+
+	for ( i = 0; i<pWorker->output_num; i++ )
+	{
+		SPLIT_OUTPUT* out = pWorker->output[ (pWorker->next_output+i) % pWorker->output_num ];
+		if ( out->queue_head == NULL ) continue;
+		block[num] = out->queue_head;
+		out->queue_head = block[num]->next;
+		if ( out->queue_head == NULL ) out->queue_tail = NULL;
+		output[num++] = out;
+	}
+	if ( num == 0 )
+		return 0;
+	pWorker->next_output++;
+	pWorker->busy = 1;
+	WorkerUnlock( pWorker );
+
+	for ( k = 0; k<num; k++ )
+		RemuxBlock( output[k], block[k] );
+
+	WorkerLock( pWorker );
+	for ( k = 0; k<num; k++ )
+	{
+		block[k]->next = output[k]->free_list;
+		output[k]->free_list = block[k];
+	}
+	pWorker->queued -= num;
+	pWorker->busy = 0;
+	return num;
+}
+
+#ifdef SPLIT_THREAD
+static void* SplitWorkerThread( void* pContext )
+{
+	SPLIT_WORKER* worker = (SPLIT_WORKER*)pContext;
+	pthread_mutex_lock( &worker->lock );
+	while ( 1 )
+	{
+		while ( !worker->stop && worker->queued == 0 )
+			pthread_cond_wait( &worker->wake, &worker->lock );
+		if ( worker->queued == 0 )
+			break;
+		WorkerPass( worker );
+		pthread_cond_broadcast( &worker->done );
+	}
+	pthread_mutex_unlock( &worker->lock );
+	return NULL;
+}
+#endif
+
+static void QueueBlock( SPLIT_OUTPUT* pOutput )
+{
+	SPLIT_WORKER* worker = pOutput->worker;
+	SPLIT_BLOCK* block = pOutput->fill;
+	if ( block == NULL || block->bytes == 0 )
+		return;
+	pOutput->fill = NULL;
+	block->program = pOutput->program;
+	block->next = NULL;
+
+	WorkerLock( worker );
+	if ( pOutput->queue_tail )
+		pOutput->queue_tail->next = block;
+	else
+		pOutput->queue_head = block;
+	pOutput->queue_tail = block;
+	worker->queued++;
+	if ( !worker->running )
+	{
+		while ( WorkerPass( worker ) > 0 )
+			;
+	}
+#ifdef SPLIT_THREAD
+	else
+		pthread_cond_signal( &worker->wake );
+#endif
+	WorkerUnlock( worker );
+}
+
+static SPLIT_BLOCK* FillBlock( MUX_SPLITTER* pSplitter, SPLIT_OUTPUT* pOutput )
+{
+	SPLIT_WORKER* worker = pOutput->worker;
+	SPLIT_BLOCK* block = NULL;
+	if ( pOutput->fill != NULL )
+		return pOutput->fill;
+
+	WorkerLock( worker );
+#ifdef SPLIT_THREAD
+	while ( worker->running && pOutput->free_list == NULL && pOutput->block_num >= SPLIT_MAX_BLOCKS )
+		pthread_cond_wait( &worker->done, &worker->lock );
+#endif
+	if ( pOutput->free_list != NULL )
+	{
+		block = pOutput->free_list;
+		pOutput->free_list = block->next;
+	}
+	WorkerUnlock( worker );
+
+	if ( block == NULL )
+	{
+		block = SAGETV_MALLOC( sizeof(SPLIT_BLOCK) );
+		block->data = SAGETV_MALLOC( pSplitter->block_size );
+		pOutput->block_num++;
+	}
+	block->bytes = 0;
+	pOutput->fill = block;
+	return block;
+}
+
+static void ReleaseBlocks( SPLIT_BLOCK* pBlock )
+{
+	while ( pBlock != NULL )
+	{
+		SPLIT_BLOCK* next = pBlock->next;
+		SAGETV_FREE( pBlock->data );
+		SAGETV_FREE( pBlock );
+		pBlock = next;
+	}
+}
+
+static SPLIT_OUTPUT* CreateSplitOutput( MUX_SPLITTER* pSplitter, int nChannel )
+{
+	SPLIT_OUTPUT* output;
+	SPLIT_WORKER* worker;
+	TUNE tune={0};
+
+	if ( pSplitter->output_num >= MAX_SPLIT_CHANNEL )
+		return NULL;
+	output = SAGETV_MALLOC( sizeof(SPLIT_OUTPUT) );
+	output->channel  = nChannel;
+	output->splitter = pSplitter;
+	tune.channel = nChannel;
+	output->remuxer = OpenRemuxStream( REMUX_STREAM, &tune, pSplitter->input_format, pSplitter->output_format,
+									   NULL, NULL, (DUMP)SplitOutputDumper, output );
+	if ( output->remuxer == NULL )
+	{
+		SageLog(( _LOG_ERROR, 3, TEXT("MuxSplitter: failed to open remuxer of channel %d"), nChannel ));
+		SAGETV_FREE( output );
+		return NULL;
+	}
+
+	worker = &pSplitter->worker[ pSplitter->thread_num ? pSplitter->output_num % pSplitter->thread_num : 0 ];
+	output->worker = worker;
+	WorkerLock( worker );
+	worker->output[worker->output_num++] = output;
+	WorkerUnlock( worker );
+
+	pSplitter->route[0] |= 1ULL<<pSplitter->output_num;
+	pSplitter->output[pSplitter->output_num++] = output;
+	pSplitter->channel_output[nChannel] = output;
+	SageLog(( _LOG_TRACE, 3, TEXT("MuxSplitter: channel %d output on worker %d"), nChannel, (int)(worker-pSplitter->worker) ));
+	return output;
+}
+
+static int OutputIndex( MUX_SPLITTER* pSplitter, SPLIT_OUTPUT* pOutput )
+{
+	int i;
+	for ( i = 0; i<pSplitter->output_num; i++ )
+		if ( pSplitter->output[i] == pOutput )
+			return i;
+	return -1;
+}
+
+static int ProgramSelected( MUX_SPLITTER* pSplitter, unsigned short nProgram )
+{
+	int i;
+	if ( !pSplitter->select_mode )
+		return 1;
+	for ( i = 0; i<pSplitter->select_num; i++ )
+		if ( pSplitter->select_program[i] == nProgram )
+			return 1;
+	return 0;
+}
+
+//output created for a selected program
+static SPLIT_OUTPUT* ProgramOutput( MUX_SPLITTER* pSplitter, unsigned short nProgram )
+{
+	int i;
+	for ( i = 0; i<pSplitter->output_num; i++ )
+		if ( pSplitter->output[i]->program == nProgram )
+			return pSplitter->output[i];
+	return NULL;
+}
+
+//remux what is pushed for an output, its remuxer is idle when it returns
+static void DrainSplitOutput( SPLIT_OUTPUT* pOutput )
+{
+	QueueBlock( pOutput );
+#ifdef SPLIT_THREAD
+	if ( pOutput->worker->running )
+	{
+		SPLIT_WORKER* worker = pOutput->worker;
+		pthread_mutex_lock( &worker->lock );
+		while ( pOutput->queue_head != NULL || worker->busy )
+			pthread_cond_wait( &worker->done, &worker->lock );
+		pthread_mutex_unlock( &worker->lock );
+	}
+#endif
+}
+
+static void TuneSplitOutput( SPLIT_OUTPUT* pOutput, int nChannel )
+{
+	TUNE tune={0};
+	DrainSplitOutput( pOutput );
+	ResetRemuxStream( pOutput->remuxer );
+	tune.channel = nChannel;
+	SetupRemuxStreamTune( pOutput->remuxer, &tune );
+	pOutput->channel = nChannel;
+}
+
+//route PMT pid of each channel in PAT to its output, new channels get an output
+static void RoutePAT( MUX_SPLITTER* pSplitter )
+{
+	TS_FILTER* filter = pSplitter->ts_filter;
+	int i;
+
+	//stream pids stay routed till the PMT of the channel is updated
+	for ( i = 0; i<pSplitter->output_num; i++ )
+	{
+		if ( pSplitter->output[i]->pmt_pid )
+			pSplitter->route[ pSplitter->output[i]->pmt_pid ] &= ~(1ULL<<i);
+		pSplitter->output[i]->pmt_pid = 0;
+	}
+	//a selected program keeps its output when it moves to another channel
+	if ( pSplitter->select_mode )
+		memset( pSplitter->channel_output, 0, sizeof(pSplitter->channel_output) );
+
+	for ( i = 0; i<filter->mapped_num; i++ )
+	{
+		int channel = filter->pmt_map[i].channel+1;
+		unsigned short program = filter->pmt_map[i].program;
+		SPLIT_OUTPUT* output;
+		if ( filter->pmt_map[i].pid == 0 || program == 0 || channel > pSplitter->max_channel )
+			continue;
+		if ( pSplitter->select_mode )
+		{
+			if ( !ProgramSelected( pSplitter, program ) )
+				continue;
+			output = ProgramOutput( pSplitter, program );
+			if ( output != NULL && output->channel != channel && !output->stopped )
+				TuneSplitOutput( output, channel );
+		} else
+			output = pSplitter->channel_output[channel];
+		if ( output == NULL )
+			output = CreateSplitOutput( pSplitter, channel );
+		if ( output == NULL || output->stopped )
+			continue;
+		output->program = program;
+		output->pmt_pid = filter->pmt_map[i].pid & 0x1fff;
+		pSplitter->channel_output[channel] = output;
+		pSplitter->route[ output->pmt_pid ] |= 1ULL<<OutputIndex( pSplitter, output );
+	}
+}
+
+//PAT updated
+static int SplitPATDumper( void* pContext, unsigned char* pData, int nSize )
+{
+	MUX_SPLITTER* splitter = (MUX_SPLITTER*)pContext;
+	PAT_DATA* pat_data = (PAT_DATA*)pData;
+
+	if ( pat_data->update_flag == 0 )
+		return 0;
+	RoutePAT( splitter );
+	return 0;
+}
+
+//PMT updated, route pcr and stream pids of the program to its channel
+static int SplitPMTDumper( void* pContext, unsigned char* pData, int nSize )
+{
+	MUX_SPLITTER* splitter = (MUX_SPLITTER*)pContext;
+	PMT_DATA* pmt_data = (PMT_DATA*)pData;
+	TS_PMT* pmt = pmt_data->pmt_table;
+	SPLIT_OUTPUT* output;
+	ULONGLONG bit;
+	int i, index;
+
+	if ( pmt_data->channel <= 0 || pmt_data->channel > splitter->max_channel )
+		return 0;
+	if ( ( output = splitter->channel_output[pmt_data->channel] ) == NULL || output->stopped )
+		return 0;
+	if ( splitter->select_mode && output->program != pmt->program_number )
+		return 0;
+	index = OutputIndex( splitter, output );
+	bit = 1ULL<<index;
+	for ( i = 1; i<0x2000; i++ )
+		if ( i != pmt_data->pid )
+			splitter->route[i] &= ~bit;
+	output->program = pmt->program_number;
+	splitter->route[ pmt->pcr_pid & 0x1fff ] |= bit;
+	for ( i = 0; i<pmt->total_stream_number; i++ )
+		splitter->route[ pmt->stream_pid[i] & 0x1fff ] |= bit;
+	splitter->route[0x1fff] &= ~bit;
+	return 1;
+}
+
+static inline void RoutePacket( MUX_SPLITTER* pSplitter, unsigned char* pPacket, ULONGLONG lRoute )
+{
+	while ( lRoute )
+	{
+		int k = LowBit( lRoute );
+		SPLIT_OUTPUT* output = pSplitter->output[k];
+		SPLIT_BLOCK* block = FillBlock( pSplitter, output );
+		memcpy( block->data+block->bytes, pPacket, pSplitter->packet_length );
+		block->bytes += pSplitter->packet_length;
+		output->in_bytes += pSplitter->packet_length;
+		if ( block->bytes >= pSplitter->block_size )
+			QueueBlock( output );
+		lRoute &= lRoute-1;
+	}
+}
+
+void* OpenMuxSplitter( int nMaxChannel, int nThreads, int nInputFormat, int nOutputFormat,
+					   DUMP pfnOutputDump, void* pOutputDumpContext )
+{
+	MUX_SPLITTER* splitter;
+	int i;
+
+	if ( nInputFormat != MPEG_TS && nInputFormat != MPEG_M2TS )
+		return NULL;
+	if ( nMaxChannel <= 0 || nMaxChannel > MAX_SPLIT_CHANNEL )
+		nMaxChannel = MAX_SPLIT_CHANNEL;
+	if ( nThreads < 0 ) nThreads = 0;
+	if ( nThreads > MAX_SPLIT_THREAD ) nThreads = MAX_SPLIT_THREAD;
+#ifndef SPLIT_THREAD
+	nThreads = 0;
+#endif
+
+	splitter = SAGETV_MALLOC( sizeof(MUX_SPLITTER) );
+	splitter->input_format  = nInputFormat;
+	splitter->output_format = nOutputFormat;
+	splitter->packet_length = nInputFormat == MPEG_M2TS ? M2TS_PACKET_LENGTH : TS_PACKET_LENGTH;
+	splitter->block_size    = splitter->packet_length*SPLIT_BLOCK_PACKETS;
+	splitter->max_channel   = nMaxChannel;
+	splitter->output_dumper = pfnOutputDump;
+	splitter->output_dumper_context = pOutputDumpContext;
+
+	splitter->ts_filter = CreateTSFilter( DEFAULT_PAT_NUM, DEFAULT_PMT_NUM, 0, 0 );
+	splitter->ts_filter->disable_stream_filter = 1;
+	splitter->ts_filter->disable_psi_parse = 1;
+	splitter->ts_filter->disable_pid_hist = 1;
+	splitter->ts_filter->dumper.pat_dumper = (DUMP)SplitPATDumper;
+	splitter->ts_filter->dumper.pat_dumper_context = splitter;
+	splitter->ts_filter->dumper.pmt_dumper = (DUMP)SplitPMTDumper;
+	splitter->ts_filter->dumper.pmt_dumper_context = splitter;
+
+	splitter->thread_num = nThreads;
+#ifdef SPLIT_THREAD
+	for ( i = 0; i<nThreads; i++ )
+	{
+		SPLIT_WORKER* worker = &splitter->worker[i];
+		pthread_mutex_init( &worker->lock, NULL );
+		pthread_cond_init( &worker->wake, NULL );
+		pthread_cond_init( &worker->done, NULL );
+		worker->running = 1;
+		if ( pthread_create( &worker->thread, NULL, SplitWorkerThread, worker ) )
+		{
+			SageLog(( _LOG_ERROR, 3, TEXT("MuxSplitter: failed to start worker %d, remux inline"), i ));
+			pthread_mutex_destroy( &worker->lock );
+			pthread_cond_destroy( &worker->wake );
+			pthread_cond_destroy( &worker->done );
+			worker->running = 0;
+			break;
+		}
+	}
+	splitter->thread_num = i;
+#else
+	(void)i;
+#endif
+
+	SageLog(( _LOG_TRACE, 3, TEXT("MuxSplitter is opened (channels:%d threads:%d)"), nMaxChannel, splitter->thread_num ));
+	return splitter;
+}
+
+int PushMuxSplitterData( void* Handle, unsigned char* pData, int nBytes )
+{
+	MUX_SPLITTER* splitter = (MUX_SPLITTER*)Handle;
+	int packet_length = splitter->packet_length;
+	int start_offset = packet_length-TS_PACKET_LENGTH;
+	int used_bytes = 0;
+
+	while ( nBytes >= packet_length )
+	{
+		unsigned char* header = pData+start_offset;
+		ULONGLONG route;
+
+		if ( *header != TS_SYNC )
+		{
+			splitter->bad_packets++;
+			while ( nBytes >= packet_length && pData[start_offset] != TS_SYNC )
+			{
+				pData++;
+				nBytes--;
+				used_bytes++;
+			}
+			continue;
+		}
+
+		TSProcess( splitter->ts_filter, header );
+		route = splitter->route[ ((header[1]&0x1f)<<8)|header[2] ];
+		if ( route )
+			RoutePacket( splitter, pData, route );
+		splitter->input_packets++;
+		pData += packet_length;
+		nBytes -= packet_length;
+		used_bytes += packet_length;
+	}
+	return used_bytes;
+}
+
+//remux everything pushed so far and flush remuxers
+void FlushMuxSplitter( void* Handle )
+{
+	MUX_SPLITTER* splitter = (MUX_SPLITTER*)Handle;
+	int i;
+	for ( i = 0; i<splitter->output_num; i++ )
+		QueueBlock( splitter->output[i] );
+#ifdef SPLIT_THREAD
+	for ( i = 0; i<splitter->thread_num; i++ )
+	{
+		SPLIT_WORKER* worker = &splitter->worker[i];
+		pthread_mutex_lock( &worker->lock );
+		while ( worker->queued > 0 || worker->busy )
+			pthread_cond_wait( &worker->done, &worker->lock );
+		pthread_mutex_unlock( &worker->lock );
+	}
+#endif
+	for ( i = 0; i<splitter->output_num; i++ )
+		FlushRemuxStream( splitter->output[i]->remuxer );
+}
+
+void CloseMuxSplitter( void* Handle )
+{
+	MUX_SPLITTER* splitter = (MUX_SPLITTER*)Handle;
+	int i;
+
+	for ( i = 0; i<splitter->output_num; i++ )
+		QueueBlock( splitter->output[i] );
+#ifdef SPLIT_THREAD
+	for ( i = 0; i<splitter->thread_num; i++ )
+	{
+		SPLIT_WORKER* worker = &splitter->worker[i];
+		pthread_mutex_lock( &worker->lock );
+		worker->stop = 1;
+		pthread_cond_signal( &worker->wake );
+		pthread_mutex_unlock( &worker->lock );
+		pthread_join( worker->thread, NULL );
+		pthread_mutex_destroy( &worker->lock );
+		pthread_cond_destroy( &worker->wake );
+		pthread_cond_destroy( &worker->done );
+	}
+#endif
+	//workers have remuxed every queued block before they quit, what is left in remuxers goes out as
+	//FlushMuxSplitter does; a stopped output was flushed when it was deselected
+	for ( i = 0; i<splitter->output_num; i++ )
+	{
+		SPLIT_OUTPUT* output = splitter->output[i];
+		if ( !output->stopped )
+			FlushRemuxStream( output->remuxer );
+		CloseRemuxStream( output->remuxer );
+		ReleaseBlocks( output->free_list );
+		ReleaseBlocks( output->fill );
+		SAGETV_FREE( output );
+	}
+	ReleaseTSFilter( splitter->ts_filter );
+	SageLog(( _LOG_TRACE, 3, TEXT("MuxSplitter is closed (packets:%s bad:%s)"),
+		      long_long_ss( splitter->input_packets ), long_long_ss( splitter->bad_packets ) ));
+	SAGETV_FREE( splitter );
+}
+
+int SelectMuxSplitterProgram( void* Handle, unsigned short nProgram )
+{
+	MUX_SPLITTER* splitter = (MUX_SPLITTER*)Handle;
+	SPLIT_OUTPUT* output;
+
+	if ( nProgram == 0 )
+		return 0;
+	splitter->select_mode = 1;
+	if ( !ProgramSelected( splitter, nProgram ) )
+	{
+		if ( splitter->select_num >= MAX_SPLIT_CHANNEL )
+			return 0;
+		splitter->select_program[splitter->select_num++] = nProgram;
+	}
+
+	//restart a deselected one from a clean remuxer
+	if ( ( output = ProgramOutput( splitter, nProgram ) ) != NULL && output->stopped )
+	{
+		TuneSplitOutput( output, output->channel );
+		output->stopped = 0;
+		splitter->route[0] |= 1ULL<<OutputIndex( splitter, output );
+	}
+	RoutePAT( splitter );
+	SageLog(( _LOG_TRACE, 3, TEXT("MuxSplitter: program %d selected"), nProgram ));
+	return 1;
+}
+
+void DeselectMuxSplitterProgram( void* Handle, unsigned short nProgram )
+{
+	MUX_SPLITTER* splitter = (MUX_SPLITTER*)Handle;
+	SPLIT_OUTPUT* output;
+	int i;
+
+	for ( i = 0; i<splitter->select_num; i++ )
+	{
+		if ( splitter->select_program[i] == nProgram )
+		{
+			splitter->select_program[i] = splitter->select_program[--splitter->select_num];
+			break;
+		}
+	}
+
+	if ( ( output = ProgramOutput( splitter, nProgram ) ) != NULL && !output->stopped )
+	{
+		ULONGLONG bit = 1ULL<<OutputIndex( splitter, output );
+		for ( i = 0; i<0x2000; i++ )
+			splitter->route[i] &= ~bit;
+		output->pmt_pid = 0;
+		output->stopped = 1;
+		if ( splitter->channel_output[output->channel] == output )
+			splitter->channel_output[output->channel] = NULL;
+		DrainSplitOutput( output );
+		FlushRemuxStream( output->remuxer );
+		SageLog(( _LOG_TRACE, 3, TEXT("MuxSplitter: program %d stopped (channel %d)"), nProgram, output->channel ));
+	}
+}
+
+int MuxSplitterChannelNum( void* Handle )
+{
+	MUX_SPLITTER* splitter = (MUX_SPLITTER*)Handle;
+	return splitter->output_num;
+}
+
+ULONGLONG MuxSplitterChannelBytes( void* Handle, int nChannel )
+{
+	MUX_SPLITTER* splitter = (MUX_SPLITTER*)Handle;
+	if ( nChannel <= 0 || nChannel > MAX_SPLIT_CHANNEL || splitter->channel_output[nChannel] == NULL )
+		return 0;
+	return splitter->channel_output[nChannel]->in_bytes;
+}
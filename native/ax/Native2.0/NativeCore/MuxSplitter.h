@@ -0,0 +1,59 @@
+/*
+ * Copyright 2015 The SageTV Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MUX_SPLITTER_H
+#define MUX_SPLITTER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MAX_SPLIT_CHANNEL  64
+#define MAX_SPLIT_THREAD   16
+
+//data of a channel passed to the output dumper, nSize is sizeof(MUX_OUTPUT_DATA)
+typedef struct MUX_OUTPUT_DATA
+{
+	unsigned short channel;   //1 based, order of PMT in PAT as TUNE.channel
+	unsigned short program;   //program number, 0 till its PMT is seen
+	unsigned char* data_ptr;
+	int  bytes;
+} MUX_OUTPUT_DATA;
+
+//full mux splitter: packets of a mux are classified once on the pushing thread (PAT/PMT and pid routing),
+//every program gets its own remuxer that runs on one of nThreads workers. Channels 1..nMaxChannel found in
+//PAT get an output. With nThreads of 0 all remuxing is done inside PushMuxSplitterData. The output dumper is
+//called on worker threads, data of a channel always come from the same thread.
+void* OpenMuxSplitter( int nMaxChannel, int nThreads, int nInputFormat, int nOutputFormat,
+					   DUMP pfnOutputDump, void* pOutputDumpContext );
+int   PushMuxSplitterData( void* Handle, unsigned char* pData, int nBytes );
+void  FlushMuxSplitter( void* Handle );
+void  CloseMuxSplitter( void* Handle );
+//record selected programs only. After the first select a channel in PAT gets an output when its program is selected,
+//an output follows its program when PAT moves it to another channel. 0 when MAX_SPLIT_CHANNEL programs are selected.
+int   SelectMuxSplitterProgram( void* Handle, unsigned short nProgram );
+//stop a program, what was pushed for it is remuxed and its remuxer flushed before it returns. Selecting it again
+//restarts it on a reset remuxer.
+void  DeselectMuxSplitterProgram( void* Handle, unsigned short nProgram );
+int   MuxSplitterChannelNum( void* Handle );
+//bytes fed into the remuxer of a channel
+ULONGLONG MuxSplitterChannelBytes( void* Handle, int nChannel );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -87,6 +87,7 @@ typedef LONGLONG REFERENCE_TIME;
 #include <unistd.h>
 #include <memory.h>	
 #include <stdlib.h>
+#include <sys/uio.h>
 
 #define TEXT( x )	x
 #define snprintf snprintf
@@ -121,6 +122,7 @@ typedef ULONGLONG REFERENCE_TIME;
 #include <assert.h>
 #include "NativeMemory.h"
 #include "AVTrack.h"
+#include "StartCodeScan.h"
 #include "AVFormat/MpegVideoFormat.h"
 #include "AVFormat/VC1Format.h"
 #include "AVFormat/H264Format.h"
@@ -508,6 +510,31 @@ typedef struct OUTPUT_DATA
 	unsigned long  fourcc;
 } OUTPUT_DATA;
 
+//a slice of output data, it's struct iovec on Linux, a chain of slices can be passed to writev/pwritev as it is
+#ifdef WIN32
+typedef struct DATA_IOV
+{
+	void*  iov_base;
+	size_t iov_len;
+} DATA_IOV;
+#else
+typedef struct iovec DATA_IOV;
+#endif
+
+#define MAX_OUTPUT_IOV	4
+//scatter-gather output of a packet (header, payload, padding slices) instead of copying them together.
+//Slices point into block, a consumer may HoldBlockBuffer(block) to keep them after the dumper returns and
+//DropBlockBuffer(block) once they are written; with a NULL block slices are valid only inside the dumper.
+typedef struct OUTPUT_IOV
+{
+	DATA_IOV iov[MAX_OUTPUT_IOV];
+	unsigned short iov_num;
+	unsigned short group_flag;
+	unsigned long  bytes;
+	unsigned long  fourcc;
+	struct BLOCK_BUFFER* block;
+} OUTPUT_IOV;
+
 typedef struct DATA_BUFFER
 {
 	unsigned short  data_bytes;
@@ -555,6 +582,10 @@ struct DEMUXER* GetDemuxer( void* Handle );
 int GetAVFormat(  char* pFileName, unsigned long nCheckMaxiumSize, int bStreamData, 
 			   int nRequestedTSChannel,   char* pFormatBuf, int nFormatSize, char* pDurationBuf, 
 			   int DurationSize, int* nTotalChannel );
+void* OpenAVProbe( char* pFileName, unsigned long nCheckMaxiumSize, int bStreamData );
+int   GetProbeAVFormat( void* Handle, int nIndex, char* pFormatBuf, int nFormatSize, char* pDurationBuf,
+					    int nDurationBufSize, int* nTotalChannel );
+void  CloseAVProbe( void* Handle );
 char* _data_alignment_check_( char* buf, int buf_size );
 char* _access_alignment_check_( char* buf, int buf_len );
 
@@ -18,8 +18,8 @@
 #include <stdlib.h>
 #include <memory.h>
 #include <string.h>
-#include "NativeMemory.h"
 #include "NativeCore.h"
+#include "NativeMemory.h"
 
 ////ZQ remove ME
 //int  _mem_error_flag = 0;
@@ -302,6 +302,20 @@ char* sagetv_mem_inf( int loc, char *buf, int buf_size )
 	return buf;
 }
 
+//release build counters and arenas only
+int SageMemoryStat( int nTag, MEM_STAT* pStat )
+{
+	memset( pStat, 0, sizeof(MEM_STAT) );
+	return nTag >= 0 && nTag < MEM_TAG_NUM;
+}
+long SageMemoryArenaBytes( )	{ return 0; }
+struct MEM_ARENA* CreateMemArena( const char* pName ) { return NULL; }
+void  ReleaseMemArena( struct MEM_ARENA* pArena ) { }
+void  ResetMemArena( struct MEM_ARENA* pArena ) { }
+struct MEM_ARENA* SageMemArenaEnter( struct MEM_ARENA* pArena ) { return NULL; }
+void  SageMemArenaLeave( struct MEM_ARENA* pPrevArena ) { }
+int   SageMemArenaEnable( int bEnable ) { return 0; }
+
 #else
 void* sagetv_malloc2( int size, int line )
 {
@@ -332,17 +346,455 @@ void  sagetv_free2( void* p, int line )
 	free( p );
 }
 
+///////////////////////////////////////////////////////////////////////////////////////////////////
+//every block has a header with its tag and size for per tag counters, a block of an arena slab
+//finds its arena through the slab that is aligned on MEM_SLAB_SIZE.
+#ifdef WIN32
+#include <windows.h>
+#define MEM_TLS					__declspec(thread)
+#define MEM_ATOMIC_ADD( p, v )	InterlockedExchangeAdd( (volatile LONG*)(p), (LONG)(v) )
+#define MEM_ATOMIC_CAS( p, o, n ) ( InterlockedCompareExchange( (volatile LONG*)(p), (LONG)(n), (LONG)(o) ) == (LONG)(o) )
+typedef CRITICAL_SECTION MEM_LOCK;
+#define MEM_LOCK_INIT( l )		InitializeCriticalSection( l )
+#define MEM_LOCK_DESTROY( l )	DeleteCriticalSection( l )
+#define MEM_LOCKING( l )		EnterCriticalSection( l )
+#define MEM_UNLOCKING( l )		LeaveCriticalSection( l )
+#define MEM_SLAB_ALLOC( n )		_aligned_malloc( n, n )
+#define MEM_SLAB_FREE( p )		_aligned_free( p )
+#else
+#include <pthread.h>
+#define MEM_TLS					__thread
+#define MEM_ATOMIC_ADD( p, v )	__sync_fetch_and_add( (p), (v) )
+#define MEM_ATOMIC_CAS( p, o, n ) __sync_bool_compare_and_swap( (p), (o), (n) )
+typedef pthread_mutex_t MEM_LOCK;
+#define MEM_LOCK_INIT( l )		pthread_mutex_init( l, NULL )
+#define MEM_LOCK_DESTROY( l )	pthread_mutex_destroy( l )
+#define MEM_LOCKING( l )		pthread_mutex_lock( l )
+#define MEM_UNLOCKING( l )		pthread_mutex_unlock( l )
+static void* MEM_SLAB_ALLOC( int n )
+{
+	void* p;
+	return posix_memalign( &p, n, n ) ? NULL : p;
+}
+#define MEM_SLAB_FREE( p )		free( p )
+#endif
+
+#define MEM_MAGIC_HEAP   0x5a
+#define MEM_MAGIC_SLAB   0xa5
+#define MEM_MAGIC_FREE   0xfe
+
+#define MEM_SLAB_SIZE    (64*1024)
+#define MEM_SLAB_HEAD    32
+#define MEM_MIN_CLASS    32
+#define MEM_CLASS_NUM    8			//32 ... 4096 bytes
+
+typedef struct MEM_HEADER
+{
+	unsigned short tag;
+	unsigned char  magic;
+	unsigned char  size_class;
+	int            size;
+	union {
+		struct MEM_HEADER* next;	//free list link of a slab block
+		ULONGLONG  align;
+	} u;
+} MEM_HEADER;
+
+typedef struct MEM_SLAB
+{
+	struct MEM_ARENA* arena;
+	struct MEM_SLAB*  next;
+	int size_class;
+	int used;
+} MEM_SLAB;
+
+typedef struct MEM_ARENA
+{
+	MEM_HEADER* free_list[MEM_CLASS_NUM];
+	MEM_SLAB*   slab_list[MEM_CLASS_NUM];
+	long  live;					//blocks out of the arena, owner only till closed
+	long  slab_num;
+	volatile long owner;		//id of the thread inside the arena, 0 when none is
+	int   depth;				//nested enters of the owner
+	MEM_LOCK lock;				//remote free list and close
+	MEM_HEADER* remote_list;
+	int   closed;
+	char  name[16];
+} MEM_ARENA;
+
+typedef struct MEM_TAG_COUNTER
+{
+	volatile long bytes;
+	volatile long objects;
+	volatile long peak_bytes;
+	volatile unsigned long allocs;
+	char padding[64-4*sizeof(long)];	//a cache line each
+} MEM_TAG_COUNTER;
+
+static MEM_TAG_COUNTER _mem_counter[MEM_TAG_NUM];
+static volatile long _mem_arena_bytes = 0;
+static int _mem_arena_enable = 0;				//off unless SageMemArenaEnable turns it on
+static MEM_TLS MEM_ARENA* _mem_arena = NULL;	//arena entered on this thread, owned by it
+static MEM_TLS long _mem_thread_id = 0;
+static volatile long _mem_thread_seq = 0;
+
+#define MEM_SLAB_OF( p )  ((MEM_SLAB*)((size_t)(p) & ~(size_t)(MEM_SLAB_SIZE-1)))
+#define MEM_CLASS_SIZE( c ) (MEM_MIN_CLASS<<(c))
+
+static void CountAlloc( int nTag, int nSize )
+{
+	MEM_TAG_COUNTER* counter = &_mem_counter[nTag];
+	long bytes = MEM_ATOMIC_ADD( &counter->bytes, nSize ) + nSize;
+	MEM_ATOMIC_ADD( &counter->objects, 1 );
+	MEM_ATOMIC_ADD( &counter->allocs, 1 );
+	if ( bytes > counter->peak_bytes )
+		counter->peak_bytes = bytes;
+}
+
+static void CountFree( int nTag, int nSize )
+{
+	MEM_TAG_COUNTER* counter = &_mem_counter[nTag];
+	MEM_ATOMIC_ADD( &counter->bytes, -nSize );
+	MEM_ATOMIC_ADD( &counter->objects, -1 );
+}
+
+static int SizeClass( int nSize )
+{
+	int c = 0;
+	while ( c < MEM_CLASS_NUM && MEM_CLASS_SIZE(c) < nSize )
+		c++;
+	return c;
+}
+
+static int NewSlab( MEM_ARENA* pArena, int nClass )
+{
+	int stride = sizeof(MEM_HEADER)+MEM_CLASS_SIZE(nClass);
+	int i, num = (MEM_SLAB_SIZE-MEM_SLAB_HEAD)/stride;
+	MEM_SLAB* slab = (MEM_SLAB*)MEM_SLAB_ALLOC( MEM_SLAB_SIZE );
+	unsigned char* p;
+	if ( slab == NULL )
+		return 0;
+	slab->arena = pArena;
+	slab->size_class = nClass;
+	slab->used = 0;
+	slab->next = pArena->slab_list[nClass];
+	pArena->slab_list[nClass] = slab;
+	pArena->slab_num++;
+	MEM_ATOMIC_ADD( &_mem_arena_bytes, MEM_SLAB_SIZE );
+
+	p = (unsigned char*)slab + MEM_SLAB_HEAD + (num-1)*stride;
+	for ( i = 0; i<num; i++, p -= stride )
+	{
+		MEM_HEADER* block = (MEM_HEADER*)p;
+		block->magic = MEM_MAGIC_FREE;
+		block->size_class = nClass;
+		block->u.next = pArena->free_list[nClass];
+		pArena->free_list[nClass] = block;
+	}
+	return 1;
+}
+
+static void FreeToArena( MEM_ARENA* pArena, MEM_HEADER* pBlock )
+{
+	int c = pBlock->size_class;
+	MEM_SLAB_OF( pBlock )->used--;
+	pBlock->magic = MEM_MAGIC_FREE;
+	pBlock->u.next = pArena->free_list[c];
+	pArena->free_list[c] = pBlock;
+	pArena->live--;
+}
+
+//take back blocks freed on other threads
+static void DrainRemoteFree( MEM_ARENA* pArena )
+{
+	MEM_HEADER* block;
+	if ( pArena->remote_list == NULL )
+		return;
+	MEM_LOCKING( &pArena->lock );
+	block = pArena->remote_list;
+	pArena->remote_list = NULL;
+	MEM_UNLOCKING( &pArena->lock );
+	while ( block != NULL )
+	{
+		MEM_HEADER* next = block->u.next;
+		FreeToArena( pArena, block );
+		block = next;
+	}
+}
+
+static void DestroyArena( MEM_ARENA* pArena )
+{
+	int c;
+	for ( c = 0; c<MEM_CLASS_NUM; c++ )
+	{
+		MEM_SLAB* slab = pArena->slab_list[c];
+		while ( slab != NULL )
+		{
+			MEM_SLAB* next = slab->next;
+			MEM_SLAB_FREE( slab );
+			slab = next;
+		}
+	}
+	MEM_ATOMIC_ADD( &_mem_arena_bytes, -pArena->slab_num*MEM_SLAB_SIZE );
+	MEM_LOCK_DESTROY( &pArena->lock );
+	free( pArena );
+}
+
+static long MemThreadId( )
+{
+	if ( _mem_thread_id == 0 )
+		_mem_thread_id = MEM_ATOMIC_ADD( &_mem_thread_seq, 1 ) + 1;
+	return _mem_thread_id;
+}
+
+//the free lists are used without lock by the thread that owns the arena, another thread
+//can't take it till the owner leaves
+static int ArenaAcquire( MEM_ARENA* pArena )
+{
+	long id = MemThreadId( );
+	if ( pArena->owner != id && !MEM_ATOMIC_CAS( &pArena->owner, 0, id ) )
+		return 0;
+	pArena->depth++;
+	return 1;
+}
+
+static void ArenaRelease( MEM_ARENA* pArena )
+{
+	if ( --pArena->depth == 0 )
+		MEM_ATOMIC_CAS( &pArena->owner, pArena->owner, 0 );
+}
+
+static MEM_HEADER* ArenaAlloc( MEM_ARENA* pArena, int nClass )
+{
+	MEM_HEADER* block = pArena->free_list[nClass];
+	if ( block == NULL )
+	{
+		DrainRemoteFree( pArena );
+		if ( ( block = pArena->free_list[nClass] ) == NULL )
+		{
+			if ( !NewSlab( pArena, nClass ) )
+				return NULL;
+			block = pArena->free_list[nClass];
+		}
+	}
+	pArena->free_list[nClass] = block->u.next;
+	MEM_SLAB_OF( block )->used++;
+	pArena->live++;
+	block->magic = MEM_MAGIC_SLAB;
+	return block;
+}
+
+void* sagetv_malloc_tag( int size, int tag )
+{
+	MEM_HEADER* block = NULL;
+	MEM_ARENA* arena = _mem_arena;
+	if ( size < 0 )
+		return NULL;
+	if ( (unsigned int)tag >= MEM_TAG_NUM )
+		tag = MEM_TAG_MISC;
+
+	if ( arena != NULL && size <= MEM_CLASS_SIZE(MEM_CLASS_NUM-1) )
+		block = ArenaAlloc( arena, SizeClass( size ) );
+	if ( block == NULL )
+	{
+		block = (MEM_HEADER*)malloc( sizeof(MEM_HEADER)+size );
+		if ( block == NULL )
+			return NULL;
+		block->magic = MEM_MAGIC_HEAP;
+	}
+	block->tag  = tag;
+	block->size = size;
+	memset( block+1, 0, size );
+	CountAlloc( tag, size );
+	return (void*)(block+1);
+}
+
 void* sagetv_malloc( int size )
 {
-	char* p = (char*)malloc( size );
-	if ( p ) memset( p, 0, size );
-	return (void*)p; 
+	return sagetv_malloc_tag( size, MEM_TAG_MISC );
 }
 
 void  sagetv_free( void* p )
 {
-	free( p );
+	MEM_HEADER* block;
+	MEM_ARENA* arena;
+	int destroy = 0;
+	if ( p == NULL )
+		return;
+	block = (MEM_HEADER*)p - 1;
+	if ( block->magic == MEM_MAGIC_HEAP )
+	{
+		CountFree( block->tag, block->size );
+		block->magic = MEM_MAGIC_FREE;
+		free( block );
+		return;
+	}
+	if ( block->magic != MEM_MAGIC_SLAB )
+	{
+		char buf[128];
+		snprintf( buf, sizeof(buf), "Try to free unknown or freed memory block 0x%p", p );
+		SageLog(( _LOG_ERROR, 1, TEXT("%s"), buf ));
+		_log_error( buf );
+		return;
+	}
+
+	CountFree( block->tag, block->size );
+	arena = MEM_SLAB_OF( block )->arena;
+	if ( arena == _mem_arena )
+	{
+		FreeToArena( arena, block );
+		return;
+	}
+
+	MEM_LOCKING( &arena->lock );
+	if ( arena->closed )
+	{
+		block->magic = MEM_MAGIC_FREE;
+		destroy = --arena->live == 0;
+	} else
+	{
+		block->u.next = arena->remote_list;
+		arena->remote_list = block;
+	}
+	MEM_UNLOCKING( &arena->lock );
+	if ( destroy )
+		DestroyArena( arena );
+}
+
+struct MEM_ARENA* CreateMemArena( const char* pName )
+{
+	MEM_ARENA* arena;
+	if ( !_mem_arena_enable )
+		return NULL;
+	arena = (MEM_ARENA*)malloc( sizeof(MEM_ARENA) );
+	if ( arena == NULL )
+		return NULL;
+	memset( arena, 0, sizeof(MEM_ARENA) );
+	MEM_LOCK_INIT( &arena->lock );
+	strncpy( arena->name, pName, sizeof(arena->name)-1 );
+	return arena;
+}
+
+void ReleaseMemArena( struct MEM_ARENA* pArena )
+{
+	int destroy;
+	if ( pArena == NULL )
+		return;
+	if ( _mem_arena == pArena )
+		_mem_arena = NULL;
+	MEM_LOCKING( &pArena->lock );
+	pArena->closed = 1;
+	while ( pArena->remote_list != NULL )
+	{
+		pArena->remote_list->magic = MEM_MAGIC_FREE;
+		pArena->remote_list = pArena->remote_list->u.next;
+		pArena->live--;
+	}
+	destroy = pArena->live == 0;
+	MEM_UNLOCKING( &pArena->lock );
+	if ( destroy )
+		DestroyArena( pArena );
+	else
+		SageLog(( _LOG_TRACE, 3, TEXT("Memory arena %s released with %d blocks in use"), pArena->name, pArena->live ));
 }
+
+//return slabs without blocks in use to the system
+void ResetMemArena( struct MEM_ARENA* pArena )
+{
+	int c, freed = 0;
+	//it's left as it is while another thread is inside
+	if ( pArena == NULL || !ArenaAcquire( pArena ) )
+		return;
+	DrainRemoteFree( pArena );
+	for ( c = 0; c<MEM_CLASS_NUM; c++ )
+	{
+		MEM_HEADER **link = &pArena->free_list[c];
+		MEM_SLAB **slab_link = &pArena->slab_list[c];
+		while ( *link != NULL )
+		{
+			if ( MEM_SLAB_OF( *link )->used == 0 )
+				*link = (*link)->u.next;
+			else
+				link = &(*link)->u.next;
+		}
+		while ( *slab_link != NULL )
+		{
+			MEM_SLAB* slab = *slab_link;
+			if ( slab->used == 0 )
+			{
+				*slab_link = slab->next;
+				MEM_SLAB_FREE( slab );
+				freed++;
+			} else
+				slab_link = &slab->next;
+		}
+	}
+	pArena->slab_num -= freed;
+	MEM_ATOMIC_ADD( &_mem_arena_bytes, -freed*MEM_SLAB_SIZE );
+	ArenaRelease( pArena );
+}
+
+//an arena another thread is inside isn't entered, blocks come from the heap till it's left
+struct MEM_ARENA* SageMemArenaEnter( struct MEM_ARENA* pArena )
+{
+	MEM_ARENA* prev = _mem_arena;
+	if ( pArena != NULL && !ArenaAcquire( pArena ) )
+		pArena = NULL;
+	_mem_arena = pArena;
+	return prev;
+}
+
+void SageMemArenaLeave( struct MEM_ARENA* pPrevArena )
+{
+	if ( _mem_arena != NULL )
+		ArenaRelease( _mem_arena );
+	_mem_arena = pPrevArena;
+}
+
+int SageMemArenaEnable( int bEnable )
+{
+	int prev = _mem_arena_enable;
+	_mem_arena_enable = bEnable;
+	return prev;
+}
+
+int SageMemoryStat( int nTag, MEM_STAT* pStat )
+{
+	if ( nTag < 0 || nTag >= MEM_TAG_NUM )
+		return 0;
+	pStat->bytes      = _mem_counter[nTag].bytes;
+	pStat->objects    = _mem_counter[nTag].objects;
+	pStat->peak_bytes = _mem_counter[nTag].peak_bytes;
+	pStat->allocs     = _mem_counter[nTag].allocs;
+	return 1;
+}
+
+long SageMemoryArenaBytes( )
+{
+	return _mem_arena_bytes;
+}
+
 #endif
 
+const char* SageMemoryTagName( int nTag )
+{
+	static const char* name[MEM_TAG_NUM] = { "misc", "section", "desc", "epg", "psi" };
+	if ( nTag < 0 || nTag >= MEM_TAG_NUM )
+		return "";
+	return name[nTag];
+}
+
+void SageMemoryStatReport( )
+{
+	int i;
+	for ( i = 0; i<MEM_TAG_NUM; i++ )
+	{
+		MEM_STAT stat={0};
+		SageMemoryStat( i, &stat );
+		SageLog(( _LOG_TRACE, 3, TEXT("Memory %-8s bytes:%ld blocks:%ld peak:%ld allocs:%lu"), SageMemoryTagName(i),
+			      stat.bytes, stat.objects, stat.peak_bytes, stat.allocs ));
+	}
+	SageLog(( _LOG_TRACE, 3, TEXT("Memory arena slabs:%ld"), SageMemoryArenaBytes() ));
+}
+
 
@@ -27,6 +27,41 @@ extern "C" {
 #endif
 
 
+//allocation tags, every SAGETV_MALLOC block is counted under its tag, SAGETV_MALLOC is MEM_TAG_MISC
+#define MEM_TAG_MISC     0
+#define MEM_TAG_SECTION  1		//TS_SECTION and section data
+#define MEM_TAG_DESC     2		//DESC_DATA buffers
+#define MEM_TAG_EPG      3		//EIT events and EPG strings
+#define MEM_TAG_PSI      4		//NIT, SDT, VCT tables of PSI parsers
+#define MEM_TAG_NUM      5
+
+typedef struct MEM_STAT
+{
+	long bytes;				//bytes in use
+	long objects;			//blocks in use
+	long peak_bytes;		//approximate when several threads allocate the tag at same time
+	unsigned long allocs;	//total allocations
+} MEM_STAT;
+
+//counters are kept in release builds, a MEMORY_CHECK build has its own tracking and reports zero
+int   SageMemoryStat( int nTag, MEM_STAT* pStat );
+const char* SageMemoryTagName( int nTag );
+long  SageMemoryArenaBytes( );		//slab memory held by all arenas
+void  SageMemoryStatReport( );		//log counters of all tags
+
+//size class slab arena. Blocks up to 4K that are allocated while an arena is entered on a thread come from
+//its slabs; a block can be freed on any thread at any time, a free on other thread than the one inside the
+//arena goes to a locked list the owner takes back later. An arena is entered by one thread at a time, a
+//thread that enters it while another one is inside allocates from the heap instead. ResetMemArena returns
+//empty slabs to the system; a released arena stays till its last block is freed. Arenas are off by default.
+struct MEM_ARENA;
+struct MEM_ARENA* CreateMemArena( const char* pName );	//NULL when arenas are disabled
+void  ReleaseMemArena( struct MEM_ARENA* pArena );
+void  ResetMemArena( struct MEM_ARENA* pArena );
+struct MEM_ARENA* SageMemArenaEnter( struct MEM_ARENA* pArena );	//returns the arena to pass to SageMemArenaLeave
+void  SageMemArenaLeave( struct MEM_ARENA* pPrevArena );
+int   SageMemArenaEnable( int bEnable );	//returns previous setting, applies to arenas created after it
+
 #ifdef MEMORY_CHECK
 void* sagetv_malloc1( int size, int line, char* filename );
 void  sagetv_free1( void* p, int line, char* filename );
@@ -36,15 +71,18 @@ void  MemoryTrack( );
 #define MEMORY_TRACK()  MemoryTrack( )
 /*************************************************************/
 #define SAGETV_MALLOC( x )		sagetv_malloc1( x, __LINE__, __FILE__ )
+#define SAGETV_MALLOC_TAG( x, t ) sagetv_malloc1( x, __LINE__, __FILE__ )
 #define SAGETV_FREE( x )		sagetv_free1( x,  __LINE__, __FILE__ )
 /*************************************************************/
 #else
 void* sagetv_malloc( int size );
+void* sagetv_malloc_tag( int size, int tag );
 void  sagetv_free( void* p );
 #define MEMORY_REPORT() 
 #define MEMORY_TRACK()  
 /*************************************************************/
-#define SAGETV_MALLOC( x )		sagetv_malloc( x  )
+#define SAGETV_MALLOC( x )		sagetv_malloc_tag( x, MEM_TAG_MISC )
+#define SAGETV_MALLOC_TAG( x, t ) sagetv_malloc_tag( x, t )
 #define SAGETV_FREE( x )		sagetv_free( x  )
 /*************************************************************/
 #endif
@@ -118,6 +118,24 @@ int BlockBufferPSDump( void* pContext, void* pData, int nSize )
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////
+//dump contiguous data, a consumer of OUTPUT_IOV gets it as a single slice, pBlockBuffer is the block holding it
+void PSBuilderOutputData( PS_BUILDER *pPSBuilder, OUTPUT_DATA* pOutputData, BLOCK_BUFFER* pBlockBuffer )
+{
+	if ( pPSBuilder->dumper.iov_dumper != NULL )
+	{
+		OUTPUT_IOV output_iov;
+		output_iov.iov[0].iov_base = pOutputData->data_ptr;
+		output_iov.iov[0].iov_len  = pOutputData->bytes;
+		output_iov.iov_num    = 1;
+		output_iov.bytes      = pOutputData->bytes;
+		output_iov.group_flag = pOutputData->group_flag;
+		output_iov.fourcc     = pOutputData->fourcc;
+		output_iov.block      = pBlockBuffer;
+		pPSBuilder->dumper.iov_dumper( pPSBuilder->dumper.iov_dumper_context, &output_iov, sizeof(output_iov) );
+	} else
+		pPSBuilder->dumper.stream_dumper( pPSBuilder->dumper.stream_dumper_context, pOutputData, sizeof(OUTPUT_DATA) );
+}
+
 int PSBulderPushDataInSafe( PS_BUILDER *pPSBuilder, int nTrackIndex, int bGroup, unsigned char* pData, int nSize )
 {
 	OUTPUT_DATA output_data={0};
@@ -156,16 +174,44 @@ int PSBulderPushDataInSafe( PS_BUILDER *pPSBuilder, int nTrackIndex, int bGroup,
 		ASSERT( bytes == header_bytes );
 		es_elmnt.pes.has_pts = es_elmnt.pes.has_dts = 0;
 
-		//dump header (PACK+PES)
-		output_data.data_ptr = buf;
-		output_data.bytes = bytes;
-		pPSBuilder->dumper.stream_dumper( pPSBuilder->dumper.stream_dumper_context, &output_data, sizeof(output_data) );
-		pPSBuilder->output_bytes += bytes;
+		if ( pPSBuilder->dumper.iov_dumper != NULL )
+		{
+			//header, content and padding of the last block go out as one chain
+			OUTPUT_IOV output_iov;
+			int len = 0;
+			output_iov.iov[0].iov_base = buf;
+			output_iov.iov[0].iov_len  = bytes;
+			output_iov.iov[1].iov_base = pData+used_bytes;
+			output_iov.iov[1].iov_len  = content_bytes;
+			output_iov.iov_num = 2;
+			if ( pPSBuilder->pading_block_enable && used_bytes+content_bytes >= nSize &&
+				 ( len = pPSBuilder->buffer_size - header_bytes - content_bytes ) > 0 )
+			{
+				BuildPadBufferHeader( (char*)pPSBuilder->block_buffer, len );
+				output_iov.iov[2].iov_base = pPSBuilder->block_buffer;
+				output_iov.iov[2].iov_len  = len;
+				output_iov.iov_num = 3;
+			} else
+				len = 0;
+			output_iov.bytes      = bytes+content_bytes+len;
+			output_iov.group_flag = output_data.group_flag;
+			output_iov.fourcc     = output_data.fourcc;
+			output_iov.block      = NULL;
+			pPSBuilder->dumper.iov_dumper( pPSBuilder->dumper.iov_dumper_context, &output_iov, sizeof(output_iov) );
+			pPSBuilder->output_bytes += bytes+len;
+		} else
+		{
+			//dump header (PACK+PES)
+			output_data.data_ptr = buf;
+			output_data.bytes = bytes;
+			pPSBuilder->dumper.stream_dumper( pPSBuilder->dumper.stream_dumper_context, &output_data, sizeof(output_data) );
+			pPSBuilder->output_bytes += bytes;
 
-		//dump PES data of a block (content only)
-		output_data.data_ptr = pData+used_bytes;
-		output_data.bytes = content_bytes;
-		pPSBuilder->dumper.stream_dumper( pPSBuilder->dumper.stream_dumper_context, &output_data, sizeof(output_data) );
+			//dump PES data of a block (content only)
+			output_data.data_ptr = pData+used_bytes;
+			output_data.bytes = content_bytes;
+			pPSBuilder->dumper.stream_dumper( pPSBuilder->dumper.stream_dumper_context, &output_data, sizeof(output_data) );
+		}
 
 		used_bytes += content_bytes;
 		pPSBuilder->output_bytes += content_bytes;
@@ -173,7 +219,7 @@ int PSBulderPushDataInSafe( PS_BUILDER *pPSBuilder, int nTrackIndex, int bGroup,
 		track->es_blocks_counter++;
 	}
 
-	if ( pPSBuilder->pading_block_enable )
+	if ( pPSBuilder->pading_block_enable && pPSBuilder->dumper.iov_dumper == NULL )
 	{
 		int len = pPSBuilder->buffer_size - header_bytes - content_bytes;
 		if ( len > 0 )
@@ -246,7 +292,7 @@ int PSBulderPushDataInBuffer( PS_BUILDER *pPSBuilder, int nTrackIndex, int bGrou
 			output_data.data_ptr = pBlockBuffer->buffer_start;
 			output_data.bytes = used_bytes+content_bytes+pading_bytes;
 			output_data.start_offset = pading_bytes;
-			pPSBuilder->dumper.stream_dumper( pPSBuilder->dumper.stream_dumper_context, &output_data, sizeof(output_data) );
+			PSBuilderOutputData( pPSBuilder, &output_data, pBlockBuffer );
 			pPSBuilder->output_bytes += bytes+content_bytes+pading_bytes;
 		} else
 		{
@@ -254,7 +300,7 @@ int PSBulderPushDataInBuffer( PS_BUILDER *pPSBuilder, int nTrackIndex, int bGrou
 			ASSERT( p+used_bytes == pBlockBuffer->data_start );
 			output_data.data_ptr = p;
 			output_data.bytes = used_bytes+content_bytes;
-			pPSBuilder->dumper.stream_dumper( pPSBuilder->dumper.stream_dumper_context, &output_data, sizeof(output_data) );
+			PSBuilderOutputData( pPSBuilder, &output_data, pBlockBuffer );
 			pPSBuilder->output_bytes += bytes+content_bytes;
 		}
 		//used_bytes += content_bytes;
@@ -342,6 +388,7 @@ void ResetPSBuilder( PS_BUILDER *pPSBuilder )
 {
 	pPSBuilder->used_bytes = 0;
 	pPSBuilder->output_bytes = 0;
+	pPSBuilder->copy_bytes = 0;
 	pPSBuilder->input_blocks = 0;
 	pPSBuilder->output_blocks = 0;
 	pPSBuilder->out_of_order_blocks = 0;
@@ -359,7 +406,7 @@ int FlushEndOfCode( PS_BUILDER *pPSBuilder )
 		//output_data.track = &pPSBuilder->tracks->track[0];
 		output_data.data_ptr = buf;
 		output_data.bytes = 4;
-		pPSBuilder->dumper.stream_dumper( pPSBuilder->dumper.stream_dumper_context, &output_data, sizeof(output_data) );
+		PSBuilderOutputData( pPSBuilder, &output_data, NULL );
 
 		pPSBuilder->output_bytes += 4;
 		pPSBuilder->output_blocks++;
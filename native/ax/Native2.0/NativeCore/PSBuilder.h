@@ -31,6 +31,8 @@ typedef struct PS_BUILDER_DUMPER
 {
 	DUMP  stream_dumper;
 	void* stream_dumper_context;
+	DUMP  iov_dumper;            //OUTPUT_IOV slices of a pack instead of OUTPUT_DATA when it's set
+	void* iov_dumper_context;
 
 	//DUMP  message_dumper;
 	//void* message_dumper_context;
@@ -78,6 +80,7 @@ typedef struct PS_BUILDER
 
 	ULONGLONG  used_bytes;
 	ULONGLONG  output_bytes;
+	ULONGLONG  copy_bytes;       //bytes copied into output buffers
 	unsigned long input_blocks;
 	unsigned long output_blocks;
 	unsigned long out_of_order_blocks;
@@ -96,6 +99,7 @@ void ReleasePSBuilder( PS_BUILDER *pPSBuilder );
 void ResetPSBuilder( PS_BUILDER *pPSBuilder );
 int PSBulderPushDataInSafe( PS_BUILDER *pPSBuilder, int nTrackIndex, int bGroup, unsigned char* pData, int nSize );
 int PSBulderPushDataInBuffer( PS_BUILDER *pPSBuilder, int nTrackIndex, int bGroup, struct BLOCK_BUFFER* pBlockBuffer );
+void PSBuilderOutputData( PS_BUILDER *pPSBuilder, OUTPUT_DATA* pOutputData, struct BLOCK_BUFFER* pBlockBuffer );
 int SetupTracks( TRACK *pTrack );
 int CreatSageStreamHeader( PS_BUILDER* pPSBuilder );
 int FlushEndOfCode( PS_BUILDER *pPSBuilder );
@@ -80,6 +80,8 @@ typedef struct CHANNEL_DATA
 	} u ;
 	struct TS_STREAMS *streams;   //optional
 	unsigned char  update_flag;   //channel table updated flag;
+	unsigned char  section_number;      //section of the table (SDT, VCT) the channels are from
+	unsigned char  last_section_number;
 	unsigned long  command;       //command return from dumper, save channel (command:1) or drop it (command:0).
 } CHANNEL_DATA;
 
@@ -131,6 +133,8 @@ typedef struct TUNE_DATA
 	} s[MAX_TUNE_NUM] ;
 
 	unsigned short update_flag;   //channel table updated flag;
+	unsigned char  section_number;      //section of the NIT the tune entry is from
+	unsigned char  last_section_number;
 	unsigned long  command;       //command return from dumper, save channel (command:1) or drop it (command:0).
 } TUNE_DATA;
 
@@ -408,7 +408,7 @@ unsigned char title_huffman_tbl[]={
 0x9b /*1935*/, 0x9b /*1936*/, 0x9b /*1937*/, 0x9b /*1938*/, 0x9b /*1939*/ 
 };
 
-int program_huffman_tbl_size = 1652;
+int program_huffman_tbl_size = 1782;
 unsigned char program_huffman_tbl[]={
 /* index ZQ */
 0x01 /*000*/, 0x00 /*001*/, 0x01 /*002*/, 0x2c /*003*/, 0x01 /*004*/, 
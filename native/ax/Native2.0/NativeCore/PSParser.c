@@ -118,17 +118,14 @@ inline unsigned char* SearchPSStart( const unsigned char* pData, int nBytes )
 #define	UNKNOWN_PACKET_TYPE		0x0f
 
 {
-	unsigned long code;
+	const unsigned char* p = pData;
+	const unsigned char* end = pData+nBytes;
 
-	if ( nBytes < 4 )
-		return NULL;
-
-	code = 0xffffff00 |*pData++;
-	while ( --nBytes )
+	while ( (p = SearchStartCode( p, (int)(end-p), -1 )) != NULL )
 	{
-		if ( ( (code&0x00ffffff)==0x01 ) && IS_PS_STREAM_ID( *(pData) ) )
-			return (unsigned char* )pData-3;
-		code = (( code << 8 )| *pData++ );
+		if ( IS_PS_STREAM_ID( p[3] ) )
+			return (unsigned char* )p;
+		p++;
 	}
 
 	return NULL;
@@ -0,0 +1,784 @@
+/*
+ * Copyright 2015 The SageTV Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "NativeCore.h"
+#include "RecordIndex.h"
+
+//Keyframe index sidecar of a PS recording. The writer follows pack and PES headers of data written into
+//the recording, only video PES payload is scanned for start codes. An entry is made for every I picture
+//(IDR or I slice of H.264) with the offset of the pack it starts in, or of the pack of its sequence header.
+//File layout: a 64 bytes header followed by 24 bytes entries, all little endian,
+//header: "SIDX" version:2 entry_size:2 flags:4 reserved:4 first_pts:8 last_pts:8 entry_num:4 reserved:4 bytes:8
+//entry:  pos:8 pts:8 scr:6 flags:2
+//entries are written before the header that counts them, a reader never sees a partial entry.
+
+#define INDEX_MAGIC          0x58444953		//"SIDX"
+#define INDEX_VERSION        1
+#define INDEX_HEADER_SIZE    64
+#define INDEX_ENTRY_SIZE     24
+#define INDEX_PENDING        16
+#define INDEX_FLUSH_PTS      (2*90000)
+
+#define ST_SYNC     0
+#define ST_PACK     1	//pack header
+#define ST_LENGTH   2	//packet length of a PES or system header
+#define ST_PES      3	//video PES header
+#define ST_SKIP     4
+#define ST_PAYLOAD  5	//video PES payload
+
+#define CODEC_UNKNOWN 0
+#define CODEC_MPEG2   1
+#define CODEC_H264    2
+
+#define PTS_WRAP      0x200000000ULL
+
+typedef struct RECORD_INDEX
+{
+	FILE* fp;
+	ULONGLONG stream_pos;		//recording offset of next pushed byte
+	int state;
+	unsigned long code;			//start code shift register
+	unsigned char header[264];
+	int header_bytes;
+	int header_need;
+	unsigned char stream_id;
+	ULONGLONG skip_bytes;
+	ULONGLONG payload_bytes;
+	int unbounded;				//video PES length 0
+
+	int pack_valid;
+	ULONGLONG pack_pos;
+	ULONGLONG pack_scr;
+	ULONGLONG pes_pos;			//pack of current video PES
+	ULONGLONG pes_scr;
+	ULONGLONG pes_pts;
+	int pes_pts_valid;			//PTS isn't taken by a picture of this PES yet
+
+	unsigned long es_code;
+	unsigned char es_start;
+	unsigned char peek[8];
+	int peek_bytes;
+	int peek_need;
+	int codec;
+	int aud_seen;
+	int gop_pending;
+	ULONGLONG gop_pos;
+	ULONGLONG gop_scr;
+
+	int pts_valid;
+	ULONGLONG pts_wrap;
+	ULONGLONG last_raw_pts;
+	ULONGLONG first_pts;
+	ULONGLONG last_pts;
+	ULONGLONG flush_pts;
+	ULONGLONG last_entry_pts;
+
+	RECORD_INDEX_ENTRY pending[INDEX_PENDING];
+	int pending_num;
+	unsigned long entry_num;	//entries in the file
+} RECORD_INDEX;
+
+typedef struct RECORD_INDEX_READER
+{
+	FILE* fp;
+	unsigned long flags;
+	ULONGLONG first_pts;
+	ULONGLONG last_pts;
+	ULONGLONG bytes;
+	RECORD_INDEX_ENTRY* entry;
+	int entry_num;
+	int entry_max;
+} RECORD_INDEX_READER;
+
+static void Put16( unsigned char* p, unsigned short v )
+{
+	p[0] = (unsigned char)v; p[1] = (unsigned char)(v>>8);
+}
+
+static void Put32( unsigned char* p, unsigned long v )
+{
+	Put16( p, (unsigned short)v ); Put16( p+2, (unsigned short)(v>>16) );
+}
+
+static void Put64( unsigned char* p, ULONGLONG v )
+{
+	Put32( p, (unsigned long)v ); Put32( p+4, (unsigned long)(v>>32) );
+}
+
+static unsigned short Get16( const unsigned char* p )
+{
+	return p[0] | (p[1]<<8);
+}
+
+static unsigned long Get32( const unsigned char* p )
+{
+	return Get16( p ) | ((unsigned long)Get16( p+2 )<<16);
+}
+
+static ULONGLONG Get64( const unsigned char* p )
+{
+	return Get32( p ) | ((ULONGLONG)Get32( p+4 )<<32);
+}
+
+static ULONGLONG ParsePTS( const unsigned char* p )
+{
+	return ((ULONGLONG)((p[0]>>1)&0x07)<<30) | (p[1]<<22) | ((p[2]>>1)<<15) | (p[3]<<7) | (p[4]>>1);
+}
+
+//SCR of a pack header in 27MHz, p points after the start code
+static ULONGLONG ParseSCR( const unsigned char* p )
+{
+	ULONGLONG base;
+	if ( (p[0] & 0xc0) == 0x40 ) //MPEG2
+	{
+		base = ((ULONGLONG)((p[0]>>3)&0x07)<<30) | ((ULONGLONG)(p[0]&0x03)<<28) | (p[1]<<20) |
+			   ((p[2]>>3)<<15) | ((p[2]&0x03)<<13) | (p[3]<<5) | (p[4]>>3);
+		return base*300 + (((p[4]&0x03)<<7) | (p[5]>>1));
+	}
+	return ParsePTS( p )*300;
+}
+
+//header bytes a pack header needs, p points after the start code
+static int PackHeaderNeed( const unsigned char* p, int nBytes )
+{
+	if ( nBytes < 1 )
+		return 1;
+	if ( (p[0] & 0xc0) == 0x40 )
+		return nBytes < 10 ? 10 : 10+(p[9]&0x07);
+	return 8;
+}
+
+//header bytes a video PES needs, p points after the packet length
+static int PESHeaderNeed( const unsigned char* p, int nBytes, int* pPTSPos )
+{
+	int i = 0;
+	*pPTSPos = -1;
+	if ( nBytes < 1 )
+		return 1;
+	if ( (p[0] & 0xc0) == 0x80 ) //MPEG2
+	{
+		if ( nBytes < 3 )
+			return 3;
+		if ( p[1] & 0x80 )
+			*pPTSPos = 3;
+		return 3+p[2];
+	}
+	while ( i < nBytes && p[i] == 0xff && i < 16 )
+		i++;
+	if ( i >= nBytes )
+		return i+1;
+	if ( (p[i] & 0xc0) == 0x40 )
+	{
+		i += 2;
+		if ( i >= nBytes )
+			return i+1;
+	}
+	if ( (p[i] & 0xe0) == 0x20 )
+	{
+		*pPTSPos = i;
+		return i + ( (p[i] & 0x10) ? 10 : 5 );
+	}
+	return i+1;
+}
+
+static ULONGLONG UnwrapPTS( RECORD_INDEX* pIndex, ULONGLONG lRawPTS )
+{
+	if ( !pIndex->pts_valid )
+	{
+		pIndex->pts_valid = 1;
+		pIndex->last_raw_pts = lRawPTS;
+		return lRawPTS;
+	}
+	if ( lRawPTS + PTS_WRAP/2 < pIndex->last_raw_pts )
+	{
+		pIndex->pts_wrap += PTS_WRAP;
+		pIndex->last_raw_pts = lRawPTS;
+	} else
+	if ( lRawPTS > pIndex->last_raw_pts + PTS_WRAP/2 ) //reordered picture before a wrap
+	{
+		return pIndex->pts_wrap >= PTS_WRAP ? lRawPTS + pIndex->pts_wrap - PTS_WRAP : lRawPTS;
+	} else
+	if ( lRawPTS > pIndex->last_raw_pts )
+		pIndex->last_raw_pts = lRawPTS;
+	return lRawPTS + pIndex->pts_wrap;
+}
+
+static int WriteIndexHeader( RECORD_INDEX* pIndex )
+{
+	unsigned char buf[INDEX_HEADER_SIZE];
+	memset( buf, 0, sizeof(buf) );
+	Put32( buf, INDEX_MAGIC );
+	Put16( buf+4, INDEX_VERSION );
+	Put16( buf+6, INDEX_ENTRY_SIZE );
+	Put32( buf+8, pIndex->codec == CODEC_H264 ? INDEX_H264 : 0 );
+	Put64( buf+16, pIndex->first_pts );
+	Put64( buf+24, pIndex->last_pts );
+	Put32( buf+32, pIndex->entry_num );
+	Put64( buf+40, pIndex->stream_pos );
+	if ( fseek( pIndex->fp, 0, SEEK_SET ) || fwrite( buf, 1, sizeof(buf), pIndex->fp ) != sizeof(buf) )
+		return 0;
+	return 1;
+}
+
+int FlushRecordIndex( void* Handle )
+{
+	RECORD_INDEX *pIndex = (RECORD_INDEX*)Handle;
+	unsigned char buf[INDEX_PENDING*INDEX_ENTRY_SIZE];
+	int i, ret;
+	if ( pIndex == NULL )
+		return 0;
+	for ( i = 0; i<pIndex->pending_num; i++ )
+	{
+		unsigned char* p = buf + i*INDEX_ENTRY_SIZE;
+		Put64( p, pIndex->pending[i].pos );
+		Put64( p+8, pIndex->pending[i].pts );
+		Put32( p+16, (unsigned long)pIndex->pending[i].scr );
+		Put16( p+20, (unsigned short)(pIndex->pending[i].scr>>32) );
+		Put16( p+22, pIndex->pending[i].flags );
+	}
+	ret = 1;
+	if ( pIndex->pending_num )
+	{
+		if ( fseek( pIndex->fp, INDEX_HEADER_SIZE + (long)pIndex->entry_num*INDEX_ENTRY_SIZE, SEEK_SET ) ||
+			 fwrite( buf, INDEX_ENTRY_SIZE, pIndex->pending_num, pIndex->fp ) != (size_t)pIndex->pending_num )
+			ret = 0;
+		else
+			pIndex->entry_num += pIndex->pending_num;
+		fflush( pIndex->fp );
+		pIndex->pending_num = 0;
+	}
+	if ( !WriteIndexHeader( pIndex ) )
+		ret = 0;
+	fflush( pIndex->fp );
+	pIndex->flush_pts = pIndex->last_pts;
+	return ret;
+}
+
+static void AddEntry( RECORD_INDEX* pIndex, unsigned short uFlags )
+{
+	RECORD_INDEX_ENTRY* pEntry;
+	int gop = pIndex->gop_pending;
+	pIndex->gop_pending = 0;
+	if ( !pIndex->pes_pts_valid )
+		return;
+	pIndex->pes_pts_valid = 0;
+	if ( !(uFlags & INDEX_KEY_FRAME) )
+		return;
+	if ( pIndex->entry_num + pIndex->pending_num && pIndex->pes_pts == pIndex->last_entry_pts )
+		return;
+	if ( pIndex->pending_num >= INDEX_PENDING )
+		FlushRecordIndex( pIndex );
+	pEntry = &pIndex->pending[pIndex->pending_num++];
+	pEntry->pos = gop ? pIndex->gop_pos : pIndex->pes_pos;
+	pEntry->scr = gop ? pIndex->gop_scr : pIndex->pes_scr;
+	pEntry->pts = pIndex->pes_pts;
+	pEntry->flags = uFlags | ( gop ? INDEX_GOP_START : 0 ) | ( pIndex->codec == CODEC_H264 ? INDEX_H264 : 0 );
+	pIndex->last_entry_pts = pIndex->pes_pts;
+}
+
+static int ReadUE( const unsigned char* p, int nBytes, int* pBit, unsigned long* pValue )
+{
+	int zeros = 0, i, bit = *pBit;
+	unsigned long v = 0;
+	while ( bit < nBytes*8 && !(p[bit>>3] & (0x80>>(bit&7))) )
+	{
+		zeros++; bit++;
+	}
+	if ( bit + zeros >= nBytes*8 || zeros > 16 )
+		return 0;
+	bit++;
+	for ( i = 0; i<zeros; i++, bit++ )
+		v = (v<<1) | ((p[bit>>3]>>(7-(bit&7)))&1);
+	*pValue = (1UL<<zeros) - 1 + v;
+	*pBit = bit;
+	return 1;
+}
+
+static void PeekDone( RECORD_INDEX* pIndex )
+{
+	unsigned char code = pIndex->es_start;
+	pIndex->peek_need = 0;
+	if ( pIndex->codec == CODEC_MPEG2 )
+	{
+		if ( code == 0x00 )
+			AddEntry( pIndex, ((pIndex->peek[1]>>3)&0x07) == 1 ? INDEX_KEY_FRAME : 0 );
+		return;
+	}
+	switch ( code & 0x1f ) {
+	case 9:
+		if ( (pIndex->peek[0] & 0x1f) == 0x10 )
+			pIndex->aud_seen = 1;
+		break;
+	case 7:
+		switch ( pIndex->peek[0] ) {
+		case 66: case 77: case 88: case 100: case 110: case 122: case 244: case 44: case 118: case 128:
+			if ( pIndex->codec == CODEC_H264 || pIndex->aud_seen )
+			{
+				pIndex->codec = CODEC_H264;
+				pIndex->gop_pending = 1;
+				pIndex->gop_pos = pIndex->pes_pos;
+				pIndex->gop_scr = pIndex->pes_scr;
+			}
+		}
+		break;
+	case 1:
+	case 5:
+		if ( pIndex->codec == CODEC_H264 )
+		{
+			unsigned long first_mb, slice_type;
+			int bit = 0;
+			if ( !ReadUE( pIndex->peek, pIndex->peek_bytes, &bit, &first_mb ) ||
+				 !ReadUE( pIndex->peek, pIndex->peek_bytes, &bit, &slice_type ) || first_mb )
+				break;
+			AddEntry( pIndex, ( (code & 0x1f) == 5 || slice_type % 5 == 2 ) ? INDEX_KEY_FRAME : 0 );
+		}
+		break;
+	}
+}
+
+//returns 1 if it's a system start code that ends an unbounded PES
+static int ESStartCode( RECORD_INDEX* pIndex, unsigned char code )
+{
+	if ( code >= 0xb9 )
+		return pIndex->unbounded;
+	pIndex->es_start = code;
+	pIndex->peek_bytes = 0;
+	pIndex->peek_need = 0;
+	if ( code == 0xb3 || ( code == 0xb8 && pIndex->codec == CODEC_MPEG2 ) )
+	{
+		pIndex->codec = CODEC_MPEG2;
+		if ( !pIndex->gop_pending )
+		{
+			pIndex->gop_pending = 1;
+			pIndex->gop_pos = pIndex->pes_pos;
+			pIndex->gop_scr = pIndex->pes_scr;
+		}
+	} else
+	if ( pIndex->codec == CODEC_MPEG2 )
+	{
+		if ( code == 0x00 )
+			pIndex->peek_need = 2;
+	} else
+	if ( !(code & 0x80) )
+	{
+		switch ( code & 0x1f ) {
+		case 9: case 7: pIndex->peek_need = 1; break;
+		case 1: case 5: pIndex->peek_need = 4; break;
+		}
+	}
+	return 0;
+}
+
+static unsigned long ShiftCode( unsigned long lCode, const unsigned char* p, int nBytes )
+{
+	int i = nBytes > 4 ? nBytes-4 : 0;
+	for ( ; i<nBytes; i++ )
+		lCode = (lCode<<8) | p[i];
+	return lCode;
+}
+
+//scans video payload, returns bytes used, stops after a system start code of an unbounded PES
+static int ScanESData( RECORD_INDEX* pIndex, const unsigned char* pData, int nBytes, int* pSystemCode )
+{
+	int i = 0;
+	*pSystemCode = 0;
+	while ( i < nBytes )
+	{
+		unsigned char b;
+		if ( !pIndex->peek_need && (pIndex->es_code & 0xffffff) != 0x000001 )
+		{
+			const unsigned char* q = memchr( pData+i, 0x01, nBytes-i );
+			if ( q == NULL )
+			{
+				pIndex->es_code = ShiftCode( pIndex->es_code, pData+i, nBytes-i );
+				return nBytes;
+			}
+			pIndex->es_code = ShiftCode( pIndex->es_code, pData+i, (int)(q-pData)+1-i );
+			i = (int)(q-pData)+1;
+			continue;
+		}
+		b = pData[i++];
+		if ( pIndex->peek_need )
+		{
+			pIndex->peek[pIndex->peek_bytes++] = b;
+			if ( pIndex->peek_bytes >= pIndex->peek_need )
+				PeekDone( pIndex );
+		}
+		if ( (pIndex->es_code & 0xffffff) == 0x000001 && ESStartCode( pIndex, b ) )
+		{
+			pIndex->es_code = 0xffffff00 | b;
+			*pSystemCode = 1;
+			return i;
+		}
+		pIndex->es_code = (pIndex->es_code<<8) | b;
+	}
+	return i;
+}
+
+static void SystemStartCode( RECORD_INDEX* pIndex, unsigned char code )
+{
+	pIndex->stream_id = code;
+	pIndex->header_bytes = 0;
+	if ( code == 0xba )
+	{
+		pIndex->pack_pos = pIndex->stream_pos - 4;
+		pIndex->state = ST_PACK;
+	} else
+	if ( code >= 0xbb )
+		pIndex->state = ST_LENGTH;
+	else
+		pIndex->state = ST_SYNC;
+}
+
+int PushRecordIndexData( void* Handle, const unsigned char* pData, int nBytes )
+{
+	RECORD_INDEX *pIndex = (RECORD_INDEX*)Handle;
+	int i = 0;
+	if ( pIndex == NULL || pIndex->fp == NULL )
+		return 0;
+	while ( i < nBytes )
+	{
+		int n, need, pts_pos;
+		switch ( pIndex->state ) {
+		case ST_SYNC:
+			pIndex->code = (pIndex->code<<8) | pData[i++];
+			pIndex->stream_pos++;
+			if ( (pIndex->code & 0xffffff00) == 0x00000100 )
+				SystemStartCode( pIndex, (unsigned char)pIndex->code );
+			break;
+
+		case ST_PACK:
+			pIndex->header[pIndex->header_bytes++] = pData[i++];
+			pIndex->stream_pos++;
+			if ( pIndex->header_bytes >= PackHeaderNeed( pIndex->header, pIndex->header_bytes ) )
+			{
+				pIndex->pack_scr = ParseSCR( pIndex->header );
+				pIndex->pack_valid = 1;
+				pIndex->code = 0xffffffff;
+				pIndex->state = ST_SYNC;
+			}
+			break;
+
+		case ST_LENGTH:
+			pIndex->header[pIndex->header_bytes++] = pData[i++];
+			pIndex->stream_pos++;
+			if ( pIndex->header_bytes < 2 )
+				break;
+			pIndex->skip_bytes = (pIndex->header[0]<<8)|pIndex->header[1];
+			pIndex->code = 0xffffffff;
+			pIndex->header_bytes = 0;
+			if ( (pIndex->stream_id & 0xf0) == 0xe0 )
+			{
+				pIndex->unbounded = pIndex->skip_bytes == 0;
+				pIndex->pes_pos = pIndex->pack_valid ? pIndex->pack_pos : pIndex->stream_pos-6;
+				pIndex->pes_scr = pIndex->pack_valid ? pIndex->pack_scr : 0;
+				pIndex->state = ST_PES;
+			} else
+				pIndex->state = pIndex->skip_bytes ? ST_SKIP : ST_SYNC;
+			break;
+
+		case ST_PES:
+			pIndex->header[pIndex->header_bytes++] = pData[i++];
+			pIndex->stream_pos++;
+			need = PESHeaderNeed( pIndex->header, pIndex->header_bytes, &pts_pos );
+			if ( pIndex->header_bytes < need )
+				break;
+			if ( pts_pos >= 0 )
+			{
+				int first = !pIndex->pts_valid;
+				pIndex->pes_pts = UnwrapPTS( pIndex, ParsePTS( pIndex->header+pts_pos ) );
+				pIndex->pes_pts_valid = 1;
+				if ( first )
+					pIndex->first_pts = pIndex->flush_pts = pIndex->pes_pts;
+				if ( pIndex->pes_pts > pIndex->last_pts )
+					pIndex->last_pts = pIndex->pes_pts;
+			} else
+				pIndex->pes_pts_valid = 0;
+			if ( pIndex->unbounded )
+				pIndex->payload_bytes = 0;
+			else
+			if ( pIndex->skip_bytes > (ULONGLONG)need )
+				pIndex->payload_bytes = pIndex->skip_bytes - need;
+			else
+			{
+				pIndex->state = ST_SYNC;
+				break;
+			}
+			pIndex->state = ST_PAYLOAD;
+			break;
+
+		case ST_SKIP:
+			n = nBytes-i < pIndex->skip_bytes ? nBytes-i : (int)pIndex->skip_bytes;
+			i += n;
+			pIndex->stream_pos += n;
+			pIndex->skip_bytes -= n;
+			if ( pIndex->skip_bytes == 0 )
+				pIndex->state = ST_SYNC;
+			break;
+
+		case ST_PAYLOAD:
+			{
+				int system_code;
+				n = nBytes-i;
+				if ( !pIndex->unbounded && pIndex->payload_bytes < (ULONGLONG)n )
+					n = (int)pIndex->payload_bytes;
+				n = ScanESData( pIndex, pData+i, n, &system_code );
+				i += n;
+				pIndex->stream_pos += n;
+				if ( system_code )
+					SystemStartCode( pIndex, (unsigned char)pIndex->es_code );
+				else
+				if ( !pIndex->unbounded && ( pIndex->payload_bytes -= n ) == 0 )
+					pIndex->state = ST_SYNC;
+			}
+			break;
+		}
+	}
+	if ( pIndex->pending_num >= INDEX_PENDING || pIndex->last_pts >= pIndex->flush_pts + INDEX_FLUSH_PTS )
+		FlushRecordIndex( pIndex );
+	return nBytes;
+}
+
+void* OpenRecordIndex( char* pIndexFileName )
+{
+	RECORD_INDEX *pIndex;
+	FILE* fp = fopen( pIndexFileName, "wb" );
+	if ( fp == NULL )
+	{
+		SageLog(( _LOG_ERROR, 3, TEXT("RecordIndex: can't open index file %s"), pIndexFileName ));
+		return NULL;
+	}
+	pIndex = SAGETV_MALLOC( sizeof(RECORD_INDEX) );
+	memset( pIndex, 0, sizeof(RECORD_INDEX) );
+	pIndex->fp = fp;
+	pIndex->code = 0xffffffff;
+	pIndex->es_code = 0xffffffff;
+	WriteIndexHeader( pIndex );
+	fflush( fp );
+	return pIndex;
+}
+
+int CloseRecordIndex( void* Handle )
+{
+	RECORD_INDEX *pIndex = (RECORD_INDEX*)Handle;
+	int ret;
+	if ( pIndex == NULL )
+		return 0;
+	ret = FlushRecordIndex( pIndex );
+	SageLog(( _LOG_TRACE, 3, TEXT("RecordIndex: %lu entries of %llu bytes"), pIndex->entry_num, pIndex->stream_pos ));
+	fclose( pIndex->fp );
+	SAGETV_FREE( pIndex );
+	return ret;
+}
+
+int RecordIndexFileName( const char* pRecFileName, char* pIndexFileName, int nSize )
+{
+	int len = (int)strlen( pRecFileName );
+	if ( len + (int)sizeof(RECORD_INDEX_EXT) > nSize )
+		return 0;
+	memcpy( pIndexFileName, pRecFileName, len );
+	memcpy( pIndexFileName+len, RECORD_INDEX_EXT, sizeof(RECORD_INDEX_EXT) );
+	return 1;
+}
+
+void* OpenRecordIndexReader( char* pIndexFileName )
+{
+	RECORD_INDEX_READER *pReader;
+	unsigned char buf[INDEX_HEADER_SIZE];
+	FILE* fp = fopen( pIndexFileName, "rb" );
+	if ( fp == NULL )
+		return NULL;
+	if ( fread( buf, 1, sizeof(buf), fp ) != sizeof(buf) || Get32( buf ) != INDEX_MAGIC ||
+		 Get16( buf+4 ) != INDEX_VERSION || Get16( buf+6 ) != INDEX_ENTRY_SIZE )
+	{
+		SageLog(( _LOG_TRACE, 3, TEXT("RecordIndex: %s isn't a record index"), pIndexFileName ));
+		fclose( fp );
+		return NULL;
+	}
+	pReader = SAGETV_MALLOC( sizeof(RECORD_INDEX_READER) );
+	memset( pReader, 0, sizeof(RECORD_INDEX_READER) );
+	pReader->fp = fp;
+	RefreshRecordIndexReader( pReader );
+	return pReader;
+}
+
+int RefreshRecordIndexReader( void* Handle )
+{
+	RECORD_INDEX_READER *pReader = (RECORD_INDEX_READER*)Handle;
+	unsigned char buf[INDEX_HEADER_SIZE];
+	unsigned char data[64*INDEX_ENTRY_SIZE];
+	int entry_num, num = 0;
+	if ( pReader == NULL )
+		return 0;
+	if ( fseek( pReader->fp, 0, SEEK_SET ) || fread( buf, 1, sizeof(buf), pReader->fp ) != sizeof(buf) )
+		return 0;
+	entry_num = (int)Get32( buf+32 );
+	if ( entry_num > pReader->entry_max )
+	{
+		int max = pReader->entry_max ? pReader->entry_max : 1024;
+		RECORD_INDEX_ENTRY* entry;
+		while ( max < entry_num )
+			max *= 2;
+		entry = SAGETV_MALLOC( sizeof(RECORD_INDEX_ENTRY)*max );
+		if ( pReader->entry_num )
+			memcpy( entry, pReader->entry, sizeof(RECORD_INDEX_ENTRY)*pReader->entry_num );
+		if ( pReader->entry )
+			SAGETV_FREE( pReader->entry );
+		pReader->entry = entry;
+		pReader->entry_max = max;
+	}
+	if ( entry_num > pReader->entry_num &&
+		 fseek( pReader->fp, INDEX_HEADER_SIZE + (long)pReader->entry_num*INDEX_ENTRY_SIZE, SEEK_SET ) )
+		return 0;
+	while ( pReader->entry_num < entry_num )
+	{
+		int i, n = entry_num - pReader->entry_num;
+		if ( n > 64 ) n = 64;
+		if ( fread( data, INDEX_ENTRY_SIZE, n, pReader->fp ) != (size_t)n )
+			break;
+		for ( i = 0; i<n; i++ )
+		{
+			RECORD_INDEX_ENTRY* pEntry = &pReader->entry[pReader->entry_num++];
+			unsigned char* p = data + i*INDEX_ENTRY_SIZE;
+			pEntry->pos = Get64( p );
+			pEntry->pts = Get64( p+8 );
+			pEntry->scr = Get32( p+16 ) | ((ULONGLONG)Get16( p+20 )<<32);
+			pEntry->flags = Get16( p+22 );
+		}
+		num += n;
+	}
+	pReader->flags = Get32( buf+8 );
+	pReader->first_pts = Get64( buf+16 );
+	pReader->last_pts = Get64( buf+24 );
+	pReader->bytes = Get64( buf+40 );
+	return num;
+}
+
+void CloseRecordIndexReader( void* Handle )
+{
+	RECORD_INDEX_READER *pReader = (RECORD_INDEX_READER*)Handle;
+	if ( pReader == NULL )
+		return;
+	fclose( pReader->fp );
+	if ( pReader->entry )
+		SAGETV_FREE( pReader->entry );
+	SAGETV_FREE( pReader );
+}
+
+int RecordIndexEntryNum( void* Handle )
+{
+	return Handle ? ((RECORD_INDEX_READER*)Handle)->entry_num : 0;
+}
+
+int GetRecordIndexEntry( void* Handle, int nIndex, RECORD_INDEX_ENTRY* pEntry )
+{
+	RECORD_INDEX_READER *pReader = (RECORD_INDEX_READER*)Handle;
+	if ( pReader == NULL || nIndex < 0 || nIndex >= pReader->entry_num )
+		return 0;
+	if ( pEntry != NULL )
+		*pEntry = pReader->entry[nIndex];
+	return 1;
+}
+
+ULONGLONG RecordIndexFirstPTS( void* Handle )
+{
+	return Handle ? ((RECORD_INDEX_READER*)Handle)->first_pts : 0;
+}
+
+ULONGLONG RecordIndexLastPTS( void* Handle )
+{
+	return Handle ? ((RECORD_INDEX_READER*)Handle)->last_pts : 0;
+}
+
+ULONGLONG RecordIndexDuration( void* Handle )
+{
+	RECORD_INDEX_READER *pReader = (RECORD_INDEX_READER*)Handle;
+	if ( pReader == NULL || pReader->last_pts < pReader->first_pts )
+		return 0;
+	return pReader->last_pts - pReader->first_pts;
+}
+
+ULONGLONG RecordIndexBytes( void* Handle )
+{
+	return Handle ? ((RECORD_INDEX_READER*)Handle)->bytes : 0;
+}
+
+//the last entry whose key is at or before lKey, keys are PTS (bPos=0) or file offset
+static int SearchEntry( RECORD_INDEX_READER* pReader, ULONGLONG lKey, int bPos, RECORD_INDEX_ENTRY* pEntry )
+{
+	int lo = 0, hi = pReader->entry_num;
+	while ( lo < hi )
+	{
+		int mid = (lo+hi)/2;
+		ULONGLONG key = bPos ? pReader->entry[mid].pos : pReader->entry[mid].pts;
+		if ( key <= lKey )
+			lo = mid+1;
+		else
+			hi = mid;
+	}
+	if ( lo == 0 )
+		return -1;
+	if ( pEntry != NULL )
+		*pEntry = pReader->entry[lo-1];
+	return lo-1;
+}
+
+int SeekRecordIndexPTS( void* Handle, ULONGLONG lPTS, RECORD_INDEX_ENTRY* pEntry )
+{
+	if ( Handle == NULL )
+		return -1;
+	return SearchEntry( (RECORD_INDEX_READER*)Handle, lPTS, 0, pEntry );
+}
+
+int SeekRecordIndexTime( void* Handle, unsigned long lMillSeconds, RECORD_INDEX_ENTRY* pEntry )
+{
+	RECORD_INDEX_READER *pReader = (RECORD_INDEX_READER*)Handle;
+	if ( pReader == NULL )
+		return -1;
+	return SearchEntry( pReader, pReader->first_pts + (ULONGLONG)lMillSeconds*90, 0, pEntry );
+}
+
+int SeekRecordIndexPos( void* Handle, ULONGLONG lPos, RECORD_INDEX_ENTRY* pEntry )
+{
+	if ( Handle == NULL )
+		return -1;
+	return SearchEntry( (RECORD_INDEX_READER*)Handle, lPos, 1, pEntry );
+}
+
+int StepRecordIndex( void* Handle, int nIndex, int nStep, int bGOP, RECORD_INDEX_ENTRY* pEntry )
+{
+	RECORD_INDEX_READER *pReader = (RECORD_INDEX_READER*)Handle;
+	int dir = nStep < 0 ? -1 : 1;
+	if ( pReader == NULL )
+		return -1;
+	if ( nStep < 0 ) nStep = -nStep;
+	while ( nStep > 0 )
+	{
+		nIndex += dir;
+		if ( nIndex < 0 || nIndex >= pReader->entry_num )
+			return -1;
+		if ( !bGOP || (pReader->entry[nIndex].flags & INDEX_GOP_START) )
+			nStep--;
+	}
+	if ( nIndex < 0 || nIndex >= pReader->entry_num )
+		return -1;
+	if ( pEntry != NULL )
+		*pEntry = pReader->entry[nIndex];
+	return nIndex;
+}
@@ -0,0 +1,69 @@
+/*
+ * Copyright 2015 The SageTV Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef RECORD_INDEX_H
+#define RECORD_INDEX_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//entry flags
+#define INDEX_KEY_FRAME    0x0001	//I picture of MPEG2, IDR or I slice of H.264
+#define INDEX_GOP_START    0x0002	//a sequence header (SPS) precedes it, decoding can start here
+#define INDEX_H264         0x0004
+
+#define RECORD_INDEX_EXT   ".idx"
+
+typedef struct RECORD_INDEX_ENTRY
+{
+	ULONGLONG pos;		//file offset of the pack that carries the frame (its sequence header)
+	ULONGLONG pts;		//video PTS, unwrapped to 64 bits
+	ULONGLONG scr;		//SCR of the pack in 27MHz
+	unsigned short flags;
+} RECORD_INDEX_ENTRY;
+
+//keyframe index sidecar of a MPEG2 PS recording, data are pushed as they are written into the recording file.
+//The index is flushed every few entries, a reader of a recording in progress sees it grow.
+void* OpenRecordIndex( char* pIndexFileName );
+int   PushRecordIndexData( void* Handle, const unsigned char* pData, int nBytes );
+int   FlushRecordIndex( void* Handle );
+int   CloseRecordIndex( void* Handle );
+//index file name of a recording, returns 0 if it doesn't fit into pIndexFileName
+int   RecordIndexFileName( const char* pRecFileName, char* pIndexFileName, int nSize );
+
+void* OpenRecordIndexReader( char* pIndexFileName );
+//reads entries added since the index is opened or last refreshed, returns number of new entries
+int   RefreshRecordIndexReader( void* Handle );
+void  CloseRecordIndexReader( void* Handle );
+int   RecordIndexEntryNum( void* Handle );
+int   GetRecordIndexEntry( void* Handle, int nIndex, RECORD_INDEX_ENTRY* pEntry );
+ULONGLONG RecordIndexFirstPTS( void* Handle );
+ULONGLONG RecordIndexLastPTS( void* Handle );
+ULONGLONG RecordIndexDuration( void* Handle );	//in PTS (90KHz)
+ULONGLONG RecordIndexBytes( void* Handle );		//recording bytes indexed
+//Seek*: the last entry at or before the target, returns its index, -1 if the target is before the first entry.
+int   SeekRecordIndexPTS( void* Handle, ULONGLONG lPTS, RECORD_INDEX_ENTRY* pEntry );
+int   SeekRecordIndexTime( void* Handle, unsigned long lMillSeconds, RECORD_INDEX_ENTRY* pEntry );
+int   SeekRecordIndexPos( void* Handle, ULONGLONG lPos, RECORD_INDEX_ENTRY* pEntry );
+//trick play, moves nStep key frames (GOP starts if bGOP) from nIndex, returns new index, -1 at either end
+int   StepRecordIndex( void* Handle, int nIndex, int nStep, int bGOP, RECORD_INDEX_ENTRY* pEntry );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,702 @@
+/*
+ * Copyright 2015 The SageTV Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifdef Linux
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE   //O_DIRECT
+#endif
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "NativeCore.h"
+#include "RecordWriter.h"
+
+#ifdef Linux
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#if defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#define REC_URING
+#endif
+#endif
+#endif
+#endif
+
+#ifdef WIN32
+#include <io.h>
+struct iovec { void* iov_base; size_t iov_len; };
+#endif
+
+//Recording writer of capture plugins. Data are copied into a ring of aligned buffers, full buffers are
+//sealed with their file offset and a batch of them is written with positioned writes (one pwritev per
+//contiguous run, or one io_uring submission), a circular file wraps by splitting a buffer at the file end,
+//no seek is needed. FlushRecordWriter writes everything out and waits, data are visible to readers after it.
+
+#define REC_ALIGN        4096
+#define REC_BUFFER_SIZE  (256*1024)
+#define REC_BUFFER_NUM   8
+#define REC_MAX_BUFFER   32
+#define REC_MAX_IOV      (REC_MAX_BUFFER*2)
+#define REC_SYNC_TAG     0xffffffffULL
+
+typedef struct REC_BUFFER
+{
+	unsigned char* data;
+	int       bytes;
+	ULONGLONG offset;		//file offset of data[0]
+	int       ops;			//io_uring writes in flight
+	struct iovec iov[2];	//segments of io_uring writes, a buffer crossing circular file end has two
+	ULONGLONG seg_offset[2];
+} REC_BUFFER;
+
+#ifdef REC_URING
+typedef struct REC_URING_RING
+{
+	int ring_fd;
+	unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+	unsigned *cq_head, *cq_tail, *cq_mask;
+	struct io_uring_sqe *sqes;
+	struct io_uring_cqe *cqes;
+	void  *sq_ptr, *cq_ptr;
+	size_t sq_len, cq_len, sqe_len;
+	int    to_submit;
+} REC_URING_RING;
+#endif
+
+typedef struct RECORD_WRITER
+{
+	int fd;
+	int engine;
+	int direct;
+	int fd_flags;
+	ULONGLONG circ_size;
+	ULONGLONG file_pos;		//file offset of next sealed buffer
+	int buffer_size;
+	int buffer_num;
+	unsigned char* pool;
+	REC_BUFFER* buffer;
+	//ring: [head, head+inflight) are submitted, next queued ones are sealed, the fill buffer follows
+	int head;
+	int inflight;
+	int queued;
+	int batch;
+	unsigned long sync_bytes;
+	unsigned long sync_interval;
+	ULONGLONG unsynced_bytes;
+	unsigned long last_sync;
+	int sync_inflight;
+	int error;
+#ifdef REC_URING
+	REC_URING_RING* uring;
+#endif
+} RECORD_WRITER;
+
+static unsigned long RecTick( )
+{
+#ifdef WIN32
+	return GetTickCount( );
+#else
+	struct timespec ts;
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return (unsigned long)( ts.tv_sec*1000 + ts.tv_nsec/1000000 );
+#endif
+}
+
+static ULONGLONG WrapPos( RECORD_WRITER* pWriter, ULONGLONG lPos )
+{
+	if ( pWriter->circ_size )
+		while ( lPos >= pWriter->circ_size )
+			lPos -= pWriter->circ_size;
+	return lPos;
+}
+
+static REC_BUFFER* FillBuffer( RECORD_WRITER* pWriter )
+{
+	return &pWriter->buffer[ (pWriter->head+pWriter->inflight+pWriter->queued) % pWriter->buffer_num ];
+}
+
+//split a buffer at circular file end
+static int BufferSegments( RECORD_WRITER* pWriter, REC_BUFFER* pBuffer )
+{
+	ULONGLONG room = pWriter->circ_size ? pWriter->circ_size - pBuffer->offset : (ULONGLONG)pBuffer->bytes;
+	pBuffer->iov[0].iov_base = pBuffer->data;
+	pBuffer->seg_offset[0] = pBuffer->offset;
+	if ( room >= (ULONGLONG)pBuffer->bytes )
+	{
+		pBuffer->iov[0].iov_len = pBuffer->bytes;
+		return 1;
+	}
+	pBuffer->iov[0].iov_len = (size_t)room;
+	pBuffer->iov[1].iov_base = pBuffer->data + room;
+	pBuffer->iov[1].iov_len = pBuffer->bytes - (size_t)room;
+	pBuffer->seg_offset[1] = 0;
+	return 2;
+}
+
+//write a contiguous run, short writes are continued
+static int WriteRun( RECORD_WRITER* pWriter, struct iovec* pIov, int nNum, ULONGLONG lOffset )
+{
+	while ( nNum > 0 )
+	{
+#ifdef WIN32
+		int ret;
+		if ( _lseeki64( pWriter->fd, lOffset, SEEK_SET ) < 0 )
+			return -1;
+		ret = _write( pWriter->fd, pIov->iov_base, (unsigned int)pIov->iov_len );
+#else
+		ssize_t ret = pwritev( pWriter->fd, pIov, nNum, (off_t)lOffset );
+#endif
+		if ( ret < 0 )
+		{
+			if ( errno == EINTR )
+				continue;
+			SageLog(( _LOG_ERROR, 3, TEXT("RecordWriter: write failed at %lld, errno:%d"), lOffset, errno ));
+			return -1;
+		}
+		lOffset += ret;
+		while ( nNum > 0 && (size_t)ret >= pIov->iov_len )
+		{
+			ret -= pIov->iov_len;
+			pIov++;
+			nNum--;
+		}
+		if ( nNum > 0 )
+		{
+			pIov->iov_base = (char*)pIov->iov_base + ret;
+			pIov->iov_len -= ret;
+		}
+	}
+	return 0;
+}
+
+static void SyncData( RECORD_WRITER* pWriter )
+{
+#ifdef WIN32
+	_commit( pWriter->fd );
+#else
+	fdatasync( pWriter->fd );
+#endif
+}
+
+static int SyncDue( RECORD_WRITER* pWriter )
+{
+	if ( pWriter->unsynced_bytes == 0 )
+		return 0;
+	if ( pWriter->sync_bytes && pWriter->unsynced_bytes >= pWriter->sync_bytes )
+		return 1;
+	if ( pWriter->sync_interval && RecTick( ) - pWriter->last_sync >= pWriter->sync_interval )
+		return 1;
+	return 0;
+}
+
+static int SubmitPWritev( RECORD_WRITER* pWriter )
+{
+	struct iovec iov[REC_MAX_IOV];
+	ULONGLONG run_pos = 0, next_pos = 0;
+	int i, j, seg, n = 0, ret = 0;
+
+	for ( i = 0; i<pWriter->queued; i++ )
+	{
+		REC_BUFFER* buffer = &pWriter->buffer[ (pWriter->head+i) % pWriter->buffer_num ];
+		seg = BufferSegments( pWriter, buffer );
+		for ( j = 0; j<seg; j++ )
+		{
+			if ( n && ( buffer->seg_offset[j] != next_pos || n == REC_MAX_IOV ) )
+			{
+				ret |= WriteRun( pWriter, iov, n, run_pos );
+				n = 0;
+			}
+			if ( n == 0 )
+				run_pos = buffer->seg_offset[j];
+			iov[n++] = buffer->iov[j];
+			next_pos = buffer->seg_offset[j] + buffer->iov[j].iov_len;
+		}
+		pWriter->unsynced_bytes += buffer->bytes;
+	}
+	if ( n )
+		ret |= WriteRun( pWriter, iov, n, run_pos );
+	if ( ret )
+		pWriter->error = 1;
+	pWriter->head = (pWriter->head+pWriter->queued) % pWriter->buffer_num;
+	pWriter->queued = 0;
+
+	if ( SyncDue( pWriter ) )
+	{
+		SyncData( pWriter );
+		pWriter->unsynced_bytes = 0;
+		pWriter->last_sync = RecTick( );
+	}
+	return ret;
+}
+
+#ifdef REC_URING
+
+static int URingSetup( unsigned nEntries, struct io_uring_params* pParams )
+{
+	return (int)syscall( __NR_io_uring_setup, nEntries, pParams );
+}
+
+static int URingEnter( int nRingFd, unsigned nSubmit, unsigned nComplete, unsigned nFlags )
+{
+	return (int)syscall( __NR_io_uring_enter, nRingFd, nSubmit, nComplete, nFlags, NULL, 0 );
+}
+
+static void CloseURing( REC_URING_RING* pRing )
+{
+	if ( pRing->sqes != NULL && pRing->sqes != MAP_FAILED )
+		munmap( pRing->sqes, pRing->sqe_len );
+	if ( pRing->cq_ptr != NULL && pRing->cq_ptr != MAP_FAILED && pRing->cq_ptr != pRing->sq_ptr )
+		munmap( pRing->cq_ptr, pRing->cq_len );
+	if ( pRing->sq_ptr != NULL && pRing->sq_ptr != MAP_FAILED )
+		munmap( pRing->sq_ptr, pRing->sq_len );
+	if ( pRing->ring_fd >= 0 )
+		close( pRing->ring_fd );
+	SAGETV_FREE( pRing );
+}
+
+static REC_URING_RING* OpenURing( unsigned nEntries )
+{
+	struct io_uring_params params;
+	REC_URING_RING* ring = SAGETV_MALLOC( sizeof(REC_URING_RING) );
+	unsigned char *sq, *cq;
+
+	if ( ring == NULL )
+		return NULL;
+	memset( &params, 0, sizeof(params) );
+	ring->ring_fd = URingSetup( nEntries, &params );
+	if ( ring->ring_fd < 0 )
+	{
+		SageLog(( _LOG_TRACE, 3, TEXT("RecordWriter: io_uring isn't available (errno:%d), use pwritev"), errno ));
+		SAGETV_FREE( ring );
+		return NULL;
+	}
+
+	ring->sq_len = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	ring->cq_len = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+	if ( params.features & IORING_FEAT_SINGLE_MMAP )
+		if ( ring->cq_len > ring->sq_len )
+			ring->sq_len = ring->cq_len;
+	ring->sq_ptr = mmap( NULL, ring->sq_len, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, ring->ring_fd, IORING_OFF_SQ_RING );
+	if ( ring->sq_ptr == MAP_FAILED )
+	{
+		CloseURing( ring );
+		return NULL;
+	}
+	if ( params.features & IORING_FEAT_SINGLE_MMAP )
+		ring->cq_ptr = ring->sq_ptr;
+	else
+	{
+		ring->cq_ptr = mmap( NULL, ring->cq_len, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, ring->ring_fd, IORING_OFF_CQ_RING );
+		if ( ring->cq_ptr == MAP_FAILED )
+		{
+			CloseURing( ring );
+			return NULL;
+		}
+	}
+	ring->sqe_len = params.sq_entries * sizeof(struct io_uring_sqe);
+	ring->sqes = mmap( NULL, ring->sqe_len, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, ring->ring_fd, IORING_OFF_SQES );
+	if ( ring->sqes == MAP_FAILED )
+	{
+		CloseURing( ring );
+		return NULL;
+	}
+
+	sq = (unsigned char*)ring->sq_ptr;
+	cq = (unsigned char*)ring->cq_ptr;
+	ring->sq_head  = (unsigned*)( sq + params.sq_off.head );
+	ring->sq_tail  = (unsigned*)( sq + params.sq_off.tail );
+	ring->sq_mask  = (unsigned*)( sq + params.sq_off.ring_mask );
+	ring->sq_array = (unsigned*)( sq + params.sq_off.array );
+	ring->cq_head  = (unsigned*)( cq + params.cq_off.head );
+	ring->cq_tail  = (unsigned*)( cq + params.cq_off.tail );
+	ring->cq_mask  = (unsigned*)( cq + params.cq_off.ring_mask );
+	ring->cqes     = (struct io_uring_cqe*)( cq + params.cq_off.cqes );
+	return ring;
+}
+
+static struct io_uring_sqe* URingSqe( REC_URING_RING* pRing )
+{
+	unsigned tail = *pRing->sq_tail;
+	unsigned index = tail & *pRing->sq_mask;
+	struct io_uring_sqe* sqe = &pRing->sqes[index];
+	memset( sqe, 0, sizeof(*sqe) );
+	pRing->sq_array[index] = index;
+	__atomic_store_n( pRing->sq_tail, tail+1, __ATOMIC_RELEASE );
+	pRing->to_submit++;
+	return sqe;
+}
+
+static int URingSubmit( REC_URING_RING* pRing, unsigned nComplete )
+{
+	int ret;
+	do {
+		ret = URingEnter( pRing->ring_fd, pRing->to_submit, nComplete, nComplete ? IORING_ENTER_GETEVENTS : 0 );
+	} while ( ret < 0 && errno == EINTR );
+	if ( ret >= 0 )
+		pRing->to_submit -= ret < pRing->to_submit ? ret : pRing->to_submit;
+	return ret;
+}
+
+static int SubmitURing( RECORD_WRITER* pWriter )
+{
+	REC_URING_RING* ring = pWriter->uring;
+	int i, j, seg;
+
+	for ( i = 0; i<pWriter->queued; i++ )
+	{
+		int index = (pWriter->head+pWriter->inflight+i) % pWriter->buffer_num;
+		REC_BUFFER* buffer = &pWriter->buffer[index];
+		seg = BufferSegments( pWriter, buffer );
+		for ( j = 0; j<seg; j++ )
+		{
+			struct io_uring_sqe* sqe = URingSqe( ring );
+			sqe->opcode = IORING_OP_WRITEV;
+			sqe->fd = pWriter->fd;
+			sqe->addr = (unsigned long)&buffer->iov[j];
+			sqe->len = 1;
+			sqe->off = buffer->seg_offset[j];
+			sqe->user_data = index*2+j;
+		}
+		buffer->ops = seg;
+		pWriter->unsynced_bytes += buffer->bytes;
+	}
+	pWriter->inflight += pWriter->queued;
+	pWriter->queued = 0;
+
+	//datasync runs after all writes queued ahead of it
+	if ( !pWriter->sync_inflight && SyncDue( pWriter ) )
+	{
+		struct io_uring_sqe* sqe = URingSqe( ring );
+		sqe->opcode = IORING_OP_FSYNC;
+		sqe->fd = pWriter->fd;
+		sqe->flags = IOSQE_IO_DRAIN;
+		sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+		sqe->user_data = REC_SYNC_TAG;
+		pWriter->sync_inflight = 1;
+		pWriter->unsynced_bytes = 0;
+		pWriter->last_sync = RecTick( );
+	}
+
+	if ( URingSubmit( ring, 0 ) < 0 )
+	{
+		SageLog(( _LOG_ERROR, 3, TEXT("RecordWriter: io_uring submit failed, errno:%d"), errno ));
+		pWriter->error = 1;
+		return -1;
+	}
+	return 0;
+}
+
+//reap completions till no more than nInflight buffers are in flight
+static int ReapURing( RECORD_WRITER* pWriter, int nInflight, int bSync )
+{
+	REC_URING_RING* ring = pWriter->uring;
+	for ( ;; )
+	{
+		unsigned head = *ring->cq_head;
+		while ( head != __atomic_load_n( ring->cq_tail, __ATOMIC_ACQUIRE ) )
+		{
+			struct io_uring_cqe* cqe = &ring->cqes[ head & *ring->cq_mask ];
+			if ( cqe->user_data == REC_SYNC_TAG )
+			{
+				pWriter->sync_inflight = 0;
+			} else
+			{
+				REC_BUFFER* buffer = &pWriter->buffer[ cqe->user_data/2 ];
+				int seg = (int)( cqe->user_data & 1 );
+				if ( cqe->res < 0 || (size_t)cqe->res < buffer->iov[seg].iov_len )
+				{
+					//finish a short or failed write synchronously
+					struct iovec iov;
+					size_t done = cqe->res < 0 ? 0 : (size_t)cqe->res;
+					iov.iov_base = (char*)buffer->iov[seg].iov_base + done;
+					iov.iov_len = buffer->iov[seg].iov_len - done;
+					if ( WriteRun( pWriter, &iov, 1, buffer->seg_offset[seg] + done ) )
+						pWriter->error = 1;
+				}
+				buffer->ops--;
+			}
+			head++;
+		}
+		__atomic_store_n( ring->cq_head, head, __ATOMIC_RELEASE );
+
+		while ( pWriter->inflight > 0 && pWriter->buffer[pWriter->head].ops == 0 )
+		{
+			pWriter->head = (pWriter->head+1) % pWriter->buffer_num;
+			pWriter->inflight--;
+		}
+		if ( pWriter->inflight <= nInflight && !( bSync && pWriter->sync_inflight ) )
+			break;
+		if ( URingSubmit( ring, 1 ) < 0 )
+		{
+			SageLog(( _LOG_ERROR, 3, TEXT("RecordWriter: io_uring wait failed, errno:%d"), errno ));
+			pWriter->error = 1;
+			return -1;
+		}
+	}
+	return 0;
+}
+
+#endif
+
+static int SubmitBuffers( RECORD_WRITER* pWriter )
+{
+	if ( pWriter->queued == 0 )
+		return 0;
+#ifdef REC_URING
+	if ( pWriter->uring != NULL )
+		return SubmitURing( pWriter );
+#endif
+	return SubmitPWritev( pWriter );
+}
+
+static int WaitBuffers( RECORD_WRITER* pWriter, int nInflight, int bSync )
+{
+#ifdef REC_URING
+	if ( pWriter->uring != NULL )
+		return ReapURing( pWriter, nInflight, bSync );
+#endif
+	return 0;
+}
+
+static void NewFillBuffer( RECORD_WRITER* pWriter )
+{
+	REC_BUFFER* buffer;
+	//ring is full, the next fill buffer is still in flight
+	if ( pWriter->inflight+pWriter->queued >= pWriter->buffer_num )
+	{
+		SubmitBuffers( pWriter );
+		WaitBuffers( pWriter, pWriter->buffer_num-1, 0 );
+	}
+	buffer = FillBuffer( pWriter );
+	buffer->bytes = 0;
+	buffer->offset = pWriter->file_pos;
+}
+
+static void SealFillBuffer( RECORD_WRITER* pWriter )
+{
+	REC_BUFFER* buffer = FillBuffer( pWriter );
+	pWriter->file_pos = WrapPos( pWriter, buffer->offset + buffer->bytes );
+	pWriter->queued++;
+	if ( pWriter->queued >= pWriter->batch )
+		SubmitBuffers( pWriter );
+	NewFillBuffer( pWriter );
+}
+
+static void SetDirectIO( RECORD_WRITER* pWriter, int bDirect )
+{
+#ifdef O_DIRECT
+	fcntl( pWriter->fd, F_SETFL, bDirect ? pWriter->fd_flags|O_DIRECT : pWriter->fd_flags );
+#endif
+}
+
+void* OpenRecordWriter( int nFd, ULONGLONG lCircFileSize, int nBufferSize, int nBufferNum, int nFlag )
+{
+	RECORD_WRITER* writer;
+	ULONGLONG pos;
+	int i;
+
+	if ( nFd < 0 )
+		return NULL;
+	if ( nBufferSize <= 0 ) nBufferSize = REC_BUFFER_SIZE;
+	if ( nBufferNum <= 0 )  nBufferNum = REC_BUFFER_NUM;
+	if ( nBufferNum < 2 ) nBufferNum = 2;
+	if ( nBufferNum > REC_MAX_BUFFER ) nBufferNum = REC_MAX_BUFFER;
+	nBufferSize = ( nBufferSize + REC_ALIGN-1 ) & ~(REC_ALIGN-1);
+	if ( lCircFileSize && (ULONGLONG)nBufferSize > lCircFileSize )
+		nBufferSize = (int)lCircFileSize;
+
+	writer = SAGETV_MALLOC( sizeof(RECORD_WRITER) );
+	if ( writer == NULL )
+		return NULL;
+	writer->fd = nFd;
+	writer->circ_size = lCircFileSize;
+	writer->buffer_size = nBufferSize;
+	writer->buffer_num = nBufferNum;
+	writer->batch = nBufferNum/2;
+	writer->buffer = SAGETV_MALLOC( sizeof(REC_BUFFER)*nBufferNum );
+	writer->pool = SAGETV_MALLOC( nBufferSize*nBufferNum + REC_ALIGN );
+	if ( writer->buffer == NULL || writer->pool == NULL )
+	{
+		SageLog(( _LOG_TRACE, 3, TEXT("RecordWriter: no memory for %d buffers of %d bytes"), nBufferNum, nBufferSize ));
+		SAGETV_FREE( writer->pool );
+		SAGETV_FREE( writer->buffer );
+		SAGETV_FREE( writer );
+		return NULL;
+	}
+	for ( i = 0; i<nBufferNum; i++ )
+		writer->buffer[i].data = (unsigned char*)( ( (size_t)writer->pool + REC_ALIGN-1 ) & ~(size_t)(REC_ALIGN-1) ) + i*nBufferSize;
+
+#ifdef WIN32
+	pos = _lseeki64( nFd, 0, SEEK_CUR );
+#else
+	pos = lseek( nFd, 0, SEEK_CUR );
+	writer->fd_flags = fcntl( nFd, F_GETFL );
+#endif
+	if ( (LONGLONG)pos < 0 ) pos = 0;
+	writer->file_pos = WrapPos( writer, pos );
+
+#ifdef O_DIRECT
+	if ( nFlag & RECORD_WRITER_DIRECT )
+	{
+		//O_DIRECT needs aligned offsets, the circular file end is a wrap point
+		if ( ( writer->file_pos & (REC_ALIGN-1) ) || ( lCircFileSize & (REC_ALIGN-1) ) ||
+			 fcntl( nFd, F_SETFL, writer->fd_flags|O_DIRECT ) < 0 )
+			SageLog(( _LOG_TRACE, 3, TEXT("RecordWriter: O_DIRECT isn't usable on the file, use page cache") ));
+		else
+			writer->direct = 1;
+	}
+#endif
+
+	writer->engine = RECORD_WRITER_PWRITEV;
+#ifdef REC_URING
+	if ( ( nFlag & RECORD_WRITER_ENGINE ) != RECORD_WRITER_PWRITEV )
+	{
+		writer->uring = OpenURing( nBufferNum*2+2 );
+		if ( writer->uring != NULL )
+			writer->engine = RECORD_WRITER_URING;
+	}
+#endif
+
+	writer->last_sync = RecTick( );
+	NewFillBuffer( writer );
+	SageLog(( _LOG_TRACE, 3, TEXT("RecordWriter: open fd:%d engine:%s%s buffer:%dx%d circular:%lld"), nFd,
+		RecordWriterEngineName( writer->engine ), writer->direct ? " direct" : "", nBufferNum, nBufferSize, lCircFileSize ));
+	return writer;
+}
+
+int PushRecordData( void* Handle, const unsigned char* pData, int nBytes )
+{
+	RECORD_WRITER* writer = (RECORD_WRITER*)Handle;
+	int bytes = nBytes;
+	if ( writer == NULL || pData == NULL )
+		return 0;
+	while ( bytes > 0 )
+	{
+		REC_BUFFER* buffer = FillBuffer( writer );
+		int size = writer->buffer_size - buffer->bytes;
+		if ( size > bytes ) size = bytes;
+		memcpy( buffer->data + buffer->bytes, pData, size );
+		buffer->bytes += size;
+		pData += size;
+		bytes -= size;
+		if ( buffer->bytes == writer->buffer_size )
+			SealFillBuffer( writer );
+	}
+	return writer->error ? 0 : nBytes;
+}
+
+int FlushRecordWriter( void* Handle )
+{
+	RECORD_WRITER* writer = (RECORD_WRITER*)Handle;
+	REC_BUFFER *buffer, *tail_buffer;
+	int tail;
+	if ( writer == NULL )
+		return 0;
+
+	buffer = FillBuffer( writer );
+	tail = writer->direct ? ( buffer->bytes & (REC_ALIGN-1) ) : 0;
+	if ( buffer->bytes > tail )
+	{
+		buffer->bytes -= tail;
+		writer->file_pos = WrapPos( writer, buffer->offset + buffer->bytes );
+		writer->queued++;
+	}
+	SubmitBuffers( writer );
+	WaitBuffers( writer, 0, 0 );
+
+	if ( buffer->bytes > 0 && buffer != FillBuffer( writer ) )
+	{
+		//the aligned part is written, the unaligned tail stays in a fill buffer and is rewritten
+		//with O_DIRECT once the block fills up
+		tail_buffer = FillBuffer( writer );
+		tail_buffer->offset = writer->file_pos;
+		tail_buffer->bytes = tail;
+		if ( tail )
+			memcpy( tail_buffer->data, buffer->data + buffer->bytes, tail );
+		buffer = tail_buffer;
+	}
+	if ( tail )
+	{
+		//make the tail visible to readers through page cache
+		struct iovec iov;
+		iov.iov_base = buffer->data;
+		iov.iov_len = tail;
+		SetDirectIO( writer, 0 );
+		if ( WriteRun( writer, &iov, 1, buffer->offset ) )
+			writer->error = 1;
+		SetDirectIO( writer, 1 );
+	}
+	return writer->error ? 0 : 1;
+}
+
+int CloseRecordWriter( void* Handle )
+{
+	RECORD_WRITER* writer = (RECORD_WRITER*)Handle;
+	REC_BUFFER* buffer;
+	int ret;
+	if ( writer == NULL )
+		return 0;
+	ret = FlushRecordWriter( writer );
+	WaitBuffers( writer, 0, 1 );
+	buffer = FillBuffer( writer );
+#ifdef REC_URING
+	if ( writer->uring != NULL )
+		CloseURing( writer->uring );
+#endif
+	if ( writer->direct )
+		SetDirectIO( writer, 0 );
+#ifndef WIN32
+	//leave fd at the end of data for caller
+	lseek( writer->fd, WrapPos( writer, buffer->offset + buffer->bytes ), SEEK_SET );
+#endif
+	SAGETV_FREE( writer->pool );
+	SAGETV_FREE( writer->buffer );
+	SAGETV_FREE( writer );
+	return ret;
+}
+
+void SetupRecordWriterSync( void* Handle, unsigned long lSyncBytes, unsigned long lSyncInterval )
+{
+	RECORD_WRITER* writer = (RECORD_WRITER*)Handle;
+	if ( writer == NULL )
+		return;
+	writer->sync_bytes = lSyncBytes;
+	writer->sync_interval = lSyncInterval;
+	writer->last_sync = RecTick( );
+}
+
+int RecordWriterEngine( void* Handle )
+{
+	RECORD_WRITER* writer = (RECORD_WRITER*)Handle;
+	return writer != NULL ? writer->engine : 0;
+}
+
+char* RecordWriterEngineName( int nEngine )
+{
+	switch ( nEngine & RECORD_WRITER_ENGINE ) {
+	case RECORD_WRITER_PWRITEV: return "pwritev";
+	case RECORD_WRITER_URING:   return "io_uring";
+	}
+	return "auto";
+}
@@ -0,0 +1,48 @@
+/*
+ * Copyright 2015 The SageTV Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef RECORD_WRITER_H
+#define RECORD_WRITER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//engine, 0 picks io_uring when the kernel has it, pwritev otherwise
+#define RECORD_WRITER_AUTO     0x00
+#define RECORD_WRITER_PWRITEV  0x01
+#define RECORD_WRITER_URING    0x02
+#define RECORD_WRITER_ENGINE   0x0f
+//write full buffers with O_DIRECT, the unaligned tail of a flush goes through page cache
+#define RECORD_WRITER_DIRECT   0x10
+
+//recording writer on an opened file descriptor, data are gathered in a ring of aligned buffers and
+//written by positioned batch writes. lCircFileSize is the size of a circular file, 0 for a linear file.
+//nBufferSize/nBufferNum of 0 take default. The fd stays owned by caller, it's not closed by CloseRecordWriter.
+void* OpenRecordWriter( int nFd, ULONGLONG lCircFileSize, int nBufferSize, int nBufferNum, int nFlag );
+int   PushRecordData( void* Handle, const unsigned char* pData, int nBytes );
+int   FlushRecordWriter( void* Handle );
+int   CloseRecordWriter( void* Handle );
+//fdatasync once every lSyncBytes written or lSyncInterval ms, 0 disables it.
+void  SetupRecordWriterSync( void* Handle, unsigned long lSyncBytes, unsigned long lSyncInterval );
+int   RecordWriterEngine( void* Handle );
+char* RecordWriterEngineName( int nEngine );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -510,8 +510,7 @@ static int RemuxMessageDumper( void* pContext, unsigned char* pData, int nSize )
 					//dump a system head block (PACK+SYSTEM HEADER)
 					output_data.data_ptr = pRemuxer->ps_builder->block_buffer; 
 					output_data.bytes    = pRemuxer->ps_builder->system_packet_bytes;
-					pRemuxer->ps_builder->dumper.stream_dumper( pRemuxer->ps_builder->dumper.stream_dumper_context, 
-						                              &output_data, sizeof(output_data) );
+					PSBuilderOutputData( pRemuxer->ps_builder, &output_data, NULL );
 					//PadingBuffer( pRemuxer->ps_builder->block_buffer, pRemuxer->ps_builder->buffer_size ); //clean up pading buffer
 					pRemuxer->ps_builder->system_packet_bytes = 0;
 				} else
@@ -525,12 +524,13 @@ static int RemuxMessageDumper( void* pContext, unsigned char* pData, int nSize )
 						ASSERT( block_buffer->buffer_size >= pRemuxer->ps_builder->system_packet_bytes );
 						memcpy( block_buffer->buffer_start, pRemuxer->ps_builder->block_buffer, 
 															pRemuxer->ps_builder->system_packet_bytes );
+						pRemuxer->ps_builder->copy_bytes += pRemuxer->ps_builder->system_packet_bytes;
 						//PadingBuffer( block_buffer->data_start+pRemuxer->ps_builder->system_packet_bytes, 
 						//	          block_buffer->data_size-pRemuxer->ps_builder->system_packet_bytes ); 
 						output_data.data_ptr = block_buffer->data_start; 
 						output_data.bytes    = pRemuxer->ps_builder->system_packet_bytes;
-						pRemuxer->ps_builder->dumper.stream_dumper( pRemuxer->ps_builder->dumper.stream_dumper_context, 
-																					  &output_data, sizeof(output_data) );
+						//the block goes back right away, it can't be held
+						PSBuilderOutputData( pRemuxer->ps_builder, &output_data, NULL );
 						ReturnBlockBuffer( pRemuxer->demuxer, block_buffer );
 					}
 				}
@@ -860,6 +860,41 @@ void SetupRemuxOutputBlockSize( void* Handle, int nSize )
 		SetupBlockDataSize( pRemuxer->ts_builder, nSize );
 }
 
+void SetupRemuxOutputIOVDump( void* Handle, DUMP pfnIOVDump, void* pIOVDumpContext )
+{
+	REMUXER *pRemuxer = (REMUXER *)Handle;
+	if ( pRemuxer->ps_builder )
+	{
+		pRemuxer->ps_builder->dumper.iov_dumper = pfnIOVDump;
+		pRemuxer->ps_builder->dumper.iov_dumper_context = pIOVDumpContext;
+	}
+	if ( pRemuxer->ts_builder )
+	{
+		pRemuxer->ts_builder->dumper.iov_dumper = pfnIOVDump;
+		pRemuxer->ts_builder->dumper.iov_dumper_context = pIOVDumpContext;
+	}
+}
+
+void GetRemuxCopyStat( void* Handle, ULONGLONG* pCopyBytes, ULONGLONG* pOutputBytes )
+{
+	REMUXER *pRemuxer = (REMUXER *)Handle;
+	ULONGLONG copy_bytes = 0, output_bytes = 0;
+	if ( pRemuxer->demuxer->ts_parser )
+		copy_bytes += pRemuxer->demuxer->ts_parser->es_copy_bytes;
+	if ( pRemuxer->ps_builder )
+	{
+		copy_bytes   += pRemuxer->ps_builder->copy_bytes;
+		output_bytes += pRemuxer->ps_builder->output_bytes;
+	}
+	if ( pRemuxer->ts_builder )
+	{
+		copy_bytes   += pRemuxer->ts_builder->copy_bytes;
+		output_bytes += (ULONGLONG)pRemuxer->ts_builder->output_packets*pRemuxer->ts_builder->packet_length;
+	}
+	if ( pCopyBytes != NULL )   *pCopyBytes = copy_bytes;
+	if ( pOutputBytes != NULL ) *pOutputBytes = output_bytes;
+}
+
 void ResetRemuxStream( void* Handle )
 {
 	REMUXER *pRemuxer = (REMUXER *)Handle;
@@ -1137,13 +1172,7 @@ static void _output_statistic( REMUXER *pRemuxer )
 
 unsigned char* _search_data_( unsigned char* match, int len, unsigned char* data, int data_size )
 {
-	int i;
-	for ( i = 0; i<data_size-len; i++ )
-	
-		if ( !memcmp( match, data+i, len ) )
-			return data+i;
-	
-	return NULL;
+	return (unsigned char*)SearchBytes( data, data_size, match, len );
 }
 /*
 static void _s_(unsigned char*data, int size)
@@ -69,6 +69,11 @@ void ResetRemuxStreamSlot( void* Handle, int nSlot );
 void FlushRemuxStream( void* Handle );
 void ChangeRemuxOutputFormat( void* Handle, int nOutputFormat );
 void SetupRemuxOutputBlockSize( void* Handle, int nSize );
+//output goes to pfnIOVDump as OUTPUT_IOV slices instead of OUTPUT_DATA, a PS pack of a TS source isn't copied
+//out of its ES block and the consumer may hold the block (HoldBlockBuffer) to batch packs into one writev
+void SetupRemuxOutputIOVDump( void* Handle, DUMP pfnIOVDump, void* pIOVDumpContext );
+//bytes copied inside the remuxer (ES block assembly, output packing) and bytes output since open or reset
+void GetRemuxCopyStat( void* Handle, ULONGLONG* pCopyBytes, ULONGLONG* pOutputBytes );
 void SetupRemuxStreamTune( void* Handle, TUNE *pTune );
 void SetupRemuxTSStreamFormat( void* Handle, int nFormat, int nSubFormat );
 void DisableMultipleAudio( void* Handle );
@@ -230,3 +230,22 @@ TUNE_LIST *GetScanTuneList( SCAN_FILTER* pScanFilter )
 	return GetTuneList( pScanFilter->pScan );
 }
 
+void ScanChannelNeedTables( SCAN_FILTER* pScanFilter, int nTables )
+{
+	if ( pScanFilter->pScan != NULL )
+		ChannelScanNeedTables( pScanFilter->pScan, (unsigned short)nTables );
+}
+
+int ScanChannelTables( SCAN_FILTER* pScanFilter )
+{
+	if ( pScanFilter->pScan == NULL )
+		return 0;
+	return ChannelScanTablesDone( pScanFilter->pScan );
+}
+
+void ScanChannelNetwork( SCAN_FILTER* pScanFilter, TUNE_LIST* pTuneList )
+{
+	if ( pScanFilter->pScan != NULL )
+		ChannelScanNetwork( pScanFilter->pScan, pTuneList );
+}
+
@@ -51,6 +51,10 @@ int	 ScanChannelNum( SCAN_FILTER* pScanFilter );
 int	 ScanChannelTimeClock( SCAN_FILTER* pScanFilter, unsigned long lMillionSecond );
 struct CHANNEL_LIST *GetScanChannelList( SCAN_FILTER* pScanFilter );
 struct TUNE_LIST    *GetScanTuneList( SCAN_FILTER* pScanFilter );
+//after StartChannelScan, see ChannelScanNeedTables and ChannelScanNetwork
+void ScanChannelNeedTables( SCAN_FILTER* pScanFilter, int nTables );
+int	 ScanChannelTables( SCAN_FILTER* pScanFilter );
+void ScanChannelNetwork( SCAN_FILTER* pScanFilter, struct TUNE_LIST* pTuneList );
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,378 @@
+/*
+ * Copyright 2015 The SageTV Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "NativeCore.h"
+#include "ChannelScan.h"
+#include "ScanScheduler.h"
+
+#ifndef WIN32
+#include <pthread.h>
+#define SCHED_THREAD
+#endif
+
+typedef struct SCAN_FREQ
+{
+	TUNE  tune;
+	unsigned char  state;		//SCAN_FREQ_xx
+	unsigned char  in_nit;		//a NIT carries it
+	unsigned char  found;		//channels of tsid are found on it
+	unsigned char  padding;
+	short tuner;
+	unsigned short onid;		//transport stream the NIT gives, or found on it
+	unsigned short tsid;
+	unsigned short channel_num;
+} SCAN_FREQ;
+
+typedef struct SCAN_SCHEDULER
+{
+#ifdef SCHED_THREAD
+	pthread_mutex_t lock;
+#endif
+	int   flags;
+	int   freq_num;
+	int   total_freq_num;
+	SCAN_FREQ* freq;
+	int   network_ready;		//a complete NIT is in network
+	TUNE_LIST    network;
+	CHANNEL_LIST channel_list;
+} SCAN_SCHEDULER;
+
+static void SchedLock( SCAN_SCHEDULER* pSched )
+{
+#ifdef SCHED_THREAD
+	pthread_mutex_lock( &pSched->lock );
+#endif
+}
+
+static void SchedUnlock( SCAN_SCHEDULER* pSched )
+{
+#ifdef SCHED_THREAD
+	pthread_mutex_unlock( &pSched->lock );
+#endif
+}
+
+//freq is the first of T, C and S tune
+static unsigned long TuneFreq( TUNE* pTune )
+{
+	if ( pTune->stream_format == ATSC_STREAM )
+		return pTune->u.atsc.u.atsc.freq;
+	return pTune->u.dvb.dvb.s.freq;
+}
+
+//NIT and frequency tables may round frequencies differently
+static int SameFreq( unsigned long lFreq1, unsigned long lFreq2 )
+{
+	unsigned long diff = lFreq1 > lFreq2 ? lFreq1 - lFreq2 : lFreq2 - lFreq1;
+	return diff <= _MAX( lFreq1, lFreq2 )/2000;
+}
+
+static int FindFreq( SCAN_SCHEDULER* pSched, TUNE_DAT* pTuneDat, int nSubFormat )
+{
+	int i;
+	for ( i = 0; i<pSched->freq_num; i++ )
+	{
+		TUNE* tune = &pSched->freq[i].tune;
+		if ( !SameFreq( TuneFreq( tune ), pTuneDat->u.s.freq ) )
+			continue;
+		if ( nSubFormat == SATELLITE && tune->u.dvb.dvb.s.pol && pTuneDat->u.s.pol && tune->u.dvb.dvb.s.pol != pTuneDat->u.s.pol )
+			continue;
+		return i;
+	}
+	return -1;
+}
+
+static void AddFreq( SCAN_SCHEDULER* pSched, TUNE* pTune )
+{
+	if ( pSched->freq_num == pSched->total_freq_num )
+	{
+		SCAN_FREQ* old_freq = pSched->freq;
+		pSched->total_freq_num += 32;
+		pSched->freq = SAGETV_MALLOC( pSched->total_freq_num*sizeof(SCAN_FREQ) );
+		if ( old_freq != NULL )
+		{
+			memcpy( pSched->freq, old_freq, pSched->freq_num*sizeof(SCAN_FREQ) );
+			SAGETV_FREE( old_freq );
+		}
+	}
+	memset( &pSched->freq[pSched->freq_num], 0, sizeof(SCAN_FREQ) );
+	pSched->freq[pSched->freq_num].tune = *pTune;
+	pSched->freq[pSched->freq_num].tuner = -1;
+	pSched->freq_num++;
+}
+
+static int SameChannel( CHANNEL_DAT* pChannel1, CHANNEL_DAT* pChannel2, int nStreamFormat )
+{
+	if ( nStreamFormat == ATSC_STREAM )
+		return pChannel1->u.atsc.major_num == pChannel2->u.atsc.major_num &&
+			   pChannel1->u.atsc.minor_num == pChannel2->u.atsc.minor_num &&
+			   pChannel1->u.atsc.program_id == pChannel2->u.atsc.program_id &&
+			   pChannel1->u.atsc.physical_ch == pChannel2->u.atsc.physical_ch;
+	return pChannel1->u.dvb.onid == pChannel2->u.dvb.onid &&
+		   pChannel1->u.dvb.tsid == pChannel2->u.dvb.tsid &&
+		   pChannel1->u.dvb.sid  == pChannel2->u.dvb.sid;
+}
+
+static int MergeChannels( CHANNEL_LIST* pMerged, CHANNEL_LIST* pChannelList )
+{
+	int i, j, num = 0;
+	if ( pMerged->channel_num == 0 )
+	{
+		pMerged->stream_format = pChannelList->stream_format;
+		pMerged->sub_format = pChannelList->sub_format;
+	}
+	for ( i = 0; i<pChannelList->channel_num; i++ )
+	{
+		if ( pChannelList->channel[i].state == 0 )
+			continue;
+		for ( j = 0; j<pMerged->channel_num; j++ )
+			if ( SameChannel( &pMerged->channel[j], &pChannelList->channel[i], pMerged->stream_format ) )
+				break;
+		if ( j < pMerged->channel_num )
+			continue;
+		if ( pMerged->channel_num == pMerged->total_list_num )
+		{
+			CHANNEL_DAT* old_channel = pMerged->channel;
+			pMerged->total_list_num += 64;
+			pMerged->channel = SAGETV_MALLOC( pMerged->total_list_num*sizeof(CHANNEL_DAT) );
+			if ( old_channel != NULL )
+			{
+				memcpy( pMerged->channel, old_channel, pMerged->channel_num*sizeof(CHANNEL_DAT) );
+				SAGETV_FREE( old_channel );
+			}
+		}
+		pMerged->channel[pMerged->channel_num++] = pChannelList->channel[i];
+		num++;
+	}
+	return num;
+}
+
+static void MergeNetwork( SCAN_SCHEDULER* pSched, TUNE_LIST* pTuneList, TUNE* pTemplate )
+{
+	TUNE template_tune = *pTemplate; //the freq table grows
+	int i, j;
+	if ( pSched->network.tune_num == 0 )
+	{
+		pSched->network.stream_format = pTuneList->stream_format;
+		pSched->network.sub_format = pTuneList->sub_format;
+	}
+	for ( i = 0; i<pTuneList->tune_num; i++ )
+	{
+		TUNE_DAT* tune_dat = &pTuneList->tune[i];
+		for ( j = 0; j<pSched->network.tune_num; j++ )
+			if ( pSched->network.tune[j].onid == tune_dat->onid && pSched->network.tune[j].tsid == tune_dat->tsid )
+				break;
+		if ( j == pSched->network.tune_num )
+		{
+			if ( pSched->network.tune_num == pSched->network.total_list_num )
+			{
+				TUNE_DAT* old_tune = pSched->network.tune;
+				pSched->network.total_list_num += 32;
+				pSched->network.tune = SAGETV_MALLOC( pSched->network.total_list_num*sizeof(TUNE_DAT) );
+				if ( old_tune != NULL )
+				{
+					memcpy( pSched->network.tune, old_tune, pSched->network.tune_num*sizeof(TUNE_DAT) );
+					SAGETV_FREE( old_tune );
+				}
+			}
+			pSched->network.tune[pSched->network.tune_num++] = *tune_dat;
+		}
+
+		//a NIT transport stream moves ahead, or is added
+		if ( ( j = FindFreq( pSched, tune_dat, pTuneList->sub_format ) ) < 0 && ( pSched->flags & SCAN_SCHED_NIT_ADD ) )
+		{
+			TUNE tune = template_tune;
+			tune.u.dvb.dvb.s = tune_dat->u.s;
+			AddFreq( pSched, &tune );
+			j = pSched->freq_num-1;
+			SageLog(( _LOG_TRACE, 3, TEXT("ScanScheduler: add NIT frequency %d onid:%d tsid:%d"),
+					  tune_dat->u.s.freq, tune_dat->onid, tune_dat->tsid ));
+		}
+		if ( j >= 0 && !pSched->freq[j].in_nit )
+		{
+			pSched->freq[j].in_nit = 1;
+			if ( pSched->freq[j].tsid == 0 )
+			{
+				pSched->freq[j].onid = tune_dat->onid;
+				pSched->freq[j].tsid = tune_dat->tsid;
+			}
+		}
+	}
+}
+
+static int TsidFound( SCAN_SCHEDULER* pSched, unsigned short nOnid, unsigned short nTsid )
+{
+	int i;
+	for ( i = 0; i<pSched->freq_num; i++ )
+		if ( pSched->freq[i].found && pSched->freq[i].onid == nOnid && pSched->freq[i].tsid == nTsid )
+			return 1;
+	return 0;
+}
+
+void* CreateScanScheduler( TUNE* pTunes, int nTuneNum, int nFlags )
+{
+	SCAN_SCHEDULER* pSched = SAGETV_MALLOC( sizeof(SCAN_SCHEDULER) );
+	int i;
+#ifdef SCHED_THREAD
+	pthread_mutex_init( &pSched->lock, NULL );
+#endif
+	pSched->flags = nFlags;
+	for ( i = 0; i<nTuneNum; i++ )
+		AddFreq( pSched, &pTunes[i] );
+	SageLog(( _LOG_TRACE, 3, TEXT("ScanScheduler: %d frequencies, flags:0x%x"), nTuneNum, nFlags ));
+	return pSched;
+}
+
+void ReleaseScanScheduler( void* Handle )
+{
+	SCAN_SCHEDULER* pSched = (SCAN_SCHEDULER*)Handle;
+	if ( pSched == NULL )
+		return;
+#ifdef SCHED_THREAD
+	pthread_mutex_destroy( &pSched->lock );
+#endif
+	if ( pSched->freq )
+		SAGETV_FREE( pSched->freq );
+	if ( pSched->network.tune )
+		SAGETV_FREE( pSched->network.tune );
+	if ( pSched->channel_list.channel )
+		SAGETV_FREE( pSched->channel_list.channel );
+	SAGETV_FREE( pSched );
+}
+
+int NextScanTune( void* Handle, int nTuner, TUNE* pTune )
+{
+	SCAN_SCHEDULER* pSched = (SCAN_SCHEDULER*)Handle;
+	int i, index = -1;
+	SchedLock( pSched );
+	for ( i = 0; i<pSched->freq_num; i++ )
+	{
+		if ( pSched->freq[i].state != SCAN_FREQ_PENDING )
+			continue;
+		if ( pSched->freq[i].in_nit )
+		{
+			index = i;
+			break;
+		}
+		if ( index < 0 )
+			index = i;
+	}
+	if ( index >= 0 )
+	{
+		pSched->freq[index].state = SCAN_FREQ_BUSY;
+		pSched->freq[index].tuner = nTuner;
+		*pTune = pSched->freq[index].tune;
+	}
+	SchedUnlock( pSched );
+	return index;
+}
+
+void ScanTuneDone( void* Handle, int nIndex, SCAN* pScan )
+{
+	SCAN_SCHEDULER* pSched = (SCAN_SCHEDULER*)Handle;
+	SCAN_FREQ* freq;
+	int i, skipped = 0;
+	SchedLock( pSched );
+	if ( nIndex < 0 || nIndex >= pSched->freq_num )
+	{
+		SchedUnlock( pSched );
+		return;
+	}
+	freq = &pSched->freq[nIndex];
+	freq->state = SCAN_FREQ_DONE;
+	if ( pScan != NULL )
+	{
+		CHANNEL_LIST* channel_list = GetChannelList( pScan );
+		TUNE_LIST* tune_list = GetTuneList( pScan );
+		if ( channel_list->channel_num > 0 )
+		{
+			freq->channel_num = (unsigned short)MergeChannels( &pSched->channel_list, channel_list );
+			if ( channel_list->stream_format == DVB_STREAM )
+			{
+				freq->onid = channel_list->channel[0].u.dvb.onid;
+				freq->tsid = channel_list->channel[0].u.dvb.tsid;
+				freq->found = 1;
+			}
+		}
+		if ( tune_list->tune_num > 0 && tune_list->stream_format == DVB_STREAM )
+		{
+			MergeNetwork( pSched, tune_list, &freq->tune );
+			freq = &pSched->freq[nIndex];
+		}
+		if ( !pSched->network_ready && ( ChannelScanTablesDone( pScan ) & SCAN_TABLE_NIT ) )
+		{
+			pSched->network_ready = 1;
+			SageLog(( _LOG_TRACE, 3, TEXT("ScanScheduler: NIT is complete on frequency %d, %d transport streams"),
+					  TuneFreq( &freq->tune ), pSched->network.tune_num ));
+		}
+	}
+
+	//a transport stream found on one frequency isn't scanned on another one
+	for ( i = 0; i<pSched->freq_num; i++ )
+	{
+		SCAN_FREQ* f = &pSched->freq[i];
+		if ( f->state != SCAN_FREQ_PENDING )
+			continue;
+		if ( ( pSched->flags & SCAN_SCHED_NIT_ONLY ) && pSched->network_ready && !f->in_nit )
+		{
+			f->state = SCAN_FREQ_SKIPPED;
+			skipped++;
+		} else
+		if ( f->tsid && TsidFound( pSched, f->onid, f->tsid ) )
+		{
+			f->state = SCAN_FREQ_SKIPPED;
+			skipped++;
+		}
+	}
+	SageLog(( _LOG_TRACE, 3, TEXT("ScanScheduler: frequency %d done on tuner %d, channels:%d tsid:%d, skipped:%d"),
+			  TuneFreq( &freq->tune ), freq->tuner, freq->channel_num, freq->tsid, skipped ));
+	SchedUnlock( pSched );
+}
+
+TUNE_LIST* ScanSchedulerNetwork( void* Handle )
+{
+	SCAN_SCHEDULER* pSched = (SCAN_SCHEDULER*)Handle;
+	return pSched->network_ready ? &pSched->network : NULL;
+}
+
+CHANNEL_LIST* ScanSchedulerChannelList( void* Handle )
+{
+	SCAN_SCHEDULER* pSched = (SCAN_SCHEDULER*)Handle;
+	return &pSched->channel_list;
+}
+
+int ScanSchedulerState( void* Handle, int* pDone, int* pSkipped, int* pTotal )
+{
+	SCAN_SCHEDULER* pSched = (SCAN_SCHEDULER*)Handle;
+	int i, left = 0, done = 0, skipped = 0;
+	SchedLock( pSched );
+	for ( i = 0; i<pSched->freq_num; i++ )
+	{
+		if ( pSched->freq[i].state == SCAN_FREQ_DONE )
+			done++;
+		else
+		if ( pSched->freq[i].state == SCAN_FREQ_SKIPPED )
+			skipped++;
+		else
+			left++;
+	}
+	if ( pDone ) *pDone = done;
+	if ( pSkipped ) *pSkipped = skipped;
+	if ( pTotal ) *pTotal = pSched->freq_num;
+	SchedUnlock( pSched );
+	return left;
+}
@@ -0,0 +1,59 @@
+/*
+ * Copyright 2015 The SageTV Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SCAN_SCHEDULER_H
+#define SCAN_SCHEDULER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//channel scan of a source on all of its tuners. A free tuner takes the next frequency of the list, tunes it and
+//runs a ChannelScan till the PSI tables are complete, and gives the scan back. Transport streams the NIT carries
+//are scanned first (SCAN_SCHED_NIT_ADD adds the ones not in the list), a frequency the NIT gives a transport
+//stream already found on another frequency is skipped, and with SCAN_SCHED_NIT_ONLY the ones a complete NIT
+//doesn't carry are skipped. Once a NIT is complete, pass ScanSchedulerNetwork to ChannelScanNetwork of the next
+//scans so they don't wait for the NIT. It doesn't touch a tuner, callers of all tuners may share it.
+#define SCAN_SCHED_NIT_ADD		0x01
+#define SCAN_SCHED_NIT_ONLY		0x02
+
+#define SCAN_FREQ_PENDING		0
+#define SCAN_FREQ_BUSY			1
+#define SCAN_FREQ_DONE			2
+#define SCAN_FREQ_SKIPPED		3
+
+struct SCAN;
+struct TUNE_LIST;
+struct CHANNEL_LIST;
+
+void* CreateScanScheduler( TUNE* pTunes, int nTuneNum, int nFlags );
+void  ReleaseScanScheduler( void* Handle );
+//index of the frequency tuner nTuner scans into pTune, -1 when none is left (scans in progress may add some)
+int   NextScanTune( void* Handle, int nTuner, TUNE* pTune );
+//pScan NULL when the tuner didn't lock
+void  ScanTuneDone( void* Handle, int nIndex, struct SCAN* pScan );
+//NULL till a NIT is complete
+struct TUNE_LIST*    ScanSchedulerNetwork( void* Handle );
+//channels found on all frequencies
+struct CHANNEL_LIST* ScanSchedulerChannelList( void* Handle );
+//frequencies in state SCAN_FREQ_xx, returns pending and busy ones
+int   ScanSchedulerState( void* Handle, int* pDone, int* pSkipped, int* pTotal );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -24,11 +24,14 @@
 static int SectionCrcCheck( TS_SECTION* pSection );
 static int PushSectionData( TS_SECTION* pSection, char* pData, int Bytes );
 static unsigned long GetCrc32( unsigned char* p );
+static int CheckCompletedSection( TS_SECTION* pSection );
+static int RepeatedSectionHeader( TS_SECTION* pSection );
+static int SectionHeaderBytes( unsigned char* pData );
 //static int PopSectionData( TS_SECTION* pSection, char* pData, int Bytes );
 //static void SetCrc32( unsigned char* p, unsigned long crc32 );
 TS_SECTION* CreateSection(  )
 {
-	TS_SECTION* pSection = SAGETV_MALLOC( sizeof(TS_SECTION) );
+	TS_SECTION* pSection = SAGETV_MALLOC_TAG( sizeof(TS_SECTION), MEM_TAG_SECTION );
 	pSection->data = NULL;
 	pSection->section_type = 0xff;
 	pSection->total_bytes = 0;
@@ -52,6 +55,8 @@ void ResetSection( TS_SECTION* pSection )
 	pSection->bytes = 0;
 	pSection->crc32 = 0;
 	pSection->start_offset = 0;
+	pSection->cached = 0;
+	pSection->skip = 0;
 }
 
 static int FlushSectionData( TS_SECTION* pSection )
@@ -85,12 +90,8 @@ static int FlushSectionData( TS_SECTION* pSection )
 
 	if ( PushSectionData( pSection, (char*)section_data, nSize ) )
 	{
-		if ( SectionCrcCheck( pSection ) )
-		{
-			pSection->section_type = *pSection->data;
-			pSection->crc32 = GetCrc32( pSection->data + pSection->total_bytes -4 );
+		if ( CheckCompletedSection( pSection ) )
 			return pSection->bytes;
-		}
 	}
 
 	return 0;
@@ -134,15 +135,13 @@ int UnpackSection( int bStartFlag, TS_SECTION* pSection, const unsigned char*  p
 			{
 				if ( PushSectionData( pSection, (char*)pbData+1, last_bytes ) )
 				{
-					if ( SectionCrcCheck( pSection ) )
+					if ( CheckCompletedSection( pSection ) )
 					{
 						if ( nSize - last_bytes - 1 < sizeof(pSection->left_over ) )
 						{
 							memcpy( pSection->left_over, section_data, nSize - last_bytes - 1 );
 							pSection->left_over_size = nSize - last_bytes - 1;
 						}
-						pSection->section_type = *pSection->data;
-						pSection->crc32 = GetCrc32( pSection->data + pSection->total_bytes -4 );
 						return pSection->bytes + offset;
 					}
 				}
@@ -167,12 +166,8 @@ int UnpackSection( int bStartFlag, TS_SECTION* pSection, const unsigned char*  p
 
 	if ( PushSectionData( pSection, (char*)section_data, nSize-(int)(section_data-pbData) ) )
 	{
-		if ( SectionCrcCheck( pSection ) )
-		{
-			pSection->section_type = *pSection->data;
-			pSection->crc32 = GetCrc32( pSection->data + pSection->total_bytes -4 );
+		if ( CheckCompletedSection( pSection ) )
 			return pSection->bytes + offset;
-		}
 		else
 			return 0;
 	}
@@ -188,6 +183,8 @@ unsigned char* StartSection( TS_SECTION* pSection, int nSectionLength )
 	pSection->total_bytes = nSectionLength + 4; // 4 Byte CRC
 	pSection->bytes = 0;
 	pSection->crc32 = 0;
+	pSection->cached = 0;
+	pSection->skip = 0;
 	return pSection->data;
 }
 
@@ -197,7 +194,27 @@ static int PushSectionData( TS_SECTION* pSection, char* pData, int Bytes )
 	Bytes = _MIN( pSection->total_bytes - pSection->bytes, Bytes );
 	if ( Bytes > 0 )
 	{
-		memcpy( pSection->data + pSection->bytes, pData, Bytes );
+		if ( pSection->skip )
+		{
+			//only tail crc32 of a repeat is kept
+			int tail = pSection->total_bytes-4;
+			if ( pSection->bytes + Bytes > tail )
+			{
+				int offset = _MAX( tail, pSection->bytes );
+				memcpy( pSection->data + offset, pData + offset - pSection->bytes, pSection->bytes + Bytes - offset );
+			}
+			pSection->cache->skipped_bytes += Bytes;
+		} else
+		{
+			memcpy( pSection->data + pSection->bytes, pData, Bytes );
+			if ( pSection->cache != NULL )
+			{
+				int header = SectionHeaderBytes( pSection->data );
+				if ( pSection->bytes < header && pSection->bytes + Bytes >= header && 
+					 pSection->bytes + Bytes < pSection->total_bytes )
+					pSection->skip = RepeatedSectionHeader( pSection );
+			}
+		}
 		pSection->bytes += Bytes;
 	}
 	return  ( pSection->bytes == pSection->total_bytes );
@@ -261,7 +278,7 @@ unsigned char *AllocSectionData( TS_SECTION* pSection, int nDataLength )
 	{
 		if ( pSection->data != NULL )
 			SAGETV_FREE( pSection->data );
-		pSection->data = (unsigned char*)SAGETV_MALLOC( nDataLength );
+		pSection->data = (unsigned char*)SAGETV_MALLOC_TAG( nDataLength, MEM_TAG_SECTION );
 		if ( pSection->data != NULL )
 			pSection->data_size = nDataLength;
 	}
@@ -298,7 +315,7 @@ int SealSectionData( TS_SECTION* pSection, int nDataLength )
 TS_SECTION* DupSection( TS_SECTION* pSection )
 {
 	TS_SECTION* pNewSection = CreateSection(  );
-	pNewSection->data = SAGETV_MALLOC( pSection->total_bytes );
+	pNewSection->data = SAGETV_MALLOC_TAG( pSection->total_bytes, MEM_TAG_SECTION );
 	memcpy( pNewSection->data, pSection->data, pSection->total_bytes );
 	pNewSection->total_bytes =  pSection->total_bytes;
 	pNewSection->section_type = pSection->section_type;
@@ -324,3 +341,204 @@ int BuildSectionHeader( SECTION_HEADER* pSectionHeader, TS_SECTION* pSection )
 	return 8+pSection->start_offset;
 }
 
+/////////////////////////////////////////////////////////////////////////////////////////////////////////
+#define SECTION_CACHE_INIT   256
+static int section_cache_enabled = 1;
+#define SECTION_VERSION( p ) ( ( (p)[5] & 0x3E ) >> 1 )
+
+static ULONGLONG SectionKey( TS_SECTION* pSection )
+{
+	unsigned char* p = pSection->data;
+	return ( 1ULL<<63 )|( (ULONGLONG)pSection->pid<<40 )|( (ULONGLONG)p[0]<<32 )|
+		   ( (ULONGLONG)p[3]<<24 )|( (ULONGLONG)p[4]<<16 )|( p[6]<<8 )|( p[5]&0x01 );
+}
+
+//DVB EIT and SDT of other TSes share table_id_extension (service_id, tsid) across muxes,
+//the tsid/onid after the section header tells them apart
+#define DVB_EIT_TABLE( t )	( (t) >= 0x4e && (t) <= 0x6f )
+#define DVB_SDT_TABLE( t )	( (t) == 0x42 || (t) == 0x46 )
+
+static unsigned long SectionExt( TS_SECTION* pSection )
+{
+	unsigned char* p = pSection->data;
+	if ( DVB_EIT_TABLE( p[0] ) )
+		return ( (unsigned long)p[8]<<24 )|( p[9]<<16 )|( p[10]<<8 )|p[11];
+	if ( DVB_SDT_TABLE( p[0] ) )
+		return ( (unsigned long)p[8]<<24 )|( p[9]<<16 );
+	return 0;
+}
+
+//bytes of a section needed to look up its cache entry
+static int SectionHeaderBytes( unsigned char* pData )
+{
+	return ( DVB_EIT_TABLE( pData[0] ) || DVB_SDT_TABLE( pData[0] ) ) ? 12 : 8;
+}
+
+//Fibonacci hashing, size is power of 2
+static unsigned long CacheSlot( ULONGLONG Key, unsigned long nSize )
+{
+	return (unsigned long)( ( Key * 0x9E3779B97F4A7C15ULL ) >> 32 ) & ( nSize-1 );
+}
+
+static SECTION_CACHE_ENTRY* FindCacheEntry( SECTION_CACHE* pCache, ULONGLONG Key, unsigned long Ext )
+{
+	unsigned long k;
+	if ( pCache->entry == NULL )
+		return NULL;
+	k = CacheSlot( Key^Ext, pCache->size );
+	while ( pCache->entry[k].key )
+	{
+		if ( pCache->entry[k].key == Key && pCache->entry[k].ext == Ext )
+			return &pCache->entry[k];
+		k = ( k+1 ) & ( pCache->size-1 );
+	}
+	return NULL;
+}
+
+static void RehashSectionCache( SECTION_CACHE* pCache, unsigned long nSize )
+{
+	unsigned long i, k;
+	SECTION_CACHE_ENTRY* entry = SAGETV_MALLOC_TAG( sizeof(SECTION_CACHE_ENTRY)*nSize, MEM_TAG_SECTION );
+	for ( i = 0; i<pCache->size; i++ )
+	{
+		if ( pCache->entry[i].key == 0 )
+			continue;
+		k = CacheSlot( pCache->entry[i].key^pCache->entry[i].ext, nSize );
+		while ( entry[k].key )
+			k = ( k+1 ) & ( nSize-1 );
+		entry[k] = pCache->entry[i];
+	}
+	SAGETV_FREE( pCache->entry );
+	pCache->entry = entry;
+	pCache->size = nSize;
+}
+
+//the header of a section being reassembled is of a cached version, its payload is skipped
+static int RepeatedSectionHeader( TS_SECTION* pSection )
+{
+	SECTION_CACHE_ENTRY* entry;
+	if ( pSection->total_bytes < 12 )
+		return 0;
+	entry = FindCacheEntry( pSection->cache, SectionKey( pSection ), SectionExt( pSection ) );
+	return ( entry != NULL && entry->version == SECTION_VERSION( pSection->data ) );
+}
+
+//a completed section of a cached version and tail crc32 is a repeat and isn't crc checked
+static int CheckCompletedSection( TS_SECTION* pSection )
+{
+	pSection->cached = 0;
+	if ( pSection->cache != NULL && pSection->total_bytes >= 12 )
+	{
+		SECTION_CACHE_ENTRY* entry = FindCacheEntry( pSection->cache, SectionKey( pSection ), SectionExt( pSection ) );
+		if ( entry != NULL && entry->version == SECTION_VERSION( pSection->data ) &&
+			 entry->crc32 == GetCrc32( pSection->data + pSection->total_bytes -4 ) )
+		{
+			pSection->cache->hit++;
+			pSection->cached = 1;
+		} else
+		{
+			pSection->cache->miss++;
+			if ( pSection->skip )
+			{
+				//same version but new crc32, payload is lost, the entry is invalidated to reassemble next repeat
+				if ( entry != NULL )
+					entry->version = 0xff;
+				pSection->skip = 0;
+				return 0;
+			}
+		}
+	}
+	if ( !pSection->cached && !SectionCrcCheck( pSection ) )
+		return 0;
+	pSection->skip = 0;
+	pSection->section_type = *pSection->data;
+	pSection->crc32 = GetCrc32( pSection->data + pSection->total_bytes -4 );
+	return 1;
+}
+
+SECTION_CACHE* CreateSectionCache( )
+{
+	if ( !section_cache_enabled )
+		return NULL;
+	return SAGETV_MALLOC_TAG( sizeof(SECTION_CACHE), MEM_TAG_SECTION );
+}
+
+int SectionCacheEnable( int bEnable )
+{
+	int prev = section_cache_enabled;
+	section_cache_enabled = bEnable;
+	return prev;
+}
+
+void ReleaseSectionCache( SECTION_CACHE* pCache )
+{
+	if ( pCache == NULL )
+		return;
+	SAGETV_FREE( pCache->entry );
+	SAGETV_FREE( pCache );
+}
+
+void ResetSectionCache( SECTION_CACHE* pCache )
+{
+	if ( pCache == NULL )
+		return;
+	SAGETV_FREE( pCache->entry );
+	pCache->entry = NULL;
+	pCache->num = 0;
+	pCache->size = 0;
+}
+
+void AttachSectionCache( TS_SECTION* pSection, SECTION_CACHE* pCache, unsigned short nPid )
+{
+	pSection->cache = pCache;
+	pSection->pid = nPid;
+}
+
+//a parser caches a section after it keeps the section's content, its repeats are dropped since then
+void CacheSection( TS_SECTION* pSection )
+{
+	SECTION_CACHE* cache = pSection->cache;
+	SECTION_CACHE_ENTRY* entry;
+	ULONGLONG key;
+	unsigned long ext, k;
+	if ( cache == NULL || pSection->cached || pSection->total_bytes < 12 || pSection->bytes != pSection->total_bytes )
+		return;
+
+	key = SectionKey( pSection );
+	ext = SectionExt( pSection );
+	if ( ( entry = FindCacheEntry( cache, key, ext ) ) == NULL )
+	{
+		if ( ( cache->num+1 )*2 > cache->size )
+			RehashSectionCache( cache, cache->size ? cache->size*2 : SECTION_CACHE_INIT );
+		k = CacheSlot( key^ext, cache->size );
+		while ( cache->entry[k].key )
+			k = ( k+1 ) & ( cache->size-1 );
+		entry = &cache->entry[k];
+		entry->key = key;
+		entry->ext = ext;
+		cache->num++;
+	}
+	entry->version = SECTION_VERSION( pSection->data );
+	entry->crc32 = pSection->crc32;
+}
+
+//a parser can't use a repeat of a cached section, next repeat is reassembled in full
+void UncacheSection( TS_SECTION* pSection )
+{
+	SECTION_CACHE_ENTRY* entry;
+	if ( pSection->cache == NULL || pSection->total_bytes < 12 )
+		return;
+	if ( ( entry = FindCacheEntry( pSection->cache, SectionKey( pSection ), SectionExt( pSection ) ) ) != NULL )
+		entry->version = 0xff;
+}
+
+//sections of a pid are unpacked again, when their contents depend on a table that has been changed
+void UncacheSectionPid( SECTION_CACHE* pCache, unsigned short nPid )
+{
+	unsigned long i;
+	if ( pCache == NULL )
+		return;
+	for ( i = 0; i<pCache->size; i++ )
+		if ( pCache->entry[i].key && (unsigned short)((pCache->entry[i].key>>40)&0x1fff) == nPid )
+			pCache->entry[i].version = 0xff;
+}
@@ -21,6 +21,28 @@
 extern "C" {
 #endif
 
+//sections a parser has unpacked, keyed on pid:table_id:table_id_extension:section_number:current_next,
+//DVB EIT and SDT also on the transport_stream_id/original_network_id that follow the section header.
+//A section completed with the version and tail crc32 of its entry is a repeat, it isn't crc checked
+//and after its header is seen, the rest of its payload isn't copied.
+typedef struct SECTION_CACHE_ENTRY
+{
+	ULONGLONG	   key;				//0 is empty
+	unsigned long  ext;				//DVB EIT tsid:onid, SDT onid, 0 for other tables
+	unsigned long  crc32;
+	unsigned char  version;			//0xff, entry is invalidated
+} SECTION_CACHE_ENTRY;
+
+typedef struct SECTION_CACHE
+{
+	unsigned long  num;
+	unsigned long  size;			//power of 2, doubles when half full
+	SECTION_CACHE_ENTRY *entry;
+	unsigned long  hit;				//repeated sections dropped
+	unsigned long  miss;			//sections reassembled and crc checked
+	unsigned long  skipped_bytes;	//payload bytes of repeats not copied
+} SECTION_CACHE;
+
 typedef struct
 {
 	unsigned char	section_type;     //the first byte section data
@@ -34,6 +56,10 @@ typedef struct
 	unsigned char   padding;
 	unsigned char	left_over[200];   //section data doens't start align with a TS packet, it's left over of unconsumed bytes
 	unsigned long	crc32;			  //crc32 for checking section data updated
+	SECTION_CACHE   *cache;			  //NULL, no cache
+	unsigned short  pid;			  //pid in cache key
+	unsigned char   cached;			  //completed section is a repeat of a cached one, its data isn't checked
+	unsigned char   skip;			  //payload of a repeat is being skipped
 } TS_SECTION;
 
 typedef struct 
@@ -63,6 +89,15 @@ int  SealSectionData( TS_SECTION* pSection, int nDataLength );
 unsigned char* StartSection( TS_SECTION* pSection, int nSectionLength );
 int BuildSectionHeader( SECTION_HEADER* pSectionHeader, TS_SECTION* pSection );
 
+SECTION_CACHE* CreateSectionCache( );		//NULL when section cache is disabled
+int  SectionCacheEnable( int bEnable );		//returns previous setting, applies to caches created after it
+void ReleaseSectionCache( SECTION_CACHE* pCache );
+void ResetSectionCache( SECTION_CACHE* pCache );
+void AttachSectionCache( TS_SECTION* pSection, SECTION_CACHE* pCache, unsigned short nPid );
+void CacheSection( TS_SECTION* pSection );
+void UncacheSection( TS_SECTION* pSection );
+void UncacheSectionPid( SECTION_CACHE* pCache, unsigned short nPid );
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,375 @@
+/*
+ * Copyright 2015 The SageTV Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "NativeCore.h"
+#include "StartCodeScan.h"
+
+//Start code and sync word searching of AVFormat parsers. Two kernels do all work, a key kernel finds 2..4 bytes
+//key (start code prefix, zero run, emulation prevention, head of a pattern), a sync kernel finds masked 16 bits
+//sync words of audio. A SIMD engine is picked at runtime, scalar code is reference.
+#if defined(__GNUC__) && ( defined(__x86_64__) || defined(__i386__) ) && !defined(MINI_PVR)
+#define START_CODE_X86
+#include <emmintrin.h>
+#include <immintrin.h>
+#elif defined(__GNUC__) && defined(__ARM_NEON) && !defined(MINI_PVR)
+#define START_CODE_ARM
+#include <arm_neon.h>
+#endif
+
+static int code_engine = -1;
+
+static int ScanKeyScalar( const unsigned char* p, int nBytes, const unsigned char* pKey, int nKey )
+{
+	int i;
+	for ( i = 0; i+nKey <= nBytes; i++ )
+		if ( p[i] == pKey[0] && p[i+1] == pKey[1] &&
+			 ( nKey < 3 || p[i+2] == pKey[2] ) && ( nKey < 4 || p[i+3] == pKey[3] ) )
+			return i;
+	return -1;
+}
+
+static int ScanSyncScalar( const unsigned char* p, int nBytes, const unsigned char* pSync0, const unsigned char* pSync1,
+						   int nSync, unsigned char nMask )
+{
+	int i, k;
+	for ( i = 0; i+2 <= nBytes; i++ )
+		for ( k = 0; k<nSync; k++ )
+			if ( p[i] == pSync0[k] && (p[i+1] & nMask) == pSync1[k] )
+				return i;
+	return -1;
+}
+
+//vector loops stop where a load of the last key byte passes the end, scalar code finishes the tail
+static int ScanTail( const unsigned char* p, int i, int nBytes, const unsigned char* pKey, int nKey )
+{
+	int pos = ScanKeyScalar( p+i, nBytes-i, pKey, nKey );
+	return pos < 0 ? -1 : i+pos;
+}
+
+static int SyncTail( const unsigned char* p, int i, int nBytes, const unsigned char* pSync0, const unsigned char* pSync1,
+					 int nSync, unsigned char nMask )
+{
+	int pos = ScanSyncScalar( p+i, nBytes-i, pSync0, pSync1, nSync, nMask );
+	return pos < 0 ? -1 : i+pos;
+}
+
+#ifdef START_CODE_X86
+static int ScanKeySSE2( const unsigned char* p, int nBytes, const unsigned char* pKey, int nKey )
+{
+	__m128i k0 = _mm_set1_epi8( (char)pKey[0] );
+	__m128i k1 = _mm_set1_epi8( (char)pKey[1] );
+	__m128i k2 = _mm_set1_epi8( (char)( nKey > 2 ? pKey[2] : 0 ) );
+	__m128i k3 = _mm_set1_epi8( (char)( nKey > 3 ? pKey[3] : 0 ) );
+	int i, bits;
+	for ( i = 0; i+nKey+15 <= nBytes; i += 16 )
+	{
+		__m128i m = _mm_and_si128( _mm_cmpeq_epi8( _mm_loadu_si128( (const __m128i*)(p+i) ), k0 ),
+								   _mm_cmpeq_epi8( _mm_loadu_si128( (const __m128i*)(p+i+1) ), k1 ) );
+		if ( nKey > 2 )
+			m = _mm_and_si128( m, _mm_cmpeq_epi8( _mm_loadu_si128( (const __m128i*)(p+i+2) ), k2 ) );
+		if ( nKey > 3 )
+			m = _mm_and_si128( m, _mm_cmpeq_epi8( _mm_loadu_si128( (const __m128i*)(p+i+3) ), k3 ) );
+		bits = _mm_movemask_epi8( m );
+		if ( bits )
+			return i + __builtin_ctz( bits );
+	}
+	return ScanTail( p, i, nBytes, pKey, nKey );
+}
+
+static int ScanSyncSSE2( const unsigned char* p, int nBytes, const unsigned char* pSync0, const unsigned char* pSync1,
+						 int nSync, unsigned char nMask )
+{
+	__m128i s0[MAX_SYNC_WORD_NUM], s1[MAX_SYNC_WORD_NUM];
+	__m128i mask = _mm_set1_epi8( (char)nMask );
+	int i, k, bits;
+	for ( k = 0; k<nSync; k++ )
+	{
+		s0[k] = _mm_set1_epi8( (char)pSync0[k] );
+		s1[k] = _mm_set1_epi8( (char)pSync1[k] );
+	}
+	for ( i = 0; i+17 <= nBytes; i += 16 )
+	{
+		__m128i d0 = _mm_loadu_si128( (const __m128i*)(p+i) );
+		__m128i d1 = _mm_and_si128( _mm_loadu_si128( (const __m128i*)(p+i+1) ), mask );
+		__m128i m = _mm_setzero_si128( );
+		for ( k = 0; k<nSync; k++ )
+			m = _mm_or_si128( m, _mm_and_si128( _mm_cmpeq_epi8( d0, s0[k] ), _mm_cmpeq_epi8( d1, s1[k] ) ) );
+		bits = _mm_movemask_epi8( m );
+		if ( bits )
+			return i + __builtin_ctz( bits );
+	}
+	return SyncTail( p, i, nBytes, pSync0, pSync1, nSync, nMask );
+}
+
+__attribute__((target("avx2")))
+static int ScanKeyAVX2( const unsigned char* p, int nBytes, const unsigned char* pKey, int nKey )
+{
+	__m256i k0 = _mm256_set1_epi8( (char)pKey[0] );
+	__m256i k1 = _mm256_set1_epi8( (char)pKey[1] );
+	__m256i k2 = _mm256_set1_epi8( (char)( nKey > 2 ? pKey[2] : 0 ) );
+	__m256i k3 = _mm256_set1_epi8( (char)( nKey > 3 ? pKey[3] : 0 ) );
+	int i;
+	unsigned int bits;
+	for ( i = 0; i+nKey+31 <= nBytes; i += 32 )
+	{
+		__m256i m = _mm256_and_si256( _mm256_cmpeq_epi8( _mm256_loadu_si256( (const __m256i*)(p+i) ), k0 ),
+									  _mm256_cmpeq_epi8( _mm256_loadu_si256( (const __m256i*)(p+i+1) ), k1 ) );
+		if ( nKey > 2 )
+			m = _mm256_and_si256( m, _mm256_cmpeq_epi8( _mm256_loadu_si256( (const __m256i*)(p+i+2) ), k2 ) );
+		if ( nKey > 3 )
+			m = _mm256_and_si256( m, _mm256_cmpeq_epi8( _mm256_loadu_si256( (const __m256i*)(p+i+3) ), k3 ) );
+		bits = (unsigned int)_mm256_movemask_epi8( m );
+		if ( bits )
+			return i + __builtin_ctz( bits );
+	}
+	return ScanTail( p, i, nBytes, pKey, nKey );
+}
+
+__attribute__((target("avx2")))
+static int ScanSyncAVX2( const unsigned char* p, int nBytes, const unsigned char* pSync0, const unsigned char* pSync1,
+						 int nSync, unsigned char nMask )
+{
+	__m256i s0[MAX_SYNC_WORD_NUM], s1[MAX_SYNC_WORD_NUM];
+	__m256i mask = _mm256_set1_epi8( (char)nMask );
+	int i, k;
+	unsigned int bits;
+	for ( k = 0; k<nSync; k++ )
+	{
+		s0[k] = _mm256_set1_epi8( (char)pSync0[k] );
+		s1[k] = _mm256_set1_epi8( (char)pSync1[k] );
+	}
+	for ( i = 0; i+33 <= nBytes; i += 32 )
+	{
+		__m256i d0 = _mm256_loadu_si256( (const __m256i*)(p+i) );
+		__m256i d1 = _mm256_and_si256( _mm256_loadu_si256( (const __m256i*)(p+i+1) ), mask );
+		__m256i m = _mm256_setzero_si256( );
+		for ( k = 0; k<nSync; k++ )
+			m = _mm256_or_si256( m, _mm256_and_si256( _mm256_cmpeq_epi8( d0, s0[k] ), _mm256_cmpeq_epi8( d1, s1[k] ) ) );
+		bits = (unsigned int)_mm256_movemask_epi8( m );
+		if ( bits )
+			return i + __builtin_ctz( bits );
+	}
+	return SyncTail( p, i, nBytes, pSync0, pSync1, nSync, nMask );
+}
+
+static int DetectStartCodeEngine( )
+{
+	__builtin_cpu_init( );
+	if ( __builtin_cpu_supports( "avx2" ) )
+		return START_CODE_AVX2;
+	if ( __builtin_cpu_supports( "sse2" ) )
+		return START_CODE_SSE2;
+	return START_CODE_SCALAR;
+}
+#elif defined(START_CODE_ARM)
+//NEON has no movemask, narrowing shift packs a compare result into 4 bits a byte lane
+static inline unsigned long long NeonMask( uint8x16_t m )
+{
+	return vget_lane_u64( vreinterpret_u64_u8( vshrn_n_u16( vreinterpretq_u16_u8( m ), 4 ) ), 0 );
+}
+
+static int ScanKeyNEON( const unsigned char* p, int nBytes, const unsigned char* pKey, int nKey )
+{
+	uint8x16_t k0 = vdupq_n_u8( pKey[0] );
+	uint8x16_t k1 = vdupq_n_u8( pKey[1] );
+	uint8x16_t k2 = vdupq_n_u8( nKey > 2 ? pKey[2] : 0 );
+	uint8x16_t k3 = vdupq_n_u8( nKey > 3 ? pKey[3] : 0 );
+	unsigned long long bits;
+	int i;
+	for ( i = 0; i+nKey+15 <= nBytes; i += 16 )
+	{
+		uint8x16_t m = vandq_u8( vceqq_u8( vld1q_u8( p+i ), k0 ), vceqq_u8( vld1q_u8( p+i+1 ), k1 ) );
+		if ( nKey > 2 )
+			m = vandq_u8( m, vceqq_u8( vld1q_u8( p+i+2 ), k2 ) );
+		if ( nKey > 3 )
+			m = vandq_u8( m, vceqq_u8( vld1q_u8( p+i+3 ), k3 ) );
+		bits = NeonMask( m );
+		if ( bits )
+			return i + ( __builtin_ctzll( bits ) >> 2 );
+	}
+	return ScanTail( p, i, nBytes, pKey, nKey );
+}
+
+static int ScanSyncNEON( const unsigned char* p, int nBytes, const unsigned char* pSync0, const unsigned char* pSync1,
+						 int nSync, unsigned char nMask )
+{
+	uint8x16_t mask = vdupq_n_u8( nMask );
+	unsigned long long bits;
+	int i, k;
+	for ( i = 0; i+17 <= nBytes; i += 16 )
+	{
+		uint8x16_t d0 = vld1q_u8( p+i );
+		uint8x16_t d1 = vandq_u8( vld1q_u8( p+i+1 ), mask );
+		uint8x16_t m = vdupq_n_u8( 0 );
+		for ( k = 0; k<nSync; k++ )
+			m = vorrq_u8( m, vandq_u8( vceqq_u8( d0, vdupq_n_u8( pSync0[k] ) ), vceqq_u8( d1, vdupq_n_u8( pSync1[k] ) ) ) );
+		bits = NeonMask( m );
+		if ( bits )
+			return i + ( __builtin_ctzll( bits ) >> 2 );
+	}
+	return SyncTail( p, i, nBytes, pSync0, pSync1, nSync, nMask );
+}
+
+static int DetectStartCodeEngine( )
+{
+	return START_CODE_NEON;
+}
+#else
+static int DetectStartCodeEngine( )
+{
+	return START_CODE_SCALAR;
+}
+#endif
+
+int StartCodeEngine( )
+{
+	if ( code_engine < 0 )
+	{
+		code_engine = DetectStartCodeEngine( );
+		SageLog(( _LOG_TRACE, 3, TEXT("start code scan engine:%s"), StartCodeEngineName( code_engine ) ));
+	}
+	return code_engine;
+}
+
+//force a slower engine (benchmark), it can't go beyond cpu capability
+void SetupStartCodeEngine( int nEngine )
+{
+	int engine = DetectStartCodeEngine( );
+	//x86 engines are in order of capability, NEON is the only one on ARM
+	if ( engine == START_CODE_NEON )
+		code_engine = nEngine == START_CODE_NEON ? nEngine : START_CODE_SCALAR;
+	else
+		code_engine = nEngine > engine ? engine : nEngine;
+}
+
+char* StartCodeEngineName( int nEngine )
+{
+	if ( nEngine == START_CODE_NEON ) return "NEON";
+	if ( nEngine == START_CODE_AVX2 ) return "AVX2";
+	if ( nEngine == START_CODE_SSE2 ) return "SSE2";
+	return "scalar";
+}
+
+//offset of first key in data, -1 if not found
+static int ScanKey( const unsigned char* p, int nBytes, const unsigned char* pKey, int nKey )
+{
+	if ( nBytes < nKey )
+		return -1;
+#ifdef START_CODE_X86
+	switch ( StartCodeEngine( ) ) {
+	case START_CODE_AVX2:
+		return ScanKeyAVX2( p, nBytes, pKey, nKey );
+	case START_CODE_SSE2:
+		return ScanKeySSE2( p, nBytes, pKey, nKey );
+	}
+#elif defined(START_CODE_ARM)
+	if ( StartCodeEngine( ) == START_CODE_NEON )
+		return ScanKeyNEON( p, nBytes, pKey, nKey );
+#endif
+	return ScanKeyScalar( p, nBytes, pKey, nKey );
+}
+
+static int ScanSync( const unsigned char* p, int nBytes, const unsigned char* pSync0, const unsigned char* pSync1,
+					 int nSync, unsigned char nMask )
+{
+	if ( nBytes < 2 )
+		return -1;
+#ifdef START_CODE_X86
+	switch ( StartCodeEngine( ) ) {
+	case START_CODE_AVX2:
+		return ScanSyncAVX2( p, nBytes, pSync0, pSync1, nSync, nMask );
+	case START_CODE_SSE2:
+		return ScanSyncSSE2( p, nBytes, pSync0, pSync1, nSync, nMask );
+	}
+#elif defined(START_CODE_ARM)
+	if ( StartCodeEngine( ) == START_CODE_NEON )
+		return ScanSyncNEON( p, nBytes, pSync0, pSync1, nSync, nMask );
+#endif
+	return ScanSyncScalar( p, nBytes, pSync0, pSync1, nSync, nMask );
+}
+
+const unsigned char* SearchStartCode( const unsigned char* pData, int nBytes, int nCode )
+{
+	unsigned char key[4] = { 0x00, 0x00, 0x01, 0x00 };
+	int pos;
+	if ( nCode >= 0 )
+	{
+		key[3] = (unsigned char)nCode;
+		pos = ScanKey( pData, nBytes, key, 4 );
+	} else
+		pos = ScanKey( pData, nBytes-1, key, 3 ); //code byte is in the buffer too
+	return pos < 0 ? NULL : pData+pos;
+}
+
+const unsigned char* SearchZeroRunEnd( const unsigned char* pData, int nBytes, int nZeros )
+{
+	static const unsigned char zeros[4] = { 0, 0, 0, 0 };
+	int pos;
+	if ( (pos = ScanKey( pData, nBytes, zeros, nZeros )) < 0 )
+		return NULL;
+	for ( pos += nZeros; pos < nBytes; pos++ )
+		if ( pData[pos] )
+			return pData+pos;
+	return NULL;
+}
+
+const unsigned char* SearchSyncWord( const unsigned char* pData, int nBytes, const unsigned short* pSync, int nSync,
+									 unsigned short nMask )
+{
+	unsigned char sync0[MAX_SYNC_WORD_NUM], sync1[MAX_SYNC_WORD_NUM];
+	int k, pos;
+	ASSERT( (nMask & 0xff00) == 0xff00 && nSync <= MAX_SYNC_WORD_NUM );
+	for ( k = 0; k<nSync; k++ )
+	{
+		sync0[k] = (unsigned char)( pSync[k] >> 8 );
+		sync1[k] = (unsigned char)( pSync[k] & nMask );
+	}
+	pos = ScanSync( pData, nBytes, sync0, sync1, nSync, (unsigned char)nMask );
+	return pos < 0 ? NULL : pData+pos;
+}
+
+const unsigned char* SearchBytes( const unsigned char* pData, int nBytes, const unsigned char* pMatch, int nMatch )
+{
+	int key = _MIN( nMatch, 4 ), pos, start = 0;
+	if ( nMatch < 2 )
+		return nMatch <= 0 ? pData : (const unsigned char*)memchr( pData, pMatch[0], nBytes > 0 ? nBytes : 0 );
+	//key kernel finds head of the pattern, rest of it is checked here
+	while ( (pos = ScanKey( pData+start, nBytes-start-(nMatch-key), pMatch, key )) >= 0 )
+	{
+		if ( nMatch == key || !memcmp( pData+start+pos+key, pMatch+key, nMatch-key ) )
+			return pData+start+pos;
+		start += pos+1;
+	}
+	return NULL;
+}
+
+int RemoveEmulationPrevention( const unsigned char* pSrc, int nBytes, unsigned char* pDst )
+{
+	static const unsigned char epb[3] = { 0x00, 0x00, 0x03 };
+	int src = 0, dst = 0, pos;
+	if ( nBytes <= 0 )
+		return 0;
+	while ( (pos = ScanKey( pSrc+src, nBytes-src, epb, 3 )) >= 0 )
+	{
+		memmove( pDst+dst, pSrc+src, pos+2 );
+		dst += pos+2;
+		src += pos+3;
+	}
+	memmove( pDst+dst, pSrc+src, nBytes-src );
+	return dst+nBytes-src;
+}
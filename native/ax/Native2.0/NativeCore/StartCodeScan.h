@@ -0,0 +1,52 @@
+/*
+ * Copyright 2015 The SageTV Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef START_CODE_SCAN_H
+#define START_CODE_SCAN_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define START_CODE_SCALAR   0x00
+#define START_CODE_SSE2     0x01
+#define START_CODE_AVX2     0x02
+#define START_CODE_NEON     0x03
+
+#define MAX_SYNC_WORD_NUM   4
+
+//next start code 00 00 01 xx with xx == nCode (any xx if nCode < 0), all 4 bytes of it are in the buffer
+const unsigned char* SearchStartCode( const unsigned char* pData, int nBytes, int nCode );
+//first non-zero byte after a run of nZeros (2..4) or more zero bytes, the byte is in the buffer
+const unsigned char* SearchZeroRunEnd( const unsigned char* pData, int nBytes, int nZeros );
+//next 16 bits sync word that equals one of pSync words (MAX_SYNC_WORD_NUM at most) under nMask,
+//high byte of nMask has to be 0xff, (e.g. 0xfff0 of MPEG audio)
+const unsigned char* SearchSyncWord( const unsigned char* pData, int nBytes, const unsigned short* pSync, int nSync,
+									 unsigned short nMask );
+const unsigned char* SearchBytes( const unsigned char* pData, int nBytes, const unsigned char* pMatch, int nMatch );
+//drop emulation prevention bytes (00 00 03 -> 00 00) of a whole NAL payload, pDst may be pSrc
+//return bytes in pDst
+int  RemoveEmulationPrevention( const unsigned char* pSrc, int nBytes, unsigned char* pDst );
+
+int  StartCodeEngine( );
+void SetupStartCodeEngine( int nEngine );
+char* StartCodeEngineName( int nEngine );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -296,6 +296,7 @@ void ResetTSBuilder( TS_BUILDER *pTSBuilder )
 	int i;
 	pTSBuilder->used_bytes = 0;
 	pTSBuilder->output_bytes = 0;
+	pTSBuilder->copy_bytes = 0;
 	pTSBuilder->input_blocks = 0;
 	pTSBuilder->output_blocks = 0;
 	pTSBuilder->output_packets = 0;
@@ -907,6 +908,24 @@ static int FillTSPack2( TS_PACKET *pTSPacket, unsigned char* pData1, int nBytes1
 	return used_bytes-nBytes1;
 }
 
+static void DumpOutputData( TS_BUILDER *pTSBuilder )
+{
+	if ( pTSBuilder->dumper.iov_dumper != NULL )
+	{
+		//a TS packet interleaves a header every 184 bytes of payload, it's packed in the buffer rather than sliced
+		OUTPUT_IOV output_iov;
+		output_iov.iov[0].iov_base = pTSBuilder->output_data.data_ptr;
+		output_iov.iov[0].iov_len  = pTSBuilder->output_data.bytes;
+		output_iov.iov_num    = 1;
+		output_iov.bytes      = pTSBuilder->output_data.bytes;
+		output_iov.group_flag = pTSBuilder->output_data.group_flag;
+		output_iov.fourcc     = pTSBuilder->output_data.fourcc;
+		output_iov.block      = NULL;
+		pTSBuilder->dumper.iov_dumper( pTSBuilder->dumper.iov_dumper_context, &output_iov, sizeof( OUTPUT_IOV ) );
+	} else
+		pTSBuilder->dumper.stream_dumper( pTSBuilder->dumper.stream_dumper_context, &pTSBuilder->output_data, sizeof( OUTPUT_DATA ) );
+}
+
 unsigned char* RequsetTSPacket( TS_BUILDER *pTSBuilder )
 {
 	unsigned char *p;
@@ -935,7 +954,7 @@ unsigned char* RequsetTSPacket( TS_BUILDER *pTSBuilder )
 		pTSBuilder->output_data.bytes    = pTSBuilder->output_buffer->data_bytes;
 		pTSBuilder->output_data.data_ptr = pTSBuilder->output_buffer->buffer;
 		pTSBuilder->output_packets += pTSBuilder->output_buffer->data_bytes/pTSBuilder->packet_length;
-		pTSBuilder->dumper.stream_dumper( pTSBuilder->dumper.stream_dumper_context, &pTSBuilder->output_data, sizeof( OUTPUT_DATA ) );
+		DumpOutputData( pTSBuilder );
 		pTSBuilder->output_blocks++;
 		pTSBuilder->output_data.group_flag = 0;
 		pTSBuilder->output_data.start_offset = 0;
@@ -991,6 +1010,7 @@ static int PushContentData( TS_BUILDER *pTSBuilder, TS_PACKET* pTSPacket, unsign
 		pTSPacket->continuity_ct++;
 		if ( bytes == 0 ) break;
 	}
+	pTSBuilder->copy_bytes += used_bytes;
 
 	return used_bytes;
 }
@@ -1016,6 +1036,7 @@ static int PushSectionData( TS_BUILDER *pTSBuilder, TS_SECTION *pSection, TS_PAC
 		pTSPacket->continuity_ct++;
 		if ( bytes == 0 ) break;
 	}
+	pTSBuilder->copy_bytes += used_bytes;
 
 	return used_bytes;
 }
@@ -1039,7 +1060,7 @@ void FlushOutData( TS_BUILDER *pTSBuilder )
 	pTSBuilder->output_data.bytes    = pTSBuilder->output_buffer->data_bytes;
 	pTSBuilder->output_data.data_ptr = pTSBuilder->output_buffer->buffer;
 	pTSBuilder->output_packets += pTSBuilder->output_buffer->data_bytes/pTSBuilder->packet_length;
-	pTSBuilder->dumper.stream_dumper( pTSBuilder->dumper.stream_dumper_context, &pTSBuilder->output_data, sizeof( OUTPUT_DATA ) );
+	DumpOutputData( pTSBuilder );
 }
 
 unsigned char LookupStreamType( unsigned long lFourCC )
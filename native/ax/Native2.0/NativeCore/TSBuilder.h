@@ -37,6 +37,8 @@ typedef struct TS_BUILDER_DUMPER
 {
 	DUMP  stream_dumper;
 	void* stream_dumper_context;
+	DUMP  iov_dumper;            //OUTPUT_IOV of packed packets instead of OUTPUT_DATA when it's set
+	void* iov_dumper_context;
 
 	//DUMP  message_dumper;
 	//void* message_dumper_context;
@@ -89,6 +91,7 @@ typedef struct TS_BUILDER
 	OUTPUT_DATA  output_data;       //dump data
 	ULONGLONG  used_bytes;
 	ULONGLONG  output_bytes;
+	ULONGLONG  copy_bytes;       //payload bytes copied into packets
 	unsigned long output_packets;
 	unsigned long input_blocks;
 	unsigned long output_blocks;
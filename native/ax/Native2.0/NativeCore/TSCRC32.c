@@ -14,9 +14,29 @@
  * limitations under the License.
  */
 
+#include <stdlib.h>
 #include "TSCRC32.h"
 
-static unsigned long ts_crc32_table[256] =
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+//MPEG-2 CRC32 (poly 0x04c11db7, msb first, init 0xffffffff, no final xor) of PSI sections.
+//ts_crc32_table is the byte-at-a-time reference, slicing-by-8 tables are derived from it once at first use,
+//a PCLMULQDQ folding engine is picked at runtime on x86_64 CPUs supporting it.
+#if defined(__GNUC__) && defined(__x86_64__) && !defined(MINI_PVR)
+#define TS_CRC32_X86
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#include <smmintrin.h>
+#include <wmmintrin.h>
+#endif
+
+#define CRC32_POLY  0x04c11db7
+
+static const unsigned int ts_crc32_table[256] =
 {
   0x00000000, 0x04c11db7, 0x09823b6e, 0x0d4326d9,
   0x130476dc, 0x17c56b6b, 0x1a864db2, 0x1e475005,
@@ -84,15 +104,218 @@ static unsigned long ts_crc32_table[256] =
   0xbcb4666d, 0xb8757bda, 0xb5365d03, 0xb1f740b4
 };
 
-unsigned long CalTSCRC32( const unsigned char *pData, int len )
+static unsigned int crc32_slice_table[8][256];
+static int crc32_engine = -1;
+
+static unsigned int CRC32Table( unsigned int crc, const unsigned char* pData, int nLen )
+{
+	while ( nLen-- > 0 )
+		crc = (crc << 8) ^ ts_crc32_table[ (crc >> 24) ^ *pData++ ];
+	return crc;
+}
+
+static void InitSliceTable( )
+{
+	int i, k;
+	for ( i = 0; i<256; i++ )
+		crc32_slice_table[0][i] = ts_crc32_table[i];
+	for ( k = 1; k<8; k++ )
+		for ( i = 0; i<256; i++ )
+		{
+			unsigned int crc = crc32_slice_table[k-1][i];
+			crc32_slice_table[k][i] = (crc << 8) ^ ts_crc32_table[ crc >> 24 ];
+		}
+}
+
+//slicing-by-8, 8 bytes are looked up in 8 tables independently per step
+static unsigned int CRC32Slice8( unsigned int crc, const unsigned char* pData, int nLen )
+{
+	const unsigned int (*t)[256] = (const unsigned int (*)[256])crc32_slice_table;
+	while ( nLen >= 8 )
+	{
+		unsigned int hi = crc ^ ( ((unsigned int)pData[0]<<24) | (pData[1]<<16) | (pData[2]<<8) | pData[3] );
+		crc = t[7][ hi>>24 ] ^ t[6][ (hi>>16)&0xff ] ^ t[5][ (hi>>8)&0xff ] ^ t[4][ hi&0xff ] ^
+			  t[3][ pData[4] ] ^ t[2][ pData[5] ] ^ t[1][ pData[6] ] ^ t[0][ pData[7] ];
+		pData += 8;
+		nLen  -= 8;
+	}
+	return CRC32Table( crc, pData, nLen );
+}
+
+#ifdef TS_CRC32_X86
+//folding constants, x^n mod P, and Barrett constant floor(x^64/P)
+static unsigned long long crc32_k[6], crc32_mu;
+
+static unsigned int XPowModP( int n )
 {
-    unsigned long  crc = 0xffffffff;
-    unsigned char* p_byte = (unsigned char*)pData;
+	unsigned int r = 1;
+	while ( n-- > 0 )
+		r = ( r & 0x80000000 ) ? (r << 1) ^ CRC32_POLY : (r << 1);
+	return r;
+}
+
+static unsigned long long BarrettMu( )
+{
+	unsigned long long q = 0, r = 0;
+	int i;
+	for ( i = 64; i >= 0; i-- )
+	{
+		r = (r << 1) | ( i == 64 );
+		if ( r & 0x100000000ULL )
+		{
+			r ^= 0x100000000ULL | CRC32_POLY;
+			q |= 1ULL << i;
+		}
+	}
+	return q;
+}
+
+static void InitFoldConstant( )
+{
+	crc32_k[0] = XPowModP( 512+64 ); //fold by 4 (64 bytes)
+	crc32_k[1] = XPowModP( 512 );
+	crc32_k[2] = XPowModP( 128+64 ); //fold by 1 (16 bytes)
+	crc32_k[3] = XPowModP( 128 );
+	crc32_k[4] = XPowModP( 96 );     //128 bits -> 96 bits
+	crc32_k[5] = XPowModP( 64 );     //96 bits -> 64 bits
+	crc32_mu = BarrettMu( );
+}
+
+#define CRC32_TARGET __attribute__((target("pclmul,ssse3,sse4.1")))
+
+CRC32_TARGET
+static inline __m128i Fold128( __m128i x, __m128i k )
+{
+	return _mm_xor_si128( _mm_clmulepi64_si128( x, k, 0x11 ), _mm_clmulepi64_si128( x, k, 0x00 ) );
+}
+
+//data is folded in 128 bits polynomial, byte 0 in the highest degree, then reduced to 32 bits by Barrett reduction
+CRC32_TARGET
+static unsigned int CRC32Fold( unsigned int crc, const unsigned char* pData, int nLen )
+{
+	const __m128i swap = _mm_setr_epi8( 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0 );
+	const __m128i k4 = _mm_set_epi64x( crc32_k[0], crc32_k[1] );
+	const __m128i k1 = _mm_set_epi64x( crc32_k[2], crc32_k[3] );
+	__m128i x, r, t;
+	unsigned long long r64, q;
+
+	if ( nLen < 32 )
+		return CRC32Slice8( crc, pData, nLen );
 
-    while( len-- )
-    {
-      crc = (crc << 8) ^ ts_crc32_table[ (crc >> 24) ^ (*p_byte) ];
-      p_byte++;
-    }
-    return crc;
+	x = _mm_shuffle_epi8( _mm_loadu_si128( (const __m128i*)pData ), swap );
+	x = _mm_xor_si128( x, _mm_set_epi32( (int)crc, 0, 0, 0 ) );
+	pData += 16;
+	nLen  -= 16;
+
+	if ( nLen >= 112 )
+	{
+		__m128i x1, x2, x3;
+		x1 = _mm_shuffle_epi8( _mm_loadu_si128( (const __m128i*)(pData) ), swap );
+		x2 = _mm_shuffle_epi8( _mm_loadu_si128( (const __m128i*)(pData+16) ), swap );
+		x3 = _mm_shuffle_epi8( _mm_loadu_si128( (const __m128i*)(pData+32) ), swap );
+		pData += 48;
+		nLen  -= 48;
+		while ( nLen >= 64 )
+		{
+			x  = _mm_xor_si128( Fold128( x,  k4 ), _mm_shuffle_epi8( _mm_loadu_si128( (const __m128i*)(pData) ), swap ) );
+			x1 = _mm_xor_si128( Fold128( x1, k4 ), _mm_shuffle_epi8( _mm_loadu_si128( (const __m128i*)(pData+16) ), swap ) );
+			x2 = _mm_xor_si128( Fold128( x2, k4 ), _mm_shuffle_epi8( _mm_loadu_si128( (const __m128i*)(pData+32) ), swap ) );
+			x3 = _mm_xor_si128( Fold128( x3, k4 ), _mm_shuffle_epi8( _mm_loadu_si128( (const __m128i*)(pData+48) ), swap ) );
+			pData += 64;
+			nLen  -= 64;
+		}
+		x = _mm_xor_si128( Fold128( x, k1 ), x1 );
+		x = _mm_xor_si128( Fold128( x, k1 ), x2 );
+		x = _mm_xor_si128( Fold128( x, k1 ), x3 );
+	}
+
+	while ( nLen >= 16 )
+	{
+		x = _mm_xor_si128( Fold128( x, k1 ), _mm_shuffle_epi8( _mm_loadu_si128( (const __m128i*)pData ), swap ) );
+		pData += 16;
+		nLen  -= 16;
+	}
+
+	//crc = x * x^32 mod P
+	r = _mm_xor_si128( _mm_clmulepi64_si128( x, _mm_cvtsi64_si128( crc32_k[4] ), 0x01 ),
+		               _mm_slli_si128( _mm_move_epi64( x ), 4 ) );
+	t = _mm_clmulepi64_si128( _mm_srli_si128( r, 8 ), _mm_cvtsi64_si128( crc32_k[5] ), 0x00 );
+	r64 = (unsigned long long)_mm_cvtsi128_si64( _mm_xor_si128( t, r ) );
+	q = (unsigned long long)_mm_cvtsi128_si64( _mm_clmulepi64_si128( _mm_cvtsi64_si128( r64 >> 32 ), _mm_cvtsi64_si128( crc32_mu ), 0x00 ) ) >> 32;
+	t = _mm_clmulepi64_si128( _mm_cvtsi64_si128( q ), _mm_cvtsi64_si128( 0x100000000ULL | CRC32_POLY ), 0x00 );
+	crc = (unsigned int)( r64 ^ (unsigned long long)_mm_cvtsi128_si64( t ) );
+
+	return CRC32Slice8( crc, pData, nLen );
+}
+
+static int DetectCRC32Engine( )
+{
+	__builtin_cpu_init( );
+	if ( __builtin_cpu_supports( "pclmul" ) && __builtin_cpu_supports( "sse4.1" ) )
+		return TS_CRC32_PCLMUL;
+	return TS_CRC32_SLICE8;
+}
+#else
+static int DetectCRC32Engine( )
+{
+	return TS_CRC32_SLICE8;
+}
+#endif
+
+//tables and engine are set up once, by the first caller of any thread
+static void InitCRC32Engine( )
+{
+	InitSliceTable( );
+#ifdef TS_CRC32_X86
+	InitFoldConstant( );
+#endif
+	crc32_engine = DetectCRC32Engine( );
+}
+
+#ifdef WIN32
+static INIT_ONCE crc32_engine_once = INIT_ONCE_STATIC_INIT;
+static BOOL CALLBACK InitCRC32EngineOnce( PINIT_ONCE pOnce, PVOID pParam, PVOID* ppContext )
+{
+	InitCRC32Engine( );
+	return TRUE;
+}
+#define CRC32EngineReady( )	InitOnceExecuteOnce( &crc32_engine_once, InitCRC32EngineOnce, NULL, NULL )
+#else
+static pthread_once_t crc32_engine_once = PTHREAD_ONCE_INIT;
+#define CRC32EngineReady( )	pthread_once( &crc32_engine_once, InitCRC32Engine )
+#endif
+
+int TSCRC32Engine( )
+{
+	CRC32EngineReady( );
+	return crc32_engine;
+}
+
+//force a slower engine (test and benchmark), it can't go beyond cpu capability
+void SetupTSCRC32Engine( int nEngine )
+{
+	int engine;
+	TSCRC32Engine( );
+	engine = DetectCRC32Engine( );
+	crc32_engine = nEngine > engine ? engine : nEngine;
+}
+
+char* TSCRC32EngineName( int nEngine )
+{
+	if ( nEngine == TS_CRC32_PCLMUL ) return "PCLMUL";
+	if ( nEngine == TS_CRC32_SLICE8 ) return "slice-by-8";
+	return "table";
+}
+
+unsigned long CalTSCRC32( const unsigned char *pData, int len )
+{
+	switch ( TSCRC32Engine( ) ) {
+#ifdef TS_CRC32_X86
+	case TS_CRC32_PCLMUL:
+		return CRC32Fold( 0xffffffff, pData, len );
+#endif
+	case TS_CRC32_SLICE8:
+		return CRC32Slice8( 0xffffffff, pData, len );
+	}
+	return CRC32Table( 0xffffffff, pData, len );
 }
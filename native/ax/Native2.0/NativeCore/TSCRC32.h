@@ -14,13 +14,24 @@
  * limitations under the License.
  */
 
+#ifndef TS_CRC32_H
+#define TS_CRC32_H
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+#define TS_CRC32_TABLE      0x00
+#define TS_CRC32_SLICE8     0x01
+#define TS_CRC32_PCLMUL     0x02
+
 unsigned long CalTSCRC32( const unsigned char *pData, int len );
+int   TSCRC32Engine( );
+void  SetupTSCRC32Engine( int nEngine );
+char* TSCRC32EngineName( int nEngine );
 
 #ifdef __cplusplus
 }
 #endif
 
+#endif
@@ -57,10 +57,17 @@ TS_FILTER* CreateTSFilter( int nPatNum, int nPmtNum, int nStreamFormat, int nSub
 	pTSFilter->pmt = SAGETV_MALLOC( sizeof(TS_PMT)*pTSFilter->pmt_num );
 	pTSFilter->pmt_section   = SAGETV_MALLOC( sizeof(TS_SECTION*)*pTSFilter->pmt_num );
 	pTSFilter->pmt_map = SAGETV_MALLOC( sizeof(TS_PMT_MAP )*pTSFilter->map_num );
+	pTSFilter->pid_tbl = SAGETV_MALLOC( sizeof(PID_HANDLER)*PID_TBL_SIZE );
+	pTSFilter->mem_arena = CreateMemArena( "TSFilter" );
 
+	pTSFilter->section_cache = CreateSectionCache();
 	pTSFilter->pat_section = CreateSection();
+	AttachSectionCache( pTSFilter->pat_section, pTSFilter->section_cache, 0 );
 	for ( i = 0; i<pTSFilter->pmt_num; i++ )
+	{
 		pTSFilter->pmt_section[i] = CreateSection();
+		AttachSectionCache( pTSFilter->pmt_section[i], pTSFilter->section_cache, 0 );
+	}
 
 	pTSFilter->ts_streams_num = 0;
 
@@ -68,6 +75,7 @@ TS_FILTER* CreateTSFilter( int nPatNum, int nPmtNum, int nStreamFormat, int nSub
 	ASSERT( pTSFilter->pmt );
 	ASSERT( pTSFilter->pmt_section );
 	ASSERT( pTSFilter->pmt_map );
+	ASSERT( pTSFilter->pid_tbl );
 
 	pTSFilter->psi_parser = CreatePSIParser( pTSFilter, nStreamFormat, nSubFormat );
 
@@ -84,6 +92,7 @@ TS_FILTER* CreateTSFilter( int nPatNum, int nPmtNum, int nStreamFormat, int nSub
 		pTSFilter->pmt_map[i].program = 0;
 	}
 	pTSFilter->mapped_num = 0;
+	pTSFilter->pid_tbl[0].pid_class = PID_CLASS_PAT;
 
 	return pTSFilter;
 }
@@ -91,6 +100,8 @@ TS_FILTER* CreateTSFilter( int nPatNum, int nPmtNum, int nStreamFormat, int nSub
 void ReleaseTSFilter( TS_FILTER* pTSFilter )
 {
 	int i, j;
+	struct MEM_ARENA* mem_arena = pTSFilter->mem_arena;
+	struct MEM_ARENA* prev_arena = SageMemArenaEnter( mem_arena );
 	ReleaseSection( pTSFilter->pat_section );
 
 	for ( i = 0; i<pTSFilter->pmt_num; i++ )
@@ -103,18 +114,29 @@ void ReleaseTSFilter( TS_FILTER* pTSFilter )
 		}
 	}
 	ReleasePSIParser( pTSFilter->psi_parser );
+	if ( pTSFilter->section_cache != NULL )
+		SageLog(( _LOG_TRACE, 3, TEXT("Section cache: %lu repeats dropped, %lu sections unpacked, %lu bytes skipped, %lu cached."),
+			pTSFilter->section_cache->hit, pTSFilter->section_cache->miss, pTSFilter->section_cache->skipped_bytes, 
+			pTSFilter->section_cache->num ));
+	ReleaseSectionCache( pTSFilter->section_cache );
 	//SAGETV_FREE( pTSFilter->ts_streams.ts_element );
 	SAGETV_FREE( pTSFilter->pat );
 	SAGETV_FREE( pTSFilter->pmt );
 	SAGETV_FREE( pTSFilter->pmt_section );
 	SAGETV_FREE( pTSFilter->pmt_map );
+	SAGETV_FREE( pTSFilter->pid_tbl );
 	SAGETV_FREE( pTSFilter );
+	SageMemArenaLeave( prev_arena );
+	ReleaseMemArena( mem_arena );
 }
 
+static void IndexPidHist( TS_FILTER* pTSFilter );
 void ResetTSFilter( TS_FILTER* pTSFilter )
 {
 	int i,j;
+	struct MEM_ARENA* prev_arena;
 	CHECK_SAGE_TAG( pTSFilter, TSFILTER_TAG ); //check PTSfilter is created by CreateTSFilter()
+	prev_arena = SageMemArenaEnter( pTSFilter->mem_arena );
 	
 	pTSFilter->disable_ts_table_parse = 0;
 	pTSFilter->disable_stream_filter = 0;
@@ -125,6 +147,7 @@ void ResetTSFilter( TS_FILTER* pTSFilter )
 	pTSFilter->ts_packet_counter = 0;
 	memset( pTSFilter->pat, 0x0, sizeof(TS_PAT)*pTSFilter->pat_num  );
 	ResetSection( pTSFilter->pat_section );
+	ResetSectionCache( pTSFilter->section_cache );
 
 
 	for ( i = 0; i<pTSFilter->pmt_num; i++ )
@@ -156,6 +179,13 @@ void ResetTSFilter( TS_FILTER* pTSFilter )
 	pTSFilter->mapped_num = 0;
 
 	pTSFilter->ts_streams_num = 0;
+
+	memset( pTSFilter->pid_tbl, 0, sizeof(PID_HANDLER)*PID_TBL_SIZE );
+	pTSFilter->pid_tbl[0].pid_class = PID_CLASS_PAT;
+	IndexPidHist( pTSFilter );
+
+	ResetMemArena( pTSFilter->mem_arena );
+	SageMemArenaLeave( prev_arena );
 }
 
 
@@ -177,7 +207,7 @@ static ULONGLONG GetPCR( const unsigned char* pkt )
 }
 
 
-static int UnpackTSPacket( TS_PACKET *pTSPacket, const unsigned char* pData )	
+static int UnpackTSPacket( TS_PACKET *pTSPacket, const unsigned char* pData )
 {
 	pTSPacket->data   = (unsigned char*)pData;
 	pTSPacket->sync	  =	pData[0];			
@@ -186,9 +216,9 @@ static int UnpackTSPacket( TS_PACKET *pTSPacket, const unsigned char* pData )
 	pTSPacket->start  =	pData[1]&0x40	? 1 : 0;	
 	pTSPacket->priority =	pData[1]&0x20 ? 1 : 0;	
 	pTSPacket->pid	  =	pData[2] | (pData[1]&0x1f)<<8 ;	
-	pTSPacket->scrambling_ctr = ( pData[3] & 0xc0 )>> 6;	
-	pTSPacket->adaption_ctr   = ( pData[3] & 0x30 )>> 4;	
-	pTSPacket->continuity_ct  = ( pData[3] & 0x0f );	
+	pTSPacket->scrambling_ctr = ( pData[3] & 0xc0 )>> 6;
+	pTSPacket->adaption_ctr   = ( pData[3] & 0x30 )>> 4;
+	pTSPacket->continuity_ct  = ( pData[3] & 0x0f );
 	pTSPacket->pcr = pTSPacket->opcr  = 0;
 	pTSPacket->pcr_flag = 0;
 	
@@ -255,18 +285,82 @@ int CheckPacketContinuity( TS_PACKET *pTSPacket, unsigned char* pContinuity )
 
 }
 
-static inline int LookupPMT( TS_FILTER* pTSFilter, unsigned short uPid )
+//PID lookup table keeps handlers of a pid in place of scaning pmt map, pmt streams and filter streams per packet,
+//tables are remapped when they are changed (PAT, PMT update and channel filter setup)
+static void MapPMTPids( TS_FILTER* pTSFilter )
 {
-	int i, j; 
-	for ( i = 0; i<pTSFilter->pmt_num; i++ )
+	int i;
+	for ( i = 0; i<PID_TBL_SIZE; i++ )
+		pTSFilter->pid_tbl[i].pid_class &= ~PID_CLASS_PMT;
+
+	for ( i = 0; i<pTSFilter->mapped_num; i++ )
+	{
+		PID_HANDLER *entry = &pTSFilter->pid_tbl[ pTSFilter->pmt_map[i].pid & (PID_TBL_SIZE-1) ];
+		if ( pTSFilter->pmt_map[i].pid == 0 || ( entry->pid_class & PID_CLASS_PMT ) )
+			continue;
+		entry->pid_class |= PID_CLASS_PMT;
+		entry->pmt_index = i;
+	}
+}
+
+static void UnmapProgramPids( TS_FILTER* pTSFilter, TS_PMT *pPmt )
+{
+	int i, pmt_index = (int)( pPmt - pTSFilter->pmt );
+	for ( i = 0; i<pPmt->total_stream_number; i++ )
+	{
+		PID_HANDLER *entry = &pTSFilter->pid_tbl[ pPmt->stream_pid[i] ];
+		if ( ( entry->pid_class & PID_CLASS_PROGRAM ) && entry->program == pmt_index )
+			entry->pid_class &= ~PID_CLASS_PROGRAM;
+	}
+}
+
+static void MapProgramPids( TS_FILTER* pTSFilter, TS_PMT *pPmt )
+{
+	int i, pmt_index = (int)( pPmt - pTSFilter->pmt );
+	for ( i = 0; i<pPmt->total_stream_number; i++ )
+	{
+		PID_HANDLER *entry = &pTSFilter->pid_tbl[ pPmt->stream_pid[i] ];
+		entry->pid_class |= PID_CLASS_PROGRAM;
+		entry->program = pmt_index;
+	}
+}
+
+//stream filter and PCR/CA filter dispatch the first filter streams only.
+static void MapStreamPids( TS_FILTER* pTSFilter )
+{
+	int i;
+	TS_STREAMS *ts_streams_ptr;
+	for ( i = 0; i<PID_TBL_SIZE; i++ )
+		pTSFilter->pid_tbl[i].pid_class &= ~(PID_CLASS_STREAM|PID_CLASS_SHARED|PID_CLASS_PCR|PID_CLASS_CA);
+
+	if ( pTSFilter->ts_streams_num == 0 )
+		return;
+
+	ts_streams_ptr = pTSFilter->ts_streams[0];
+	for ( i = 0; i<ts_streams_ptr->num_stream; i++ )
 	{
-		for ( j =0; j< pTSFilter->pmt[i].total_stream_number; j++ )
+		PID_HANDLER *entry = &pTSFilter->pid_tbl[ ts_streams_ptr->ts_element[i].pid & (PID_TBL_SIZE-1) ];
+		if ( entry->pid_class & PID_CLASS_STREAM )
 		{
-			if ( pTSFilter->pmt[i].stream_pid[j] == uPid )
-				return i;
+			entry->pid_class |= PID_CLASS_SHARED;
+			continue;
 		}
+		entry->pid_class |= PID_CLASS_STREAM;
+		entry->track = i;
 	}
-	return -1;
+	pTSFilter->pid_tbl[ ts_streams_ptr->pcr_pid & (PID_TBL_SIZE-1) ].pid_class |= PID_CLASS_PCR;
+	if ( ts_streams_ptr->ca_pid )
+		pTSFilter->pid_tbl[ ts_streams_ptr->ca_pid & (PID_TBL_SIZE-1) ].pid_class |= PID_CLASS_CA;
+}
+
+static void IndexPidHist( TS_FILTER* pTSFilter )
+{
+	int i;
+	for ( i = 0; i<PID_TBL_SIZE; i++ )
+		pTSFilter->pid_tbl[i].hist = 0;
+
+	for ( i = pTSFilter->pid_hist_num-1; i>=0; i-- )
+		pTSFilter->pid_tbl[ pTSFilter->pid_hist[i].pid & (PID_TBL_SIZE-1) ].hist = i+1;
 }
 
 static void SortPidHistTable( TS_FILTER* pTSFilter )
@@ -286,41 +380,39 @@ static void SortPidHistTable( TS_FILTER* pTSFilter )
 			}
 		}
 	}
+	IndexPidHist( pTSFilter );
 }			
 
 //catch most active 10 pids in histogram table, when the most active pid counter hits threshold number disable histgraming
-static void HistogramPid( TS_FILTER* pTSFilter, TS_PACKET *pTSPacket )
+static void HistogramPid( TS_FILTER* pTSFilter, TS_PACKET *pTSPacket, PID_HANDLER *pEntry )
 {
 	int i;
-	unsigned short max_num, min_num, min_index;
+	unsigned short max_num, min_num, min_index = 0;
 	if ( pTSFilter->disable_pid_hist == 1 || pTSPacket->pid == 0 )
 		return;
 
 	if ( pTSFilter->ts_streams_num == 0  ) //filter isn't setup yet, ccount data packet for PMT
 	{
-		int pmt_index = LookupPMT( pTSFilter, pTSPacket->pid );
-		if ( pmt_index >= 0 )
+		if ( pEntry->pid_class & PID_CLASS_PROGRAM )
 		{
-			pTSFilter->pmt[pmt_index].active_count++;
+			pTSFilter->pmt[pEntry->program].active_count++;
 		}
 	}
 
-	for ( i = 0; i<pTSFilter->pid_hist_num; i++ )
+	if ( pEntry->hist )
 	{
-		if ( pTSFilter->pid_hist[i].pid == pTSPacket->pid )
-		{
-			pTSFilter->pid_hist[i].count++;
-			if ( pTSPacket->pcr_flag )		 
-				pTSFilter->pid_hist[i].flag |= PCR_FLAG;
-			if ( pTSPacket->scrambling_ctr ) 
-				pTSFilter->pid_hist[i].flag |= SCRAMB_FLAG;
+		i = pEntry->hist-1;
+		pTSFilter->pid_hist[i].count++;
+		if ( pTSPacket->pcr_flag )		 
+			pTSFilter->pid_hist[i].flag |= PCR_FLAG;
+		if ( pTSPacket->scrambling_ctr ) 
+			pTSFilter->pid_hist[i].flag |= SCRAMB_FLAG;
 
-			//stop histgramming
-			if ( pTSFilter->pid_hist[i].count > PID_HIST_THRESHOLD + 100 )
-				pTSFilter->disable_pid_hist = 1;
+		//stop histgramming
+		if ( pTSFilter->pid_hist[i].count > PID_HIST_THRESHOLD + 100 )
+			pTSFilter->disable_pid_hist = 1;
 
-			return;
-		}
+		return;
 	}
 
 	if ( pTSFilter->pid_hist_ctrl == 1 )
@@ -331,6 +423,7 @@ static void HistogramPid( TS_FILTER* pTSFilter, TS_PACKET *pTSPacket )
 		pTSFilter->pid_hist[pTSFilter->pid_hist_num].pid = pTSPacket->pid;
 		pTSFilter->pid_hist[pTSFilter->pid_hist_num].count = 1;
 		pTSFilter->pid_hist_num++;
+		pEntry->hist = pTSFilter->pid_hist_num;
 		return;
 	} else
 	{
@@ -350,8 +443,10 @@ static void HistogramPid( TS_FILTER* pTSFilter, TS_PACKET *pTSPacket )
 		}
 
 		//replace at least one
+		pTSFilter->pid_tbl[ pTSFilter->pid_hist[min_index].pid & (PID_TBL_SIZE-1) ].hist = 0;
 		pTSFilter->pid_hist[min_index].pid = pTSPacket->pid;
 		pTSFilter->pid_hist[min_index].count = 1;
+		pEntry->hist = min_index+1;
 		if ( max_num > PID_HIST_THRESHOLD )
 		{
 			SortPidHistTable( pTSFilter );
@@ -410,7 +505,13 @@ static int UnpackPAT( TS_FILTER* pTSFilter, TS_PACKET *pTSPacket )
 	pPat->stamp = pTSFilter->ts_packet_counter;
 
 	pPat->update_flag = pTSFilter->pat_section->crc32 != pPat->section_crc32;
+	if ( pPat->update_flag && pTSFilter->pat_section->cached )
+	{
+		UncacheSection( pTSFilter->pat_section ); //a cached repeat of other section of the PAT, unpack it next time
+		return -1;
+	}
 	pPat->section_crc32 = pTSFilter->pat_section->crc32;
+	CacheSection( pTSFilter->pat_section );
 	if ( pPat->update_flag == 0 ) 
 	{
 		return i; //pat unchange, skip it
@@ -444,6 +545,7 @@ int UnpackPMT( TS_FILTER *pTSFilter, int nPmtIndex, TS_PACKET *pTSPacket )
 	int stream_num, section_bytes, section_start, update_pmt = 0;
 	SECTION_HEADER section_header;
 	TS_PMT *pPmt;
+	TS_SECTION *pSection;
 
 	payload_data = pTSPacket->data + pTSPacket->payload_offset;
 	payload_size = pTSPacket->payload_bytes;
@@ -455,6 +557,7 @@ int UnpackPMT( TS_FILTER *pTSFilter, int nPmtIndex, TS_PACKET *pTSPacket )
 
 	if ( !CheckPacketContinuity( pTSPacket, &pTSFilter->pmt_section[nPmtIndex]->counter ) )
 		return 0;
+	pTSFilter->pmt_section[nPmtIndex]->pid = pTSPacket->pid;
 
 	section_start = pTSPacket->start;
 	while ( payload_size > 0 )
@@ -478,17 +581,26 @@ int UnpackPMT( TS_FILTER *pTSFilter, int nPmtIndex, TS_PACKET *pTSPacket )
 		section_start = 2;
 		
 		pPmt = &pTSFilter->pmt[nPmtIndex]; 
+		pSection = pTSFilter->pmt_section[nPmtIndex];
+		if ( pSection->cached && !pTSFilter->pmt_map[nPmtIndex].group_flag && pSection->crc32 != pPmt->section_crc32 )
+		{
+			UncacheSection( pSection ); //a cached repeat of other program's PMT on the pid, unpack it next time
+			continue;
+		}
 		pPmt->update_flag = pTSFilter->pmt_section[nPmtIndex]->crc32 != pPmt->section_crc32;
 		pPmt->section_crc32 = pTSFilter->pmt_section[nPmtIndex]->crc32;
+		if ( pPmt->update_flag == 0 && !pTSFilter->pmt_map[nPmtIndex].group_flag )
+			CacheSection( pSection );
 		if ( pPmt->update_flag == 0 && payload_size == 0 ) 
 			return update_pmt; //skip unpacking pmt to save time as it's unchange table
+		if ( pPmt->update_flag == 0 && pSection->cached )
+			continue;
 
 		UnpackSectionDataHeader( &section_header, pTSFilter->pmt_section[nPmtIndex] );
 
 		if ( pTSFilter->pmt_map[nPmtIndex].group_flag )
 		{
 			int uNewIndex;
-			TS_SECTION *pSection;
 			unsigned long crc32_tmp;
 			uNewIndex = GetPmtIndex2( pTSFilter, pTSPacket->pid, section_header.tsid );
 			if ( uNewIndex == -1 ||  pTSFilter->pmt_num <= uNewIndex )
@@ -499,17 +611,24 @@ int UnpackPMT( TS_FILTER *pTSFilter, int nPmtIndex, TS_PACKET *pTSPacket )
 			}
 			pPmt = &pTSFilter->pmt[uNewIndex]; 
 			pPmt->update_flag = pTSFilter->pmt_section[nPmtIndex]->crc32 != pPmt->section_crc32;;
+			if ( pPmt->update_flag && pSection->cached )
+			{
+				UncacheSection( pSection );
+				continue;
+			}
 			pPmt->section_crc32 = pTSFilter->pmt_section[nPmtIndex]->crc32;
 			if ( pPmt->update_flag == 0 )		 //skip unpacking pmt to save time as it's unchange table
+			{
+				CacheSection( pSection );
 				continue;
+			}
 
 			//swap section 
 			crc32_tmp = pTSFilter->pmt[uNewIndex].section_crc32;
 			pTSFilter->pmt[uNewIndex].section_crc32 = pTSFilter->pmt[nPmtIndex].section_crc32;
 			pTSFilter->pmt[nPmtIndex].section_crc32 = crc32_tmp;
-			pSection = pTSFilter->pmt_section[uNewIndex];
-			pTSFilter->pmt_section[uNewIndex] = pTSFilter->pmt_section[nPmtIndex];
-			pTSFilter->pmt_section[nPmtIndex] = pSection;
+			pTSFilter->pmt_section[nPmtIndex] = pTSFilter->pmt_section[uNewIndex];
+			pTSFilter->pmt_section[uNewIndex] = pSection;
 		}
 
 		pPmt->program_number = section_header.tsid;
@@ -531,6 +650,7 @@ int UnpackPMT( TS_FILTER *pTSFilter, int nPmtIndex, TS_PACKET *pTSPacket )
 			ParseCADesc( pPmt, &pPmt->program_desc );
 		}
 
+		UnmapProgramPids( pTSFilter, pPmt );
 		packet_offset = 4 + data_length;
 		stream_num = 0;
 		while ( packet_offset + 6 <= section_header.table_bytes )
@@ -588,6 +708,8 @@ int UnpackPMT( TS_FILTER *pTSFilter, int nPmtIndex, TS_PACKET *pTSPacket )
 		}
 
 		pPmt->total_stream_number = stream_num;
+		MapProgramPids( pTSFilter, pPmt );
+		CacheSection( pSection );
 
 	}
 	return update_pmt;
@@ -757,6 +879,7 @@ int UpdatePMTMap( TS_FILTER* pTSFilter, int nPatIndex )
 		}
 	}
 
+	MapPMTPids( pTSFilter );
 	SageLog(( _LOG_ERROR, 3, TEXT("PMT-MAP Table is updated" ) ));
 	return update_flag;
 }
@@ -793,17 +916,6 @@ static int GetPatIndex( TS_FILTER* pTSFilter, unsigned short uPid, unsigned shor
 	return pat_index;
 }
 
-static int GetPmtIndex( TS_FILTER* pTSFilter, unsigned short uPid )
-{
-	int i;
-	for ( i = 0; i<pTSFilter->mapped_num ; i++ )
-	{
-		if ( pTSFilter->pmt_map[i].pid == uPid )
-			return i;
-	}
-	return -1;
-}
-
 static int GetPmtIndex2( TS_FILTER* pTSFilter, unsigned short uPid, unsigned short uProgram )
 {
 	int i;
@@ -849,13 +961,13 @@ static void DumpPMTTable( TS_FILTER* pTSFilter, int pmt_index, int pid )
 
 }
 
-static inline int ParseTSTable( TS_FILTER* pTSFilter, TS_PACKET *pTSPacket )
+static inline int ParseTSTable( TS_FILTER* pTSFilter, TS_PACKET *pTSPacket, PID_HANDLER *pEntry )
 {
 	int pat_index, pmt_index;
 	int ret;
 
 	//process PAT
-	if ( pTSPacket->pid == 0 )
+	if ( pEntry->pid_class & PID_CLASS_PAT )
 	{                                      
 		pat_index = UnpackPAT( pTSFilter, pTSPacket );
 		if ( pat_index >= 0 )
@@ -878,9 +990,10 @@ static inline int ParseTSTable( TS_FILTER* pTSFilter, TS_PACKET *pTSPacket )
 		return 1;
 	} else
 	//if it's PMT pid, process PMT
-	if ( ( pmt_index = GetPmtIndex( pTSFilter, pTSPacket->pid ) ) >= 0 )
+	if ( pEntry->pid_class & PID_CLASS_PMT )
 	{
 		int update_num;
+		pmt_index = pEntry->pmt_index;
 		if ( (update_num = UnpackPMT( pTSFilter, pmt_index, pTSPacket )) > 0 )
 		{
 			if ( pTSFilter->dumper.pmt_dumper != NULL )
@@ -911,16 +1024,24 @@ static inline int ParseTSTable( TS_FILTER* pTSFilter, TS_PACKET *pTSPacket )
 	return 0;
 }
 
-static inline int FilterStreaming( TS_FILTER* pTSFilter, TS_PACKET *pTSPacket )
+static inline int FilterStreaming( TS_FILTER* pTSFilter, TS_PACKET *pTSPacket, PID_HANDLER *pEntry )
 {
 	int i, k = 0, ret = 0;
-	if ( pTSFilter->ts_streams_num )
+	if ( pTSFilter->ts_streams_num && ( pEntry->pid_class & PID_CLASS_STREAM ) )
 	{
 		TS_STREAMS *ts_streams_ptr = pTSFilter->ts_streams[k];
 		
-		//if ( ts_streams_ptr == NULL  ) continue;
+		//streams are changed by the parser without setting up filter (channel reset), remap it
+		i = pEntry->track;
+		if ( i >= ts_streams_ptr->num_stream || pTSPacket->pid != ts_streams_ptr->ts_element[i].pid )
+		{
+			MapStreamPids( pTSFilter );
+			if ( !( pEntry->pid_class & PID_CLASS_STREAM ) )
+				return 0;
+			i = pEntry->track;
+		}
 
-		for ( i = 0; i<ts_streams_ptr->num_stream; i++ )
+		for ( ; i<ts_streams_ptr->num_stream; i++ )
 		{
 			if ( pTSPacket->pid == ts_streams_ptr->ts_element[i].pid )
 			{
@@ -934,6 +1055,8 @@ static inline int FilterStreaming( TS_FILTER* pTSFilter, TS_PACKET *pTSPacket )
 				stream_data.container   = ts_streams_ptr->container;
 				pTSFilter->dumper.stream_dumper( pTSFilter->dumper.stream_dumper_context, (void*)&stream_data, sizeof(STREAM_DATA) );
 				ret = 1;
+				if ( !( pEntry->pid_class & PID_CLASS_SHARED ) )
+					break;
 			}
 		}
 	}
@@ -978,11 +1101,11 @@ static inline void FastFiltering( TS_FILTER* pTSFilter, TS_PACKET* pTSPacket )
 }
 */
 
-static inline void FilterPCRnCA( TS_FILTER* pTSFilter, TS_PACKET *pTSPacket )
+static inline void FilterPCRnCA( TS_FILTER* pTSFilter, TS_PACKET *pTSPacket, PID_HANDLER *pEntry )
 {
 	int k = 0;
 
-	if ( pTSFilter->ts_streams_num )
+	if ( pTSFilter->ts_streams_num && ( pEntry->pid_class & (PID_CLASS_PCR|PID_CLASS_CA) ) )
 	{
 		TS_STREAMS *ts_streams_ptr = pTSFilter->ts_streams[k];
 		
@@ -1039,53 +1162,45 @@ static inline int FilterSageNullPacket( TS_FILTER* pTSFilter, TS_PACKET *pTSPack
 	return 0;
 }
 
-int TSProcess( TS_FILTER* pTSFilter, unsigned char* pData )
+static inline int ProcessTSPacket( TS_FILTER* pTSFilter, TS_PACKET *pTSPacket )
 {
-	TS_PACKET TSPacket;
-
-	pTSFilter->ts_packet_counter++;
+	PID_HANDLER *entry = &pTSFilter->pid_tbl[pTSPacket->pid];
 
-	//parse ts to get data
-	if ( !UnpackTSPacket( &TSPacket, pData ) )
-	{
-		return -1;
-	}
-
-	if ( TSPacket.pid == 0x1fff ) //null packet may caary PCR
+	if ( pTSPacket->pid == 0x1fff ) //null packet may caary PCR
 	{
 		//it's SageTV null packets.
-		if ( FilterSageNullPacket( pTSFilter, &TSPacket ) )
+		if ( FilterSageNullPacket( pTSFilter, pTSPacket ) )
 			return 0;
 
-		FilterPCRnCA( pTSFilter, &TSPacket );
+		FilterPCRnCA( pTSFilter, pTSPacket, entry );
 		return 0;
 	}
 
 	//parse PAT PMT table, to get channel information
 	if ( !pTSFilter->disable_ts_table_parse )
 	{
-		if ( ParseTSTable( pTSFilter, &TSPacket ) > 0 )
+		if ( ParseTSTable( pTSFilter, pTSPacket, entry ) > 0 )
 		{
 			return 1;
 		}
 	}
 
-	HistogramPid( pTSFilter, &TSPacket );
+	HistogramPid( pTSFilter, pTSPacket, entry );
 
 	//filte out a packet to dumper
 	if ( !pTSFilter->disable_stream_filter )
 	{
-		FilterPCRnCA( pTSFilter, &TSPacket );
-		if ( FilterStreaming( pTSFilter, &TSPacket ) > 0 )
+		FilterPCRnCA( pTSFilter, pTSPacket, entry );
+		if ( FilterStreaming( pTSFilter, pTSPacket, entry ) > 0 )
 		{
 			return 1;
 		}
 	}
 
-	//parse PSI data 
+	//parse PSI data
 	if ( !pTSFilter->disable_psi_parse )
 	{
-		if (  ParseTSPSI( pTSFilter, &TSPacket ) > 0 )
+		if (  ParseTSPSI( pTSFilter, pTSPacket ) > 0 )
 		{
 			return 1;
 		}
@@ -1094,10 +1209,32 @@ int TSProcess( TS_FILTER* pTSFilter, unsigned char* pData )
 	return 0;
 }
 
+int TSProcess( TS_FILTER* pTSFilter, unsigned char* pData )
+{
+	TS_PACKET TSPacket;
+	struct MEM_ARENA* prev_arena;
+	int ret;
+
+	pTSFilter->ts_packet_counter++;
+
+	//parse ts to get data
+	if ( !UnpackTSPacket( &TSPacket, pData ) )
+	{
+		return -1;
+	}
+
+	prev_arena = SageMemArenaEnter( pTSFilter->mem_arena );
+	ret = ProcessTSPacket( pTSFilter, &TSPacket );
+	SageMemArenaLeave( prev_arena );
+	return ret;
+}
+
+
 //it called by TSInfoParser only
-int TSProcessInfo( TS_FILTER* pTSFilter, unsigned char* pData )
+static int ProcessTSInfo( TS_FILTER* pTSFilter, unsigned char* pData )
 {
 	TS_PACKET TSPacket;
+	PID_HANDLER *entry;
 
 	pTSFilter->ts_packet_counter++;
 
@@ -1106,17 +1243,18 @@ int TSProcessInfo( TS_FILTER* pTSFilter, unsigned char* pData )
 	{
 		return -1;
 	}
+	entry = &pTSFilter->pid_tbl[TSPacket.pid];
 
 	if ( TSPacket.pid == 0x1fff ) //null packet may caary PCR
 	{
-		FilterPCRnCA( pTSFilter, &TSPacket );
+		FilterPCRnCA( pTSFilter, &TSPacket, entry );
 		return 0;
 	}
 
 	//parse PAT PMT table, to get channel information
 	if ( !pTSFilter->disable_ts_table_parse )
 	{
-		if ( ParseTSTable( pTSFilter, &TSPacket ) > 0 )
+		if ( ParseTSTable( pTSFilter, &TSPacket, entry ) > 0 )
 		{
 			return 1;
 		}
@@ -1125,8 +1263,8 @@ int TSProcessInfo( TS_FILTER* pTSFilter, unsigned char* pData )
 	//filte out a packet to dumper
 	if ( !pTSFilter->disable_stream_filter )
 	{
-		FilterPCRnCA( pTSFilter, &TSPacket );
-		if ( FilterStreaming( pTSFilter, &TSPacket ) > 0 )
+		FilterPCRnCA( pTSFilter, &TSPacket, entry );
+		if ( FilterStreaming( pTSFilter, &TSPacket, entry ) > 0 )
 		{
 			return 2;
 		}
@@ -1144,6 +1282,14 @@ int TSProcessInfo( TS_FILTER* pTSFilter, unsigned char* pData )
 	return 0;
 }
 
+int TSProcessInfo( TS_FILTER* pTSFilter, unsigned char* pData )
+{
+	struct MEM_ARENA* prev_arena = SageMemArenaEnter( pTSFilter->mem_arena );
+	int ret = ProcessTSInfo( pTSFilter, pData );
+	SageMemArenaLeave( prev_arena );
+	return ret;
+}
+
 int BlastPatTable( TS_FILTER* pTSFilter, int nProgram, int nTsid )
 {
 	int pat_index = -1;
@@ -1744,7 +1890,10 @@ int SelectTSFilterChannel( TS_FILTER* pTSFilter, TS_STREAMS* pTsStreams, unsigne
 			pTsStreams->num_stream = k;
 
 			if ( k <= 0 )
+			{
+				MapStreamPids( pTSFilter );
 				return 1;
+			}
 
 			//registry TS_STREAMS for filterring
 			for ( j = 0; j<pTSFilter->ts_streams_num; j++ )
@@ -1780,6 +1929,8 @@ int SelectTSFilterChannel( TS_FILTER* pTSFilter, TS_STREAMS* pTsStreams, unsigne
 					pTSFilter->pid_hist[j].pid = 0;
 				pTSFilter->pid_hist[j].count = 0;
 			}
+			MapStreamPids( pTSFilter );
+			IndexPidHist( pTSFilter );
 
 			return k;
 						
@@ -1891,7 +2042,8 @@ int SetupChannelFilterByPids( TS_FILTER* pTSFilter, TS_STREAMS* pTsStreams, PIDS
 			pTSFilter->pid_hist[j].count = 0;
 		}
 		SageLog(( _LOG_TRACE, 3, TEXT("\t PCR:\tpid:0x%02x"), pTsStreams->pcr_pid ));
-
+		MapStreamPids( pTSFilter );
+		IndexPidHist( pTSFilter );
 	}
 
 	return n;
@@ -1927,6 +2079,8 @@ int SetupChannelFilter( TS_FILTER* pTSFilter, TS_STREAMS* pTsStreams  )
 	{
 		SageLog(( _LOG_TRACE, 3, TEXT("\t PCR:\tpid:0x%02x"), pTsStreams->pcr_pid ));
 	}
+	MapStreamPids( pTSFilter );
+	IndexPidHist( pTSFilter );
 
 	return 1;
 }
@@ -1956,7 +2110,7 @@ int BuildChannelTSFilter( TS_FILTER* pTSFilter, TS_STREAMS* pTsStreams )
 // DESC section
 DESC_DATA* CreateDesc( )
 {
-	DESC_DATA* pDesc = SAGETV_MALLOC( sizeof(DESC_DATA) );
+	DESC_DATA* pDesc = SAGETV_MALLOC_TAG( sizeof(DESC_DATA), MEM_TAG_DESC );
 	return pDesc;
 }
 void ReleaseDesc( DESC_DATA* pDesc )
@@ -1981,7 +2135,7 @@ unsigned char* NewDescData( DESC_DATA* pDesc, int nBytes )
 	{
 		if (  pDesc->buffer_size > 0 )	
 			SAGETV_FREE( pDesc->desc_ptr-4 );
-		pDesc->desc_ptr = (unsigned char*)SAGETV_MALLOC( nBytes+4 )+4;
+		pDesc->desc_ptr = (unsigned char*)SAGETV_MALLOC_TAG( nBytes+4, MEM_TAG_DESC )+4;
 		pDesc->buffer_size = nBytes;
 	}
 	return pDesc->desc_ptr;
@@ -1994,7 +2148,7 @@ unsigned char* FillDescData( DESC_DATA *pDesc, unsigned char* pData, int nBytes
 	{
 		if (  pDesc->buffer_size > 0 )	
 			SAGETV_FREE( pDesc->desc_ptr-4 );
-		pDesc->desc_ptr = (unsigned char*)SAGETV_MALLOC( nBytes+4 )+4;
+		pDesc->desc_ptr = (unsigned char*)SAGETV_MALLOC_TAG( nBytes+4, MEM_TAG_DESC )+4;
 		pDesc->buffer_size = nBytes;
 	}
 	memcpy( pDesc->desc_ptr, pData, nBytes );
@@ -2022,7 +2176,7 @@ unsigned char* NewDescData( DESC_DATA* pDesc, int nBytes )
 	{
 		if (  pDesc->buffer_size > 0 )	
 			SAGETV_FREE( pDesc->desc_ptr );
-		pDesc->desc_ptr = (unsigned char*)SAGETV_MALLOC( nBytes);
+		pDesc->desc_ptr = (unsigned char*)SAGETV_MALLOC_TAG( nBytes, MEM_TAG_DESC );
 		pDesc->buffer_size = nBytes;
 	}
 	return pDesc->desc_ptr;
@@ -2035,7 +2189,7 @@ unsigned char* FillDescData( DESC_DATA *pDesc, unsigned char* pData, int nBytes
 	{
 		if (  pDesc->buffer_size > 0 )	
 			SAGETV_FREE( pDesc->desc_ptr );
-		pDesc->desc_ptr = (unsigned char*)SAGETV_MALLOC( nBytes );
+		pDesc->desc_ptr = (unsigned char*)SAGETV_MALLOC_TAG( nBytes, MEM_TAG_DESC );
 		pDesc->buffer_size = nBytes;
 	}
 	memcpy( pDesc->desc_ptr, pData, nBytes );
@@ -2048,7 +2202,7 @@ unsigned char* AppendDescData( DESC_DATA *pDesc, unsigned char* pData, int nByte
 	assert( pDesc && nBytes > 0 );
 	if ( pDesc->buffer_size < pDesc->desc_bytes + nBytes )
 	{
-		unsigned char* new_buf = (unsigned char*)SAGETV_MALLOC( pDesc->desc_bytes + nBytes );
+		unsigned char* new_buf = (unsigned char*)SAGETV_MALLOC_TAG( pDesc->desc_bytes + nBytes, MEM_TAG_DESC );
 		memcpy( new_buf, pDesc->desc_ptr, pDesc->desc_bytes );
 		if (  pDesc->buffer_size > 0 )	
 			SAGETV_FREE( pDesc->desc_ptr );
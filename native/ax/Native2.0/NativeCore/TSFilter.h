@@ -339,6 +339,27 @@ typedef struct
 	unsigned short flag;  //first bit for PCR flag, 2'd for scrambimg flg
 } PID_HIST;
 
+//PID lookup table, a packet's pid indexes its handlers directly
+#define PID_TBL_SIZE      0x2000
+
+#define PID_CLASS_PAT     0x01
+#define PID_CLASS_PMT     0x02
+#define PID_CLASS_STREAM  0x04
+#define PID_CLASS_PCR     0x08
+#define PID_CLASS_CA      0x10
+#define PID_CLASS_PROGRAM 0x20   //a stream pid listed in a PMT
+#define PID_CLASS_SHARED  0x40   //pid hits more than one track of the filter streams
+
+typedef struct PID_HANDLER
+{
+	unsigned char  pid_class;  //PID_CLASS_xxx bits
+	unsigned char  track;      //ts_element index of a stream pid in filter streams
+	unsigned char  hist;       //pid_hist index+1, 0: not in histogram
+	unsigned char  padding;
+	unsigned short pmt_index;  //pmt_map index of a PMT pid
+	unsigned short program;    //pmt index of a program stream pid
+} PID_HANDLER;
+
 #define MAX_PID_TBL_NUM 6
 
 typedef struct PID_ITEM
@@ -405,9 +426,15 @@ typedef struct TS_FILTER
 	unsigned  short pid_hist_num;
 	unsigned  short pid_hist_ctrl;
 	unsigned  long ts_packet_counter;
-	
+
+	PID_HANDLER *pid_tbl;   //PID_TBL_SIZE entries
+
 	FAST_FILTER fast_filter;
 
+	struct MEM_ARENA* mem_arena;  //section and descriptor buffers of the filter and its PSI parser
+
+	SECTION_CACHE* section_cache; //sections of PAT, PMT and PSI tables unpacked, shared with PSI parser
+
 	char _tag_[4]; //debug tag
 } TS_FILTER;
 
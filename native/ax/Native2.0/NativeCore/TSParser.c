@@ -462,7 +462,7 @@ static inline void UpdateGetCurrentPCRCue( TS_PARSER *pTSParser, SLOT *pSlot, TR
 	}
 }
 
-inline void FillESBlock( TRACK *pTrack, unsigned char* pData, int nBytes )
+inline void FillESBlock( TS_PARSER *pTSParser, TRACK *pTrack, unsigned char* pData, int nBytes )
 {
 	unsigned char* out_ptr  = pTrack->es_data_start + pTrack->es_data_bytes;
 	if ( nBytes < 0 ) 
@@ -481,6 +481,7 @@ inline void FillESBlock( TRACK *pTrack, unsigned char* pData, int nBytes )
 	{
 		memcpy( out_ptr, pData, nBytes );
 		pTrack->es_data_bytes += nBytes;
+		pTSParser->es_copy_bytes += nBytes;
 	} else
 	{
 		SageLog(( _LOG_TRACE, 1, TEXT("ERROR ES block buffer is too small to hold an ES block! (data size:%d, block size:%d)"),  
@@ -719,7 +720,7 @@ static int StreamDumper( void* pContext, unsigned char* pData, int nSize )
 		if ( overflow_bytes > 0 )  //data not close at a TS packet (start group)
 		{
 			//fill in reset of data
-			FillESBlock( track, in_ptr, in_bytes - overflow_bytes );
+			FillESBlock( pTSParser, track, in_ptr, in_bytes - overflow_bytes );
 
 			if ( (slot->state & PARSING_INFO) && 
 				  track->av_elmnt->format_fourcc == 0 &&
@@ -771,10 +772,10 @@ static int StreamDumper( void* pContext, unsigned char* pData, int nSize )
 			}
 
 			if ( overflow_bytes < 0 )
-				FillESBlock( track, in_ptr, in_bytes );
+				FillESBlock( pTSParser, track, in_ptr, in_bytes );
 			else
 			{
-				FillESBlock( track, in_ptr, in_bytes - overflow_bytes );
+				FillESBlock( pTSParser, track, in_ptr, in_bytes - overflow_bytes );
 
 				if ( (slot->state & PARSING_INFO) && 
 					 track->av_elmnt->format_fourcc == 0 &&
@@ -795,7 +796,7 @@ static int StreamDumper( void* pContext, unsigned char* pData, int nSize )
 				in_ptr   +=  in_bytes - overflow_bytes;
 				in_bytes = overflow_bytes;
 
-				FillESBlock( track, in_ptr, in_bytes );
+				FillESBlock( pTSParser, track, in_ptr, in_bytes );
 
 			}
 
@@ -1123,6 +1124,7 @@ void ResetTSParser( TS_PARSER *pTSParser )
 	pTSParser->status = 0;
 	pTSParser->state = PARSING_INFO;
 	pTSParser->used_bytes = 0;
+	pTSParser->es_copy_bytes = 0;
 	pTSParser->bad_packets = 0;
 	pTSParser->bad_blocks = 0;
 	pTSParser->input_packets = 0;
@@ -2815,6 +2817,7 @@ void TSParserZero( TS_PARSER *pTSParser )
 	
 	//zero statistic
 	pTSParser->used_bytes = 0;
+	pTSParser->es_copy_bytes = 0;
 	pTSParser->input_packets = 0;
 	pTSParser->valid_pcakets = 0;
 	pTSParser->bad_packets = 0;
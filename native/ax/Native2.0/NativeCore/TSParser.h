@@ -151,6 +151,7 @@ typedef struct TS_PARSER
 	SLOT  slot[MAX_SLOT_NUM];
 
 	ULONGLONG  used_bytes;
+	ULONGLONG  es_copy_bytes;        //payload bytes copied into ES blocks
 	unsigned long input_packets;
 	unsigned long valid_pcakets;
 	unsigned long bad_packets;
@@ -0,0 +1,686 @@
+/*
+ * Copyright 2015 The SageTV Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifdef Linux
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE   //fallocate
+#endif
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "NativeCore.h"
+#include "RecordWriter.h"
+#include "RecordIndex.h"
+#include "TimeShiftFile.h"
+#include "TimeShiftReader.h"
+
+#ifdef Linux
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#ifdef FALLOC_FL_KEEP_SIZE
+#define TS_FALLOCATE
+#endif
+#endif
+
+#ifdef WIN32
+#include <io.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#endif
+
+//Time-shift file engine of the capture plugins (DVB, HDHomeRun, IVTV, Firewire). The recording file is
+//written by positioned writes, or through RecordWriter batches when it's enabled, a circular file wraps
+//at its end without a seek. A circular file is preallocated at open, a linear one ahead of the data in
+//TS_PREALLOC steps, the blocks past the data are released when it's closed. With TIMESHIFT_PUBLISH readers
+//poll the write position in a shared memory header instead of the file size. A file switch takes the next file at a
+//transition point of the data (FindTransitionPoint), the handle stays the same.
+
+#define TS_PREALLOC        (64*1024*1024)
+#define TS_HEADER_DIR      "/dev/shm"
+#define TS_HEADER_PREFIX   "sagetv-ts-"
+
+#ifdef WIN32
+#include <windows.h>
+#define TS_LOCK              CRITICAL_SECTION
+#define TSLockInit( l )      InitializeCriticalSection( l )
+#define TSLockFree( l )      DeleteCriticalSection( l )
+#define TSLock( l )          EnterCriticalSection( l )
+#define TSUnlock( l )        LeaveCriticalSection( l )
+#define TSPending( ts )      ( (ts)->next != NULL )
+#else
+#include <pthread.h>
+#define TS_LOCK              pthread_mutex_t
+#define TSLockInit( l )      pthread_mutex_init( l, NULL )
+#define TSLockFree( l )      pthread_mutex_destroy( l )
+#define TSLock( l )          pthread_mutex_lock( l )
+#define TSUnlock( l )        pthread_mutex_unlock( l )
+#define TSPending( ts )      ( __atomic_load_n( &(ts)->next, __ATOMIC_ACQUIRE ) != NULL )
+#endif
+
+typedef struct TIMESHIFT_FILE
+{
+	int   fd;
+	char  file_name[1024];
+	ULONGLONG circ_size;
+	ULONGLONG write_pos;		//bytes written into the file, the file offset is write_pos modulo circ_size
+	ULONGLONG prealloc_pos;		//a linear file is preallocated up to here
+	void* writer;				//RecordWriter, NULL writes by pwrite
+	void* index;				//RecordIndex sidecar
+	TIMESHIFT_HEADER* header;
+	unsigned int header_size;	//of the mapped segment, with the shared data window
+	unsigned char* shared_data;
+	char  header_name[64];
+} TIMESHIFT_FILE;
+
+typedef struct TIMESHIFT
+{
+	TIMESHIFT_FILE* file;
+	TIMESHIFT_FILE* volatile next;	//file switched to at a transition point, set by another thread
+	TS_LOCK lock;				//hand over of next, the writer checks it without lock first
+	int   flag;
+	ULONGLONG circ_size;
+	unsigned long sync_bytes;
+	int   trans_format;
+	int   trans_video;
+	int   trans_limit;
+	int   bytes_tested;
+	int   error;
+} TIMESHIFT;
+
+static ULONGLONG FileHash( const char* pFileName )
+{
+	ULONGLONG hash = 0xcbf29ce484222325ULL;	//FNV-1a
+	while ( *pFileName )
+	{
+		hash ^= (unsigned char)*pFileName++;
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+int TimeShiftHeaderName( const char* pFileName, char* pName, int nSize )
+{
+	int len = snprintf( pName, nSize, "%s/%s%016llx", TS_HEADER_DIR, TS_HEADER_PREFIX, FileHash( pFileName ) );
+	return len > 0 && len < nSize;
+}
+
+#ifdef Linux
+//readers of this process wait on their eventfd, readers of another process on the notify_seq futex
+static void WakeReaders( TIMESHIFT_FILE* pFile )
+{
+	TIMESHIFT_HEADER* header = pFile->header;
+	if ( __atomic_load_n( &header->readers, __ATOMIC_SEQ_CST ) == 0 )
+		return;
+	__atomic_add_fetch( &header->notify_seq, 1, __ATOMIC_SEQ_CST );
+	NotifyTimeShiftReaders( pFile->header_name );
+	if ( __atomic_load_n( &header->sleepers, __ATOMIC_SEQ_CST ) )
+		syscall( SYS_futex, &header->notify_seq, FUTEX_WAKE, 0x7fffffff, NULL, NULL, 0 );
+}
+
+static void PublishWritePos( TIMESHIFT_FILE* pFile )
+{
+	if ( pFile->header == NULL )
+		return;
+	__atomic_store_n( &pFile->header->write_pos, pFile->write_pos, __ATOMIC_SEQ_CST );
+	WakeReaders( pFile );
+}
+
+//data_end is moved ahead of the copy, a reader checks it after its copy to know the bytes weren't overwritten
+static void CopySharedData( TIMESHIFT_FILE* pFile, const unsigned char* pData, int nBytes )
+{
+	unsigned int size = pFile->header->data_size, offset, head;
+	ULONGLONG end = pFile->write_pos + nBytes;
+	if ( (unsigned int)nBytes > size )
+	{
+		pData += nBytes - size;
+		nBytes = size;
+	}
+	__atomic_store_n( &pFile->header->data_end, end, __ATOMIC_RELAXED );
+	__atomic_thread_fence( __ATOMIC_RELEASE );
+	offset = (unsigned int)( ( end - nBytes ) % size );
+	head = _MIN( (unsigned int)nBytes, size - offset );
+	memcpy( pFile->shared_data + offset, pData, head );
+	memcpy( pFile->shared_data, pData + head, nBytes - head );
+}
+
+static void OpenHeader( TIMESHIFT_FILE* pFile, int nFlag )
+{
+	TIMESHIFT_HEADER* header;
+	unsigned int size = TIMESHIFT_HEADER_SIZE + ( ( nFlag & TIMESHIFT_SHARED_DATA ) ? TIMESHIFT_SHARED_SIZE : 0 );
+	int fd;
+	if ( !TimeShiftHeaderName( pFile->file_name, pFile->header_name, sizeof(pFile->header_name) ) )
+		return;
+	fd = open( pFile->header_name, O_RDWR|O_CREAT|O_TRUNC, 0644 );
+	if ( fd < 0 )
+		return;
+	if ( ftruncate( fd, size ) == 0 &&
+		 ( header = mmap( NULL, size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0 ) ) != MAP_FAILED )
+	{
+		header->version = TIMESHIFT_HEADER_VERSION;
+		header->circ_size = pFile->circ_size;
+		header->write_pos = 0;
+		header->state = TIMESHIFT_WRITING;
+		header->writer_pid = (unsigned int)getpid( );
+		memcpy( header->file_name, pFile->file_name, sizeof(header->file_name) );
+		header->data_offset = TIMESHIFT_HEADER_SIZE;
+		header->data_size = size - TIMESHIFT_HEADER_SIZE;
+		__atomic_store_n( &header->magic, TIMESHIFT_HEADER_MAGIC, __ATOMIC_RELEASE );
+		pFile->header = header;
+		pFile->header_size = size;
+		pFile->shared_data = header->data_size ? (unsigned char*)header + header->data_offset : NULL;
+	} else
+		unlink( pFile->header_name );
+	close( fd );
+}
+
+//a reader that has it mapped sees it closed, the name is gone for new readers
+static void CloseHeader( TIMESHIFT_FILE* pFile )
+{
+	if ( pFile->header == NULL )
+		return;
+	__atomic_store_n( &pFile->header->write_pos, pFile->write_pos, __ATOMIC_SEQ_CST );
+	__atomic_store_n( &pFile->header->state, TIMESHIFT_CLOSED, __ATOMIC_SEQ_CST );
+	WakeReaders( pFile );
+	munmap( pFile->header, pFile->header_size );
+	unlink( pFile->header_name );
+	pFile->header = NULL;
+	pFile->shared_data = NULL;
+}
+
+static void Preallocate( TIMESHIFT_FILE* pFile, ULONGLONG lEnd )
+{
+#ifdef TS_FALLOCATE
+	ULONGLONG start = pFile->prealloc_pos;
+	if ( pFile->circ_size )
+		lEnd = pFile->circ_size;
+	else
+		lEnd = ( lEnd + TS_PREALLOC-1 ) / TS_PREALLOC * TS_PREALLOC;
+	if ( lEnd <= start )
+		return;
+	pFile->prealloc_pos = lEnd;
+	//keeps the file size, readers of the file size see only data
+	if ( fallocate( pFile->fd, FALLOC_FL_KEEP_SIZE, (off_t)start, (off_t)( lEnd-start ) ) < 0 )
+	{
+		SageLog(( _LOG_TRACE, 3, TEXT("TimeShiftFile: fallocate isn't supported on %s, errno:%d"), pFile->file_name, errno ));
+		pFile->prealloc_pos = (ULONGLONG)-1;	//don't try again
+	}
+#endif
+}
+
+//truncating to its own size frees blocks past the end, a hole punched there isn't freed by ext4
+static void ReleasePreallocated( TIMESHIFT_FILE* pFile )
+{
+#ifdef TS_FALLOCATE
+	if ( pFile->circ_size || pFile->prealloc_pos == (ULONGLONG)-1 || pFile->prealloc_pos <= pFile->write_pos )
+		return;
+	if ( ftruncate( pFile->fd, (off_t)pFile->write_pos ) < 0 )
+		SageLog(( _LOG_TRACE, 3, TEXT("TimeShiftFile: failed release preallocated %s, errno:%d"), pFile->file_name, errno ));
+#endif
+}
+
+#else
+static void PublishWritePos( TIMESHIFT_FILE* pFile ) { }
+static void CopySharedData( TIMESHIFT_FILE* pFile, const unsigned char* pData, int nBytes ) { }
+static void OpenHeader( TIMESHIFT_FILE* pFile, int nFlag ) { }
+static void CloseHeader( TIMESHIFT_FILE* pFile ) { }
+static void Preallocate( TIMESHIFT_FILE* pFile, ULONGLONG lEnd ) { }
+static void ReleasePreallocated( TIMESHIFT_FILE* pFile ) { }
+#endif
+
+static int PWrite( int nFd, const unsigned char* pData, int nBytes, ULONGLONG lOffset )
+{
+	int bytes = 0;
+	while ( bytes < nBytes )
+	{
+#ifdef WIN32
+		int ret = -1;
+		if ( _lseeki64( nFd, lOffset+bytes, SEEK_SET ) >= 0 )
+			ret = _write( nFd, pData+bytes, nBytes-bytes );
+#else
+		ssize_t ret = pwrite( nFd, pData+bytes, nBytes-bytes, (off_t)( lOffset+bytes ) );
+#endif
+		if ( ret < 0 )
+		{
+			if ( errno == EINTR )
+				continue;
+			SageLog(( _LOG_ERROR, 3, TEXT("TimeShiftFile: write failed at %lld, errno:%d"), lOffset+bytes, errno ));
+			return -1;
+		}
+		bytes += (int)ret;
+	}
+	return bytes;
+}
+
+static TIMESHIFT_FILE* OpenFile( const char* pFileName, ULONGLONG lCircFileSize, int nFlag )
+{
+	TIMESHIFT_FILE* file;
+	char index_name[1024];
+	file = SAGETV_MALLOC( sizeof(TIMESHIFT_FILE) );
+	if ( file == NULL )
+		return NULL;
+	memset( file, 0, sizeof(TIMESHIFT_FILE) );
+	strncpy( file->file_name, pFileName, sizeof(file->file_name)-1 );
+	file->circ_size = lCircFileSize;
+#ifdef WIN32
+	file->fd = _open( pFileName, _O_WRONLY|_O_CREAT|_O_TRUNC|_O_BINARY, _S_IREAD|_S_IWRITE );
+#else
+	file->fd = open( pFileName, O_WRONLY|O_CREAT|O_TRUNC, 0666 );
+#endif
+	if ( file->fd < 0 )
+	{
+		SageLog(( _LOG_ERROR, 3, TEXT("TimeShiftFile: failed open %s, errno:%d"), pFileName, errno ));
+		SAGETV_FREE( file );
+		return NULL;
+	}
+	Preallocate( file, 0 );
+	if ( nFlag & TIMESHIFT_WRITER )
+	{
+		int engine = nFlag & RECORD_WRITER_ENGINE;
+		int flag = ( engine ? engine-1 : RECORD_WRITER_AUTO ) | ( nFlag & RECORD_WRITER_DIRECT );
+		file->writer = OpenRecordWriter( file->fd, lCircFileSize, 0, 0, flag );
+	}
+	if ( ( nFlag & TIMESHIFT_INDEX ) && !lCircFileSize && RecordIndexFileName( pFileName, index_name, sizeof(index_name) ) )
+		file->index = OpenRecordIndex( index_name );
+	if ( nFlag & ( TIMESHIFT_PUBLISH | TIMESHIFT_SHARED_DATA ) )
+		OpenHeader( file, nFlag );
+	return file;
+}
+
+//returns 0 if data written through RecordWriter failed
+static int CloseFile( TIMESHIFT_FILE* pFile )
+{
+	int ret = 1;
+	if ( pFile->writer != NULL )
+		ret = CloseRecordWriter( pFile->writer );
+	CloseHeader( pFile );
+	if ( pFile->index != NULL )
+		CloseRecordIndex( pFile->index );
+	ReleasePreallocated( pFile );
+#ifdef WIN32
+	_close( pFile->fd );
+#else
+	close( pFile->fd );
+#endif
+	SAGETV_FREE( pFile );
+	return ret;
+}
+
+static int WriteOut( TIMESHIFT_FILE* pFile, const unsigned char* pData, int nBytes )
+{
+	int bytes;
+	if ( nBytes <= 0 )
+		return 0;
+	if ( pFile->writer != NULL )
+	{
+		//RecordWriter wraps a circular file inside, published at flush
+		bytes = PushRecordData( pFile->writer, pData, nBytes );
+		if ( bytes == 0 )
+			return -1;
+	} else
+	{
+		ULONGLONG offset = pFile->circ_size ? pFile->write_pos % pFile->circ_size : pFile->write_pos;
+		int head = nBytes;
+		if ( !pFile->circ_size && pFile->prealloc_pos != (ULONGLONG)-1 && offset + nBytes > pFile->prealloc_pos )
+			Preallocate( pFile, offset + nBytes );
+		if ( pFile->circ_size && offset + nBytes > pFile->circ_size )
+			head = (int)( pFile->circ_size - offset );
+		if ( PWrite( pFile->fd, pData, head, offset ) < 0 ||
+			 ( head < nBytes && PWrite( pFile->fd, pData+head, nBytes-head, 0 ) < 0 ) )
+			return -1;
+		bytes = nBytes;
+	}
+	if ( pFile->index != NULL )
+		PushRecordIndexData( pFile->index, pData, bytes );
+	if ( pFile->shared_data != NULL )
+		CopySharedData( pFile, pData, bytes );
+	pFile->write_pos += bytes;
+	if ( pFile->writer == NULL )
+		PublishWritePos( pFile );
+	return bytes;
+}
+
+//the next file takes the place of the current one, called with the lock held
+static void TakeNext( TIMESHIFT* ts )
+{
+	if ( !CloseFile( ts->file ) )
+		ts->error = 1;
+	ts->file = ts->next;
+	ts->next = NULL;
+}
+
+void* OpenTimeShiftFile( const char* pFileName, ULONGLONG lCircFileSize, int nFlag )
+{
+	TIMESHIFT* ts;
+	TIMESHIFT_FILE* file;
+	if ( pFileName == NULL || ( file = OpenFile( pFileName, lCircFileSize, nFlag ) ) == NULL )
+		return NULL;
+	ts = SAGETV_MALLOC( sizeof(TIMESHIFT) );
+	if ( ts == NULL )
+	{
+		CloseFile( file );
+		return NULL;
+	}
+	memset( ts, 0, sizeof(TIMESHIFT) );
+	ts->file = file;
+	ts->flag = nFlag;
+	ts->circ_size = lCircFileSize;
+	ts->trans_limit = TIMESHIFT_TRANSITION_LIMIT;
+	TSLockInit( &ts->lock );
+	SageLog(( _LOG_TRACE, 3, TEXT("TimeShiftFile: open %s writer:%s circular:%lld header:%s"), pFileName,
+		TimeShiftWriterName( ts ), lCircFileSize, file->header ? file->header_name : "none" ));
+	return ts;
+}
+
+int CloseTimeShiftFile( void* Handle )
+{
+	TIMESHIFT* ts = (TIMESHIFT*)Handle;
+	int ret;
+	if ( ts == NULL )
+		return 0;
+	//a pending file never reached its transition point, it has no data
+	if ( ts->next != NULL )
+		CloseFile( ts->next );
+	ret = CloseFile( ts->file ) && !ts->error;
+	TSLockFree( &ts->lock );
+	SAGETV_FREE( ts );
+	return ret;
+}
+
+int WriteTimeShiftData( void* Handle, const unsigned char* pData, int nBytes )
+{
+	TIMESHIFT* ts = (TIMESHIFT*)Handle;
+	int written = 0, bytes;
+	if ( ts == NULL || pData == NULL || nBytes <= 0 )
+		return 0;
+
+	if ( TSPending( ts ) )
+	{
+		int pos;
+		TSLock( &ts->lock );
+		pos = ts->trans_limit ? FindTransitionPoint( pData, nBytes, ts->trans_format, ts->trans_video ) : 0;
+		if ( pos >= 0 || ( ts->bytes_tested += nBytes ) > ts->trans_limit )
+		{
+			//data before the transition point finish the old file, a circular one is dropped as it is
+			if ( pos > 0 )
+			{
+				if ( !ts->circ_size && ( written = WriteOut( ts->file, pData, pos ) ) < 0 )
+				{
+					ts->error = 1;
+					written = 0;
+				}
+				pData += pos;
+				nBytes -= pos;
+			}
+			SageLog(( _LOG_TRACE, 3, TEXT("TimeShiftFile: transition %s after %d bytes, switch %s to %s"),
+				pos >= 0 ? "found" : "limit reached", ts->bytes_tested + _MAX( pos, 0 ), ts->file->file_name, ts->next->file_name ));
+			TakeNext( ts );
+		}
+		TSUnlock( &ts->lock );
+	}
+
+	if ( ( bytes = WriteOut( ts->file, pData, nBytes ) ) < 0 )
+	{
+		ts->error = 1;
+		return -1;
+	}
+	return written + bytes;
+}
+
+int FlushTimeShiftFile( void* Handle )
+{
+	TIMESHIFT* ts = (TIMESHIFT*)Handle;
+	TIMESHIFT_FILE* file;
+	if ( ts == NULL )
+		return 0;
+	file = ts->file;
+	if ( file->writer != NULL )
+	{
+		if ( !FlushRecordWriter( file->writer ) )
+			ts->error = 1;
+		PublishWritePos( file );
+	}
+	if ( file->index != NULL )
+		FlushRecordIndex( file->index );
+	return !ts->error;
+}
+
+int SwitchTimeShiftFile( void* Handle, const char* pFileName, int nFormat, int nVideoType, int nLimit )
+{
+	TIMESHIFT* ts = (TIMESHIFT*)Handle;
+	TIMESHIFT_FILE *next, *pending;
+	if ( ts == NULL || pFileName == NULL || ( next = OpenFile( pFileName, ts->circ_size, ts->flag ) ) == NULL )
+		return 0;
+	SetupRecordWriterSync( next->writer, ts->sync_bytes, 0 );
+	TSLock( &ts->lock );
+	pending = ts->next;
+	ts->trans_format = nFormat;
+	ts->trans_video = nVideoType;
+	ts->trans_limit = nLimit;
+	ts->bytes_tested = 0;
+	ts->next = next;
+	TSUnlock( &ts->lock );
+	//switched again before the last one was taken
+	if ( pending != NULL )
+		CloseFile( pending );
+	return 1;
+}
+
+int TimeShiftSwitchPending( void* Handle )
+{
+	TIMESHIFT* ts = (TIMESHIFT*)Handle;
+	return ts != NULL && TSPending( ts );
+}
+
+int ForceTimeShiftSwitch( void* Handle )
+{
+	TIMESHIFT* ts = (TIMESHIFT*)Handle;
+	int ret = 0;
+	if ( ts == NULL )
+		return 0;
+	TSLock( &ts->lock );
+	if ( ts->next != NULL )
+	{
+		SageLog(( _LOG_TRACE, 3, TEXT("TimeShiftFile: no transition after %d bytes, switch %s to %s"),
+			ts->bytes_tested, ts->file->file_name, ts->next->file_name ));
+		TakeNext( ts );
+		ret = 1;
+	}
+	TSUnlock( &ts->lock );
+	return ret;
+}
+
+void SetupTimeShiftSync( void* Handle, unsigned long lSyncBytes )
+{
+	TIMESHIFT* ts = (TIMESHIFT*)Handle;
+	if ( ts == NULL )
+		return;
+	ts->sync_bytes = lSyncBytes;
+	SetupRecordWriterSync( ts->file->writer, lSyncBytes, 0 );
+}
+
+ULONGLONG TimeShiftBytes( void* Handle )
+{
+	TIMESHIFT* ts = (TIMESHIFT*)Handle;
+	return ts != NULL ? ts->file->write_pos : 0;
+}
+
+int TimeShiftFd( void* Handle )
+{
+	TIMESHIFT* ts = (TIMESHIFT*)Handle;
+	return ts != NULL ? ts->file->fd : -1;
+}
+
+const char* TimeShiftFileName( void* Handle )
+{
+	TIMESHIFT* ts = (TIMESHIFT*)Handle;
+	return ts != NULL ? ts->file->file_name : "";
+}
+
+char* TimeShiftWriterName( void* Handle )
+{
+	TIMESHIFT* ts = (TIMESHIFT*)Handle;
+	if ( ts == NULL || ts->file->writer == NULL )
+		return "pwrite";
+	return RecordWriterEngineName( RecordWriterEngine( ts->file->writer ) );
+}
+
+// NOTE: This could get bad start codes.
+static int VerifyPSBlock( const unsigned char *data, int videotype )
+{
+	unsigned char b;
+	unsigned int pos = 0;
+	unsigned int cur = 0xFFFFFFFF;
+	while ( pos < 2048 )
+	{
+		b = data[pos];
+		pos += 1;
+		cur <<= 8;
+		cur |= b;
+		if ( videotype == 2 )
+		{
+			//video sequence header
+			if ( ( cur&0xFFFFFF00 ) == 0x00000100 && b == 0xB3 )
+				return 1;
+		}
+		else if ( videotype == 3 )
+		{
+			//H.264 access unit delimiter
+			if ( cur == 0x00000001 && pos+3 < 2048 &&
+				 data[pos] == 0x09 && data[pos+1] == 0x10 && data[pos+2] == 0x00 )
+				return 1;
+		}
+		else
+		{
+			return 1;
+		}
+	}
+	return 0;
+}
+
+// TODO: implement TS support for other source than HDPVR
+// videotype 1: mpeg1 2:mpeg2 3:h264
+int FindTransitionPoint( const unsigned char* pData, int nBytes, int nFormat, int nVideoType )
+{
+	const unsigned char* data = pData;
+	int numbytes = nBytes;
+
+	if ( nFormat == TIMESHIFT_TS )
+	{
+		int i, j;
+		// For the HDPVR our input is a tranport stream, we must find a valid start point
+		// in the video pid 0x1011 of 00 00 01 09 10 00
+
+		// First we try to locate ts packets
+		for ( i = 0; i<numbytes; i++ )
+		{
+			if ( data[i] == 0x47 &&
+				 (i+188) < numbytes && data[i+188] == 0x47 &&
+				 (i+188*2) < numbytes && data[i+188*2] == 0x47 )
+				break;
+		}
+
+		// Second we find a ts packet with section start and pid 0x1011
+		while ( (i+188) <= numbytes )
+		{
+			if ( data[i] == 0x47 && data[i+1] == 0x50 && data[i+2] == 0x11 )
+			{
+				// If the packet contains the magic sequence 00 00 00 01 09 10 00, the data up to the begining
+				// of this TS packet go in old file and the new data in the new file
+				for ( j = 4; j<188-7; j++ )
+				{
+					if ( data[i+j] == 0x00 && data[i+j+1] == 0x00 && data[i+j+2] == 0x00 && data[i+j+3] == 0x01 &&
+						 data[i+j+4] == 0x09 && data[i+j+5] == 0x10 && data[i+j+6] == 0x00 )
+						return i;
+				}
+			}
+			i += 188;
+		}
+	}
+	else
+	{
+		// For the IVTV cards we must find a sequence start inside the video stream
+		// we are looking for 00 00 01 B3, IVTV use 2K blocks
+		// First locate the 00 00 01 BA block
+		int i = 0;
+		while ( i <= numbytes-2048 )
+		{
+			if ( data[i] == 0x00 && data[i+1] == 0x00 && data[i+2] == 0x01 && data[i+3] == 0xBA )
+			{
+				if ( VerifyPSBlock( &data[i], nVideoType ) )
+					return i;
+				i += 2048;
+			}
+			else
+			{
+				i++;
+			}
+		}
+	}
+	return -1;
+}
+
+#ifdef Linux
+const TIMESHIFT_HEADER* OpenTimeShiftHeader( const char* pFileName )
+{
+	char name[64];
+	TIMESHIFT_HEADER* header;
+	int fd;
+	if ( pFileName == NULL || !TimeShiftHeaderName( pFileName, name, sizeof(name) ) )
+		return NULL;
+	if ( ( fd = open( name, O_RDONLY ) ) < 0 )
+		return NULL;
+	header = mmap( NULL, sizeof(TIMESHIFT_HEADER), PROT_READ, MAP_SHARED, fd, 0 );
+	close( fd );
+	if ( header == MAP_FAILED )
+		return NULL;
+	//the name hashes the file name, a collision or a header being set up isn't taken
+	if ( __atomic_load_n( &header->magic, __ATOMIC_ACQUIRE ) != TIMESHIFT_HEADER_MAGIC ||
+		 header->version != TIMESHIFT_HEADER_VERSION || strncmp( header->file_name, pFileName, sizeof(header->file_name) ) )
+	{
+		munmap( header, sizeof(TIMESHIFT_HEADER) );
+		return NULL;
+	}
+	return header;
+}
+
+void CloseTimeShiftHeader( const TIMESHIFT_HEADER* pHeader )
+{
+	if ( pHeader != NULL )
+		munmap( (void*)pHeader, sizeof(TIMESHIFT_HEADER) );
+}
+
+ULONGLONG TimeShiftWritePos( const TIMESHIFT_HEADER* pHeader )
+{
+	return pHeader != NULL ? __atomic_load_n( &pHeader->write_pos, __ATOMIC_ACQUIRE ) : 0;
+}
+
+int TimeShiftState( const TIMESHIFT_HEADER* pHeader )
+{
+	return pHeader != NULL ? (int)__atomic_load_n( &pHeader->state, __ATOMIC_ACQUIRE ) : TIMESHIFT_CLOSED;
+}
+#else
+const TIMESHIFT_HEADER* OpenTimeShiftHeader( const char* pFileName ) { return NULL; }
+void CloseTimeShiftHeader( const TIMESHIFT_HEADER* pHeader ) { }
+ULONGLONG TimeShiftWritePos( const TIMESHIFT_HEADER* pHeader ) { return 0; }
+int TimeShiftState( const TIMESHIFT_HEADER* pHeader ) { return TIMESHIFT_CLOSED; }
+#endif
@@ -0,0 +1,100 @@
+/*
+ * Copyright 2015 The SageTV Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TIMESHIFT_FILE_H
+#define TIMESHIFT_FILE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//open flags, the low byte is "record_writer" of debugserver.ini: RecordWriter engine flag + 1, 0 writes by pwrite
+#define TIMESHIFT_WRITER       0x00ff
+#define TIMESHIFT_INDEX        0x0100	//keep a RecordIndex sidecar, PS data of a linear file only
+#define TIMESHIFT_PUBLISH      0x0200	//publish the shared memory header
+#define TIMESHIFT_SHARED_DATA  0x0400	//keep the latest TIMESHIFT_SHARED_SIZE bytes in the header's segment, implies TIMESHIFT_PUBLISH
+
+//transition point of a file switch
+#define TIMESHIFT_PS           0		//pack with a sequence header (videotype 2), H.264 AUD (3), any pack (0)
+#define TIMESHIFT_TS           1		//HDPVR video PID 0x1011 packet with AUD
+#define TIMESHIFT_TRANSITION_LIMIT  (8*1024*1024)
+
+#define TIMESHIFT_HEADER_MAGIC 0x48535453	//"STSH"
+#define TIMESHIFT_HEADER_VERSION 2
+#define TIMESHIFT_WRITING      1
+#define TIMESHIFT_CLOSED       2
+#define TIMESHIFT_HEADER_SIZE  4096
+#define TIMESHIFT_SHARED_SIZE  (4*1024*1024)
+
+//shared memory header of a time-shift file, "/dev/shm/sagetv-ts-<hash of file name>". The writer publishes
+//write_pos after data are in the file, a reader polls it with an acquire load, no syscall. Bytes
+//[write_pos-circ_size, write_pos) of a circular file are valid, at file offset pos modulo circ_size.
+//With TIMESHIFT_SHARED_DATA the data are copied into a window of data_size bytes at data_offset of the
+//segment too, byte pos at pos modulo data_size; bytes from data_end-data_size up to write_pos are valid.
+//While readers are attached (TimeShiftReader.h) notify_seq is bumped at each publish and wakes them.
+typedef struct TIMESHIFT_HEADER
+{
+	unsigned int magic;
+	unsigned int version;
+	ULONGLONG circ_size;			//0 for a linear file
+	volatile ULONGLONG write_pos;	//bytes written since the file is opened
+	volatile unsigned int state;	//TIMESHIFT_WRITING, TIMESHIFT_CLOSED when the writer closes or switches the file
+	unsigned int writer_pid;
+	char file_name[1024];
+	volatile unsigned int notify_seq;	//futex word of readers in another process
+	volatile unsigned int readers;		//attached readers
+	volatile unsigned int sleepers;		//readers waiting on notify_seq
+	unsigned int data_size;				//0 without shared data
+	unsigned int data_offset;
+	unsigned int reserved;
+	volatile ULONGLONG data_end;		//the window is filled up to here, it's moved before bytes are copied
+} TIMESHIFT_HEADER;
+
+//time-shift output of a capture plugin, owns the recording file (and its index sidecar), the file is
+//truncated. A circular file of lCircFileSize is preallocated, it wraps without seek. NULL on failure.
+void* OpenTimeShiftFile( const char* pFileName, ULONGLONG lCircFileSize, int nFlag );
+int   CloseTimeShiftFile( void* Handle );
+//returns bytes written into the current file(s), -1 on write error.
+int   WriteTimeShiftData( void* Handle, const unsigned char* pData, int nBytes );
+//writes out RecordWriter batches and publishes them, data are visible to readers after it
+int   FlushTimeShiftFile( void* Handle );
+//next file is opened now and taken at a transition point of the data written after, or when nLimit bytes
+//are written without one (0 switches at the next write). Data before the transition point go to the
+//current file, unless it's circular.
+int   SwitchTimeShiftFile( void* Handle, const char* pFileName, int nFormat, int nVideoType, int nLimit );
+int   TimeShiftSwitchPending( void* Handle );
+int   ForceTimeShiftSwitch( void* Handle );	//takes the pending file now, without a transition point
+void  SetupTimeShiftSync( void* Handle, unsigned long lSyncBytes );
+ULONGLONG TimeShiftBytes( void* Handle );	//written into the current file
+int   TimeShiftFd( void* Handle );
+const char* TimeShiftFileName( void* Handle );
+char* TimeShiftWriterName( void* Handle );
+
+//offset of the transition point in pData, -1 if there's none
+int   FindTransitionPoint( const unsigned char* pData, int nBytes, int nFormat, int nVideoType );
+
+//reader side
+int   TimeShiftHeaderName( const char* pFileName, char* pName, int nSize );
+const TIMESHIFT_HEADER* OpenTimeShiftHeader( const char* pFileName );	//NULL when no writer publishes the file
+void  CloseTimeShiftHeader( const TIMESHIFT_HEADER* pHeader );
+ULONGLONG TimeShiftWritePos( const TIMESHIFT_HEADER* pHeader );
+int   TimeShiftState( const TIMESHIFT_HEADER* pHeader );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
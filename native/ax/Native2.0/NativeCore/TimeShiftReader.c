@@ -0,0 +1,282 @@
+/*
+ * Copyright 2015 The SageTV Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "NativeCore.h"
+#include "TimeShiftFile.h"
+#include "TimeShiftReader.h"
+
+#ifdef Linux
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+//A reader maps the whole segment of the header (with the shared data window) read/write, it counts itself
+//in readers and sleepers of the header so that the writer signals only while somebody is there. Readers
+//of a writer in this process are kept in reader_list, the writer signals their eventfd at each publish.
+
+typedef struct TIMESHIFT_READER
+{
+	TIMESHIFT_HEADER* header;
+	unsigned int size;
+	const unsigned char* data;
+	int   efd;
+	char  header_name[64];
+	struct TIMESHIFT_READER* next;
+} TIMESHIFT_READER;
+
+static pthread_mutex_t reader_lock = PTHREAD_MUTEX_INITIALIZER;
+static TIMESHIFT_READER* reader_list = NULL;
+static int reader_num = 0;
+
+void NotifyTimeShiftReaders( const char* pHeaderName )
+{
+	TIMESHIFT_READER* reader;
+	if ( __atomic_load_n( &reader_num, __ATOMIC_ACQUIRE ) == 0 )
+		return;
+	pthread_mutex_lock( &reader_lock );
+	for ( reader = reader_list; reader != NULL; reader = reader->next )
+	{
+		if ( !strcmp( reader->header_name, pHeaderName ) )
+		{
+			uint64_t one = 1;
+			if ( write( reader->efd, &one, sizeof(one) ) < 0 && errno != EAGAIN )
+				SageLog(( _LOG_TRACE, 3, TEXT("TimeShiftReader: eventfd signal failed, errno:%d"), errno ));
+		}
+	}
+	pthread_mutex_unlock( &reader_lock );
+}
+
+void* OpenTimeShiftReader( const char* pFileName )
+{
+	TIMESHIFT_READER* reader;
+	TIMESHIFT_HEADER* header;
+	struct stat st;
+	char name[64];
+	int fd;
+	if ( pFileName == NULL || !TimeShiftHeaderName( pFileName, name, sizeof(name) ) )
+		return NULL;
+	if ( ( fd = open( name, O_RDWR ) ) < 0 )
+		return NULL;
+	if ( fstat( fd, &st ) < 0 || st.st_size < TIMESHIFT_HEADER_SIZE ||
+		 ( header = mmap( NULL, st.st_size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0 ) ) == MAP_FAILED )
+	{
+		close( fd );
+		return NULL;
+	}
+	close( fd );
+	//the name hashes the file name, a collision or a header being set up isn't taken
+	if ( __atomic_load_n( &header->magic, __ATOMIC_ACQUIRE ) != TIMESHIFT_HEADER_MAGIC ||
+		 header->version != TIMESHIFT_HEADER_VERSION || strncmp( header->file_name, pFileName, sizeof(header->file_name) ) ||
+		 (ULONGLONG)header->data_offset + header->data_size > (ULONGLONG)st.st_size )
+	{
+		munmap( header, st.st_size );
+		return NULL;
+	}
+
+	reader = SAGETV_MALLOC( sizeof(TIMESHIFT_READER) );
+	if ( reader == NULL )
+	{
+		munmap( header, st.st_size );
+		return NULL;
+	}
+	memset( reader, 0, sizeof(TIMESHIFT_READER) );
+	reader->header = header;
+	reader->size = (unsigned int)st.st_size;
+	reader->data = header->data_size ? (unsigned char*)header + header->data_offset : NULL;
+	reader->efd = -1;
+	memcpy( reader->header_name, name, sizeof(reader->header_name) );
+	if ( header->writer_pid == (unsigned int)getpid( ) &&
+		 ( reader->efd = eventfd( 0, EFD_NONBLOCK|EFD_CLOEXEC ) ) >= 0 )
+	{
+		pthread_mutex_lock( &reader_lock );
+		reader->next = reader_list;
+		reader_list = reader;
+		__atomic_add_fetch( &reader_num, 1, __ATOMIC_RELEASE );
+		pthread_mutex_unlock( &reader_lock );
+	}
+	__atomic_add_fetch( &header->readers, 1, __ATOMIC_SEQ_CST );
+	SageLog(( _LOG_TRACE, 3, TEXT("TimeShiftReader: open %s pos:%lld shared data:%d %s"), pFileName,
+		TimeShiftReaderPos( reader ), header->data_size, reader->efd >= 0 ? "eventfd" : "futex" ));
+	return reader;
+}
+
+void CloseTimeShiftReader( void* Handle )
+{
+	TIMESHIFT_READER* reader = (TIMESHIFT_READER*)Handle;
+	TIMESHIFT_READER** link;
+	if ( reader == NULL )
+		return;
+	__atomic_sub_fetch( &reader->header->readers, 1, __ATOMIC_SEQ_CST );
+	if ( reader->efd >= 0 )
+	{
+		pthread_mutex_lock( &reader_lock );
+		for ( link = &reader_list; *link != NULL; link = &(*link)->next )
+		{
+			if ( *link == reader )
+			{
+				*link = reader->next;
+				__atomic_sub_fetch( &reader_num, 1, __ATOMIC_RELEASE );
+				break;
+			}
+		}
+		pthread_mutex_unlock( &reader_lock );
+		close( reader->efd );
+	}
+	munmap( reader->header, reader->size );
+	SAGETV_FREE( reader );
+}
+
+int TimeShiftReaderEventFd( void* Handle )
+{
+	TIMESHIFT_READER* reader = (TIMESHIFT_READER*)Handle;
+	return reader != NULL ? reader->efd : -1;
+}
+
+void TimeShiftReaderEvent( void* Handle )
+{
+	TIMESHIFT_READER* reader = (TIMESHIFT_READER*)Handle;
+	uint64_t count;
+	if ( reader != NULL && reader->efd >= 0 )
+		while ( read( reader->efd, &count, sizeof(count) ) < 0 && errno == EINTR );
+}
+
+ULONGLONG TimeShiftReaderPos( void* Handle )
+{
+	TIMESHIFT_READER* reader = (TIMESHIFT_READER*)Handle;
+	return reader != NULL ? __atomic_load_n( &reader->header->write_pos, __ATOMIC_ACQUIRE ) : 0;
+}
+
+int TimeShiftReaderClosed( void* Handle )
+{
+	TIMESHIFT_READER* reader = (TIMESHIFT_READER*)Handle;
+	return reader == NULL || __atomic_load_n( &reader->header->state, __ATOMIC_ACQUIRE ) == TIMESHIFT_CLOSED;
+}
+
+static long long NowMs( )
+{
+	struct timespec ts;
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return (long long)ts.tv_sec*1000 + ts.tv_nsec/1000000;
+}
+
+ULONGLONG WaitTimeShiftData( void* Handle, ULONGLONG lPos, int nTimeout )
+{
+	TIMESHIFT_READER* reader = (TIMESHIFT_READER*)Handle;
+	TIMESHIFT_HEADER* header;
+	long long deadline = nTimeout >= 0 ? NowMs( ) + nTimeout : 0;
+	ULONGLONG pos;
+	if ( reader == NULL )
+		return 0;
+	header = reader->header;
+	for ( ;; )
+	{
+		int wait_ms = -1;
+		pos = __atomic_load_n( &header->write_pos, __ATOMIC_SEQ_CST );
+		if ( pos > lPos || TimeShiftReaderClosed( reader ) )
+			return pos;
+		if ( nTimeout >= 0 && ( wait_ms = (int)( deadline - NowMs( ) ) ) <= 0 )
+			return pos;
+		if ( reader->efd >= 0 )
+		{
+			struct pollfd pfd;
+			pfd.fd = reader->efd;
+			pfd.events = POLLIN;
+			if ( poll( &pfd, 1, wait_ms ) > 0 )
+				TimeShiftReaderEvent( reader );
+		} else
+		{
+			//the writer bumps notify_seq after it publishes and wakes if it sees a sleeper
+			unsigned int seq = __atomic_load_n( &header->notify_seq, __ATOMIC_SEQ_CST );
+			__atomic_add_fetch( &header->sleepers, 1, __ATOMIC_SEQ_CST );
+			if ( __atomic_load_n( &header->write_pos, __ATOMIC_SEQ_CST ) <= lPos && !TimeShiftReaderClosed( reader ) )
+			{
+				struct timespec ts;
+				ts.tv_sec = wait_ms / 1000;
+				ts.tv_nsec = ( wait_ms % 1000 ) * 1000000L;
+				syscall( SYS_futex, &header->notify_seq, FUTEX_WAIT, seq, wait_ms >= 0 ? &ts : NULL, NULL, 0 );
+			}
+			__atomic_sub_fetch( &header->sleepers, 1, __ATOMIC_SEQ_CST );
+		}
+	}
+}
+
+int PeekTimeShiftData( void* Handle, ULONGLONG lPos, const unsigned char** ppData )
+{
+	TIMESHIFT_READER* reader = (TIMESHIFT_READER*)Handle;
+	unsigned int size, offset;
+	ULONGLONG pos, end;
+	if ( reader == NULL || reader->data == NULL )
+		return -1;
+	size = reader->header->data_size;
+	pos = __atomic_load_n( &reader->header->write_pos, __ATOMIC_ACQUIRE );
+	end = __atomic_load_n( &reader->header->data_end, __ATOMIC_ACQUIRE );
+	if ( lPos + size < end )
+		return -1;
+	if ( lPos >= pos )
+		return 0;
+	offset = (unsigned int)( lPos % size );
+	*ppData = reader->data + offset;
+	return (int)_MIN( pos - lPos, (ULONGLONG)( size - offset ) );
+}
+
+int TimeShiftDataValid( void* Handle, ULONGLONG lPos )
+{
+	TIMESHIFT_READER* reader = (TIMESHIFT_READER*)Handle;
+	if ( reader == NULL || reader->data == NULL )
+		return 0;
+	__atomic_thread_fence( __ATOMIC_ACQUIRE );
+	return lPos + reader->header->data_size >= __atomic_load_n( &reader->header->data_end, __ATOMIC_RELAXED );
+}
+
+int ReadTimeShiftData( void* Handle, ULONGLONG lPos, unsigned char* pBuf, int nBytes )
+{
+	const unsigned char* data;
+	int bytes = 0, n = 0;
+	while ( bytes < nBytes && ( n = PeekTimeShiftData( Handle, lPos + bytes, &data ) ) > 0 )
+	{
+		n = _MIN( n, nBytes - bytes );
+		memcpy( pBuf + bytes, data, n );
+		bytes += n;
+	}
+	if ( n < 0 && bytes == 0 )
+		return -1;
+	return TimeShiftDataValid( Handle, lPos ) ? bytes : -1;
+}
+
+#else
+void NotifyTimeShiftReaders( const char* pHeaderName ) { }
+void* OpenTimeShiftReader( const char* pFileName ) { return NULL; }
+void  CloseTimeShiftReader( void* Handle ) { }
+int   TimeShiftReaderEventFd( void* Handle ) { return -1; }
+void  TimeShiftReaderEvent( void* Handle ) { }
+ULONGLONG WaitTimeShiftData( void* Handle, ULONGLONG lPos, int nTimeout ) { return 0; }
+ULONGLONG TimeShiftReaderPos( void* Handle ) { return 0; }
+int   TimeShiftReaderClosed( void* Handle ) { return 1; }
+int   PeekTimeShiftData( void* Handle, ULONGLONG lPos, const unsigned char** ppData ) { return -1; }
+int   TimeShiftDataValid( void* Handle, ULONGLONG lPos ) { return 0; }
+int   ReadTimeShiftData( void* Handle, ULONGLONG lPos, unsigned char* pBuf, int nBytes ) { return -1; }
+#endif
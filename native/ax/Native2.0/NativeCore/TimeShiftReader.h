@@ -0,0 +1,51 @@
+/*
+ * Copyright 2015 The SageTV Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef TIMESHIFT_READER_H
+#define TIMESHIFT_READER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//live TV reader of a time-shift file being written (TimeShiftFile.h), attached to its shared memory header.
+//It's woken when the write position moves instead of polling the file size. The writer of this process
+//signals the reader's eventfd, a writer of another process the header's futex.
+void* OpenTimeShiftReader( const char* pFileName );		//NULL when no writer publishes the file
+void  CloseTimeShiftReader( void* Handle );
+//readable when the write position moved or the file is closed, read it empty with TimeShiftReaderEvent.
+//-1 when the writer is in another process, WaitTimeShiftData only.
+int   TimeShiftReaderEventFd( void* Handle );
+void  TimeShiftReaderEvent( void* Handle );
+//returns the write position once it's past lPos, the file is closed or nTimeout ms are over (-1 no timeout)
+ULONGLONG WaitTimeShiftData( void* Handle, ULONGLONG lPos, int nTimeout );
+ULONGLONG TimeShiftReaderPos( void* Handle );
+int   TimeShiftReaderClosed( void* Handle );
+//recent data of the shared window (TIMESHIFT_SHARED_DATA). Peek returns the contiguous bytes at lPos without
+//copy, 0 when there's none yet, -1 when lPos isn't in the window (read the file); the bytes may be overwritten
+//while they're used, TimeShiftDataValid tells if they are still good. Read copies and checks them.
+int   PeekTimeShiftData( void* Handle, ULONGLONG lPos, const unsigned char** ppData );
+int   TimeShiftDataValid( void* Handle, ULONGLONG lPos );
+int   ReadTimeShiftData( void* Handle, ULONGLONG lPos, unsigned char* pBuf, int nBytes );
+
+//writer side, signals the eventfds of readers of the header in this process
+void  NotifyTimeShiftReaders( const char* pHeaderName );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,4940 @@
+/*
+ * Copyright 2015 The SageTV Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//native core micro benchmark on recorded captures, usage: tsbench <test> <file> [options]
+
+#include "NativeCore.h"
+#include "TSFilter.h"
+#include "TSParser.h"
+#include "Demuxer.h"
+#include "Remuxer.h"
+#include "BlockBuffer.h"
+#include "StartCodeScan.h"
+#include "TSCRC32.h"
+#include "ATSCHuffman.h"
+#include "GetAVInf.h"
+#include "LiveDuration.h"
+#include "RecordWriter.h"
+#include "RecordIndex.h"
+#include "TimeShiftFile.h"
+#include "TimeShiftReader.h"
+#include "MuxSplitter.h"
+#include "ScanFilter.h"
+#include "ScanScheduler.h"
+#include "TSEPGParser.h"
+#include "spscring.h"
+#include "msgqueue.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/wait.h>
+#include <sys/uio.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <dirent.h>
+
+#define PUSH_BLOCK_SIZE  (188*348)
+
+typedef struct BENCH_DATA
+{
+	unsigned char* data;
+	unsigned long  bytes;
+	int  loops;
+	int  packet_length;
+} BENCH_DATA;
+
+static double now_sec( )
+{
+	struct timespec ts;
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return ts.tv_sec + ts.tv_nsec/1e9;
+}
+
+static ULONGLONG now_ns( )
+{
+	struct timespec ts;
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return (ULONGLONG)ts.tv_sec*1000000000 + ts.tv_nsec;
+}
+
+static int LoadFile( BENCH_DATA* pBench, char* pFileName, unsigned long lMaxBytes )
+{
+	FILE* fp;
+	long size;
+	if ( ( fp = fopen( pFileName, "rb" ) ) == NULL )
+	{
+		printf( "can't open file %s\n", pFileName );
+		return 0;
+	}
+	fseek( fp, 0, SEEK_END );
+	size = ftell( fp );
+	fseek( fp, 0, SEEK_SET );
+	if ( lMaxBytes && size > (long)lMaxBytes )
+		size = lMaxBytes;
+	pBench->data = malloc( size );
+	pBench->bytes = (unsigned long)fread( pBench->data, 1, size, fp );
+	fclose( fp );
+	pBench->packet_length = CheckM2TFormat( pBench->data, _MIN( pBench->bytes, 188*16 ) ) ? M2TS_PACKET_LENGTH : TS_PACKET_LENGTH;
+	return pBench->bytes > 0;
+}
+
+static int NullDumper( void* pContext, void* pData, int nSize )
+{
+	unsigned long *bytes = (unsigned long*)pContext;
+	*bytes += nSize;
+	return nSize;
+}
+
+static void PushAll( void* pRemuxer, BENCH_DATA* pBench )
+{
+	unsigned long offset = 0;
+	int expected_bytes;
+	while ( offset < pBench->bytes )
+	{
+		int bytes = (int)_MIN( PUSH_BLOCK_SIZE, pBench->bytes - offset );
+		int used = PushRemuxStreamData( pRemuxer, pBench->data+offset, bytes, &expected_bytes );
+		offset += used > 0 ? used : bytes;
+	}
+}
+
+//synthetic full mux: PAT, a PMT per program, MPEG2 video (PCR) and AC3 audio of each program, null packets
+typedef struct MUX_BUILDER
+{
+	unsigned char* data;
+	unsigned long  bytes;
+	unsigned long  size;
+	unsigned char  counter[0x2000];
+} MUX_BUILDER;
+
+static int SectionVer( unsigned char* pOut, int nTableId, int nExt, int nVersion, int nSection, int nLastSection,
+					   unsigned char* pBody, int nBytes )
+{
+	int len = 5+nBytes+4;
+	unsigned long crc;
+	pOut[0] = nTableId;
+	pOut[1] = 0xb0 | ((len>>8)&0x0f);
+	pOut[2] = len & 0xff;
+	pOut[3] = nExt>>8;
+	pOut[4] = nExt&0xff;
+	pOut[5] = 0xc1 | ((nVersion&0x1f)<<1);
+	pOut[6] = nSection;
+	pOut[7] = nLastSection;
+	memcpy( pOut+8, pBody, nBytes );
+	crc = CalTSCRC32( pOut, 8+nBytes );
+	pOut[8+nBytes]   = (unsigned char)(crc>>24);
+	pOut[8+nBytes+1] = (unsigned char)(crc>>16);
+	pOut[8+nBytes+2] = (unsigned char)(crc>>8);
+	pOut[8+nBytes+3] = (unsigned char)(crc);
+	return 8+nBytes+4;
+}
+
+static int Section( unsigned char* pOut, int nTableId, int nExt, unsigned char* pBody, int nBytes )
+{
+	return SectionVer( pOut, nTableId, nExt, 0, 0, 0, pBody, nBytes );
+}
+
+//packetize a payload, PCR goes into adaption field of the first packet when lPCR isn't zero
+static void Packetize( MUX_BUILDER* pMux, int nPid, unsigned char* pData, int nBytes, ULONGLONG lPCR )
+{
+	int first = 1;
+	while ( ( nBytes > 0 || first ) && pMux->bytes + TS_PACKET_LENGTH <= pMux->size )
+	{
+		unsigned char* p = pMux->data + pMux->bytes;
+		int af_len = 0, room, chunk;
+		p[0] = TS_SYNC;
+		p[1] = (first ? 0x40 : 0 ) | (nPid>>8);
+		p[2] = nPid & 0xff;
+		if ( first && lPCR )
+		{
+			ULONGLONG base = lPCR/300;
+			int ext = (int)(lPCR%300);
+			p[5] = 0x10;
+			p[6] = (unsigned char)(base>>25);
+			p[7] = (unsigned char)(base>>17);
+			p[8] = (unsigned char)(base>>9);
+			p[9] = (unsigned char)(base>>1);
+			p[10]= (unsigned char)(((base&1)<<7)|0x7e|(ext>>8));
+			p[11]= ext & 0xff;
+			af_len = 7;
+		}
+		room = 184 - (af_len ? af_len+1 : 0);
+		chunk = nBytes < room ? nBytes : room;
+		if ( chunk < room )
+		{
+			//stuffing in adaption field
+			int stuff = room - chunk;
+			if ( af_len == 0 )
+			{
+				stuff--; //length byte
+				if ( stuff > 0 )
+				{
+					p[5] = 0;
+					af_len = 1;
+					stuff--;
+				}
+			}
+			memset( p+5+af_len, 0xff, stuff );
+			af_len += stuff;
+		}
+		if ( af_len || chunk < room )
+			p[4] = af_len;
+		p[3] = ( ( af_len || chunk < room ) ? 0x30 : 0x10 ) | ( pMux->counter[nPid]++ & 0x0f );
+		memcpy( p+TS_PACKET_LENGTH-chunk, pData, chunk );
+		pData  += chunk;
+		nBytes -= chunk;
+		pMux->bytes += TS_PACKET_LENGTH;
+		first = 0;
+	}
+}
+
+static int PackPES( unsigned char* pOut, int nStreamId, unsigned char* pData, int nBytes, unsigned long lPTS )
+{
+	int len = 8+nBytes;
+	pOut[0] = 0; pOut[1] = 0; pOut[2] = 1; pOut[3] = nStreamId;
+	if ( nStreamId >= 0xe0 && len > 0xffff ) len = 0;
+	pOut[4] = len>>8;
+	pOut[5] = len&0xff;
+	pOut[6] = 0x80; pOut[7] = 0x80; pOut[8] = 5;
+	pOut[9] = 0x21 | ((lPTS>>29)&0x0e);
+	pOut[10]= (unsigned char)(lPTS>>22);
+	pOut[11]= 0x01 | ((lPTS>>14)&0xfe);
+	pOut[12]= (unsigned char)(lPTS>>7);
+	pOut[13]= 0x01 | ((lPTS<<1)&0xfe);
+	memcpy( pOut+14, pData, nBytes );
+	return 14+nBytes;
+}
+
+#define PROGRAM_PMT_PID( i )    (0x100+(i)*0x10)
+#define PROGRAM_VIDEO_PID( i )  (0x101+(i)*0x10)
+#define PROGRAM_AUDIO_PID( i )  (0x104+(i)*0x10)
+
+static void BuildMux( BENCH_DATA* pBench, int nPrograms, unsigned long lBytes )
+{
+	static unsigned char seq_hdr[]={ 0x00,0x00,0x01,0xb3, 0x2d,0x01,0xe0, 0x34, 0xff,0xff,0xe0,0x18,
+	                                 0x00,0x00,0x01,0xb5, 0x14,0x84,0x00,0x01,0x00,
+	                                 0x00,0x00,0x01,0xb8, 0x00,0x08,0x00 };
+	MUX_BUILDER *mux = calloc( 1, sizeof(MUX_BUILDER) );
+	unsigned char body[1024], pat[1024], *pmt, *es, *pes;
+	int pat_bytes, pmt_bytes[256], i, n, frame = 0;
+
+	mux->size = lBytes - lBytes%TS_PACKET_LENGTH;
+	mux->data = malloc( mux->size );
+	pmt = malloc( 256*64 );
+	es  = malloc( 8192 );
+	pes = malloc( 8192+16 );
+
+	pat[0] = 0; //pointer field
+	for ( i = 0; i<nPrograms; i++ )
+	{
+		body[i*4]   = (i+1)>>8;
+		body[i*4+1] = (i+1)&0xff;
+		body[i*4+2] = 0xe0 | (PROGRAM_PMT_PID(i)>>8);
+		body[i*4+3] = PROGRAM_PMT_PID(i)&0xff;
+	}
+	pat_bytes = 1+Section( pat+1, 0, 1, body, nPrograms*4 );
+	for ( i = 0; i<nPrograms; i++ )
+	{
+		unsigned char* p = body;
+		*p++ = 0xe0 | (PROGRAM_VIDEO_PID(i)>>8); *p++ = PROGRAM_VIDEO_PID(i)&0xff;
+		*p++ = 0xf0; *p++ = 0;
+		*p++ = 0x02;
+		*p++ = 0xe0 | (PROGRAM_VIDEO_PID(i)>>8); *p++ = PROGRAM_VIDEO_PID(i)&0xff;
+		*p++ = 0xf0; *p++ = 0;
+		*p++ = 0x81;
+		*p++ = 0xe0 | (PROGRAM_AUDIO_PID(i)>>8); *p++ = PROGRAM_AUDIO_PID(i)&0xff;
+		*p++ = 0xf0; *p++ = 6;
+		*p++ = ISO639_LANGUAGE_DESC; *p++ = 4; *p++ = 'e'; *p++ = 'n'; *p++ = 'g'; *p++ = 0;
+		pmt[i*64] = 0;
+		pmt_bytes[i] = 1+Section( pmt+i*64+1, 2, i+1, body, (int)(p-body) );
+	}
+
+	srand( 1 );
+	while ( mux->bytes + TS_PACKET_LENGTH <= mux->size )
+	{
+		unsigned long pts = frame*3003+90000;
+		if ( frame % 10 == 0 )
+		{
+			Packetize( mux, 0, pat, pat_bytes, 0 );
+			for ( i = 0; i<nPrograms; i++ )
+				Packetize( mux, PROGRAM_PMT_PID(i), pmt+i*64, pmt_bytes[i], 0 );
+		}
+		for ( i = 0; i<nPrograms; i++ )
+		{
+			int type = frame % 15 == 0 ? 1 : 2;
+			n = 0;
+			if ( type == 1 )
+			{
+				memcpy( es, seq_hdr, sizeof(seq_hdr) );
+				n = sizeof(seq_hdr);
+			}
+			es[n++] = 0; es[n++] = 0; es[n++] = 1; es[n++] = 0;
+			es[n++] = (frame>>2)&0xff; es[n++] = ((frame&3)<<6)|(type<<3); es[n++] = 0xff; es[n++] = 0xf8;
+			es[n++] = 0; es[n++] = 0; es[n++] = 1; es[n++] = 1;
+			while ( n < ( type == 1 ? 6000 : 1600 ) )
+				es[n++] = (unsigned char)( rand() | 0x01 );
+			Packetize( mux, PROGRAM_VIDEO_PID(i), pes, PackPES( pes, 0xe0, es, n, pts ), (ULONGLONG)pts*300 );
+			if ( frame % 2 == 0 )
+			{
+				memset( es, 0, 1536 );
+				es[0] = 0x0b; es[1] = 0x77; es[4] = 0x14; es[5] = 0x40;
+				Packetize( mux, PROGRAM_AUDIO_PID(i), pes, PackPES( pes, 0xbd, es, 1536, pts ), 0 );
+			}
+		}
+		for ( i = 0; i<5 && mux->bytes + TS_PACKET_LENGTH <= mux->size; i++ )
+		{
+			unsigned char* p = mux->data + mux->bytes;
+			p[0] = TS_SYNC; p[1] = 0x1f; p[2] = 0xff; p[3] = 0x10;
+			memset( p+4, 0xff, 184 );
+			mux->bytes += TS_PACKET_LENGTH;
+		}
+		frame++;
+	}
+
+	pBench->data = mux->data;
+	pBench->bytes = mux->bytes;
+	pBench->packet_length = TS_PACKET_LENGTH;
+	free( pmt );
+	free( es );
+	free( pes );
+	free( mux );
+}
+
+//TS->PS remux of a channel of the capture, returns packets per second
+static double RunParse( BENCH_DATA* pBench, int nChannel, unsigned long* pOutBytes )
+{
+	TUNE tune={0};
+	void* remuxer;
+	DEMUXER* demuxer;
+	double t0, t1;
+	int i;
+
+	tune.channel = nChannel;
+	remuxer = OpenRemuxStream( REMUX_STREAM, &tune, MPEG_TS, MPEG_PS, NULL, NULL, NullDumper, pOutBytes );
+	demuxer = GetDemuxer( remuxer );
+	if ( pBench->packet_length == M2TS_PACKET_LENGTH )
+		SetupTSStreamType( demuxer->ts_parser, MPEG_M2TS );
+
+	t0 = now_sec( );
+	for ( i = 0; i<pBench->loops; i++ )
+	{
+		PushAll( remuxer, pBench );
+		ResetRemuxStream( remuxer );
+	}
+	t1 = now_sec( );
+	CloseRemuxStream( remuxer );
+	return (double)pBench->bytes/pBench->packet_length*pBench->loops/(t1-t0);
+}
+
+static int BenchParse( BENCH_DATA* pBench )
+{
+	double pps;
+	unsigned long out_bytes = 0;
+
+	pps = RunParse( pBench, 1, &out_bytes );
+	printf( "%-8s %12.0f packets/sec  %7.1f MB/s\n", "remux", pps, pps*pBench->packet_length/1e6 );
+	pps = RunParse( pBench, 0xfffe, &out_bytes );
+	printf( "%-8s %12.0f packets/sec  %7.1f MB/s\n", "filter", pps, pps*pBench->packet_length/1e6 );
+	return 0;
+}
+
+//per packet cost against number of programs in a full mux. "filter" tunes to a channel not in the mux, every packet
+//goes through table, histogram, stream and PSI filters; "remux" remuxes the first program as a recording does.
+static int BenchPidTable( BENCH_DATA* pBench, unsigned long lBytes )
+{
+	int programs;
+	if ( lBytes == 0 )
+		lBytes = 32*1024*1024;
+	printf( "%lu MB mux, loops %d\n", lBytes>>20, pBench->loops );
+	printf( "programs  filter ns/packet  remux ns/packet\n" );
+	for ( programs = 1; programs <= 64; programs *= 2 )
+	{
+		unsigned long out_bytes = 0;
+		double filter_pps, remux_pps;
+		BuildMux( pBench, programs, lBytes );
+		filter_pps = RunParse( pBench, 0xfffe, &out_bytes );
+		remux_pps  = RunParse( pBench, 1, &out_bytes );
+		printf( "%8d  %16.1f  %15.1f\n", programs, 1e9/filter_pps, 1e9/remux_pps );
+		free( pBench->data );
+		pBench->data = NULL;
+	}
+	return 0;
+}
+
+//PSI sections of a pid reassembled from a capture, or synthetic EIT size sections
+typedef struct SECTION_SET
+{
+	unsigned char* data;
+	unsigned long  bytes;
+	unsigned long  size;
+	int* length;
+	int  num;
+	int  max_num;
+	unsigned char buf[4096+3];
+	int  have, need, active;
+} SECTION_SET;
+
+static void PushSection( SECTION_SET* pSet, unsigned char* pData, int nBytes )
+{
+	if ( pSet->num >= pSet->max_num || pSet->bytes + nBytes > pSet->size )
+		return;
+	memcpy( pSet->data + pSet->bytes, pData, nBytes );
+	pSet->bytes += nBytes;
+	pSet->length[pSet->num++] = nBytes;
+}
+
+static void FeedSection( SECTION_SET* pSet, const unsigned char* pData, int nBytes )
+{
+	while ( nBytes > 0 && pSet->active )
+	{
+		int n;
+		if ( pSet->have < 3 )
+		{
+			n = _MIN( 3-pSet->have, nBytes );
+			memcpy( pSet->buf+pSet->have, pData, n );
+			pSet->have += n; pData += n; nBytes -= n;
+			if ( pSet->have < 3 )
+				return;
+			if ( pSet->buf[0] == 0xff ) //stuffing
+			{
+				pSet->active = 0;
+				return;
+			}
+			pSet->need = 3 + ( ((pSet->buf[1]&0x0f)<<8) | pSet->buf[2] );
+		}
+		n = _MIN( pSet->need-pSet->have, nBytes );
+		memcpy( pSet->buf+pSet->have, pData, n );
+		pSet->have += n; pData += n; nBytes -= n;
+		if ( pSet->have == pSet->need )
+		{
+			PushSection( pSet, pSet->buf, pSet->need );
+			pSet->have = 0; //next section may follow in the packet
+		}
+	}
+}
+
+static void CollectSections( SECTION_SET* pSet, BENCH_DATA* pBench, int nPid )
+{
+	unsigned long offset;
+	int sync_offset = pBench->packet_length - TS_PACKET_LENGTH;
+	for ( offset = 0; offset + pBench->packet_length <= pBench->bytes; offset += pBench->packet_length )
+	{
+		unsigned char* p = pBench->data + offset + sync_offset;
+		int start, pos = 4, pointer;
+		if ( p[0] != TS_SYNC || ( ((p[1]&0x1f)<<8)|p[2] ) != nPid || !( p[3] & 0x10 ) )
+			continue;
+		if ( p[3] & 0x20 )
+			pos += 1 + p[4];
+		if ( pos >= TS_PACKET_LENGTH )
+			continue;
+		start = p[1] & 0x40;
+		if ( !start )
+		{
+			FeedSection( pSet, p+pos, TS_PACKET_LENGTH-pos );
+			continue;
+		}
+		pointer = p[pos++];
+		if ( pos + pointer > TS_PACKET_LENGTH )
+			continue;
+		FeedSection( pSet, p+pos, pointer );
+		pSet->active = 1;
+		pSet->have = 0;
+		FeedSection( pSet, p+pos+pointer, TS_PACKET_LENGTH-pos-pointer );
+	}
+}
+
+static void SyntheticSections( SECTION_SET* pSet, int nNum )
+{
+	unsigned char body[4096];
+	int i, j;
+	srand( 3 );
+	for ( i = 0; i<nNum; i++ )
+	{
+		unsigned char section[4096+16];
+		int bytes = 100 + rand()%3900, len;
+		for ( j = 0; j<bytes; j++ )
+			body[j] = (unsigned char)rand();
+		len = Section( section, 0x50, i & 0xffff, body, bytes );
+		PushSection( pSet, section, len );
+	}
+}
+
+//check all crc engines against byte table, then sections/sec of each engine
+static int BenchCRC32( BENCH_DATA* pBench, int bHasFile )
+{
+	SECTION_SET set={0};
+	unsigned char* buf;
+	int engine, i, bad = 0, invalid = 0;
+	int default_engine = TSCRC32Engine( );
+
+	set.size = 64*1024*1024;
+	set.max_num = 200000;
+	set.data = malloc( set.size );
+	set.length = malloc( set.max_num*sizeof(int) );
+	if ( bHasFile )
+		CollectSections( &set, pBench, 0x12 );
+	if ( set.num == 0 )
+	{
+		printf( "no EIT section (pid 0x12) found, use synthetic sections\n" );
+		SyntheticSections( &set, 20000 );
+	}
+	printf( "%d sections, %lu bytes, average %lu bytes\n", set.num, set.bytes, set.bytes/set.num );
+
+	//verify on random buffer, lengths and alignment
+	buf = malloc( 65536+64 );
+	srand( 7 );
+	for ( i = 0; i<65536+64; i++ )
+		buf[i] = (unsigned char)rand();
+	for ( i = 0; i<20000; i++ )
+	{
+		int len = i < 4096 ? i : rand()%65536, offset = rand()%64;
+		unsigned long crc;
+		SetupTSCRC32Engine( TS_CRC32_TABLE );
+		crc = CalTSCRC32( buf+offset, len );
+		for ( engine = TS_CRC32_SLICE8; engine <= TS_CRC32_PCLMUL; engine++ )
+		{
+			SetupTSCRC32Engine( engine );
+			if ( TSCRC32Engine() == engine && CalTSCRC32( buf+offset, len ) != crc )
+			{
+				if ( bad++ < 8 )
+					printf( "MISMATCH %s len:%d offset:%d\n", TSCRC32EngineName( engine ), len, offset );
+			}
+		}
+	}
+	free( buf );
+
+	for ( engine = TS_CRC32_TABLE; engine <= TS_CRC32_PCLMUL; engine++ )
+	{
+		unsigned long offset;
+		double t0, t1;
+		int loop;
+		SetupTSCRC32Engine( engine );
+		if ( TSCRC32Engine() != engine )
+			continue;
+		invalid = 0;
+		t0 = now_sec( );
+		for ( loop = 0; loop<pBench->loops; loop++ )
+			for ( offset = 0, i = 0; i<set.num; offset += set.length[i++] )
+				invalid += CalTSCRC32( set.data+offset, set.length[i] ) != 0;
+		t1 = now_sec( );
+		printf( "%-12s %10.0f sections/sec %8.1f MB/s  bad crc sections:%d\n", TSCRC32EngineName( engine ),
+			     set.num*pBench->loops/(t1-t0), set.bytes*pBench->loops/(t1-t0)/1e6, invalid/pBench->loops );
+	}
+	SetupTSCRC32Engine( default_engine );
+	printf( "verify %s\n", bad ? "FAILED" : "passed" );
+
+	free( set.data );
+	free( set.length );
+	return bad ? 1 : 0;
+}
+
+//program search of getMediaAVInf0: GetAVFormat() per channel till a valid one, against the probe handle. Then every
+//program by GetAVFormat() against ProbeAVFormat() of all programs in one pass, results have to be identical.
+static int ProgramValid( char* pFormat )
+{
+	return !( pFormat[0] == 0x0 || strstr( pFormat, "ENCRYPTED;" ) || strstr( pFormat, "NO-DATA;" ) ||
+		      strstr( pFormat, "UNKNOWN-TS;" ) || strstr( pFormat, "UNKNOWN-PS;" ) || strstr( pFormat, "NO-AV-TS;" ) );
+}
+
+static int BenchProbe( BENCH_DATA* pBench, char* pFileName, unsigned long lSearchBytes )
+{
+	char format[2048], duration[32], probe_format[2048], probe_duration[32];
+	int channel, total = 0, probe_total = 0, ret = 0, probe_ret = 0, calls = 0, i, mismatch = 0;
+	int status[4]={0};
+	double t0, t1, loop_time = 0, probe_time = 0, all_time = 0;
+	AV_PROBE_INF* probe_inf;
+	void* probe;
+
+	if ( lSearchBytes == 0 )
+		lSearchBytes = 8*1024*1024;
+	for ( i = 0; i<pBench->loops; i++ )
+	{
+		t0 = now_sec( );
+		channel = 0;
+		calls = 0;
+		do {
+			ret = GetAVFormat( pFileName, lSearchBytes, 0, channel+1, format, sizeof(format), duration, sizeof(duration), &total );
+			calls++;
+			if ( ProgramValid( format ) )
+				break;
+			channel++;
+		} while ( channel < total );
+		t1 = now_sec( );
+		loop_time += t1-t0;
+
+		t0 = now_sec( );
+		probe = OpenAVProbe( pFileName, lSearchBytes, 0 );
+		channel = 0;
+		do {
+			probe_ret = GetProbeAVFormat( probe, channel, probe_format, sizeof(probe_format), probe_duration, sizeof(probe_duration), &probe_total );
+			if ( ProgramValid( probe_format ) )
+				break;
+			channel++;
+		} while ( channel < probe_total );
+		CloseAVProbe( probe );
+		t1 = now_sec( );
+		probe_time += t1-t0;
+	}
+	printf( "search %lu bytes, %d programs, loops %d\n", lSearchBytes, total, pBench->loops );
+	printf( "per-channel loop  %9.2f ms  (%d GetAVFormat calls) channel:%d duration:%s\n", loop_time*1e3/pBench->loops, calls, ret, duration );
+	printf( "one pass probe    %9.2f ms  x%.2f channel:%d duration:%s %s\n", probe_time*1e3/pBench->loops, loop_time/probe_time,
+			 probe_ret, probe_duration, ret == probe_ret && !strcmp( format, probe_format ) && !strcmp( duration, probe_duration ) ? "" : "RESULT MISMATCH" );
+
+	//every program against GetAVFormat, as when no program is valid
+	t0 = now_sec( );
+	probe_inf = ProbeAVFormat( pFileName, lSearchBytes, 0 );
+	probe_time = now_sec( )-t0;
+	for ( i = 0; i<total; i++ )
+	{
+		AV_PROGRAM_INF *program = i < probe_inf->program_num ? &probe_inf->program[i] : NULL;
+		t0 = now_sec( );
+		ret = GetAVFormat( pFileName, lSearchBytes, 0, i+1, format, sizeof(format), duration, sizeof(duration), &channel );
+		all_time += now_sec( )-t0;
+		if ( program == NULL || ret != program->channel || strcmp( format, program->format ) || strcmp( duration, program->duration ) )
+		{
+			printf( "channel %d mismatch\n  loop:  %d %s %s\n", i+1, ret, duration, format );
+			if ( program != NULL )
+				printf( "  probe: %d %s %s\n", program->channel, program->duration, program->format );
+			mismatch++;
+		} else
+			status[program->status]++;
+	}
+	ReleaseAVProbeInf( probe_inf );
+	printf( "all %d programs   loop %9.2f ms  probe %9.2f ms  x%.2f, valid:%d encrypted:%d no-data:%d unknown:%d, %d mismatched\n",
+			 total, all_time*1e3, probe_time*1e3, all_time/probe_time, status[AVINF_VALID], status[AVINF_ENCRYPTED],
+			 status[AVINF_NO_DATA], status[AVINF_UNKNOWN], mismatch );
+	return mismatch ? 1 : 0;
+}
+
+//recording write path of N concurrent tuners: each tuner thread writes its own file in remuxer output
+//blocks and flushes once per capture read, as eatEncoderData0 does. stdio fwrite/fflush per block is the
+//reference, the file checksum of every writer engine has to match it.
+#define WRITER_READ_SIZE   (188*348)
+#define WRITER_BLOCK_SIZE  (188*24)
+
+typedef struct WRITER_TUNER
+{
+	char  file_name[512];
+	unsigned char* data;
+	unsigned long  data_bytes;
+	ULONGLONG bytes;
+	ULONGLONG circ_size;
+	unsigned long sync_bytes;
+	int   flag;		//-1 stdio, writer flag otherwise (TimeShiftFile flag in timeshift bench)
+	int   engine;
+	unsigned long checksum;
+	ULONGLONG published;	//write position of the TimeShiftFile header at the end
+	char* writer_name;		//of the TimeShiftFile
+} WRITER_TUNER;
+
+static void* WriterTuner( void* pContext )
+{
+	WRITER_TUNER* tuner = (WRITER_TUNER*)pContext;
+	FILE* fp = fopen( tuner->file_name, "wb" );
+	ULONGLONG written = 0, circ_pos = 0;
+	unsigned long offset = 0;
+	void* writer = NULL;
+	if ( fp == NULL )
+		return NULL;
+	if ( tuner->flag >= 0 )
+	{
+		writer = OpenRecordWriter( fileno( fp ), tuner->circ_size, 0, 0, tuner->flag );
+		SetupRecordWriterSync( writer, tuner->sync_bytes, 0 );
+		tuner->engine = RecordWriterEngine( writer );
+	}
+	while ( written < tuner->bytes )
+	{
+		int read_bytes = (int)_MIN( WRITER_READ_SIZE, tuner->bytes - written ), i;
+		for ( i = 0; i<read_bytes; i += WRITER_BLOCK_SIZE )
+		{
+			int bytes = _MIN( WRITER_BLOCK_SIZE, read_bytes-i );
+			unsigned char* data;
+			if ( offset + bytes > tuner->data_bytes )
+				offset = 0;
+			data = tuner->data + offset;
+			offset += bytes;
+			if ( writer != NULL )
+				PushRecordData( writer, data, bytes );
+			else
+			if ( tuner->circ_size )
+			{
+				//OutputDump circular file
+				int size = (int)_MIN( (ULONGLONG)bytes, tuner->circ_size - circ_pos );
+				fwrite( data, 1, size, fp );
+				fflush( fp );
+				circ_pos += size;
+				if ( circ_pos == tuner->circ_size )
+				{
+					fseek( fp, 0, SEEK_SET );
+					circ_pos = 0;
+					if ( size < bytes )
+					{
+						fwrite( data+size, 1, bytes-size, fp );
+						fflush( fp );
+						circ_pos = bytes-size;
+					}
+				}
+			} else
+			{
+				fwrite( data, 1, bytes, fp );
+				fflush( fp );
+			}
+		}
+		if ( writer != NULL )
+			FlushRecordWriter( writer );
+		else
+			fflush( fp );
+		written += read_bytes;
+	}
+	if ( writer != NULL )
+		CloseRecordWriter( writer );
+	fclose( fp );
+	return NULL;
+}
+
+static unsigned long FileChecksum( char* pFileName )
+{
+	unsigned char buf[64*1024];
+	unsigned long sum = 0, pos = 0;
+	size_t i, bytes;
+	FILE* fp = fopen( pFileName, "rb" );
+	if ( fp == NULL )
+		return 0;
+	while ( ( bytes = fread( buf, 1, sizeof(buf), fp ) ) > 0 )
+		for ( i = 0; i<bytes; i++ )
+			sum = sum*31 + buf[i] + (pos++ & 0xff);
+	fclose( fp );
+	return sum;
+}
+
+static double RunWriter( WRITER_TUNER* pTuner, int nTuners, void* (*pTunerThread)( void* ) )
+{
+	pthread_t thread[64];
+	double t0 = now_sec( ), t1;
+	int i;
+	for ( i = 0; i<nTuners; i++ )
+		pthread_create( &thread[i], NULL, pTunerThread, &pTuner[i] );
+	for ( i = 0; i<nTuners; i++ )
+		pthread_join( thread[i], NULL );
+	t1 = now_sec( );
+	for ( i = 0; i<nTuners; i++ )
+	{
+		pTuner[i].checksum = FileChecksum( pTuner[i].file_name );
+		unlink( pTuner[i].file_name );
+	}
+	return t1-t0;
+}
+
+static int BenchWriter( char* pDir, int nTuners, unsigned long lBytes, unsigned long lCircSize, unsigned long lSyncBytes )
+{
+	static const int flags[] = { -1, RECORD_WRITER_PWRITEV, RECORD_WRITER_URING,
+		                         RECORD_WRITER_PWRITEV|RECORD_WRITER_DIRECT, RECORD_WRITER_URING|RECORD_WRITER_DIRECT };
+	WRITER_TUNER tuner[64];
+	unsigned long reference[64];
+	int i, k, mismatch = 0;
+
+	if ( nTuners <= 0 ) nTuners = 4;
+	if ( nTuners > 64 ) nTuners = 64;
+	if ( lBytes == 0 ) lBytes = 64*1024*1024;
+	memset( tuner, 0, sizeof(tuner) );
+	for ( i = 0; i<nTuners; i++ )
+	{
+		unsigned long j, seed = i+1;
+		tuner[i].data_bytes = 4*1024*1024;
+		tuner[i].data = malloc( tuner[i].data_bytes );
+		for ( j = 0; j<tuner[i].data_bytes; j++ )
+		{
+			seed = seed*1103515245 + 12345;
+			tuner[i].data[j] = ( j % 188 ) ? (unsigned char)( seed >> 16 ) : 0x47;
+		}
+		snprintf( tuner[i].file_name, sizeof(tuner[i].file_name), "%s/tsbench-writer-%d.ts", pDir, i );
+		tuner[i].bytes = lBytes;
+		tuner[i].circ_size = lCircSize;
+		tuner[i].sync_bytes = lSyncBytes;
+	}
+	printf( "%d tuners, %lu MB each, %s file %lu MB, sync every %lu MB\n", nTuners, lBytes>>20, lCircSize ? "circular" : "linear",
+		    lCircSize>>20, lSyncBytes>>20 );
+	for ( k = 0; k<(int)(sizeof(flags)/sizeof(flags[0])); k++ )
+	{
+		double t;
+		int bad = 0;
+		for ( i = 0; i<nTuners; i++ )
+			tuner[i].flag = flags[k];
+		t = RunWriter( tuner, nTuners, WriterTuner );
+		for ( i = 0; i<nTuners; i++ )
+		{
+			if ( k == 0 )
+				reference[i] = tuner[i].checksum;
+			else
+			if ( reference[i] != tuner[i].checksum )
+				bad++;
+		}
+		mismatch += bad;
+		printf( "%-8s %-7s %9.1f MB/s  %8.2f s  %s\n", flags[k] < 0 ? "stdio" : RecordWriterEngineName( tuner[0].engine ),
+			    flags[k] >= 0 && ( flags[k] & RECORD_WRITER_DIRECT ) ? "direct" : "", (double)lBytes*nTuners/t/(1024*1024), t,
+			    bad ? "DATA MISMATCH" : "" );
+	}
+	for ( i = 0; i<nTuners; i++ )
+		free( tuner[i].data );
+	return mismatch ? 1 : 0;
+}
+
+//time-shift ring files of N concurrent tuners on one disk: the old OutputDump path (fwrite/fflush, fseek at
+//the wrap) against TimeShiftFile by pwrite and by RecordWriter engines, preallocated ring and shared memory
+//write position. Checksums have to match the stdio file, the published write position the bytes written.
+//Then the cost of a reader polling the write position, header load against stat() of the file size.
+static void* TimeShiftTuner( void* pContext )
+{
+	WRITER_TUNER* tuner = (WRITER_TUNER*)pContext;
+	void* ts = OpenTimeShiftFile( tuner->file_name, tuner->circ_size, tuner->flag | TIMESHIFT_PUBLISH );
+	const TIMESHIFT_HEADER* header;
+	ULONGLONG written = 0;
+	unsigned long offset = 0;
+	if ( ts == NULL )
+		return NULL;
+	SetupTimeShiftSync( ts, tuner->sync_bytes );
+	tuner->writer_name = TimeShiftWriterName( ts );
+	header = OpenTimeShiftHeader( tuner->file_name );
+	while ( written < tuner->bytes )
+	{
+		int read_bytes = (int)_MIN( WRITER_READ_SIZE, tuner->bytes - written ), i;
+		for ( i = 0; i<read_bytes; i += WRITER_BLOCK_SIZE )
+		{
+			int bytes = _MIN( WRITER_BLOCK_SIZE, read_bytes-i );
+			if ( offset + bytes > tuner->data_bytes )
+				offset = 0;
+			WriteTimeShiftData( ts, tuner->data + offset, bytes );
+			offset += bytes;
+		}
+		FlushTimeShiftFile( ts );
+		written += read_bytes;
+	}
+	tuner->published = header != NULL ? TimeShiftWritePos( header ) : 0;
+	CloseTimeShiftHeader( header );
+	CloseTimeShiftFile( ts );
+	return NULL;
+}
+
+static volatile ULONGLONG poll_sum;
+
+static double PollRate( const char* pFileName, const TIMESHIFT_HEADER* pHeader, int nPolls )
+{
+	double t0 = now_sec( );
+	ULONGLONG sum = 0;
+	int i;
+	for ( i = 0; i<nPolls; i++ )
+	{
+		if ( pHeader != NULL )
+			sum += TimeShiftWritePos( pHeader );
+		else
+		{
+			struct stat st;
+			if ( stat( pFileName, &st ) == 0 )
+				sum += st.st_size;
+		}
+	}
+	poll_sum = sum;
+	return ( now_sec( ) - t0 ) * 1e9 / nPolls;
+}
+
+static int BenchTimeShift( char* pDir, int nTuners, unsigned long lBytes, unsigned long lCircSize, unsigned long lSyncBytes )
+{
+	static const int flags[] = { -1, 0, RECORD_WRITER_PWRITEV+1, RECORD_WRITER_URING+1 };
+	WRITER_TUNER tuner[64];
+	unsigned long reference[64];
+	char file_name[512];
+	const TIMESHIFT_HEADER* header;
+	void* ts;
+	int i, k, mismatch = 0;
+
+	if ( nTuners <= 0 ) nTuners = 16;
+	if ( nTuners > 64 ) nTuners = 64;
+	if ( lBytes == 0 ) lBytes = 64*1024*1024;
+	if ( lCircSize == 0 ) lCircSize = 16*1024*1024;
+	memset( tuner, 0, sizeof(tuner) );
+	for ( i = 0; i<nTuners; i++ )
+	{
+		unsigned long j, seed = i+1;
+		tuner[i].data_bytes = 4*1024*1024;
+		tuner[i].data = malloc( tuner[i].data_bytes );
+		for ( j = 0; j<tuner[i].data_bytes; j++ )
+		{
+			seed = seed*1103515245 + 12345;
+			tuner[i].data[j] = ( j % 188 ) ? (unsigned char)( seed >> 16 ) : 0x47;
+		}
+		snprintf( tuner[i].file_name, sizeof(tuner[i].file_name), "%s/tsbench-timeshift-%d.ts", pDir, i );
+		tuner[i].bytes = lBytes;
+		tuner[i].circ_size = lCircSize;
+		tuner[i].sync_bytes = lSyncBytes;
+	}
+	printf( "%d tuners, %lu MB each into %lu MB ring files, sync every %lu MB\n", nTuners, lBytes>>20, lCircSize>>20, lSyncBytes>>20 );
+	printf( "%-16s %9s %8s  %s\n", "writer", "MB/s", "s", "" );
+	for ( k = 0; k<(int)(sizeof(flags)/sizeof(flags[0])); k++ )
+	{
+		char name[64];
+		double t;
+		int bad = 0, lost = 0;
+		for ( i = 0; i<nTuners; i++ )
+		{
+			tuner[i].flag = flags[k];
+			tuner[i].published = 0;
+		}
+		t = RunWriter( tuner, nTuners, flags[k] < 0 ? WriterTuner : TimeShiftTuner );
+		for ( i = 0; i<nTuners; i++ )
+		{
+			if ( k == 0 )
+				reference[i] = tuner[i].checksum;
+			else
+			{
+				bad += reference[i] != tuner[i].checksum;
+				lost += tuner[i].published != tuner[i].bytes;
+			}
+		}
+		mismatch += bad + lost;
+		if ( flags[k] < 0 )
+			snprintf( name, sizeof(name), "stdio fseek" );
+		else
+			snprintf( name, sizeof(name), "timeshift %s", tuner[0].writer_name ? tuner[0].writer_name : "-" );
+		printf( "%-16s %9.1f %8.2f  %s%s\n", name, (double)lBytes*nTuners/t/(1024*1024), t,
+			    bad ? "DATA MISMATCH " : "", lost ? "WRITE POSITION MISMATCH" : "" );
+	}
+
+	//a reader of live TV polls the write position
+	snprintf( file_name, sizeof(file_name), "%s/tsbench-timeshift-poll.ts", pDir );
+	if ( ( ts = OpenTimeShiftFile( file_name, lCircSize, TIMESHIFT_PUBLISH ) ) != NULL )
+	{
+		WriteTimeShiftData( ts, tuner[0].data, 188*1024 );
+		header = OpenTimeShiftHeader( file_name );
+		printf( "poll write position: header %.1f ns, stat %.1f ns\n", PollRate( file_name, header, 10000000 ),
+			    PollRate( file_name, NULL, 1000000 ) );
+		if ( header == NULL || TimeShiftWritePos( header ) != 188*1024 )
+		{
+			printf( "header of %s isn't published\n", file_name );
+			mismatch++;
+		}
+		CloseTimeShiftHeader( header );
+		CloseTimeShiftFile( ts );
+		unlink( file_name );
+	}
+	for ( i = 0; i<nTuners; i++ )
+		free( tuner[i].data );
+	return mismatch ? 1 : 0;
+}
+
+//capture ring of the DVB/IVTV capture threads, lock free spscRing against the mutex guarded copy it replaces.
+//The producer feeds chunks of random size, an {index, length} header and a pattern payload, the consumer
+//checks every byte and the chunk order. flood runs both sides flat out on a big and on a small odd sized ring,
+//paced sends a chunk every RING_PACE_NS and takes producer commit to consumer check latency. discard is paced
+//and stalls the consumer to drive push into discard mode, the gaps in chunk order have to match the drop counters.
+#define RING_MAX_CHUNK    (64*1024)
+#define RING_READ_SIZE    (188*348)		//consumer takes BUFFERSIZE at most, as eatEncoderData0
+#define RING_SMALL_SIZE   (RING_MAX_CHUNK+8+1021)
+#define RING_PACE_NS      100000
+#define RING_PACE_CHUNKS  10000
+#define RING_HIST_NUM     24			//bucket 0 <1us, bucket i [2^(i-1), 2^i) us
+
+enum { RING_MUTEX, RING_COPY, RING_SPAN, RING_DISCARD };
+
+typedef struct RING_BENCH
+{
+	spscRing ring;
+	pthread_mutex_t mutex;
+	int   mode;
+	int   paced;
+	unsigned int   chunks;
+	unsigned int*  chunk_len;	//payload bytes
+	unsigned char* pattern;
+	ULONGLONG*     commit_ns;
+	ULONGLONG*     latency;
+	volatile unsigned int done;
+
+	//consumer
+	unsigned char  hdr[8];
+	int   hdr_bytes;
+	unsigned int   index, len, off, next;
+	unsigned int   lost_chunks;
+	ULONGLONG      lost_bytes;
+	ULONGLONG      bytes;
+	unsigned int   errors;
+} RING_BENCH;
+
+static unsigned char* RingPattern( RING_BENCH* b, unsigned int nIndex )
+{
+	return b->pattern + ( ( nIndex*2654435761U ) >> 16 );
+}
+
+static void RingCheck( RING_BENCH* b, const unsigned char* p, int n )
+{
+	ULONGLONG t = b->paced ? now_ns( ) : 0;
+	int k;
+	b->bytes += n;
+	while ( n > 0 && !b->errors )
+	{
+		if ( b->hdr_bytes < 8 )
+		{
+			k = _MIN( 8-b->hdr_bytes, n );
+			memcpy( b->hdr+b->hdr_bytes, p, k );
+			b->hdr_bytes += k; p += k; n -= k;
+			if ( b->hdr_bytes < 8 )
+				break;
+			memcpy( &b->index, b->hdr, 4 );
+			memcpy( &b->len, b->hdr+4, 4 );
+			b->off = 0;
+			if ( b->index >= b->chunks || b->index < b->next || b->len != b->chunk_len[b->index] )
+			{
+				b->errors++;	//lost sync, nothing after it can be checked
+				break;
+			}
+			while ( b->next < b->index )
+			{
+				b->lost_chunks++;
+				b->lost_bytes += b->chunk_len[b->next++]+8;
+			}
+			b->next = b->index+1;
+		}
+		k = _MIN( (int)( b->len - b->off ), n );
+		if ( memcmp( p, RingPattern( b, b->index ) + b->off, k ) )
+			b->errors++;
+		b->off += k; p += k; n -= k;
+		if ( b->off == b->len )
+		{
+			b->hdr_bytes = 0;
+			if ( b->paced )
+				b->latency[b->index] = t - b->commit_ns[b->index];
+		}
+	}
+}
+
+static void* RingProducer( void* pContext )
+{
+	RING_BENCH* b = (RING_BENCH*)pContext;
+	unsigned char* chunk = malloc( RING_MAX_CHUNK+8 );
+	ULONGLONG next_ns = now_ns( );
+	unsigned int i;
+	for ( i = 0; i<b->chunks; i++ )
+	{
+		int bytes = b->chunk_len[i]+8, pos = 0, span, ok;
+		unsigned char* ptr;
+		if ( b->paced )
+		{
+			while ( now_ns( ) < next_ns )
+				sched_yield( );
+			next_ns += RING_PACE_NS;
+		}
+		memcpy( chunk, &i, 4 );
+		memcpy( chunk+4, &b->chunk_len[i], 4 );
+		memcpy( chunk+8, RingPattern( b, i ), b->chunk_len[i] );
+		switch ( b->mode ) {
+		case RING_MUTEX:
+			do {
+				pthread_mutex_lock( &b->mutex );
+				if ( ( ok = freespaceSPSCRing( &b->ring ) >= bytes ) )
+				{
+					b->commit_ns[i] = now_ns( );
+					addSPSCRing( &b->ring, chunk, bytes );
+				}
+				pthread_mutex_unlock( &b->mutex );
+				if ( !ok )
+					sched_yield( );
+			} while ( !ok );
+			break;
+		case RING_COPY:
+			b->commit_ns[i] = now_ns( );
+			while ( !addSPSCRing( &b->ring, chunk, bytes ) )
+			{
+				sched_yield( );
+				b->commit_ns[i] = now_ns( );
+			}
+			break;
+		case RING_SPAN:
+			//as the capture thread reading into the ring
+			while ( pos < bytes )
+			{
+				if ( ( span = writeSpanSPSCRing( &b->ring, &ptr ) ) == 0 )
+				{
+					sched_yield( );
+					continue;
+				}
+				span = _MIN( span, bytes-pos );
+				memcpy( ptr, chunk+pos, span );
+				pos += span;
+				if ( pos == bytes )
+					b->commit_ns[i] = now_ns( );
+				commitWriteSPSCRing( &b->ring, span );
+			}
+			break;
+		case RING_DISCARD:
+			b->commit_ns[i] = now_ns( );
+			pushSPSCRing( &b->ring, chunk, bytes );
+			break;
+		}
+	}
+	SPSC_STORE( &b->done, 1 );
+	free( chunk );
+	return NULL;
+}
+
+static void* RingConsumer( void* pContext )
+{
+	RING_BENCH* b = (RING_BENCH*)pContext;
+	unsigned char* buf = malloc( RING_READ_SIZE );
+	ULONGLONG stall = 8*1024*1024;
+	while ( 1 )
+	{
+		int done = SPSC_LOAD( &b->done ), n;
+		unsigned char* ptr;
+		switch ( b->mode ) {
+		case RING_MUTEX:
+			pthread_mutex_lock( &b->mutex );
+			n = _MIN( usedspaceSPSCRing( &b->ring ), RING_READ_SIZE );
+			getSPSCRing( &b->ring, buf, n );
+			pthread_mutex_unlock( &b->mutex );
+			RingCheck( b, buf, n );
+			break;
+		case RING_SPAN:
+			n = _MIN( readSpanSPSCRing( &b->ring, &ptr ), RING_READ_SIZE );
+			RingCheck( b, ptr, n );
+			commitReadSPSCRing( &b->ring, n );
+			break;
+		default:
+			n = _MIN( usedspaceSPSCRing( &b->ring ), RING_READ_SIZE );
+			getSPSCRing( &b->ring, buf, n );
+			RingCheck( b, buf, n );
+			break;
+		}
+		if ( n == 0 )
+		{
+			if ( done )
+				break;
+			sched_yield( );
+		}
+		if ( b->mode == RING_DISCARD && b->bytes >= stall )
+		{
+			usleep( 20000 );
+			stall += 8*1024*1024;
+		}
+	}
+	free( buf );
+	return NULL;
+}
+
+static int CompareLatency( const void* a, const void* b )
+{
+	ULONGLONG x = *(const ULONGLONG*)a, y = *(const ULONGLONG*)b;
+	return x < y ? -1 : x > y;
+}
+
+static double RunRing( RING_BENCH* b, int nMode, int nRingSize, int bPaced )
+{
+	pthread_t producer, consumer;
+	double t0, t1;
+	if ( createSPSCRing( &b->ring, nRingSize ) == 0 )
+		return 0;
+	b->mode = nMode;
+	b->paced = bPaced;
+	b->done = 0;
+	b->hdr_bytes = 0;
+	b->next = b->lost_chunks = b->errors = 0;
+	b->lost_bytes = b->bytes = 0;
+	t0 = now_sec( );
+	pthread_create( &consumer, NULL, RingConsumer, b );
+	pthread_create( &producer, NULL, RingProducer, b );
+	pthread_join( producer, NULL );
+	pthread_join( consumer, NULL );
+	t1 = now_sec( );
+	//chunks dropped after the last one consumed
+	while ( nMode == RING_DISCARD && b->next < b->chunks )
+	{
+		b->lost_chunks++;
+		b->lost_bytes += b->chunk_len[b->next++]+8;
+	}
+	if ( b->next != b->chunks || b->hdr_bytes )
+		b->errors++;
+	return t1-t0;
+}
+
+static int BenchRing( unsigned long lBytes, unsigned long lRingSize )
+{
+	static const char* mode_name[] = { "mutex", "copy", "span" };
+	unsigned long hist[3][RING_HIST_NUM];
+	ULONGLONG total = 0;
+	RING_BENCH b;
+	unsigned int i, seed = 1, max_chunks;
+	int mode, k, errors = 0;
+
+	if ( lBytes == 0 ) lBytes = 512*1024*1024;
+	if ( lRingSize == 0 ) lRingSize = 4*1024*1024;
+	memset( &b, 0, sizeof(b) );
+	memset( hist, 0, sizeof(hist) );
+	pthread_mutex_init( &b.mutex, NULL );
+	max_chunks = lBytes/(RING_MAX_CHUNK/4) + RING_PACE_CHUNKS;
+	b.chunk_len = malloc( max_chunks*sizeof(unsigned int) );
+	b.commit_ns = malloc( max_chunks*sizeof(ULONGLONG) );
+	b.latency = malloc( max_chunks*sizeof(ULONGLONG) );
+	b.pattern = malloc( 0x10000 + RING_MAX_CHUNK );
+	for ( i = 0; i<0x10000 + RING_MAX_CHUNK; i++ )
+	{
+		seed = seed*1103515245 + 12345;
+		b.pattern[i] = (unsigned char)( seed >> 16 );
+	}
+	for ( i = 0; i<max_chunks && total < lBytes; i++ )
+	{
+		seed = seed*1103515245 + 12345;
+		b.chunk_len[i] = 180 + ( seed >> 8 ) % ( RING_MAX_CHUNK-180 );
+		total += b.chunk_len[i]+8;
+	}
+	b.chunks = i;
+
+	printf( "ring %lu KB, small ring %d bytes, %lu MB in %u chunks of 188..64K, consumer reads %d\n", lRingSize>>10,
+		    RING_SMALL_SIZE, lBytes>>20, b.chunks, RING_READ_SIZE );
+	printf( "%-6s %10s %10s %9s %9s %9s %9s\n", "mode", "flood MB/s", "small MB/s", "p50 us", "p99 us", "p99.9 us", "max us" );
+	for ( mode = RING_MUTEX; mode <= RING_SPAN; mode++ )
+	{
+		unsigned int chunks = b.chunks;
+		double t, t_small;
+		t = RunRing( &b, mode, lRingSize, 0 );
+		errors += b.errors;
+		freeSPSCRing( &b.ring );
+		t_small = RunRing( &b, mode, RING_SMALL_SIZE, 0 );
+		errors += b.errors;
+		freeSPSCRing( &b.ring );
+
+		b.chunks = RING_PACE_CHUNKS;
+		RunRing( &b, mode, lRingSize, 1 );
+		errors += b.errors;
+		freeSPSCRing( &b.ring );
+		qsort( b.latency, b.chunks, sizeof(ULONGLONG), CompareLatency );
+		for ( i = 0; i<b.chunks; i++ )
+		{
+			ULONGLONG us = b.latency[i]/1000;
+			for ( k = 0; us && k<RING_HIST_NUM-1; k++ )
+				us >>= 1;
+			hist[mode][k]++;
+		}
+		printf( "%-6s %10.1f %10.1f %9.1f %9.1f %9.1f %9.1f %s\n", mode_name[mode], total/t/(1024*1024),
+			    total/t_small/(1024*1024), b.latency[b.chunks/2]/1e3, b.latency[b.chunks*99/100]/1e3,
+			    b.latency[b.chunks*999/1000]/1e3, b.latency[b.chunks-1]/1e3, errors ? "DATA MISMATCH" : "" );
+		b.chunks = chunks;
+	}
+
+	printf( "latency of paced chunks, one every %d us\n%-12s %8s %8s %8s\n", RING_PACE_NS/1000, "", mode_name[0],
+		    mode_name[1], mode_name[2] );
+	for ( k = 0; k<RING_HIST_NUM; k++ )
+	{
+		char label[32];
+		if ( !hist[0][k] && !hist[1][k] && !hist[2][k] )
+			continue;
+		if ( k == 0 )
+			snprintf( label, sizeof(label), "< 1 us" );
+		else
+			snprintf( label, sizeof(label), "< %lu %s", k<11 ? 1UL<<k : 1UL<<(k-10), k<11 ? "us" : "ms" );
+		printf( "%-12s %8lu %8lu %8lu\n", label, hist[0][k], hist[1][k], hist[2][k] );
+	}
+
+	//paced, a consumer stall of 20 ms overflows rings up to 6 MB
+	b.chunks = RING_PACE_CHUNKS;
+	RunRing( &b, RING_DISCARD, lRingSize, 1 );
+	printf( "discard  %u drop events, %llu bytes dropped, %u chunks %llu bytes missing in consumer order %s\n",
+		    b.ring.dropEvents, b.ring.droppedBytes, b.lost_chunks, b.lost_bytes,
+		    b.errors || b.lost_bytes != b.ring.droppedBytes ? "DATA MISMATCH" : "" );
+	if ( b.errors || b.lost_bytes != b.ring.droppedBytes )
+		errors++;
+	freeSPSCRing( &b.ring );
+
+	pthread_mutex_destroy( &b.mutex );
+	free( b.chunk_len );
+	free( b.commit_ns );
+	free( b.latency );
+	free( b.pattern );
+	return errors ? 1 : 0;
+}
+
+//recording every program of a mux. The reference opens a remuxer per program and feeds each one the whole mux on
+//one thread, the splitter classifies packets once and remuxes programs on -t worker threads. Output of each channel
+//has to be the same for any number of threads; -d<dir> writes channels of the last run into files.
+#define SPLIT_MAX_RUN  8
+
+typedef struct SPLIT_CHANNEL
+{
+	ULONGLONG bytes;
+	unsigned long checksum;
+	FILE* fp;
+} SPLIT_CHANNEL;
+
+typedef struct SPLIT_BENCH
+{
+	SPLIT_CHANNEL channel[MAX_SPLIT_CHANNEL+1];
+	char* dir;
+} SPLIT_BENCH;
+
+static void SplitChecksum( SPLIT_CHANNEL* pChannel, const unsigned char* pData, int nBytes )
+{
+	int i;
+	for ( i = 0; i<nBytes; i++ )
+		pChannel->checksum = pChannel->checksum*31 + pData[i] + (unsigned long)( (pChannel->bytes+i) & 0xff );
+	pChannel->bytes += nBytes;
+}
+
+static int SplitDumper( void* pContext, void* pData, int nSize )
+{
+	SPLIT_BENCH* b = (SPLIT_BENCH*)pContext;
+	MUX_OUTPUT_DATA* output = (MUX_OUTPUT_DATA*)pData;
+	SPLIT_CHANNEL* channel = &b->channel[output->channel];
+	if ( b->dir != NULL && channel->fp == NULL )
+	{
+		char file_name[512];
+		snprintf( file_name, sizeof(file_name), "%s/channel-%02d-%d.mpg", b->dir, output->channel, output->program );
+		channel->fp = fopen( file_name, "wb" );
+	}
+	if ( channel->fp != NULL )
+		fwrite( output->data_ptr, 1, output->bytes, channel->fp );
+	SplitChecksum( channel, output->data_ptr, output->bytes );
+	return nSize;
+}
+
+typedef struct SPLIT_REF_OUTPUT
+{
+	SPLIT_BENCH* bench;
+	int channel;
+} SPLIT_REF_OUTPUT;
+
+static int SplitRefDumper( void* pContext, void* pData, int nSize )
+{
+	SPLIT_REF_OUTPUT* output = (SPLIT_REF_OUTPUT*)pContext;
+	OUTPUT_DATA *pOutputData = (OUTPUT_DATA *)pData;
+	SplitChecksum( &output->bench->channel[output->channel], pOutputData->data_ptr, pOutputData->bytes );
+	return pOutputData->bytes;
+}
+
+static double RunSplitRef( BENCH_DATA* pBench, SPLIT_BENCH* b, int nChannels )
+{
+	SPLIT_REF_OUTPUT output[MAX_SPLIT_CHANNEL];
+	void* remuxer[MAX_SPLIT_CHANNEL];
+	unsigned long offset = 0;
+	double t0;
+	int i;
+
+	memset( b->channel, 0, sizeof(b->channel) );
+	t0 = now_sec( );
+	for ( i = 0; i<nChannels; i++ )
+	{
+		TUNE tune={0};
+		tune.channel = i+1;
+		output[i].bench = b;
+		output[i].channel = i+1;
+		remuxer[i] = OpenRemuxStream( REMUX_STREAM, &tune, pBench->packet_length == M2TS_PACKET_LENGTH ? MPEG_M2TS : MPEG_TS,
+									  MPEG_PS, NULL, NULL, SplitRefDumper, &output[i] );
+	}
+	while ( offset < pBench->bytes )
+	{
+		int bytes = (int)_MIN( PUSH_BLOCK_SIZE, pBench->bytes - offset ), expected_bytes;
+		for ( i = 0; i<nChannels; i++ )
+			PushRemuxStreamData( remuxer[i], pBench->data+offset, bytes, &expected_bytes );
+		offset += bytes;
+	}
+	for ( i = 0; i<nChannels; i++ )
+	{
+		FlushRemuxStream( remuxer[i] );
+		CloseRemuxStream( remuxer[i] );
+	}
+	return now_sec( )-t0;
+}
+
+static double RunSplit( BENCH_DATA* pBench, SPLIT_BENCH* b, int nChannels, int nThreads, int* pFound )
+{
+	unsigned long offset = 0;
+	void* splitter;
+	double t0, t1;
+	int i;
+
+	memset( b->channel, 0, sizeof(b->channel) );
+	t0 = now_sec( );
+	splitter = OpenMuxSplitter( nChannels, nThreads, pBench->packet_length == M2TS_PACKET_LENGTH ? MPEG_M2TS : MPEG_TS,
+							    MPEG_PS, SplitDumper, b );
+	while ( offset < pBench->bytes )
+	{
+		int bytes = (int)_MIN( PUSH_BLOCK_SIZE, pBench->bytes - offset );
+		int used = PushMuxSplitterData( splitter, pBench->data+offset, bytes );
+		offset += used > 0 ? used : bytes;
+	}
+	*pFound = MuxSplitterChannelNum( splitter );
+	CloseMuxSplitter( splitter );
+	t1 = now_sec( );
+	for ( i = 0; i<=MAX_SPLIT_CHANNEL; i++ )
+	{
+		if ( b->channel[i].fp != NULL )
+			fclose( b->channel[i].fp );
+		b->channel[i].fp = NULL;
+	}
+	return t1-t0;
+}
+
+static int BenchSplit( BENCH_DATA* pBench, char* pFileName, int nPrograms, int nThreads, unsigned long lBytes, char* pDir )
+{
+	static SPLIT_BENCH b, ref, base;
+	int threads[SPLIT_MAX_RUN], runs = 0, found = 0, i, k, errors = 0;
+	double t, t_ref, t_base = 0;
+
+	if ( nPrograms <= 0 || nPrograms > MAX_SPLIT_CHANNEL )
+		nPrograms = MAX_SPLIT_CHANNEL;
+	if ( !LoadFile( pBench, pFileName, lBytes ) )
+	{
+		int synthetic = nPrograms < MAX_SPLIT_CHANNEL ? nPrograms : 16;
+		BuildMux( pBench, synthetic, lBytes ? lBytes : 64*1024*1024 );
+		printf( "synthetic %d program mux, ", synthetic );
+		//kept as a recorded mux for tests that replay it
+		if ( pDir != NULL )
+		{
+			char path[512];
+			FILE* fp;
+			snprintf( path, sizeof(path), "%s/mux.ts", pDir );
+			if ( ( fp = fopen( path, "wb" ) ) != NULL )
+			{
+				fwrite( pBench->data, 1, pBench->bytes, fp );
+				fclose( fp );
+			}
+		}
+	}
+	if ( nThreads <= 0 )
+		nThreads = _MAX( 4, (int)sysconf( _SC_NPROCESSORS_ONLN ) );
+	for ( k = 0; k<=nThreads && runs < SPLIT_MAX_RUN; k = k ? k*2 : 1 )
+		threads[runs++] = k;
+	if ( threads[runs-1] != nThreads && runs < SPLIT_MAX_RUN )
+		threads[runs++] = nThreads;
+	printf( "%lu MB, %ld cpus\n", pBench->bytes>>20, sysconf( _SC_NPROCESSORS_ONLN ) );
+
+	for ( i = 0; i<runs; i++ )
+	{
+		b.dir = i == runs-1 ? pDir : NULL;
+		t = RunSplit( pBench, &b, nPrograms, threads[i], &found );
+		if ( i == 0 )
+		{
+			t_base = t;
+			base = b;
+			t_ref = RunSplitRef( pBench, &ref, found );
+			printf( "%d channels\n%-18s %8s %8s\n", found, "", "MB/s", "speedup" );
+			printf( "%-18s %8.1f %8.2f\n", "remuxer/program", pBench->bytes/t_ref/1e6, t_base/t_ref );
+		}
+		for ( k = 1; k<=found; k++ )
+		{
+			if ( b.channel[k].bytes != base.channel[k].bytes || b.channel[k].checksum != base.channel[k].checksum )
+			{
+				printf( "channel %d output mismatch with %d threads\n", k, threads[i] );
+				errors++;
+			}
+		}
+		printf( "splitter %2d thread %8.1f %8.2f\n", threads[i], pBench->bytes/t/1e6, t_base/t );
+	}
+
+	//pack SCR is interpolated over input bytes between PCRs, a remuxer of the splitter sees only packets of its
+	//program, SCR may differ from remuxer/program by a few ticks, payload and size don't. The reference is
+	//flushed before it is closed, CloseMuxSplitter has to remux and flush what is left of each channel as well.
+	k = 0;
+	for ( i = 1; i<=found; i++ )
+		if ( ref.channel[i].bytes == base.channel[i].bytes )
+			k++;
+	printf( "output size of %d of %d channels is same as remuxer/program\n", k, found );
+	for ( i = 1; i<=found; i++ )
+		printf( "  channel %2d %10llu bytes, remuxer/program %10llu bytes %s\n", i, base.channel[i].bytes, 
+			    ref.channel[i].bytes, ref.channel[i].bytes != base.channel[i].bytes ? "SIZE MISMATCH" : "" );
+	return errors || k != found ? 1 : 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//EIT memory: a day of EIT carousel into an EPG parser, heap against arena allocator
+#define EIT_PID            0x12
+#define EIT_ONID           0x233a
+#define EIT_TSID           1
+#define EIT_SEGMENT_EVENTS 6		//a 3 hours schedule segment of 30 minutes events
+#define EIT_SEGMENTS       24		//3 days of schedule
+#define EIT_HOURS          24
+
+typedef struct EIT_BENCH
+{
+	MUX_BUILDER mux;
+	int services;
+	int repeats;				//carousel cycles of an hour
+	int tsid;					//tsid of EIT sections, 0 is EIT_TSID
+	unsigned long epg_num;
+	unsigned long sections;
+	unsigned long events;
+} EIT_BENCH;
+
+static void BCD( unsigned char* p, int nVal )
+{
+	*p = (unsigned char)(((nVal/10)<<4)|(nVal%10));
+}
+
+//an event every 30 minutes of each service, event contents depend only on service and event index
+static int EitEvent( unsigned char* pOut, int nService, int nEvent )
+{
+	unsigned char* p = pOut;
+	unsigned char* desc;
+	int minutes = nEvent*30, len, text_len;
+	char text[200];
+	p[0] = (unsigned char)(nEvent>>8);
+	p[1] = (unsigned char)nEvent;
+	p[2] = (unsigned char)((60000+minutes/1440)>>8);
+	p[3] = (unsigned char)(60000+minutes/1440);
+	BCD( p+4, (minutes%1440)/60 );
+	BCD( p+5, minutes%60 );
+	BCD( p+6, 0 );
+	BCD( p+7, 0 );
+	BCD( p+8, 30 );
+	BCD( p+9, 0 );
+	desc = p+12;
+
+	//short event
+	len = snprintf( text, sizeof(text), "Program %d-%d", nService, nEvent%97 );
+	text_len = snprintf( text+len, sizeof(text)-len, "Episode %d of a series on service %d, repeated at night.", nEvent, nService );
+	desc[0] = 0x4d;
+	desc[1] = 3+1+len+1+text_len;
+	memcpy( desc+2, "eng", 3 );
+	desc[5] = len;
+	memcpy( desc+6, text, len );
+	desc[6+len] = text_len;
+	memcpy( desc+7+len, text+len, text_len );
+	desc += 2+desc[1];
+
+	//extended event on every other event
+	if ( nEvent & 1 )
+	{
+		text_len = snprintf( text, sizeof(text), "Cast and credits of event %d on service %d, with a longer description "
+			                  "of the plot that runs to about one hundred and fifty bytes of text.", nEvent, nService );
+		desc[0] = 0x4e;
+		desc[1] = 1+3+1+1+text_len;
+		desc[2] = 0x00;
+		memcpy( desc+3, "eng", 3 );
+		desc[6] = 0;
+		desc[7] = text_len;
+		memcpy( desc+8, text, text_len );
+		desc += 2+desc[1];
+	}
+
+	//content and parental rating
+	desc[0] = 0x54; desc[1] = 2; desc[2] = 0x10 | (nEvent&0x0f); desc[3] = 0;
+	desc += 4;
+	desc[0] = 0x55; desc[1] = 4; memcpy( desc+2, "GBR", 3 ); desc[5] = nEvent % 12;
+	desc += 6;
+
+	len = (int)(desc-(p+12));
+	p[10] = 0x80 | (len>>8);
+	p[11] = len & 0xff;
+	return 12+len;
+}
+
+static void EitSection( EIT_BENCH* b, int nTableId, int nService, int nVersion, int nSection, int nLastSection,
+					    int nFirstEvent, int nEvents )
+{
+	unsigned char body[4096], section[4096+16];
+	int i, bytes = 6, len;
+	int tsid = b->tsid ? b->tsid : EIT_TSID;
+	section[0] = 0; //pointer field
+	body[0] = tsid>>8;
+	body[1] = tsid&0xff;
+	body[2] = EIT_ONID>>8;
+	body[3] = EIT_ONID&0xff;
+	body[4] = nLastSection;
+	body[5] = nTableId;
+	for ( i = 0; i<nEvents; i++ )
+		bytes += EitEvent( body+bytes, nService, nFirstEvent+i );
+	len = 1+SectionVer( section+1, nTableId, nService, nVersion, nSection, nLastSection, body, bytes );
+	Packetize( &b->mux, EIT_PID, section, len, 0 );
+	b->sections++;
+}
+
+//EIT carousel of an hour: present/following that changes every hour, 3 days schedule rolling on 3 hours segments
+static void EitHour( EIT_BENCH* b, int nHour )
+{
+	int r, i, s, first_segment = nHour/3;
+	b->mux.bytes = 0;
+	for ( r = 0; r<b->repeats; r++ )
+		for ( i = 0; i<b->services; i++ )
+		{
+			int service = 0x100+i;
+			EitSection( b, 0x4e, service, nHour, 0, 1, nHour*2, 1 );
+			EitSection( b, 0x4e, service, nHour, 1, 1, nHour*2+1, 1 );
+			for ( s = first_segment; s<first_segment+EIT_SEGMENTS; s++ )
+				EitSection( b, 0x50+(s/32)%16, service, first_segment, (s%32)*8, (EIT_SEGMENTS-1)*8,
+							s*EIT_SEGMENT_EVENTS, EIT_SEGMENT_EVENTS );
+		}
+}
+
+static int EitEPGDumper( void* pContext, void* pData, int nSize )
+{
+	((EIT_BENCH*)pContext)->epg_num++;
+	return nSize;
+}
+
+static long RSSBytes( )
+{
+	long pages = 0, rss = 0;
+	FILE* fp = fopen( "/proc/self/statm", "r" );
+	if ( fp != NULL )
+	{
+		if ( fscanf( fp, "%ld %ld", &pages, &rss ) != 2 )
+			rss = 0;
+		fclose( fp );
+	}
+	return rss*sysconf( _SC_PAGESIZE );
+}
+
+static unsigned long TotalAllocs( )
+{
+	unsigned long allocs = 0;
+	int i;
+	for ( i = 0; i<MEM_TAG_NUM; i++ )
+	{
+		MEM_STAT stat;
+		SageMemoryStat( i, &stat );
+		allocs += stat.allocs;
+	}
+	return allocs;
+}
+
+static void PrintEitRow( const char* pMode, const char* pHour, double fMB, double fAllocRate, double fSectionRate )
+{
+	MEM_STAT stat[MEM_TAG_NUM];
+	int i;
+	for ( i = 0; i<MEM_TAG_NUM; i++ )
+		SageMemoryStat( i, &stat[i] );
+	printf( "%-6s %5s %8.0f %10.0f %9.0f %8ld %8ld %8ld %8ld %8ld %7.1f\n", pMode, pHour, fMB, fAllocRate, fSectionRate,
+		    stat[MEM_TAG_EPG].bytes/1024, stat[MEM_TAG_DESC].bytes/1024, stat[MEM_TAG_SECTION].bytes/1024,
+		    stat[MEM_TAG_MISC].bytes/1024, SageMemoryArenaBytes()/1024, RSSBytes()/1048576.0 );
+}
+
+static int RunEitMem( BENCH_DATA* pBench, EIT_BENCH* b, int bArena )
+{
+	const char* mode = bArena ? "arena" : "heap";
+	TS_EPG_PARSER* parser;
+	double t_total = 0, mb_total = 0;
+	unsigned long allocs_total = 0, sections_total = 0;
+	int h, i;
+
+	SageMemArenaEnable( bArena );
+	parser = CreateTSEPGParser( DVB_STREAM, 0 );
+	SetupTSEPGParserDump( parser, NULL, NULL, (DUMP)EitEPGDumper, b );
+	for ( h = 1; h<=EIT_HOURS; h++ )
+	{
+		unsigned char* data;
+		unsigned long bytes, allocs;
+		double t0, t;
+		if ( pBench->data != NULL )
+		{
+			data  = pBench->data;
+			bytes = pBench->bytes;
+		} else
+		{
+			b->sections = 0;
+			EitHour( b, h );
+			data  = b->mux.data;
+			bytes = b->mux.bytes;
+		}
+		allocs = TotalAllocs( );
+		t0 = now_sec( );
+		for ( i = 0; i+TS_PACKET_LENGTH <= (int)bytes; )
+		{
+			int n = (int)_MIN( PUSH_BLOCK_SIZE, bytes-i );
+			i += PushTSEPGPacketParser( parser, data+i, n - n%TS_PACKET_LENGTH );
+		}
+		t = now_sec( )-t0;
+		allocs = TotalAllocs( )-allocs;
+		t_total += t;
+		mb_total += bytes/1048576.0;
+		allocs_total += allocs;
+		sections_total += b->sections;
+		if ( h == 1 || h%4 == 0 )
+		{
+			char hour[8];
+			snprintf( hour, sizeof(hour), "%d", h );
+			PrintEitRow( mode, hour, mb_total, allocs/t, b->sections/t );
+		}
+	}
+	PrintEitRow( mode, "total", mb_total, allocs_total/t_total, sections_total/t_total );
+	ResetTSEPGParser( parser );
+	PrintEitRow( mode, "reset", mb_total, 0, 0 );
+	ReleaseTSEPGParser( parser );
+	printf( "%-6s %lu EPG strings, %.2f s parse\n", mode, b->epg_num, t_total );
+	return 0;
+}
+
+//each allocator runs in its own process for a clean RSS
+static int BenchEitMem( BENCH_DATA* pBench, int nServices, int nRepeats )
+{
+	EIT_BENCH b;
+	int bArena, ret = 0;
+
+	memset( &b, 0, sizeof(b) );
+	b.services = nServices > 0 ? nServices : 100;
+	b.repeats = nRepeats > 0 ? nRepeats : 1;
+	if ( pBench->data != NULL )
+		printf( "%lu bytes of EIT stream file an hour, %d hours\n", pBench->bytes, EIT_HOURS );
+	else
+	{
+		b.mux.size = (unsigned long)b.services*b.repeats*(2+EIT_SEGMENTS)*12*TS_PACKET_LENGTH;
+		b.mux.data = (unsigned char*)malloc( b.mux.size );
+		printf( "synthetic EIT of %d services, %d days schedule, carousel %d times an hour, %d hours\n",
+			    b.services, EIT_SEGMENTS/8, b.repeats, EIT_HOURS );
+	}
+	printf( "%-6s %5s %8s %10s %9s %8s %8s %8s %8s %8s %7s\n", "mode", "hour", "MB fed", "allocs/s", "sects/s",
+		    "epg KB", "desc KB", "sect KB", "misc KB", "slab KB", "RSS MB" );
+	fflush( stdout );
+	for ( bArena = 0; bArena<=1; bArena++ )
+	{
+		int status = 1;
+		pid_t pid = fork( );
+		if ( pid == 0 )
+		{
+			RunEitMem( pBench, &b, bArena );
+			fflush( stdout );
+			_exit( 0 );
+		}
+		if ( pid < 0 || waitpid( pid, &status, 0 ) < 0 || status != 0 )
+			ret = 1;
+	}
+	free( b.mux.data );
+	return ret;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//EIT store: carousel cycles of present/following and 8 days of schedule of every service into a DVB EPG
+//parser, the first cycle fills the event store, the others repeat unchanged sections
+#define EIT_STORE_DAYS     8
+
+static void EitSchedule( EIT_BENCH* b )
+{
+	int i, s, segments = EIT_STORE_DAYS*8;
+	b->mux.bytes = 0;
+	for ( i = 0; i<b->services; i++ )
+	{
+		int service = 0x100+i;
+		EitSection( b, 0x4e, service, 0, 0, 1, 0, 1 );
+		EitSection( b, 0x4e, service, 0, 1, 1, 1, 1 );
+		b->events += 2;
+		for ( s = 0; s<segments; s++ )
+		{
+			int last_segment = _MIN( segments, (s/32+1)*32 )-1;
+			EitSection( b, 0x50+s/32, service, 0, (s%32)*8, (last_segment%32)*8, s*EIT_SEGMENT_EVENTS, EIT_SEGMENT_EVENTS );
+			b->events += EIT_SEGMENT_EVENTS;
+		}
+	}
+}
+
+static long PeakRSSBytes( )
+{
+	char line[128];
+	long kb = 0;
+	FILE* fp = fopen( "/proc/self/status", "r" );
+	if ( fp != NULL )
+	{
+		while ( fgets( line, sizeof(line), fp ) != NULL )
+			if ( !strncmp( line, "VmHWM:", 6 ) )
+				kb = atol( line+6 );
+		fclose( fp );
+	}
+	return kb*1024;
+}
+
+static int BenchEitStore( BENCH_DATA* pBench, int nServices, int nCycles )
+{
+	TS_EPG_PARSER* parser;
+	EIT_BENCH b;
+	MEM_STAT epg, desc;
+	double t_total = 0;
+	int c, i;
+
+	memset( &b, 0, sizeof(b) );
+	b.services = nServices > 0 ? nServices : 200;
+	if ( pBench->data != NULL )
+		printf( "%lu bytes of EIT stream file, %d cycles\n", pBench->bytes, nCycles );
+	else
+	{
+		b.mux.size = (unsigned long)b.services*(2+EIT_STORE_DAYS*8)*12*TS_PACKET_LENGTH;
+		b.mux.data = (unsigned char*)malloc( b.mux.size );
+		EitSchedule( &b );
+		printf( "synthetic EIT of %d services, %d days schedule, %lu events in %lu sections a cycle, %d cycles\n",
+			    b.services, EIT_STORE_DAYS, b.events, b.sections, nCycles );
+	}
+	printf( "%-6s %8s %10s %11s %9s %9s %9s %9s\n", "cycle", "MB", "sects/s", "events/s", "EPG out",
+		    "epg KB", "peak KB", "VmHWM MB" );
+
+	parser = CreateTSEPGParser( DVB_STREAM, 0 );
+	SetupTSEPGParserDump( parser, NULL, NULL, (DUMP)EitEPGDumper, &b );
+	for ( c = 1; c<=nCycles; c++ )
+	{
+		unsigned char* data = pBench->data != NULL ? pBench->data : b.mux.data;
+		unsigned long bytes = pBench->data != NULL ? pBench->bytes : b.mux.bytes;
+		unsigned long epg_num = b.epg_num;
+		double t0, t;
+		t0 = now_sec( );
+		for ( i = 0; i+TS_PACKET_LENGTH <= (int)bytes; )
+		{
+			int n = (int)_MIN( PUSH_BLOCK_SIZE, bytes-i );
+			i += PushTSEPGPacketParser( parser, data+i, n - n%TS_PACKET_LENGTH );
+		}
+		t = now_sec( )-t0;
+		t_total += t;
+		SageMemoryStat( MEM_TAG_EPG, &epg );
+		SageMemoryStat( MEM_TAG_DESC, &desc );
+		printf( "%-6d %8.1f %10.0f %11.0f %9lu %9ld %9ld %9.1f\n", c, bytes/1048576.0, b.sections/t, b.events/t,
+			    b.epg_num-epg_num, (epg.bytes+desc.bytes)/1024, (epg.peak_bytes+desc.peak_bytes)/1024,
+				PeakRSSBytes()/1048576.0 );
+	}
+	ReleaseTSEPGParser( parser );
+	printf( "%lu EPG strings, %.2f s parse\n", b.epg_num, t_total );
+	free( b.mux.data );
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//zero copy: TS->PS remux of a 20 Mbps H.264 program into a batching writer, a writer copying output into
+//a batch buffer (as capture plugins do) against a writer holding ES blocks and writing iovec chains.
+//MB/s is of the best of -n loops
+#define ZC_BITRATE     20000000
+#define ZC_PMT_PID     0x100
+#define ZC_VIDEO_PID   0x101
+#define ZC_AUDIO_PID   0x104
+#define ZC_BATCH_SIZE  (256*1024)
+#define ZC_BATCH_IOV   64
+#define ZC_HOLD_MAX    (FIFO_QUEUE_SIZE/4)
+
+static void BuildH264Mux( BENCH_DATA* pBench, unsigned long lBytes )
+{
+	//AUD, SPS of Main@4.0 1920x1080 29.97 fps, PPS
+	static unsigned char seq_hdr[]={ 0x00,0x00,0x00,0x01,0x09,0x10,
+	                                 0x00,0x00,0x00,0x01,0x67,0x4d,0x00,0x28,0xda,0x01,0xe0,0x08,0x9f,0x96,
+	                                 0x10,0x00,0x00,0x3e,0x90,0x00,0x0e,0xa6,0x08,0x40,
+	                                 0x00,0x00,0x00,0x01,0x68,0xee,0x3c,0x80 };
+	int frame_bytes = (int)( (ULONGLONG)ZC_BITRATE/8*1001/30000 );
+	MUX_BUILDER *mux = calloc( 1, sizeof(MUX_BUILDER) );
+	unsigned char body[256], pat[256], pmt[256], *es, *pes, *p;
+	int pat_bytes, pmt_bytes, n, frame = 0;
+
+	mux->size = lBytes - lBytes%TS_PACKET_LENGTH;
+	mux->data = malloc( mux->size );
+	es  = malloc( frame_bytes*4 );
+	pes = malloc( frame_bytes*4+16 );
+
+	body[0] = 0; body[1] = 1; body[2] = 0xe0 | (ZC_PMT_PID>>8); body[3] = ZC_PMT_PID&0xff;
+	pat[0] = 0;
+	pat_bytes = 1+Section( pat+1, 0, 1, body, 4 );
+	p = body;
+	*p++ = 0xe0 | (ZC_VIDEO_PID>>8); *p++ = ZC_VIDEO_PID&0xff;
+	*p++ = 0xf0; *p++ = 0;
+	*p++ = 0x1b;
+	*p++ = 0xe0 | (ZC_VIDEO_PID>>8); *p++ = ZC_VIDEO_PID&0xff;
+	*p++ = 0xf0; *p++ = 0;
+	*p++ = 0x81;
+	*p++ = 0xe0 | (ZC_AUDIO_PID>>8); *p++ = ZC_AUDIO_PID&0xff;
+	*p++ = 0xf0; *p++ = 6;
+	*p++ = ISO639_LANGUAGE_DESC; *p++ = 4; *p++ = 'e'; *p++ = 'n'; *p++ = 'g'; *p++ = 0;
+	pmt[0] = 0;
+	pmt_bytes = 1+Section( pmt+1, 2, 1, body, (int)(p-body) );
+
+	//an IDR of 3 average frames each 30 frames, other frames make up the rate
+	srand( 1 );
+	while ( mux->bytes + TS_PACKET_LENGTH <= mux->size )
+	{
+		unsigned long pts = frame*3003+90000;
+		int idr = frame % 30 == 0;
+		int bytes = idr ? frame_bytes*3 : frame_bytes*27/29;
+		if ( frame % 10 == 0 )
+		{
+			Packetize( mux, 0, pat, pat_bytes, 0 );
+			Packetize( mux, ZC_PMT_PID, pmt, pmt_bytes, 0 );
+		}
+		n = 0;
+		if ( idr )
+		{
+			memcpy( es, seq_hdr, sizeof(seq_hdr) );
+			n = sizeof(seq_hdr);
+		} else
+		{
+			memcpy( es, seq_hdr, 6 );
+			n = 6;
+		}
+		es[n++] = 0; es[n++] = 0; es[n++] = 0; es[n++] = 1; es[n++] = idr ? 0x65 : 0x41;
+		while ( n < bytes )
+			es[n++] = (unsigned char)( rand() | 0x01 );
+		Packetize( mux, ZC_VIDEO_PID, pes, PackPES( pes, 0xe0, es, n, pts ), (ULONGLONG)pts*300 );
+		if ( frame % 2 == 0 )
+		{
+			memset( es, 0, 1536 );
+			es[0] = 0x0b; es[1] = 0x77; es[4] = 0x14; es[5] = 0x40;
+			Packetize( mux, ZC_AUDIO_PID, pes, PackPES( pes, 0xbd, es, 1536, pts ), 0 );
+		}
+		frame++;
+	}
+
+	pBench->data = mux->data;
+	pBench->bytes = mux->bytes;
+	pBench->packet_length = TS_PACKET_LENGTH;
+	free( es );
+	free( pes );
+	free( mux );
+}
+
+typedef struct ZC_WRITER
+{
+	int fd;
+	unsigned char* batch;		//output copies of the copy writer, slices out of ES blocks of the iovec writer
+	unsigned long  batch_bytes;
+	DATA_IOV iov[ZC_BATCH_IOV];
+	int iov_num;
+	unsigned long iov_bytes;
+	BLOCK_BUFFER* held[ZC_HOLD_MAX];
+	int held_num;
+	ULONGLONG copy_bytes;
+	ULONGLONG bytes;
+	unsigned long writes;
+} ZC_WRITER;
+
+static void ZCFlush( ZC_WRITER* w )
+{
+	if ( w->iov_num )
+	{
+		int i = 0;
+		while ( i < w->iov_num )
+		{
+			ssize_t n = writev( w->fd, w->iov+i, w->iov_num-i );
+			if ( n < 0 )
+				break;
+			w->bytes += n;
+			w->writes++;
+			while ( i < w->iov_num && n >= (ssize_t)w->iov[i].iov_len )
+				n -= w->iov[i++].iov_len;
+			if ( i < w->iov_num && n > 0 )
+			{
+				w->iov[i].iov_base = (unsigned char*)w->iov[i].iov_base + n;
+				w->iov[i].iov_len -= n;
+			}
+		}
+		while ( w->held_num )
+			DropBlockBuffer( w->held[--w->held_num] );
+	} else
+	if ( w->batch_bytes )
+	{
+		if ( write( w->fd, w->batch, w->batch_bytes ) > 0 )
+			w->bytes += w->batch_bytes;
+		w->writes++;
+	}
+	w->iov_num = 0;
+	w->iov_bytes = 0;
+	w->batch_bytes = 0;
+}
+
+static int ZCCopyDumper( void* pContext, void* pData, int nSize )
+{
+	ZC_WRITER* w = (ZC_WRITER*)pContext;
+	OUTPUT_DATA* output = (OUTPUT_DATA*)pData;
+	if ( w->batch_bytes + output->bytes > ZC_BATCH_SIZE )
+		ZCFlush( w );
+	memcpy( w->batch+w->batch_bytes, output->data_ptr, output->bytes );
+	w->batch_bytes += output->bytes;
+	w->copy_bytes += output->bytes;
+	return output->bytes;
+}
+
+static int ZCIovDumper( void* pContext, void* pData, int nSize )
+{
+	ZC_WRITER* w = (ZC_WRITER*)pContext;
+	OUTPUT_IOV* output = (OUTPUT_IOV*)pData;
+	int i;
+	if ( w->iov_num + output->iov_num > ZC_BATCH_IOV || w->held_num >= ZC_HOLD_MAX ||
+		 w->batch_bytes + output->bytes > ZC_BATCH_SIZE )
+		ZCFlush( w );
+	if ( HoldBlockBuffer( output->block ) )
+	{
+		w->held[w->held_num++] = output->block;
+		for ( i = 0; i<output->iov_num; i++ )
+			w->iov[w->iov_num++] = output->iov[i];
+	} else
+	{
+		//slices are valid only in the call, they are copied
+		unsigned char* p = w->batch+w->batch_bytes;
+		for ( i = 0; i<output->iov_num; i++ )
+		{
+			memcpy( w->batch+w->batch_bytes, output->iov[i].iov_base, output->iov[i].iov_len );
+			w->batch_bytes += output->iov[i].iov_len;
+		}
+		w->iov[w->iov_num].iov_base = p;
+		w->iov[w->iov_num++].iov_len = output->bytes;
+		w->copy_bytes += output->bytes;
+	}
+	w->iov_bytes += output->bytes;
+	if ( w->iov_bytes >= ZC_BATCH_SIZE )
+		ZCFlush( w );
+	return output->bytes;
+}
+
+static double RunZeroCopy( BENCH_DATA* pBench, ZC_WRITER* w, int bIov, ULONGLONG* pRemuxCopyBytes )
+{
+	TUNE tune={0};
+	void* remuxer;
+	double t0, t, t_best = 0;
+	ULONGLONG output_bytes;
+	int i;
+
+	for ( i = 0; i<pBench->loops; i++ )
+	{
+		t0 = now_sec( );
+		tune.channel = 1;
+		remuxer = OpenRemuxStream( REMUX_STREAM, &tune, MPEG_TS, MPEG_PS, NULL, NULL, ZCCopyDumper, w );
+		if ( bIov )
+			SetupRemuxOutputIOVDump( remuxer, ZCIovDumper, w );
+		PushAll( remuxer, pBench );
+		FlushRemuxStream( remuxer );
+		ZCFlush( w );
+		GetRemuxCopyStat( remuxer, pRemuxCopyBytes, &output_bytes );
+		CloseRemuxStream( remuxer );
+		t = now_sec( )-t0;
+		if ( i == 0 || t < t_best )
+			t_best = t;
+	}
+	return t_best;
+}
+
+static int BenchZeroCopy( BENCH_DATA* pBench, char* pFileName, unsigned long lBytes, char* pDir )
+{
+	static const char* mode[2]={ "copy", "iovec" };
+	char file_name[2][512];
+	unsigned long checksum[2]={ 0, 0 };
+	ULONGLONG bytes[2]={ 0, 0 };
+	int i;
+
+	if ( !LoadFile( pBench, pFileName, lBytes ) )
+	{
+		BuildH264Mux( pBench, lBytes ? lBytes : 64*1024*1024 );
+		printf( "synthetic %d Mbps H.264 TS, ", ZC_BITRATE/1000000 );
+	}
+	printf( "%lu MB, loops %d\n", pBench->bytes>>20, pBench->loops );
+	printf( "%-6s %8s %10s %8s %12s %12s %12s\n", "writer", "MB/s", "out MB", "writes", "remux copy/B", "writer copy/B", "total copy/B" );
+	for ( i = 0; i<2; i++ )
+	{
+		ZC_WRITER w;
+		ULONGLONG remux_copy = 0;
+		double t, out;
+		memset( &w, 0, sizeof(w) );
+		w.batch = malloc( ZC_BATCH_SIZE );
+		if ( pDir != NULL )
+		{
+			snprintf( file_name[i], sizeof(file_name[i]), "%s/zerocopy-%s.mpg", pDir, mode[i] );
+			w.fd = open( file_name[i], O_WRONLY|O_CREAT|O_TRUNC, 0666 );
+		} else
+			w.fd = open( "/dev/null", O_WRONLY );
+		if ( w.fd < 0 )
+		{
+			printf( "can't open output %s\n", pDir != NULL ? file_name[i] : "/dev/null" );
+			free( w.batch );
+			return 1;
+		}
+		t = RunZeroCopy( pBench, &w, i, &remux_copy );
+		close( w.fd );
+		out = (double)w.bytes/pBench->loops;
+		printf( "%-6s %8.1f %10.1f %8lu %12.3f %12.3f %12.3f\n", mode[i], pBench->bytes/t/1e6, out/1048576,
+			    w.writes/pBench->loops, remux_copy/out, w.copy_bytes/pBench->loops/out, (remux_copy+w.copy_bytes/pBench->loops)/out );
+		bytes[i] = w.bytes;
+		if ( pDir != NULL )
+			checksum[i] = FileChecksum( file_name[i] );
+		free( w.batch );
+	}
+	if ( bytes[0] != bytes[1] || checksum[0] != checksum[1] )
+	{
+		printf( "output mismatch between writers\n" );
+		return 1;
+	}
+	printf( "output of both writers is identical%s\n", pDir != NULL ? " (file checksum)" : " in size" );
+	return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//message queue: the EPG strings of an EIT sweep posted as capture plugins post them, a delivery a message
+//on the tuner thread (the old postMessage) against the native message queue and its dispatcher thread.
+//There is no VM here, the deliver stub decodes records and copies source and data out as MsgManager does,
+//so CPU is of the native side and the count of JNI crossings stands for the Java side
+#define MQ_SOURCE        "adapter0-0"
+#define MQ_EPG_MSG_TYPE  10
+#define MQ_DIRECT        0
+#define MQ_QUEUE         1
+
+typedef struct MQ_BENCH
+{
+	EIT_BENCH eit;
+	int mode;
+	unsigned long delivered;
+	unsigned long deliver_calls;
+	double post_cpu;			//tuner thread, in the EPG dumper
+	double dispatch_cpu;		//dispatcher thread, as of its last delivery
+	unsigned char record[16+sizeof(MQ_SOURCE)+MSG_MAX_DATA];
+} MQ_BENCH;
+
+static double cpu_sec( clockid_t clock )
+{
+	struct timespec ts;
+	clock_gettime( clock, &ts );
+	return ts.tv_sec + ts.tv_nsec/1e9;
+}
+
+static void MQPut32( unsigned char* p, unsigned long nVal )
+{
+	p[0] = (unsigned char)(nVal>>24); p[1] = (unsigned char)(nVal>>16);
+	p[2] = (unsigned char)(nVal>>8);  p[3] = (unsigned char)nVal;
+}
+
+static unsigned long MQGet32( unsigned char* p )
+{
+	return ((unsigned long)p[0]<<24)|((unsigned long)p[1]<<16)|((unsigned long)p[2]<<8)|p[3];
+}
+
+//as MsgManager.postMessages, a source string and a data array a message
+static unsigned long MQDecode( unsigned char* pData, int nBytes )
+{
+	unsigned long n = 0;
+	int pos = 0;
+	while ( pos+16 <= nBytes )
+	{
+		unsigned long src_len = MQGet32( pData+pos+8 );
+		unsigned long data_len = MQGet32( pData+pos+12+src_len );
+		char* src = malloc( src_len+1 );
+		unsigned char* data = malloc( data_len );
+		memcpy( src, pData+pos+12, src_len );
+		src[src_len] = 0;
+		memcpy( data, pData+pos+16+src_len, data_len );
+		free( src );
+		free( data );
+		pos += 16+src_len+data_len;
+		n++;
+	}
+	return n;
+}
+
+static int MQDeliver( void* pContext, unsigned char* pBatch, int nBytes, int nMsgs )
+{
+	MQ_BENCH* b = (MQ_BENCH*)pContext;
+	b->delivered += MQDecode( pBatch, nBytes );
+	b->deliver_calls++;
+	if ( b->mode == MQ_QUEUE )
+		b->dispatch_cpu = cpu_sec( CLOCK_THREAD_CPUTIME_ID );
+	return nMsgs;
+}
+
+static int MQEPGDumper( void* pContext, void* pData, int nSize )
+{
+	MQ_BENCH* b = (MQ_BENCH*)pContext;
+	int len = (int)strlen( (char*)pData ), src_len = sizeof(MQ_SOURCE)-1;
+	double c0 = cpu_sec( CLOCK_THREAD_CPUTIME_ID );
+	b->eit.epg_num++;
+	if ( b->mode == MQ_DIRECT )
+	{
+		if ( len > MSG_MAX_DATA )
+			return nSize;
+		MQPut32( b->record, MQ_EPG_MSG_TYPE );
+		MQPut32( b->record+4, 100 );
+		MQPut32( b->record+8, src_len );
+		memcpy( b->record+12, MQ_SOURCE, src_len );
+		MQPut32( b->record+12+src_len, len );
+		memcpy( b->record+16+src_len, pData, len );
+		MQDeliver( b, b->record, 16+src_len+len, 1 );
+	} else
+		postQueuedMessage( MQ_SOURCE, (char*)pData, len, MQ_EPG_MSG_TYPE, 100 );
+	b->post_cpu += cpu_sec( CLOCK_THREAD_CPUTIME_ID )-c0;
+	return nSize;
+}
+
+static void RunMsgQueue( BENCH_DATA* pBench, MQ_BENCH* b, double* pResult )
+{
+	TS_EPG_PARSER* parser;
+	MsgQueueStats stats={0};
+	double t_wall = 0, t0;
+	int h, i, hours = pBench->data != NULL ? pBench->loops : EIT_HOURS;
+
+	if ( b->mode == MQ_QUEUE )
+		setMsgQueueDeliver( MQDeliver, b );
+	parser = CreateTSEPGParser( DVB_STREAM, 0 );
+	SetupTSEPGParserDump( parser, NULL, NULL, (DUMP)MQEPGDumper, b );
+	for ( h = 1; h<=hours; h++ )
+	{
+		unsigned char* data;
+		unsigned long bytes;
+		if ( pBench->data != NULL )
+		{
+			data  = pBench->data;
+			bytes = pBench->bytes;
+		} else
+		{
+			EitHour( &b->eit, h );
+			data  = b->eit.mux.data;
+			bytes = b->eit.mux.bytes;
+		}
+		t0 = now_sec( );
+		for ( i = 0; i+TS_PACKET_LENGTH <= (int)bytes; )
+		{
+			int n = (int)_MIN( PUSH_BLOCK_SIZE, bytes-i );
+			i += PushTSEPGPacketParser( parser, data+i, n - n%TS_PACKET_LENGTH );
+		}
+		t_wall += now_sec( )-t0;
+	}
+	t0 = now_sec( );
+	if ( b->mode == MQ_QUEUE )
+	{
+		stopMsgQueue( );
+		statsMsgQueue( &stats );
+	}
+	t_wall += now_sec( )-t0;
+	ReleaseTSEPGParser( parser );
+
+	pResult[0] = b->eit.epg_num;
+	pResult[1] = t_wall;
+	pResult[2] = b->post_cpu;
+	pResult[3] = b->post_cpu+b->dispatch_cpu;
+	pResult[4] = b->deliver_calls;
+	pResult[5] = b->delivered;
+	pResult[6] = stats.maxDepth;
+	pResult[7] = (double)stats.dropped;
+}
+
+//each mode runs in its own process, the queue can't be restarted
+static int BenchMsgQueue( BENCH_DATA* pBench, int nServices )
+{
+	static const char* mode_name[2]={ "direct", "queue" };
+	double result[2][8];
+	MQ_BENCH* b;
+	int mode, ret = 0;
+
+	b = calloc( 1, sizeof(MQ_BENCH) );
+	b->eit.services = nServices > 0 ? nServices : 100;
+	b->eit.repeats = 1;
+	if ( pBench->data != NULL )
+		printf( "%lu bytes of EIT stream file replayed %d times\n", pBench->bytes, pBench->loops );
+	else
+	{
+		b->eit.mux.size = (unsigned long)b->eit.services*(2+EIT_SEGMENTS)*12*TS_PACKET_LENGTH;
+		b->eit.mux.data = (unsigned char*)malloc( b->eit.mux.size );
+		printf( "synthetic EIT of %d services, %d days schedule, %d hours\n", b->eit.services, EIT_SEGMENTS/8, EIT_HOURS );
+	}
+	printf( "%-6s %9s %10s %12s %12s %10s %9s %9s %8s\n", "mode", "messages", "msgs/s", "tuner us/msg",
+		    "total us/msg", "deliveries", "attaches", "max depth", "dropped" );
+	for ( mode = MQ_DIRECT; mode<=MQ_QUEUE; mode++ )
+	{
+		double* r = result[mode];
+		int fd[2], status = 1;
+		pid_t pid;
+		memset( r, 0, sizeof(result[mode]) );
+		fflush( stdout );
+		if ( pipe( fd ) < 0 )
+			return 1;
+		pid = fork( );
+		if ( pid == 0 )
+		{
+			close( fd[0] );
+			b->mode = mode;
+			RunMsgQueue( pBench, b, r );
+			_exit( write( fd[1], r, sizeof(result[mode]) ) == sizeof(result[mode]) ? 0 : 1 );
+		}
+		close( fd[1] );
+		if ( pid < 0 || read( fd[0], r, sizeof(result[mode]) ) != sizeof(result[mode]) ||
+			 waitpid( pid, &status, 0 ) < 0 || status != 0 )
+			ret = 1;
+		close( fd[0] );
+
+		//the old postMessage attaches, builds a SageMsg and detaches on every message
+		printf( "%-6s %9.0f %10.0f %12.3f %12.3f %10.0f %9.0f %9.0f %8.0f\n", mode_name[mode], r[0],
+			    r[1] > 0 ? r[0]/r[1] : 0, r[0] > 0 ? r[2]*1e6/r[0] : 0, r[0] > 0 ? r[3]*1e6/r[0] : 0,
+			    r[4], mode == MQ_DIRECT ? r[0] : 1, r[6], r[7] );
+		if ( r[5]+r[7] != r[0] )
+		{
+			printf( "%s: %.0f messages posted, %.0f delivered and %.0f dropped\n", mode_name[mode], r[0], r[5], r[7] );
+			ret = 1;
+		}
+	}
+	free( b->eit.mux.data );
+	free( b );
+	return ret;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//PSI cache: an hour of PSI/SI of a DVB-T mux and of an ATSC mux into an EPG parser, with and without
+//section cache. A/V packets are left out, they cost the same either way.
+#define PSI_SERVICES    8
+#define PSI_SLOTS       600			//100ms slots of a minute of carousel
+#define PSI_MINUTES     60
+#define PSI_EIT_PID     0x1d00
+#define PSI_ETT_PID     0x1e00
+#define PSI_ATSC_EIT    4			//EIT-0..3, 3 hours each
+#define PSI_ATSC_EVENTS 6
+
+static int PsiSection( unsigned char* pOut, int nTableId, int nExt, int nVersion, unsigned char* pBody, int nBytes )
+{
+	pOut[0] = 0; //pointer field
+	return 1+SectionVer( pOut+1, nTableId, nExt, nVersion, 0, 0, pBody, nBytes );
+}
+
+static int PsiPatPmt( unsigned char* pPat, unsigned char pPmt[][256], int* pPmtBytes )
+{
+	unsigned char body[256], *p;
+	int i;
+	for ( i = 0; i<PSI_SERVICES; i++ )
+	{
+		body[i*4]   = (0x100+i)>>8;
+		body[i*4+1] = (0x100+i)&0xff;
+		body[i*4+2] = 0xe0 | (PROGRAM_PMT_PID(i)>>8);
+		body[i*4+3] = PROGRAM_PMT_PID(i)&0xff;
+	}
+	for ( i = 0; i<PSI_SERVICES; i++ )
+	{
+		p = body;
+		*p++ = 0xe0 | (PROGRAM_VIDEO_PID(i)>>8); *p++ = PROGRAM_VIDEO_PID(i)&0xff;
+		*p++ = 0xf0; *p++ = 0;
+		*p++ = 0x02;
+		*p++ = 0xe0 | (PROGRAM_VIDEO_PID(i)>>8); *p++ = PROGRAM_VIDEO_PID(i)&0xff;
+		*p++ = 0xf0; *p++ = 0;
+		*p++ = 0x81;
+		*p++ = 0xe0 | (PROGRAM_AUDIO_PID(i)>>8); *p++ = PROGRAM_AUDIO_PID(i)&0xff;
+		*p++ = 0xf0; *p++ = 6;
+		*p++ = ISO639_LANGUAGE_DESC; *p++ = 4; *p++ = 'e'; *p++ = 'n'; *p++ = 'g'; *p++ = 0;
+		pPmtBytes[i] = PsiSection( pPmt[i], 2, 0x100+i, 0, body, (int)(p-body) );
+	}
+	for ( i = 0; i<PSI_SERVICES; i++ )
+	{
+		body[i*4]   = (0x100+i)>>8;
+		body[i*4+1] = (0x100+i)&0xff;
+		body[i*4+2] = 0xe0 | (PROGRAM_PMT_PID(i)>>8);
+		body[i*4+3] = PROGRAM_PMT_PID(i)&0xff;
+	}
+	return PsiSection( pPat, 0, EIT_TSID, 0, body, PSI_SERVICES*4 );
+}
+
+//a minute of a DVB-T mux: PAT/PMT 100ms, NIT 10s, SDT, EIT p/f and EIT-other p/f 2s, 8 days of EIT schedule
+//with first day every 10s and the others every 30s; p/f version is the half hour
+static void DvbPsiMinute( EIT_BENCH* b, int nVersion )
+{
+	unsigned char pat[256], pmt[PSI_SERVICES][256], nit[1024], sdt[1024], body[1024], *p, *loop;
+	int pat_bytes, pmt_bytes[PSI_SERVICES], nit_bytes, sdt_bytes, slot, i, s, t;
+
+	pat_bytes = PsiPatPmt( pat, pmt, pmt_bytes );
+
+	p = body;
+	*p++ = 0xf0; *p++ = 10;
+	*p++ = 0x40; *p++ = 8; memcpy( p, "Freeview", 8 ); p += 8;
+	loop = p; p += 2;
+	for ( t = 0; t<6; t++ )
+	{
+		*p++ = (EIT_TSID+t)>>8; *p++ = (EIT_TSID+t)&0xff;
+		*p++ = EIT_ONID>>8; *p++ = EIT_ONID&0xff;
+		*p++ = 0xf0; *p++ = 2+PSI_SERVICES*3+2+11;
+		*p++ = 0x41; *p++ = PSI_SERVICES*3;
+		for ( i = 0; i<PSI_SERVICES; i++ )
+		{
+			*p++ = (t*0x1000+0x100+i)>>8; *p++ = (t*0x1000+0x100+i)&0xff; *p++ = 0x01;
+		}
+		*p++ = 0x5a; *p++ = 11;
+		*p++ = 0x04; *p++ = 0xc4; *p++ = 0xb4; *p++ = 0x00 + t; //frequency in 10Hz
+		*p++ = 0x1f; *p++ = 0x83; *p++ = 0x41; *p++ = 0xff; *p++ = 0xff; *p++ = 0xff; *p++ = 0xff;
+	}
+	loop[0] = 0xf0 | ((p-loop-2)>>8);
+	loop[1] = (p-loop-2)&0xff;
+	nit_bytes = PsiSection( nit, 0x40, 0x3005, 0, body, (int)(p-body) );
+
+	p = body;
+	*p++ = EIT_ONID>>8; *p++ = EIT_ONID&0xff; *p++ = 0xff;
+	for ( i = 0; i<PSI_SERVICES; i++ )
+	{
+		char name[16];
+		int len = snprintf( name, sizeof(name), "Service %d", i );
+		*p++ = (0x100+i)>>8; *p++ = (0x100+i)&0xff;
+		*p++ = 0xfd;
+		*p++ = 0x80; *p++ = 2+1+1+3+1+len;
+		*p++ = 0x48; *p++ = 1+1+3+1+len;
+		*p++ = 0x01;
+		*p++ = 3; memcpy( p, "BBC", 3 ); p += 3;
+		*p++ = len; memcpy( p, name, len ); p += len;
+	}
+	sdt_bytes = PsiSection( sdt, 0x42, EIT_TSID, 0, body, (int)(p-body) );
+
+	b->mux.bytes = 0;
+	for ( slot = 0; slot<PSI_SLOTS; slot++ )
+	{
+		Packetize( &b->mux, 0, pat, pat_bytes, 0 );
+		for ( i = 0; i<PSI_SERVICES; i++ )
+			Packetize( &b->mux, PROGRAM_PMT_PID(i), pmt[i], pmt_bytes[i], 0 );
+		if ( slot % 100 == 0 )
+			Packetize( &b->mux, 0x10, nit, nit_bytes, 0 );
+		if ( slot % 20 == 0 )
+		{
+			Packetize( &b->mux, 0x11, sdt, sdt_bytes, 0 );
+			for ( i = 0; i<PSI_SERVICES; i++ )
+			{
+				EitSection( b, 0x4e, 0x100+i, nVersion, 0, 1, nVersion, 1 );
+				EitSection( b, 0x4e, 0x100+i, nVersion, 1, 1, nVersion+1, 1 );
+			}
+			//EIT-other p/f of two regional muxes that carry the same service_id, on the same version
+			for ( t = 1; t<=2; t++ )
+			{
+				b->tsid = EIT_TSID+t;
+				EitSection( b, 0x4f, 0x100, nVersion, 0, 1, t*1000+nVersion, 1 );
+				EitSection( b, 0x4f, 0x100, nVersion, 1, 1, t*1000+nVersion+1, 1 );
+			}
+			b->tsid = 0;
+		}
+		for ( i = 0; i<PSI_SERVICES; i++ )
+			for ( s = 0; s<EIT_STORE_DAYS*8; s++ )
+			{
+				int period = s < 8 ? 100 : 300;
+				if ( slot % period == ( i*EIT_STORE_DAYS*8+s ) % period )
+					EitSection( b, 0x50+s/32, 0x100+i, 0, (s%32)*8, (_MIN( EIT_STORE_DAYS*8, (s/32+1)*32 )-1)%32*8,
+								s*EIT_SEGMENT_EVENTS, EIT_SEGMENT_EVENTS );
+			}
+	}
+}
+
+static unsigned char* PsiAtscString( unsigned char* p, const char* pText )
+{
+	int len = (int)strlen( pText );
+	*p++ = 1; memcpy( p, "eng", 3 ); p += 3;
+	*p++ = 1; *p++ = 0; *p++ = 0;
+	*p++ = len; memcpy( p, pText, len );
+	return p+len;
+}
+
+//a minute of an ATSC mux: PAT/PMT and MGT 100ms, TVCT 400ms, STT 1s, EIT-0 500ms, EIT-1..3 3s,
+//an ETT of each event every minute; EIT-0 version is the half hour
+static void AtscPsiMinute( EIT_BENCH* b, int nVersion )
+{
+	unsigned char pat[256], pmt[PSI_SERVICES][256], mgt[512], vct[1024], stt[64];
+	unsigned char body[2048], section[2048+16], *p;
+	int pat_bytes, pmt_bytes[PSI_SERVICES], mgt_bytes, vct_bytes, slot, i, k, e;
+	char text[160];
+
+	pat_bytes = PsiPatPmt( pat, pmt, pmt_bytes );
+
+	p = body;
+	*p++ = 0;
+	*p++ = 0; *p++ = 1+2*PSI_ATSC_EIT;
+	for ( k = 0; k<1+2*PSI_ATSC_EIT; k++ )
+	{
+		int type = k == 0 ? 0 : k <= PSI_ATSC_EIT ? 0x100+k-1 : 0x200+k-1-PSI_ATSC_EIT;
+		int pid  = k == 0 ? 0x1ffb : k <= PSI_ATSC_EIT ? PSI_EIT_PID+k-1 : PSI_ETT_PID+k-1-PSI_ATSC_EIT;
+		*p++ = type>>8; *p++ = type&0xff;
+		*p++ = 0xe0|(pid>>8); *p++ = pid&0xff;
+		*p++ = 0xe0;
+		*p++ = 0; *p++ = 0; *p++ = 0x10; *p++ = 0;
+		*p++ = 0xf0; *p++ = 0;
+	}
+	*p++ = 0xf0; *p++ = 0;
+	mgt_bytes = PsiSection( mgt, 0xc7, 0, 0, body, (int)(p-body) );
+
+	p = body;
+	*p++ = 0;
+	*p++ = PSI_SERVICES;
+	for ( i = 0; i<PSI_SERVICES; i++ )
+	{
+		memset( p, 0, 14 );
+		p[1] = 'K'; p[3] = 'A'; p[5] = 'B'; p[7] = 'C'; p[9] = '0'+i;
+		p[14] = 0xf0 | (7>>6);
+		p[15] = ((7&0x3f)<<2) | ((i+1)>>8);
+		p[16] = (i+1)&0xff;
+		p[17] = 4;
+		memset( p+18, 0, 4 );
+		p[22] = EIT_TSID>>8; p[23] = EIT_TSID&0xff;
+		p[24] = (0x100+i)>>8; p[25] = (0x100+i)&0xff;
+		p[26] = 0x0d;
+		p[27] = 0xc0 | 2;
+		p[28] = (i+1)>>8; p[29] = (i+1)&0xff;
+		p[30] = 0xfc; p[31] = 0;
+		p += 32;
+	}
+	*p++ = 0xfc; *p++ = 0;
+	vct_bytes = PsiSection( vct, 0xc8, EIT_TSID, 0, body, (int)(p-body) );
+
+	b->mux.bytes = 0;
+	for ( slot = 0; slot<PSI_SLOTS; slot++ )
+	{
+		Packetize( &b->mux, 0, pat, pat_bytes, 0 );
+		for ( i = 0; i<PSI_SERVICES; i++ )
+			Packetize( &b->mux, PROGRAM_PMT_PID(i), pmt[i], pmt_bytes[i], 0 );
+		Packetize( &b->mux, 0x1ffb, mgt, mgt_bytes, 0 );
+		if ( slot % 4 == 0 )
+			Packetize( &b->mux, 0x1ffb, vct, vct_bytes, 0 );
+		if ( slot % 10 == 0 )
+		{
+			unsigned long gps = 1000000000+slot/10;
+			p = body;
+			*p++ = 0;
+			*p++ = (unsigned char)(gps>>24); *p++ = (unsigned char)(gps>>16); *p++ = (unsigned char)(gps>>8); *p++ = (unsigned char)gps;
+			*p++ = 18; *p++ = 0x60; *p++ = 0;
+			Packetize( &b->mux, 0x1ffb, stt, PsiSection( stt, 0xcd, 0, 0, body, (int)(p-body) ), 0 );
+		}
+		for ( k = 0; k<PSI_ATSC_EIT; k++ )
+		{
+			int period = k == 0 ? 5 : 30;
+			for ( i = 0; i<PSI_SERVICES; i++ )
+			{
+				if ( slot % period != ( k+i ) % period )
+					continue;
+				p = body;
+				*p++ = 0;
+				*p++ = PSI_ATSC_EVENTS;
+				for ( e = 0; e<PSI_ATSC_EVENTS; e++ )
+				{
+					int event = k*PSI_ATSC_EVENTS+e;
+					unsigned long start = 1000000000+event*1800;
+					unsigned char* len;
+					*p++ = 0xc0 | (event>>8); *p++ = event&0xff;
+					*p++ = (unsigned char)(start>>24); *p++ = (unsigned char)(start>>16); *p++ = (unsigned char)(start>>8); *p++ = (unsigned char)start;
+					*p++ = 0xc0 | 0x10; *p++ = 1800>>8; *p++ = 1800&0xff;
+					len = p++;
+					snprintf( text, sizeof(text), "Program %d-%d%s", i, event, k == 0 && nVersion ? " (updated)" : "" );
+					p = PsiAtscString( p, text );
+					*len = (unsigned char)(p-len-1);
+					*p++ = 0xf0; *p++ = 0;
+				}
+				Packetize( &b->mux, PSI_EIT_PID+k, section, PsiSection( section, 0xcb, i+1, k == 0 ? nVersion : 0, body, (int)(p-body) ), 0 );
+				b->sections++;
+			}
+		}
+		for ( k = 0; k<PSI_ATSC_EIT; k++ )
+			for ( i = 0; i<PSI_SERVICES; i++ )
+				for ( e = 0; e<PSI_ATSC_EVENTS; e++ )
+				{
+					int event = k*PSI_ATSC_EVENTS+e;
+					unsigned long etm = ((unsigned long)(i+1)<<16) | (event<<2) | 0x2;
+					if ( slot != ( ( k*PSI_SERVICES+i )*PSI_ATSC_EVENTS+e )*PSI_SLOTS/(PSI_ATSC_EIT*PSI_SERVICES*PSI_ATSC_EVENTS) )
+						continue;
+					p = body;
+					*p++ = 0;
+					*p++ = (unsigned char)(etm>>24); *p++ = (unsigned char)(etm>>16); *p++ = (unsigned char)(etm>>8); *p++ = (unsigned char)etm;
+					snprintf( text, sizeof(text), "Episode %d of a series on channel %d, with a description of the plot "
+							  "that runs on for a while.", event, i );
+					p = PsiAtscString( p, text );
+					Packetize( &b->mux, PSI_ETT_PID+k, section, PsiSection( section, 0xcc, (i<<8)|event, 0, body, (int)(p-body) ), 0 );
+					b->sections++;
+				}
+	}
+}
+
+//replay a minute of carousel with continuity counters carried on, returns parse seconds
+static double PsiReplay( TS_EPG_PARSER* pParser, MUX_BUILDER* pMux, unsigned char* pCounter )
+{
+	unsigned long i, n;
+	double t = 0, t0;
+	for ( i = 0; i<pMux->bytes; i += n )
+	{
+		unsigned long k;
+		n = _MIN( PUSH_BLOCK_SIZE, pMux->bytes-i );
+		for ( k = i; k<i+n; k += TS_PACKET_LENGTH )
+		{
+			unsigned char* pkt = pMux->data+k;
+			int pid = ((pkt[1]&0x1f)<<8)|pkt[2];
+			pkt[3] = (pkt[3]&0xf0) | (pCounter[pid]++ & 0x0f);
+		}
+		t0 = cpu_sec( CLOCK_THREAD_CPUTIME_ID );
+		PushTSEPGPacketParser( pParser, pMux->data+i, (int)n );
+		t += cpu_sec( CLOCK_THREAD_CPUTIME_ID )-t0;
+	}
+	return t;
+}
+
+//EPG out of a cached run has to match the uncached one (nEpgRef)
+static unsigned long RunPsiCache( BENCH_DATA* pBench, int nFormat, int bCache, unsigned long nEpgRef )
+{
+	TS_EPG_PARSER* parser;
+	EIT_BENCH b;
+	SECTION_CACHE cache={0};
+	static unsigned char counter[0x2000];
+	double t = 0;
+	unsigned long bytes = 0, pid_bytes = 0;
+	int minute, version = -1, prev;
+
+	memset( &b, 0, sizeof(b) );
+	b.mux.size = 16*1024*1024;
+	b.mux.data = (unsigned char*)malloc( b.mux.size );
+	prev = SectionCacheEnable( bCache );
+	parser = CreateTSEPGParser( nFormat, nFormat == ATSC_STREAM ? TERRESTRIAL : 0 );
+	SectionCacheEnable( prev );
+	SetupTSEPGParserDump( parser, (DUMP)NullDumper, &pid_bytes, (DUMP)EitEPGDumper, &b );
+	for ( minute = 0; minute<PSI_MINUTES; minute++ )
+	{
+		if ( pBench->data != NULL )
+		{
+			MUX_BUILDER file={0};
+			file.data = pBench->data;
+			file.bytes = pBench->bytes - pBench->bytes%TS_PACKET_LENGTH;
+			if ( minute >= pBench->loops )
+				break;
+			t += PsiReplay( parser, &file, counter );
+			bytes += file.bytes;
+			continue;
+		}
+		if ( minute/30 != version )
+		{
+			version = minute/30;
+			if ( nFormat == ATSC_STREAM )
+				AtscPsiMinute( &b, version );
+			else
+				DvbPsiMinute( &b, version );
+		}
+		t += PsiReplay( parser, &b.mux, counter );
+		bytes += b.mux.bytes;
+	}
+	if ( parser->ts_filter->section_cache != NULL )
+		cache = *parser->ts_filter->section_cache;
+	printf( "%-6s %-6s %8.1f %10.1f %11.0f %9lu %9lu %9lu %10.1f %9lu %s\n", nFormat == ATSC_STREAM ? "atsc" : "dvb-t", 
+		    bCache ? "cache" : "none", bytes/1048576.0, t*1000, bytes/TS_PACKET_LENGTH/t, cache.hit, cache.miss, cache.num, 
+			cache.skipped_bytes/1048576.0, b.epg_num, bCache && b.epg_num != nEpgRef ? "EPG MISMATCH" : "" );
+	ReleaseTSEPGParser( parser );
+	free( b.mux.data );
+	return b.epg_num;
+}
+
+static int BenchPsiCache( BENCH_DATA* pBench, char* pFormat )
+{
+	int format, mismatch = 0;
+	if ( pBench->data != NULL )
+		printf( "%lu bytes of PSI stream file replayed %d times\n", pBench->bytes, pBench->loops );
+	else
+		printf( "an hour of PSI/SI of a %d services mux, DVB-T with 8 days EIT schedule, ATSC with EIT-0..3 and ETT\n", PSI_SERVICES );
+	printf( "%-6s %-6s %8s %10s %11s %9s %9s %9s %10s %9s\n", "mux", "cache", "MB", "parse ms", "packets/s", 
+		    "hits", "misses", "entries", "skipped MB", "EPG out" );
+	for ( format = DVB_STREAM; format >= ATSC_STREAM; format-- )
+	{
+		unsigned long epg_num;
+		if ( pFormat != NULL && strcmp( pFormat, format == ATSC_STREAM ? "atsc" : "dvb" ) )
+			continue;
+		epg_num = RunPsiCache( pBench, format, 0, 0 );
+		mismatch += RunPsiCache( pBench, format, 1, epg_num ) != epg_num;
+	}
+	return mismatch ? 1 : 0;
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////
+//ATSC Huffman: titles and descriptions coded with the A/65 tables and random strings decoded by the tree
+//walker and the table decoder, outputs compared; decode rate of each, and EIT/ETT rate of a first tune
+//sweep (every event new) through an ATSC EPG parser with each
+#define HUFF_STRINGS       20000
+#define HUFF_PAD           16			//tree walker reads up to 2 bytes past an escape at end
+#define HUFF_RANDOM        0x10
+#define HUFF_SWEEP_EIT     8			//EIT-0..7, a day
+#define HUFF_SWEEP_EVENTS  6
+
+typedef struct HUFF_CODE
+{
+	unsigned int bits;
+	int len;
+} HUFF_CODE;
+
+typedef struct HUFF_BENCH
+{
+	HUFF_CODE code[2][128][128];		//type, previous character, character
+	unsigned char* data;				//strings of a length byte, a type byte (0x10 on random strings) and HUFF_PAD
+										//bytes of padding
+	unsigned long bytes;
+	int strings;
+	unsigned long text_bytes;
+	unsigned long crc;					//of EPG strings of a sweep
+	unsigned long epg_num;
+} HUFF_BENCH;
+
+extern unsigned char title_huffman_tbl[];
+extern unsigned char program_huffman_tbl[];
+
+//codes of the tree of a previous character, trees of characters below 128 are 11 bits deep at most
+static void HuffCodes( unsigned char* pHuffman, HUFF_CODE* pCode, int nIndex, int nOffset, unsigned int lBits, int nLen )
+{
+	int b;
+	for ( b = 0; b<2; b++ )
+	{
+		unsigned char node = pHuffman[nIndex+nOffset+b];
+		if ( node & 0x80 )
+		{
+			pCode[node&0x7f].bits = (lBits<<1)|b;
+			pCode[node&0x7f].len = nLen+1;
+		} else
+			HuffCodes( pHuffman, pCode, nIndex, node*2, (lBits<<1)|b, nLen+1 );
+	}
+}
+
+static void HuffInitCodes( HUFF_BENCH* b )
+{
+	int t, c;
+	for ( t = 0; t<2; t++ )
+	{
+		unsigned char* huffman = t == 0 ? title_huffman_tbl : program_huffman_tbl;
+		for ( c = 0; c<128; c++ )
+			HuffCodes( huffman, b->code[t][c], (huffman[c*2]<<8)|huffman[c*2+1], 0, 0, 0 );
+	}
+}
+
+//encodes a text and its terminator, a character out of the previous character's tree is escaped
+static int HuffEncode( HUFF_BENCH* b, int nType, unsigned char* pOut, const char* pText )
+{
+	HUFF_CODE (*code)[128] = b->code[nType-1];
+	unsigned long long acc = 0;
+	int acc_bits = 0, bytes = 0, lch = 0, i, len = (int)strlen( pText );
+	for ( i = 0; i<=len; i++ )
+	{
+		int ch = (unsigned char)pText[i];
+		if ( ch < 128 && ch != 27 && code[lch][ch].len )
+		{
+			acc = (acc<<code[lch][ch].len)|code[lch][ch].bits;
+			acc_bits += code[lch][ch].len;
+		} else
+		{
+			acc = (acc<<code[lch][27].len)|code[lch][27].bits;
+			acc = (acc<<8)|ch;
+			acc_bits += code[lch][27].len+8;
+		}
+		while ( acc_bits >= 8 )
+		{
+			pOut[bytes++] = (unsigned char)(acc>>(acc_bits-8));
+			acc_bits -= 8;
+		}
+		lch = ch;
+	}
+	if ( acc_bits )
+		pOut[bytes++] = (unsigned char)(acc<<(8-acc_bits));
+	return bytes;
+}
+
+static void HuffText( char* pText, int nSize, unsigned int* pSeed, int nWords )
+{
+	static const char* words[] = { "the", "news", "at", "Eleven", "weather", "and", "sports", "of", "a", "family",
+		"Doctor", "Who", "in", "New", "York", "city", "detective", "investigates", "murder", "on", "wife", "her",
+		"finds", "secret", "Baseball", "Yankees", "vs.", "Red", "Sox", "live", "from", "(2009)", "comedy", "HD",
+		"episode", "friends", "his", "old", "school", "travel", "Paris", "cooking", "Chef's", "kitchen", "PBS" };
+	int i, pos = 0;
+	for ( i = 0; i<nWords && pos < nSize-16; i++ )
+	{
+		*pSeed = *pSeed*1103515245+12345;
+		pos += snprintf( pText+pos, nSize-pos, "%s%s", i ? " " : "", words[ (*pSeed>>16) % (sizeof(words)/sizeof(words[0])) ] );
+	}
+	if ( i > 2 && pos < nSize-1 )
+		pText[pos++] = '.';
+	pText[pos] = 0;
+}
+
+static void HuffCorpus( HUFF_BENCH* b, int nStrings )
+{
+	unsigned int seed = 1;
+	char text[512];
+	int i, k;
+	b->data = (unsigned char*)calloc( (unsigned long)nStrings*2*(2+255+HUFF_PAD), 1 );
+	b->bytes = 0;
+	for ( i = 0; i<nStrings*2; i++ )
+	{
+		unsigned char* p = b->data+b->bytes;
+		int type = 1+(i&1), len;
+		seed = seed*1103515245+12345;
+		if ( i % 4 < 2 )
+		{
+			//title of a few words, description of a sentence or two
+			HuffText( text, type == 1 ? 64 : 280, &seed, type == 1 ? 2+(seed>>16)%5 : 12+(seed>>16)%30 );
+			len = HuffEncode( b, type, p+2, text );
+			if ( len > 255 )
+				continue;
+			b->text_bytes += strlen( text );
+		} else
+		{
+			//random bits, escapes into characters past 127 and their trees
+			len = 1+(seed>>16)%255;
+			for ( k = 0; k<len; k++ )
+			{
+				seed = seed*1103515245+12345;
+				p[2+k] = (unsigned char)(seed>>16);
+			}
+		}
+		p[0] = len;
+		p[1] = type | ( i % 4 < 2 ? 0 : HUFF_RANDOM );
+		b->bytes += 2+len+HUFF_PAD;
+		b->strings++;
+	}
+}
+
+//compares decoders on every string at full and limited output sizes, returns mismatches
+static int HuffValidate( HUFF_BENCH* b, unsigned long* pRoundTrip )
+{
+	unsigned char out[2][ATSC_HUFFMAN_MAX_BYTES(255)];
+	unsigned long i;
+	int bad = 0, e, n[2], m, max_size[3] = { ATSC_HUFFMAN_MAX_BYTES(255), 256, 17 };
+	unsigned int seed = 7;
+	char text[512];
+	*pRoundTrip = 0;
+	for ( i = 0; i<b->bytes; )
+	{
+		unsigned char* p = b->data+i;
+		for ( m = 0; m<3; m++ )
+		{
+			for ( e = 0; e<2; e++ )
+			{
+				SetupATSCHuffmanEngine( e == 0 ? ATSC_HUFFMAN_TREE : ATSC_HUFFMAN_TABLE );
+				n[e] = UncompressATSCHuffman( p[1]&0x0f, out[e], max_size[m], p+2, p[0] );
+			}
+			if ( n[0] != n[1] || memcmp( out[0], out[1], n[0] ) )
+			{
+				if ( bad++ < 4 )
+					printf( "mismatch at string offset %lu type %d len %d size %d: tree %d bytes, table %d bytes\n",
+							i, p[1]&0x0f, p[0], max_size[m], n[0], n[1] );
+			}
+		}
+		i += 2+p[0]+HUFF_PAD;
+	}
+	//round trip of coded text
+	for ( i = 0; i<1000; i++ )
+	{
+		unsigned char coded[2048];
+		int type = 1+(i&1), len;
+		HuffText( text, 280, &seed, 2+i%40 );
+		len = HuffEncode( b, type, coded, text );
+		memset( coded+len, 0, HUFF_PAD );
+		if ( len > 255 )
+			continue;
+		n[1] = UncompressATSCHuffman( type, out[1], sizeof(out[1]), coded, len );
+		if ( n[1] == (int)strlen( text )+1 && !memcmp( out[1], text, n[1] ) )
+			(*pRoundTrip)++;
+		else
+		if ( bad++ < 4 )
+			printf( "round trip failed, type %d '%s'\n", type, text );
+	}
+	return bad;
+}
+
+//best of nLoops of decoding strings of a kind (0 coded text, HUFF_RANDOM) nPasses times
+static double HuffDecodeRate( HUFF_BENCH* b, int nKind, int nEngine, int nPasses, int nLoops, unsigned long* pOutBytes,
+							  int* pStrings )
+{
+	unsigned char out[ATSC_HUFFMAN_MAX_BYTES(255)];
+	double best = 0;
+	int l, k;
+	SetupATSCHuffmanEngine( nEngine );
+	for ( l = 0; l<nLoops; l++ )
+	{
+		unsigned long i, bytes = 0;
+		double t0, t;
+		*pStrings = 0;
+		t0 = now_sec( );
+		for ( i = 0; i<b->bytes; i += 2+b->data[i]+HUFF_PAD )
+		{
+			if ( ( b->data[i+1] & HUFF_RANDOM ) != nKind )
+				continue;
+			for ( k = 0; k<nPasses; k++ )
+				bytes += UncompressATSCHuffman( b->data[i+1]&0x0f, out, sizeof(out), b->data+i+2, b->data[i] );
+			(*pStrings)++;
+		}
+		t = now_sec( )-t0;
+		if ( best == 0 || t < best )
+			best = t;
+		*pOutBytes = bytes/nPasses;
+	}
+	return best;
+}
+
+static int HuffEPGDumper( void* pContext, void* pData, int nSize )
+{
+	HUFF_BENCH* b = (HUFF_BENCH*)pContext;
+	b->crc = b->crc*31 + CalTSCRC32( (unsigned char*)pData, nSize );
+	b->epg_num++;
+	return nSize;
+}
+
+static unsigned char* HuffString( HUFF_BENCH* b, unsigned char* p, int nType, const char* pText )
+{
+	*p++ = 1; memcpy( p, "eng", 3 ); p += 3;
+	*p++ = 1; *p++ = nType; *p++ = 0;
+	p[0] = HuffEncode( b, nType, p+1, pText );
+	return p+1+p[0];
+}
+
+//MGT, TVCT, a day of EIT and an ETT of every event of nServices channels, every event new to a parser
+static void HuffSweep( HUFF_BENCH* b, MUX_BUILDER* pMux, int nServices, unsigned long* pSections )
+{
+	unsigned char body[4096], section[4096+16], *p;
+	unsigned int seed = 3;
+	char text[512];
+	int i, k, e;
+	pMux->bytes = 0;
+	*pSections = 0;
+
+	p = body;
+	*p++ = 0;
+	*p++ = 0; *p++ = 2*HUFF_SWEEP_EIT;
+	for ( k = 0; k<2*HUFF_SWEEP_EIT; k++ )
+	{
+		int type = k < HUFF_SWEEP_EIT ? 0x100+k : 0x200+k-HUFF_SWEEP_EIT;
+		int pid  = k < HUFF_SWEEP_EIT ? PSI_EIT_PID+k : PSI_ETT_PID+k-HUFF_SWEEP_EIT;
+		*p++ = type>>8; *p++ = type&0xff;
+		*p++ = 0xe0|(pid>>8); *p++ = pid&0xff;
+		*p++ = 0xe0;
+		*p++ = 0; *p++ = 0; *p++ = 0x10; *p++ = 0;
+		*p++ = 0xf0; *p++ = 0;
+	}
+	*p++ = 0xf0; *p++ = 0;
+	Packetize( pMux, 0x1ffb, section, PsiSection( section, 0xc7, 0, 0, body, (int)(p-body) ), 0 );
+
+	p = body;
+	*p++ = 0;
+	*p++ = nServices;
+	for ( i = 0; i<nServices; i++ )
+	{
+		memset( p, 0, 32 );
+		p[1] = 'W'; p[3] = 'N'; p[5] = '0'+i/10; p[7] = '0'+i%10;
+		p[14] = 0xf0 | ((2+i/100)>>6);
+		p[15] = (((2+i/100)&0x3f)<<2) | ((i%100+1)>>8);
+		p[16] = (i%100+1)&0xff;
+		p[17] = 4;
+		p[22] = EIT_TSID>>8; p[23] = EIT_TSID&0xff;
+		p[24] = (0x100+i)>>8; p[25] = (0x100+i)&0xff;
+		p[26] = 0x0d;
+		p[27] = 0xc0 | 2;
+		p[28] = (i+1)>>8; p[29] = (i+1)&0xff;
+		p[30] = 0xfc; p[31] = 0;
+		p += 32;
+	}
+	*p++ = 0xfc; *p++ = 0;
+	Packetize( pMux, 0x1ffb, section, PsiSection( section, 0xc8, EIT_TSID, 0, body, (int)(p-body) ), 0 );
+
+	for ( k = 0; k<HUFF_SWEEP_EIT; k++ )
+		for ( i = 0; i<nServices; i++ )
+		{
+			p = body;
+			*p++ = 0;
+			*p++ = HUFF_SWEEP_EVENTS;
+			for ( e = 0; e<HUFF_SWEEP_EVENTS; e++ )
+			{
+				int event = k*HUFF_SWEEP_EVENTS+e;
+				unsigned long start = 1000000000+event*1800;
+				unsigned char* len;
+				*p++ = 0xc0 | (event>>8); *p++ = event&0xff;
+				*p++ = (unsigned char)(start>>24); *p++ = (unsigned char)(start>>16); *p++ = (unsigned char)(start>>8); *p++ = (unsigned char)start;
+				*p++ = 0xc0 | 0x10; *p++ = 1800>>8; *p++ = 1800&0xff;
+				len = p++;
+				HuffText( text, 64, &seed, 2+seed%4 );
+				p = HuffString( b, p, 1, text );
+				*len = (unsigned char)(p-len-1);
+				*p++ = 0xf0; *p++ = 0;
+			}
+			Packetize( pMux, PSI_EIT_PID+k, section, PsiSection( section, 0xcb, i+1, 0, body, (int)(p-body) ), 0 );
+			(*pSections)++;
+		}
+
+	for ( k = 0; k<HUFF_SWEEP_EIT; k++ )
+		for ( i = 0; i<nServices; i++ )
+			for ( e = 0; e<HUFF_SWEEP_EVENTS; e++ )
+			{
+				int event = k*HUFF_SWEEP_EVENTS+e;
+				unsigned long etm = ((unsigned long)(i+1)<<16) | (event<<2) | 0x2;
+				p = body;
+				*p++ = 0;
+				*p++ = (unsigned char)(etm>>24); *p++ = (unsigned char)(etm>>16); *p++ = (unsigned char)(etm>>8); *p++ = (unsigned char)etm;
+				HuffText( text, 280, &seed, 16+seed%20 );
+				p = HuffString( b, p, 2, text );
+				Packetize( pMux, PSI_ETT_PID+k, section, PsiSection( section, 0xcc, (i<<8)|event, 0, body, (int)(p-body) ), 0 );
+				(*pSections)++;
+			}
+}
+
+static double RunHuffSweep( HUFF_BENCH* b, MUX_BUILDER* pMux, int nEngine, int nLoops )
+{
+	double best = 0;
+	int l;
+	SetupATSCHuffmanEngine( nEngine );
+	for ( l = 0; l<nLoops; l++ )
+	{
+		TS_EPG_PARSER* parser;
+		unsigned long i, pid_bytes = 0;
+		double t0, t;
+		b->crc = 0;
+		b->epg_num = 0;
+		parser = CreateTSEPGParser( ATSC_STREAM, TERRESTRIAL );
+		SetupTSEPGParserDump( parser, (DUMP)NullDumper, &pid_bytes, (DUMP)HuffEPGDumper, b );
+		t0 = now_sec( );
+		for ( i = 0; i<pMux->bytes; i += PUSH_BLOCK_SIZE )
+			PushTSEPGPacketParser( parser, pMux->data+i, (int)_MIN( PUSH_BLOCK_SIZE, pMux->bytes-i ) );
+		t = now_sec( )-t0;
+		ReleaseTSEPGParser( parser );
+		if ( best == 0 || t < best )
+			best = t;
+	}
+	return best;
+}
+
+static int BenchHuffman( BENCH_DATA* pBench, int nServices )
+{
+	HUFF_BENCH* b = (HUFF_BENCH*)calloc( 1, sizeof(HUFF_BENCH) );
+	MUX_BUILDER mux={0};
+	unsigned long round_trip, out_bytes, sections, crc[2], epg_num[2];
+	double t_tree, t_sweep[2];
+	int e, bad, kind, strings, engine = ATSCHuffmanEngine( );
+
+	if ( nServices <= 0 || nServices > 30 )
+		nServices = 30;
+	HuffInitCodes( b );
+	HuffCorpus( b, HUFF_STRINGS );
+	bad = HuffValidate( b, &round_trip );
+	printf( "%d strings (half titles and descriptions of %lu bytes of text coded with A/65 tables, half random), "
+		    "%d mismatches, %lu of 1000 texts round trip\n", b->strings, b->text_bytes, bad, round_trip );
+
+	printf( "%-7s %-12s %10s %10s %8s\n", "strings", "decoder", "ns/string", "MB/s out", "speedup" );
+	for ( kind = 0; kind<=HUFF_RANDOM; kind += HUFF_RANDOM )
+	{
+		const char* kind_name = kind ? "random" : "text";
+		t_tree = HuffDecodeRate( b, kind, ATSC_HUFFMAN_TREE, 2, pBench->loops, &out_bytes, &strings );
+		printf( "%-7s %-12s %10.0f %10.1f %8.2f\n", kind_name, "tree 2-pass", t_tree*1e9/strings, out_bytes/t_tree/1048576.0, 1.0 );
+		for ( e = ATSC_HUFFMAN_TREE; e<=ATSC_HUFFMAN_TABLE; e++ )
+		{
+			double t = HuffDecodeRate( b, kind, e, 1, pBench->loops, &out_bytes, &strings );
+			printf( "%-7s %-12s %10.0f %10.1f %8.2f\n", kind_name, ATSCHuffmanEngineName( e ), t*1e9/strings,
+				    out_bytes/t/1048576.0, t_tree/t );
+		}
+	}
+
+	mux.size = 8*1024*1024;
+	mux.data = (unsigned char*)malloc( mux.size );
+	HuffSweep( b, &mux, nServices, &sections );
+	printf( "first tune sweep of %d channels, %lu EIT/ETT sections, %.1f MB\n", nServices, sections, mux.bytes/1048576.0 );
+	printf( "%-14s %10s %10s %10s\n", "decoder", "sects/s", "EPG out", "EPG crc" );
+	for ( e = ATSC_HUFFMAN_TREE; e<=ATSC_HUFFMAN_TABLE; e++ )
+	{
+		t_sweep[e] = RunHuffSweep( b, &mux, e, pBench->loops > 1 ? pBench->loops : 20 );
+		crc[e] = b->crc;
+		epg_num[e] = b->epg_num;
+		printf( "%-14s %10.0f %10lu %10lx\n", ATSCHuffmanEngineName( e ), sections/t_sweep[e], epg_num[e], crc[e] );
+	}
+	if ( crc[0] != crc[1] || epg_num[0] != epg_num[1] )
+	{
+		printf( "EPG output of decoders differs\n" );
+		bad++;
+	}
+	SetupATSCHuffmanEngine( engine );
+	free( mux.data );
+	free( b->data );
+	free( b );
+	return bad ? 1 : 0;
+}
+
+//seek: keyframe index sidecar of a PS recording. A synthetic MPEG2 PS recording is written with its index,
+//then cold cache seeks to random times by bitrate estimation and re-sync against an index lookup.
+#define SEEK_BITRATE     16000000
+#define SEEK_GOP         15
+#define SEEK_PACK        2048
+#define SEEK_BLOCK       (64*1024)
+#define SEEK_WINDOW      54000			//0.6s, a GOP is 0.5s
+#define SEEK_POOL        (4*1024*1024)
+
+typedef struct SEEK_WRITER
+{
+	FILE* fp;
+	unsigned char* out;
+	int out_bytes;
+	ULONGLONG pos;
+	void* index;
+	ULONGLONG index_ns;
+	unsigned char* pool;
+	unsigned long pool_pos;
+} SEEK_WRITER;
+
+static void SeekFlush( SEEK_WRITER* w )
+{
+	ULONGLONG t;
+	fwrite( w->out, 1, w->out_bytes, w->fp );
+	t = now_ns( );
+	PushRecordIndexData( w->index, w->out, w->out_bytes );
+	w->index_ns += now_ns( ) - t;
+	w->out_bytes = 0;
+}
+
+static void SeekPackHeader( unsigned char* p, ULONGLONG lPos )
+{
+	ULONGLONG scr = lPos*8*27000000/SEEK_BITRATE, base = scr/300;
+	unsigned long ext = (unsigned long)(scr%300), mux_rate = SEEK_BITRATE/400;
+	p[0] = 0; p[1] = 0; p[2] = 1; p[3] = 0xba;
+	p[4] = 0x44 | (unsigned char)((base>>27)&0x38) | (unsigned char)((base>>28)&0x03);
+	p[5] = (unsigned char)(base>>20);
+	p[6] = 0x04 | (unsigned char)((base>>12)&0xf8) | (unsigned char)((base>>13)&0x03);
+	p[7] = (unsigned char)(base>>5);
+	p[8] = 0x04 | (unsigned char)((base<<3)&0xf8) | (unsigned char)(ext>>7);
+	p[9] = 0x01 | (unsigned char)(ext<<1);
+	p[10] = (unsigned char)(mux_rate>>14); p[11] = (unsigned char)(mux_rate>>6); p[12] = (unsigned char)(mux_rate<<2)|0x03;
+	p[13] = 0xf8;
+}
+
+//one frame (or an audio frame) in 2048 bytes packs, PTS on the first PES
+static void SeekPackFrame( SEEK_WRITER* w, int nStreamId, unsigned char* pHead, int nHeadBytes, int nBytes, unsigned long lPTS )
+{
+	int first = 1;
+	while ( nBytes > 0 )
+	{
+		unsigned char* p;
+		int hdr = first ? 14 : 9, payload = SEEK_PACK-14-hdr, pad = 0;
+		if ( w->out_bytes + SEEK_PACK > 1024*1024 )
+			SeekFlush( w );
+		p = w->out + w->out_bytes;
+		SeekPackHeader( p, w->pos );
+		p += 14;
+		if ( payload > nBytes )
+		{
+			pad = payload - nBytes;
+			payload = nBytes;
+		}
+		if ( first )
+			PackPES( p, nStreamId, p, 0, lPTS );
+		else
+		{
+			p[0] = 0; p[1] = 0; p[2] = 1; p[3] = nStreamId; p[6] = 0x80; p[7] = 0; p[8] = 0;
+		}
+		if ( pad <= 16 ) //stuffing bytes, a padding packet fills more
+			p[8] += pad;
+		p[4] = (unsigned char)((hdr-6+(pad<=16?pad:0)+payload)>>8);
+		p[5] = (unsigned char)(hdr-6+(pad<=16?pad:0)+payload);
+		p += hdr;
+		if ( pad <= 16 )
+		{
+			memset( p, 0xff, pad );
+			p += pad;
+		} else
+		{
+			unsigned char* q = p+payload;
+			q[0] = 0; q[1] = 0; q[2] = 1; q[3] = 0xbe; q[4] = (unsigned char)((pad-6)>>8); q[5] = (unsigned char)(pad-6);
+			memset( q+6, 0xff, pad-6 );
+		}
+		if ( nHeadBytes > 0 )
+		{
+			int n = nHeadBytes < payload ? nHeadBytes : payload;
+			memcpy( p, pHead, n );
+			pHead += n; nHeadBytes -= n;
+			p += n; nBytes -= n; payload -= n;
+		}
+		if ( w->pool_pos + payload > SEEK_POOL )
+			w->pool_pos = 0;
+		memcpy( p, w->pool+w->pool_pos, payload );
+		w->pool_pos += payload+1;
+		nBytes -= payload;
+		w->out_bytes += SEEK_PACK;
+		w->pos += SEEK_PACK;
+		first = 0;
+	}
+}
+
+static ULONGLONG SeekPTS( const unsigned char* p )
+{
+	return ((ULONGLONG)((p[0]>>1)&0x07)<<30) | (p[1]<<22) | ((p[2]>>1)<<15) | (p[3]<<7) | (p[4]>>1);
+}
+
+//video PTS after each pack in a block, the GOP start (pack offset in block) of the first sequence header
+//at or before lTarget; returns first PTS, 0 if there's none
+static ULONGLONG SeekScanBlock( const unsigned char* pData, int nBytes, ULONGLONG lTarget,
+								int* pGopPos, ULONGLONG* pGopPTS, ULONGLONG* pLastPTS )
+{
+	ULONGLONG first = 0;
+	int i;
+	*pGopPos = -1;
+	*pLastPTS = 0;
+	for ( i = 0; i+14+14+4 <= nBytes; i++ )
+	{
+		const unsigned char* p = pData+i;
+		ULONGLONG pts;
+		if ( p[0] || p[1] || p[2] != 1 || p[3] != 0xba || p[14] || p[15] || p[16] != 1 || p[17] != 0xe0 || !(p[21] & 0x80) )
+			continue;
+		pts = SeekPTS( p+23 );
+		if ( !first ) first = pts;
+		*pLastPTS = pts;
+		if ( p[28] == 0 && p[29] == 0 && p[30] == 1 && p[31] == 0xb3 && pts <= lTarget )
+		{
+			*pGopPos = i;
+			*pGopPTS = pts;
+		}
+		i += SEEK_PACK-1;
+	}
+	return first;
+}
+
+static int SeekRead( int fd, ULONGLONG lPos, unsigned char* pBuf, int* pReads )
+{
+	(*pReads)++;
+	return (int)pread( fd, pBuf, SEEK_BLOCK, (off_t)lPos );
+}
+
+//seek without index: bitrate estimate, secant steps until a block starts a little before the target, then
+//forward to the last GOP start at or before the target, backward if the GOP starts before the landing block
+static ULONGLONG SeekByEstimate( int fd, ULONGLONG lSize, ULONGLONG lFirstPTS, ULONGLONG lLastPTS, ULONGLONG lTarget,
+								 unsigned char* pBuf, int* pReads )
+{
+	double rate = (double)lSize/(lLastPTS-lFirstPTS);
+	LONGLONG pos = (LONGLONG)( ((LONGLONG)(lTarget-lFirstPTS) - SEEK_WINDOW/2)*rate ), start;
+	ULONGLONG gop_pos = 0, gop_pts, last_pts, pts;
+	int i, n, gop, found = 0;
+	for ( i = 0; i<32; i++ )
+	{
+		LONGLONG err;
+		if ( pos > (LONGLONG)(lSize-SEEK_BLOCK) ) pos = lSize-SEEK_BLOCK;
+		if ( pos < 0 ) pos = 0;
+		pos -= pos % SEEK_PACK;
+		n = SeekRead( fd, pos, pBuf, pReads );
+		pts = SeekScanBlock( pBuf, n, 0, &gop, &gop_pts, &last_pts );
+		err = (LONGLONG)lTarget - (LONGLONG)pts;
+		if ( pts && err >= 0 && err < SEEK_WINDOW )
+			break;
+		pos += (LONGLONG)( ( err - SEEK_WINDOW/2 )*rate );
+	}
+	start = pos;
+	for ( ;; )
+	{
+		pts = SeekScanBlock( pBuf, n, lTarget, &gop, &gop_pts, &last_pts );
+		if ( gop >= 0 )
+		{
+			gop_pos = pos+gop;
+			found = 1;
+		}
+		if ( ( pts && last_pts > lTarget ) || pos + n >= (LONGLONG)lSize )
+			break;
+		pos += SEEK_BLOCK;
+		n = SeekRead( fd, pos, pBuf, pReads );
+	}
+	for ( pos = start; !found && pos > 0; )
+	{
+		pos = pos > SEEK_BLOCK ? pos-SEEK_BLOCK : 0;
+		n = SeekRead( fd, pos, pBuf, pReads );
+		SeekScanBlock( pBuf, n, lTarget, &gop, &gop_pts, &last_pts );
+		if ( gop >= 0 )
+		{
+			gop_pos = pos+gop;
+			found = 1;
+		}
+	}
+	return gop_pos;
+}
+
+static int CompareUll( const void* a, const void* b )
+{
+	ULONGLONG x = *(ULONGLONG*)a, y = *(ULONGLONG*)b;
+	return x < y ? -1 : x > y;
+}
+
+static void SeekDropCache( int fd )
+{
+	posix_fadvise( fd, 0, 0, POSIX_FADV_DONTNEED );
+}
+
+static void PrintSeekRow( const char* pName, ULONGLONG* pNs, int nSeeks, unsigned long lReads )
+{
+	ULONGLONG total = 0;
+	int i;
+	for ( i = 0; i<nSeeks; i++ ) total += pNs[i];
+	qsort( pNs, nSeeks, sizeof(ULONGLONG), CompareUll );
+	printf( "%-9s avg %8.3f ms  p50 %8.3f ms  p99 %8.3f ms  max %8.3f ms  reads/seek %6.2f\n", pName,
+			total/1e6/nSeeks, pNs[nSeeks/2]/1e6, pNs[nSeeks*99/100]/1e6, pNs[nSeeks-1]/1e6, (double)lReads/nSeeks );
+}
+
+static int BenchSeek( char* pFileName, ULONGLONG lBytes, int nSeeks )
+{
+	static unsigned char seq_hdr[]={ 0x00,0x00,0x01,0xb3, 0x78,0x04,0x38, 0x34, 0xff,0xff,0xe0,0x18,
+	                                 0x00,0x00,0x01,0xb8, 0x00,0x08,0x00,0x40,
+	                                 0x00,0x00,0x01,0x00, 0x00,0x08 };
+	SEEK_WRITER w={0};
+	char index_name[1024];
+	unsigned char head[sizeof(seq_hdr)], *buf;
+	int frame_bytes = SEEK_BITRATE/8*1001/30000, frame = 0, i, fd, bad = 0;
+	ULONGLONG first_pts, last_pts, *est_ns, *idx_ns, t, t0, size;
+	unsigned long est_reads = 0, idx_reads = 0;
+	double write_sec;
+	void* reader;
+	RECORD_INDEX_ENTRY entry;
+
+	if ( lBytes == 0 ) lBytes = 10ULL*1024*1024*1024;
+	if ( nSeeks <= 1 ) nSeeks = 200;
+	if ( !RecordIndexFileName( pFileName, index_name, sizeof(index_name) ) )
+		return 1;
+	w.fp = fopen( pFileName, "wb" );
+	w.index = OpenRecordIndex( index_name );
+	if ( w.fp == NULL || w.index == NULL )
+	{
+		printf( "can't create %s or %s\n", pFileName, index_name );
+		return 1;
+	}
+	w.out = malloc( 1024*1024 );
+	w.pool = malloc( SEEK_POOL+SEEK_PACK );
+	srand( 1 );
+	for ( i = 0; i<SEEK_POOL+SEEK_PACK; i++ )
+		w.pool[i] = (unsigned char)( rand() | 0x01 );
+
+	//an I frame of 3 average frames each GOP, 0.5s; an audio pack a frame
+	t0 = now_ns( );
+	while ( w.pos + 4*frame_bytes < lBytes )
+	{
+		unsigned long pts = (unsigned long)( ( 90000 + (ULONGLONG)frame*3003 ) & 0x1ffffffffULL );
+		int type = frame % SEEK_GOP == 0 ? 1 : ( frame % 3 == 0 ? 2 : 3 );
+		int bytes = type == 1 ? frame_bytes*3 : frame_bytes*(SEEK_GOP-3)/(SEEK_GOP-1);
+		int temporal = frame % SEEK_GOP;
+		if ( type == 1 )
+		{
+			memcpy( head, seq_hdr, sizeof(seq_hdr) );
+			SeekPackFrame( &w, 0xe0, head, sizeof(seq_hdr), bytes, pts );
+		} else
+		{
+			memcpy( head, seq_hdr+20, 6 );
+			head[4] = (unsigned char)(temporal>>2);
+			head[5] = (unsigned char)(((temporal&3)<<6) | (type<<3));
+			SeekPackFrame( &w, 0xe0, head, 6, bytes, pts );
+		}
+		SeekPackFrame( &w, 0xc0, NULL, 0, SEEK_PACK-28, pts );
+		frame++;
+	}
+	SeekFlush( &w );
+	fflush( w.fp );
+	fdatasync( fileno( w.fp ) );
+	fclose( w.fp );
+	CloseRecordIndex( w.index );
+	write_sec = ( now_ns( ) - t0 )/1e9;
+	size = w.pos;
+	printf( "recording %s %.2f GB, %d frames (%.1f min), written %.1f MB/s\n", pFileName, size/1e9, frame,
+			frame*1001/30000.0/60, size/1e6/write_sec );
+	printf( "index %s: %.1f ms CPU in %.2f s write, %.2f%% of write time, %.0f MB/s parse\n", index_name,
+			w.index_ns/1e6, write_sec, w.index_ns/1e9*100/write_sec, size/1e6/(w.index_ns/1e9) );
+	free( w.out );
+	free( w.pool );
+
+	fd = open( pFileName, O_RDONLY );
+	buf = malloc( SEEK_BLOCK );
+	est_ns = malloc( sizeof(ULONGLONG)*nSeeks );
+	idx_ns = malloc( sizeof(ULONGLONG)*nSeeks );
+
+	//open: duration by the first and last blocks of the file against the index header
+	{
+		int gop, reads = 0;
+		ULONGLONG gop_pts, lp, open_ns;
+		SeekDropCache( fd );
+		t = now_ns( );
+		first_pts = SeekScanBlock( buf, SeekRead( fd, 0, buf, &reads ), 0, &gop, &gop_pts, &lp );
+		SeekScanBlock( buf, SeekRead( fd, size-SEEK_BLOCK, buf, &reads ), 0, &gop, &gop_pts, &last_pts );
+		open_ns = now_ns( ) - t;
+		i = open( index_name, O_RDONLY );
+		SeekDropCache( i );
+		close( i );
+		t = now_ns( );
+		reader = OpenRecordIndexReader( index_name );
+		t = now_ns( ) - t;
+		if ( reader == NULL )
+		{
+			printf( "can't open index %s\n", index_name );
+			return 1;
+		}
+		printf( "open      file ends %.3f ms, duration %.1f s;  index %.3f ms, %d entries, duration %.1f s\n",
+				open_ns/1e6, (last_pts-first_pts)/90000.0, t/1e6, RecordIndexEntryNum( reader ),
+				RecordIndexDuration( reader )/90000.0 );
+		if ( RecordIndexFirstPTS( reader ) != first_pts || RecordIndexLastPTS( reader ) < last_pts )
+		{
+			printf( "index PTS range differs from the file\n" );
+			bad++;
+		}
+	}
+
+	srand( 2 );
+	for ( i = 0; i<nSeeks; i++ )
+	{
+		unsigned long ms = (unsigned long)( 1000 + (double)rand()/RAND_MAX*( (last_pts-first_pts)/90 - 2000 ) );
+		ULONGLONG target = first_pts + (ULONGLONG)ms*90, est_pos;
+		int reads = 0, gop;
+		ULONGLONG gop_pts, lp;
+
+		SeekDropCache( fd );
+		t = now_ns( );
+		est_pos = SeekByEstimate( fd, size, first_pts, last_pts, target, buf, &reads );
+		est_ns[i] = now_ns( ) - t;
+		est_reads += reads;
+
+		SeekDropCache( fd );
+		t = now_ns( );
+		reads = 0;
+		if ( SeekRecordIndexTime( reader, ms, &entry ) >= 0 )
+			SeekRead( fd, entry.pos, buf, &reads );
+		idx_ns[i] = now_ns( ) - t;
+		idx_reads += reads;
+
+		SeekScanBlock( buf, SEEK_BLOCK, target, &gop, &gop_pts, &lp );
+		if ( entry.pos != est_pos || gop != 0 || gop_pts != entry.pts || !(entry.flags & INDEX_GOP_START) )
+		{
+			if ( bad++ < 5 )
+				printf( "seek %lu ms: estimate at %llu, index at %llu pts %llu\n", ms, est_pos, entry.pos, entry.pts );
+		}
+	}
+	printf( "%d cold cache seeks to random times:\n", nSeeks );
+	PrintSeekRow( "estimate", est_ns, nSeeks, est_reads );
+	PrintSeekRow( "index", idx_ns, nSeeks, idx_reads );
+	if ( bad )
+		printf( "%d seeks land on different GOPs\n", bad );
+
+	CloseRecordIndexReader( reader );
+	close( fd );
+	free( buf );
+	free( est_ns );
+	free( idx_ns );
+	return bad ? 1 : 0;
+}
+
+//library scan: AV-INF of every file of a directory as FormatParser asks for it, GetMediaAVFormat one file at a time
+//against GetMediaAVFormatBatch on a worker pool, page cache of the files dropped before each run
+#define MAX_AVINF_FILE   4096
+#define AVINF_SEARCH_SIZE (30*1024*1024)
+
+static int FileDumper( void* pContext, void* pData, int nSize )
+{
+	OUTPUT_DATA* output = (OUTPUT_DATA*)pData;
+	return (int)fwrite( output->data_ptr, 1, output->bytes, (FILE*)pContext );
+}
+
+static void AVInfSamples( char* pDir, int nFiles, unsigned long lBytes )
+{
+	BENCH_DATA mux={0};
+	char path[512];
+	FILE* fp;
+	int i;
+	for ( i = 0; i<nFiles; i++ )
+	{
+		BuildMux( &mux, 1+i%4, lBytes );
+		if ( i & 1 )
+		{
+			TUNE tune={0};
+			void* remuxer;
+			unsigned long offset = 0;
+			int expected_bytes;
+			snprintf( path, sizeof(path), "%s/sample%03d.mpg", pDir, i );
+			if ( ( fp = fopen( path, "wb" ) ) == NULL ) break;
+			tune.channel = 1;
+			remuxer = OpenRemuxStream( REMUX_STREAM, &tune, MPEG_TS, MPEG_PS, NULL, NULL, FileDumper, fp );
+			while ( offset < mux.bytes )
+			{
+				int bytes = (int)_MIN( PUSH_BLOCK_SIZE, mux.bytes - offset );
+				int used = PushRemuxStreamData( remuxer, mux.data+offset, bytes, &expected_bytes );
+				offset += used > 0 ? used : bytes;
+			}
+			FlushRemuxStream( remuxer );
+			CloseRemuxStream( remuxer );
+		} else
+		{
+			snprintf( path, sizeof(path), "%s/sample%03d.ts", pDir, i );
+			if ( ( fp = fopen( path, "wb" ) ) == NULL ) break;
+			fwrite( mux.data, 1, mux.bytes, fp );
+		}
+		fclose( fp );
+		free( mux.data );
+		mux.data = NULL;
+	}
+	if ( i < nFiles )
+		printf( "can't write sample files into %s\n", pDir );
+}
+
+static int AVInfFiles( char* pDir, char** pFiles, unsigned long* pSizes )
+{
+	DIR* dir;
+	struct dirent* ent;
+	struct stat st;
+	char path[512];
+	int n = 0;
+	if ( ( dir = opendir( pDir ) ) == NULL )
+		return 0;
+	while ( n < MAX_AVINF_FILE && ( ent = readdir( dir ) ) != NULL )
+	{
+		int len = (int)strlen( ent->d_name );
+		if ( len > 4 && !strcmp( ent->d_name+len-4, RECORD_INDEX_EXT ) )
+			continue;
+		snprintf( path, sizeof(path), "%s/%s", pDir, ent->d_name );
+		if ( stat( path, &st ) || !S_ISREG( st.st_mode ) || st.st_size == 0 )
+			continue;
+		pFiles[n] = strdup( path );
+		pSizes[n] = (unsigned long)_MIN( (ULONGLONG)st.st_size, AVINF_SEARCH_SIZE );
+		n++;
+	}
+	closedir( dir );
+	return n;
+}
+
+static void AVInfDropCache( char** pFiles, int nFiles )
+{
+	int i, fd;
+	for ( i = 0; i<nFiles; i++ )
+		if ( ( fd = open( pFiles[i], O_RDONLY ) ) >= 0 )
+		{
+			SeekDropCache( fd );
+			close( fd );
+		}
+}
+
+static int BenchAVInf( char* pDir, int nFiles, unsigned long lBytes, int nMaxThreads )
+{
+	static char* files[MAX_AVINF_FILE];
+	static unsigned long sizes[MAX_AVINF_FILE];
+	static int threads[]={ 1, 2, 4, 8, 16, 32 };
+	AVINF_BATCH_ITEM *serial, *batch;
+	double t, t_serial;
+	int n, i, k, mismatch = 0;
+
+	if ( nFiles > 0 )
+		AVInfSamples( pDir, _MIN( nFiles, MAX_AVINF_FILE ), lBytes ? lBytes : 32*1024*1024 );
+	if ( ( n = AVInfFiles( pDir, files, sizes ) ) == 0 )
+	{
+		printf( "no file in %s (-p<files> writes sample files)\n", pDir );
+		return 1;
+	}
+	if ( nMaxThreads <= 0 ) nMaxThreads = 16;
+	serial = calloc( n, sizeof(AVINF_BATCH_ITEM) );
+	batch  = calloc( n, sizeof(AVINF_BATCH_ITEM) );
+
+	AVInfDropCache( files, n );
+	t = now_sec( );
+	for ( i = 0; i<n; i++ )
+	{
+		serial[i].ret = GetMediaAVFormat( files[i], sizes[i], 0, -1, serial[i].format, sizeof(serial[i].format),
+				serial[i].duration, sizeof(serial[i].duration), &serial[i].total_channel );
+	}
+	t_serial = now_sec( )-t;
+	printf( "%d files, cold cache\n", n );
+	printf( "  serial          %8.3f s %8.1f files/s\n", t_serial, n/t_serial );
+
+	for ( k = 0; k<(int)(sizeof(threads)/sizeof(threads[0])) && threads[k] <= nMaxThreads; k++ )
+	{
+		int used, bad = 0;
+		for ( i = 0; i<n; i++ )
+		{
+			memset( &batch[i], 0, sizeof(AVINF_BATCH_ITEM) );
+			batch[i].file_name = files[i];
+			batch[i].check_size = sizes[i];
+			batch[i].channel = -1;
+		}
+		AVInfDropCache( files, n );
+		t = now_sec( );
+		used = GetMediaAVFormatBatch( batch, n, threads[k] );
+		t = now_sec( )-t;
+		for ( i = 0; i<n; i++ )
+		{
+			if ( batch[i].ret != serial[i].ret || batch[i].total_channel != serial[i].total_channel ||
+				 strcmp( batch[i].format, serial[i].format ) || strcmp( batch[i].duration, serial[i].duration ) )
+			{
+				if ( mismatch+bad < 5 )
+					printf( "  %s: batch %d %s %s, serial %d %s %s\n", files[i], batch[i].ret, batch[i].duration,
+							batch[i].format, serial[i].ret, serial[i].duration, serial[i].format );
+				bad++;
+			}
+		}
+		mismatch += bad;
+		printf( "  batch %2d threads %8.3f s %8.1f files/s  x%.2f%s\n", used, t, n/t, t_serial/t,
+				bad ? "  MISMATCH" : "" );
+	}
+	if ( mismatch )
+		printf( "%d AV-INF differ from serial probe\n", mismatch );
+
+	for ( i = 0; i<n; i++ )
+		free( files[i] );
+	free( serial );
+	free( batch );
+	return mismatch ? 1 : 0;
+}
+
+//livedur: a recording in progress polled for its duration. A synthetic TS recording, its PTS/PCR start a minute
+//before 33 bits wrap and jump an hour ahead in the middle, and its PS remux are appended a chunk at a time; after each
+//chunk the tracker and a full probe are asked for duration, bytes read and duration errors are compared.
+#define LIVE_PTS_START   (0x1ffffffffULL - 60*90000)
+#define LIVE_PTS_JUMP    (3600ULL*90000)
+
+static ULONGLONG ProcReadBytes( )
+{
+	char line[128];
+	ULONGLONG bytes = 0;
+	FILE* fp = fopen( "/proc/self/io", "r" );
+	if ( fp != NULL )
+	{
+		while ( fgets( line, sizeof(line), fp ) != NULL )
+			if ( !strncmp( line, "rchar:", 6 ) )
+				bytes = strtoull( line+6, NULL, 10 );
+		fclose( fp );
+	}
+	return bytes;
+}
+
+static ULONGLONG LiveRemap( ULONGLONG lPTS, int bJump )
+{
+	return ( lPTS + LIVE_PTS_START + ( bJump ? LIVE_PTS_JUMP : 0 ) ) & 0x1ffffffffULL;
+}
+
+static void LivePutPTS( unsigned char* p, ULONGLONG lPTS )
+{
+	p[0] = (p[0]&0xf0) | 0x01 | (unsigned char)((lPTS>>29)&0x0e);
+	p[1] = (unsigned char)(lPTS>>22);
+	p[2] = 0x01 | (unsigned char)((lPTS>>14)&0xfe);
+	p[3] = (unsigned char)(lPTS>>7);
+	p[4] = 0x01 | (unsigned char)((lPTS<<1)&0xfe);
+}
+
+//PTS and PCR of BuildMux output (PTS/DTS of its PS remux) moved to the wrap, the second half jumps
+static void LiveTimeline( BENCH_DATA* pBench, int bPS )
+{
+	unsigned long i;
+	if ( bPS )
+	{
+		for ( i = 0; i + 19 <= pBench->bytes; i++ )
+		{
+			unsigned char* p = pBench->data+i;
+			int jump = i >= pBench->bytes/2;
+			if ( p[0] || p[1] || p[2] != 1 || p[3] < 0xbd || ( p[6] & 0xc0 ) != 0x80 )
+				continue;
+			if ( p[7] & 0x80 )
+				LivePutPTS( p+9, LiveRemap( SeekPTS( p+9 ), jump ) );
+			if ( ( p[7] & 0xc0 ) == 0xc0 )
+				LivePutPTS( p+14, LiveRemap( SeekPTS( p+14 ), jump ) );
+			i += 8;
+		}
+		return;
+	}
+	for ( i = 0; i + TS_PACKET_LENGTH <= pBench->bytes; i += TS_PACKET_LENGTH )
+	{
+		unsigned char* p = pBench->data+i;
+		int off = 4, jump = i >= pBench->bytes/2;
+		if ( ( p[3] & 0x20 ) && p[4] >= 7 && ( p[5] & 0x10 ) )
+		{
+			ULONGLONG base = ((ULONGLONG)p[6]<<25)|(p[7]<<17)|(p[8]<<9)|(p[9]<<1)|(p[10]>>7);
+			base = LiveRemap( base, jump );
+			p[6] = (unsigned char)(base>>25); p[7] = (unsigned char)(base>>17);
+			p[8] = (unsigned char)(base>>9);  p[9] = (unsigned char)(base>>1);
+			p[10] = (unsigned char)((p[10]&0x7f)|((base&1)<<7));
+		}
+		if ( p[3] & 0x20 )
+			off += 1+p[4];
+		if ( ( p[1] & 0x40 ) && off+14 <= TS_PACKET_LENGTH && p[off] == 0 && p[off+1] == 0 && p[off+2] == 1 &&
+			 ( p[off+7] & 0x80 ) )
+			LivePutPTS( p+off+9, LiveRemap( SeekPTS( p+off+9 ), jump ) );
+	}
+}
+
+//frames of the recording that start in [*pPos, lBytes), *pPos moves to where next count starts
+static unsigned long LiveFrames( BENCH_DATA* pBench, int bPS, unsigned long* pPos, unsigned long lBytes )
+{
+	unsigned long i = *pPos, frames = 0;
+	if ( !bPS )
+	{
+		for ( ; i + TS_PACKET_LENGTH <= lBytes; i += TS_PACKET_LENGTH )
+		{
+			unsigned char* p = pBench->data+i;
+			int off = ( p[3] & 0x20 ) ? 5+p[4] : 4;
+			if ( ( p[1] & 0x40 ) && ((p[1]&0x1f)<<8|p[2]) == PROGRAM_VIDEO_PID(0) && off+4 <= TS_PACKET_LENGTH &&
+				 p[off+3] == 0xe0 )
+				frames++;
+		}
+	} else
+	{
+		for ( ; i + 14 <= lBytes; i++ )
+		{
+			unsigned char* p = pBench->data+i;
+			if ( p[0] == 0 && p[1] == 0 && p[2] == 1 && p[3] == 0xe0 && ( p[7] & 0x80 ) )
+			{
+				frames++;
+				i += 13;
+			}
+		}
+	}
+	*pPos = i;
+	return frames;
+}
+
+typedef struct LIVE_BUF
+{
+	unsigned char* data;
+	unsigned long  bytes;
+	unsigned long  size;
+} LIVE_BUF;
+
+static int LiveBufDumper( void* pContext, void* pData, int nSize )
+{
+	LIVE_BUF* b = (LIVE_BUF*)pContext;
+	OUTPUT_DATA* output = (OUTPUT_DATA*)pData;
+	if ( b->bytes + output->bytes > b->size )
+	{
+		b->size = ( b->bytes + output->bytes )*2;
+		b->data = realloc( b->data, b->size );
+	}
+	memcpy( b->data+b->bytes, output->data_ptr, output->bytes );
+	b->bytes += output->bytes;
+	return output->bytes;
+}
+
+static double LiveSeconds( const char* pDuration )
+{
+	return hs_long_long( (char*)pDuration )/10000000.0;
+}
+
+static int RunLiveDuration( BENCH_DATA* pBench, int bPS, char* pFileName, int nPolls )
+{
+	unsigned long chunk = pBench->bytes/nPolls, written = 0, frame_pos = 0, frames = 0;
+	ULONGLONG live_read = 0, full_read = 0, r;
+	double live_t = 0, full_t = 0, live_err = 0, full_err = 0, t;
+	char format[2048], duration[32];
+	int i, total, live_bad = 0;
+	FILE* fp;
+
+	if ( ( fp = fopen( pFileName, "wb" ) ) == NULL )
+	{
+		printf( "can't open file %s\n", pFileName );
+		return 1;
+	}
+	ReleaseLiveDuration( NULL );
+	printf( "%s recording %lu bytes, %d polls of %lu bytes\n", bPS ? "PS" : "TS", pBench->bytes, nPolls, chunk );
+	printf( "  poll     truth      tracker  err       bytes      full probe  err       bytes\n" );
+	for ( i = 0; i<nPolls; i++ )
+	{
+		double truth, live, full;
+		unsigned long n = i == nPolls-1 ? pBench->bytes-written : chunk;
+		fwrite( pBench->data+written, 1, n, fp );
+		fflush( fp );
+		written += n;
+		frames += LiveFrames( pBench, bPS, &frame_pos, written );
+		truth = ( frames - 1 )*3003/90000.0;
+
+		r = ProcReadBytes( );
+		t = now_sec( );
+		GetLiveMediaAVFormat( pFileName, _MIN( written, AVINF_SEARCH_SIZE ), -1, format, sizeof(format),
+							  duration, sizeof(duration), &total );
+		live_t += now_sec( )-t;
+		live = LiveSeconds( duration );
+		r = ProcReadBytes( )-r;
+		live_read += r;
+		if ( fabs( live-truth ) > live_err ) live_err = fabs( live-truth );
+		if ( fabs( live-truth ) > 1.0 ) live_bad++;
+
+		{
+			ULONGLONG rf = ProcReadBytes( );
+			t = now_sec( );
+			GetMediaAVFormat( pFileName, _MIN( written, AVINF_SEARCH_SIZE ), 1, -1, format, sizeof(format),
+							  duration, sizeof(duration), &total );
+			full_t += now_sec( )-t;
+			full = LiveSeconds( duration );
+			rf = ProcReadBytes( )-rf;
+			full_read += rf;
+			if ( fabs( full-truth ) > full_err ) full_err = fabs( full-truth );
+			if ( i % (nPolls/10 ? nPolls/10 : 1) == 0 || i == nPolls-1 )
+				printf( "  %4d %9.2f %12.2f %+8.2f %9llu %12.2f %+8.2f %9llu\n", i, truth, live, live-truth, r,
+						full, full-truth, rf );
+		}
+	}
+	fclose( fp );
+	printf( "  per call: tracker %8.1f KB read %7.3f ms, max error %.2f s\n", live_read/1024.0/nPolls,
+			live_t*1000/nPolls, live_err );
+	printf( "            full    %8.1f KB read %7.3f ms, max error %.2f s\n", full_read/1024.0/nPolls,
+			full_t*1000/nPolls, full_err );
+	ReleaseLiveDuration( NULL );
+	unlink( pFileName );
+	return live_bad ? 1 : 0;
+}
+
+static int BenchLiveDuration( char* pDir, unsigned long lBytes, int nPolls )
+{
+	BENCH_DATA ts={0}, rec={0};
+	LIVE_BUF ps={0};
+	TUNE tune={0};
+	void* remuxer;
+	char path[512];
+	int ret;
+
+	if ( nPolls <= 1 ) nPolls = 200;
+	BuildMux( &ts, 1, lBytes ? lBytes : 64*1024*1024 );
+	tune.channel = 1;
+	remuxer = OpenRemuxStream( REMUX_STREAM, &tune, MPEG_TS, MPEG_PS, NULL, NULL, LiveBufDumper, &ps );
+	PushAll( remuxer, &ts );
+	FlushRemuxStream( remuxer );
+	CloseRemuxStream( remuxer );
+
+	LiveTimeline( &ts, 0 );
+	snprintf( path, sizeof(path), "%s/live.ts", pDir );
+	ret = RunLiveDuration( &ts, 0, path, nPolls );
+	free( ts.data );
+
+	rec.data = ps.data;
+	rec.bytes = ps.bytes;
+	LiveTimeline( &rec, 1 );
+	snprintf( path, sizeof(path), "%s/live.mpg", pDir );
+	ret |= RunLiveDuration( &rec, 1, path, nPolls );
+	free( rec.data );
+	if ( ret )
+		printf( "tracker duration is off by more than 1s\n" );
+	return ret;
+}
+
+//startcode: start code and sync word searches of AVFormat parsers on StartCodeScan engines against the byte loops the
+//parsers had. Every match of random and sync-dense buffers of all lengths and alignments has to be the same, then
+//throughput of each format on the file (a capture) or on a synthetic buffer of -m MB with sync words planted.
+#define SC_PS_STREAM_ID(x) ( (x) == 0xB9 || (x) == 0xBA || (x) == 0xBB || (x) == 0xBC || (x) == 0xBE || IS_PES_STREAM_ID(x) )
+
+typedef const unsigned char* (*SC_SEARCH)( const unsigned char* pData, int nBytes );
+typedef struct SC_FORMAT
+{
+	const char* name;
+	SC_SEARCH old_search;
+	SC_SEARCH new_search;
+	unsigned char plant[8];     //a match planted into test buffers
+	int plant_bytes;
+} SC_FORMAT;
+
+//the old loop, a code ending at the last byte isn't taken
+static const unsigned char* OldMPEGStartCode( const unsigned char* pData, int nBytes, unsigned long StartCode )
+{
+	unsigned int code;
+	if ( nBytes < 4 )
+		return NULL;
+	code = 0xffffff00 |*pData++;
+	while ( --nBytes )
+	{
+		if ( code == StartCode )
+			return pData - 4;
+		code = (( code << 8 )| *pData++ );
+	}
+	return NULL;
+}
+
+static const unsigned char* OldMpeg2( const unsigned char* p, int n ) { return OldMPEGStartCode( p, n, 0x000001B3 ); }
+static const unsigned char* NewMpeg2( const unsigned char* p, int n ) { return SearchMPEGStartCode( p, n, 0x000001B3 ); }
+static const unsigned char* OldVC1( const unsigned char* p, int n ) { return OldMPEGStartCode( p, n, 0x0000010F ); }
+static const unsigned char* NewVC1( const unsigned char* p, int n ) { return SearchMPEGStartCode( p, n, 0x0000010F ); }
+
+static const unsigned char* OldH264( const unsigned char* p, int n )
+{
+	int i, zero_bytes = 0;
+	for ( i = 0; i<n; i++ )
+	{
+		if ( p[i] == 0 )
+			zero_bytes++;
+		if ( zero_bytes >= 3 && p[i] )
+			return p+i;
+		if ( p[i] ) zero_bytes = 0;
+	}
+	return NULL;
+}
+static const unsigned char* NewH264( const unsigned char* p, int n ) { return SearchZeroRunEnd( p, n, 3 ); }
+
+static const unsigned char* OldPS( const unsigned char* pData, int nBytes )
+{
+	unsigned long code;
+	if ( nBytes < 4 )
+		return NULL;
+	code = 0xffffff00 |*pData++;
+	while ( --nBytes )
+	{
+		if ( ( (code&0x00ffffff)==0x01 ) && SC_PS_STREAM_ID( *(pData) ) )
+			return pData-3;
+		code = (( code << 8 )| *pData++ );
+	}
+	return NULL;
+}
+static const unsigned char* NewPS( const unsigned char* p, int n )
+{
+	const unsigned char* end = p+n;
+	while ( (p = SearchStartCode( p, (int)(end-p), -1 )) != NULL )
+	{
+		if ( SC_PS_STREAM_ID( p[3] ) )
+			return p;
+		p++;
+	}
+	return NULL;
+}
+
+static const unsigned char* OldAC3( const unsigned char* p, int n )
+{
+	int i;
+	for ( i = 0; i<n-1; i++ )
+		if ( ( p[i] == 0x0B && p[i+1] == 0x77 ) || ( p[i] == 0x77 && p[i+1] == 0x0B ) )
+			return p+i;
+	return NULL;
+}
+static const unsigned char* NewAC3( const unsigned char* p, int n )
+{
+	static const unsigned short sync[2] = { 0x0B77, 0x770B };
+	return SearchSyncWord( p, n, sync, 2, 0xffff );
+}
+
+static int DTSSyncAt( const unsigned char* p )
+{
+	return ( p[0] == 0xff && p[1] == 0x1f && p[2] == 0x00 && p[3] == 0xe8 && (p[4] & 0xf0) == 0xf0 && p[5] == 0x07 ) ||
+		   ( p[0] == 0x1f && p[1] == 0xff && p[2] == 0xe8 && p[3] == 0x00 && p[4] == 0x07 && (p[5] & 0xf0) == 0xf0 ) ||
+		   ( p[0] == 0x7f && p[1] == 0xfe && p[2] == 0x80 && p[3] == 0x01 && (p[4] & 0xfc) == 0xfc ) ||
+		   ( p[0] == 0xfe && p[1] == 0x7f && p[2] == 0x01 && p[3] == 0x80 );
+}
+static const unsigned char* OldDTS( const unsigned char* p, int n )
+{
+	int i;
+	for ( i = 0; i+6<=n; i++ )
+		if ( DTSSyncAt( p+i ) )
+			return p+i;
+	return NULL;
+}
+static const unsigned char* NewDTS( const unsigned char* p, int n )
+{
+	static const unsigned short sync[4] = { 0xff1f, 0x1fff, 0x7ffe, 0xfe7f };
+	const unsigned char* end = p+n;
+	while ( (p = SearchSyncWord( p, (int)(end-p)-4, sync, 4, 0xffff )) != NULL )
+	{
+		if ( DTSSyncAt( p ) )
+			return p;
+		p++;
+	}
+	return NULL;
+}
+
+static const unsigned char* OldMpa( const unsigned char* p, int n )
+{
+	int i;
+	for ( i = 0; i<n-2; i++ )
+		if ( p[i] == 0xff && ( p[i+1] & 0xf0 ) == 0xf0 && ( p[i+2] & 0xf0 ) != 0xf0 )
+			return p+i;
+	return NULL;
+}
+static const unsigned char* NewMpa( const unsigned char* p, int n )
+{
+	static const unsigned short sync = 0xfff0;
+	const unsigned char* end = p+n;
+	while ( (p = SearchSyncWord( p, (int)(end-p)-1, &sync, 1, 0xfff0 )) != NULL )
+	{
+		if ( ( p[2] & 0xf0 ) != 0xf0 )
+			return p;
+		p++;
+	}
+	return NULL;
+}
+
+static const unsigned char* OldLOAS( const unsigned char* p, int n )
+{
+	int i = 0;
+	while ( i < n-1 && !(p[i] == 0x56 && ((p[i+1] & 0xE0)==0xE0 )) )
+		i++;
+	return i < n-1 ? p+i : NULL;
+}
+static const unsigned char* NewLOAS( const unsigned char* p, int n )
+{
+	static const unsigned short sync = 0x56e0;
+	return SearchSyncWord( p, n, &sync, 1, 0xffe0 );
+}
+
+static const unsigned char sc_pattern[6] = { 0x00, 0x00, 0x01, 0xb3, 0x77, 0x0b };
+//_search_data_ of Remuxer, it skipped its last position too
+static const unsigned char* OldBytes( const unsigned char* p, int n )
+{
+	int i;
+	for ( i = 0; i<n+1-(int)sizeof(sc_pattern); i++ )
+		if ( !memcmp( sc_pattern, p+i, sizeof(sc_pattern) ) )
+			return p+i;
+	return NULL;
+}
+static const unsigned char* NewBytes( const unsigned char* p, int n ) { return SearchBytes( p, n, sc_pattern, sizeof(sc_pattern) ); }
+
+static int OldNAL2RBSP( const unsigned char* src, unsigned char* dst, int size )
+{
+	int si=0, di=0;
+	while ( si<size )
+	{
+		if ( si+2<size && src[si]==0 && src[si+1]==0 && src[si+2]==3 )
+		{
+			dst[di++] = 0;
+			dst[di++] = 0;
+			si += 3;
+			continue;
+		}
+		dst[di++] = src[si++];
+	}
+	return di;
+}
+
+static SC_FORMAT sc_formats[] = {
+	{ "mpeg2",  OldMpeg2, NewMpeg2, { 0x00, 0x00, 0x01, 0xb3 }, 4 },
+	{ "vc1",    OldVC1,   NewVC1,   { 0x00, 0x00, 0x01, 0x0f }, 4 },
+	{ "h264",   OldH264,  NewH264,  { 0x00, 0x00, 0x00, 0x01, 0x67 }, 5 },
+	{ "ps",     OldPS,    NewPS,    { 0x00, 0x00, 0x01, 0xe0 }, 4 },
+	{ "ac3",    OldAC3,   NewAC3,   { 0x0b, 0x77 }, 2 },
+	{ "dts",    OldDTS,   NewDTS,   { 0x7f, 0xfe, 0x80, 0x01, 0xfc }, 5 },
+	{ "mpa",    OldMpa,   NewMpa,   { 0xff, 0xfd, 0x90 }, 3 },
+	{ "loas",   OldLOAS,  NewLOAS,  { 0x56, 0xe5 }, 2 },
+	{ "bytes",  OldBytes, NewBytes, { 0x00, 0x00, 0x01, 0xb3, 0x77, 0x0b }, 6 },
+};
+#define SC_FORMAT_NUM  (int)(sizeof(sc_formats)/sizeof(sc_formats[0]))
+
+//bytes of sync words and start codes half of the time, matches and near misses are everywhere
+static void SCDenseData( unsigned char* p, int n )
+{
+	static const unsigned char alphabet[] = { 0x00, 0x00, 0x00, 0x00, 0x01, 0x03, 0x0b, 0x77, 0x7f, 0xfe, 0x80, 0xff,
+											  0x1f, 0xe8, 0x07, 0xf0, 0xfc, 0x56, 0xe0, 0xb3, 0x0f, 0xba, 0xfd, 0x90 };
+	int i;
+	for ( i = 0; i<n; i++ )
+		p[i] = ( rand() & 1 ) ? alphabet[rand()%sizeof(alphabet)] : (unsigned char)rand();
+}
+
+static int SCSameMatches( SC_FORMAT* f, const unsigned char* p, int n, int* pMatches )
+{
+	const unsigned char *pos = p, *a, *b;
+	for ( ;; )
+	{
+		a = f->old_search( pos, (int)(p+n-pos) );
+		b = f->new_search( pos, (int)(p+n-pos) );
+		if ( a != b )
+			return 0;
+		if ( a == NULL )
+			return 1;
+		(*pMatches)++;
+		pos = a+1;
+	}
+}
+
+static int SCVerify( int nEngine )
+{
+	unsigned char *buf = malloc( 4096+64+8 ), *out[2];
+	int f, i, bad = 0, matches = 0;
+	out[0] = malloc( 4096+64 );
+	out[1] = malloc( 2*4096+64 );
+	srand( 11 );
+	for ( f = 0; f<=SC_FORMAT_NUM; f++ )
+		for ( i = 0; i<20000; i++ )
+		{
+			int len = i < 512 ? i : rand()%4096, offset = rand()%64, n;
+			unsigned char* p = buf+offset;
+			if ( i & 1 )
+				SCDenseData( p, len+8 );
+			else
+				for ( n = 0; n<len+8; n++ )
+					p[n] = (unsigned char)rand();
+			if ( f == SC_FORMAT_NUM )
+			{
+				//emulation prevention, a whole buffer into another one and in place
+				n = OldNAL2RBSP( p, out[0], len );
+				memcpy( out[1], p, len );
+				if ( RemoveEmulationPrevention( p, len, out[1]+len ) != n || memcmp( out[1]+len, out[0], n ) ||
+					 RemoveEmulationPrevention( out[1], len, out[1] ) != n || memcmp( out[1], out[0], n ) )
+				{
+					if ( bad++ < 8 )
+						printf( "MISMATCH %s epb len:%d offset:%d\n", StartCodeEngineName( nEngine ), len, offset );
+				}
+				continue;
+			}
+			//a match at a random place and one ending at the last byte
+			if ( len >= sc_formats[f].plant_bytes )
+			{
+				memcpy( p+rand()%(len-sc_formats[f].plant_bytes+1), sc_formats[f].plant, sc_formats[f].plant_bytes );
+				if ( i & 2 )
+					memcpy( p+len-sc_formats[f].plant_bytes, sc_formats[f].plant, sc_formats[f].plant_bytes );
+			}
+			if ( !SCSameMatches( &sc_formats[f], p, len, &matches ) )
+			{
+				if ( bad++ < 8 )
+					printf( "MISMATCH %s %s len:%d offset:%d\n", StartCodeEngineName( nEngine ), sc_formats[f].name, len, offset );
+			}
+		}
+	free( out[0] );
+	free( out[1] );
+	free( buf );
+	return bad;
+}
+
+static double SCScanRate( SC_FORMAT* f, int bOld, BENCH_DATA* pBench, unsigned long* pMatches )
+{
+	const unsigned char *end = pBench->data+pBench->bytes, *p;
+	double best = 0, t0, t;
+	int l;
+	for ( l = 0; l<pBench->loops; l++ )
+	{
+		*pMatches = 0;
+		t0 = now_sec( );
+		for ( p = pBench->data; ( p = bOld ? f->old_search( p, (int)(end-p) ) : f->new_search( p, (int)(end-p) ) ) != NULL; p++ )
+			(*pMatches)++;
+		t = now_sec( )-t0;
+		if ( best == 0 || t < best )
+			best = t;
+	}
+	return best;
+}
+
+static double SCEpbRate( int bOld, BENCH_DATA* pBench, unsigned char* pOut, int* pBytes )
+{
+	double best = 0, t0, t;
+	int l;
+	for ( l = 0; l<pBench->loops; l++ )
+	{
+		t0 = now_sec( );
+		*pBytes = bOld ? OldNAL2RBSP( pBench->data, pOut, (int)pBench->bytes ) :
+						 RemoveEmulationPrevention( pBench->data, (int)pBench->bytes, pOut );
+		t = now_sec( )-t0;
+		if ( best == 0 || t < best )
+			best = t;
+	}
+	return best;
+}
+
+static int BenchStartCode( BENCH_DATA* pBench, int bHasFile, unsigned long lBytes )
+{
+	unsigned char* out;
+	unsigned long matches[2];
+	double t_old, t, mb;
+	int e, f, bad = 0, bytes[2] = { 0, 0 }, engine = StartCodeEngine( );
+
+	if ( bHasFile )
+	{
+		//old loops read a byte past the end
+		pBench->data = realloc( pBench->data, pBench->bytes+64 );
+		memset( pBench->data+pBench->bytes, 0xff, 64 );
+	} else
+	{
+		unsigned long i;
+		//compressed payload with a sync word or a start code of each format planted every 2KB
+		pBench->bytes = lBytes ? lBytes : 16*1024*1024;
+		pBench->data = malloc( pBench->bytes+64 );
+		srand( 3 );
+		for ( i = 0; i<pBench->bytes+64; i++ )
+			pBench->data[i] = (unsigned char)rand();
+		for ( i = 0; i+2048 <= pBench->bytes; i += 2048 )
+		{
+			SC_FORMAT* fmt = &sc_formats[(i/2048)%SC_FORMAT_NUM];
+			memcpy( pBench->data+i+rand()%1024, fmt->plant, fmt->plant_bytes );
+		}
+		printf( "synthetic %lu bytes\n", pBench->bytes );
+	}
+	if ( pBench->loops < 3 ) pBench->loops = 3;
+
+	for ( e = START_CODE_SCALAR; e<=START_CODE_NEON; e++ )
+	{
+		int n;
+		SetupStartCodeEngine( e );
+		if ( StartCodeEngine( ) != e )
+			continue;
+		n = SCVerify( e );
+		printf( "verify %-8s %s\n", StartCodeEngineName( e ), n ? "FAILED" : "passed" );
+		bad += n;
+	}
+
+	mb = pBench->bytes/1048576.0;
+	printf( "%-7s %-8s %10s %10s %8s\n", "format", "search", "matches", "MB/s", "speedup" );
+	for ( f = 0; f<SC_FORMAT_NUM; f++ )
+	{
+		t_old = SCScanRate( &sc_formats[f], 1, pBench, &matches[0] );
+		printf( "%-7s %-8s %10lu %10.1f %8.2f\n", sc_formats[f].name, "old loop", matches[0], mb/t_old, 1.0 );
+		for ( e = START_CODE_SCALAR; e<=START_CODE_NEON; e++ )
+		{
+			SetupStartCodeEngine( e );
+			if ( StartCodeEngine( ) != e )
+				continue;
+			t = SCScanRate( &sc_formats[f], 0, pBench, &matches[1] );
+			printf( "%-7s %-8s %10lu %10.1f %8.2f%s\n", sc_formats[f].name, StartCodeEngineName( e ), matches[1], mb/t, t_old/t,
+				    matches[1] != matches[0] ? "  MISMATCH" : "" );
+			bad += matches[1] != matches[0];
+		}
+	}
+	out = malloc( pBench->bytes );
+	t_old = SCEpbRate( 1, pBench, out, &bytes[0] );
+	printf( "%-7s %-8s %10d %10.1f %8.2f\n", "epb", "old loop", (int)pBench->bytes-bytes[0], mb/t_old, 1.0 );
+	for ( e = START_CODE_SCALAR; e<=START_CODE_NEON; e++ )
+	{
+		SetupStartCodeEngine( e );
+		if ( StartCodeEngine( ) != e )
+			continue;
+		t = SCEpbRate( 0, pBench, out, &bytes[1] );
+		printf( "%-7s %-8s %10d %10.1f %8.2f%s\n", "epb", StartCodeEngineName( e ), (int)pBench->bytes-bytes[1], mb/t, t_old/t,
+			    bytes[1] != bytes[0] ? "  MISMATCH" : "" );
+		bad += bytes[1] != bytes[0];
+	}
+	free( out );
+	SetupStartCodeEngine( engine );
+	return bad ? 1 : 0;
+}
+
+//channel change to first byte of live TV. At each change the tuner thread opens a new recording, tunes for
+//20-200ms and streams LIVETV_RATE in capture reads of LIVETV_CHUNK. The reader starts once the recording is
+//set up, as playback does, and reads all of it: polling the file size every 100ms as MediaServer does or every
+//10ms and pread, against a TimeShiftReader woken by its eventfd reading the shared data window. Reader CPU
+//is taken on its thread, the data it gets are checked against the tuner's.
+#define LIVETV_RATE       (20*1000*1000/8)
+#define LIVETV_CHUNK      (188*348)
+#define LIVETV_STREAM_MS  500
+
+typedef struct LIVETV_BENCH
+{
+	char  file_name[512];
+	unsigned char* data;
+	unsigned long  data_bytes;
+	int   tune_ms;
+	volatile int started;
+	volatile int done;
+	double first_write;			//the first chunk is handed to the writer
+	ULONGLONG bytes;
+	unsigned long checksum;
+} LIVETV_BENCH;
+
+static unsigned long StreamSum( unsigned long lSum, ULONGLONG lPos, const unsigned char* pData, int nBytes )
+{
+	int i;
+	for ( i = 0; i<nBytes; i++ )
+		lSum = lSum*31 + pData[i] + (unsigned char)( lPos+i );
+	return lSum;
+}
+
+static void* LiveTVTuner( void* pContext )
+{
+	LIVETV_BENCH* b = (LIVETV_BENCH*)pContext;
+	void* ts = OpenTimeShiftFile( b->file_name, 0, TIMESHIFT_SHARED_DATA );
+	unsigned long offset = 0;
+	double t0;
+	__atomic_store_n( &b->started, 1, __ATOMIC_RELEASE );
+	usleep( b->tune_ms*1000 );
+	t0 = now_sec( );
+	while ( ts != NULL && now_sec( ) - t0 < LIVETV_STREAM_MS/1000.0 )
+	{
+		double due;
+		if ( offset + LIVETV_CHUNK > b->data_bytes )
+			offset = 0;
+		if ( b->bytes == 0 )
+			b->first_write = now_sec( );
+		WriteTimeShiftData( ts, b->data + offset, LIVETV_CHUNK );
+		FlushTimeShiftFile( ts );
+		b->checksum = StreamSum( b->checksum, b->bytes, b->data + offset, LIVETV_CHUNK );
+		b->bytes += LIVETV_CHUNK;
+		offset += LIVETV_CHUNK;
+		due = t0 + (double)b->bytes/LIVETV_RATE - now_sec( );
+		if ( due > 0 )
+			usleep( (useconds_t)( due*1e6 ) );
+	}
+	__atomic_store_n( &b->done, 1, __ATOMIC_RELEASE );
+	CloseTimeShiftFile( ts );
+	return NULL;
+}
+
+//poll_ms 0 is the TimeShiftReader, returns the time the first byte is seen
+static double LiveTVReader( LIVETV_BENCH* b, int nPollMs, unsigned long* pChecksum, int* pWakeups )
+{
+	static unsigned char buf[LIVETV_CHUNK*8];
+	ULONGLONG pos = 0;
+	double first = 0;
+	void* reader = NULL;
+	int fd;
+	while ( !__atomic_load_n( &b->started, __ATOMIC_ACQUIRE ) )
+		usleep( 1000 );
+	if ( ( fd = open( b->file_name, O_RDONLY ) ) < 0 )
+		return 0;
+	if ( nPollMs == 0 && ( reader = OpenTimeShiftReader( b->file_name ) ) == NULL )
+	{
+		close( fd );
+		return 0;
+	}
+	for ( ;; )
+	{
+		int done = __atomic_load_n( &b->done, __ATOMIC_ACQUIRE );
+		ULONGLONG end;
+		if ( reader != NULL )
+			end = WaitTimeShiftData( reader, pos, 1000 );
+		else
+		{
+			struct stat st;
+			end = fstat( fd, &st ) == 0 ? (ULONGLONG)st.st_size : pos;
+		}
+		(*pWakeups)++;
+		if ( end > pos && first == 0 )
+			first = now_sec( );
+		while ( pos < end )
+		{
+			const unsigned char* data;
+			int n = reader != NULL ? PeekTimeShiftData( reader, pos, &data ) : -1;
+			if ( n > 0 && TimeShiftDataValid( reader, pos ) )
+			{
+				*pChecksum = StreamSum( *pChecksum, pos, data, n );
+				if ( !TimeShiftDataValid( reader, pos ) )
+					break;
+			} else
+			{
+				//left the window, or a file reader
+				n = (int)pread( fd, buf, (size_t)_MIN( (ULONGLONG)sizeof(buf), end-pos ), (off_t)pos );
+				if ( n <= 0 )
+					break;
+				*pChecksum = StreamSum( *pChecksum, pos, buf, n );
+			}
+			pos += n;
+		}
+		if ( reader != NULL ? TimeShiftReaderClosed( reader ) && pos >= TimeShiftReaderPos( reader ) : done && pos >= b->bytes )
+			break;
+		if ( reader == NULL )
+			usleep( nPollMs*1000 );
+	}
+	CloseTimeShiftReader( reader );
+	close( fd );
+	return first;
+}
+
+static int BenchLiveTV( char* pDir, int nChanges )
+{
+	static const int poll_ms[] = { 100, 10, 0 };
+	LIVETV_BENCH b;
+	unsigned char* data;
+	unsigned long data_bytes = 4*1024*1024, j, seed = 1;
+	int k, i, bad = 0;
+
+	if ( nChanges <= 1 ) nChanges = 10;
+	data = malloc( data_bytes );
+	for ( j = 0; j<data_bytes; j++ )
+	{
+		seed = seed*1103515245 + 12345;
+		data[j] = ( j % 188 ) ? (unsigned char)( seed >> 16 ) : 0x47;
+	}
+	printf( "%d channel changes, %d Mbps for %d ms after a 20-200 ms tune\n", nChanges, LIVETV_RATE*8/1000000, LIVETV_STREAM_MS );
+	printf( "%-12s %12s %12s %12s %12s\n", "reader", "first ms", "max ms", "cpu ms/s", "wakeups/s" );
+	for ( k = 0; k<(int)(sizeof(poll_ms)/sizeof(poll_ms[0])); k++ )
+	{
+		double latency = 0, max_latency = 0, cpu = 0, stream = 0;
+		char name[32];
+		int wakeups = 0, mismatch = 0;
+		srand( 1 );
+		for ( i = 0; i<nChanges; i++ )
+		{
+			pthread_t thread;
+			unsigned long checksum = 0;
+			double t0, t1, c0, first;
+			memset( &b, 0, sizeof(b) );
+			snprintf( b.file_name, sizeof(b.file_name), "%s/tsbench-livetv-%d.ts", pDir, i );
+			b.data = data;
+			b.data_bytes = data_bytes;
+			b.tune_ms = 20 + rand( ) % 181;
+			c0 = cpu_sec( CLOCK_THREAD_CPUTIME_ID );
+			t0 = now_sec( );
+			pthread_create( &thread, NULL, LiveTVTuner, &b );
+			first = LiveTVReader( &b, poll_ms[k], &checksum, &wakeups );
+			pthread_join( thread, NULL );
+			t1 = now_sec( );
+			cpu += cpu_sec( CLOCK_THREAD_CPUTIME_ID ) - c0;
+			stream += t1 - t0;
+			if ( first > 0 )
+			{
+				latency += first - b.first_write;
+				max_latency = _MAX( max_latency, first - b.first_write );
+			}
+			mismatch += first == 0 || checksum != b.checksum;
+			unlink( b.file_name );
+		}
+		bad += mismatch;
+		if ( poll_ms[k] )
+			snprintf( name, sizeof(name), "poll %dms", poll_ms[k] );
+		else
+			snprintf( name, sizeof(name), "eventfd" );
+		printf( "%-12s %12.2f %12.2f %12.3f %12.1f%s\n", name, latency*1000/nChanges, max_latency*1000, cpu*1000/stream,
+			    wakeups/stream, mismatch ? "  DATA MISMATCH" : "" );
+	}
+	free( data );
+	return bad ? 1 : 0;
+}
+
+//DVB-C channel scan on recorded captures of each occupied frequency, <freq>.ts files of a directory, freq as its
+//NIT gives it (10Hz). Tuners are simulated: lock takes SCANSIM_LOCK_MS, an empty frequency costs the lock timeout,
+//a capture plays from a random position at SCANSIM_RATE and loops. The old scan walks the frequency table on a
+//tuner with the fixed waits of WaiteScanDone polled every 100ms; the scheduler stops a frequency once its tables
+//are complete, prunes the table by the NIT and spreads it on -t tuners.
+#define SCANSIM_RATE        (38*1000*1000/8)
+#define SCANSIM_LOCK_MS     300
+#define SCANSIM_TIMEOUT_MS  1500		//DVB-C lock timeout of Channel.c
+#define SCANSIM_FIRST_FREQ  11400000	//114-858MHz raster in 8MHz steps
+#define SCANSIM_FREQ_STEP   800000
+#define SCANSIM_FREQ_NUM    94
+#define SCANSIM_ONID        0x22d4
+#define SCANSIM_NID         0x3001
+#define SCANSIM_SERVICES    10
+#define SCANSIM_SLOTS       30			//100ms slots of a capture, a NIT cycle
+#define SCANSIM_MAX_CAPTURE 64
+#define SCANSIM_MAX_TUNERS  16
+
+typedef struct SCANSIM_CAPTURE
+{
+	unsigned long  freq;
+	unsigned char* data;
+	unsigned long  bytes;
+} SCANSIM_CAPTURE;
+
+typedef struct SCANSIM
+{
+	SCANSIM_CAPTURE capture[SCANSIM_MAX_CAPTURE];
+	int  capture_num;
+	TUNE freq[SCANSIM_FREQ_NUM+SCANSIM_MAX_CAPTURE];
+	int  freq_num;
+	unsigned int seed;
+	int  tuned;
+	int  locked;
+} SCANSIM;
+
+static unsigned long ScanSimFreq( int nTransport )
+{
+	return SCANSIM_FIRST_FREQ + (unsigned long)(2+4*nTransport)*SCANSIM_FREQ_STEP;
+}
+
+static int ScanSimSameFreq( unsigned long lFreq1, unsigned long lFreq2 )
+{
+	unsigned long diff = lFreq1 > lFreq2 ? lFreq1 - lFreq2 : lFreq2 - lFreq1;
+	return diff <= _MAX( lFreq1, lFreq2 )/2000;
+}
+
+static void ScanSimBCD( unsigned char* p, unsigned long lVal, int nBytes )
+{
+	int i;
+	for ( i = nBytes-1; i>=0; i-- )
+	{
+		BCD( p+i, (int)(lVal%100) );
+		lVal /= 100;
+	}
+}
+
+//NIT actual in two sections, odd transports in the second one
+static int ScanSimNit( unsigned char* pOut, int nTransports, int nSection )
+{
+	unsigned char body[1024], *p = body, *loop;
+	int t, k, len;
+	static const char name[] = "SimCable";
+	p[0] = 0xf0; p[1] = 2+sizeof(name)-1;
+	p[2] = 0x40; p[3] = sizeof(name)-1;
+	memcpy( p+4, name, sizeof(name)-1 );
+	p += 4+sizeof(name)-1;
+	loop = p;
+	p += 2;
+	for ( t = nSection; t<nTransports; t += 2 )
+	{
+		unsigned char* desc;
+		p[0] = (100+t)>>8; p[1] = (100+t)&0xff;
+		p[2] = SCANSIM_ONID>>8; p[3] = SCANSIM_ONID&0xff;
+		desc = p+6;
+		desc[0] = 0x41; desc[1] = SCANSIM_SERVICES*3;
+		for ( k = 0; k<SCANSIM_SERVICES; k++ )
+		{
+			int sid = (100+t)*16+k;
+			desc[2+k*3] = sid>>8; desc[3+k*3] = sid&0xff; desc[4+k*3] = 1;
+		}
+		desc += 2+SCANSIM_SERVICES*3;
+		desc[0] = 0x44; desc[1] = 11;
+		ScanSimBCD( desc+2, ScanSimFreq( t )/10, 4 );
+		desc[6] = 0xff; desc[7] = 0xf2;
+		desc[8] = 5; //256QAM
+		ScanSimBCD( desc+9, 6900, 3 ); //006.9000 MSym
+		desc[12] = 0x0f;
+		desc += 13;
+		len = (int)(desc-(p+6));
+		p[4] = 0xf0 | (len>>8); p[5] = len&0xff;
+		p = desc;
+	}
+	len = (int)(p-loop-2);
+	loop[0] = 0xf0 | (len>>8); loop[1] = len&0xff;
+	pOut[0] = 0; //pointer field
+	return 1+SectionVer( pOut+1, 0x40, SCANSIM_NID, 0, nSection, 1, body, (int)(p-body) );
+}
+
+//SDT actual in two sections, half of the services each
+static int ScanSimSdt( unsigned char* pOut, int nTsid, int nSection )
+{
+	unsigned char body[1024], *p = body;
+	int k;
+	p[0] = SCANSIM_ONID>>8; p[1] = SCANSIM_ONID&0xff; p[2] = 0xff;
+	p += 3;
+	for ( k = nSection; k<SCANSIM_SERVICES; k += 2 )
+	{
+		char provider[] = "Sim", name[16];
+		int sid = nTsid*16+k, name_len = snprintf( name, sizeof(name), "Sim %d-%d", nTsid, k );
+		int len = 2+2+(int)strlen(provider)+1+name_len;
+		p[0] = sid>>8; p[1] = sid&0xff; p[2] = 0xfc;
+		p[3] = 0x80 | (len>>8); p[4] = len&0xff;
+		p[5] = 0x48; p[6] = len-2; p[7] = 1;
+		p[8] = (unsigned char)strlen(provider);
+		memcpy( p+9, provider, strlen(provider) );
+		p += 9+strlen(provider);
+		p[0] = name_len;
+		memcpy( p+1, name, name_len );
+		p += 1+name_len;
+	}
+	pOut[0] = 0;
+	return 1+SectionVer( pOut+1, 0x42, nTsid, 0, nSection, 1, body, (int)(p-body) );
+}
+
+//a transport of SCANSIM_SERVICES services: PAT and PMTs every 100ms, SDT every second and NIT every 3 seconds in
+//two sections each, video packets of the services fill the rest
+static int ScanSimWrite( char* pDir, int nTransports )
+{
+	MUX_BUILDER *mux = calloc( 1, sizeof(MUX_BUILDER) );
+	unsigned char pat[1024], pmt[SCANSIM_SERVICES][256], sdt[2][1024], nit[2][1024], body[256], video[184];
+	int pat_bytes, pmt_bytes[SCANSIM_SERVICES], sdt_bytes[2], nit_bytes[2];
+	int packets = SCANSIM_RATE/10/TS_PACKET_LENGTH, t, k, slot;
+	char path[512];
+
+	mux->size = (unsigned long)SCANSIM_SLOTS*packets*TS_PACKET_LENGTH;
+	mux->data = malloc( mux->size );
+	memset( video, 0xff, sizeof(video) );
+	nit_bytes[0] = ScanSimNit( nit[0], nTransports, 0 );
+	nit_bytes[1] = ScanSimNit( nit[1], nTransports, 1 );
+	for ( t = 0; t<nTransports; t++ )
+	{
+		int tsid = 100+t;
+		FILE* fp;
+		body[0] = 0; body[1] = 0; body[2] = 0xe0 | (0x10>>8); body[3] = 0x10;
+		for ( k = 0; k<SCANSIM_SERVICES; k++ )
+		{
+			unsigned char pmt_body[32];
+			int sid = tsid*16+k;
+			body[4+k*4] = sid>>8; body[5+k*4] = sid&0xff;
+			body[6+k*4] = 0xe0 | (PROGRAM_PMT_PID( k )>>8); body[7+k*4] = PROGRAM_PMT_PID( k )&0xff;
+			pmt_body[0] = 0xe0 | (PROGRAM_VIDEO_PID( k )>>8); pmt_body[1] = PROGRAM_VIDEO_PID( k )&0xff;
+			pmt_body[2] = 0xf0; pmt_body[3] = 0;
+			pmt_body[4] = 2;
+			pmt_body[5] = 0xe0 | (PROGRAM_VIDEO_PID( k )>>8); pmt_body[6] = PROGRAM_VIDEO_PID( k )&0xff;
+			pmt_body[7] = 0xf0; pmt_body[8] = 0;
+			pmt_bytes[k] = PsiSection( pmt[k], 0x02, sid, 0, pmt_body, 9 );
+		}
+		pat_bytes = PsiSection( pat, 0x00, tsid, 0, body, 4+SCANSIM_SERVICES*4 );
+		sdt_bytes[0] = ScanSimSdt( sdt[0], tsid, 0 );
+		sdt_bytes[1] = ScanSimSdt( sdt[1], tsid, 1 );
+		mux->bytes = 0;
+		memset( mux->counter, 0, sizeof(mux->counter) );
+		for ( slot = 0; slot<SCANSIM_SLOTS; slot++ )
+		{
+			unsigned long slot_end = (unsigned long)(slot+1)*packets*TS_PACKET_LENGTH;
+			Packetize( mux, 0, pat, pat_bytes, 0 );
+			for ( k = 0; k<SCANSIM_SERVICES; k++ )
+				Packetize( mux, PROGRAM_PMT_PID( k ), pmt[k], pmt_bytes[k], 0 );
+			if ( slot % 10 == 0 || slot % 10 == 5 )
+				Packetize( mux, 0x11, sdt[slot%10 != 0], sdt_bytes[slot%10 != 0], 0 );
+			if ( slot % 30 == 0 || slot % 30 == 15 )
+				Packetize( mux, 0x10, nit[slot%30 != 0], nit_bytes[slot%30 != 0], 0 );
+			for ( k = 0; mux->bytes < slot_end; k++ )
+			{
+				unsigned char* p = mux->data + mux->bytes;
+				int pid = PROGRAM_VIDEO_PID( k%SCANSIM_SERVICES );
+				p[0] = TS_SYNC;
+				p[1] = pid>>8;
+				p[2] = pid&0xff;
+				p[3] = 0x10 | ( mux->counter[pid]++ & 0x0f );
+				memcpy( p+4, video, sizeof(video) );
+				mux->bytes += TS_PACKET_LENGTH;
+			}
+		}
+		snprintf( path, sizeof(path), "%s/%lu.ts", pDir, ScanSimFreq( t ) );
+		if ( ( fp = fopen( path, "wb" ) ) == NULL )
+		{
+			printf( "can't write %s\n", path );
+			free( mux->data );
+			free( mux );
+			return 0;
+		}
+		fwrite( mux->data, 1, mux->bytes, fp );
+		fclose( fp );
+	}
+	free( mux->data );
+	free( mux );
+	return 1;
+}
+
+static void ScanSimTune( TUNE* pTune, unsigned long lFreq )
+{
+	memset( pTune, 0, sizeof(TUNE) );
+	pTune->stream_format = DVB_STREAM;
+	pTune->sub_format = CABLE;
+	pTune->u.dvb.dvb_type = 2;
+	pTune->u.dvb.dvb.c.freq = lFreq;
+	pTune->u.dvb.dvb.c.symbol_rate = 6900;
+	pTune->u.dvb.dvb.c.modulation = 11;
+}
+
+//captures of the directory, the frequency table is the raster and the captures off the raster
+static int ScanSimLoad( SCANSIM* s, char* pDir )
+{
+	DIR* dir;
+	struct dirent* ent;
+	char path[512];
+	int i, j;
+	if ( ( dir = opendir( pDir ) ) == NULL )
+		return 0;
+	while ( s->capture_num < SCANSIM_MAX_CAPTURE && ( ent = readdir( dir ) ) != NULL )
+	{
+		BENCH_DATA data={0};
+		unsigned long freq;
+		char ext[8];
+		if ( sscanf( ent->d_name, "%lu.%7s", &freq, ext ) != 2 || strcmp( ext, "ts" ) )
+			continue;
+		snprintf( path, sizeof(path), "%s/%s", pDir, ent->d_name );
+		if ( !LoadFile( &data, path, 0 ) || data.bytes < TS_PACKET_LENGTH*16 )
+		{
+			free( data.data );
+			continue;
+		}
+		s->capture[s->capture_num].freq = freq;
+		s->capture[s->capture_num].data = data.data;
+		s->capture[s->capture_num].bytes = data.bytes - data.bytes%TS_PACKET_LENGTH;
+		s->capture_num++;
+	}
+	closedir( dir );
+	for ( i = 0; i<SCANSIM_FREQ_NUM; i++ )
+		ScanSimTune( &s->freq[s->freq_num++], SCANSIM_FIRST_FREQ+(unsigned long)i*SCANSIM_FREQ_STEP );
+	for ( i = 0; i<s->capture_num; i++ )
+	{
+		for ( j = 0; j<SCANSIM_FREQ_NUM; j++ )
+			if ( ScanSimSameFreq( s->freq[j].u.dvb.dvb.c.freq, s->capture[i].freq ) )
+				break;
+		if ( j == SCANSIM_FREQ_NUM )
+			ScanSimTune( &s->freq[s->freq_num++], s->capture[i].freq );
+	}
+	return s->capture_num;
+}
+
+//a tuner scans a frequency as WaiteScanDone does, returns simulated ms, *ppFilter the scan of a locked frequency
+static unsigned long ScanSimJob( SCANSIM* s, void* pSched, TUNE* pTune, int bComplete, SCAN_FILTER** ppFilter )
+{
+	SCANSIM_CAPTURE* capture = NULL;
+	SCAN_FILTER* filter;
+	TUNE_LIST* network;
+	unsigned long slice_ms = bComplete ? 10 : 100, slice, pos, elapsed, progress_ms = 0;
+	unsigned long timeout_ms = SCANSIM_TIMEOUT_MS;
+	int i, channel_num = 0, extended = 0;
+
+	*ppFilter = NULL;
+	s->tuned++;
+	for ( i = 0; i<s->capture_num; i++ )
+		if ( ScanSimSameFreq( s->capture[i].freq, pTune->u.dvb.dvb.c.freq ) )
+			capture = &s->capture[i];
+	if ( capture == NULL )
+		return SCANSIM_TIMEOUT_MS;
+	s->locked++;
+
+	filter = CreateScanFilter( );
+	StartChannelScan( filter, pTune );
+	if ( !bComplete )
+		ScanChannelNeedTables( filter, 0 );
+	else
+	if ( ( network = ScanSchedulerNetwork( pSched ) ) != NULL )
+		ScanChannelNetwork( filter, network );
+	else
+		ScanChannelNeedTables( filter, SCAN_TABLE_DEFAULT|SCAN_TABLE_NIT );
+
+	slice = SCANSIM_RATE/1000*slice_ms/TS_PACKET_LENGTH*TS_PACKET_LENGTH;
+	pos = (unsigned long)( rand_r( &s->seed ) % ( capture->bytes/TS_PACKET_LENGTH ) )*TS_PACKET_LENGTH;
+	for ( elapsed = slice_ms; ; elapsed += slice_ms )
+	{
+		unsigned long n = slice;
+		int state, num;
+		while ( n > 0 )
+		{
+			unsigned long bytes = _MIN( n, capture->bytes-pos );
+			ProcessScan( filter, capture->data+pos, (long)bytes );
+			pos += bytes;
+			if ( pos == capture->bytes )
+				pos = 0;
+			n -= bytes;
+		}
+		ScanChannelTimeClock( filter, SCANSIM_LOCK_MS+elapsed );
+		if ( ( state = ScanChannelState( filter ) ) > 0 )
+			break;
+		//more time once data come in, and when channels are found
+		if ( state == 0 && ( progress_ms += slice_ms ) > 800 && !extended )
+		{
+			timeout_ms += SCANSIM_TIMEOUT_MS/2;
+			extended = 1;
+		}
+		if ( ( num = ScanChannelNum( filter ) ) != channel_num )
+		{
+			timeout_ms += SCANSIM_TIMEOUT_MS;
+			channel_num = num;
+		}
+		if ( elapsed >= timeout_ms || elapsed >= 40000 )
+			break;
+	}
+	*ppFilter = filter;
+	return SCANSIM_LOCK_MS + elapsed;
+}
+
+//discrete event run of the tuners, returns simulated ms
+static unsigned long ScanSimRun( SCANSIM* s, void* pSched, int nTuners, int bComplete )
+{
+	unsigned long free_ms[SCANSIM_MAX_TUNERS]={0}, end_ms = 0;
+	SCAN_FILTER* filter[SCANSIM_MAX_TUNERS]={0};
+	int index[SCANSIM_MAX_TUNERS], busy[SCANSIM_MAX_TUNERS]={0};
+	int i, k;
+	for ( ;; )
+	{
+		TUNE tune;
+		//the earliest tuner, a scan finishing goes before a tuner getting free at the same time
+		for ( k = 0, i = 1; i<nTuners; i++ )
+			if ( free_ms[i] < free_ms[k] || ( free_ms[i] == free_ms[k] && busy[i] && !busy[k] ) )
+				k = i;
+		if ( busy[k] )
+		{
+			ScanTuneDone( pSched, index[k], filter[k] ? filter[k]->pScan : NULL );
+			if ( filter[k] )
+				ReleaseScanFilter( filter[k] );
+			filter[k] = NULL;
+			busy[k] = 0;
+			end_ms = _MAX( end_ms, free_ms[k] );
+			continue;
+		}
+		if ( ( index[k] = NextScanTune( pSched, k, &tune ) ) < 0 )
+		{
+			//scans in progress may add frequencies
+			int next = -1;
+			for ( i = 0; i<nTuners; i++ )
+				if ( busy[i] && ( next < 0 || free_ms[i] < free_ms[next] ) )
+					next = i;
+			if ( next < 0 )
+				break;
+			free_ms[k] = free_ms[next];
+			continue;
+		}
+		free_ms[k] += ScanSimJob( s, pSched, &tune, bComplete, &filter[k] );
+		busy[k] = 1;
+	}
+	return end_ms;
+}
+
+static int CompareChannelKey( const void* a, const void* b )
+{
+	ULONGLONG x = *(ULONGLONG*)a, y = *(ULONGLONG*)b;
+	return x < y ? -1 : x > y;
+}
+
+//onid/tsid/sid of channels found, sorted
+static int ScanSimChannels( void* pSched, ULONGLONG* pKeys, int nMax )
+{
+	CHANNEL_LIST* list = ScanSchedulerChannelList( pSched );
+	int i, n = 0;
+	for ( i = 0; i<list->channel_num && n<nMax; i++ )
+		pKeys[n++] = ((ULONGLONG)list->channel[i].u.dvb.onid<<32) | ((ULONGLONG)list->channel[i].u.dvb.tsid<<16) |
+					 list->channel[i].u.dvb.sid;
+	qsort( pKeys, n, sizeof(ULONGLONG), CompareChannelKey );
+	return n;
+}
+
+static int BenchScan( char* pDir, int nTransports, int nTuners )
+{
+	static const struct { const char* name; int complete; int flags; int multi_tuner; } policy[] = {
+		{ "fixed waits",     0, SCAN_SCHED_NIT_ADD, 0 },
+		{ "completion",      1, SCAN_SCHED_NIT_ADD, 0 },
+		{ "completion+NIT",  1, SCAN_SCHED_NIT_ADD|SCAN_SCHED_NIT_ONLY, 0 },
+		{ "completion+NIT",  1, SCAN_SCHED_NIT_ADD|SCAN_SCHED_NIT_ONLY, 1 },
+	};
+	SCANSIM* s = calloc( 1, sizeof(SCANSIM) );
+	ULONGLONG *keys = malloc( 4096*sizeof(ULONGLONG) ), *base_keys = malloc( 4096*sizeof(ULONGLONG) );
+	unsigned long base_ms = 0;
+	int k, i, base_num = 0, bad = 0;
+
+	if ( nTuners <= 0 ) nTuners = 4;
+	if ( nTuners > SCANSIM_MAX_TUNERS ) nTuners = SCANSIM_MAX_TUNERS;
+	if ( nTransports > (SCANSIM_FREQ_NUM-2)/4+1 ) nTransports = (SCANSIM_FREQ_NUM-2)/4+1;
+	if ( nTransports > 0 && !ScanSimWrite( pDir, nTransports ) )
+		return 1;
+	if ( !ScanSimLoad( s, pDir ) )
+	{
+		printf( "no <freq>.ts capture in %s\n", pDir );
+		free( s );
+		return 1;
+	}
+	printf( "%d captures, %d frequencies, lock %d ms, lock timeout %d ms, %d Mbps\n", s->capture_num, s->freq_num,
+		    SCANSIM_LOCK_MS, SCANSIM_TIMEOUT_MS, SCANSIM_RATE*8/1000000 );
+	printf( "%-16s %6s %6s %7s %8s %9s %10s %8s %8s\n", "scan", "tuners", "tuned", "locked", "skipped", "channels",
+		    "scan sec", "speedup", "cpu ms" );
+	for ( k = 0; k<(int)(sizeof(policy)/sizeof(policy[0])); k++ )
+	{
+		int tuners = policy[k].multi_tuner ? nTuners : 1, skipped, num;
+		void* sched = CreateScanScheduler( s->freq, s->freq_num, policy[k].flags );
+		unsigned long ms;
+		double c0 = cpu_sec( CLOCK_PROCESS_CPUTIME_ID );
+		s->seed = 1;
+		s->tuned = s->locked = 0;
+		ms = ScanSimRun( s, sched, tuners, policy[k].complete );
+		c0 = cpu_sec( CLOCK_PROCESS_CPUTIME_ID ) - c0;
+		ScanSchedulerState( sched, NULL, &skipped, NULL );
+		num = ScanSimChannels( sched, k ? keys : base_keys, 4096 );
+		if ( k == 0 )
+		{
+			base_num = num;
+			base_ms = ms;
+		}
+		i = k == 0 || ( num == base_num && !memcmp( keys, base_keys, num*sizeof(ULONGLONG) ) );
+		bad += !i;
+		printf( "%-16s %6d %6d %7d %8d %9d %10.1f %7.1fx %8.1f%s\n", policy[k].name, tuners, s->tuned, s->locked, skipped,
+			    num, ms/1000.0, ms ? (double)base_ms/ms : 0, c0*1000, i ? "" : "  CHANNEL MISMATCH" );
+		ReleaseScanScheduler( sched );
+	}
+	for ( i = 0; i<s->capture_num; i++ )
+		free( s->capture[i].data );
+	free( s );
+	free( keys );
+	free( base_keys );
+	return bad ? 1 : 0;
+}
+
+static void Usage( )
+{
+	puts( "Usage: tsbench <test> <file> [-n<loops>] [-m<max MB>]" );
+	puts( "  parse   TS parser packets/sec, remux of the first channel and filtering only (a channel not in the file)" );
+	puts( "  pidtbl  TS parser cost per packet on synthetic muxes of 1 to 64 programs (file is ignored, -m sets mux size)" );
+	puts( "  crc     verify CRC32 engines against byte table, sections/sec on EIT sections of the file" );
+	puts( "  probe   program search of a multi-program file, GetAVFormat per channel against one pass probe (-m sets search size)" );
+	puts( "  writer  recording write MB/s of -t<tuners> concurrent tuners into directory <file>, -m MB per tuner," );
+	puts( "          -c<MB> circular file size, -s<MB> fdatasync interval; stdio against RecordWriter engines" );
+	puts( "  timeshift time-shift ring files of -t<tuners> (default 16) into directory <file>, -m MB per tuner, -c<MB>" );
+	puts( "          ring size (default 16); old stdio fseek path against TimeShiftFile engines, write position poll cost" );
+	puts( "  livetv  channel change to first byte and reader CPU of live TV, -n<changes> recordings in directory <file>;" );
+	puts( "          file size polling every 100ms and 10ms against TimeShiftReader eventfd and shared data window" );
+	puts( "  ring    capture ring stress test and latency histogram, lock free spscRing against mutex guarded copy," );
+	puts( "          -m MB fed, -c<MB> ring size (file is ignored)" );
+	puts( "  split   record every program of a mux, remuxer per program against MuxSplitter on 0 to -t<threads> workers," );
+	puts( "          -p<programs> max channels, -d<dir> writes channel files; a synthetic mux when file can't be read" );
+	puts( "          (written to <dir>/mux.ts with -d)" );
+	puts( "  eitmem  24 hours of EIT into a DVB EPG parser, allocation rate, live bytes of memory tags and RSS with heap" );
+	puts( "          against slab arena; file is an EIT stream replayed each hour, else -p<services> synthetic EIT" );
+	puts( "          with -n<cycles> carousel cycles an hour" );
+	puts( "  eitstore DVB EIT event store, events/sec and memory of -n<cycles> carousel cycles (default 3) of an EIT" );
+	puts( "          stream file or of -p<services> synthetic services with 8 days schedule" );
+	puts( "  zerocopy TS->PS remux of a 20 Mbps H.264 program (file or synthetic, -m MB) into a batching writer," );
+	puts( "          copy writer against iovec writer holding ES blocks; copied bytes per output byte, -d<dir> writes files" );
+	puts( "  msgqueue EPG strings of an EIT sweep posted a message at a time on the tuner thread against the native" );
+	puts( "          message queue; file is an EIT stream replayed -n times, else -p<services> synthetic EIT of 24 hours" );
+	puts( "  psicache PSI/SI parse CPU of an hour of a DVB-T and of an ATSC mux with and without section cache; file is" );
+	puts( "          a PSI stream replayed -n times (-d<dvb|atsc> its format), else synthetic PSI/SI of 8 services" );
+	puts( "  huffman  ATSC Huffman tree walker against table decoder, outputs of coded and random strings compared," );
+	puts( "          decode rate, and EIT/ETT rate of a first tune sweep of -p<channels> (file is ignored)" );
+	puts( "  seek    writes a MPEG2 PS recording of -m MB (default 10GB) into file with its keyframe index, index CPU" );
+	puts( "          while writing, then -n<seeks> cold cache seeks by bitrate estimate and re-sync against the index" );
+	puts( "  avinf   AV-INF of every file of directory <file> as a library scan asks for it, one file at a time against" );
+	puts( "          batch probe on 1 to -t<threads> workers, cold cache; -p<files> writes sample TS/PS files of -m MB first" );
+	puts( "  livedur  a TS recording of -m MB (default 64) with PTS wrap and a jump, and its PS remux, appended into" );
+	puts( "          directory <file> in -n<polls> chunks; duration tracker against full probe, bytes read and errors" );
+	puts( "  startcode start code/sync word search of each AVFormat parser and emulation prevention removal, SIMD" );
+	puts( "          engines against old byte loops, verified on random buffers; MB/s on file or -m MB synthetic" );
+	puts( "  scan    DVB-C channel scan simulated on <freq>.ts captures of directory <file>, fixed waits against table" );
+	puts( "          completion, NIT pruning and -t<tuners> (default 4); -p<transports> writes synthetic captures first" );
+}
+
+int main( int argc, char* argv[] )
+{
+	BENCH_DATA bench={0};
+	unsigned long max_bytes = 0, circ_bytes = 0, sync_bytes = 0;
+	int tuners = 0, programs = 0;
+	char *test, *file, *dir = NULL;
+	int i, ret = 1;
+
+	if ( argc < 3 )
+	{
+		Usage( );
+		return 1;
+	}
+	test = argv[1];
+	file = argv[2];
+	bench.loops = 1;
+	for ( i = 3; i<argc; i++ )
+	{
+		if ( argv[i][0] == '-' )
+			switch ( argv[i][1] ) {
+			case 'n': bench.loops = atoi( argv[i]+2 ); break;
+			case 'm': max_bytes = strtoul( argv[i]+2, NULL, 10 )*1024*1024; break;
+			case 't': tuners = atoi( argv[i]+2 ); break;
+			case 'c': circ_bytes = strtoul( argv[i]+2, NULL, 10 )*1024*1024; break;
+			case 's': sync_bytes = strtoul( argv[i]+2, NULL, 10 )*1024*1024; break;
+			case 'p': programs = atoi( argv[i]+2 ); break;
+			case 'd': dir = argv[i]+2; break;
+			}
+	}
+	if ( bench.loops <= 0 ) bench.loops = 1;
+
+	if ( !strcmp( test, "parse" ) )
+	{
+		if ( !LoadFile( &bench, file, max_bytes ) )
+			return 1;
+		printf( "%s %lu bytes, packet length %d, loops %d\n", file, bench.bytes, bench.packet_length, bench.loops );
+		ret = BenchParse( &bench );
+	} else
+	if ( !strcmp( test, "pidtbl" ) )
+	{
+		ret = BenchPidTable( &bench, max_bytes );
+	} else
+	if ( !strcmp( test, "crc" ) )
+	{
+		int has_file = LoadFile( &bench, file, max_bytes );
+		ret = BenchCRC32( &bench, has_file );
+	} else
+	if ( !strcmp( test, "probe" ) )
+	{
+		ret = BenchProbe( &bench, file, max_bytes );
+	} else
+	if ( !strcmp( test, "writer" ) )
+	{
+		ret = BenchWriter( file, tuners, max_bytes, circ_bytes, sync_bytes );
+	} else
+	if ( !strcmp( test, "timeshift" ) )
+	{
+		ret = BenchTimeShift( file, tuners, max_bytes, circ_bytes, sync_bytes );
+	} else
+	if ( !strcmp( test, "livetv" ) )
+	{
+		ret = BenchLiveTV( file, bench.loops );
+	} else
+	if ( !strcmp( test, "ring" ) )
+	{
+		ret = BenchRing( max_bytes, circ_bytes );
+	} else
+	if ( !strcmp( test, "split" ) )
+	{
+		ret = BenchSplit( &bench, file, programs, tuners, max_bytes, dir );
+	} else
+	if ( !strcmp( test, "eitmem" ) )
+	{
+		LoadFile( &bench, file, max_bytes );
+		ret = BenchEitMem( &bench, programs, bench.loops );
+	} else
+	if ( !strcmp( test, "eitstore" ) )
+	{
+		LoadFile( &bench, file, max_bytes );
+		ret = BenchEitStore( &bench, programs, bench.loops > 1 ? bench.loops : 3 );
+	} else
+	if ( !strcmp( test, "zerocopy" ) )
+	{
+		ret = BenchZeroCopy( &bench, file, max_bytes, dir );
+	} else
+	if ( !strcmp( test, "msgqueue" ) )
+	{
+		LoadFile( &bench, file, max_bytes );
+		ret = BenchMsgQueue( &bench, programs );
+	} else
+	if ( !strcmp( test, "psicache" ) )
+	{
+		LoadFile( &bench, file, max_bytes );
+		ret = BenchPsiCache( &bench, dir );
+	} else
+	if ( !strcmp( test, "huffman" ) )
+	{
+		ret = BenchHuffman( &bench, programs );
+	} else
+	if ( !strcmp( test, "seek" ) )
+	{
+		ret = BenchSeek( file, max_bytes, bench.loops );
+	} else
+	if ( !strcmp( test, "avinf" ) )
+	{
+		ret = BenchAVInf( file, programs, max_bytes, tuners );
+	} else
+	if ( !strcmp( test, "livedur" ) )
+	{
+		ret = BenchLiveDuration( file, max_bytes, bench.loops );
+	} else
+	if ( !strcmp( test, "startcode" ) )
+	{
+		int has_file = LoadFile( &bench, file, max_bytes );
+		ret = BenchStartCode( &bench, has_file, max_bytes );
+	} else
+	if ( !strcmp( test, "scan" ) )
+	{
+		ret = BenchScan( file, programs, tuners );
+	} else
+		Usage( );
+
+	free( bench.data );
+	return ret;
+}
@@ -424,7 +424,7 @@ bool SearchMPEG2StartCode( const unsigned char* pStart, int Bytes, unsigned	long
 {
 	const unsigned char	*pbData;
 	int	 len;
-	unsigned long code;
+	unsigned int code;	//32 bits, a 64 bits long keeps the bytes shifted out
 
 	if ( Bytes < 4 )
 		return false;
@@ -454,7 +454,7 @@ bool SearchMPEG4VOLCode( const unsigned char* pStart, int Bytes, const unsigned
 {
 	const unsigned char	*pbData;
 	int	 len;
-	unsigned long code;
+	unsigned int code;
 
 	if ( Bytes < 4 )
 		return false;
@@ -3017,7 +3017,7 @@ int CheckMPEGPacket( const unsigned char* pStart, int Bytes )
 {
 	const unsigned char	*pbData, *p1, *p2;
 	int	 len;
-	unsigned long code;
+	unsigned int code;
 	unsigned long StartCode = 0x000001BA;
 
 	if ( Bytes < 4 )
@@ -440,7 +440,7 @@ static unsigned long crc32_table2[256] = {
 //
 unsigned long CalCrcCheck( const unsigned char *pData, int len )
 {
-    unsigned long  crc = 0xffffffff;
+    unsigned int  crc = 0xffffffff;	//32 bits, the table index goes out of range with a 64 bits long
     unsigned char* p_byte = (unsigned char*)pData;
 
     while( len-- )
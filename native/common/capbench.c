@@ -0,0 +1,164 @@
+/*
+ * Copyright 2015 The SageTV Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include "capbench.h"
+
+typedef struct
+{
+    const CapBenchOps *ops;
+    void *tuner;
+    pthread_t thread;
+    int running;
+    volatile int *stop;
+    unsigned long long eats;
+    unsigned long long recorded;
+} BenchTuner;
+
+static double cpuSec(const struct rusage *u)
+{
+    return u->ru_utime.tv_sec+u->ru_utime.tv_usec/1e6+u->ru_stime.tv_sec+u->ru_stime.tv_usec/1e6;
+}
+
+// the Java encoder thread
+static void *eatThread(void *data)
+{
+    BenchTuner *x=(BenchTuner *)data;
+    while(!*x->stop)
+    {
+        int n=x->ops->eat(x->tuner);
+        x->eats++;
+        if(n>0)
+            x->recorded+=n;
+    }
+    return NULL;
+}
+
+static void printLine(const char *label, double mbps, const CapReplayStats *s, unsigned long long ringDrop)
+{
+    printf("%-6s %7.2f %9.1f %8.2f %8.2f %7.0f %7u %8u %7.1f %7.1f %8.1f\n", label, mbps,
+           s->sentBytes/1048576.0, s->droppedBytes/1048576.0, ringDrop/1048576.0,
+           s->writes ? (double)s->writeUsSum/s->writes : 0.0, s->writeUsP99, s->writeUsMax,
+           s->delays ? s->delayUsSum/1e3/s->delays : 0.0, s->delayUsP99/1e3, s->delayUsMax/1e3);
+}
+
+int runCapBench(const CapBenchOps *ops, void *context, const CapBenchParams *params)
+{
+    static BenchTuner tuner[CAP_BENCH_MAX_TUNERS];
+    CapReplayStats stats[CAP_BENCH_MAX_TUNERS], total;
+    unsigned long long ringDrop[CAP_BENCH_MAX_TUNERS], ringTotal=0, senderCpuUs=0;
+    struct rusage r0, r1;
+    struct timeval t0, t1;
+    volatile int stop=0;
+    double t, cpu, mbps=0;
+    int tuners=params->tuners, i, ret=0;
+
+    if(tuners<1)
+        tuners=1;
+    if(tuners>CAP_BENCH_MAX_TUNERS)
+        tuners=CAP_BENCH_MAX_TUNERS;
+    memset(tuner, 0, sizeof(tuner));
+    memset(&total, 0, sizeof(total));
+    for(i=0; i<tuners; i++)
+    {
+        tuner[i].ops=ops;
+        tuner[i].stop=&stop;
+        if((tuner[i].tuner=ops->open(context, i))==NULL)
+        {
+            fprintf(stderr, "%s: failed opening tuner %d\n", params->name, i);
+            tuners=i;
+            ret=1;
+            break;
+        }
+    }
+
+    getrusage(RUSAGE_SELF, &r0);
+    gettimeofday(&t0, NULL);
+    for(i=0; i<tuners; i++)
+    {
+        char out[1024];
+        if(params->outDir)
+            snprintf(out, sizeof(out), "%s/capbench-%d.ts", params->outDir, i);
+        else
+            snprintf(out, sizeof(out), "/dev/null");
+        if(!ops->start(tuner[i].tuner, out))
+        {
+            fprintf(stderr, "%s: failed starting tuner %d on %s\n", params->name, i, out);
+            ret=1;
+            continue;
+        }
+        tuner[i].running=pthread_create(&tuner[i].thread, NULL, eatThread, &tuner[i])==0;
+    }
+    sleep(params->seconds>0 ? params->seconds : 1);
+    stop=1;
+    for(i=0; i<tuners; i++)
+    {
+        if(tuner[i].running)
+            pthread_join(tuner[i].thread, NULL);
+        ops->stop(tuner[i].tuner);
+    }
+    gettimeofday(&t1, NULL);
+    getrusage(RUSAGE_SELF, &r1);
+    t=(t1.tv_sec-t0.tv_sec)+(t1.tv_usec-t0.tv_usec)/1e6;
+
+    printf("%s: %d tuners, %.1f s\n", params->name, tuners, t);
+    printf("%-6s %7s %9s %8s %8s %7s %7s %8s %7s %7s %8s\n", "tuner", "Mbps", "MB sent", "MB drop", "MB ring",
+           "wr us", "wr p99", "wr max", "e2e ms", "e2e p99", "e2e max");
+    for(i=0; i<tuners; i++)
+    {
+        char label[16];
+        statsCapReplay(ops->replay(tuner[i].tuner), &stats[i]);
+        ringDrop[i]=ops->dropped ? ops->dropped(tuner[i].tuner) : 0;
+        snprintf(label, sizeof(label), "%d", i);
+        printLine(label, stats[i].consumedBytes*8/1e6/t, &stats[i], ringDrop[i]);
+
+        mbps+=stats[i].consumedBytes*8/1e6/t;
+        ringTotal+=ringDrop[i];
+        senderCpuUs+=stats[i].senderCpuUs;
+        total.sentBytes+=stats[i].sentBytes;
+        total.droppedBytes+=stats[i].droppedBytes;
+        total.consumedBytes+=stats[i].consumedBytes;
+        total.writes+=stats[i].writes;
+        total.writeUsSum+=stats[i].writeUsSum;
+        total.delays+=stats[i].delays;
+        total.delayUsSum+=stats[i].delayUsSum;
+        if(stats[i].writeUsMax>total.writeUsMax) total.writeUsMax=stats[i].writeUsMax;
+        if(stats[i].writeUsP99>total.writeUsP99) total.writeUsP99=stats[i].writeUsP99;
+        if(stats[i].delayUsMax>total.delayUsMax) total.delayUsMax=stats[i].delayUsMax;
+        if(stats[i].delayUsP99>total.delayUsP99) total.delayUsP99=stats[i].delayUsP99;
+        if(stats[i].droppedBytes || ringDrop[i] || !stats[i].consumedBytes)
+            ret=1;
+    }
+    // p99 of the total is the worst tuner's
+    printLine("all", mbps, &total, ringTotal);
+
+    cpu=cpuSec(&r1)-cpuSec(&r0)-senderCpuUs/1e6;
+    printf("cpu %.1f ms/s (%.1f%% of a core), %.3f ms/s per Mbps, stand-in devices %.1f ms/s\n",
+           cpu*1e3/t, cpu*100/t, mbps>0 ? cpu*1e3/t/mbps : 0.0, senderCpuUs/1e3/t);
+    if(tuners>0)
+        printf("file: %s %u clock refs, %.2f Mbps\n", stats[0].packetSize ?
+               (stats[0].packetSize==192 ? "TS 192" : "TS 188") : "PS", stats[0].clockRefs,
+               stats[0].fileUs ? stats[0].fileBytes*8.0/stats[0].fileUs : 0.0);
+
+    for(i=0; i<tuners; i++)
+        ops->close(tuner[i].tuner);
+    return ret;
+}
@@ -0,0 +1,757 @@
+/*
+ * Copyright 2015 The SageTV Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "capreplay.h"
+
+#define CLOCK_HZ            27000000ULL         // PCR/SCR ticks a second
+#define CLOCK_WRAP          ((1ULL<<33)*300)
+#define CLOCK_MIN_STEP      (CLOCK_HZ/50)       // clock refs closer than 20ms are skipped
+#define CLOCK_MAX_STEP      CLOCK_HZ            // longer steps (or backwards) are discontinuities
+#define SEND_TICK_US        1000
+#define PIPE_CHUNK          (188*348)           // bytes a write at most, BUFFERSIZE of the DVB plugin
+#define SENT_MARKS          4096                // send times kept for the end-to-end delay
+
+enum { SINK_NONE, SINK_PIPE, SINK_UDP };
+
+typedef struct
+{
+    unsigned long long offset;
+    unsigned long long us;
+} PaceMark;
+
+typedef struct
+{
+    unsigned long long end;                     // sentBytes after a chunk
+    unsigned long long us;
+} SentMark;
+
+struct CapReplay
+{
+    int fd;
+    unsigned char *data;
+    unsigned long long size;
+    unsigned int packetSize;
+    int speed;
+
+    // offset -> us into the file, offset 0 at 0, the last mark is the end of the file
+    PaceMark *pace;
+    int paceNum;
+    unsigned int clockRefs;
+
+    int sink;
+    int sinkFd;                                 // pipe write end or UDP socket
+    pthread_t thread;
+    int running;
+    volatile int stop;
+    volatile int playing;
+    int replay;                                 // playCapReplay asked for a fresh start
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+
+    // sender thread
+    unsigned long long pos;                     // offset in the file
+    unsigned long long passUs;                  // clock of the passes before this one
+    unsigned long long startUs;
+
+    SentMark marks[SENT_MARKS];
+    unsigned long long markNum;
+    unsigned int loops;
+    unsigned long long sentBytes;
+    unsigned long long droppedBytes;
+    unsigned long long consumedBytes;
+    unsigned long long writes;
+    unsigned long long writeUsSum;
+    unsigned int writeUsMax;
+    unsigned long long delays;
+    unsigned long long delayUsSum;
+    unsigned int delayUsMax;
+    unsigned int writeHist[CAP_REPLAY_HISTOGRAM];
+    unsigned int delayHist[CAP_REPLAY_HISTOGRAM];
+    unsigned long long senderCpuUs;
+};
+
+unsigned long long capReplayUs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec*1000000+ts.tv_nsec/1000;
+}
+
+// 4 buckets an octave, exact below 4us
+static int histBucket(unsigned int us)
+{
+    int e;
+    if(us<4)
+        return us;
+    e=31-__builtin_clz(us);
+    return (e-1)*4+((us>>(e-2))&3);
+}
+
+static unsigned int histTop(int bucket)
+{
+    int e=bucket/4+1;
+    if(bucket<4)
+        return bucket;
+    return ((4+(bucket&3))<<(e-2))+(1<<(e-2))-1;
+}
+
+static unsigned int histPercentile(const unsigned int *hist, unsigned long long count, int percent)
+{
+    unsigned long long want=(count*percent+99)/100, sum=0;
+    int i;
+    for(i=0; i<CAP_REPLAY_HISTOGRAM; i++)
+    {
+        sum+=hist[i];
+        if(sum>=want && sum)
+            return histTop(i);
+    }
+    return 0;
+}
+
+static int isTSSync(const unsigned char *p, unsigned long long left, unsigned int packetSize)
+{
+    return left>=2*packetSize+1 && p[0]==0x47 && p[packetSize]==0x47 && p[2*packetSize]==0x47;
+}
+
+// 27MHz PCR of a TS packet, -1 if it has none
+static long long packetPCR(const unsigned char *p, int *pid)
+{
+    *pid=((p[1]&0x1f)<<8)|p[2];
+    if(!(p[3]&0x20) || p[4]<7 || !(p[5]&0x10))
+        return -1;
+    return ((unsigned long long)p[6]<<25|(unsigned long long)p[7]<<17|(unsigned long long)p[8]<<9|
+            (unsigned long long)p[9]<<1|p[10]>>7)*300+(((p[10]&1)<<8)|p[11]);
+}
+
+// 27MHz SCR of a pack header at p (00 00 01 BA), MPEG-2 or MPEG-1, -1 if it isn't one
+static long long packSCR(const unsigned char *p, unsigned long long left)
+{
+    if(left<12)
+        return -1;
+    if((p[4]&0xc0)==0x40)
+        return ((unsigned long long)((p[4]>>3)&7)<<30|(unsigned long long)(p[4]&3)<<28|
+                (unsigned long long)p[5]<<20|(unsigned long long)(p[6]>>3)<<15|(unsigned long long)(p[6]&3)<<13|
+                (unsigned long long)p[7]<<5|p[8]>>3)*300+(((p[8]&3)<<7)|(p[9]>>1));
+    if((p[4]&0xf0)==0x20)
+        return ((unsigned long long)((p[4]>>1)&7)<<30|(unsigned long long)p[5]<<22|
+                (unsigned long long)(p[6]>>1)<<15|(unsigned long long)p[7]<<7|p[8]>>1)*300;
+    return -1;
+}
+
+static int addRef(PaceMark **refs, int *num, int *max, unsigned long long offset, unsigned long long clock)
+{
+    if(*num==*max)
+    {
+        int grow=*max ? *max*2 : 1024;
+        PaceMark *p=(PaceMark *)realloc(*refs, grow*sizeof(PaceMark));
+        if(p==NULL)
+            return 0;
+        *refs=p;
+        *max=grow;
+    }
+    (*refs)[*num].offset=offset;
+    (*refs)[(*num)++].us=clock;
+    return 1;
+}
+
+// clock references (offset, 27MHz clock) of the first PCR PID of a TS, or of the packs of a PS
+static int scanClockRefs(CapReplay *r, PaceMark **refs, int *max)
+{
+    const unsigned char *p=r->data;
+    unsigned long long size=r->size, pos=0, last=0;
+    int num=0, pcrPid=-1, pid;
+    long long clock;
+
+    if(r->packetSize)
+    {
+        unsigned int prefix=r->packetSize-188;
+        while(pos+r->packetSize<=size)
+        {
+            if(p[pos+prefix]!=0x47)
+            {
+                // lost sync, on to three packets in a row
+                pos++;
+                while(pos+prefix<size && !isTSSync(p+pos+prefix, size-pos-prefix, r->packetSize))
+                    pos++;
+                continue;
+            }
+            clock=packetPCR(p+pos+prefix, &pid);
+            if(clock>=0 && (pcrPid<0 || pid==pcrPid))
+            {
+                pcrPid=pid;
+                if(!num || (unsigned long long)clock-last>=CLOCK_MIN_STEP || (unsigned long long)clock<last)
+                {
+                    if(!addRef(refs, &num, max, pos, clock))
+                        break;
+                    last=clock;
+                }
+            }
+            pos+=r->packetSize;
+        }
+        return num;
+    }
+
+    while(pos+12<=size)
+    {
+        const unsigned char *q=(const unsigned char *)memchr(p+pos+2, 0x01, size-pos-2);
+        if(q==NULL)
+            break;
+        pos=q-2-p;
+        if(q[-2]==0 && q[-1]==0 && pos+4<=size && q[1]==0xba && (clock=packSCR(p+pos, size-pos))>=0)
+        {
+            if(!num || (unsigned long long)clock-last>=CLOCK_MIN_STEP || (unsigned long long)clock<last)
+            {
+                if(!addRef(refs, &num, max, pos, clock))
+                    break;
+                last=clock;
+            }
+        }
+        pos+=3;
+    }
+    return num;
+}
+
+// offset -> us map of a pass through the file from its clock refs. Steps across a discontinuity
+// (backwards, too long) and the bytes before the first and after the last ref go at the average rate.
+static int buildPaceMap(CapReplay *r)
+{
+    PaceMark *refs=NULL;
+    int max=0, num, i, n=0;
+    unsigned long long rate, goodBytes=0, goodClock=0, us=0;
+
+    num=scanClockRefs(r, &refs, &max);
+    for(i=1; i<num; i++)
+    {
+        unsigned long long step=(refs[i].us+CLOCK_WRAP-refs[i-1].us)%CLOCK_WRAP;
+        if(step>0 && step<=CLOCK_MAX_STEP)
+        {
+            goodBytes+=refs[i].offset-refs[i-1].offset;
+            goodClock+=step;
+        }
+    }
+    rate=goodClock ? goodBytes*CLOCK_HZ/goodClock : CAP_REPLAY_LEGACY_RATE;
+    if(rate==0)
+        rate=CAP_REPLAY_LEGACY_RATE;
+    r->clockRefs=goodClock ? num : 0;
+
+    r->pace=(PaceMark *)malloc((num+2)*sizeof(PaceMark));
+    if(r->pace==NULL)
+    {
+        free(refs);
+        return 0;
+    }
+    r->pace[n].offset=0;
+    r->pace[n++].us=0;
+    for(i=0; i<num && goodClock; i++)
+    {
+        unsigned long long prev=r->pace[n-1].offset;
+        if(i>0)
+        {
+            unsigned long long step=(refs[i].us+CLOCK_WRAP-refs[i-1].us)%CLOCK_WRAP;
+            if(step>0 && step<=CLOCK_MAX_STEP)
+                us+=step/27;
+            else
+                us+=(refs[i].offset-prev)*1000000/rate;
+        }
+        else
+            us+=refs[i].offset*1000000/rate;
+        if(refs[i].offset>prev)
+        {
+            r->pace[n].offset=refs[i].offset;
+            r->pace[n++].us=us;
+        }
+    }
+    if(r->size>r->pace[n-1].offset)
+    {
+        us+=(r->size-r->pace[n-1].offset)*1000000/rate;
+        r->pace[n].offset=r->size;
+        r->pace[n++].us=us;
+    }
+    // a pass takes 1ms at least, so the sender always gets somewhere
+    if(r->pace[n-1].us==0)
+        r->pace[n-1].us=1000;
+    r->paceNum=n;
+    free(refs);
+    return 1;
+}
+
+// bytes of the file due by us into a pass
+static unsigned long long paceOffset(CapReplay *r, unsigned long long us)
+{
+    int lo=0, hi=r->paceNum-1;
+    PaceMark *a, *b;
+    if(us>=r->pace[hi].us)
+        return r->size;
+    while(hi-lo>1)
+    {
+        int mid=(lo+hi)/2;
+        if(r->pace[mid].us<=us)
+            lo=mid;
+        else
+            hi=mid;
+    }
+    a=&r->pace[lo];
+    b=&r->pace[hi];
+    if(b->us==a->us)
+        return b->offset;
+    return a->offset+(b->offset-a->offset)*(us-a->us)/(b->us-a->us);
+}
+
+static unsigned int detectPacketSize(const unsigned char *p, unsigned long long size)
+{
+    unsigned long long i;
+    for(i=0; i<188 && i<size; i++)
+    {
+        if(isTSSync(p+i, size-i, 188))
+            return 188;
+        if(i>=4 && isTSSync(p+i, size-i, 192))
+            return 192;
+    }
+    return 0;
+}
+
+CapReplay *openCapReplay(const char *path, int speed)
+{
+    CapReplay *r;
+    struct stat st;
+    int fd=open(path, O_RDONLY);
+
+    if(fd<0)
+        return NULL;
+    if(fstat(fd, &st) || st.st_size==0)
+    {
+        close(fd);
+        return NULL;
+    }
+    r=(CapReplay *)calloc(1, sizeof(CapReplay));
+    if(r==NULL)
+    {
+        close(fd);
+        return NULL;
+    }
+    r->fd=fd;
+    r->size=st.st_size;
+    r->speed=speed<0 ? 0 : speed;
+    r->sinkFd=-1;
+    r->data=(unsigned char *)mmap(NULL, r->size, PROT_READ, MAP_SHARED, fd, 0);
+    if(r->data==MAP_FAILED)
+    {
+        close(fd);
+        free(r);
+        return NULL;
+    }
+    madvise(r->data, r->size, MADV_SEQUENTIAL);
+    r->packetSize=detectPacketSize(r->data, r->size);
+    if(!buildPaceMap(r))
+    {
+        munmap(r->data, r->size);
+        close(fd);
+        free(r);
+        return NULL;
+    }
+    pthread_mutex_init(&r->lock, NULL);
+    pthread_cond_init(&r->cond, NULL);
+    return r;
+}
+
+static void markSent(CapReplay *r, unsigned long long now)
+{
+    SentMark *m=&r->marks[r->markNum%SENT_MARKS];
+    m->end=r->sentBytes;
+    m->us=now;
+    r->markNum++;
+}
+
+// one chunk into the sink, what doesn't fit is dropped unless the replay isn't paced
+static int sendChunk(CapReplay *r, const unsigned char *p, int bytes)
+{
+    int n=0, unit;
+    if(r->sink==SINK_UDP)
+    {
+        int off;
+        for(off=0; off<bytes; off+=CAP_REPLAY_DATAGRAM)
+        {
+            int size=bytes-off<CAP_REPLAY_DATAGRAM ? bytes-off : CAP_REPLAY_DATAGRAM;
+            while(send(r->sinkFd, p+off, size, MSG_DONTWAIT)<0)
+            {
+                struct pollfd pfd={r->sinkFd, POLLOUT, 0};
+                if(r->speed || (errno!=EAGAIN && errno!=EWOULDBLOCK && errno!=ENOBUFS && errno!=EINTR))
+                {
+                    size=-size;
+                    break;
+                }
+                if(r->stop)
+                    return n;
+                poll(&pfd, 1, 100);
+            }
+            if(size>0)
+                n+=size;
+            else
+                r->droppedBytes-=size;
+        }
+        return n;
+    }
+
+    // a tuner overflows by whole packets, one begun is written out before the rest is dropped
+    unit=r->packetSize ? r->packetSize : 1;
+    while(n<bytes)
+    {
+        int w=write(r->sinkFd, p+n, bytes-n);
+        if(w>0)
+        {
+            n+=w;
+            continue;
+        }
+        if(w<0 && errno==EINTR)
+            continue;
+        if(w<0 && (errno==EAGAIN || errno==EWOULDBLOCK) && (!r->speed || n%unit) && !r->stop)
+        {
+            struct pollfd pfd={r->sinkFd, POLLOUT, 0};
+            poll(&pfd, 1, 100);
+            continue;
+        }
+        // full (the tuner overflows) or the consumer is gone, what's left at a stop isn't a loss
+        if(!r->stop)
+            r->droppedBytes+=bytes-n;
+        break;
+    }
+    return n;
+}
+
+static void *senderThread(void *data)
+{
+    CapReplay *r=(CapReplay *)data;
+    struct timespec next;
+    unsigned long long passUs=r->pace[r->paceNum-1].us;
+
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    while(1)
+    {
+        unsigned long long now, due, clock;
+
+        pthread_mutex_lock(&r->lock);
+        while(!r->stop && !r->playing)
+            pthread_cond_wait(&r->cond, &r->lock);
+        if(r->stop)
+        {
+            pthread_mutex_unlock(&r->lock);
+            break;
+        }
+        if(r->replay)
+        {
+            r->replay=0;
+            r->pos=0;
+            r->passUs=0;
+            r->startUs=capReplayUs();
+            clock_gettime(CLOCK_MONOTONIC, &next);
+        }
+        pthread_mutex_unlock(&r->lock);
+
+        now=capReplayUs();
+        if(r->speed)
+        {
+            // file clock now, the passes played so far are taken off
+            clock=(now-r->startUs)*r->speed/CAP_REPLAY_REALTIME;
+            due=clock<r->passUs ? 0 : clock-r->passUs;
+            due=due>=passUs ? r->size : paceOffset(r, due);
+            // chunks start on a packet, drops stay packet aligned
+            if(r->packetSize && due<r->size)
+                due-=due%r->packetSize;
+        }
+        else
+            due=r->size;
+
+        while(r->pos<due && !r->stop && r->playing)
+        {
+            unsigned long long chunk=due-r->pos;
+            int sent;
+            if(chunk>PIPE_CHUNK)
+                chunk=r->packetSize ? PIPE_CHUNK-PIPE_CHUNK%r->packetSize : PIPE_CHUNK;
+            sent=sendChunk(r, r->data+r->pos, (int)chunk);
+            r->pos+=chunk;
+            pthread_mutex_lock(&r->lock);
+            r->sentBytes+=sent;
+            if(sent>0)
+                markSent(r, capReplayUs());
+            pthread_mutex_unlock(&r->lock);
+        }
+        if(r->pos>=r->size)
+        {
+            r->pos=0;
+            r->passUs+=passUs;
+            r->loops++;
+            if(!r->speed)
+                continue;
+        }
+        if(!r->speed)
+            continue;
+
+        next.tv_nsec+=SEND_TICK_US*1000;
+        if(next.tv_nsec>=1000000000)
+        {
+            next.tv_nsec-=1000000000;
+            next.tv_sec++;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+    }
+#ifdef RUSAGE_THREAD
+    {
+        // what the stand-in device took, benchmarks leave it out of the capture cost
+        struct rusage usage;
+        if(getrusage(RUSAGE_THREAD, &usage)==0)
+            r->senderCpuUs+=(unsigned long long)(usage.ru_utime.tv_sec+usage.ru_stime.tv_sec)*1000000+
+                            usage.ru_utime.tv_usec+usage.ru_stime.tv_usec;
+    }
+#endif
+    return NULL;
+}
+
+static int startSender(CapReplay *r)
+{
+    r->stop=0;
+    r->playing=0;
+    r->replay=0;
+    if(pthread_create(&r->thread, NULL, senderThread, r))
+        return 0;
+    r->running=1;
+    return 1;
+}
+
+int startCapReplayPipe(CapReplay *replay, int bufferBytes)
+{
+    int fds[2];
+    if(replay==NULL)
+        return -1;
+    stopCapReplay(replay);
+    if(pipe(fds))
+        return -1;
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+    fcntl(fds[1], F_SETFL, O_NONBLOCK);
+#ifdef F_SETPIPE_SZ
+    // as large as the device buffer, pipe-max-size (1M by default) if that's more than allowed
+    if(bufferBytes>0 && fcntl(fds[1], F_SETPIPE_SZ, bufferBytes)<0)
+        fcntl(fds[1], F_SETPIPE_SZ, bufferBytes<(1<<20) ? bufferBytes : (1<<20));
+#endif
+    replay->sink=SINK_PIPE;
+    replay->sinkFd=fds[1];
+    if(!startSender(replay))
+    {
+        close(fds[0]);
+        close(fds[1]);
+        replay->sink=SINK_NONE;
+        replay->sinkFd=-1;
+        return -1;
+    }
+    return fds[0];
+}
+
+int startCapReplayUDP(CapReplay *replay, const char *host, int port)
+{
+    struct sockaddr_in addr;
+    int fd;
+    if(replay==NULL)
+        return -1;
+    stopCapReplay(replay);
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family=AF_INET;
+    addr.sin_port=htons(port);
+    if(inet_pton(AF_INET, host, &addr.sin_addr)!=1)
+        return -1;
+    fd=socket(AF_INET, SOCK_DGRAM, 0);
+    if(fd<0)
+        return -1;
+    if(connect(fd, (struct sockaddr *)&addr, sizeof(addr)))
+    {
+        close(fd);
+        return -1;
+    }
+    replay->sink=SINK_UDP;
+    replay->sinkFd=fd;
+    if(!startSender(replay))
+    {
+        close(fd);
+        replay->sink=SINK_NONE;
+        replay->sinkFd=-1;
+        return -1;
+    }
+    return 0;
+}
+
+void playCapReplay(CapReplay *replay)
+{
+    if(replay==NULL)
+        return;
+    pthread_mutex_lock(&replay->lock);
+    replay->playing=1;
+    replay->replay=1;
+    pthread_cond_signal(&replay->cond);
+    pthread_mutex_unlock(&replay->lock);
+}
+
+void pauseCapReplay(CapReplay *replay)
+{
+    if(replay==NULL)
+        return;
+    pthread_mutex_lock(&replay->lock);
+    replay->playing=0;
+    pthread_mutex_unlock(&replay->lock);
+}
+
+void stopCapReplay(CapReplay *replay)
+{
+    if(replay==NULL || !replay->running)
+        return;
+    pthread_mutex_lock(&replay->lock);
+    replay->stop=1;
+    pthread_cond_signal(&replay->cond);
+    pthread_mutex_unlock(&replay->lock);
+    pthread_join(replay->thread, NULL);
+    replay->running=0;
+    if(replay->sinkFd>=0)
+        close(replay->sinkFd);
+    replay->sinkFd=-1;
+    replay->sink=SINK_NONE;
+}
+
+void closeCapReplay(CapReplay *replay)
+{
+    if(replay==NULL)
+        return;
+    stopCapReplay(replay);
+    munmap(replay->data, replay->size);
+    close(replay->fd);
+    pthread_mutex_destroy(&replay->lock);
+    pthread_cond_destroy(&replay->cond);
+    free(replay->pace);
+    free(replay);
+}
+
+void consumedCapReplay(CapReplay *replay, unsigned long bytes, unsigned long writeUs)
+{
+    unsigned long long now=capReplayUs(), first;
+    if(replay==NULL || bytes==0)
+        return;
+    pthread_mutex_lock(&replay->lock);
+    replay->consumedBytes+=bytes;
+    replay->writes++;
+    replay->writeUsSum+=writeUs;
+    if(writeUs>replay->writeUsMax)
+        replay->writeUsMax=writeUs;
+    replay->writeHist[histBucket(writeUs)]++;
+
+    // the oldest chunk holding the last byte consumed was sent when
+    first=replay->markNum>SENT_MARKS ? replay->markNum-SENT_MARKS : 0;
+    if(replay->markNum>first)
+    {
+        unsigned long long lo=first, hi=replay->markNum-1, delay;
+        while(lo<hi)
+        {
+            unsigned long long mid=(lo+hi)/2;
+            if(replay->marks[mid%SENT_MARKS].end>=replay->consumedBytes)
+                hi=mid;
+            else
+                lo=mid+1;
+        }
+        delay=now>replay->marks[lo%SENT_MARKS].us ? now-replay->marks[lo%SENT_MARKS].us : 0;
+        if(delay>0xffffffffULL)
+            delay=0xffffffffULL;
+        replay->delays++;
+        replay->delayUsSum+=delay;
+        if(delay>replay->delayUsMax)
+            replay->delayUsMax=(unsigned int)delay;
+        replay->delayHist[histBucket((unsigned int)delay)]++;
+    }
+    pthread_mutex_unlock(&replay->lock);
+}
+
+void statsCapReplay(CapReplay *replay, CapReplayStats *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    if(replay==NULL)
+        return;
+    pthread_mutex_lock(&replay->lock);
+    stats->packetSize=replay->packetSize;
+    stats->clockRefs=replay->clockRefs;
+    stats->fileBytes=replay->size;
+    stats->fileUs=replay->pace[replay->paceNum-1].us;
+    stats->loops=replay->loops;
+    stats->sentBytes=replay->sentBytes;
+    stats->droppedBytes=replay->droppedBytes;
+    stats->consumedBytes=replay->consumedBytes;
+    stats->writes=replay->writes;
+    stats->writeUsSum=replay->writeUsSum;
+    stats->writeUsMax=replay->writeUsMax;
+    stats->writeUsP99=histPercentile(replay->writeHist, replay->writes, 99);
+    stats->delays=replay->delays;
+    stats->delayUsSum=replay->delayUsSum;
+    stats->delayUsMax=replay->delayUsMax;
+    stats->delayUsP99=histPercentile(replay->delayHist, replay->delays, 99);
+    stats->senderCpuUs=replay->senderCpuUs;
+    // a bucket's top can be past the largest value in it
+    if(stats->writeUsP99>stats->writeUsMax)
+        stats->writeUsP99=stats->writeUsMax;
+    if(stats->delayUsP99>stats->delayUsMax)
+        stats->delayUsP99=stats->delayUsMax;
+    pthread_mutex_unlock(&replay->lock);
+}
+
+int loadCapReplayCfg(const char *cfgFile, char *path, int pathSize, int *speed)
+{
+    char buf[512], name[64], file[448];
+    int mode=0, val;
+    FILE *fp=fopen(cfgFile, "rt");
+
+    path[0]=0;
+    *speed=CAP_REPLAY_REALTIME;
+    if(fp==NULL)
+        return 0;
+    while(fgets(buf, sizeof(buf), fp))
+    {
+        int fields;
+        if(buf[0]=='#')
+            continue;
+        file[0]=0;
+        fields=sscanf(buf, "%63s %d %447s", name, &val, file);
+        if(fields<2)
+            continue;
+        if(!strcmp(name, "debugsource") && val!=0 && fields==3)
+        {
+            mode=val;
+            snprintf(path, pathSize, "%s", file);
+        }
+        else if(!strcmp(name, "debugsource_speed") && val>=0)
+            *speed=val;
+    }
+    fclose(fp);
+    return path[0] ? mode : 0;
+}
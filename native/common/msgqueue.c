@@ -0,0 +1,437 @@
+/*
+ * Copyright 2015 The SageTV Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+#ifndef STANDALONE
+#include <jni.h>
+#endif
+#include "msgqueue.h"
+
+#define MSG_MAX_SOURCE      255
+#define MSG_WAIT_MS         1000
+#define MSG_LINGER_US       10000               // after a wake up, so a sweep goes out in a few large batches
+#define MSG_RECORD_HEADER   16
+
+#if defined(__GNUC__)
+#define MSG_ALIGNED __attribute__((aligned(64)))
+#else
+#define MSG_ALIGNED
+#endif
+
+// flags shared by producers and dispatcher
+#define FLAG_LOAD(p)        __atomic_load_n((p), __ATOMIC_SEQ_CST)
+#define FLAG_STORE(p, v)    __atomic_store_n((p), (v), __ATOMIC_SEQ_CST)
+#define COUNT(p, n)         __atomic_fetch_add((p), (n), __ATOMIC_RELAXED)
+
+typedef struct
+{
+    int bytes;
+    unsigned char data[MSG_RECORD_HEADER];      // encoded record, source and data follow
+} MsgRecord;
+
+// bounded multi producer ring: slot seq is its position when free, position+1 when it holds a message
+typedef struct
+{
+    unsigned long seq;
+    MsgRecord *rec;
+} MsgSlot;
+
+typedef struct
+{
+    MsgSlot slot[MSG_QUEUE_SLOTS];
+    unsigned long tail MSG_ALIGNED;             // producers
+    unsigned long head MSG_ALIGNED;             // dispatcher
+    int efd;                                    // eventfd the dispatcher sleeps on
+    int waiting;
+    int stop;
+    int running;
+    pthread_t thread;
+    MsgQueueDeliver deliver;
+    void *context;
+    unsigned long long posted;
+    unsigned long long delivered;
+    unsigned long long dropped;
+    unsigned long long batches;
+    unsigned int maxDepth;
+    unsigned char batch[MSG_BATCH_SIZE];
+} MsgQueue;
+
+static MsgQueue queue;
+static pthread_once_t queueOnce=PTHREAD_ONCE_INIT;
+
+#ifndef STANDALONE
+// JNI state of the dispatcher thread, which stays attached as a daemon
+typedef struct
+{
+    JavaVM *vm;
+    JNIEnv *env;
+    int failed;
+    jclass msgMgrClass;
+    jmethodID postMsgsMeth;                     // MsgManager.postMessages(ByteBuffer, int)
+    jmethodID postMsgMeth;                      // MsgManager.postMessage(SageMsg) of cores without it
+    jclass msgClass;
+    jmethodID msgConstructor;
+    jobject batchBuffer;
+} JavaDeliver;
+
+static JavaDeliver javaDeliver;
+
+static int attachJava(JavaDeliver *j, unsigned char *batch)
+{
+    JNIEnv *env;
+    JavaVMAttachArgs args;
+    jsize numVMs=0;
+    jclass cls;
+
+    if(j->env!=NULL || j->failed)
+        return j->env!=NULL;
+    if(JNI_GetCreatedJavaVMs(&j->vm, 1, &numVMs) || numVMs<1)
+        return 0;   // no VM yet, try again on next batch
+    args.version=JNI_VERSION_1_4;
+    args.name="NativeMsgQueue";
+    args.group=NULL;
+    if((*j->vm)->AttachCurrentThreadAsDaemon(j->vm, (void**)&j->env, &args)!=JNI_OK)
+    {
+        j->env=NULL;
+        return 0;
+    }
+    env=j->env;
+
+    cls=(*env)->FindClass(env, "sage/msg/MsgManager");
+    if(cls!=NULL)
+    {
+        j->msgMgrClass=(jclass)(*env)->NewGlobalRef(env, cls);
+        j->postMsgsMeth=(*env)->GetStaticMethodID(env, cls, "postMessages", "(Ljava/nio/ByteBuffer;I)V");
+        if(j->postMsgsMeth==NULL)
+            (*env)->ExceptionClear(env);
+        else
+        {
+            jobject buf=(*env)->NewDirectByteBuffer(env, batch, MSG_BATCH_SIZE);
+            if(buf!=NULL)
+                j->batchBuffer=(*env)->NewGlobalRef(env, buf);
+            else
+                (*env)->ExceptionClear(env);
+        }
+        if(j->postMsgsMeth==NULL || j->batchBuffer==NULL)
+        {
+            j->postMsgMeth=(*env)->GetStaticMethodID(env, cls, "postMessage", "(Lsage/msg/SageMsg;)V");
+            cls=(*env)->FindClass(env, "sage/msg/SageMsg");
+            if(cls!=NULL)
+            {
+                j->msgClass=(jclass)(*env)->NewGlobalRef(env, cls);
+                j->msgConstructor=(*env)->GetMethodID(env, cls, "<init>", "(ILjava/lang/Object;Ljava/lang/Object;I)V");
+            }
+        }
+    }
+    if((*env)->ExceptionCheck(env))
+        (*env)->ExceptionClear(env);
+    if(j->msgMgrClass==NULL || ((j->postMsgsMeth==NULL || j->batchBuffer==NULL) &&
+       (j->postMsgMeth==NULL || j->msgConstructor==NULL)))
+        j->failed=1;
+    return !j->failed;
+}
+
+static void detachJava(JavaDeliver *j)
+{
+    if(j->env==NULL)
+        return;
+    if(j->batchBuffer!=NULL)
+        (*j->env)->DeleteGlobalRef(j->env, j->batchBuffer);
+    j->batchBuffer=NULL;
+    (*j->vm)->DetachCurrentThread(j->vm);
+    j->env=NULL;
+}
+
+static unsigned int get32(const unsigned char *p)
+{
+    return ((unsigned int)p[0]<<24)|((unsigned int)p[1]<<16)|((unsigned int)p[2]<<8)|p[3];
+}
+
+static int deliverJava(void *context, unsigned char *batch, int bytes, int msgs)
+{
+    JavaDeliver *j=(JavaDeliver *)context;
+    JNIEnv *env;
+    int pos=0, n=0;
+
+    if(!attachJava(j, batch))
+        return 0;
+    env=j->env;
+    if(j->postMsgsMeth!=NULL && j->batchBuffer!=NULL)
+    {
+        (*env)->CallStaticVoidMethod(env, j->msgMgrClass, j->postMsgsMeth, j->batchBuffer, (jint)bytes);
+        if((*env)->ExceptionCheck(env))
+        {
+            (*env)->ExceptionDescribe(env);
+            (*env)->ExceptionClear(env);
+            return 0;
+        }
+        return msgs;
+    }
+
+    // a SageMsg a message for cores without postMessages, still on the one attached thread
+    while(pos+MSG_RECORD_HEADER<=bytes)
+    {
+        char src[MSG_MAX_SOURCE+1];
+        int type=(int)get32(batch+pos);
+        int priority=(int)get32(batch+pos+4);
+        int srcLen=(int)get32(batch+pos+8);
+        int dataLen=(int)get32(batch+pos+12+srcLen);
+        jbyteArray data;
+        jobject msg;
+
+        memcpy(src, batch+pos+12, srcLen);
+        src[srcLen]=0;
+        if((*env)->PushLocalFrame(env, 4)<0)
+            break;
+        data=(*env)->NewByteArray(env, dataLen);
+        if(data!=NULL)
+        {
+            (*env)->SetByteArrayRegion(env, data, 0, dataLen, (const jbyte*)(batch+pos+16+srcLen));
+            msg=(*env)->NewObject(env, j->msgClass, j->msgConstructor, type, (*env)->NewStringUTF(env, src), data, priority);
+            if(msg!=NULL)
+            {
+                (*env)->CallStaticVoidMethod(env, j->msgMgrClass, j->postMsgMeth, msg);
+                n++;
+            }
+        }
+        if((*env)->ExceptionCheck(env))
+            (*env)->ExceptionClear(env);
+        (*env)->PopLocalFrame(env, NULL);
+        pos+=MSG_RECORD_HEADER+srcLen+dataLen;
+    }
+    return n;
+}
+#endif
+
+static void put32(unsigned char *p, unsigned int v)
+{
+    p[0]=(unsigned char)(v>>24);
+    p[1]=(unsigned char)(v>>16);
+    p[2]=(unsigned char)(v>>8);
+    p[3]=(unsigned char)v;
+}
+
+static MsgRecord *takeMsg(MsgQueue *q)
+{
+    MsgSlot *slot=&q->slot[q->head&(MSG_QUEUE_SLOTS-1)];
+    MsgRecord *rec;
+
+    if(__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE)!=q->head+1)
+        return NULL;
+    rec=slot->rec;
+    __atomic_store_n(&slot->seq, q->head+MSG_QUEUE_SLOTS, __ATOMIC_RELEASE);
+    __atomic_store_n(&q->head, q->head+1, __ATOMIC_RELEASE);
+    return rec;
+}
+
+static void deliverBatch(MsgQueue *q, int bytes, int msgs)
+{
+    int n=q->deliver!=NULL ? q->deliver(q->context, q->batch, bytes, msgs) : 0;
+    if(n<0)
+        n=0;
+    else if(n>msgs)
+        n=msgs;
+    COUNT(&q->delivered, n);
+    COUNT(&q->dropped, msgs-n);
+    COUNT(&q->batches, 1);
+}
+
+static void *DispatchThread(void *data)
+{
+    MsgQueue *q=(MsgQueue *)data;
+    int bytes=0, msgs=0;
+
+    for(;;)
+    {
+        MsgRecord *rec=takeMsg(q);
+        if(rec!=NULL)
+        {
+            if(bytes+rec->bytes>MSG_BATCH_SIZE)
+            {
+                deliverBatch(q, bytes, msgs);
+                bytes=msgs=0;
+            }
+            memcpy(q->batch+bytes, rec->data, rec->bytes);
+            bytes+=rec->bytes;
+            msgs++;
+            free(rec);
+            continue;
+        }
+        // the ring ran dry, whatever piled up while the last batch was out goes as one
+        if(msgs)
+        {
+            deliverBatch(q, bytes, msgs);
+            bytes=msgs=0;
+            continue;
+        }
+        if(FLAG_LOAD(&q->stop))
+            break;
+
+        // a producer that published after the check below sees waiting and writes the event
+        FLAG_STORE(&q->waiting, 1);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if(__atomic_load_n(&q->slot[q->head&(MSG_QUEUE_SLOTS-1)].seq, __ATOMIC_ACQUIRE)!=q->head+1 &&
+           !FLAG_LOAD(&q->stop))
+        {
+            struct pollfd pfd;
+            unsigned long long val;
+            pfd.fd=q->efd;
+            pfd.events=POLLIN;
+            if(poll(&pfd, 1, MSG_WAIT_MS)>0)
+                if(read(q->efd, &val, sizeof(val))<0) {}
+            FLAG_STORE(&q->waiting, 0);
+            if(!FLAG_LOAD(&q->stop))
+                usleep(MSG_LINGER_US);
+        }
+        FLAG_STORE(&q->waiting, 0);
+    }
+#ifndef STANDALONE
+    if(q->context==&javaDeliver)
+        detachJava(&javaDeliver);
+#endif
+    return NULL;
+}
+
+static void startMsgQueue(void)
+{
+    MsgQueue *q=&queue;
+    unsigned long i;
+
+    for(i=0; i<MSG_QUEUE_SLOTS; i++)
+        q->slot[i].seq=i;
+#ifndef STANDALONE
+    if(q->deliver==NULL)
+    {
+        q->deliver=deliverJava;
+        q->context=&javaDeliver;
+    }
+#endif
+    q->efd=eventfd(0, EFD_NONBLOCK|EFD_CLOEXEC);
+    if(q->efd<0)
+        return;
+    if(pthread_create(&q->thread, NULL, DispatchThread, q))
+    {
+        close(q->efd);
+        q->efd=-1;
+        return;
+    }
+    FLAG_STORE(&q->running, 1);
+}
+
+int postQueuedMessage(const char *pSrc, const char *pData, int nDataLen, int nMsgType, int nPriority)
+{
+    MsgQueue *q=&queue;
+    int srcLen=pSrc!=NULL ? (int)strlen(pSrc) : 0;
+    unsigned long pos, head;
+    unsigned int depth, maxDepth;
+    MsgRecord *rec;
+    MsgSlot *slot;
+
+    pthread_once(&queueOnce, startMsgQueue);
+    if(srcLen>MSG_MAX_SOURCE)
+        srcLen=MSG_MAX_SOURCE;
+    if(!FLAG_LOAD(&q->running) || FLAG_LOAD(&q->stop) || nDataLen<0 || nDataLen>MSG_MAX_DATA ||
+       (rec=(MsgRecord *)malloc(sizeof(MsgRecord)+srcLen+nDataLen))==NULL)
+    {
+        COUNT(&q->dropped, 1);
+        return 0;
+    }
+    rec->bytes=MSG_RECORD_HEADER+srcLen+nDataLen;
+    put32(rec->data, nMsgType);
+    put32(rec->data+4, nPriority);
+    put32(rec->data+8, srcLen);
+    memcpy(rec->data+12, pSrc, srcLen);
+    put32(rec->data+12+srcLen, nDataLen);
+    memcpy(rec->data+16+srcLen, pData, nDataLen);
+
+    pos=__atomic_load_n(&q->tail, __ATOMIC_RELAXED);
+    for(;;)
+    {
+        long dif;
+        slot=&q->slot[pos&(MSG_QUEUE_SLOTS-1)];
+        dif=(long)(__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE)-pos);
+        if(dif==0)
+        {
+            if(__atomic_compare_exchange_n(&q->tail, &pos, pos+1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                break;
+        }
+        else if(dif<0)
+        {
+            // full, the dispatcher is a ring behind
+            free(rec);
+            COUNT(&q->dropped, 1);
+            return 0;
+        }
+        else
+            pos=__atomic_load_n(&q->tail, __ATOMIC_RELAXED);
+    }
+    slot->rec=rec;
+    __atomic_store_n(&slot->seq, pos+1, __ATOMIC_RELEASE);
+    COUNT(&q->posted, 1);
+
+    head=__atomic_load_n(&q->head, __ATOMIC_RELAXED);
+    depth=(unsigned int)(pos+1-head);
+    maxDepth=__atomic_load_n(&q->maxDepth, __ATOMIC_RELAXED);
+    while(depth<=MSG_QUEUE_SLOTS && depth>maxDepth &&
+          !__atomic_compare_exchange_n(&q->maxDepth, &maxDepth, depth, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if(FLAG_LOAD(&q->waiting))
+    {
+        unsigned long long one=1;
+        if(write(q->efd, &one, sizeof(one))<0) {}
+    }
+    return 1;
+}
+
+void setMsgQueueDeliver(MsgQueueDeliver deliver, void *context)
+{
+    queue.deliver=deliver;
+    queue.context=context;
+}
+
+void stopMsgQueue(void)
+{
+    MsgQueue *q=&queue;
+    unsigned long long one=1;
+
+    if(!FLAG_LOAD(&q->running) || FLAG_LOAD(&q->stop))
+        return;
+    FLAG_STORE(&q->stop, 1);
+    if(write(q->efd, &one, sizeof(one))<0) {}
+    pthread_join(q->thread, NULL);
+    close(q->efd);
+    q->efd=-1;
+}
+
+void statsMsgQueue(MsgQueueStats *stats)
+{
+    MsgQueue *q=&queue;
+    unsigned long tail=__atomic_load_n(&q->tail, __ATOMIC_RELAXED);
+    unsigned long head=__atomic_load_n(&q->head, __ATOMIC_RELAXED);
+
+    stats->posted=__atomic_load_n(&q->posted, __ATOMIC_RELAXED);
+    stats->delivered=__atomic_load_n(&q->delivered, __ATOMIC_RELAXED);
+    stats->dropped=__atomic_load_n(&q->dropped, __ATOMIC_RELAXED);
+    stats->batches=__atomic_load_n(&q->batches, __ATOMIC_RELAXED);
+    stats->depth=tail>head ? (unsigned int)(tail-head) : 0;
+    stats->maxDepth=__atomic_load_n(&q->maxDepth, __ATOMIC_RELAXED);
+}
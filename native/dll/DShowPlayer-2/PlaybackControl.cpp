@@ -354,6 +354,9 @@ extern "C" {
 #endif
 extern int __cdecl GetAVFormatW( wchar_t* FileName, unsigned long CheckSize, int bLiveFile, int RequestedTSProgram, 
 			   char* FormatBuf, int FormatSize, char* DurationBuf, int DurationSize, int* Program );
+extern void* __cdecl OpenAVProbeW( wchar_t* FileName, unsigned long CheckSize, int bLiveFile );
+extern int __cdecl GetProbeAVFormat( void* Handle, int Index, char* FormatBuf, int FormatSize, char* DurationBuf, int DurationSize, int* Program );
+extern void __cdecl CloseAVProbe( void* Handle );
 extern ULONGLONG __cdecl   hs_long_long( char* digital );
 extern int __cdecl ms_time_stamp( ULONGLONG llTime, char* pBuffer, int nSize );
 extern int __cdecl _flog_check();
@@ -391,12 +394,12 @@ JNIEXPORT jstring JNICALL Java_sage_media_format_MPEGParser_getMediaAVInf0
 				            Format, sizeof(Format), Duration, sizeof(Duration), &TotalProgramNum  );
 		
 	} else
-	{ //Search first one valid channel MedAVInf
+	{ //Search first one valid channel MedAVInf, all channels are probed in one pass of file
 
+		void* Probe = OpenAVProbeW( (wchar_t*)szFilename, (unsigned long)jSearchSize, LiveFile );
 		Channel = 0;
 		do {
-			ret = GetAVFormatW((wchar_t*)szFilename, (unsigned long)jSearchSize, LiveFile, Channel+1, 
-				          Format, sizeof(Format), Duration, sizeof(Duration), &TotalProgramNum );
+			ret = GetProbeAVFormat( Probe, Channel, Format, sizeof(Format), Duration, sizeof(Duration), &TotalProgramNum );
 
 			if ( Format[0] == 0x0 || strstr(  Format, "ENCRYPTED-TS;" ) || strstr( Format, "NO-DATA;" ) ||
 				strstr( Format, "UNKNOWN-TS;"  ) || strstr( Format, "UNKNOWN-PS;"  ) || strstr(  Format, "NO-AV-TS;" ) )
@@ -405,6 +408,7 @@ JNIEXPORT jstring JNICALL Java_sage_media_format_MPEGParser_getMediaAVInf0
 				break;
 
 		} while( Channel < TotalProgramNum );
+		CloseAVProbe( Probe );
 
 	}
 	env->ReleaseStringChars(jFilename, szFilename);
@@ -36,7 +36,7 @@
 #include <aud/aud_inf.h>
 #include "../thread_util.h"
 #include "../subdecoder.h"
-#include "../circbuffer.h"
+#include "spscring.h"
 
 //#define DEBUGPTSOFFSET
 //#define DEBUGSTB
@@ -80,10 +80,10 @@ typedef struct
 	int vidmaplength;
 	void* vidbase;
     
-	circBuffer pesbuffer; 
-	circBuffer audpesbuffer;
-	circBuffer vidpesbuffer;
-	circBuffer sppesbuffer;
+	spscRing pesbuffer; 
+	spscRing audpesbuffer;
+	spscRing vidpesbuffer;
+	spscRing sppesbuffer;
 	long long vidpts;
 	long long audpts;
 	int fastmode;    
@@ -162,7 +162,7 @@ int SendVideoBlock(STBInfo *si, int flags)
     CLIPINFO  info;
     int nbuf;
     if(si->vidcliplen>(60*1024) || (flags!=0 && si->vidcliplen>0 
-        && usedspaceCircBuffer(&si->vidpesbuffer)<65536) || (si->seqend && si->vidcliplen>0))
+        && usedspaceSPSCRing(&si->vidpesbuffer)<65536) || (si->seqend && si->vidcliplen>0))
     {        
         ioctl(si->m2vfd, MPEG_VID_GET_CLIP_BUFFERS, &nbuf);
         if(nbuf>0)
@@ -196,7 +196,7 @@ int SendAudioBlock(STBInfo *si, int flags)
 {
     int nbuf;
     if(si->audcliplen>(6*1024) || (flags!=0 && si->audcliplen>0 
-        && usedspaceCircBuffer(&si->audpesbuffer)<8192))
+        && usedspaceSPSCRing(&si->audpesbuffer)<8192))
     {
         ioctl(si->audfd, MPEG_AUD_GET_CLIP_BUFFERS, &nbuf);
         if(nbuf>0)
@@ -213,33 +213,33 @@ int SendAudioBlock(STBInfo *si, int flags)
     return 0;
 }                
 
-int STBWriteBlock2(STBInfo *si, circBuffer *buf, int len)
+int STBWriteBlock2(STBInfo *si, spscRing *buf, int len)
 {
     int sent=0;
 #ifdef DEBUGSTB
-    fprintf(stderr, "STBwriteBlock len %d type %d\n",len, getByteCircBuffer(buf,3));
+    fprintf(stderr, "STBwriteBlock len %d type %d\n",len, peekByteSPSCRing(buf,3));
 #endif
     SYNCINFO time,time2;
     
     int ptshi=0;
     int ptslo=0;
     
-    if(getByteCircBuffer(buf,7)&0x80) /* has pts */
+    if(peekByteSPSCRing(buf,7)&0x80) /* has pts */
     {
-        ptshi=(getByteCircBuffer(buf, 4+5)&0x08)>>3;
-        ptslo=((getByteCircBuffer(buf, 4+5)&0x06)>>1)<<30;
-        ptslo|=((getByteCircBuffer(buf, 4+6)&0xFF)>>0)<<22;
-        ptslo|=((getByteCircBuffer(buf, 4+7)&0xFE)>>1)<<15;
-        ptslo|=((getByteCircBuffer(buf, 4+8)&0xFF)>>0)<<7;
-        ptslo|=((getByteCircBuffer(buf, 4+9)&0xFE)>>1)<<0;
+        ptshi=(peekByteSPSCRing(buf, 4+5)&0x08)>>3;
+        ptslo=((peekByteSPSCRing(buf, 4+5)&0x06)>>1)<<30;
+        ptslo|=((peekByteSPSCRing(buf, 4+6)&0xFF)>>0)<<22;
+        ptslo|=((peekByteSPSCRing(buf, 4+7)&0xFE)>>1)<<15;
+        ptslo|=((peekByteSPSCRing(buf, 4+8)&0xFF)>>0)<<7;
+        ptslo|=((peekByteSPSCRing(buf, 4+9)&0xFE)>>1)<<0;
 //        fprintf(stderr, "Block %02X has PTS: %d %d\n", buf[3], ptshi, ptslo);
-        if(getByteCircBuffer(buf, 3)==0xE0)
+        if(peekByteSPSCRing(buf, 3)==0xE0)
         {
             si->vidpts=ptshi;
             si->vidpts<<=32;
             si->vidpts|=ptslo;
         }
-        if(getByteCircBuffer(buf, 3)==(si->audiosub>>8))
+        if(peekByteSPSCRing(buf, 3)==(si->audiosub>>8))
         {
             if(si->audpts==-1)
             {
@@ -261,7 +261,7 @@ int STBWriteBlock2(STBInfo *si, circBuffer *buf, int len)
         }
     }
         
-    if(getByteCircBuffer(buf, 3)==0xE0)
+    if(peekByteSPSCRing(buf, 3)==0xE0)
     {
         int origlen;
         if(si->vidpts==-1)
@@ -269,13 +269,13 @@ int STBWriteBlock2(STBInfo *si, circBuffer *buf, int len)
 #ifdef DEBUGPTS
             fprintf(stderr, "Discarding video block with no pts\n");
 #endif
-            dropCircBuffer(buf, len);
+            dropSPSCRing(buf, len);
             return 1; // Discard the block
         }
-        if(getByteCircBuffer(buf, len-4)==0x00 &&
-           getByteCircBuffer(buf, len-3)==0x00 &&
-           getByteCircBuffer(buf, len-2)==0x01 &&
-           getByteCircBuffer(buf, len-1)==0xB7)
+        if(peekByteSPSCRing(buf, len-4)==0x00 &&
+           peekByteSPSCRing(buf, len-3)==0x00 &&
+           peekByteSPSCRing(buf, len-2)==0x01 &&
+           peekByteSPSCRing(buf, len-1)==0xB7)
         {
             fprintf(stderr, "Detected sequence end in video stream\n");
             si->seqend+=1;
@@ -283,9 +283,9 @@ int STBWriteBlock2(STBInfo *si, circBuffer *buf, int len)
         
         if((65536 - si->vidcliplen) >= len)
         {
-            getCircBuffer(buf, si->vidclipbuffer + si->vidcliplen, len);
+            getSPSCRing(buf, si->vidclipbuffer + si->vidcliplen, len);
             si->vidcliplen+=len;
-            if(si->seqend==1 && usedspaceCircBuffer(buf)==0)
+            if(si->seqend==1 && usedspaceSPSCRing(buf)==0)
             {
                 fprintf(stderr, "Adding forced next frame\n");
                 origlen=(si->vidclipbuffer[si->vidcliplen-len+4]<<8) |
@@ -294,7 +294,7 @@ int STBWriteBlock2(STBInfo *si, circBuffer *buf, int len)
                 si->vidclipbuffer[si->vidcliplen-len+4]=origlen>>8;
                 si->vidclipbuffer[si->vidcliplen-len+5]=origlen;
                 si->vidcliplen-=4;
-                addCircBuffer(buf, testpframe, 0x129+9+4);
+                addSPSCRing(buf, testpframe, 0x129+9+4);
             }
             sent=1;
         }
@@ -303,9 +303,9 @@ int STBWriteBlock2(STBInfo *si, circBuffer *buf, int len)
             SendVideoBlock(si, 0);
             if((sent==0) && (65536 - si->vidcliplen) >= len)
             {
-                getCircBuffer(buf, si->vidclipbuffer + si->vidcliplen, len);
+                getSPSCRing(buf, si->vidclipbuffer + si->vidcliplen, len);
                 si->vidcliplen+=len;
-                if(si->seqend==1 && usedspaceCircBuffer(buf)==0)
+                if(si->seqend==1 && usedspaceSPSCRing(buf)==0)
                 {
                     fprintf(stderr, "Adding forced next frame\n");
                     origlen=(si->vidclipbuffer[si->vidcliplen-len+4]<<8) |
@@ -314,28 +314,28 @@ int STBWriteBlock2(STBInfo *si, circBuffer *buf, int len)
                     si->vidclipbuffer[si->vidcliplen-len+4]=origlen>>8;
                     si->vidclipbuffer[si->vidcliplen-len+5]=origlen;
                     si->vidcliplen-=4;
-                    addCircBuffer(buf, testpframe, 0x129+9+4);
+                    addSPSCRing(buf, testpframe, 0x129+9+4);
                 }
                 sent=1;
             }
         }
         return sent;
     }
-    else if(getByteCircBuffer(buf, 3)==(si->audiosub>>8))
+    else if(peekByteSPSCRing(buf, 3)==(si->audiosub>>8))
     {
         if(si->audpts==-1)
         {
 #ifdef DEBUGPTS
             fprintf(stderr, "Discarding audio block until we get audio with pts\n");
 #endif
-            dropCircBuffer(buf, len);
+            dropSPSCRing(buf, len);
             return 1; // Discard the block
         }
         
         if(si->mode!=0) 
         {
             // discard audio packets in fast forward mode...
-            dropCircBuffer(buf, len);
+            dropSPSCRing(buf, len);
             return 1;
         }
         
@@ -346,20 +346,20 @@ int STBWriteBlock2(STBInfo *si, circBuffer *buf, int len)
                 int packetlen;
                 int headerlen;
                 // Discard if not right subtype
-                if(getByteCircBuffer(buf, getByteCircBuffer(buf, 8)+9)!=(si->audiosub&0xFF))
+                if(peekByteSPSCRing(buf, peekByteSPSCRing(buf, 8)+9)!=(si->audiosub&0xFF))
                 {
-                    dropCircBuffer(buf, len);
+                    dropSPSCRing(buf, len);
                     return 1;
                 }
                 
                 // copy 4 bytes header
-                getCircBuffer(buf, si->audclipbuffer + si->audcliplen, 4);
+                getSPSCRing(buf, si->audclipbuffer + si->audcliplen, 4);
                 si->audcliplen+=4;
                 
                 // copy packet len
-                packetlen=getByteCircBuffer(buf, 0)<<8;
-                packetlen|=getByteCircBuffer(buf, 1);
-                dropCircBuffer(buf, 2);
+                packetlen=peekByteSPSCRing(buf, 0)<<8;
+                packetlen|=peekByteSPSCRing(buf, 1);
+                dropSPSCRing(buf, 2);
                 packetlen-=4;
                 
                 // write new len in buffer
@@ -370,23 +370,23 @@ int STBWriteBlock2(STBInfo *si, circBuffer *buf, int len)
                 si->audcliplen+=2;
                 
                 // copy header bytes
-                headerlen= 3 + getByteCircBuffer(buf, 2);
-                getCircBuffer(buf, si->audclipbuffer + si->audcliplen, 
+                headerlen= 3 + peekByteSPSCRing(buf, 2);
+                getSPSCRing(buf, si->audclipbuffer + si->audcliplen, 
                     headerlen);
                 
                 si->audcliplen+=headerlen;
                 
                 // Discard the 4 bytes dvd extra information
-                dropCircBuffer(buf, 4);
+                dropSPSCRing(buf, 4);
                 
                 // copy data bytes
-                getCircBuffer(buf, si->audclipbuffer + si->audcliplen, packetlen-headerlen);
+                getSPSCRing(buf, si->audclipbuffer + si->audcliplen, packetlen-headerlen);
                 
                 si->audcliplen+=packetlen-headerlen;
             }
             else
             {
-                getCircBuffer(buf, si->audclipbuffer + si->audcliplen, len);
+                getSPSCRing(buf, si->audclipbuffer + si->audcliplen, len);
                 si->audcliplen+=len;
             }
             sent=1;
@@ -401,20 +401,20 @@ int STBWriteBlock2(STBInfo *si, circBuffer *buf, int len)
                     int packetlen;
                     int headerlen;
                     // Discard if not right subtype
-                    if(getByteCircBuffer(buf, getByteCircBuffer(buf, 8)+9)!=(si->audiosub&0xFF))
+                    if(peekByteSPSCRing(buf, peekByteSPSCRing(buf, 8)+9)!=(si->audiosub&0xFF))
                     {
-                        dropCircBuffer(buf, len);
+                        dropSPSCRing(buf, len);
                         return 1;
                     }
                     
                     // copy 4 bytes header
-                    getCircBuffer(buf, si->audclipbuffer + si->audcliplen, 4);
+                    getSPSCRing(buf, si->audclipbuffer + si->audcliplen, 4);
                     si->audcliplen+=4;
                     
                     // copy packet len
-                    packetlen=getByteCircBuffer(buf, 0)<<8;
-                    packetlen|=getByteCircBuffer(buf, 1);
-                    dropCircBuffer(buf, 2);
+                    packetlen=peekByteSPSCRing(buf, 0)<<8;
+                    packetlen|=peekByteSPSCRing(buf, 1);
+                    dropSPSCRing(buf, 2);
                     packetlen-=4;
                     
                     // write new len in buffer
@@ -425,23 +425,23 @@ int STBWriteBlock2(STBInfo *si, circBuffer *buf, int len)
                     si->audcliplen+=2;
                     
                     // copy header bytes
-                    headerlen= 3 + getByteCircBuffer(buf, 2);
-                    getCircBuffer(buf, si->audclipbuffer + si->audcliplen, 
+                    headerlen= 3 + peekByteSPSCRing(buf, 2);
+                    getSPSCRing(buf, si->audclipbuffer + si->audcliplen, 
                         headerlen);
                     
                     si->audcliplen+=headerlen;
                     
                     // Discard the 4 bytes dvd extra information
-                    dropCircBuffer(buf, 4);
+                    dropSPSCRing(buf, 4);
                     
                     // copy data bytes
-                    getCircBuffer(buf, si->audclipbuffer + si->audcliplen, packetlen-headerlen);
+                    getSPSCRing(buf, si->audclipbuffer + si->audcliplen, packetlen-headerlen);
                     
                     si->audcliplen+=packetlen-headerlen;
                 }
                 else
                 {
-                    getCircBuffer(buf, si->audclipbuffer + si->audcliplen, len);
+                    getSPSCRing(buf, si->audclipbuffer + si->audcliplen, len);
                     si->audcliplen+=len;
                 }
                 sent=1;
@@ -452,7 +452,7 @@ int STBWriteBlock2(STBInfo *si, circBuffer *buf, int len)
     return 1; // Discard unidentified blocks    
 }
 
-int STBWriteBlockVid(STBInfo *si, circBuffer *buf, int len)
+int STBWriteBlockVid(STBInfo *si, spscRing *buf, int len)
 {
     unsigned char b;
     unsigned int pos=0;
@@ -463,16 +463,16 @@ int STBWriteBlockVid(STBInfo *si, circBuffer *buf, int len)
     si->validvideopes=0;
     
     
-    if(len!=0 && usedspaceCircBuffer(&si->vidpesbuffer)+len < VIDBUFLEN)
+    if(len!=0 && usedspaceSPSCRing(&si->vidpesbuffer)+len < VIDBUFLEN)
     {    
-        getCircBuffer2(buf, &si->vidpesbuffer, len);
+        moveSPSCRing(buf, &si->vidpesbuffer, len);
         copied=1;
     }
     
     int cur=0xFFFFFFFF;
-    while(pos<usedspaceCircBuffer(&si->vidpesbuffer))
+    while(pos<usedspaceSPSCRing(&si->vidpesbuffer))
     {        
-        b=getByteCircBuffer(&si->vidpesbuffer, pos);
+        b=peekByteSPSCRing(&si->vidpesbuffer, pos);
         pos+=1;
         cur<<=8;
         cur|=b;
@@ -482,18 +482,18 @@ int STBWriteBlockVid(STBInfo *si, circBuffer *buf, int len)
             if(b==0xE0)
             {
                 if(pos-4>0)
-                    dropCircBuffer(&si->vidpesbuffer, pos-4);
+                    dropSPSCRing(&si->vidpesbuffer, pos-4);
 
                 /* verify we have complete packet */
-                if(usedspaceCircBuffer(&si->vidpesbuffer)>=6 &&
-                    (6+(getByteCircBuffer(&si->vidpesbuffer, 4)<<8)+
-                        getByteCircBuffer(&si->vidpesbuffer, 5)) <= 
-                        usedspaceCircBuffer(&si->vidpesbuffer))
+                if(usedspaceSPSCRing(&si->vidpesbuffer)>=6 &&
+                    (6+(peekByteSPSCRing(&si->vidpesbuffer, 4)<<8)+
+                        peekByteSPSCRing(&si->vidpesbuffer, 5)) <= 
+                        usedspaceSPSCRing(&si->vidpesbuffer))
                 {
                     si->validvideopes=1;
                     if(STBWriteBlock2(si, &si->vidpesbuffer,
-                        (6+(getByteCircBuffer(&si->vidpesbuffer, 4)<<8)+
-                        getByteCircBuffer(&si->vidpesbuffer, 5)))>0)
+                        (6+(peekByteSPSCRing(&si->vidpesbuffer, 4)<<8)+
+                        peekByteSPSCRing(&si->vidpesbuffer, 5)))>0)
                     {
                         pos=0;
                     }
@@ -510,9 +510,9 @@ int STBWriteBlockVid(STBInfo *si, circBuffer *buf, int len)
         }
     }    
     
-    if(len!=0 && copied == 0 && usedspaceCircBuffer(&si->vidpesbuffer)+len < VIDBUFLEN)
+    if(len!=0 && copied == 0 && usedspaceSPSCRing(&si->vidpesbuffer)+len < VIDBUFLEN)
     {
-        getCircBuffer2(buf, &si->vidpesbuffer, len);
+        moveSPSCRing(buf, &si->vidpesbuffer, len);
         copied=1;
     }
     
@@ -522,7 +522,7 @@ int STBWriteBlockVid(STBInfo *si, circBuffer *buf, int len)
     return copied;
 }
 
-int STBWriteBlockAud(STBInfo *si, circBuffer *buf, int len)
+int STBWriteBlockAud(STBInfo *si, spscRing *buf, int len)
 {
     unsigned char b;
     unsigned int pos=0;
@@ -532,16 +532,16 @@ int STBWriteBlockAud(STBInfo *si, circBuffer *buf, int len)
 #endif
     si->validaudiopes=0;
     
-    if(len!=0 && usedspaceCircBuffer(&si->audpesbuffer)+len < AUDBUFLEN)
+    if(len!=0 && usedspaceSPSCRing(&si->audpesbuffer)+len < AUDBUFLEN)
     {    
-        getCircBuffer2(buf, &si->audpesbuffer, len);
+        moveSPSCRing(buf, &si->audpesbuffer, len);
         copied=1;
     }
     
     int cur=0xFFFFFFFF;
-    while(pos<usedspaceCircBuffer(&si->audpesbuffer))
+    while(pos<usedspaceSPSCRing(&si->audpesbuffer))
     {        
-        b=getByteCircBuffer(&si->audpesbuffer, pos);
+        b=peekByteSPSCRing(&si->audpesbuffer, pos);
         pos+=1;
         cur<<=8;
         cur|=b;
@@ -551,18 +551,18 @@ int STBWriteBlockAud(STBInfo *si, circBuffer *buf, int len)
             if(b==(si->audiosub>>8))
             {
                 if(pos-4>0)
-                    dropCircBuffer(&si->audpesbuffer, pos-4);
+                    dropSPSCRing(&si->audpesbuffer, pos-4);
 
                 /* verify we have complete packet */
-                if(usedspaceCircBuffer(&si->audpesbuffer)>=6 &&
-                    (6+(getByteCircBuffer(&si->audpesbuffer, 4)<<8)+
-                        getByteCircBuffer(&si->audpesbuffer, 5)) <= 
-                        usedspaceCircBuffer(&si->audpesbuffer))
+                if(usedspaceSPSCRing(&si->audpesbuffer)>=6 &&
+                    (6+(peekByteSPSCRing(&si->audpesbuffer, 4)<<8)+
+                        peekByteSPSCRing(&si->audpesbuffer, 5)) <= 
+                        usedspaceSPSCRing(&si->audpesbuffer))
                 {
                     si->validaudiopes=1;
                     if(STBWriteBlock2(si, &si->audpesbuffer,
-                        (6+(getByteCircBuffer(&si->audpesbuffer, 4)<<8)+
-                        getByteCircBuffer(&si->audpesbuffer, 5)))>0)
+                        (6+(peekByteSPSCRing(&si->audpesbuffer, 4)<<8)+
+                        peekByteSPSCRing(&si->audpesbuffer, 5)))>0)
                     {
                         pos=0;
                     }
@@ -579,26 +579,26 @@ int STBWriteBlockAud(STBInfo *si, circBuffer *buf, int len)
             else // bad audio stream packet...
             {
                 if(pos-4>0)
-                    dropCircBuffer(&si->audpesbuffer, pos-4);
+                    dropSPSCRing(&si->audpesbuffer, pos-4);
 
                 /* verify we have complete packet */
-                if(usedspaceCircBuffer(&si->audpesbuffer)>=6 &&
-                    (6+(getByteCircBuffer(&si->audpesbuffer, 4)<<8)+
-                        getByteCircBuffer(&si->audpesbuffer, 5)) <= 
-                        usedspaceCircBuffer(&si->audpesbuffer))
+                if(usedspaceSPSCRing(&si->audpesbuffer)>=6 &&
+                    (6+(peekByteSPSCRing(&si->audpesbuffer, 4)<<8)+
+                        peekByteSPSCRing(&si->audpesbuffer, 5)) <= 
+                        usedspaceSPSCRing(&si->audpesbuffer))
                 {
-                    dropCircBuffer(&si->audpesbuffer, 
-                        (6+(getByteCircBuffer(&si->audpesbuffer, 4)<<8)+
-                            getByteCircBuffer(&si->audpesbuffer, 5)));
+                    dropSPSCRing(&si->audpesbuffer, 
+                        (6+(peekByteSPSCRing(&si->audpesbuffer, 4)<<8)+
+                            peekByteSPSCRing(&si->audpesbuffer, 5)));
                     pos=0;
                 }
             }
         }
     }    
     
-    if(len!=0 && copied == 0 && usedspaceCircBuffer(&si->audpesbuffer)+len < AUDBUFLEN)
+    if(len!=0 && copied == 0 && usedspaceSPSCRing(&si->audpesbuffer)+len < AUDBUFLEN)
     {
-        getCircBuffer2(buf, &si->audpesbuffer, len);
+        moveSPSCRing(buf, &si->audpesbuffer, len);
         copied=1;
     }
     
@@ -609,7 +609,7 @@ int STBWriteBlockAud(STBInfo *si, circBuffer *buf, int len)
 }
 
 
-int STBWriteBlockSubPicture(STBInfo *si, circBuffer *buf, int len)
+int STBWriteBlockSubPicture(STBInfo *si, spscRing *buf, int len)
 {
     unsigned char b;
     unsigned int pos=0;
@@ -619,16 +619,16 @@ int STBWriteBlockSubPicture(STBInfo *si, circBuffer *buf, int len)
 #endif
     si->validsppes=0;
     
-    if(len!=0 && usedspaceCircBuffer(&si->sppesbuffer)+len < SPBUFLEN)
+    if(len!=0 && usedspaceSPSCRing(&si->sppesbuffer)+len < SPBUFLEN)
     {    
-        getCircBuffer2(buf, &si->sppesbuffer, len);
+        moveSPSCRing(buf, &si->sppesbuffer, len);
         copied=1;
     }
     
     int cur=0xFFFFFFFF;
-    while(pos<usedspaceCircBuffer(&si->sppesbuffer))
+    while(pos<usedspaceSPSCRing(&si->sppesbuffer))
     {        
-        b=getByteCircBuffer(&si->sppesbuffer, pos);
+        b=peekByteSPSCRing(&si->sppesbuffer, pos);
         pos+=1;
         cur<<=8;
         cur|=b;
@@ -638,18 +638,18 @@ int STBWriteBlockSubPicture(STBInfo *si, circBuffer *buf, int len)
             if(b==0xBD)
             {
                 if(pos-4>0)
-                    dropCircBuffer(&si->sppesbuffer, pos-4);
+                    dropSPSCRing(&si->sppesbuffer, pos-4);
 
                 /* verify we have complete packet */
-                if(usedspaceCircBuffer(&si->sppesbuffer)>=6 &&
-                    (6+(getByteCircBuffer(&si->sppesbuffer, 4)<<8)+
-                        getByteCircBuffer(&si->sppesbuffer, 5)) <= 
-                        usedspaceCircBuffer(&si->sppesbuffer))
+                if(usedspaceSPSCRing(&si->sppesbuffer)>=6 &&
+                    (6+(peekByteSPSCRing(&si->sppesbuffer, 4)<<8)+
+                        peekByteSPSCRing(&si->sppesbuffer, 5)) <= 
+                        usedspaceSPSCRing(&si->sppesbuffer))
                 {
                     si->validsppes=1;
                     if(SubpictureAddBlock(si->sphandle, &si->sppesbuffer,
-                        (6+(getByteCircBuffer(&si->sppesbuffer, 4)<<8)+
-                        getByteCircBuffer(&si->sppesbuffer, 5)))>0)
+                        (6+(peekByteSPSCRing(&si->sppesbuffer, 4)<<8)+
+                        peekByteSPSCRing(&si->sppesbuffer, 5)))>0)
                     {
                         pos=0;
                     }
@@ -666,9 +666,9 @@ int STBWriteBlockSubPicture(STBInfo *si, circBuffer *buf, int len)
         }
     }    
     
-    if(len!=0 && copied == 0 && usedspaceCircBuffer(&si->sppesbuffer)+len < SPBUFLEN)
+    if(len!=0 && copied == 0 && usedspaceSPSCRing(&si->sppesbuffer)+len < SPBUFLEN)
     {
-        getCircBuffer2(buf, &si->sppesbuffer, len);
+        moveSPSCRing(buf, &si->sppesbuffer, len);
         copied=1;
     }
 
@@ -679,9 +679,9 @@ int STBWriteBlockSubPicture(STBInfo *si, circBuffer *buf, int len)
 
 }
 
-int STBWriteBlock(STBInfo *si, circBuffer *buf, int len)
+int STBWriteBlock(STBInfo *si, spscRing *buf, int len)
 {
-    if(getByteCircBuffer(buf,3)==0xE0)
+    if(peekByteSPSCRing(buf,3)==0xE0)
     {
         si->hasvideo=1;
         if(STBWriteBlockVid(si, buf, len))
@@ -693,11 +693,11 @@ int STBWriteBlock(STBInfo *si, circBuffer *buf, int len)
             return 0;
         }
     }
-    else if(getByteCircBuffer(buf, 3)==(si->audiosub>>8) || getByteCircBuffer(buf, 3)==0xBD)
+    else if(peekByteSPSCRing(buf, 3)==(si->audiosub>>8) || peekByteSPSCRing(buf, 3)==0xBD)
     {
         // Test subchannel if dvd audio
-        if(getByteCircBuffer(buf, 3)==0xBD && 
-            getByteCircBuffer(buf, getByteCircBuffer(buf, 8)+9) == si->picsub)
+        if(peekByteSPSCRing(buf, 3)==0xBD && 
+            peekByteSPSCRing(buf, peekByteSPSCRing(buf, 8)+9) == si->picsub)
         {
             if(STBWriteBlockSubPicture(si, buf, len))
             {
@@ -711,9 +711,9 @@ int STBWriteBlock(STBInfo *si, circBuffer *buf, int len)
         if(si->audiomode==2)
         {
             // Discard if not right subtype
-            if(getByteCircBuffer(buf, getByteCircBuffer(buf, 8)+9) != (si->audiosub&0xFF))
+            if(peekByteSPSCRing(buf, peekByteSPSCRing(buf, 8)+9) != (si->audiosub&0xFF))
             {
-                dropCircBuffer(buf, len);
+                dropSPSCRing(buf, len);
                 return 1;
             }
         }
@@ -735,15 +735,15 @@ int STBdemux(STBInfo *si, unsigned char *critArr, int jsize, int flags)
 #ifdef DEBUGSTB    
     fprintf(stderr, "Demuxing\n");
 #endif
-    addCircBuffer(&si->pesbuffer, critArr, jsize);
+    addSPSCRing(&si->pesbuffer, critArr, jsize);
     
     unsigned char b;
     unsigned int didwork=0;
     unsigned int pos=0;
     int cur=0xFFFFFFFF;
-    while(pos<usedspaceCircBuffer(&si->pesbuffer))
+    while(pos<usedspaceSPSCRing(&si->pesbuffer))
     {        
-        b=getByteCircBuffer(&si->pesbuffer, pos);
+        b=peekByteSPSCRing(&si->pesbuffer, pos);
         pos+=1;
         cur<<=8;
         cur|=b;
@@ -756,19 +756,19 @@ int STBdemux(STBInfo *si, unsigned char *critArr, int jsize, int flags)
                 didwork=1;
                 // drop bytes up to pos-4
                 if(pos-4>0)
-                    dropCircBuffer(&si->pesbuffer, pos-4);
+                    dropSPSCRing(&si->pesbuffer, pos-4);
 
                 /* verify we have complete packet */
-                if(usedspaceCircBuffer(&si->pesbuffer)>=6 &&
-                    (6+(getByteCircBuffer(&si->pesbuffer, 4)<<8)+
-                        getByteCircBuffer(&si->pesbuffer, 5)) <= 
-                        usedspaceCircBuffer(&si->pesbuffer))
+                if(usedspaceSPSCRing(&si->pesbuffer)>=6 &&
+                    (6+(peekByteSPSCRing(&si->pesbuffer, 4)<<8)+
+                        peekByteSPSCRing(&si->pesbuffer, 5)) <= 
+                        usedspaceSPSCRing(&si->pesbuffer))
                 {
                     didwork=1;
                     // Try to write the packet in the pes buffers
                     if(STBWriteBlock(si,&si->pesbuffer,
-                        6+(getByteCircBuffer(&si->pesbuffer, 4)<<8)+
-                        getByteCircBuffer(&si->pesbuffer, 5))
+                        6+(peekByteSPSCRing(&si->pesbuffer, 4)<<8)+
+                        peekByteSPSCRing(&si->pesbuffer, 5))
                         > 0)
                     {
                         // STBWriteBlock took the data out
@@ -792,11 +792,11 @@ int STBdemux(STBInfo *si, unsigned char *critArr, int jsize, int flags)
                 didwork=1;
                 // drop bytes up to pos-4
                 if(pos-4>0)
-                    dropCircBuffer(&si->pesbuffer, pos-4);
+                    dropSPSCRing(&si->pesbuffer, pos-4);
                 /* verify we have complete packet */
-                if(usedspaceCircBuffer(&si->pesbuffer)>=14)
+                if(usedspaceSPSCRing(&si->pesbuffer)>=14)
                 {
-                    dropCircBuffer(&si->pesbuffer, 14);
+                    dropSPSCRing(&si->pesbuffer, 14);
                     pos=0;
                 }
                 else
@@ -810,16 +810,16 @@ int STBdemux(STBInfo *si, unsigned char *critArr, int jsize, int flags)
                 didwork=1;
                 // drop bytes up to pos-4
                 if(pos-4>0)
-                    dropCircBuffer(&si->pesbuffer, pos-4);
+                    dropSPSCRing(&si->pesbuffer, pos-4);
                 
                 /* verify we have complete packet */
-                if(usedspaceCircBuffer(&si->pesbuffer)>=6 &&
-                    (6+(getByteCircBuffer(&si->pesbuffer, 4)<<8)+
-                        getByteCircBuffer(&si->pesbuffer, 5)) <= 
-                        usedspaceCircBuffer(&si->pesbuffer))
+                if(usedspaceSPSCRing(&si->pesbuffer)>=6 &&
+                    (6+(peekByteSPSCRing(&si->pesbuffer, 4)<<8)+
+                        peekByteSPSCRing(&si->pesbuffer, 5)) <= 
+                        usedspaceSPSCRing(&si->pesbuffer))
                 {
-                    dropCircBuffer(&si->pesbuffer, 6+(getByteCircBuffer(&si->pesbuffer, 4)<<8)+
-                        getByteCircBuffer(&si->pesbuffer, 5));
+                    dropSPSCRing(&si->pesbuffer, 6+(peekByteSPSCRing(&si->pesbuffer, 4)<<8)+
+                        peekByteSPSCRing(&si->pesbuffer, 5));
                     pos=0;
                 }
                 else
@@ -833,16 +833,16 @@ int STBdemux(STBInfo *si, unsigned char *critArr, int jsize, int flags)
                 didwork=1;
                 // drop bytes up to pos-4
                 if(pos-4>0)
-                    dropCircBuffer(&si->pesbuffer, pos-4);
+                    dropSPSCRing(&si->pesbuffer, pos-4);
                 
                 /* verify we have complete packet */
-                if(usedspaceCircBuffer(&si->pesbuffer)>=6 &&
-                    (6+(getByteCircBuffer(&si->pesbuffer, 4)<<8)+
-                        getByteCircBuffer(&si->pesbuffer, 5)) <= 
-                        usedspaceCircBuffer(&si->pesbuffer))
+                if(usedspaceSPSCRing(&si->pesbuffer)>=6 &&
+                    (6+(peekByteSPSCRing(&si->pesbuffer, 4)<<8)+
+                        peekByteSPSCRing(&si->pesbuffer, 5)) <= 
+                        usedspaceSPSCRing(&si->pesbuffer))
                 {
-                    dropCircBuffer(&si->pesbuffer, 6+(getByteCircBuffer(&si->pesbuffer, 4)<<8)+
-                        getByteCircBuffer(&si->pesbuffer, 5));
+                    dropSPSCRing(&si->pesbuffer, 6+(peekByteSPSCRing(&si->pesbuffer, 4)<<8)+
+                        peekByteSPSCRing(&si->pesbuffer, 5));
                     pos=0;
                 }
                 else
@@ -976,35 +976,35 @@ int Media_init(int videoFormat)
         ioctl(si->m2vfd, MPEG_VID_SET_DISPMODE, VID_DISPMODE_NORM);
     }
 
-	if(createCircBuffer(&si->audpesbuffer, AUDBUFLEN)==0)
+	if(createSPSCRing(&si->audpesbuffer, AUDBUFLEN)==0)
 	{
 		close(si->m2vfd);
 		free(si);
 		return 0;
 	}
     
-	if(createCircBuffer(&si->vidpesbuffer, VIDBUFLEN)==0)
+	if(createSPSCRing(&si->vidpesbuffer, VIDBUFLEN)==0)
 	{
-		free(si->audpesbuffer.data);
+		freeSPSCRing(&si->audpesbuffer);
 		close(si->m2vfd);
 		free(si);
 		return 0;
 	}
 
-	if(createCircBuffer(&si->sppesbuffer, SPBUFLEN)==0)
+	if(createSPSCRing(&si->sppesbuffer, SPBUFLEN)==0)
 	{
-		free(si->audpesbuffer.data);
-		free(si->vidpesbuffer.data);
+		freeSPSCRing(&si->audpesbuffer);
+		freeSPSCRing(&si->vidpesbuffer);
 		close(si->m2vfd);
 		free(si);
 		return 0;
 	}
     
-	if(createCircBuffer(&si->pesbuffer, PESBUFLEN)==0)
+	if(createSPSCRing(&si->pesbuffer, PESBUFLEN)==0)
 	{
-		free(si->sppesbuffer.data);
-		free(si->audpesbuffer.data);
-		free(si->vidpesbuffer.data);
+		freeSPSCRing(&si->sppesbuffer);
+		freeSPSCRing(&si->audpesbuffer);
+		freeSPSCRing(&si->vidpesbuffer);
 		close(si->m2vfd);
 		free(si);
 		return 0;
@@ -1078,7 +1078,7 @@ static int Media_reinitAudio(int mode)
 	ioctl(si->audfd, MPEG_AUD_SET_MUTE, 0);
 	ioctl(si->audfd, MPEG_AUD_SYNC_ON, 1); // 1
 	ioctl(si->audfd, MPEG_AUD_SET_SYNC_STC, &zerostc);
-	resetCircBuffer(&si->audpesbuffer);
+	resetSPSCRing(&si->audpesbuffer);
 
 	ioctl(si->audfd, MPEG_AUD_STOP, 1);
 	close(si->audfd);
@@ -1241,10 +1241,10 @@ int Media_Flush()
 	ioctl(si->audfd, MPEG_AUD_SET_SYNC_STC, &zerostc);
 	ioctl(si->m2vfd, MPEG_VID_SET_SFM, VID_SFM_NORMAL);
 	ResetSubpicture(si->sphandle);
-	resetCircBuffer(&si->pesbuffer); 
-	resetCircBuffer(&si->audpesbuffer);
-	resetCircBuffer(&si->vidpesbuffer);
-	resetCircBuffer(&si->sppesbuffer);
+	resetSPSCRing(&si->pesbuffer); 
+	resetSPSCRing(&si->audpesbuffer);
+	resetSPSCRing(&si->vidpesbuffer);
+	resetSPSCRing(&si->sppesbuffer);
 	si->audcliplen=0;
 	si->vidcliplen=0;
 	si->vidpts=-1;
@@ -1320,13 +1320,13 @@ int Media_deinit()
 		SubpictureDeinit(si->sphandle);
     
 	if(si->pesbuffer.data)
-		free(si->pesbuffer.data);
+		freeSPSCRing(&si->pesbuffer);
 	if(si->audpesbuffer.data)
-		free(si->audpesbuffer.data);
+		freeSPSCRing(&si->audpesbuffer);
 	if(si->vidpesbuffer.data)
-		free(si->vidpesbuffer.data);
+		freeSPSCRing(&si->vidpesbuffer);
 	if(si->sppesbuffer.data)
-		free(si->sppesbuffer.data);
+		freeSPSCRing(&si->sppesbuffer);
 	if(si->vidclipbuffer)
 		free(si->vidclipbuffer);
 	if(si->audclipbuffer)
@@ -1341,10 +1341,10 @@ int Media_deinit()
 }
 
 
-int fixPTSBlock(STBInfo *si, circBuffer *buf, int len)
+int fixPTSBlock(STBInfo *si, spscRing *buf, int len)
 {
 #ifdef DEBUGSTB
-    fprintf(stderr, "fixPTSBlock len %d type %d\n",len, getByteCircBuffer(buf,3));
+    fprintf(stderr, "fixPTSBlock len %d type %d\n",len, peekByteSPSCRing(buf,3));
 #endif
     int ptsdtsflag;
     unsigned long long temppts;
@@ -1354,38 +1354,38 @@ int fixPTSBlock(STBInfo *si, circBuffer *buf, int len)
     int dtshi=0;
     int dtslo=0;
 
-    ptsdtsflag=(getByteCircBuffer(buf,7)&0xC0)>>6;
+    ptsdtsflag=(peekByteSPSCRing(buf,7)&0xC0)>>6;
 
     if(ptsdtsflag&0x2) /* has pts */
     {
-        ptshi=(getByteCircBuffer(buf, 4+5)&0x08)>>3;
-        ptslo=((getByteCircBuffer(buf, 4+5)&0x06)>>1)<<30;
-        ptslo|=((getByteCircBuffer(buf, 4+6)&0xFF)>>0)<<22;
-        ptslo|=((getByteCircBuffer(buf, 4+7)&0xFE)>>1)<<15;
-        ptslo|=((getByteCircBuffer(buf, 4+8)&0xFF)>>0)<<7;
-        ptslo|=((getByteCircBuffer(buf, 4+9)&0xFE)>>1)<<0;
+        ptshi=(peekByteSPSCRing(buf, 4+5)&0x08)>>3;
+        ptslo=((peekByteSPSCRing(buf, 4+5)&0x06)>>1)<<30;
+        ptslo|=((peekByteSPSCRing(buf, 4+6)&0xFF)>>0)<<22;
+        ptslo|=((peekByteSPSCRing(buf, 4+7)&0xFE)>>1)<<15;
+        ptslo|=((peekByteSPSCRing(buf, 4+8)&0xFF)>>0)<<7;
+        ptslo|=((peekByteSPSCRing(buf, 4+9)&0xFE)>>1)<<0;
         temppts=ptshi;
         temppts<<=32LL;
         temppts|=ptslo;
 #ifdef DEBUGPTSOFFSET
-        fprintf(stderr,"%X Old pts %lld new pts %lld\n",getByteCircBuffer(buf, 3), temppts, temppts+si->ptsOffset);
+        fprintf(stderr,"%X Old pts %lld new pts %lld\n",peekByteSPSCRing(buf, 3), temppts, temppts+si->ptsOffset);
 #endif
         temppts+=si->ptsOffset;
         temppts&=0x1FFFFFFFFLL;
-        setByteCircBuffer(buf, 4+5, (ptsdtsflag<<4) | ((temppts>>29)&0xE) |0x1);
-        setByteCircBuffer(buf, 4+6, ((temppts>>22)&0xFF));
-        setByteCircBuffer(buf, 4+7, ((temppts>>14)&0xFF)|0x1);
-        setByteCircBuffer(buf, 4+8, ((temppts>>7)&0xFF));
-        setByteCircBuffer(buf, 4+9, ((temppts<<1)&0xFF)|0x1);
+        pokeByteSPSCRing(buf, 4+5, (ptsdtsflag<<4) | ((temppts>>29)&0xE) |0x1);
+        pokeByteSPSCRing(buf, 4+6, ((temppts>>22)&0xFF));
+        pokeByteSPSCRing(buf, 4+7, ((temppts>>14)&0xFF)|0x1);
+        pokeByteSPSCRing(buf, 4+8, ((temppts>>7)&0xFF));
+        pokeByteSPSCRing(buf, 4+9, ((temppts<<1)&0xFF)|0x1);
     }
     if(ptsdtsflag&0x1) /* has dts */
     {
-        dtshi=(getByteCircBuffer(buf, 4+10)&0x08)>>3;
-        dtslo=((getByteCircBuffer(buf, 4+10)&0x06)>>1)<<30;
-        dtslo|=((getByteCircBuffer(buf, 4+11)&0xFF)>>0)<<22;
-        dtslo|=((getByteCircBuffer(buf, 4+12)&0xFE)>>1)<<15;
-        dtslo|=((getByteCircBuffer(buf, 4+13)&0xFF)>>0)<<7;
-        dtslo|=((getByteCircBuffer(buf, 4+14)&0xFE)>>1)<<0;
+        dtshi=(peekByteSPSCRing(buf, 4+10)&0x08)>>3;
+        dtslo=((peekByteSPSCRing(buf, 4+10)&0x06)>>1)<<30;
+        dtslo|=((peekByteSPSCRing(buf, 4+11)&0xFF)>>0)<<22;
+        dtslo|=((peekByteSPSCRing(buf, 4+12)&0xFE)>>1)<<15;
+        dtslo|=((peekByteSPSCRing(buf, 4+13)&0xFF)>>0)<<7;
+        dtslo|=((peekByteSPSCRing(buf, 4+14)&0xFE)>>1)<<0;
         tempdts=dtshi;
         tempdts<<=32LL;
         tempdts|=dtslo;
@@ -1394,33 +1394,30 @@ int fixPTSBlock(STBInfo *si, circBuffer *buf, int len)
 //#endif
         tempdts+=si->ptsOffset;
         tempdts&=0x1FFFFFFFFLL;
-        setByteCircBuffer(buf, 4+10, (1<<4) | ((tempdts>>29)&0xE) |0x1);
-        setByteCircBuffer(buf, 4+11, ((tempdts>>22)&0xFF));
-        setByteCircBuffer(buf, 4+12, ((tempdts>>14)&0xFF)|0x1);
-        setByteCircBuffer(buf, 4+13, ((tempdts>>7)&0xFF));
-        setByteCircBuffer(buf, 4+14, ((tempdts<<1)&0xFF)|0x1);
+        pokeByteSPSCRing(buf, 4+10, (1<<4) | ((tempdts>>29)&0xE) |0x1);
+        pokeByteSPSCRing(buf, 4+11, ((tempdts>>22)&0xFF));
+        pokeByteSPSCRing(buf, 4+12, ((tempdts>>14)&0xFF)|0x1);
+        pokeByteSPSCRing(buf, 4+13, ((tempdts>>7)&0xFF));
+        pokeByteSPSCRing(buf, 4+14, ((tempdts<<1)&0xFF)|0x1);
     }
-    dropCircBuffer(buf, len);
+    dropSPSCRing(buf, len);
 }
 
 // This only works for DVDs that send complete packets (2048*x) 
 int fixPTS(STBInfo *si, unsigned char *critArr, int jsize)
 {
-    circBuffer *buf,buf2;
-    // Create a fake circbuffer for easier code...
+    spscRing *buf,buf2;
+    // Wrap the block in a full ring for easier code...
 
     unsigned char b;
     unsigned int didwork=0;
     unsigned int pos=0;
     int cur=0xFFFFFFFF;
     buf=&buf2;
-    buf->data=critArr;
-    buf->size=jsize;
-    buf->start=0;
-    buf->datalen=jsize;
-    while(pos<usedspaceCircBuffer(buf))
+    wrapSPSCRing(buf, critArr, jsize);
+    while(pos<usedspaceSPSCRing(buf))
     {
-        b=getByteCircBuffer(buf, pos);
+        b=peekByteSPSCRing(buf, pos);
         pos+=1;
         cur<<=8;
         cur|=b;
@@ -1433,19 +1430,19 @@ int fixPTS(STBInfo *si, unsigned char *critArr, int jsize)
                 didwork=1;
                 // drop bytes up to pos-4
                 if(pos-4>0)
-                    dropCircBuffer(buf, pos-4);
+                    dropSPSCRing(buf, pos-4);
 
                 /* verify we have complete packet */
-                if(usedspaceCircBuffer(buf)>=6 &&
-                    (6+(getByteCircBuffer(buf, 4)<<8)+
-                        getByteCircBuffer(buf, 5)) <= 
-                        usedspaceCircBuffer(buf))
+                if(usedspaceSPSCRing(buf)>=6 &&
+                    (6+(peekByteSPSCRing(buf, 4)<<8)+
+                        peekByteSPSCRing(buf, 5)) <= 
+                        usedspaceSPSCRing(buf))
                 {
                     didwork=1;
                     // Try to write the packet in the pes buffers
                     if(fixPTSBlock(si,buf,
-                        6+(getByteCircBuffer(buf, 4)<<8)+
-                        getByteCircBuffer(buf, 5))
+                        6+(peekByteSPSCRing(buf, 4)<<8)+
+                        peekByteSPSCRing(buf, 5))
                         > 0)
                     {
                         // STBWriteBlock took the data out
@@ -1469,11 +1466,11 @@ int fixPTS(STBInfo *si, unsigned char *critArr, int jsize)
                 didwork=1;
                 // drop bytes up to pos-4
                 if(pos-4>0)
-                    dropCircBuffer(buf, pos-4);
+                    dropSPSCRing(buf, pos-4);
                 /* verify we have complete packet */
-                if(usedspaceCircBuffer(buf)>=14)
+                if(usedspaceSPSCRing(buf)>=14)
                 {
-                    dropCircBuffer(buf, 14);
+                    dropSPSCRing(buf, 14);
                     pos=0;
                 }
                 else
@@ -1487,16 +1484,16 @@ int fixPTS(STBInfo *si, unsigned char *critArr, int jsize)
                 didwork=1;
                 // drop bytes up to pos-4
                 if(pos-4>0)
-                    dropCircBuffer(buf, pos-4);
+                    dropSPSCRing(buf, pos-4);
                 
                 /* verify we have complete packet */
-                if(usedspaceCircBuffer(buf)>=6 &&
-                    (6+(getByteCircBuffer(buf, 4)<<8)+
-                        getByteCircBuffer(buf, 5)) <= 
-                        usedspaceCircBuffer(buf))
+                if(usedspaceSPSCRing(buf)>=6 &&
+                    (6+(peekByteSPSCRing(buf, 4)<<8)+
+                        peekByteSPSCRing(buf, 5)) <= 
+                        usedspaceSPSCRing(buf))
                 {
-                    dropCircBuffer(buf, 6+(getByteCircBuffer(buf, 4)<<8)+
-                        getByteCircBuffer(buf, 5));
+                    dropSPSCRing(buf, 6+(peekByteSPSCRing(buf, 4)<<8)+
+                        peekByteSPSCRing(buf, 5));
                     pos=0;
                 }
                 else
@@ -1548,7 +1545,7 @@ int Media_PushBuffer(int size, int flags, char *buffer)
     {
         int nbuf;
         // TODO: figure out how to implement it...
-        if(usedspaceCircBuffer(&si->vidpesbuffer)<65536)
+        if(usedspaceSPSCRing(&si->vidpesbuffer)<65536)
         {
             ioctl(si->m2vfd, MPEG_VID_GET_CLIP_BUFFERS, &nbuf);
             //fprintf(stderr, "MPEG_VID_GET_CLIP_BUFFERS returned %d\n",nbuf);            
@@ -1565,9 +1562,9 @@ int Media_PushBuffer(int size, int flags, char *buffer)
     
     
     /*fprintf(stderr, "Level : P:%d/%d A:%d/%d V:%d/%d\n", 
-        usedspaceCircBuffer(&si->pesbuffer), PESBUFLEN, 
-        usedspaceCircBuffer(&si->audpesbuffer), AUDBUFLEN,
-        usedspaceCircBuffer(&si->vidpesbuffer), VIDBUFLEN);*/
+        usedspaceSPSCRing(&si->pesbuffer), PESBUFLEN, 
+        usedspaceSPSCRing(&si->audpesbuffer), AUDBUFLEN,
+        usedspaceSPSCRing(&si->vidpesbuffer), VIDBUFLEN);*/
     /*if((get_timebase()-prevtime)>27000000)
     {
         SYNCINFO time,time2;
@@ -1596,8 +1593,8 @@ int Media_PushBuffer(int size, int flags, char *buffer)
             }
         }
     }*/
-    return ((freespaceCircBuffer(&si->pesbuffer)) > 8192) ? 
-        freespaceCircBuffer(&si->pesbuffer) : 0; // return free space
+    return ((freespaceSPSCRing(&si->pesbuffer)) > 8192) ? 
+        freespaceSPSCRing(&si->pesbuffer) : 0; // return free space
 }
 
 int Media_GetVolume()
@@ -17,7 +17,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include "subdecoder.h"
-#include "circbuffer.h"
+#include "spscring.h"
 
 // Information on format can be found on website
 // http://dvd.sourceforge.net/dvdinfo/spu.html
@@ -357,20 +357,20 @@ int ResetSubpicture(SPHandler *H)
 
 extern int Media_GetMediaTime();
 
-int SubpictureAddBlock(SPHandler *H, circBuffer *buf, int len)
+int SubpictureAddBlock(SPHandler *H, spscRing *buf, int len)
 {
     unsigned int ptshi, ptslo;
     
     if(len>4+9)
     {
-        if(getByteCircBuffer(buf,7)&0x80) /* has pts */
+        if(peekByteSPSCRing(buf,7)&0x80) /* has pts */
         {
-            ptshi=(getByteCircBuffer(buf,4+5)&0x08)>>3;
-            ptslo=((getByteCircBuffer(buf,4+5)&0x06)>>1)<<30;
-            ptslo|=((getByteCircBuffer(buf,4+6)&0xFF)>>0)<<22;
-            ptslo|=((getByteCircBuffer(buf,4+7)&0xFE)>>1)<<15;
-            ptslo|=((getByteCircBuffer(buf,4+8)&0xFF)>>0)<<7;
-            ptslo|=((getByteCircBuffer(buf,4+9)&0xFE)>>1)<<0;
+            ptshi=(peekByteSPSCRing(buf,4+5)&0x08)>>3;
+            ptslo=((peekByteSPSCRing(buf,4+5)&0x06)>>1)<<30;
+            ptslo|=((peekByteSPSCRing(buf,4+6)&0xFF)>>0)<<22;
+            ptslo|=((peekByteSPSCRing(buf,4+7)&0xFE)>>1)<<15;
+            ptslo|=((peekByteSPSCRing(buf,4+8)&0xFF)>>0)<<7;
+            ptslo|=((peekByteSPSCRing(buf,4+9)&0xFE)>>1)<<0;
             H->spupts=ptshi;
             H->spupts<<=32;
             H->spupts|=ptslo;
@@ -380,7 +380,7 @@ int SubpictureAddBlock(SPHandler *H, circBuffer *buf, int len)
                 return 0; // We don't want this packet yet
             }
             fprintf(stderr, "Subpicture block %02X has PTS: %08X%08X\n",
-                getByteCircBuffer(buf,getByteCircBuffer(buf, 8)+9), ptshi, ptslo);
+                peekByteSPSCRing(buf,peekByteSPSCRing(buf, 8)+9), ptshi, ptslo);
             fprintf(stderr, "pts/90 %d stc/90 %d\n", (unsigned int)  (H->spupts/90L),
                 Media_GetMediaTime());
         }
@@ -394,13 +394,13 @@ int SubpictureAddBlock(SPHandler *H, circBuffer *buf, int len)
     }
     ACL_UnlockMutex(H->sputhreadmutex);
     
-    len-=getByteCircBuffer(buf,8)+9+1;
+    len-=peekByteSPSCRing(buf,8)+9+1;
     if(len<0) return 1;
     
     if(H->subpicturelen+len < SUBPICBUFLEN)
     {
-        dropCircBuffer(buf, getByteCircBuffer(buf,8)+9+1);
-        getCircBuffer(buf, H->subpicturebuffer+H->subpicturelen, len);
+        dropSPSCRing(buf, peekByteSPSCRing(buf,8)+9+1);
+        getSPSCRing(buf, H->subpicturebuffer+H->subpicturelen, len);
         H->subpicturelen+=len;
     }
     else
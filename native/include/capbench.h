@@ -0,0 +1,59 @@
+/*
+ * Copyright 2015 The SageTV Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef __CAPBENCH_H__
+#define __CAPBENCH_H__
+
+// Capture server sizing: N simulated tuners of one plugin record at once, each fed by its own stand-in
+// device (capreplay.h). A thread per tuner calls eatEncoderData as the Java encoder thread does. At the
+// end it reports per tuner and in total the rate recorded, CPU (less what the stand-in devices took) per
+// Mbps, bytes dropped before the plugin (sink full) and in it (capture ring), write latency and the
+// end-to-end delay from a byte being sent to being written.
+
+#include "capreplay.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CAP_BENCH_MAX_TUNERS    64
+
+typedef struct
+{
+    void *(*open)(void *context, int tuner);    // a tuner on its stand-in device, NULL fails
+    int (*start)(void *tuner, const char *outFile);    // setupEncoding and play, 0 fails
+    int (*eat)(void *tuner);                    // eatEncoderData once, bytes recorded
+    void (*stop)(void *tuner);                  // closeEncoding, the stand-in device is stopped
+    void (*close)(void *tuner);
+    CapReplay *(*replay)(void *tuner);
+    unsigned long long (*dropped)(void *tuner); // bytes the plugin dropped, NULL if it can't
+} CapBenchOps;
+
+typedef struct
+{
+    const char *name;                           // plugin, for the report
+    int tuners;
+    int seconds;
+    const char *outDir;                         // recordings go to <outDir>/capbench-<n>.ts, /dev/null if NULL
+} CapBenchParams;
+
+// 0 when all tuners ran, the report goes to stdout
+int runCapBench(const CapBenchOps *ops, void *context, const CapBenchParams *params);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __CAPBENCH_H__
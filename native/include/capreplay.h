@@ -0,0 +1,108 @@
+/*
+ * Copyright 2015 The SageTV Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef __CAPREPLAY_H__
+#define __CAPREPLAY_H__
+
+// Stand-in capture device of the Linux capture plugins. A recorded TS (188 or 192 byte packets) or PS
+// file is played by a sender thread into a pipe that takes the place of the device fd, or in 1316 byte
+// UDP datagrams to a local port (the HDHomeRun video socket). It is paced by the file's own PCR (TS) or
+// SCR (PS) at real time or a multiple of it; a stretch without a usable clock goes at the file's average
+// rate, a file without any at the old fixed 2358 bytes/ms. The file loops with a continuous clock.
+//
+// The sink doesn't wait for a slow consumer, a chunk that doesn't fit in the pipe or socket buffer is
+// dropped as a tuner overflows. The consumer reports what it took and how long writing it out took
+// (consumedCapReplay), the replay turns that into write latency and end-to-end delay, the time from a
+// byte being sent to it being written.
+//
+// debugserver.ini of the plugins: "debugsource <mode> <file>", "debugsource_speed <percent>"
+//   mode 1: the file stands in for the device data, the device is still opened and tuned
+//   mode 2: device data is replaced by as many bytes of the file (DVB and HDHomeRun, not paced here)
+//   mode 3: the file stands in for the device, no hardware is opened and tuning always locks
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CAP_REPLAY_REALTIME     100             // speed in percent of real time, 0 doesn't pace
+#define CAP_REPLAY_DATAGRAM     1316            // UDP payload, 7 TS packets
+#define CAP_REPLAY_LEGACY_RATE  2358000         // bytes/s without any clock reference (ATSC)
+#define CAP_REPLAY_HISTOGRAM    128             // latency buckets, 4 per octave of us
+
+#define CAP_REPLAY_STANDIN      1
+#define CAP_REPLAY_SUBSTITUTE   2
+#define CAP_REPLAY_NO_DEVICE    3
+
+typedef struct CapReplay CapReplay;
+
+typedef struct
+{
+    unsigned int packetSize;                    // 188, 192, 0 PS
+    unsigned int clockRefs;                     // PCR/SCR pacing the file, 0 paced at the legacy rate
+    unsigned long long fileBytes;
+    unsigned long long fileUs;                  // one pass of the file at real time
+    unsigned int loops;                         // times the file was played through
+    unsigned long long sentBytes;               // into the sink
+    unsigned long long droppedBytes;            // sink full, the consumer didn't keep up
+    unsigned long long consumedBytes;           // reported by the consumer
+    unsigned long long writes;                  // consumer reports
+    unsigned long long writeUsSum;
+    unsigned int writeUsMax;
+    unsigned int writeUsP99;
+    unsigned long long delays;
+    unsigned long long delayUsSum;
+    unsigned int delayUsMax;
+    unsigned int delayUsP99;
+    unsigned long long senderCpuUs;             // CPU time of the sender thread, once it's stopped
+} CapReplayStats;
+
+// NULL if the file can't be mapped or is empty. speed is in percent of real time, 0 doesn't pace.
+CapReplay *openCapReplay(const char *path, int speed);
+
+// pipe sink, returns the read end for the consumer (non-blocking, the consumer owns and closes it).
+// bufferBytes sizes the pipe as the device buffer, 0 keeps the default. -1 on error.
+// The sender thread starts paused, playCapReplay starts it. A running sink is stopped first.
+int startCapReplayPipe(CapReplay *replay, int bufferBytes);
+
+// UDP sink to host:port, returns 0, -1 on error. The sender thread starts paused as above.
+int startCapReplayUDP(CapReplay *replay, const char *host, int port);
+
+// plays the file from its start on a fresh clock, also after pauseCapReplay
+void playCapReplay(CapReplay *replay);
+void pauseCapReplay(CapReplay *replay);
+
+// stops the sender thread and closes the sink (the write end of a pipe), stats are kept
+void stopCapReplay(CapReplay *replay);
+
+// stops and frees the replay
+void closeCapReplay(CapReplay *replay);
+
+// consumer side, bytes taken off the sink (or dropped after it) and written out in writeUs
+void consumedCapReplay(CapReplay *replay, unsigned long bytes, unsigned long writeUs);
+
+void statsCapReplay(CapReplay *replay, CapReplayStats *stats);
+
+// monotonic clock in us for writeUs
+unsigned long long capReplayUs(void);
+
+// debugsource and debugsource_speed of a debugserver.ini (for plugins that don't parse one already).
+// Returns the mode, 0 when there is no debug source.
+int loadCapReplayCfg(const char *cfgFile, char *path, int pathSize, int *speed);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __CAPREPLAY_H__
@@ -0,0 +1,63 @@
+/*
+ * Copyright 2015 The SageTV Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef __MSGQUEUE_H__
+#define __MSGQUEUE_H__
+
+// Native to Java message queue of capture plugins (EPG and AV-INF posts). Tuner threads put messages
+// into a lock-free ring and return, one dispatcher thread attached to the VM once takes them off and
+// delivers them in batches through MsgManager.postMessages, in place of an attach, a SageMsg and a
+// detach per message. A batch is a direct ByteBuffer of records in the layout of the MsgManager
+// socket protocol (big endian): type, priority, source length, source, data length, data.
+//
+// The dispatcher is started by the first post. A message is dropped when the ring is full.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MSG_QUEUE_SLOTS     16384               // ring size in messages, power of 2
+#define MSG_BATCH_SIZE      (256*1024)          // bytes of a batch
+#define MSG_MAX_DATA        (64*1024)           // larger messages are dropped
+
+typedef struct
+{
+    unsigned long long posted;
+    unsigned long long delivered;
+    unsigned long long dropped;                 // ring full, too large, or no VM to deliver to
+    unsigned long long batches;                 // deliver calls
+    unsigned int depth;                         // messages in the ring
+    unsigned int maxDepth;
+} MsgQueueStats;
+
+// called on the dispatcher thread, msgs records of bytes in batch. Returns messages delivered.
+typedef int (*MsgQueueDeliver)(void *context, unsigned char *batch, int bytes, int msgs);
+
+// 1 when queued, 0 when dropped. pData of nDataLen bytes is copied.
+int postQueuedMessage(const char *pSrc, const char *pData, int nDataLen, int nMsgType, int nPriority);
+
+// replaces the Java deliver, before the first post (benchmarks and STANDALONE builds)
+void setMsgQueueDeliver(MsgQueueDeliver deliver, void *context);
+
+// delivers what is queued and stops the dispatcher, the queue can't be restarted
+void stopMsgQueue(void);
+
+void statsMsgQueue(MsgQueueStats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __MSGQUEUE_H__
@@ -0,0 +1,264 @@
+/*
+ * Copyright 2015 The SageTV Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef __SPSCRING_H__
+#define __SPSCRING_H__
+
+// Lock-free single producer/single consumer byte ring, shared by capture plugins and the miniclient
+// in place of the mutex guarded circBuffer. One thread adds (add/push/writeSpan), one thread
+// reads (get/peek/drop/readSpan), no lock is needed between them. Reset only when both are idle.
+//
+// head and tail run in [0, 2*size), so any size works and a full ring is told from an empty one.
+// Producer and consumer fields sit on separate cache lines, each side keeps a cached copy of
+// the other side's index and only reloads it when the cached view is short.
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SPSC_CACHE_LINE 64
+#if defined(__GNUC__)
+#define SPSC_ALIGNED __attribute__((aligned(SPSC_CACHE_LINE)))
+#else
+#define SPSC_ALIGNED
+#endif
+
+#if defined(__ATOMIC_ACQUIRE)
+#define SPSC_LOAD(p)        __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define SPSC_STORE(p, v)    __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#else
+static inline unsigned int SPSC_LOAD(volatile unsigned int *p)
+{
+    unsigned int v = *p;
+    __sync_synchronize();
+    return v;
+}
+#define SPSC_STORE(p, v)    do { __sync_synchronize(); *(volatile unsigned int *)(p) = (v); } while(0)
+#endif
+
+typedef struct
+{
+    unsigned char *data;
+    unsigned int size;
+    unsigned int resume;            // push leaves discard mode once this much is free
+    int owner;                      // data is freed by freeSPSCRing
+
+    // producer
+    volatile unsigned int tail SPSC_ALIGNED;
+    unsigned int headCache;
+    int discarding;
+    unsigned int dropEvents;        // times push entered discard mode
+    unsigned long long droppedBytes;
+
+    // consumer
+    volatile unsigned int head SPSC_ALIGNED;
+    unsigned int tailCache;
+} spscRing;
+
+static inline unsigned int distSPSCRing(spscRing *ring, unsigned int from, unsigned int to)
+{
+    return to >= from ? to - from : to + 2*ring->size - from;
+}
+
+static inline unsigned int advSPSCRing(spscRing *ring, unsigned int pos, unsigned int len)
+{
+    pos += len;
+    return pos >= 2*ring->size ? pos - 2*ring->size : pos;
+}
+
+static inline unsigned int offSPSCRing(spscRing *ring, unsigned int pos)
+{
+    return pos >= ring->size ? pos - ring->size : pos;
+}
+
+static inline int createSPSCRing(spscRing *ring, int len)
+{
+    memset(ring, 0, sizeof(spscRing));
+    ring->data = (unsigned char *)malloc(len);
+    if(ring->data == NULL) return 0;
+    ring->size = len;
+    ring->resume = len/4;
+    ring->owner = 1;
+    return len;
+}
+
+// full ring view of an existing array, for parsing code that works on rings
+static inline void wrapSPSCRing(spscRing *ring, unsigned char *data, int len)
+{
+    memset(ring, 0, sizeof(spscRing));
+    ring->data = data;
+    ring->size = len;
+    ring->tail = ring->tailCache = len;
+}
+
+static inline void freeSPSCRing(spscRing *ring)
+{
+    if(ring->owner) free(ring->data);
+    ring->data = NULL;
+    ring->size = 0;
+}
+
+static inline void resetSPSCRing(spscRing *ring)
+{
+    ring->head = ring->tail = ring->headCache = ring->tailCache = 0;
+    ring->discarding = 0;
+}
+
+//
+// producer side
+//
+static inline int freespaceSPSCRing(spscRing *ring)
+{
+    ring->headCache = SPSC_LOAD(&ring->head);
+    return ring->size - distSPSCRing(ring, ring->headCache, ring->tail);
+}
+
+// contiguous free region at tail, fill it then commitWriteSPSCRing
+static inline int writeSpanSPSCRing(spscRing *ring, unsigned char **ptr)
+{
+    unsigned int off = offSPSCRing(ring, ring->tail);
+    unsigned int room = ring->size - distSPSCRing(ring, ring->headCache, ring->tail);
+    if(room == 0)
+        room = freespaceSPSCRing(ring);
+    *ptr = ring->data + off;
+    return room < ring->size - off ? room : ring->size - off;
+}
+
+static inline void commitWriteSPSCRing(spscRing *ring, int len)
+{
+    SPSC_STORE(&ring->tail, advSPSCRing(ring, ring->tail, len));
+}
+
+// all or nothing, 1 when added
+static inline int addSPSCRing(spscRing *ring, const unsigned char *data, int len)
+{
+    unsigned int off, part;
+    if(len <= 0) return len == 0;
+    if(ring->size - distSPSCRing(ring, ring->headCache, ring->tail) < (unsigned int)len &&
+       freespaceSPSCRing(ring) < len)
+        return 0;
+    off = offSPSCRing(ring, ring->tail);
+    part = ring->size - off;
+    if(part >= (unsigned int)len)
+        memcpy(ring->data + off, data, len);
+    else
+    {
+        memcpy(ring->data + off, data, part);
+        memcpy(ring->data, data + part, len - part);
+    }
+    commitWriteSPSCRing(ring, len);
+    return 1;
+}
+
+// capture feed: when data doesn't fit the ring goes into discard mode and drops everything till
+// resume bytes are free again, so the consumer gets a gap at one place instead of holes everywhere.
+// returns 1 when added, 0 when dropped
+static inline int pushSPSCRing(spscRing *ring, const unsigned char *data, int len)
+{
+    if(ring->discarding && freespaceSPSCRing(ring) > (int)ring->resume)
+        ring->discarding = 0;
+    if(!ring->discarding && addSPSCRing(ring, data, len))
+        return 1;
+    if(!ring->discarding)
+        ring->dropEvents++;
+    ring->discarding = 1;
+    ring->droppedBytes += len;
+    return 0;
+}
+
+//
+// consumer side
+//
+static inline int usedspaceSPSCRing(spscRing *ring)
+{
+    ring->tailCache = SPSC_LOAD(&ring->tail);
+    return distSPSCRing(ring, ring->head, ring->tailCache);
+}
+
+// contiguous data at head, consume it then commitReadSPSCRing
+static inline int readSpanSPSCRing(spscRing *ring, unsigned char **ptr)
+{
+    unsigned int off = offSPSCRing(ring, ring->head);
+    unsigned int used = usedspaceSPSCRing(ring);
+    *ptr = ring->data + off;
+    return used < ring->size - off ? used : ring->size - off;
+}
+
+static inline void commitReadSPSCRing(spscRing *ring, int len)
+{
+    SPSC_STORE(&ring->head, advSPSCRing(ring, ring->head, len));
+}
+
+static inline int dropSPSCRing(spscRing *ring, int len)
+{
+    if(len < 0 || (distSPSCRing(ring, ring->head, ring->tailCache) < (unsigned int)len &&
+       usedspaceSPSCRing(ring) < len))
+        return 0;
+    commitReadSPSCRing(ring, len);
+    return 1;
+}
+
+// all or nothing, 1 when copied out
+static inline int getSPSCRing(spscRing *ring, unsigned char *data, int len)
+{
+    unsigned int off, part;
+    if(len < 0 || (distSPSCRing(ring, ring->head, ring->tailCache) < (unsigned int)len &&
+       usedspaceSPSCRing(ring) < len))
+        return 0;
+    off = offSPSCRing(ring, ring->head);
+    part = ring->size - off;
+    if(part >= (unsigned int)len)
+        memcpy(data, ring->data + off, len);
+    else
+    {
+        memcpy(data, ring->data + off, part);
+        memcpy(data + part, ring->data, len - part);
+    }
+    commitReadSPSCRing(ring, len);
+    return 1;
+}
+
+// from ring to ring, consumer of in and producer of out
+static inline int moveSPSCRing(spscRing *in, spscRing *out, int len)
+{
+    unsigned char *ptr;
+    int span;
+    if(len < 0 || usedspaceSPSCRing(in) < len || freespaceSPSCRing(out) < len)
+        return 0;
+    while(len > 0)
+    {
+        span = readSpanSPSCRing(in, &ptr);
+        if(span > len) span = len;
+        addSPSCRing(out, ptr, span);
+        commitReadSPSCRing(in, span);
+        len -= span;
+    }
+    return 1;
+}
+
+// byte at pos from head, pos has to be below usedspace
+#define peekByteSPSCRing(ring, pos) \
+    ((ring)->data[offSPSCRing((ring), advSPSCRing((ring), (ring)->head, (pos)))])
+#define pokeByteSPSCRing(ring, pos, val) \
+    ((ring)->data[offSPSCRing((ring), advSPSCRing((ring), (ring)->head, (pos)))] = (val))
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __SPSCRING_H__
@@ -33,10 +33,15 @@ typedef struct {
 	unsigned long dump_size;
 	unsigned long dumped_bytes;
 	char  debug_source[256];
-	int   debug_source_mode;
+	int   debug_source_mode; //1: stand-in dvr, 2: substitute dvr data, 3: stand-in device (see capreplay.h)
+	int   debug_source_speed; //percent of real time the stand-in plays at, 0 as fast as it's read
 	FILE* dump_fd;
 	FILE* source_fd;
 	unsigned long audio_ctrl;
+	int   record_writer;     //RecordWriter flag+1, 0 writes by pwrite
+	unsigned long record_sync;
+	int   timeshift_share;   //1 publishes the write position in shared memory, 2 the latest data too
+	int   capture_reactor;   //capture reactor threads, 0 runs a CaptureThread per device
 } DBG;
 
 typedef struct lnb_types_st {
@@ -55,14 +60,13 @@ typedef struct DVBCaptureDev
 	int  dvrFd; 
 	//int  demuxFd; 
 	int  demuxDevs[MAX_STREAMS];
-	FILE* fd; // file to write the captured data to
+	void* outFile; // TimeShiftFile to write the captured data to, switches to the next file by itself
 	long circFileSize;
 	char devName[256];
 	char frontendName[256];
 	char demuxName[256];
 	char dvrName[256];
 	unsigned char buf[BUFFERSIZE];
-	long circWritePos;
 	
 	int hard_demulex;
 	unsigned short filterPids[MAX_STREAMS];
@@ -85,7 +89,6 @@ typedef struct DVBCaptureDev
 	unsigned long long  totalInputBytes;
 	unsigned long long  lastOutputBytes;
 	unsigned long 		dumpBytes;
-    unsigned long long  syncBytes;
 	unsigned long startTime;   //start time in ms
 	unsigned char outBuffer[ TS_BUFFER_PACKETS*TS_PACKET_LENGTH ];
 	unsigned char alignBuffer[2048];
@@ -98,20 +101,13 @@ typedef struct DVBCaptureDev
 	pthread_mutex_t mutex1_scan_data;
 	pthread_mutex_t mutex1_push_data;
 
-    circBuffer capBuffer;
-    ACL_mutex *capMutex;
-    int capState; // 0: normal 1: discarding 2: exit
+    spscRing capBuffer; // capture thread -> eatEncoderData0, keeps discard mode and drop counters
+    volatile int capState; // 0: normal 2: exit
     ACL_Thread *capThread;
-    int discardCount;
+    CaptureSource *capSource; // set when the capture reactor reads dvrFd in place of capThread
+    CapReplay *replay; // stand-in device playing dbg.debug_source into dvrFd, mode 1 and 3
+    unsigned long long replayDropped; // capBuffer.droppedBytes reported to replay
     unsigned char buf2[BUFFERSIZE];
-
-#ifdef FILETRANSITION
-	FILE* newfd; // next file to write the captured data to
-	int bytesTested; // We want to give up after some fixed amount of bytes if no transition found
-	int detectmode; // 0: unknown 1: mpeg 2 PS  2: mpeg 2 TS  3: unsupported
-	int detecttype; // 0: unknown, 1: mpeg1  2:mpeg2  3:H264
-	int detectid; // stream ID of detect (should be 0xE0 for now)
-#endif
 } DVBCaptureDev;
 
 typedef struct {
@@ -0,0 +1,368 @@
+/*
+ * Copyright 2015 The SageTV Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sched.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include "capture_reactor.h"
+
+#define REACTOR_MAX_THREADS 4
+#define REACTOR_MAX_SOURCES 32              // per thread
+#define REACTOR_MAX_EVENTS  32
+#define REACTOR_READ_SIZE   (188*1024)
+#define REACTOR_BATCH       (1024*1024)     // per source and wake up, so one busy tuner can't starve the others
+#define REACTOR_WAKE_TAG    0xffffffffffffffffULL
+#define REACTOR_COALESCE_US 2000
+
+// flags shared by reactor and consumer
+#define FLAG_LOAD(p)        __atomic_load_n((p), __ATOMIC_SEQ_CST)
+#define FLAG_STORE(p, v)    __atomic_store_n((p), (v), __ATOMIC_SEQ_CST)
+
+typedef struct ReactorThread ReactorThread;
+
+struct CaptureSource
+{
+    int fd;
+    int efd;                        // eventfd the consumer sleeps on
+    spscRing *ring;
+    ReactorThread *thread;
+    int slot;
+    int waiting;
+    int wantBytes;                  // consumer is woken once the ring holds that much
+    int hangup;
+};
+
+struct ReactorThread
+{
+    CaptureReactor *reactor;
+    pthread_t thread;
+    pthread_mutex_t lock;           // held by the thread while it services sources
+    int epfd;
+    int wakefd;
+    int stop;
+    int sources;
+    CaptureSource *slot[REACTOR_MAX_SOURCES];
+    unsigned int gen[REACTOR_MAX_SOURCES];
+    unsigned char *scratch;         // read target while a ring is full or discarding
+    CaptureReactorStats stats;
+};
+
+struct CaptureReactor
+{
+    int threads;
+    int readSize;
+    int coalesceUs;
+    pthread_mutex_t lock;
+    ReactorThread thread[REACTOR_MAX_THREADS];
+};
+
+static void signalCaptureSource(ReactorThread *t, CaptureSource *src, int force)
+{
+    unsigned long long one=1;
+    // a consumer that set waiting before it checked the ring gets the event
+    __sync_synchronize();
+    if(force || (FLAG_LOAD(&src->waiting) &&
+                 (int)src->ring->size-freespaceSPSCRing(src->ring)>=FLAG_LOAD(&src->wantBytes)))
+    {
+        if(write(src->efd, &one, sizeof(one))<0) {}
+        t->stats.signals++;
+    }
+}
+
+// read till the fd is drained or the batch is done, returns -1 when the fd hung up
+static int readCaptureSource(ReactorThread *t, CaptureSource *src)
+{
+    spscRing *ring=src->ring;
+    int readSize=t->reactor->readSize;
+    int total=0, n=0, size;
+    unsigned char *ptr;
+    while(total<REACTOR_BATCH)
+    {
+        int span=0;
+        // Can we reenter record mode
+        if(ring->discarding && freespaceSPSCRing(ring)>(int)ring->resume)
+            ring->discarding=0;
+        if(!ring->discarding)
+            span=writeSpanSPSCRing(ring, &ptr);
+        if(span>0)
+        {
+            size=span>readSize ? readSize : span;
+            n=read(src->fd, ptr, size);
+            if(n>0)
+                commitWriteSPSCRing(ring, n);
+        }
+        else
+        {
+            size=readSize;
+            n=read(src->fd, t->scratch, size);
+            if(n>0)
+                pushSPSCRing(ring, t->scratch, n);
+        }
+        if(n<0 && errno==EINTR)
+            continue;
+        if(n<0 && errno==EOVERFLOW)
+        {
+            // dvr ring of the driver overflowed, next read goes on
+            t->stats.overflows++;
+            continue;
+        }
+        if(n<=0)
+            break;
+        t->stats.reads++;
+        t->stats.bytes+=n;
+        total+=n;
+        if(n<size)
+            break;
+    }
+    if(total>0)
+        signalCaptureSource(t, src, 0);
+    return n==0 ? -1 : total;
+}
+
+static void hangupCaptureSource(ReactorThread *t, CaptureSource *src)
+{
+    epoll_ctl(t->epfd, EPOLL_CTL_DEL, src->fd, NULL);
+    FLAG_STORE(&src->hangup, 1);
+    signalCaptureSource(t, src, 1);
+}
+
+static void *ReactorThreadProc(void *data)
+{
+    ReactorThread *t=(ReactorThread *)data;
+    struct epoll_event ev[REACTOR_MAX_EVENTS];
+    struct sched_param scparam={0,};
+    int i, n;
+    scparam.sched_priority=sched_get_priority_max(SCHED_FIFO);
+    sched_setscheduler(0, SCHED_FIFO, &scparam);
+    while(!FLAG_LOAD(&t->stop))
+    {
+        // no timeout, an idle reactor doesn't wake up
+        n=epoll_wait(t->epfd, ev, REACTOR_MAX_EVENTS, -1);
+        if(n<0)
+        {
+            if(errno==EINTR) continue;
+            break;
+        }
+        pthread_mutex_lock(&t->lock);
+        t->stats.wakeups++;
+        for(i=0; i<n; i++)
+        {
+            unsigned long long tag=ev[i].data.u64;
+            int slot=(int)(tag&0xffffffff);
+            CaptureSource *src;
+            if(tag==REACTOR_WAKE_TAG)
+            {
+                unsigned long long val;
+                if(read(t->wakefd, &val, sizeof(val))<0) {}
+                continue;
+            }
+            // the source may have been removed after epoll_wait returned
+            if(slot>=REACTOR_MAX_SOURCES || t->gen[slot]!=(unsigned int)(tag>>32) ||
+               (src=t->slot[slot])==NULL || FLAG_LOAD(&src->hangup))
+                continue;
+            if(readCaptureSource(t, src)<0 ||
+               ((ev[i].events&(EPOLLHUP|EPOLLERR)) && !(ev[i].events&EPOLLIN)))
+                hangupCaptureSource(t, src);
+        }
+        pthread_mutex_unlock(&t->lock);
+        // let data pile up in the driver buffers, the next wake up reads all tuners in large batches
+        if(t->reactor->coalesceUs>0 && !FLAG_LOAD(&t->stop))
+            usleep(t->reactor->coalesceUs);
+    }
+    return NULL;
+}
+
+CaptureReactor *createCaptureReactor(int threads, int readSize, int coalesceUs)
+{
+    CaptureReactor *reactor;
+    struct epoll_event ev;
+    int i;
+    if(threads<=0) threads=1;
+    if(threads>REACTOR_MAX_THREADS) threads=REACTOR_MAX_THREADS;
+    if(readSize<=0) readSize=REACTOR_READ_SIZE;
+    if(coalesceUs<0) coalesceUs=REACTOR_COALESCE_US;
+    reactor=(CaptureReactor *)calloc(1, sizeof(CaptureReactor));
+    if(reactor==NULL) return NULL;
+    reactor->readSize=readSize;
+    reactor->coalesceUs=coalesceUs;
+    pthread_mutex_init(&reactor->lock, NULL);
+    for(i=0; i<threads; i++)
+    {
+        ReactorThread *t=&reactor->thread[i];
+        t->reactor=reactor;
+        pthread_mutex_init(&t->lock, NULL);
+        t->epfd=epoll_create1(EPOLL_CLOEXEC);
+        t->wakefd=eventfd(0, EFD_NONBLOCK|EFD_CLOEXEC);
+        t->scratch=(unsigned char *)malloc(readSize);
+        memset(&ev, 0, sizeof(ev));
+        ev.events=EPOLLIN;
+        ev.data.u64=REACTOR_WAKE_TAG;
+        if(t->epfd<0 || t->wakefd<0 || t->scratch==NULL ||
+           epoll_ctl(t->epfd, EPOLL_CTL_ADD, t->wakefd, &ev)<0 ||
+           pthread_create(&t->thread, NULL, ReactorThreadProc, t)!=0)
+        {
+            if(t->epfd>=0) close(t->epfd);
+            if(t->wakefd>=0) close(t->wakefd);
+            free(t->scratch);
+            pthread_mutex_destroy(&t->lock);
+            break;
+        }
+        reactor->threads++;
+    }
+    if(reactor->threads==0)
+    {
+        pthread_mutex_destroy(&reactor->lock);
+        free(reactor);
+        return NULL;
+    }
+    return reactor;
+}
+
+// all sources have to be removed
+void destroyCaptureReactor(CaptureReactor *reactor)
+{
+    unsigned long long one=1;
+    int i;
+    if(reactor==NULL) return;
+    for(i=0; i<reactor->threads; i++)
+    {
+        ReactorThread *t=&reactor->thread[i];
+        FLAG_STORE(&t->stop, 1);
+        if(write(t->wakefd, &one, sizeof(one))<0) {}
+        pthread_join(t->thread, NULL);
+        close(t->epfd);
+        close(t->wakefd);
+        free(t->scratch);
+        pthread_mutex_destroy(&t->lock);
+    }
+    pthread_mutex_destroy(&reactor->lock);
+    free(reactor);
+}
+
+CaptureSource *addCaptureSource(CaptureReactor *reactor, int fd, spscRing *ring)
+{
+    CaptureSource *src;
+    ReactorThread *t=NULL;
+    struct epoll_event ev;
+    int i, slot;
+    if(reactor==NULL) return NULL;
+    src=(CaptureSource *)calloc(1, sizeof(CaptureSource));
+    if(src==NULL) return NULL;
+    src->fd=fd;
+    src->ring=ring;
+    if((src->efd=eventfd(0, EFD_NONBLOCK|EFD_CLOEXEC))<0)
+    {
+        free(src);
+        return NULL;
+    }
+
+    // least loaded thread
+    pthread_mutex_lock(&reactor->lock);
+    for(i=0; i<reactor->threads; i++)
+        if(t==NULL || reactor->thread[i].sources<t->sources)
+            t=&reactor->thread[i];
+    pthread_mutex_lock(&t->lock);
+    for(slot=0; slot<REACTOR_MAX_SOURCES && t->slot[slot]!=NULL; slot++);
+    if(slot<REACTOR_MAX_SOURCES)
+    {
+        memset(&ev, 0, sizeof(ev));
+        ev.events=EPOLLIN;
+        ev.data.u64=((unsigned long long)(++t->gen[slot])<<32)|slot;
+        src->thread=t;
+        src->slot=slot;
+        t->slot[slot]=src;
+        t->sources++;
+        if(epoll_ctl(t->epfd, EPOLL_CTL_ADD, fd, &ev)<0)
+        {
+            t->slot[slot]=NULL;
+            t->sources--;
+            slot=REACTOR_MAX_SOURCES;
+        }
+    }
+    pthread_mutex_unlock(&t->lock);
+    pthread_mutex_unlock(&reactor->lock);
+    if(slot>=REACTOR_MAX_SOURCES)
+    {
+        close(src->efd);
+        free(src);
+        return NULL;
+    }
+    return src;
+}
+
+// the reactor doesn't touch the ring once this returns
+void removeCaptureSource(CaptureReactor *reactor, CaptureSource *src)
+{
+    ReactorThread *t;
+    if(reactor==NULL || src==NULL) return;
+    t=src->thread;
+    pthread_mutex_lock(&reactor->lock);
+    pthread_mutex_lock(&t->lock);
+    if(!FLAG_LOAD(&src->hangup))
+        epoll_ctl(t->epfd, EPOLL_CTL_DEL, src->fd, NULL);
+    t->slot[src->slot]=NULL;
+    t->gen[src->slot]++;
+    t->sources--;
+    pthread_mutex_unlock(&t->lock);
+    pthread_mutex_unlock(&reactor->lock);
+    close(src->efd);
+    free(src);
+}
+
+int waitCaptureSource(CaptureSource *src, int minBytes, int timeoutMs)
+{
+    struct pollfd pfd;
+    unsigned long long val;
+    FLAG_STORE(&src->wantBytes, minBytes>0 ? minBytes : 1);
+    FLAG_STORE(&src->waiting, 1);
+    __sync_synchronize();
+    if(usedspaceSPSCRing(src->ring)<src->wantBytes && !FLAG_LOAD(&src->hangup))
+    {
+        pfd.fd=src->efd;
+        pfd.events=POLLIN;
+        pfd.revents=0;
+        if(poll(&pfd, 1, timeoutMs)>0)
+        {
+            if(read(src->efd, &val, sizeof(val))<0) {}
+        }
+    }
+    FLAG_STORE(&src->waiting, 0);
+    if(usedspaceSPSCRing(src->ring)>0) return 1;
+    return FLAG_LOAD(&src->hangup) ? -1 : 0;
+}
+
+void statsCaptureReactor(CaptureReactor *reactor, CaptureReactorStats *stats)
+{
+    int i;
+    memset(stats, 0, sizeof(CaptureReactorStats));
+    if(reactor==NULL) return;
+    for(i=0; i<reactor->threads; i++)
+    {
+        ReactorThread *t=&reactor->thread[i];
+        pthread_mutex_lock(&t->lock);
+        stats->wakeups+=t->stats.wakeups;
+        stats->reads+=t->stats.reads;
+        stats->bytes+=t->stats.bytes;
+        stats->overflows+=t->stats.overflows;
+        stats->signals+=t->stats.signals;
+        pthread_mutex_unlock(&t->lock);
+    }
+}
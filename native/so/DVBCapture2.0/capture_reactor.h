@@ -0,0 +1,53 @@
+/*
+ * Copyright 2015 The SageTV Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef __CAPTURE_REACTOR__
+#define __CAPTURE_REACTOR__
+
+#include "spscring.h"
+
+// Capture reactor: a few epoll threads read the dvr fds of all tuners into their capture rings,
+// in place of one select() thread per device. A reactor thread is the ring producer of the sources
+// it owns, the parse worker of each tuner is the consumer and sleeps in waitCaptureSource till the
+// reactor has read enough data for it. After each pass a reactor thread sleeps coalesceUs, data
+// pile up in the driver buffers meanwhile and all tuners are read in large batches on next wake up.
+
+typedef struct CaptureReactor CaptureReactor;
+typedef struct CaptureSource CaptureSource;
+
+typedef struct
+{
+    unsigned long long wakeups;     // epoll_wait returns
+    unsigned long long reads;       // read() calls that returned data
+    unsigned long long bytes;
+    unsigned long long overflows;   // dvr EOVERFLOW
+    unsigned long long signals;     // consumer wake ups
+} CaptureReactorStats;
+
+// up to 4 threads, sources go to the least loaded one. readSize of 0 and coalesceUs < 0 take default
+CaptureReactor *createCaptureReactor(int threads, int readSize, int coalesceUs);
+void destroyCaptureReactor(CaptureReactor *reactor);
+
+// fd has to be O_NONBLOCK, ring is filled by the reactor till removeCaptureSource returns
+CaptureSource *addCaptureSource(CaptureReactor *reactor, int fd, spscRing *ring);
+void removeCaptureSource(CaptureReactor *reactor, CaptureSource *source);
+
+// consumer side, sleeps till the ring holds minBytes or timeout. 1 when the ring has data,
+// 0 when it's empty, -1 when it's empty and the fd hung up
+int waitCaptureSource(CaptureSource *source, int minBytes, int timeoutMs);
+
+void statsCaptureReactor(CaptureReactor *reactor, CaptureReactorStats *stats);
+
+#endif // __CAPTURE_REACTOR__
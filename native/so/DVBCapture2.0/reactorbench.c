@@ -0,0 +1,303 @@
+/*
+ * Copyright 2015 The SageTV Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+// Capture side cost per tuner, one select() CaptureThread per device against the capture reactor.
+// Pipes stand in for dvr devices, a single feeder thread writes every tuner's stream at a fixed
+// rate, the parse workers take the data off the capture rings as eatEncoderData0 does.
+// usage: reactorbench [-t<tuners>] [-r<reactor threads>] [-s<seconds>] [-b<Mbps per tuner>]
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/select.h>
+#include <sys/resource.h>
+#include <pthread.h>
+#include "capture_reactor.h"
+
+#define BUFFERSIZE (188*348)
+#define CAPCIRCBUFFERSIZE (16*1024*1024)
+#define MAX_TUNERS 64
+#define FEED_TICK_US 1000
+
+typedef struct
+{
+    int fd[2];                      // pipe, [0] is the dvr fd
+    spscRing capBuffer;
+    CaptureSource *capSource;
+    pthread_t capThread;
+    pthread_t worker;
+    int capThreadRunning;
+    volatile unsigned int capDone;
+    unsigned char buf2[BUFFERSIZE];
+    unsigned long long fedBytes;
+    unsigned long long gotBytes;
+    unsigned long long wakeups;     // capture thread select returns
+    unsigned long long sleeps;      // worker wake ups
+} BenchTuner;
+
+typedef struct
+{
+    BenchTuner tuner[MAX_TUNERS];
+    int tuners;
+    int seconds;
+    unsigned long bytesPerTick;
+    CaptureReactor *reactor;
+    struct rusage feederUsage;
+} Bench;
+
+static double elapsed(struct timeval *t)
+{
+    return t->tv_sec + t->tv_usec/1e6;
+}
+
+static double nowSec()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec/1e9;
+}
+
+static void *FeederThread(void *data)
+{
+    Bench *b=(Bench *)data;
+    unsigned char *chunk;
+    unsigned long ticks=(unsigned long)b->seconds*1000000/FEED_TICK_US, i;
+    struct timespec next;
+    int k;
+    chunk=(unsigned char *)malloc(b->bytesPerTick);
+    for(i=0; i<b->bytesPerTick; i++)
+        chunk[i]=(i%188) ? (unsigned char)i : 0x47;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    for(i=0; i<ticks; i++)
+    {
+        for(k=0; k<b->tuners; k++)
+        {
+            int n=write(b->tuner[k].fd[1], chunk, b->bytesPerTick);
+            if(n>0) b->tuner[k].fedBytes+=n;
+        }
+        next.tv_nsec+=FEED_TICK_US*1000;
+        if(next.tv_nsec>=1000000000)
+        {
+            next.tv_nsec-=1000000000;
+            next.tv_sec++;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+    }
+    for(k=0; k<b->tuners; k++)
+        close(b->tuner[k].fd[1]);
+    getrusage(RUSAGE_THREAD, &b->feederUsage);
+    free(chunk);
+    return NULL;
+}
+
+// one per device, as the plugin CaptureThread
+static void *CaptureThread(void *data)
+{
+    BenchTuner *x=(BenchTuner *)data;
+    fd_set rfds;
+    struct timeval tv;
+    while(1)
+    {
+        FD_ZERO(&rfds);
+        FD_SET(x->fd[0], &rfds);
+        tv.tv_sec = 0;
+        tv.tv_usec = 100000;
+        if(select(x->fd[0]+1, &rfds, NULL, NULL, &tv)<0)
+            break;
+        x->wakeups++;
+        if(FD_ISSET(x->fd[0], &rfds))
+        {
+            int numbytes, span=0;
+            unsigned char *ptr;
+            if(x->capBuffer.discarding && freespaceSPSCRing(&x->capBuffer)>(int)x->capBuffer.resume)
+                x->capBuffer.discarding=0;
+            if(!x->capBuffer.discarding)
+                span=writeSpanSPSCRing(&x->capBuffer, &ptr);
+            if(span>0)
+            {
+                numbytes = read(x->fd[0], ptr, span>BUFFERSIZE ? BUFFERSIZE : span);
+                if(numbytes>0)
+                    commitWriteSPSCRing(&x->capBuffer, numbytes);
+            }
+            else
+            {
+                numbytes = read(x->fd[0], x->buf2, BUFFERSIZE);
+                if(numbytes>0)
+                    pushSPSCRing(&x->capBuffer, x->buf2, numbytes);
+            }
+            if(numbytes==0)
+                break;
+        }
+    }
+    SPSC_STORE(&x->capDone, 1);
+    return NULL;
+}
+
+// parse worker, takes at most BUFFERSIZE per call as eatEncoderData0
+static void *WorkerThread(void *data)
+{
+    BenchTuner *x=(BenchTuner *)data;
+    while(1)
+    {
+        unsigned char *ptr;
+        int done=x->capSource ? 0 : (int)SPSC_LOAD(&x->capDone);
+        int numbytes=readSpanSPSCRing(&x->capBuffer, &ptr);
+        numbytes = numbytes > BUFFERSIZE ?  BUFFERSIZE : numbytes;
+        if(numbytes>0)
+        {
+            x->gotBytes+=numbytes;
+            commitReadSPSCRing(&x->capBuffer, numbytes);
+            continue;
+        }
+        x->sleeps++;
+        if(x->capSource)
+        {
+            if(waitCaptureSource(x->capSource, BUFFERSIZE, 100)<0)
+                break;
+        }
+        else
+        {
+            if(done) break;
+            usleep(10000);
+        }
+    }
+    return NULL;
+}
+
+static int RunBench(Bench *b, int reactorThreads)
+{
+    struct rusage r0, r1;
+    CaptureReactorStats stats;
+    pthread_t feeder;
+    unsigned long long fed=0, got=0, dropped=0, wakeups=0, sleeps=0;
+    double t0, t, cpu, feederCpu;
+    long csw;
+    int i;
+
+    memset(&stats, 0, sizeof(stats));
+    b->reactor=NULL;
+    if(reactorThreads>0 && (b->reactor=createCaptureReactor(reactorThreads, 0, -1))==NULL)
+    {
+        fprintf(stderr, "failed creating capture reactor\n");
+        return 1;
+    }
+    for(i=0; i<b->tuners; i++)
+    {
+        BenchTuner *x=&b->tuner[i];
+        memset(x, 0, sizeof(BenchTuner));
+        if(pipe2(x->fd, O_NONBLOCK)<0 || createSPSCRing(&x->capBuffer, CAPCIRCBUFFERSIZE)==0)
+        {
+            fprintf(stderr, "failed creating tuner %d\n", i);
+            return 1;
+        }
+        fcntl(x->fd[1], F_SETFL, 0);
+        fcntl(x->fd[0], F_SETPIPE_SZ, 1024*1024);
+    }
+    getrusage(RUSAGE_SELF, &r0);
+    t0=nowSec();
+    for(i=0; i<b->tuners; i++)
+    {
+        BenchTuner *x=&b->tuner[i];
+        if(b->reactor)
+            x->capSource=addCaptureSource(b->reactor, x->fd[0], &x->capBuffer);
+        else
+            x->capThreadRunning=pthread_create(&x->capThread, NULL, CaptureThread, x)==0;
+        pthread_create(&x->worker, NULL, WorkerThread, x);
+    }
+    pthread_create(&feeder, NULL, FeederThread, b);
+    pthread_join(feeder, NULL);
+    for(i=0; i<b->tuners; i++)
+    {
+        BenchTuner *x=&b->tuner[i];
+        pthread_join(x->worker, NULL);
+        if(x->capThreadRunning)
+            pthread_join(x->capThread, NULL);
+    }
+    t=nowSec()-t0;
+    getrusage(RUSAGE_SELF, &r1);
+    statsCaptureReactor(b->reactor, &stats);
+    for(i=0; i<b->tuners; i++)
+    {
+        BenchTuner *x=&b->tuner[i];
+        if(x->capSource)
+            removeCaptureSource(b->reactor, x->capSource);
+        fed+=x->fedBytes;
+        got+=x->gotBytes;
+        dropped+=x->capBuffer.droppedBytes;
+        wakeups+=x->wakeups;
+        sleeps+=x->sleeps;
+        close(x->fd[0]);
+        freeSPSCRing(&x->capBuffer);
+    }
+    destroyCaptureReactor(b->reactor);
+    wakeups+=stats.wakeups;
+
+    // capture side only, the feeder thread is the same in both modes
+    feederCpu=elapsed(&b->feederUsage.ru_utime)+elapsed(&b->feederUsage.ru_stime);
+    cpu=elapsed(&r1.ru_utime)-elapsed(&r0.ru_utime)+elapsed(&r1.ru_stime)-elapsed(&r0.ru_stime)-feederCpu;
+    csw=(r1.ru_nvcsw-r0.ru_nvcsw)+(r1.ru_nivcsw-r0.ru_nivcsw)-b->feederUsage.ru_nvcsw-b->feederUsage.ru_nivcsw;
+    if(reactorThreads>0)
+        printf("reactor %-2d ", reactorThreads);
+    else
+        printf("thread     ");
+    printf("%8.2f %10.1f %10.1f %10.1f %8.1f %8.1f %8.1f %s\n", cpu*1e3/t/b->tuners,
+           wakeups/t/b->tuners, sleeps/t/b->tuners, csw/t/b->tuners, fed/1048576.0, got/1048576.0,
+           dropped/1048576.0, fed!=got+dropped ? "DATA MISMATCH" : "");
+    return fed!=got+dropped;
+}
+
+int main(int argc, char *argv[])
+{
+    static Bench b;
+    int reactorThreads=0, mbps=20, i, ret=0;
+    b.tuners=8;
+    b.seconds=5;
+    for(i=1; i<argc; i++)
+    {
+        if(argv[i][0]!='-') continue;
+        switch(argv[i][1])
+        {
+            case 't': b.tuners=atoi(argv[i]+2); break;
+            case 'r': reactorThreads=atoi(argv[i]+2); break;
+            case 's': b.seconds=atoi(argv[i]+2); break;
+            case 'b': mbps=atoi(argv[i]+2); break;
+            default:
+                puts("usage: reactorbench [-t<tuners>] [-r<reactor threads>] [-s<seconds>] [-b<Mbps per tuner>]");
+                return 1;
+        }
+    }
+    if(b.tuners<1) b.tuners=1;
+    if(b.tuners>MAX_TUNERS) b.tuners=MAX_TUNERS;
+    if(b.seconds<1) b.seconds=1;
+    b.bytesPerTick=(unsigned long)mbps*1000000/8/(1000000/FEED_TICK_US);
+    b.bytesPerTick-=b.bytesPerTick%188;
+    if(b.bytesPerTick<188) b.bytesPerTick=188;
+
+    printf("%d tuners, %d Mbps each in %lu byte writes every %d us, %d s\n", b.tuners, mbps, b.bytesPerTick,
+           FEED_TICK_US, b.seconds);
+    printf("%-10s %8s %10s %10s %10s %8s %8s %8s\n", "mode", "cpu ms/s", "wakeups/s", "worker/s", "ctxsw/s",
+           "MB fed", "MB got", "MB drop");
+    printf("%-10s %8s %10s %10s %10s\n", "", "/tuner", "/tuner", "/tuner", "/tuner");
+    ret|=RunBench(&b, 0);
+    ret|=RunBench(&b, reactorThreads>0 ? reactorThreads : 1);
+    if(reactorThreads==0 && b.tuners>=8)
+        ret|=RunBench(&b, 2);
+    return ret;
+}
@@ -41,7 +41,7 @@
 #include <pthread.h>
 #include <dirent.h>
 #include "thread_util.h"
-#include "circbuffer.h"
+#include "spscring.h"
 
 #ifdef STANDALONE
 #define APISTRING const char *
@@ -66,6 +66,13 @@ static int CaptureThread(void *data);
 #include "TSFilter.h"
 #include "TSParser.h"
 #include "ScanFilter.h"
+#include "TimeShiftFile.h"
+#include "capture_reactor.h"
+#include "msgqueue.h"
+#include "capreplay.h"
+#ifdef CAPBENCH
+#include "capbench.h"
+#endif
 #include "DVBCaptureDevice.h"
 
 #if defined(__LP64__) || defined(WIN32)
@@ -213,8 +220,15 @@ static int tuneDVBSFrequency( DVBCaptureDev *CDev, DVB_S_FREQ* dvbs, int dryTune
 static char* front_end_status_string( int status );
 int getAdapterNum( DVBCaptureDev *CDev );
 static int OutputDump( void* pContext, void* pDataBlk, int lBytes );
+static void* OpenOutputFile( DVBCaptureDev *CDev, const char* pFileName );
+static void CloseOutputFile( DVBCaptureDev *CDev );
+static void AttachCaptureReactor( DVBCaptureDev *CDev );
+static void DetachCaptureReactor( DVBCaptureDev *CDev );
 static void setDmxBufferSize( DVBCaptureDev *CDev, unsigned long size );
 static void emptyDmxBufferSize( DVBCaptureDev *CDev, unsigned long size );
+static int OpenStandInDvr( DVBCaptureDev *CDev );
+static int StandInTuner( DVBCaptureDev *CDev );
+static void ReportStandInData( DVBCaptureDev *CDev, int nBytes, unsigned long long startUs );
 
 #ifdef STANDALONE
 void throwEncodingException(JNIEnv* env, jint errCode)
@@ -285,7 +299,14 @@ JNIEXPORT jlong JNICALL Java_sage_DVBCaptureDevice_createEncoder0
 	CDev->dmx_buffer_size = 10*188*1024;
 
 	ReadDeviceCfg( CDev );
+	LoadDebugCfg( &CDev->dbg );
 
+	if ( CDev->dbg.debug_source_mode == CAP_REPLAY_NO_DEVICE && CDev->dbg.debug_source[0] )
+	{
+		//stand-in device, no hardware is touched
+		CDev->frontendFd = -1;
+		CDev->demuxDevs[0] = -1;
+	} else
 	if((CDev->frontendFd = open(CDev->frontendName,O_RDWR|O_NONBLOCK)) < 0)
 	{
 		flog(("Native.log", "DVB: failed open frontend %s (%d).\r\n", CDev->frontendName, CDev->frontendFd ));
@@ -294,13 +315,18 @@ JNIEXPORT jlong JNICALL Java_sage_DVBCaptureDevice_createEncoder0
 		return 0;
 	}
 
-	if((CDev->demuxDevs[0] = open(CDev->demuxName,O_RDWR|O_NONBLOCK)) < 0)
+	if( CDev->frontendFd >= 0 && (CDev->demuxDevs[0] = open(CDev->demuxName,O_RDWR|O_NONBLOCK)) < 0)
 	{
 		flog(("Native.log", "DVB: failed open demux0 %s (%d).\r\n", CDev->demuxName, CDev->demuxDevs[0] ));
 		throwEncodingException(env, __LINE__);
 	}
 		
 
+	if ( OpenStandInDvr( CDev ) )
+	{
+		flog(("Native.log", "DVB: stand-in device plays %s at %d%% (mode:%d).\r\n", CDev->dbg.debug_source,
+		      CDev->dbg.debug_source_speed, CDev->dbg.debug_source_mode ));
+	} else
 	if((CDev->dvrFd = open(CDev->dvrName,O_RDONLY|O_NONBLOCK)) < 0) //|O_NONBLOCK
 	{
 		flog(("Native.log", "DVB: failed open dvr %s (fd:%d, errno:%d).\r\n", CDev->dvrName, CDev->dvrFd, errno ));
@@ -319,6 +345,7 @@ JNIEXPORT jlong JNICALL Java_sage_DVBCaptureDevice_createEncoder0
 		flog(("Native.log", "DVB: failed creating a Remuxer.\r\n" ));
 		sysOutPrint(env, "DVB: FAILED creat remuxer.\r\n" );
 		throwEncodingException(env, __LINE__);
+		closeCapReplay( CDev->replay );
 		close( CDev->frontendFd );
 		close( CDev->demuxDevs[0] );
 		close( CDev->dvrFd );
@@ -328,11 +355,12 @@ JNIEXPORT jlong JNICALL Java_sage_DVBCaptureDevice_createEncoder0
 	SetDefaultAudioLanguage( CDev->remuxer, LANGUAGE_CODE( "eng" ) );
 
     // JFT TODO: Ask Qian if that's right place for that
-    if(createCircBuffer(&CDev->capBuffer, CAPCIRCBUFFERSIZE)==0)
+    if(createSPSCRing(&CDev->capBuffer, CAPCIRCBUFFERSIZE)==0)
     {
         flog(("Native.log", "DVB: failed allocating circular buffer.\r\n" ));
         sysOutPrint(env, "DVB: FAILED allocating circular buffer.\r\n" );
         throwEncodingException(env, __LINE__);
+        closeCapReplay( CDev->replay );
         close( CDev->frontendFd );
         close( CDev->demuxDevs[0] );
         close( CDev->dvrFd );
@@ -340,9 +368,7 @@ JNIEXPORT jlong JNICALL Java_sage_DVBCaptureDevice_createEncoder0
         return 0;
     }
 
-    CDev->capMutex = ACL_CreateMutex();
-
-	if ( CDev->dmx_buffer_size > 0 )
+	if ( CDev->dmx_buffer_size > 0 && CDev->replay == NULL )
 		setDmxBufferSize( CDev, CDev->dmx_buffer_size );
 
 	flog(("Native.log", "DVB: encoder is created CDev: 0x%lx, 0x%lx\r\n",
@@ -359,7 +385,6 @@ JNIEXPORT jlong JNICALL Java_sage_DVBCaptureDevice_createEncoder0
 	openChannel( &CDev->channel, CDev );
 
 	//CDev->channel.lockTimeout = LOCK_FRQ_TIMEOUT;
-	LoadDebugCfg( &CDev->dbg );
 	SetupEPGDump( CDev->remuxer, (DUMP)EPG_Dumper, (void*)CDev);
 	SetupAVInfDump( CDev->remuxer, (DUMP)AVInf_Dumper, (void*)CDev );
 	enableFrqTableUpdate( &CDev->channel );
@@ -430,6 +455,13 @@ JNIEXPORT jboolean JNICALL Java_sage_DVBCaptureDevice_setInput0
  	struct dvb_frontend_info fe_info;
 	char *type;
 	int   ret;
+	if ( StandInTuner( CDev ) )
+	{
+		//stand-in device without hardware passes for an ATSC tuner
+		memset( &fe_info, 0, sizeof(fe_info) );
+		fe_info.type = FE_ATSC;
+		type = "ATSC";
+	} else
  	if ( ioctl( CDev->frontendFd, FE_GET_INFO, &fe_info) >= 0 )
 	{
 		flog(( "Native.log", "DVB:tuner name:%s\r\n", fe_info.name ));
@@ -575,23 +607,20 @@ JNIEXPORT jboolean JNICALL Java_sage_DVBCaptureDevice_setupEncoding0
 	{
 		DVBCaptureDev *CDev =  INT64_TO_PTR(DVBCaptureDev *, ptr);
 		CDev->circFileSize = (long) circSize;
-		CDev->circWritePos = 0;
 
 #ifdef STANDALONE
         const char* cfilename = jfilename;
 #else
 		const char* cfilename = (*env)->GetStringUTFChars(env, jfilename, NULL);
 #endif
-		if (CDev->fd)
+		if (CDev->outFile)
 		{
 			//drain data in buffer before close
 			FlushOutBufferData( CDev );
-			fclose(CDev->fd);
-			flog(( "Native.log", "DVB: close file:0x%lx for a new recording.\r\n", CDev->fd ));
-			CDev->fd = 0;
+			flog(( "Native.log", "DVB: close file for a new recording.\r\n" ));
+			CloseOutputFile( CDev );
 		}
-		CDev->fd = fopen(cfilename, "wb");
-		flog(( "Native.log", "DVB: open file:%s  0x%lx.\r\n", cfilename, CDev->fd ));
+		CDev->outFile = OpenOutputFile( CDev, cfilename );
 		
 #ifdef DEBUGDVB
 	sysOutPrint(env, "DVB: setup encoding %s.\r\n", cfilename);
@@ -599,16 +628,19 @@ JNIEXPORT jboolean JNICALL Java_sage_DVBCaptureDevice_setupEncoding0
 #ifndef STANDALONE
 		(*env)->ReleaseStringUTFChars(env, jfilename, cfilename);
 #endif
-		if (!CDev->fd)
+		if (!CDev->outFile)
 		{
 			throwEncodingException(env, __LINE__);
 			return JNI_FALSE;
 		}
 
-        CDev->discardCount=0;
         CDev->capState=0;
-        resetCircBuffer(&CDev->capBuffer);
-        CDev->capThread = ACL_CreateThread(CaptureThread, CDev);
+        resetSPSCRing(&CDev->capBuffer);
+        if(CDev->dbg.capture_reactor>0)
+            AttachCaptureReactor(CDev);
+        if(CDev->capSource==NULL)
+            CDev->capThread = ACL_CreateThread(CaptureThread, CDev);
+        playCapReplay(CDev->replay);
 	
 		return JNI_TRUE;
 	}
@@ -631,14 +663,14 @@ JNIEXPORT jboolean JNICALL Java_sage_DVBCaptureDevice_switchEncoding0
 	if (ptr)
 	{
 		DVBCaptureDev *CDev =  INT64_TO_PTR(DVBCaptureDev *,ptr);
+		int switched;
 #ifndef FILETRANSITION
-		if (CDev->fd)
+		if (CDev->outFile)
 		{
 			//drain data in buffer before close
 			FlushOutBufferData( CDev );
-			fclose(CDev->fd);
-			flog(( "Native.log", "DVB: close file:0x%lx for switch to a new recording.\r\n", CDev->fd ));
-			CDev->fd = 0;
+			flog(( "Native.log", "DVB: close file for switch to a new recording.\r\n" ));
+			CloseOutputFile( CDev );
 		}
 #endif
 		// Open up the file we're going to write to
@@ -648,36 +680,28 @@ JNIEXPORT jboolean JNICALL Java_sage_DVBCaptureDevice_switchEncoding0
 		const char* cfilename = (*env)->GetStringUTFChars(env, jfilename, NULL);
 #endif
 #ifdef FILETRANSITION
-		CDev->newfd = fopen(cfilename, "wb");
-		flog(( "Native.log", "DVB: switch open file:%s  set to next file.\r\n", cfilename));
-#ifndef STANDALONE
-		(*env)->ReleaseStringUTFChars(env, jfilename, cfilename);
-#endif
+		// the next file is taken at a sequence start (PS) or HDPVR video AUD (TS), or after 8MB without one
+		switched = CDev->outFile != NULL &&
+			SwitchTimeShiftFile( CDev->outFile, cfilename, getOutputFormat( &CDev->channel ) == 1 ? TIMESHIFT_PS : TIMESHIFT_TS,
+								 0, TIMESHIFT_TRANSITION_LIMIT );
+		flog(( "Native.log", "DVB: switch open file:%s  %s.\r\n", cfilename, switched ? "set to next file" : "failed" ));
 #else
-		CDev->fd = fopen(cfilename, "wb");
-		flog(( "Native.log", "DVB: switch open file:%s  0x%lx.\r\n", cfilename, CDev->fd ));
+		CDev->outFile = OpenOutputFile( CDev, cfilename );
+		switched = CDev->outFile != NULL;
+#endif
 #ifndef STANDALONE
 		(*env)->ReleaseStringUTFChars(env, jfilename, cfilename);
 #endif
-#endif
-#ifdef FILETRANSITION
-		if (!CDev->fd)
-#else
-		if (!CDev->newfd)
-#endif
+		if (!switched)
 		{
-			// This can be true in FILETRANSITION mode when newfd failed
-			if (CDev->fd)
-			{
-				fclose(CDev->fd);
-				CDev->fd = 0;
-			}
+			// This can be true in FILETRANSITION mode when the next file failed
+			CloseOutputFile( CDev );
 			throwEncodingException(env, __LINE__/*sage_EncodingException_FILESYSTEM*/);
 			return JNI_FALSE;
 		}
 #ifdef FILETRANSITION
 		flog(( "Native.log", "DVB: switch file going into eatEncoderData0 until file switched.\r\n"));
-		while(CDev->newfd)
+		while(TimeShiftSwitchPending(CDev->outFile))
 		{
 			Java_sage_DVBCaptureDevice_eatEncoderData0(env, jo, ptr);
 		}
@@ -709,23 +733,22 @@ JNIEXPORT jboolean JNICALL Java_sage_DVBCaptureDevice_closeEncoding0
 	if (ptr)
 	{
 		DVBCaptureDev *CDev =  INT64_TO_PTR(DVBCaptureDev *, ptr);
+		pauseCapReplay( CDev->replay );
+        if(CDev->capSource)
+            DetachCaptureReactor(CDev);
         if(CDev->capThread)
         {
-            ACL_LockMutex(CDev->capMutex);
             CDev->capState=2;
-            ACL_UnlockMutex(CDev->capMutex);
             sysOutPrint(env, "DVB: join capture thread\n");
             ACL_ThreadJoin(CDev->capThread);
             sysOutPrint(env, "DVB: capture thread stopped\n");
             ACL_RemoveThread(CDev->capThread);
             CDev->capThread=NULL;
         }
-		if (CDev->fd)
+		if (CDev->outFile)
 		{
-			flog(( "Native.log", "DVB: close file:0x%lx.\r\n", CDev->fd ));
 			FlushOutBufferData( CDev );
-			fclose(CDev->fd);
-			CDev->fd = 0;
+			CloseOutputFile( CDev );
 		}
 		return JNI_TRUE;
 	}
@@ -749,12 +772,19 @@ JNIEXPORT void JNICALL Java_sage_DVBCaptureDevice_destroyEncoder0
 	{
 		int i;
 		DVBCaptureDev *CDev =  INT64_TO_PTR(DVBCaptureDev *,ptr);
+#ifndef STANDALONE
+		MsgQueueStats msgStats;
+
+		statsMsgQueue( &msgStats );
+		flog(( "Native.log", "DVB: message queue posted:%llu delivered:%llu dropped:%llu batches:%llu max depth:%u\r\n",
+			msgStats.posted, msgStats.delivered, msgStats.dropped, msgStats.batches, msgStats.maxDepth ));
+#endif
 
+        if(CDev->capSource)
+            DetachCaptureReactor(CDev);
         if(CDev->capThread)
         {
-            ACL_LockMutex(CDev->capMutex);
             CDev->capState=2;
-            ACL_UnlockMutex(CDev->capMutex);
             sysOutPrint(env, "DVB: join capture thread\n");
             ACL_ThreadJoin(CDev->capThread);
             sysOutPrint(env, "DVB: capture thread stopped\n");
@@ -772,6 +802,15 @@ JNIEXPORT void JNICALL Java_sage_DVBCaptureDevice_destroyEncoder0
 			fclose( CDev->dbg.source_fd );
 			CDev->dbg.source_fd = 0;
 		}
+		if ( CDev->replay )
+		{
+			CapReplayStats replayStats;
+			statsCapReplay( CDev->replay, &replayStats );
+			flog(( "Native.log", "DVB: stand-in device sent:%llu dropped:%llu loops:%u\r\n",
+				replayStats.sentBytes, replayStats.droppedBytes, replayStats.loops ));
+			closeCapReplay( CDev->replay );
+			CDev->replay = NULL;
+		}
 		
 		if (CDev->frontendFd)
 		{
@@ -807,16 +846,10 @@ JNIEXPORT void JNICALL Java_sage_DVBCaptureDevice_destroyEncoder0
 			 CDev->scanFilter = NULL;
 		}
 
-		if (CDev->fd)
-		{
-			flog(( "Native.log", "DVB: close file:0x%lx.\r\n", CDev->fd ));
-			fclose(CDev->fd);
-			CDev->fd = 0;
-		}
+		CloseOutputFile( CDev );
 
 
-        free(CDev->capBuffer.data);
-        ACL_RemoveMutex(CDev->capMutex);
+        freeSPSCRing(&CDev->capBuffer);
 
 		closeChannel( &CDev->channel );
 		free(CDev);
@@ -832,17 +865,14 @@ static int CaptureThread(void *data)
     struct timeval tv;
     int maxfd;
     int retval;
-    int state;
+    unsigned long long discardStart=0;
     struct sched_param scparam={0,};
     scparam.sched_priority=sched_get_priority_max(SCHED_FIFO);
     sched_setscheduler(0, SCHED_FIFO, &scparam);
     while(1)
     {
-        // Remove locks and merge with the main loop?
-        ACL_LockMutex(x->capMutex);
-        state=x->capState;
-        ACL_UnlockMutex(x->capMutex);
-        if(state==2) break;
+        // capBuffer is lock free, capState is only set to stop the thread
+        if(x->capState==2) break;
 
         FD_ZERO(&rfds);
         FD_SET(x->dvrFd, &rfds);
@@ -857,40 +887,43 @@ static int CaptureThread(void *data)
         {
             FD_CLR(x->dvrFd, &rfds);
             int numbytes;
-            numbytes = read(x->dvrFd, x->buf2, BUFFERSIZE);
-            ACL_LockMutex(x->capMutex);
+            int span=0;
+            unsigned char *ptr;
             // Can we reenter record mode
-            if(state==1 && freespaceCircBuffer(&x->capBuffer)>(CAPCIRCBUFFERSIZE/4))
+            if(x->capBuffer.discarding && freespaceSPSCRing(&x->capBuffer)>(int)x->capBuffer.resume)
             {
-                flog(( "Native.log", "DVB: leaving discard mode lost %d bytes\r\n", x->discardCount));
-                x->discardCount=0;
-                state=0;
+                flog(( "Native.log", "DVB: leaving discard mode lost %llu bytes\r\n",
+                    x->capBuffer.droppedBytes-discardStart));
+                x->capBuffer.discarding=0;
             }
-            if(numbytes>0)
+            if(!x->capBuffer.discarding)
+                span=writeSpanSPSCRing(&x->capBuffer, &ptr);
+            if(span>0)
             {
-                if(state==0 && freespaceCircBuffer(&x->capBuffer)>=numbytes)
-                {
-                    // We can add to our capture buffer
-                    addCircBuffer(&x->capBuffer, x->buf2, numbytes);
-                }
-                else
+                // read straight into the capture buffer
+                numbytes = read(x->dvrFd, ptr, span>BUFFERSIZE ? BUFFERSIZE : span);
+                if(numbytes>0)
+                    commitWriteSPSCRing(&x->capBuffer, numbytes);
+            }
+            else
+            {
+                numbytes = read(x->dvrFd, x->buf2, BUFFERSIZE);
+                if(numbytes>0)
                 {
-                    // Enter discard mode
-                    if(state!=1) flog(( "Native.log", "DVB: entering discard mode\r\n"));
-                    state=1; 
-                    x->discardCount+=numbytes;
+                    int discarding=x->capBuffer.discarding;
+                    if(!pushSPSCRing(&x->capBuffer, x->buf2, numbytes) && !discarding)
+                    {
+                        // Enter discard mode
+                        flog(( "Native.log", "DVB: entering discard mode (%u)\r\n", x->capBuffer.dropEvents));
+                        discardStart=x->capBuffer.droppedBytes-numbytes;
+                    }
                 }
             }
-            else if(numbytes<0)
+            if(numbytes<0)
             {
                 // JFT TODO: see with Qian if that's safe to call from that thread
                 flog(( "Native.log", "DVB: eatEncodeData error errno : %d\r\n", errno));
             }
-            if(x->capState!=2)
-            {
-                x->capState=state;
-            }
-            ACL_UnlockMutex(x->capMutex);
         }
     }
     return 0;
@@ -924,62 +957,54 @@ JNIEXPORT jint JNICALL Java_sage_DVBCaptureDevice_eatEncoderData0
 		fds.fd = CDev->dvrFd;
 		fds.events =  POLLIN|POLLPRI|POLLERR|POLLERR|POLLNVAL;
 		int numbytes = 0;
+		int ringBytes = 0;
+		unsigned long long replayStart = 0;
+		unsigned char *pData = CDev->buf;
 		while (readMore)
 		{
-			//debug source overide data input from device
-			if ( CDev->dbg.debug_source_mode && CDev->dbg.source_fd != NULL )
+			//debug source overide data input from device, the stand-in device of mode 1 and 3 is read as dvrFd
+			if ( CDev->dbg.debug_source_mode == CAP_REPLAY_SUBSTITUTE && CDev->dbg.source_fd != NULL )
 			{
-				if ( CDev->dbg.debug_source_mode != 2 )
+				if ( ( ret = poll( &fds, 1, 10000 )) < 0  )
 				{
-					unsigned long ep, ep_epect;
-					numbytes = fread( CDev->buf, 1, BUFFERSIZE, CDev->dbg.source_fd );
-					if ( numbytes == 0 ) fseek( CDev->dbg.source_fd, 0, SEEK_SET );
+					flog(( "Native.log", "ERROR: poll errno:%d\r\n", errno ));
+					return 0;
+				}
+				if ( ( fds.revents & (POLLIN|POLLPRI )) == 0  ) return 0; 
 
-					//keep stream at constant rate
-					ep = msElipse( CDev->startTime );
-					ep_epect = (CDev->totalInputBytes + numbytes)/2358;  //ATSC: rate 2358 bytes/sec
-					if ( ep_epect > ep )
-					{
-						usleep( (ep_epect - ep)*1000 );
-					}
-					
-				} 
-				else
+				numbytes = read(CDev->dvrFd, CDev->buf, BUFFERSIZE);
+				if ( numbytes < 0 )  
 				{
-					if ( ( ret = poll( &fds, 1, 10000 )) < 0  )
-					{
-						flog(( "Native.log", "ERROR: poll errno:%d\r\n", errno ));
-						return 0;
-					}
-					if ( ( fds.revents & (POLLIN|POLLPRI )) == 0  ) return 0; 
-
-					numbytes = read(CDev->dvrFd, CDev->buf, BUFFERSIZE);
-					if ( numbytes < 0 )  
-					{
-						if (errno == EBUSY || errno == EAGAIN || errno == EWOULDBLOCK)
-							usleep( 10000 ); 
-						return 0;
-					}
-					if ( numbytes )
-					{
-						numbytes = fread( CDev->buf, 1, numbytes, CDev->dbg.source_fd );
-						if ( numbytes == 0 ) fseek( CDev->dbg.source_fd, 0, SEEK_SET );
-					}
-					
+					if (errno == EBUSY || errno == EAGAIN || errno == EWOULDBLOCK)
+						usleep( 10000 ); 
+					return 0;
+				}
+				if ( numbytes )
+				{
+					numbytes = fread( CDev->buf, 1, numbytes, CDev->dbg.source_fd );
+					if ( numbytes == 0 ) fseek( CDev->dbg.source_fd, 0, SEEK_SET );
 				}
 				readMore = 0;
 				
 			} else
 			{
-                ACL_LockMutex(CDev->capMutex);
-                numbytes = usedspaceCircBuffer(&CDev->capBuffer);
+                // parse in place in the capture buffer, released after SplitStream
+                numbytes = readSpanSPSCRing(&CDev->capBuffer, &pData);
                 numbytes = numbytes > BUFFERSIZE ?  BUFFERSIZE : numbytes;
-                getCircBuffer(&CDev->capBuffer, CDev->buf, numbytes);
-                ACL_UnlockMutex(CDev->capMutex);
+                ringBytes = numbytes;
                 if(numbytes==0)
                 {
-                    ACL_Delay(10);
-                    loopcount++;
+                    if(CDev->capSource)
+                    {
+                        // sleep till the reactor has read a full buffer, one second at most as below
+                        if(waitCaptureSource(CDev->capSource, BUFFERSIZE, 50)<=0)
+                            loopcount+=5;
+                    }
+                    else
+                    {
+                        ACL_Delay(10);
+                        loopcount++;
+                    }
                     if(loopcount>100) return 0;
                 }
                 else
@@ -1014,13 +1039,20 @@ JNIEXPORT jint JNICALL Java_sage_DVBCaptureDevice_eatEncoderData0
 		}
 
 		unsigned long long prevOutBytes = CDev->totalProcessedBytes;
+		if ( CDev->replay )
+			replayStart = capReplayUs();
 		if ( numbytes > 0 )
 		{
 			CDev->totalInputBytes += numbytes;
-			SplitStream( CDev, (char*)CDev->buf, numbytes );
+			SplitStream( CDev, (char*)pData, numbytes );
 		}
+		if ( ringBytes )
+			commitReadSPSCRing( &CDev->capBuffer, ringBytes );
 
-		fflush(CDev->fd);
+		if ( CDev->outFile )
+			FlushTimeShiftFile( CDev->outFile );
+		if ( CDev->replay )
+			ReportStandInData( CDev, ringBytes, replayStart );
 		unsigned long long count = CDev->totalProcessedBytes - prevOutBytes;
 		return (jint) count;
 	}
@@ -1075,7 +1107,7 @@ JNIEXPORT jboolean JNICALL Java_sage_DVBCaptureDevice_setChannel0
 		CDev->dbg.dumped_bytes = 0;
 		flog(("Native.log", "Raw data dumper set to:%s.\r\n", name ));
 	}
-	if ( CDev->dbg.debug_source[0] )
+	if ( CDev->dbg.debug_source[0] && CDev->dbg.debug_source_mode == CAP_REPLAY_SUBSTITUTE )
 	{
 		if ( CDev->dbg.source_fd > 0 )
 			fclose( CDev->dbg.source_fd );
@@ -1099,6 +1131,13 @@ JNIEXPORT jboolean JNICALL Java_sage_DVBCaptureDevice_setChannel0
 	CDev->totalInputBytes = 0;
 	CDev->lastOutputBytes = 0;
 	CDev->startTime = msElipse( 0 );
+	if ( CDev->replay )
+	{
+		//the stand-in device plays once capture runs, a tune while recording restarts it
+		if ( CDev->capThread != NULL || CDev->capSource != NULL )
+			playCapReplay( CDev->replay );
+		return JNI_TRUE;
+	}
 	//SelectOuputFormat( CDev->remuxer, getOutputFormat( &CDev->channel ) ); //0:TS; 1:PS
 	int count = 0;
 	while ( count<10 )
@@ -1359,6 +1398,8 @@ static int setHardDemuxPid( DVBCaptureDev *CDev, int pid, int slot )
 int checkLocked( DVBCaptureDev *CDev )
 {
 	int status;
+	if ( StandInTuner( CDev ) )
+		return 1;
 	if ( ioctl(CDev->frontendFd,FE_READ_STATUS,&status) < 0 )
 	{
 		return -1;
@@ -2177,6 +2218,7 @@ int LoadDebugCfg( DBG* dbg )
 	
 	dbg->raw_dump_path[0] = 0;
 	dbg->debug_source[0] = 0;
+	dbg->debug_source_speed = CAP_REPLAY_REALTIME;
 	FILE* fd = fopen( DEBUG_SERVER_CFG, "rt" );
 	if ( fd == NULL )
 	{	
@@ -2204,6 +2246,11 @@ int LoadDebugCfg( DBG* dbg )
 				flog(( "Native.log",  "DVB:debug source from '%s' mode:%d\r\n", ext, val ));
 				strncpy( dbg->debug_source, ext, sizeof(dbg->debug_source) );
 				dbg->debug_source_mode = (int)val;
+			} else
+			if ( !strcmp( name, "debugsource_speed" ) && val >= 0 )
+			{
+				flog(( "Native.log",  "DVB:debug source speed %d%%\r\n", val ));
+				dbg->debug_source_speed = val;
 			}
 			if ( !strcmp( name, "audio_ctrl" ) && val != 0 )
 			{
@@ -2212,6 +2259,23 @@ int LoadDebugCfg( DBG* dbg )
 				                     (dbg->audio_ctrl&0x01) ? "multiple audio disabled" : "" ));
 				
 			}
+			if ( !strcmp( name, "record_writer" ) && val > 0 )
+			{
+				dbg->record_writer = val;
+				flog(( "Native.log",  "DVB:record writer mode:%d\r\n", val ));
+			}
+			if ( !strcmp( name, "record_sync" ) && val > 0 )
+				dbg->record_sync = (unsigned long)val*1024*1024;  //Mbytes
+			if ( !strcmp( name, "timeshift_share" ) && val > 0 )
+			{
+				dbg->timeshift_share = val;
+				flog(( "Native.log",  "DVB:time-shift share mode:%d\r\n", val ));
+			}
+			if ( !strcmp( name, "capture_reactor" ) && val > 0 )
+			{
+				dbg->capture_reactor = val;
+				flog(( "Native.log",  "DVB:capture reactor threads:%d\r\n", val ));
+			}
 		}
 	}
 	
@@ -2364,138 +2428,106 @@ static int FlushOutBufferData( DVBCaptureDev *CDev )
 
 }
 
-// NOTE: This could get bad start codes.
-static int verifyPSBlock(unsigned char *data, int videotype)
+//time-shift output file, "record_writer" in debugserver.ini puts a RecordWriter on it:
+//1 auto engine, 2 pwritev, 3 io_uring, add 16 for O_DIRECT. "record_sync" fdatasync every N MB.
+//A keyframe index sidecar "<recording>.idx" is kept for PS output, a circular file isn't indexed.
+//"timeshift_share" publishes the write position under /dev/shm (1), and the latest data for a
+//live TV reader (2, TimeShiftReader.h), it's woken at each write.
+static void* OpenOutputFile( DVBCaptureDev *CDev, const char* pFileName )
 {
-    unsigned char b;
-    unsigned int pos=0;
-    int cur=0xFFFFFFFF;
-    while(pos<2048)
-    {
-        b=data[pos];
-        pos+=1;
-        cur<<=8;
-        cur|=b;
-        if(videotype==2)
-        {
-            if((cur&0xFFFFFF00)==0x00000100)
-            {
-                /* video */
-                if((b==0xB3))
-                {
-                    return 1;
-                }
-            }
-        }
-        else if(videotype==3)
-        {
-            if((cur&0xFFFFFFFF)==0x00000001)
-            {
-                if((pos+3)<2048)
-                {
-                    if( data[pos]==0x09 &&
-                        data[pos+1]==0x10 &&
-                        data[pos+2]==0x00)
-                    {
-                        return 1;
-                    }
-                }
-            }
-        }
-        else
-        {
-            return 1;
-        }
-    }
-    return 0;
+	void* file;
+	int flag = CDev->dbg.record_writer & TIMESHIFT_WRITER;
+	if ( getOutputFormat( &CDev->channel ) == 1 )
+		flag |= TIMESHIFT_INDEX;
+	if ( CDev->dbg.timeshift_share )
+		flag |= CDev->dbg.timeshift_share > 1 ? TIMESHIFT_SHARED_DATA : TIMESHIFT_PUBLISH;
+	file = OpenTimeShiftFile( pFileName, CDev->circFileSize, flag );
+	SetupTimeShiftSync( file, CDev->dbg.record_sync );
+	flog(( "Native.log", "DVB: open file:%s %s (writer:%s).\r\n", pFileName, file ? "" : "failed", TimeShiftWriterName( file ) ));
+	return file;
 }
 
-// TODO: implement TS support for other source than HDPVR
-// Videotype 1: mpeg1 2:mpeg2 3:h264
-static int findTransitionPoint(unsigned char* data, int length, int flags, int videotype)
+static void CloseOutputFile( DVBCaptureDev *CDev )
 {
-    int numbytes=length;
+	if ( CDev->outFile == NULL )
+		return;
+	flog(( "Native.log", "DVB: close file:%s.\r\n", TimeShiftFileName( CDev->outFile ) ));
+	CloseTimeShiftFile( CDev->outFile );
+	CDev->outFile = NULL;
+}
 
-    // MPEG2-TS format
-    if(flags==1)
-    {
-        int i, tsstart=-1, tsvidpacket=-1;//, seqstart=-1;
-        // For the HDPVR our input is a tranport stream, we must find a valid start point
-        // in the video pid 0x1011 of 00 00 01 09 10 00
+//stand-in device of debugsource mode 1 and 3, the file is played into a pipe read as the dvr
+static int OpenStandInDvr( DVBCaptureDev *CDev )
+{
+	int fd;
+	if ( !CDev->dbg.debug_source[0] ||
+		 ( CDev->dbg.debug_source_mode != CAP_REPLAY_STANDIN && CDev->dbg.debug_source_mode != CAP_REPLAY_NO_DEVICE ) )
+		return 0;
+	if ( ( CDev->replay = openCapReplay( CDev->dbg.debug_source, CDev->dbg.debug_source_speed ) ) == NULL )
+	{
+		flog(( "Native.log", "DVB: failed open stand-in device file %s\r\n", CDev->dbg.debug_source ));
+		return 0;
+	}
+	if ( ( fd = startCapReplayPipe( CDev->replay, CDev->dmx_buffer_size ) ) < 0 )
+	{
+		closeCapReplay( CDev->replay );
+		CDev->replay = NULL;
+		return 0;
+	}
+	CDev->dvrFd = fd;
+	CDev->replayDropped = 0;
+	return 1;
+}
 
-        // First we try to locate ts packets
-        for(i=0;i<numbytes;i++)
-        {
-            if(data[i]==0x47 && 
-                (i+188)<numbytes && data[i+188]==0x47 &&
-                (i+188*2)<numbytes && data[i+188*2]==0x47)
-            {
-                tsstart=i;
-                break;
-            }
-        }
+//debugsource mode 3 has no frontend, tuning is dry and always locks
+static int StandInTuner( DVBCaptureDev *CDev )
+{
+	return CDev->frontendFd < 0 && CDev->replay != NULL;
+}
 
-        // Second we find a ts packet with section start and pid 0x1011
-        while((i+188)<=numbytes)
-        {
-            if(data[i]==0x47 &&
-                data[i+1]==0x50 &&
-                data[i+2]==0x11)
-            {
-                tsvidpacket=i;
-                // Verify if that packet contains the magic sequence 00 00 00 01 09 10 00
-                // If it does, the data up to the begining of this TS packet go in old file 
-                // and the new data in the new file
-                int j;
-                for(j=4;j<188-7;j++)
-                {
-                    // NOTE: we could implement faster search but the number of
-                    // matched packet that reach this point should be quite small...
-                    if(data[i+j]==0x00 &&
-                        data[i+j+1]==0x00 &&
-                        data[i+j+2]==0x00 &&
-                        data[i+j+3]==0x01 &&
-                        data[i+j+4]==0x09 &&
-                        data[i+j+5]==0x10 &&
-                        data[i+j+6]==0x00)
-                    {
-                        // We have found the vid packet with the magic sequence, write that to old file
-                        return tsvidpacket;
-                    }
-                }
-            }
-            i+=188;
-        }
-    }
-    else // MPEG2-PS
-    {
-        // For the IVTV cards we must find a sequence start inside the video stream
-        // we are looking for 00 00 01 B3
-        int i=0, psstart=-1;
-        // IVTV use 2K blocks
-        // First locate the 00 00 01 BA block
-        while(i<=numbytes-2048)
-        {
-            if(data[i]==0x00 && 
-                data[i+1]==0x00 &&
-                data[i+2]==0x01 &&
-                data[i+3]==0xBA)
-            {
-                psstart=i;
-                if(verifyPSBlock(&data[i], videotype))
-                {
-                    // We have found the sequence start
-                    return psstart;
-                }
-                i+=2048;
-            }
-            else
-            {
-                i++;
-            }
-        }
-    }
-    return -1;
+//bytes taken off the stand-in device, what the capture ring dropped counts as consumed
+static void ReportStandInData( DVBCaptureDev *CDev, int nBytes, unsigned long long startUs )
+{
+	unsigned long long dropped = CDev->capBuffer.droppedBytes - CDev->replayDropped;
+	CDev->replayDropped += dropped;
+	if ( nBytes > 0 || dropped > 0 )
+		consumedCapReplay( CDev->replay, nBytes + dropped, (unsigned long)( capReplayUs() - startUs ) );
+}
+
+//optional capture reactor shared by all devices, "capture_reactor" N in debugserver.ini runs N epoll
+//threads that read every dvr fd into its capBuffer in place of one CaptureThread per device.
+static CaptureReactor *captureReactor = NULL;
+static int captureReactorUsers = 0;
+static pthread_mutex_t captureReactorLock = PTHREAD_MUTEX_INITIALIZER;
+
+static void AttachCaptureReactor( DVBCaptureDev *CDev )
+{
+	pthread_mutex_lock( &captureReactorLock );
+	if ( captureReactor == NULL )
+		captureReactor = createCaptureReactor( CDev->dbg.capture_reactor, 0, -1 );
+	if ( captureReactor != NULL )
+		CDev->capSource = addCaptureSource( captureReactor, CDev->dvrFd, &CDev->capBuffer );
+	if ( CDev->capSource != NULL )
+		captureReactorUsers++;
+	else
+		flog(( "Native.log", "DVB: capture reactor isn't available, use capture thread.\r\n" ));
+	pthread_mutex_unlock( &captureReactorLock );
+}
+
+static void DetachCaptureReactor( DVBCaptureDev *CDev )
+{
+	pthread_mutex_lock( &captureReactorLock );
+	removeCaptureSource( captureReactor, CDev->capSource );
+	CDev->capSource = NULL;
+	if ( CDev->capBuffer.dropEvents )
+		flog(( "Native.log", "DVB: capture reactor discarded %llu bytes in %u times\r\n",
+				CDev->capBuffer.droppedBytes, CDev->capBuffer.dropEvents ));
+	if ( --captureReactorUsers == 0 )
+	{
+		destroyCaptureReactor( captureReactor );
+		captureReactor = NULL;
+	}
+	pthread_mutex_unlock( &captureReactorLock );
 }
 
 //callback function for SplitStream write out data
@@ -2504,114 +2536,14 @@ static int OutputDump( void* pContext, void* pDataBlk, int lBytes )
 	DVBCaptureDev *CDev = (DVBCaptureDev*)pContext;
 	OUTPUT_DATA   *pDataBuffer = (OUTPUT_DATA*)pDataBlk;
 	unsigned char* pData = pDataBuffer->data_ptr;
-	int numbytes = pDataBuffer->bytes;
-	int writtenBytes = 0;
-
-#ifdef FILETRANSITION
-    // We want to switch to the new fd as soon as we get a good starting point
-    if(CDev->newfd)
-    {
-         int transitionpos = findTransitionPoint(pData, numbytes,
-            CDev->detectmode==2 ? 1 : 0, CDev->detecttype);
-    	//int transitionpos = 0;
-    	int bufSkip=transitionpos;
-        if(transitionpos!=-1)
-        {
-            if (!CDev->circFileSize && CDev->fd>0)
-            {
-                // TODO: Do we care if this fails?
-                writtenBytes = fwrite(pData, 1, bufSkip, CDev->fd);
-				if ( writtenBytes < 0 ) writtenBytes = 0;
-             }
-            flog(( "Native.log", "transition found after %d bytes switching fd.\r\n", CDev->bytesTested));
-            if ( CDev->fd>0 )
-            	fclose(CDev->fd);
-            CDev->fd=CDev->newfd;
-            CDev->newfd=0;
-        }
-        else
-        {
-            CDev->bytesTested+=numbytes;
-            // We might want to have different numbers or base it on bitrates
-            if(CDev->bytesTested>8*1024*1024)
-            {
-                flog(( "Native.log", "transition limit reached, switching fd.\r\n"));
-                if ( CDev->fd>0 )
-                	fclose(CDev->fd);
-                CDev->fd=CDev->newfd;
-                CDev->newfd=0;
-            }
-			bufSkip = 0;
-        }
-        pData+=bufSkip;
-        lBytes-=bufSkip;
-    }
-	CDev->dumpBytes += writtenBytes;    //there is a trouble here, I don't know dumpBytes is old or new file.
-#endif
-	if (CDev->circFileSize && CDev->fd>0 )
-	{
-		if (CDev->circWritePos == CDev->circFileSize)
-		{
-			// Wrap it now
-			fseek(CDev->fd, 0, 0);
-			CDev->circWritePos = 0;
-		}
-		if (CDev->circWritePos + numbytes <= CDev->circFileSize)
-		{
-			// No wrapping this time
-			writtenBytes = fwrite(pData, 1, numbytes, CDev->fd);
-			if ( writtenBytes < 0 )
-			{
-				return 0;
-			}
-			CDev->circWritePos += numbytes;
-			fflush( CDev->fd );
-		}
-		else
-		{
-			writtenBytes = fwrite(pData, 1, CDev->circFileSize - CDev->circWritePos, CDev->fd);
-			if ( writtenBytes < 0 )
-			{
-				return 0;
-			}
-			fflush( CDev->fd );
-			int remBytes = numbytes - (CDev->circFileSize - CDev->circWritePos);
-			// Wrap it now
-			fseek(CDev->fd, 0, 0);
-			CDev->circWritePos = remBytes;
-			int bytes = fwrite(pData + (numbytes - remBytes), 1, remBytes, CDev->fd);
-			if ( bytes < 0 )
-			{
-				return 0;
-			}
-			writtenBytes += bytes;
-			fflush( CDev->fd );
-		}
+	int writtenBytes;
 
-	}
-	else
+	//a pending next file is taken at a transition point, RecordWriter batches blocks till eatEncoderData0 flushes it
+	if ( pData == NULL || CDev->outFile == NULL ||
+		 ( writtenBytes = WriteTimeShiftData( CDev->outFile, pData, pDataBuffer->bytes ) ) < 0 )
 	{
-		if (pData==NULL || CDev->fd<=0 || (writtenBytes = fwrite(pData, 1, numbytes, CDev->fd)) == -1)
-		{
-	        flog(( "Native.log", "error in OutputDump %X 0x%X.\r\n", pData, CDev->fd));
-		    return 0;
-		}
-		if ( writtenBytes < 0 )
-		{
-		    flog(( "Native.log", "error fwrite, return %d 0x%X.\r\n", writtenBytes, CDev->fd));
-			writtenBytes = 0;
-		}
-
-		if ( CDev->fd>0 )
-		{
-			if(CDev->syncBytes>5*1024*1024)
-            {
-                //fdatasync(fileno(CDev->fd));
-                CDev->syncBytes=0;
-            }
-            CDev->syncBytes+=writtenBytes;
-            fflush( CDev->fd );
-		}
+		flog(( "Native.log", "error in OutputDump %p %s.\r\n", pData, TimeShiftFileName( CDev->outFile ) ));
+		return 0;
 	}
 	CDev->dumpBytes += writtenBytes;
 	return 1;
@@ -2753,15 +2685,7 @@ unsigned long msElipse( unsigned long start_time )
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////
-static JavaVM* vmBuf = 0;
-static jsize numVMs;
-static jclass msgMgrClass = 0;
-static jmethodID postMsgMeth = 0;
-static jclass msgClass = 0;
-static jmethodID msgConstructor = 0;
-static unsigned long msg_id = 0;
-
-//post message into Java code
+//post message into Java code, through the message queue the dispatcher thread delivers in batches
 #ifdef STANDALONE
 void postMessage( char* pSrc, char* pData, int MsgType, int Priority )
 {
@@ -2771,42 +2695,7 @@ void postMessage( char* pSrc, char* pData, int MsgType, int Priority )
 #else
 void postMessage( char* pSrc, char* pData, int MsgType, int Priority )
 {
-	JNIEnv* env;
-
-	//we sould have a lock here, for mutiple thread
-	if (!vmBuf)
-	{
-		if (JNI_GetCreatedJavaVMs(&vmBuf, 1, &numVMs))
-		{
-			return;
-		}
-	}
-
-	jint threadState = (*vmBuf)->GetEnv( vmBuf, (void**)&env, JNI_VERSION_1_2 );
-	if (threadState == JNI_EDETACHED)
-	{
-		(*vmBuf)->AttachCurrentThread(vmBuf, (void**)&env, NULL);
-	}
-
-	if ( !msgMgrClass )
-	{
-		msgMgrClass = (jclass) (*env)->NewGlobalRef(env, (*env)->FindClass(env, "sage/msg/MsgManager"));
-		if (msgMgrClass)
-			postMsgMeth = (*env)->GetStaticMethodID(env, msgMgrClass, "postMessage", "(Lsage/msg/SageMsg;)V");
-		msgClass = (jclass)((*env)->NewGlobalRef(env, (*env)->FindClass(env, "sage/msg/SageMsg")));
-		if (msgClass)
-			msgConstructor = (*env)->GetMethodID(env, msgClass, "<init>", "(ILjava/lang/Object;Ljava/lang/Object;I)V");
-	}
-
-	int dataLen = strlen(pData);
-	jbyteArray javaData = (*env)->NewByteArray(env, dataLen);
-	(*env)->SetByteArrayRegion(env, javaData, 0, dataLen, (const jbyte*)pData);
-	jobject msgObj = (*env)->NewObject(env, msgClass, msgConstructor, MsgType, (*env)->NewStringUTF(env, pSrc), javaData, Priority );
-	(*env)->CallStaticVoidMethod( env, msgMgrClass, postMsgMeth, msgObj );
-	msg_id++;
-
-	if ( threadState == JNI_EDETACHED )
-		(*vmBuf)->DetachCurrentThread(vmBuf);
+	postQueuedMessage( pSrc, pData, strlen(pData), MsgType, Priority );
 }
 #endif
 /////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -2816,7 +2705,7 @@ int SageTuneATSCChannel( void* Capture, ATSC_FREQ* atsc, int dryTune )
 {
 	DVBCaptureDev *CDev = Capture;
 	if ( CDev == NULL ) return -1;
-	return tuneATSCChannel( CDev,  atsc, dryTune );
+	return tuneATSCChannel( CDev,  atsc, dryTune || StandInTuner( CDev ) );
 }
 
 int SageTuneQAMFrequency( void* Capture, QAM_FREQ* qam, int dryTune )
@@ -2839,7 +2728,7 @@ int SageTuneQAMFrequency( void* Capture, QAM_FREQ* qam, int dryTune )
 		break;
 	}
 	if ( CDev == NULL ) return -1;
-	return tuneQAMFrequency( CDev, &dvb_qam, dryTune );
+	return tuneQAMFrequency( CDev, &dvb_qam, dryTune || StandInTuner( CDev ) );
 }
  
 
@@ -2847,21 +2736,21 @@ int SageTuneDVBTFrequency( void* Capture, DVB_T_FREQ* dvbt, int dryTune )
 {
 	DVBCaptureDev *CDev = Capture;
 	if ( CDev == NULL ) return -1;
-	return tuneDVBTFrequency( CDev, dvbt, dryTune );
+	return tuneDVBTFrequency( CDev, dvbt, dryTune || StandInTuner( CDev ) );
 }
 
 int SageTuneDVBCFrequency( void* Capture, DVB_C_FREQ* dvbc, int dryTune )
 {
 	DVBCaptureDev *CDev = Capture;
 	if ( CDev == NULL ) return -1;
-	return tuneDVBCFrequency( CDev, dvbc, dryTune );
+	return tuneDVBCFrequency( CDev, dvbc, dryTune || StandInTuner( CDev ) );
 }
 
 int SageTuneDVBSFrequency( void* Capture, DVB_S_FREQ* dvbs, int dryTune )
 {
 	DVBCaptureDev *CDev = Capture;
 	if ( CDev == NULL ) return -1;
-	return tuneDVBSFrequency( CDev, dvbs, dryTune );
+	return tuneDVBSFrequency( CDev, dvbs, dryTune || StandInTuner( CDev ) );
 }
 
 int SageCheckLocked( void* Capture )
@@ -3189,7 +3078,7 @@ JNIEXPORT jstring JNICALL Java_sage_DVBCaptureDevice_getCardModelUIDForDevice
 }
 
 
-#ifdef STANDALONE
+#if defined(STANDALONE) && !defined(CAPBENCH)
 // Test applications for recording
 
 int main(int argc, char **argv)
@@ -3241,3 +3130,89 @@ int main(int argc, char **argv)
     return 0;
 }
 #endif
+
+#if defined(STANDALONE) && defined(CAPBENCH)
+// Capture server sizing, N tuners on stand-in devices (debugsource 3 <file> in debugserver.ini of the
+// working directory) record at once, see capbench.h
+
+static void *benchOpen(void *context, int tuner)
+{
+    JNIEnv *denv=(JNIEnv *)1;
+    jobject dobj=NULL;
+    char name[32];
+    jlong encoder;
+
+    snprintf(name, sizeof(name), "adapter%d", tuner);
+    encoder=Java_sage_DVBCaptureDevice_createEncoder0(denv, dobj, name);
+    if(encoder==0)
+        return NULL;
+    if(INT64_TO_PTR(DVBCaptureDev *,encoder)->replay==NULL)
+    {
+        fprintf(stderr, "%s isn't on a stand-in device, check debugserver.ini\n", name);
+        Java_sage_DVBCaptureDevice_destroyEncoder0(denv, dobj, encoder);
+        return NULL;
+    }
+    if(!Java_sage_DVBCaptureDevice_setInput0(denv, dobj, encoder, 0, 0, "ATSC", 1, 0) ||
+       !Java_sage_DVBCaptureDevice_setChannel0(denv, dobj, encoder, (const char *)context))
+    {
+        Java_sage_DVBCaptureDevice_destroyEncoder0(denv, dobj, encoder);
+        return NULL;
+    }
+    return INT64_TO_PTR(DVBCaptureDev *,encoder);
+}
+
+static int benchStart(void *tuner, const char *outFile)
+{
+    return Java_sage_DVBCaptureDevice_setupEncoding0((JNIEnv *)1, NULL, PTR_TO_INT64(jlong,tuner), outFile, 0);
+}
+
+static int benchEat(void *tuner)
+{
+    return (int)Java_sage_DVBCaptureDevice_eatEncoderData0((JNIEnv *)1, NULL, PTR_TO_INT64(jlong,tuner));
+}
+
+static void benchStop(void *tuner)
+{
+    Java_sage_DVBCaptureDevice_closeEncoding0((JNIEnv *)1, NULL, PTR_TO_INT64(jlong,tuner));
+    stopCapReplay(((DVBCaptureDev *)tuner)->replay);
+}
+
+static void benchClose(void *tuner)
+{
+    Java_sage_DVBCaptureDevice_destroyEncoder0((JNIEnv *)1, NULL, PTR_TO_INT64(jlong,tuner));
+}
+
+static CapReplay *benchReplay(void *tuner)
+{
+    return ((DVBCaptureDev *)tuner)->replay;
+}
+
+static unsigned long long benchDropped(void *tuner)
+{
+    return ((DVBCaptureDev *)tuner)->capBuffer.droppedBytes;
+}
+
+int main(int argc, char **argv)
+{
+    static const CapBenchOps ops={ benchOpen, benchStart, benchEat, benchStop, benchClose, benchReplay, benchDropped };
+    CapBenchParams params={ "DVB", 1, 10, NULL };
+    const char *channel="0-0-0";
+    int c;
+
+    while((c=getopt(argc, argv, "t:s:d:c:"))!=-1)
+    {
+        switch(c)
+        {
+            case 't': params.tuners=atoi(optarg); break;
+            case 's': params.seconds=atoi(optarg); break;
+            case 'd': params.outDir=optarg; break;
+            case 'c': channel=optarg; break;
+            default:
+                fprintf(stderr, "Usage: capbench [-t tuners] [-s seconds] [-d outdir] [-c channel]\n"
+                        "  debugserver.ini: debugsource 3 <file.ts>, debugsource_speed <percent>\n");
+                exit(1);
+        }
+    }
+    return runCapBench(&ops, (void *)channel, &params);
+}
+#endif
@@ -41,6 +41,9 @@
 
 #include "sage_FirewireCaptureDevice.h"
 #include "sage_EncodingException.h"
+#include "NativeCore.h"
+#include "TimeShiftFile.h"
+#include "capreplay.h"
 
 #define BUFFERSIZE 188*16
 
@@ -70,11 +73,10 @@ static void sysOutPrint(JNIEnv* env, const char* cstr, ...)
 
 typedef struct FirewireCaptureDev
 {
-	FILE* fd; // file to write the captured data to
+	void* outFile; // TimeShiftFile to write the captured data to
 	long circFileSize;
 	char devName[256];
 	unsigned char buf[BUFFERSIZE];
-	long circWritePos;
 	raw1394handle_t handle;
 	octlet_t guid;
 	int port;        
@@ -85,6 +87,8 @@ typedef struct FirewireCaptureDev
 	int channel;
 	octlet_t datalen;
 	iec61883_mpeg2_t mpeg;
+	CapReplay *replay; // stand-in device of debugserver.ini, NULL with the real device
+	int replayFd; // its pipe, read in place of the isochronous receive
 } FirewireCaptureDev;
 
 
@@ -110,53 +114,11 @@ static octlet_t get_guid(raw1394handle_t handle, nodeid_t node)
 static int write_packet(unsigned char *data, int len, unsigned int dropped, void *callback_data)
 {
 	FirewireCaptureDev *CDev= (FirewireCaptureDev *) callback_data;
-	int numbytes=len;                
-	int bufSkip = 0;
-	if (numbytes)
-	{
-		if (CDev->circFileSize)
-		{
-			if (CDev->circWritePos == CDev->circFileSize)
-			{
-				// Wrap it now
-				fseek(CDev->fd, 0, 0);
-				CDev->circWritePos = 0;
-			}
-			if (CDev->circWritePos + numbytes <= CDev->circFileSize)
-			{
-				// No wrapping this time
-				if (fwrite(data + bufSkip, 1, numbytes, CDev->fd) == EOF)
-				{
-					return -1;
-				}
-				CDev->circWritePos += numbytes;
-				}
-			else
-			{
-				if (fwrite(data + bufSkip, 1, CDev->circFileSize - CDev->circWritePos, CDev->fd) == EOF)
-				{
-					return -1;
-				}
-				int remBytes = numbytes - (CDev->circFileSize - CDev->circWritePos);
-				// Wrap it now
-				fseek(CDev->fd, 0, 0);
-				CDev->circWritePos = 0;
-				if (fwrite(data + bufSkip + (numbytes - remBytes), 1, remBytes, CDev->fd) == EOF)
-				{
-					return -1;
-				}
-			}
-		}
-		else
-		{
-			if (fwrite(data + bufSkip, 1, numbytes, CDev->fd) == -1)
-			{
-				return -1;
-			}
-		}
-	}
+	// a circular file wraps without seek
+	if (len && WriteTimeShiftData(CDev->outFile, data, len) < 0)
+		return -1;
 	CDev->datalen+=len;
-	fflush(CDev->fd);
+	FlushTimeShiftFile(CDev->outFile);
 	return 0;
 }
 
@@ -206,7 +168,11 @@ JNIEXPORT jlong JNICALL Java_sage_FirewireCaptureDevice_createEncoder0
 	struct raw1394_portinfo portinfo[16];
 	int nports, port, i, device;
 	quadlet_t guid_lo, guid_hi;
+	char replayFile[448];
+	int replayMode, replaySpeed;
 	FirewireCaptureDev *CDev = (FirewireCaptureDev *) malloc(sizeof(FirewireCaptureDev));
+	memset(CDev, 0, sizeof(FirewireCaptureDev));
+	CDev->replayFd = -1;
 	const char* cdevname = (*env)->GetStringUTFChars(env, jdevname, NULL);
 	strcpy(CDev->devName, cdevname);
 	(*env)->ReleaseStringUTFChars(env, jdevname, cdevname);
@@ -231,9 +197,27 @@ JNIEXPORT jlong JNICALL Java_sage_FirewireCaptureDevice_createEncoder0
 	fflush(stdout);        
 #endif
 
+	// A recorded file standing in for the device, see capreplay.h
+	replayMode = loadCapReplayCfg("debugserver.ini", replayFile, sizeof(replayFile), &replaySpeed);
+	if(replayMode == CAP_REPLAY_STANDIN || replayMode == CAP_REPLAY_NO_DEVICE)
+	{
+		CDev->replay = openCapReplay(replayFile, replaySpeed);
+		if(CDev->replay)
+			sysOutPrint(env, "Firewire stand-in device plays %s at %d%% (mode:%d)\n", replayFile, replaySpeed, replayMode);
+		else
+			sysOutPrint(env, "Firewire failed open stand-in device file %s\n", replayFile);
+	}
+	if(CDev->replay && replayMode == CAP_REPLAY_NO_DEVICE)
+	{
+		CDev->handle = NULL;
+		CDev->node = -1;
+		return (jlong) CDev;
+	}
+
 	if(!(CDev->handle = raw1394_new_handle())) 
 	{
 		throwEncodingException(env, __LINE__);
+		closeCapReplay(CDev->replay);
 		free(CDev);
 		return 0;
 	}
@@ -242,6 +226,7 @@ JNIEXPORT jlong JNICALL Java_sage_FirewireCaptureDevice_createEncoder0
 	{
 		throwEncodingException(env, __LINE__);
 		raw1394_destroy_handle(CDev->handle);
+		closeCapReplay(CDev->replay);
 		free(CDev);
 		return 0;
 	}
@@ -272,6 +257,7 @@ JNIEXPORT jlong JNICALL Java_sage_FirewireCaptureDevice_createEncoder0
 #endif
 		throwEncodingException(env, __LINE__);
 		raw1394_destroy_handle(CDev->handle);
+		closeCapReplay(CDev->replay);
 		free(CDev);
 		return 0;
 	}
@@ -302,10 +288,12 @@ JNIEXPORT jboolean JNICALL Java_sage_FirewireCaptureDevice_setupEncoding0
 		CDev->circFileSize = (long) circSize;
 
 		const char* cfilename = (*env)->GetStringUTFChars(env, jfilename, NULL);
-		CDev->fd = fopen(cfilename, "wb");
+		if (CDev->outFile)
+			CloseTimeShiftFile(CDev->outFile);
+		CDev->outFile = OpenTimeShiftFile(cfilename, CDev->circFileSize, 0);
 		CDev->datalen=0;
 		(*env)->ReleaseStringUTFChars(env, jfilename, cfilename);
-		if (!CDev->fd)
+		if (!CDev->outFile)
 		{
 			throwEncodingException(env, __LINE__);
 			return JNI_FALSE;
@@ -313,6 +301,19 @@ JNIEXPORT jboolean JNICALL Java_sage_FirewireCaptureDevice_setupEncoding0
 		CDev->oplug=-1;
 		CDev->iplug=-1;
 		CDev->bandwidth=-1;
+		if(CDev->replay)
+		{
+			// the stand-in device's pipe takes the place of the receive
+			if((CDev->replayFd = startCapReplayPipe(CDev->replay, 0)) < 0)
+			{
+				CloseTimeShiftFile(CDev->outFile);
+				CDev->outFile = NULL;
+				throwEncodingException(env, __LINE__);
+				return JNI_FALSE;
+			}
+			playCapReplay(CDev->replay);
+			return JNI_TRUE;
+		}
 		CDev->channel = iec61883_cmp_connect (CDev->handle, CDev->node, &CDev->oplug,
 			raw1394_get_local_id (CDev->handle), &CDev->iplug, &CDev->bandwidth);
 		mpeg2_start_receive(env, CDev->handle, CDev, CDev->channel);
@@ -336,17 +337,19 @@ JNIEXPORT jboolean JNICALL Java_sage_FirewireCaptureDevice_switchEncoding0
 	if (ptr)
 	{
 		FirewireCaptureDev *CDev = (FirewireCaptureDev *) ptr;
-		if (CDev->fd)
-		{
-			fclose(CDev->fd);
-			CDev->fd = 0;
-		}
-		// Open up the file we're going to write to
+		// Open up the file we're going to write to, the packets of eatEncoderData0 go there from now on
 		const char* cfilename = (*env)->GetStringUTFChars(env, jfilename, NULL);
-		CDev->fd = fopen(cfilename, "wb");
+		int switched = SwitchTimeShiftFile(CDev->outFile, cfilename, TIMESHIFT_TS, 0, 0);
 		(*env)->ReleaseStringUTFChars(env, jfilename, cfilename);
-		if (!CDev->fd)
+		if (switched)
+			ForceTimeShiftSwitch(CDev->outFile);
+		else
 		{
+			if (CDev->outFile)
+			{
+				CloseTimeShiftFile(CDev->outFile);
+				CDev->outFile = NULL;
+			}
 			throwEncodingException(env, __LINE__/*sage_EncodingException_FILESYSTEM*/);
 			return JNI_FALSE;
 		}
@@ -373,10 +376,18 @@ JNIEXPORT jboolean JNICALL Java_sage_FirewireCaptureDevice_closeEncoding0
 			iec61883_mpeg2_close(CDev->mpeg);
 			CDev->mpeg=NULL;
 		}
-		if (CDev->fd)
+		if (CDev->outFile)
+		{
+			CloseTimeShiftFile(CDev->outFile);
+			CDev->outFile = NULL;
+		}
+		if(CDev->replay)
 		{
-			fclose(CDev->fd);
-			CDev->fd = 0;
+			stopCapReplay(CDev->replay);
+			if(CDev->replayFd >= 0)
+				close(CDev->replayFd);
+			CDev->replayFd = -1;
+			return JNI_TRUE;
 		}
 		iec61883_cmp_disconnect (CDev->handle, CDev->node, CDev->oplug,
 			raw1394_get_local_id(CDev->handle), CDev->iplug,
@@ -401,7 +412,20 @@ JNIEXPORT void JNICALL Java_sage_FirewireCaptureDevice_destroyEncoder0
 	if (ptr)
 	{
 		FirewireCaptureDev *CDev = (FirewireCaptureDev *) ptr;
-		raw1394_destroy_handle(CDev->handle);
+		if(CDev->outFile)
+			CloseTimeShiftFile(CDev->outFile);
+		if(CDev->handle)
+			raw1394_destroy_handle(CDev->handle);
+		if(CDev->replay)
+		{
+			CapReplayStats stats;
+			statsCapReplay(CDev->replay, &stats);
+			sysOutPrint(env, "Firewire stand-in device sent %llu bytes, dropped %llu, %u loops\n",
+				stats.sentBytes, stats.droppedBytes, stats.loops);
+			if(CDev->replayFd >= 0)
+				close(CDev->replayFd);
+			closeCapReplay(CDev->replay);
+		}
 		free(CDev);
 	}
 }
@@ -422,7 +446,29 @@ JNIEXPORT jint JNICALL Java_sage_FirewireCaptureDevice_eatEncoderData0
 		int numbytes = 0;
 		while (readMore) // for now we don't loop
 		{
-			if(CDev->mpeg)
+			if(CDev->replay && CDev->replayFd >= 0)
+			{
+				struct timeval tv;
+				fd_set rfds;
+				int n = 0;
+
+				FD_ZERO (&rfds);
+				FD_SET (CDev->replayFd, &rfds);
+				tv.tv_sec = 0;
+				tv.tv_usec = 20000;
+
+				if (select (CDev->replayFd + 1, &rfds, NULL, NULL, &tv) > 0)
+					n = read(CDev->replayFd, CDev->buf, BUFFERSIZE);
+				if (n > 0)
+				{
+					unsigned long long start = capReplayUs();
+					write_packet(CDev->buf, n, 0, CDev);
+					consumedCapReplay(CDev->replay, n, capReplayUs() - start);
+				}
+				numbytes=CDev->datalen;
+				CDev->datalen=0;
+			}
+			else if(CDev->mpeg)
 			{
 				int fd = raw1394_get_fd (CDev->handle);
 				struct timeval tv;
@@ -480,7 +526,7 @@ JNIEXPORT jboolean JNICALL Java_sage_FirewireCaptureDevice_setChannel0
 	int channel = atoi(chann);
 	(*env)->ReleaseStringUTFChars(env, jchan, chann);
 
-    if(channel==0) return JNI_TRUE;
+    if(channel==0 || !CDev->handle) return JNI_TRUE;
 
 	{
 		quadlet_t request[3];
@@ -20,6 +20,7 @@
 
 #include "DTVChannel.h"
 #include "SageTuner.h"
+#include "msgqueue.h"
 
 #include <stdio.h>
 #include <string.h>
@@ -124,6 +125,7 @@ int LoadDebugCfg( DTVChannelDebugInfo* dbg )
 	
 	dbg->raw_dump_path[0] = 0;
 	dbg->debug_source[0] = 0;
+	dbg->debug_source_speed = CAP_REPLAY_REALTIME;
 	FILE* fd = fopen("debugserver.ini", "r" );
 	if ( fd == NULL )
 	{
@@ -151,6 +153,11 @@ int LoadDebugCfg( DTVChannelDebugInfo* dbg )
 					flog( "Native.log",  "DTVChannel: debug source from '%s' mode:%d\r\n", ext, val );
 					strncpy( dbg->debug_source, ext, sizeof(dbg->debug_source) );
 					dbg->debug_source_mode = (int)val;
+				} else
+				if ( !strcmp( name, "debugsource_speed" ) && val >= 0 )
+				{
+					flog( "Native.log",  "DTVChannel: debug source speed %d%%\r\n", val );
+					dbg->debug_source_speed = val;
 				}
 			if ( !strcmp( name, "audio_ctrl" ) && val != 0 )
 			{
@@ -159,6 +166,18 @@ int LoadDebugCfg( DTVChannelDebugInfo* dbg )
 					   (dbg->audio_ctrl&0x01) ? "multiple audio disabled" : "" );
 				
 			}
+			if ( !strcmp( name, "record_writer" ) && val > 0 )
+			{
+				dbg->record_writer = val;
+				flog( "Native.log",  "DTVChannel: record writer mode:%d\r\n", val );
+			}
+			if ( !strcmp( name, "record_sync" ) && val > 0 )
+				dbg->record_sync = (unsigned long)val*1024*1024;  //Mbytes
+			if ( !strcmp( name, "timeshift_share" ) && val > 0 )
+			{
+				dbg->timeshift_share = val;
+				flog( "Native.log",  "DTVChannel: time-shift share mode:%d\r\n", val );
+			}
 		}
 	}
 	
@@ -169,58 +188,10 @@ int LoadDebugCfg( DTVChannelDebugInfo* dbg )
 #pragma mark -
 #pragma mark Static functions
 
+// goes through the native message queue, its dispatcher thread delivers to MsgManager in batches
 static void DTVChannel_PostMessage(char* pSrc, char* pData, int MsgType, int Priority)
 {
-	static JavaVM* vmBuf = 0;
-	static jsize numVMs;
-	static jclass msgMgrClass = 0;
-	static jmethodID postMsgMeth = 0;
-	static jclass msgClass = 0;
-	static jmethodID msgConstructor = 0;
-	static unsigned long msg_id = 0;
-	static pthread_mutex_t init_lock = PTHREAD_MUTEX_INITIALIZER;
-	JNIEnv* env;
-	
-	if(!vmBuf) {
-		jint res = 0;
-		
-		pthread_mutex_lock(&init_lock);
-		if (!vmBuf)
-			res = JNI_GetCreatedJavaVMs(&vmBuf, 1, &numVMs);
-		pthread_mutex_unlock(&init_lock);
-		
-		if(res)
-			return;
-	}
-	
-	jint threadState = vmBuf->GetEnv((void**)&env, JNI_VERSION_1_4);
-	if(threadState == JNI_EDETACHED)
-		vmBuf->AttachCurrentThread((void**)&env, NULL);
-	
-	if(!msgMgrClass || !msgClass || !msgConstructor || !postMsgMeth) {
-		pthread_mutex_lock(&init_lock);
-		
-		if (!msgMgrClass)
-			msgMgrClass = (jclass) env->NewGlobalRef(env->FindClass("sage/msg/MsgManager"));
-		if (msgMgrClass && !postMsgMeth)
-			postMsgMeth = env->GetStaticMethodID(msgMgrClass, "postMessage", "(Lsage/msg/SageMsg;)V");
-		if (!msgClass)
-			msgClass = (jclass)(env->NewGlobalRef(env->FindClass("sage/msg/SageMsg")));
-		if (msgClass && !msgConstructor)
-			msgConstructor = env->GetMethodID(msgClass, "<init>", "(ILjava/lang/Object;Ljava/lang/Object;I)V");
-		
-		pthread_mutex_unlock(&init_lock);
-	}
-	
-	int dataLen = strlen(pData)+1;
-	jbyteArray javaData = env->NewByteArray(dataLen);
-	env->SetByteArrayRegion(javaData, 0, dataLen, (const jbyte*)pData);
-	jobject msgObj = env->NewObject(msgClass, msgConstructor, MsgType, env->NewStringUTF(pSrc), javaData, Priority);
-	env->CallStaticVoidMethod(msgMgrClass, postMsgMeth, msgObj);
-	msg_id++;
-	
-	if(threadState == JNI_EDETACHED)
-		vmBuf->DetachCurrentThread();
+	postQueuedMessage(pSrc, pData, strlen(pData)+1, MsgType, Priority);
 }
 
 // Embedded EPG data
@@ -299,20 +270,30 @@ static int DTVChannel_OutputDump(void *context, void* pDataBlk, int lBytes )
 	return 0;
 }
 
+// Program output data from the splitter, MUX_OUTPUT_DATA carries the program it belongs to
+static int DTVChannel_ProgramOutputDump(void *context, void* pDataBlk, int lBytes )
+{
+	DTVChannel *chan = (DTVChannel*)context;
+	MUX_OUTPUT_DATA *pDataBuffer = (MUX_OUTPUT_DATA*)pDataBlk;
+
+	if(chan) return chan->ProgramOutputDump( pDataBuffer->program, pDataBuffer->data_ptr, pDataBuffer->bytes );
+	return 0;
+}
+
 // UNUSED (CAM): typedef long (*DATA_DUMP)( void* context, short bytes, void* mesg );
 // UNUSED: typedef int  (*ALLOC_BUFFER)( void* conext, unsigned char** ppData, int cmd ); // cmd 0:alloc, 1:release, return size
 
 #pragma mark -
 #pragma mark DTVChannel
 
-DTVChannel::DTVChannel(SageTuner *tuner, const char *tunerName, FILE *encodeFile, size_t fileSize) :
+DTVChannel::DTVChannel(SageTuner *tuner, const char *tunerName, const char *fileName, size_t fileSize) :
 	mTuner(tuner),
 	mTunerName(NULL),
-	mOutputFile(encodeFile),
-	mNextOutputFile(NULL),
-	mOutputFileSize((off_t)fileSize),
-	mOutputFileOffset(0),
+	mOutputFile(NULL),
 	mOutputBufferSize(0),
+	mSplitter(NULL),
+	mProgramOutputNum(0),
+	splitAlignBytes(0),
 	dbg(NULL),
 	havePIDTbl(false),
 	mProgramID(0),
@@ -328,6 +309,12 @@ DTVChannel::DTVChannel(SageTuner *tuner, const char *tunerName, FILE *encodeFile
 	dbg = new DTVChannelDebugInfo();
 	memset( dbg, 0, sizeof(DTVChannelDebugInfo) );
 	LoadDebugCfg(dbg);
+	if(dbg->debug_source[0] && (dbg->debug_source_mode == CAP_REPLAY_STANDIN || dbg->debug_source_mode == CAP_REPLAY_NO_DEVICE)) {
+		// the tuner's capture plays it into its own data path
+		dbg->replay = openCapReplay(dbg->debug_source, dbg->debug_source_speed);
+		flog("Native.log", "DTVChannel: stand-in device %s at %d%% (mode:%d) %s.\r\n", dbg->debug_source,
+			  dbg->debug_source_speed, dbg->debug_source_mode, dbg->replay ? "is open" : "failed");
+	}
 	
 	// clear PID filter data
 	openChannel(&mChannel, this);
@@ -351,6 +338,8 @@ DTVChannel::DTVChannel(SageTuner *tuner, const char *tunerName, FILE *encodeFile
 	memset( &mutex1_scan_session, 0, sizeof(mutex1_scan_session) );// = PTHREAD_MUTEX_INITIALIZER;
 	memset( &mutex1_scan_data, 0, sizeof(mutex1_scan_data) ); // = PTHREAD_MUTEX_INITIALIZER;
 	memset( &mutex1_push_data, 0, sizeof(mutex1_push_data) ); // = PTHREAD_MUTEX_INITIALIZER;
+	memset( &mutex1_program_output, 0, sizeof(mutex1_program_output) ); // = PTHREAD_MUTEX_INITIALIZER;
+	memset( mProgramOutput, 0, sizeof(mProgramOutput) );
 
 	parserEnabled = 0;
 	scanChannelEnabled = 0;
@@ -361,13 +350,17 @@ DTVChannel::DTVChannel(SageTuner *tuner, const char *tunerName, FILE *encodeFile
 		DisableMultipleAudio( remuxer );
 		flog( "Native.log", "DTVChannel: multiple audio is disabled\r\n" );
 	}
+	if(fileName)
+		setOutputFile(fileName, fileSize);
 
-	flog("Native.log", "DTVChannel 2.0.1 is created 0x%lx, remuxer:0x%lx tuner:'%s' outFile:0x%x \r\n",
-			  (unsigned long)this, (unsigned long)remuxer,  mTunerName, encodeFile  );
+	flog("Native.log", "DTVChannel 2.0.1 is created 0x%lx, remuxer:0x%lx tuner:'%s' outFile:%s \r\n",
+			  (unsigned long)this, (unsigned long)remuxer,  mTunerName, fileName ? fileName : "none" );
 }
 
 DTVChannel::~DTVChannel()
 {
+	MsgQueueStats msgStats;
+
 	closeChannel(&mChannel);
 	
 	if ( scanFilter != NULL )
@@ -378,11 +371,22 @@ DTVChannel::~DTVChannel()
 	if(remuxer)
 		CloseRemuxStream( remuxer );
 
+	// the splitter remuxes what is left into program outputs before they are closed
+	if(mSplitter)
+		CloseMuxSplitter( mSplitter );
+	for(int i = 0; i < MAX_PROGRAM_OUTPUT; i++) {
+		if(mProgramOutput[i].file)
+			CloseTimeShiftFile(mProgramOutput[i].file);
+	}
+
 	free(mTunerName);
 	
-	flog( "Native.log", "DTVChannel: close outFile file:0x%x\r\n", mOutputFile );
+	statsMsgQueue(&msgStats);
+	flog( "Native.log", "DTVChannel: message queue posted:%llu delivered:%llu dropped:%llu batches:%llu max depth:%u\r\n",
+		msgStats.posted, msgStats.delivered, msgStats.dropped, msgStats.batches, msgStats.maxDepth );
+	flog( "Native.log", "DTVChannel: close outFile file:%s\r\n", mOutputFile ? TimeShiftFileName(mOutputFile) : "none" );
 	if(mOutputFile)
-		fclose(mOutputFile);
+		CloseTimeShiftFile(mOutputFile);
 	//if(mOutputBuffer) free(mOutputBuffer);
 	
 	flog( "Native.log", "DTVChannel: free gdb.\r\n" );
@@ -402,34 +406,67 @@ DTVChannel::~DTVChannel()
 			dbg->debug_source_buffer = NULL;
 		}
 		
+		if(dbg->replay) {
+			closeCapReplay(dbg->replay);
+			dbg->replay = NULL;
+		}
+		
 		delete dbg;
 		dbg = NULL;
 	}
 	flog( "Native.log", "DTVChannel: destroyed.\r\n" );
 }
 
-void DTVChannel::setOutputFile(FILE *encodeFile, size_t fileSize)
+// DTVChannel owns the output file, NULL closes it
+void DTVChannel::setOutputFile(const char *fileName, size_t fileSize)
+{
+	void *outputFile = NULL;
+	void *oldFile = mOutputFile;
+	flog("Native.log", "DTVChannel setOutputFile outputFile:%s size:%d\r\n", fileName ? fileName : "none", fileSize );
+	if(fileName != NULL) {
+		outputFile = OpenTimeShiftFile(fileName, (ULONGLONG)fileSize, outputFileFlag());
+		if(outputFile) {
+			SetupTimeShiftSync(outputFile, dbg ? dbg->record_sync : 0);
+			flog("Native.log", "DTVChannel: output file writer %s\r\n", TimeShiftWriterName(outputFile));
+		} else
+			flog("Native.log", "DTVChannel: failed opening output file %s\r\n", fileName);
+	}
+	mOutputFile = outputFile;
+	if(oldFile)
+		CloseTimeShiftFile(oldFile);
+}
+
+// optional RecordWriter on the output file, "record_writer" in debugserver.ini:
+// 1 auto engine, 2 pwritev, 3 io_uring, add 16 for O_DIRECT. "record_sync" fdatasync every N MB.
+// A keyframe index sidecar "<recording>.idx" is kept for PS output, a circular file isn't indexed.
+// "timeshift_share" publishes the write position under /dev/shm (1), and the latest data for a
+// live TV reader (2, TimeShiftReader.h), it's woken at each write.
+int DTVChannel::outputFileFlag()
 {
-	// the current file will be closed by whomever opened it...
-	flog("Native.log", "DTVChannel setOutputFile outputFile:0x%x size:%d\r\n", encodeFile, fileSize );
-	mOutputFile = encodeFile;
-	mOutputFileSize = (off_t)fileSize;
-	mOutputFileOffset = 0;
+	int flag = dbg ? (dbg->record_writer & TIMESHIFT_WRITER) : 0;
+	if(getOutputFormat(&mChannel) == 1)
+		flag |= TIMESHIFT_INDEX;
+	if(dbg && dbg->timeshift_share)
+		flag |= dbg->timeshift_share > 1 ? TIMESHIFT_SHARED_DATA : TIMESHIFT_PUBLISH;
+	return flag;
 }
 
 #ifdef FILETRANSITION
-void DTVChannel::setNextOutputFile(FILE *encodeFile)
+// the file is opened now, output switches to it at a transition point of the data
+void DTVChannel::setNextOutputFile(const char *fileName)
 {
-	// the current file will be closed by whomever opened it...
+	int format = getOutputFormat(&mChannel) == 1 ? TIMESHIFT_PS : TIMESHIFT_TS;
 	pthread_mutex_lock( &mutex1_push_data );
 	mBytesIn = mBytesOut = mBytesProcessed = 0;
 	pthread_mutex_unlock( &mutex1_push_data );
-	mNextOutputFile = encodeFile;
+	if(mOutputFile == NULL || fileName == NULL ||
+		!SwitchTimeShiftFile(mOutputFile, fileName, format, 0, TIMESHIFT_TRANSITION_LIMIT))
+		flog("Native.log", "DTVChannel: failed switching output file to %s\r\n", fileName ? fileName : "none");
 }
 
 int DTVChannel::hasNextOutputFile()
 {
-    return mNextOutputFile != NULL;
+    return TimeShiftSwitchPending(mOutputFile);
 }
 #endif
 
@@ -452,9 +489,11 @@ int DTVChannel::setTuning(SageTuningParams *params)
 			flog( "Native.log", "DTVChannel: Raw dump file set to %s\r\n", name );
 		}
 		
-		if(dbg->debug_source[0]) {
+		if(dbg->debug_source[0] && dbg->debug_source_mode == CAP_REPLAY_SUBSTITUTE) {
 			if(dbg->source_fd > 0)
 				fclose(dbg->source_fd);
+			if(!dbg->debug_source_buffer)
+				dbg->debug_source_buffer = malloc(BUFFERSIZE);
 			dbg->source_fd = fopen(dbg->debug_source, "r");
 			if(dbg->source_fd > 0)
 				flog("Native.log", "DTVChannel: Debug source file open: %s mode:%d (%d).\r\n",
@@ -610,14 +649,14 @@ char *DTVChannel::getBroadcastStandard()
 
 void DTVChannel::flush()
 {
+	if(mOutputFile)
+		FlushTimeShiftFile(mOutputFile);
 }
 
 
 void DTVChannel::idle()
 {
-	int numbytes = 0;
-	
-	if(mPIDFilterDelay && havePIDTbl) {
+	if(mPIDFilterDelay && havePIDTbl && !mProgramOutputNum) {
 		struct timeval now;
 		gettimeofday(&now, NULL);
 		
@@ -627,28 +666,6 @@ void DTVChannel::idle()
 			setupPIDFilter( pidTbl, pidTotalNum );
 		}
 	}
-	
-	if(!dbg) return;
-	if(dbg->source_fd == NULL) return;
-	
-	if(dbg->debug_source_mode != 2) {
-		unsigned long ep, ep_expect;
-		
-		numbytes = fread(dbg->debug_source_buffer, 1, BUFFERSIZE, dbg->source_fd);
-		if(numbytes == 0) {
-			fseek(dbg->source_fd, 0, SEEK_SET);
-			numbytes = fread(dbg->debug_source_buffer, 1, BUFFERSIZE, dbg->source_fd);
-		}
-		
-			// keep stream at constant rate
-		ep = msElapsed(mCaptureStartTime);
-		ep_expect = (mBytesIn + numbytes) / 2358;  // ATSC: rate 2358 bytes/sec
-		if(ep_expect > ep)
-			usleep((ep_expect - ep) * 1000);
-	}
-	
-//	if(numbytes)
-//		splitStream(dbg->debug_source_buffer, (size_t)numbytes);
 }
 
 void DTVChannel::pushData(void *buffer, size_t size)
@@ -662,7 +679,9 @@ void DTVChannel::pushData(void *buffer, size_t size)
 				dbg->dumped_bytes += size;
 			}
 			
-			if((dbg->source_fd != NULL) && (dbg->debug_source_mode == 2)) {
+			if((dbg->source_fd != NULL) && (dbg->debug_source_mode == CAP_REPLAY_SUBSTITUTE)) {
+				if(size > BUFFERSIZE)
+					size = BUFFERSIZE;
 				int numbytes = fread(dbg->debug_source_buffer, 1, (int)size, dbg->source_fd);
 				if(numbytes == 0) {
 					fseek(dbg->source_fd, 0, SEEK_SET);
@@ -730,12 +749,18 @@ void DTVChannel::splitStream(void *buffer, size_t size)
 			//drop data, because of asking too many
 			expectedBytes = 0;
 		}
+		// batched blocks have to be on disk before they are counted out
+		if ( mOutputFile )
+			FlushTimeShiftFile( mOutputFile );
 		pthread_mutex_lock( &mutex1_push_data );
 		mBytesOut += mBytesDump;
 		mBytesProcessed += usedBytes;
 		pthread_mutex_unlock( &mutex1_push_data );
 	}
 
+	if ( parserEnabled && !scanChannelEnabled && mProgramOutputNum )
+		splitPrograms( pData, lDataLen );
+
 
 	
 }
@@ -752,223 +777,178 @@ long DTVChannel::AVInfoDump(short bytes, void *msg)
 	return 1;
 }
 
-#ifdef FILETRANSITION
-// NOTE: This could get bad start codes.
-static int verifyPSBlock(unsigned char *data, int videotype)
-{
-    unsigned char b;
-    unsigned int pos=0;
-    int cur=0xFFFFFFFF;
-    while(pos<2048)
-    {
-        b=data[pos];
-        pos+=1;
-        cur<<=8;
-        cur|=b;
-        if(videotype==2)
-        {
-            if((cur&0xFFFFFF00)==0x00000100)
-            {
-                /* video */
-                if((b==0xB3))
-                {
-                    return 1;
-                }
-            }
-        }
-        else if(videotype==3)
-        {
-            if((cur&0xFFFFFFFF)==0x00000001)
-            {
-                if((pos+3)<2048)
-                {
-                    if( data[pos]==0x09 &&
-                        data[pos+1]==0x10 &&
-                        data[pos+2]==0x00)
-                    {
-                        return 1;
-                    }
-                }
-            }
-        }
-        else
-        {
-            return 1;
-        }
-    }
-    return 0;
-}
-
-// TODO: implement TS support for other source than HDPVR
-// Videotype 1: mpeg1 2:mpeg2 3:h264
-static int findTransitionPoint(unsigned char* data, int length, int flags, int videotype)
-{
-    int numbytes=length;
-
-    // MPEG2-TS format
-    if(flags==1)
-    {
-        int i, tsstart=-1, tsvidpacket=-1;//, seqstart=-1;
-        // For the HDPVR our input is a tranport stream, we must find a valid start point
-        // in the video pid 0x1011 of 00 00 01 09 10 00
-
-        // First we try to locate ts packets
-        for(i=0;i<numbytes;i++)
-        {
-            if(data[i]==0x47 && 
-                (i+188)<numbytes && data[i+188]==0x47 &&
-                (i+188*2)<numbytes && data[i+188*2]==0x47)
-            {
-                tsstart=i;
-                break;
-            }
-        }
-
-        // Second we find a ts packet with section start and pid 0x1011
-        while((i+188)<=numbytes)
-        {
-            if(data[i]==0x47 &&
-                data[i+1]==0x50 &&
-                data[i+2]==0x11)
-            {
-                tsvidpacket=i;
-                // Verify if that packet contains the magic sequence 00 00 00 01 09 10 00
-                // If it does, the data up to the begining of this TS packet go in old file 
-                // and the new data in the new file
-                int j;
-                for(j=4;j<188-7;j++)
-                {
-                    // NOTE: we could implement faster search but the number of
-                    // matched packet that reach this point should be quite small...
-                    if(data[i+j]==0x00 &&
-                        data[i+j+1]==0x00 &&
-                        data[i+j+2]==0x00 &&
-                        data[i+j+3]==0x01 &&
-                        data[i+j+4]==0x09 &&
-                        data[i+j+5]==0x10 &&
-                        data[i+j+6]==0x00)
-                    {
-                        // We have found the vid packet with the magic sequence, write that to old file
-                        return tsvidpacket;
-                    }
-                }
-            }
-            i+=188;
-        }
-    }
-    else // MPEG2-PS
-    {
-        // For the IVTV cards we must find a sequence start inside the video stream
-        // we are looking for 00 00 01 B3
-        int i=0, psstart=-1;
-        // IVTV use 2K blocks
-        // First locate the 00 00 01 BA block
-        while(i<=numbytes-2048)
-        {
-            if(data[i]==0x00 && 
-                data[i+1]==0x00 &&
-                data[i+2]==0x01 &&
-                data[i+3]==0xBA)
-            {
-                psstart=i;
-                if(verifyPSBlock(&data[i], videotype))
-                {
-                    // We have found the sequence start
-                    return psstart;
-                }
-                i+=2048;
-            }
-            else
-            {
-                i++;
-            }
-        }
-    }
-    return -1;
-}
-#endif
-
 int DTVChannel::OutputDump(unsigned char *buffer, unsigned long size)
 {
-	int outBytes = 0;
+	int outBytes;
 	//flog("Native.log", "DTVChannel(%p)::OutputDump(%p, %ld) - out file %p\r\n", this, buffer, size, mOutputFile);
 	
 	if( mOutputFile == NULL || !buffer) return 0;
 	
-#ifdef FILETRANSITION
-	int numbytes = (int)size;
-    // We want to switch to the new fd as soon as we get a good starting point
-    if( mNextOutputFile )
-    {
-        // We need to parse the current data buffer hoping to find a starting point
-        int transitionpos = findTransitionPoint(buffer, numbytes,
-            detectmode==2 ? 1 : 0, detecttype);
-       	//int transitionpos = 0;
-        int bufSkip=transitionpos;
-        bytesTested = 0;
-        if(transitionpos!=-1)
-        {
-            bufSkip=transitionpos;
-            if (!mOutputFileSize)
-            {
-               outBytes=fwrite(buffer, 1, bufSkip, mOutputFile);
-            }
-            flog( "Native.log", "transition found after %d bytes switching from fd 0x%x to 0x%x.\r\n",
-						bytesTested, mOutputFile, mNextOutputFile );
-            if(mOutputFile!=NULL)
-                fclose(mOutputFile);
-            mOutputFile=mNextOutputFile;
-            mNextOutputFile = NULL;
-        }
-        else
-        {
-            bytesTested+=numbytes;
-            // We might want to have different numbers or base it on bitrates
-            if(bytesTested>8*1024*1024)
-            {
-                flog( "Native.log", "transition limit reached, switching fd.\r\n");
-                if(mOutputFile!=NULL)
-                    fclose(mOutputFile);
-                mOutputFile=mNextOutputFile;
-                mNextOutputFile = NULL;
-            }
-			bufSkip = 0;
-        }
-        buffer+=bufSkip;
-        size-=bufSkip;
-    }
-#endif
+	// a pending next file is taken at a transition point, RecordWriter batches blocks till splitStream flushes it
+	outBytes = WriteTimeShiftData(mOutputFile, buffer, (int)size);
+	if ( outBytes > 0 )
+		mBytesDump += outBytes;
+	return 1;
+}
 
-	if(mOutputFileSize)
+#pragma mark -
+#pragma mark Program outputs
+
+DTVProgramOutput *DTVChannel::findProgramOutput(unsigned short program)
+{
+	for(int i = 0; i < MAX_PROGRAM_OUTPUT; i++)
+		if(mProgramOutput[i].program == program)
+			return &mProgramOutput[i];
+	return NULL;
+}
+
+// record a program of the mux into fileName, DTVChannel closes the file when the output stops.
+// All program outputs are split out of the mux by one TS parse (MuxSplitter), each program has its own
+// remuxer that only sees its own packets. The HW PID filter passes the whole mux while any of them runs.
+// return: 1 on success, 0 when the program is recorded already or no output is left
+int DTVChannel::startProgramOutput(unsigned short program, const char *fileName)
+{
+	DTVProgramOutput *out;
+	void *file;
+	int first;
+
+	if(program == 0 || fileName == NULL)
+		return 0;
+	pthread_mutex_lock( &mutex1_program_output );
+	if(findProgramOutput(program) != NULL || (out = findProgramOutput(0)) == NULL) {
+		pthread_mutex_unlock( &mutex1_program_output );
+		flog("Native.log", "DTVChannel: program output %d can't be started (outputs:%d)\r\n", program, mProgramOutputNum);
+		return 0;
+	}
+	if(mSplitter == NULL) {
+		mSplitter = OpenMuxSplitter( MAX_SPLIT_CHANNEL, 0, MPEG_TS, MPEG_PS, (DUMP)DTVChannel_ProgramOutputDump, this );
+		splitAlignBytes = 0;
+	}
+	if(mSplitter == NULL || !SelectMuxSplitterProgram( mSplitter, program )) {
+		pthread_mutex_unlock( &mutex1_program_output );
+		flog("Native.log", "DTVChannel: failed selecting program %d in splitter\r\n", program);
+		return 0;
+	}
+	if((file = OpenTimeShiftFile(fileName, 0, 0)) == NULL) {
+		pthread_mutex_unlock( &mutex1_program_output );
+		flog("Native.log", "DTVChannel: failed opening %s for program %d\r\n", fileName, program);
+		return 0;
+	}
+	memset(out, 0, sizeof(DTVProgramOutput));
+	out->program = program;
+	out->file = file;
+	first = (++mProgramOutputNum == 1);
+	pthread_mutex_unlock( &mutex1_program_output );
+
+	// keep the PID table, it's set again when the last program output stops
+	if(first && hasPIDFilter())
+		mTuner->setPIDFilter(0, 0, NULL);
+	flog("Native.log", "DTVChannel: program output %d started outFile:%s (outputs:%d)\r\n", program, fileName, mProgramOutputNum);
+	return 1;
+}
+
+// data of the program pushed so far is written out before its file is closed
+int DTVChannel::stopProgramOutput(unsigned short program)
+{
+	DTVProgramOutput *out;
+	int last;
+
+	pthread_mutex_lock( &mutex1_program_output );
+	if(program == 0 || (out = findProgramOutput(program)) == NULL) {
+		pthread_mutex_unlock( &mutex1_program_output );
+		return 0;
+	}
+	DeselectMuxSplitterProgram( mSplitter, program );
+	flog("Native.log", "DTVChannel: program output %d stopped, %lld bytes out\r\n", program, (long long)out->bytesOut);
+	if(out->file)
+		CloseTimeShiftFile(out->file);
+	memset(out, 0, sizeof(DTVProgramOutput));
+	last = (--mProgramOutputNum == 0);
+	pthread_mutex_unlock( &mutex1_program_output );
+
+	if(last && hasPIDFilter() && pidTotalNum)
+		setupPIDFilter( pidTbl, pidTotalNum );
+	return 1;
+}
+
+// same transition rule as the main output, switch on a sequence header or give up after 8MB
+void DTVChannel::setNextProgramOutputFile(unsigned short program, const char *fileName)
+{
+	DTVProgramOutput *out;
+	pthread_mutex_lock( &mutex1_program_output );
+	if(program && fileName && (out = findProgramOutput(program)) != NULL &&
+		SwitchTimeShiftFile(out->file, fileName, TIMESHIFT_PS, 2, TIMESHIFT_TRANSITION_LIMIT))
+		out->bytesOut = 0;
+	pthread_mutex_unlock( &mutex1_program_output );
+}
+
+int DTVChannel::hasNextProgramOutputFile(unsigned short program)
+{
+	DTVProgramOutput *out;
+	int next = 0;
+	pthread_mutex_lock( &mutex1_program_output );
+	if(program && (out = findProgramOutput(program)) != NULL)
+		next = TimeShiftSwitchPending(out->file);
+	pthread_mutex_unlock( &mutex1_program_output );
+	return next;
+}
+
+off_t DTVChannel::getProgramOutputByteCount(unsigned short program)
+{
+	DTVProgramOutput *out;
+	off_t bytes = 0;
+	pthread_mutex_lock( &mutex1_program_output );
+	if(program && (out = findProgramOutput(program)) != NULL)
+		bytes = out->bytesOut;
+	pthread_mutex_unlock( &mutex1_program_output );
+	return bytes;
+}
+
+// the splitter takes whole packets, a packet cut at the end of a buffer is carried into the next one
+void DTVChannel::splitPrograms(unsigned char *pData, int length)
+{
+	int usedBytes;
+
+	pthread_mutex_lock( &mutex1_program_output );
+	if ( mSplitter == NULL || mProgramOutputNum == 0 )
 	{
-		if(mOutputFileOffset == mOutputFileSize) {
-			fseek(mOutputFile, 0, SEEK_SET);
-			mOutputFileOffset = 0;
-		}
-		
-		if(mOutputFileOffset + (off_t)size <= mOutputFileSize) {
-			outBytes=fwrite(buffer, 1, (size_t)size, mOutputFile);
-			if ( outBytes < 0 ) outBytes = 0;
-			mOutputFileOffset += outBytes;
-		} else {
-			size_t head = (size_t)(mOutputFileSize - mOutputFileOffset);
-			size_t tail = size - head;
-			int outBytes2;
-			outBytes=fwrite(buffer, 1, head, mOutputFile);
-			if ( outBytes < 0 ) outBytes = 0;
-			fseek(mOutputFile, 0, SEEK_SET);
-			outBytes2 = fwrite(buffer+head, 1, tail, mOutputFile);
-			if ( outBytes2 < 0 ) outBytes2 = 0;
-			outBytes += outBytes2;
+		pthread_mutex_unlock( &mutex1_program_output );
+		return;
+	}
+	if ( splitAlignBytes )
+	{
+		int fill = TS_PACKET_LENGTH - splitAlignBytes;
+		if ( fill > length ) fill = length;
+		memcpy( splitAlignBuffer+splitAlignBytes, pData, fill );
+		splitAlignBytes += fill;
+		pData += fill;
+		length -= fill;
+		if ( splitAlignBytes == TS_PACKET_LENGTH )
+		{
+			PushMuxSplitterData( mSplitter, splitAlignBuffer, TS_PACKET_LENGTH );
+			splitAlignBytes = 0;
 		}
-	} else {
-		outBytes=fwrite(buffer, 1, (size_t)size, mOutputFile);
-		if ( outBytes < 0 ) outBytes = 0;
 	}
-	fflush(mOutputFile);
-	mBytesDump += outBytes;
-	
-	
+	if ( length > 0 )
+	{
+		usedBytes = PushMuxSplitterData( mSplitter, pData, length );
+		splitAlignBytes = length - usedBytes;
+		memcpy( splitAlignBuffer, pData+usedBytes, splitAlignBytes );
+	}
+	pthread_mutex_unlock( &mutex1_program_output );
+}
+
+// called with mutex1_program_output held, from splitPrograms or stopProgramOutput
+int DTVChannel::ProgramOutputDump(unsigned short program, unsigned char *buffer, unsigned long size)
+{
+	DTVProgramOutput *out = program ? findProgramOutput(program) : NULL;
+	int outBytes;
+
+	if( out == NULL || out->file == NULL || !buffer ) return 0;
+
+	outBytes = WriteTimeShiftData(out->file, buffer, (int)size);
+	if ( outBytes > 0 )
+		out->bytesOut += outBytes;
 	return 1;
 }
 
@@ -989,7 +969,9 @@ long DTVChannel::pidFilterDump( PID_ENTRY* pids, int pidNum )
 		pidTbl[i] = pids[i];
 	pidTotalNum = pidNum;
 
-	if(mPIDFilterDelay) {
+	if(mProgramOutputNum) {
+		// program outputs need the whole mux, the filter is set when the last one stops
+	} else if(mPIDFilterDelay) {
 		// delayed startup
 		gettimeofday(&mPIDFilterDelayStart, NULL);
 	} else {
@@ -27,7 +27,10 @@
 #include "TSFilter.h"
 #include "TSParser.h"
 #include "ScanFilter.h"
+#include "TimeShiftFile.h"
+#include "MuxSplitter.h"
 #include "Channel.h"
+#include "capreplay.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -46,23 +49,37 @@ struct DTVChannelDebugInfo {
 	char  debug_source[256];
 	void *debug_source_buffer; // BUFFERSIZE bytes (defined in Channel.h)
 	int   debug_source_mode;
+	int   debug_source_speed; // percent of real time the stand-in device plays at
+	CapReplay *replay;        // stand-in device of debugsource mode 1 and 3
 	FILE* dump_fd;
 	FILE* source_fd;
 	unsigned long audio_ctrl;
+	int   record_writer;     // RecordWriter flag+1, 0 writes by pwrite
+	unsigned long record_sync;
+	int   timeshift_share;   // 1 publishes the write position in shared memory, 2 the latest data too
 };
 
 #define MAX_PID_NUM 8
+#define MAX_PROGRAM_OUTPUT 8
+
+// another program of the tuned mux recorded into its own file
+struct DTVProgramOutput {
+	unsigned short program; // 0: free slot
+	void *file;  // TimeShiftFile
+	off_t bytesOut;
+};
 
 // there should only be ONE of these PER DEVICE!
 class DTVChannel {
 	public:
-		DTVChannel(SageTuner *tuner, const char *tunerName, FILE *encodeFile, size_t fileSize);
+		DTVChannel(SageTuner *tuner, const char *tunerName, const char *fileName, size_t fileSize);
 		~DTVChannel();
 		
 			// configuration methods
-		void setOutputFile(FILE *encodeFile, size_t fileSize);
+			// the file is opened (truncated) here, a keyframe index is written next to a PS recording
+		void setOutputFile(const char *fileName, size_t fileSize);
 #ifdef FILETRANSITION
-		void setNextOutputFile(FILE *encodeFile);
+		void setNextOutputFile(const char *fileName);
 		int hasNextOutputFile();
 #endif
 		int setTuning(SageTuningParams *params);
@@ -76,13 +93,25 @@ class DTVChannel {
 		void idle();
 		void pushData(void *buffer, size_t size);
 		void splitStream(void *buffer, size_t size);
+			// stand-in device the tuner's data comes from (debugsource mode 1 and 3), NULL for the tuner's own
+		CapReplay *standInDevice() {return dbg ? dbg->replay : NULL;}
+			// mode 3, there is no tuner hardware to talk to
+		bool standInOnly() {return standInDevice() != NULL && dbg->debug_source_mode == CAP_REPLAY_NO_DEVICE;}
 		off_t getOutputByteCount() {return mBytesOut;}
 		off_t getProcessedByteCount() {return mBytesProcessed;}
+
+			// program outputs, one TS parse feeds all of them besides the main output
+		int  startProgramOutput(unsigned short program, const char *fileName);
+		int  stopProgramOutput(unsigned short program);
+		void setNextProgramOutputFile(unsigned short program, const char *fileName);
+		int  hasNextProgramOutputFile(unsigned short program);
+		off_t getProgramOutputByteCount(unsigned short program);
 		
 			// Dump methods
 		long EPGDump(short bytes, void *msg);
 		long AVInfoDump(short bytes, void *msg);
 		int  OutputDump(unsigned char *buffer, unsigned long size);
+		int  ProgramOutputDump(unsigned short program, unsigned char *buffer, unsigned long size);
 		long PMTDump(unsigned short programID, unsigned char *pmtData, int pmtDataSize);
 		long pidFilterDump( PID_ENTRY* pids, int pidNum );
 		
@@ -123,7 +152,7 @@ class DTVChannel {
 		char *mTunerName;
 		CHANNEL_DATA mChannel;
 		unsigned long mCaptureStartTime;
-		FILE *mOutputFile;
+		void *mOutputFile; // TimeShiftFile, switches to the next file by itself
 		int outputFormat;
 
 		int parserEnabled;
@@ -137,23 +166,22 @@ class DTVChannel {
 		SCAN_FILTER *scanFilter;
 		int  scanChannelEnabled;
 
-#ifdef FILETRANSITION
-		FILE *mNextOutputFile; // next file to write the captured data to
-		int bytesTested; // We want to give up after some fixed amount of bytes if no transition found
-		int detectmode; // 0: unknown 1: mpeg 2 PS  2: mpeg 2 TS  3: unsupported
-		int detecttype; // 0: unknown, 1: mpeg1  2:mpeg2  3:H264
-		int detectid; // stream ID of detect (should be 0xE0 for now)
-#endif
-
-
-		off_t mOutputFileSize; // if non-zero, we're recording to a circular file buffer
-		off_t mOutputFileOffset;
 		//void *mOutputBuffer;
 		size_t mOutputBufferSize;
+		int outputFileFlag();
+
+		void *mSplitter; // MuxSplitter, opened with the first program output
+		DTVProgramOutput mProgramOutput[MAX_PROGRAM_OUTPUT];
+		int  mProgramOutputNum;
+		unsigned char splitAlignBuffer[TS_PACKET_LENGTH];
+		int  splitAlignBytes;
+		DTVProgramOutput *findProgramOutput(unsigned short program);
+		void splitPrograms(unsigned char *pData, int length);
 		
 		pthread_mutex_t mutex1_scan_session;
 		pthread_mutex_t mutex1_scan_data;
 		pthread_mutex_t mutex1_push_data;
+		pthread_mutex_t mutex1_program_output;
 		
 		// debug support
 		DTVChannelDebugInfo *dbg;
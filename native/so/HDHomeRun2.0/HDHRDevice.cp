@@ -24,6 +24,12 @@
 #include <SystemConfiguration/SystemConfiguration.h>
 #include <netinet/in.h>
 #endif
+#include <sys/time.h>
+
+// the capture thread wakes when this much data is buffered (about 17ms of a 19.4Mbps ATSC stream)
+// or after HDHR_CAPTURE_WAIT_MS, whichever comes first
+#define HDHR_CAPTURE_WATERMARK		(32 * VIDEO_DATA_PACKET_SIZE)
+#define HDHR_CAPTURE_WAIT_MS		32
 
 static bool flog_enabled=false;
 void enable_hdhrdevice_native_log()
@@ -95,7 +101,6 @@ HDHRDevice::HDHRDevice(hdhomerun_discover_device_t disco, int tuner) :
 	, lastFilterProgram(65535)
 	, mChannel(NULL)
 	, mOutputPath(NULL)
-	, mOutputFile(NULL)
 	, mMaxFileSize(0)
 	, mLastMealSize(0ULL)
 	, mCaptureThreadRunning(false)
@@ -113,12 +118,16 @@ HDHRDevice::HDHRDevice(hdhomerun_discover_device_t disco, int tuner) :
 //	mChannel = new DTVChannel(dynamic_cast <SageTuner*> (this), channelName, NULL, 0);
 	flog( "Native.log", "HDHR device is created :%s\r\n", mDeviceName );
 	memset(&mTuningParams, 0, sizeof(SageTuningParams));
+	pthread_mutex_init(&mPushMutex, NULL);
+	pthread_cond_init(&mPushCond, NULL);
 }
 
 HDHRDevice::~HDHRDevice()
 {
 	stopCapture();
 	closeDevice();
+	pthread_cond_destroy(&mPushCond);
+	pthread_mutex_destroy(&mPushMutex);
 	flog( "Native.log", "HDHR device is released :%s\r\n", mDeviceName );
 }
 
@@ -283,6 +292,7 @@ int HDHRDevice::setTuning(SageTuningParams *params)
 		sprintf(channelSetting, "auto:%ld", mTuningParams.tuningFrequency );
 	}
 	flog( "Native.log",  "HDHRDevice::setTuning: channel %s\r\n", channelSetting);
+	if(standInTuner()) return 0;
 	
 	result = hdhomerun_device_set_tuner_channelmap(mDeviceConnection, mDeviceChannelMap);
 	if(result <= 0) {
@@ -319,6 +329,11 @@ int HDHRDevice::getTuningStatus(bool& locked, int& strength)
 	locked = false; // signal locked
 	strength = 0;
 	
+	if(standInTuner()) {
+		locked = true;
+		strength = 100;
+		return 1;
+	}
 	if(mDeviceConnection) {
 		struct hdhomerun_tuner_status_t status;
 		char *statusString;
@@ -363,6 +378,7 @@ int HDHRDevice::setPIDFilterByProgram(unsigned short program )
 	
 	if(program == lastFilterProgram) return 0;
 	lastFilterProgram = program;
+	if(standInTuner()) return 0;
 	
 	// DO NOT ENABLE IF WE'RE DATA SCANNING!
 	if( !mScanning && mEnableFilter && program != 0 )
@@ -384,6 +400,7 @@ int HDHRDevice::setPIDFilter(unsigned short program, int pidCount, unsigned shor
 	int result, i;
 	char filterString[1024] = "0x0000-0x1fff";	// default to send the raw DTV stream
 
+	if(standInTuner()) return 0;
 	// DO NOT ENABLE IF WE'RE DATA SCANNING!
 	if( !mScanning && mEnableFilter && (program != 0) && (pidCount != 0) )
 	{
@@ -423,7 +440,11 @@ bool HDHRDevice::openDevice()
 		return false;
 	}
 	
-	mDeviceModel = hdhomerun_device_get_model_str(mDeviceConnection);
+	// a stand-in device without hardware (debugsource mode 3) passes for an ATSC tuner
+	if(standInTuner())
+		mDeviceModel = "hdhomerun_atsc";
+	else
+		mDeviceModel = hdhomerun_device_get_model_str(mDeviceConnection);
 	flog( "Native.log", "HDHomeRun Device(Tuner:\"%s\" Model:%s) is open\r\n", mChannelName, mDeviceModel );
 	return true;
 }
@@ -457,16 +478,12 @@ void HDHRDevice::stopCapture()
 		pthread_join(mCaptureThread, &foo);
 	}
 	
+	// the channel closes its output file
 	if(mChannel) {
 		mChannel->flush();
 		mChannel->setOutputFile(NULL, 0);
 	}
 	
-	if(mOutputFile) {
-		fclose(mOutputFile);
-		mOutputFile = NULL;
-	}
-	
 	if(mOutputPath) {
 		delete mOutputPath;
 		mOutputPath = NULL;
@@ -495,13 +512,12 @@ bool HDHRDevice::setupEncoding(char *path, size_t ringSize)
 	if(path) {
 		mOutputPath = new char[strlen(path)+1];
 		strcpy(mOutputPath, path);
-		mOutputFile = fopen(mOutputPath, "wb");
 	} // else leave 'em NULL
 	mMaxFileSize = ringSize;
 	
 	mLastMealSize = 0;
 	mChannel->flush();
-	mChannel->setOutputFile(mOutputFile, mMaxFileSize);
+	mChannel->setOutputFile(mOutputPath, mMaxFileSize);
 	mKillCaptureThread = false;
 	pthread_create(&foo, NULL, HDHRDevice::captureThreadEntry, this);
 	
@@ -516,8 +532,7 @@ bool HDHRDevice::switchEncoding(char *path)
 	// Does that really matter?
 	mNextOutputPath = new char[strlen(path)+1];
 	strcpy(mNextOutputPath, path);
-	mNextOutputFile = fopen(mNextOutputPath, "wb");
-	mChannel->setNextOutputFile(mNextOutputFile);
+	mChannel->setNextOutputFile(mNextOutputPath);
 	// If we don't get data; the output file won't switch so we should just bail after 5 seconds
 	// That's much better than letting this thread run forever since it'll be the Seeker which kills SageTV altogther then
 	int maxWaits = 250;
@@ -525,17 +540,33 @@ bool HDHRDevice::switchEncoding(char *path)
 	{
 		encoderIdle();
 		eatEncoderData();
-		usleep(20); // Wait a bit so we don't consume all CPU in this loop
+		waitForPush(20); // the file switches in pushData, don't spin until the capture thread gets there
 	}
 	delete mOutputPath;
 	mOutputPath=mNextOutputPath;
 	mNextOutputPath = NULL;
-	mOutputFile = mNextOutputFile ;
-	mNextOutputFile = NULL;
 	return true;
 #endif
 }
 
+void HDHRDevice::waitForPush(int ms)
+{
+	struct timeval tv;
+	struct timespec abstime;
+	
+	gettimeofday(&tv, NULL);
+	abstime.tv_sec = tv.tv_sec + ms / 1000;
+	abstime.tv_nsec = (long)tv.tv_usec * 1000 + (long)(ms % 1000) * 1000000;
+	if(abstime.tv_nsec >= 1000000000) {
+		abstime.tv_sec++;
+		abstime.tv_nsec -= 1000000000;
+	}
+	
+	pthread_mutex_lock(&mPushMutex);
+	pthread_cond_timedwait(&mPushCond, &mPushMutex, &abstime);
+	pthread_mutex_unlock(&mPushMutex);
+}
+
 void HDHRDevice::closeEncoding()
 {
 	stopCapture();
@@ -648,6 +679,7 @@ void HDHRDevice::captureThread()
 {
 	unsigned char *buf = NULL;
 	int result;
+	CapReplay *replay;
 	
 	if(!mChannel) return;
 	if(!mDeviceConnection) return;
@@ -657,26 +689,57 @@ void HDHRDevice::captureThread()
 	
 //	flog( "Native.log",  "HDHomeRun: native capture thread starting\r\n");
 	
-	// start the device
-	result = hdhomerun_device_stream_start(mDeviceConnection);
-	if(result <= 0) {
-		flog( "Native.log",  "HDHomeRun: Error starting stream\r\n");
-		return;
+	// a stand-in device (debugsource mode 1 and 3) sends to the video socket in place of the tuner
+	replay = mChannel->standInDevice();
+	if(replay) {
+		struct hdhomerun_video_sock_t *standInSock = hdhomerun_device_get_video_sock(mDeviceConnection);
+		if(!standInSock || startCapReplayUDP(replay, "127.0.0.1", hdhomerun_video_get_local_port(standInSock)) < 0) {
+			flog( "Native.log",  "HDHomeRun: Error starting stand-in device\r\n");
+			mCaptureThreadRunning = false;
+			return;
+		}
+		playCapReplay(replay);
+	} else {
+		// start the device
+		result = hdhomerun_device_stream_start(mDeviceConnection);
+		if(result <= 0) {
+			flog( "Native.log",  "HDHomeRun: Error starting stream\r\n");
+			return;
+		}
 	}
 	
+	// wake on data instead of polling every 64ms
+	struct hdhomerun_video_sock_t *vs = hdhomerun_device_get_video_sock(mDeviceConnection);
+	if(vs) hdhomerun_video_set_notify(vs, HDHR_CAPTURE_WATERMARK);
+	
 	while(!mKillCaptureThread) {
 		size_t actual_size;
 		
-		// every 64ms read data from the hdhr device and push it to mChannel
-		usleep(64000);
+		// read data from the hdhr device once enough is buffered and push it to mChannel
+		if(vs)
+			hdhomerun_video_wait(vs, HDHR_CAPTURE_WAIT_MS);
+		else
+			usleep(64000);
 		
 		buf = hdhomerun_device_stream_recv(mDeviceConnection, VIDEO_DATA_BUFFER_SIZE_1S, &actual_size);
 		if(!buf) continue;
 		
+		unsigned long long pushStart = replay ? capReplayUs() : 0;
 		mChannel->pushData(buf, actual_size);
+		if(replay)
+			consumedCapReplay(replay, actual_size, (unsigned long)(capReplayUs() - pushStart));
+		
+		pthread_mutex_lock(&mPushMutex);
+		pthread_cond_broadcast(&mPushCond);
+		pthread_mutex_unlock(&mPushMutex);
+	}
+	if(replay) {
+		stopCapReplay(replay);
+		hdhomerun_device_stream_flush(mDeviceConnection);
+	} else {
+		hdhomerun_device_stream_flush(mDeviceConnection);
+		hdhomerun_device_stream_stop(mDeviceConnection);
 	}
-	hdhomerun_device_stream_flush(mDeviceConnection);
-	hdhomerun_device_stream_stop(mDeviceConnection);
 	
 	mCaptureThreadRunning = false;
 }
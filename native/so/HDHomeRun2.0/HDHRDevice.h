@@ -74,6 +74,7 @@ public:
 	bool setInput(char *sigFormat, int countryCode, int videoFormat);
 	char *getBroadcastStandard();
 	int getSignalStrength();
+	CapReplay *standInDevice() {return mChannel ? mChannel->standInDevice() : NULL;}
 	
 	static void *captureThreadEntry(void *arg);
 	
@@ -92,24 +93,26 @@ private:
 	unsigned short lastFilterProgram;
 	DTVChannel *mChannel;
 	char *mOutputPath;
-	FILE *mOutputFile;
 	size_t mMaxFileSize;
 	off_t mLastMealSize;
 #ifdef FILETRANSITION
 	char *mNextOutputPath;
-	FILE *mNextOutputFile;
 #endif
 
 	pthread_t mCaptureThread;
 	bool mCaptureThreadRunning;
 	bool mKillCaptureThread;
+	pthread_mutex_t mPushMutex;		// mPushCond is signalled after each pushData
+	pthread_cond_t mPushCond;
 	
 	// tuning variables
 	struct hdhomerun_channel_list_t *mDeviceChannelList;	// needed to look up frequencies (HDHR uses center freqs, not channel freqs)
 	const char *mDeviceChannelMap;							// tracks which channel table we're using
 	
+	bool standInTuner() {return mChannel && mChannel->standInOnly();}
 	void stopCapture();
 	void captureThread();
+	void waitForPush(int ms);
 };
 
 #endif //__HDHRDEVICE_H
@@ -0,0 +1,109 @@
+/*
+ * Copyright 2015 The SageTV Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+// Capture server sizing for the HDHomeRun plugin, see capbench.h. N HDHRDevice tuners without
+// hardware record at once, each from a stand-in device sending its video socket 1316 byte datagrams
+// as a tuner does, through the plugin's own capture thread, DTVChannel and output files.
+// debugserver.ini in the working directory: "debugsource 3 <file.ts>", "debugsource_speed <percent>"
+// usage: dtvbench [-t tuners] [-s seconds] [-d outdir] [-c channel]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "HDHRDevice.h"
+#include "capbench.h"
+
+#define STANDIN_DEVICE_ID 0x10000000    // any id but 0 and the wildcard, nothing is discovered
+
+static void *benchOpen(void *context, int tuner)
+{
+    hdhomerun_discover_device_t disco;
+    disco.ip_addr = 0x7f000001;
+    disco.device_type = HDHOMERUN_DEVICE_TYPE_TUNER;
+    disco.device_id = STANDIN_DEVICE_ID + tuner/2;
+
+    HDHRDevice *dev = new HDHRDevice(disco, tuner%2);
+    if (!dev->openDevice())
+    {
+        delete dev;
+        return NULL;
+    }
+    if (dev->standInDevice() == NULL)
+    {
+        fprintf(stderr, "%s isn't on a stand-in device, check debugserver.ini\n", dev->getName());
+        delete dev;
+        return NULL;
+    }
+    if (!dev->setInput((char *)"ATSC", 1, 0) || !dev->setChannel((char *)context, false, 32))
+    {
+        delete dev;
+        return NULL;
+    }
+    return dev;
+}
+
+static int benchStart(void *tuner, const char *outFile)
+{
+    return ((HDHRDevice *)tuner)->setupEncoding((char *)outFile, 0);
+}
+
+// the Java encoder thread, it sleeps between calls as the capture thread records on its own
+static int benchEat(void *tuner)
+{
+    HDHRDevice *dev = (HDHRDevice *)tuner;
+    dev->encoderIdle();
+    usleep(50000);
+    return (int)dev->eatEncoderData();
+}
+
+static void benchStop(void *tuner)
+{
+    ((HDHRDevice *)tuner)->closeEncoding();
+}
+
+static void benchClose(void *tuner)
+{
+    delete (HDHRDevice *)tuner;
+}
+
+static CapReplay *benchReplay(void *tuner)
+{
+    return ((HDHRDevice *)tuner)->standInDevice();
+}
+
+int main(int argc, char **argv)
+{
+    static const CapBenchOps ops = { benchOpen, benchStart, benchEat, benchStop, benchClose, benchReplay, NULL };
+    CapBenchParams params = { "HDHomeRun", 1, 10, NULL };
+    const char *channel = "2-0-0";
+    int c;
+
+    while ((c = getopt(argc, argv, "t:s:d:c:")) != -1)
+    {
+        switch (c)
+        {
+            case 't': params.tuners = atoi(optarg); break;
+            case 's': params.seconds = atoi(optarg); break;
+            case 'd': params.outDir = optarg; break;
+            case 'c': channel = optarg; break;
+            default:
+                fprintf(stderr, "usage: dtvbench [-t tuners] [-s seconds] [-d outdir] [-c channel]\n"
+                        "  debugserver.ini: debugsource 3 <file.ts>, debugsource_speed <percent>\n");
+                return 1;
+        }
+    }
+    return runCapBench(&ops, (void *)channel, &params);
+}
@@ -0,0 +1,314 @@
+/*
+ * Copyright 2015 The SageTV Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+// Multi-program recording through one DTVChannel. A stand-in tuner plays a recorded multi-program mux
+// in 1316 byte datagrams and applies the PID filter DTVChannel sets on it, as an HDHomeRun does. After
+// the main remuxer has locked its program, every program gets its own output file; midway one program
+// switches to a second file and another one stops while the rest keep recording. Each file is checked
+// to be MPEG-2 PS and its size against a remuxer per program fed the same part of the mux.
+// A mux can be made with "tsbench split none -p4 -m16 -d<dir>" (<dir>/mux.ts).
+// usage: dtvprogramtest <mux.ts> <output dir> [-c<push bytes, 188 and up>]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "DTVChannel.h"
+#include "SageTuner.h"
+
+#define DATAGRAM_SIZE 1316
+#define MAX_PROGRAMS MAX_PROGRAM_OUTPUT
+
+class StandInTuner : public SageTuner {
+    public:
+        StandInTuner() : filterPids(0) {}
+
+        virtual int setTuning(SageTuningParams *params) { return 0; }
+        virtual int getTuningStatus(bool& locked, int& strength) { locked = true; strength = 100; return 100; }
+        virtual bool allowDryTune() { return true; }
+        virtual bool hasPIDFilter() { return true; }
+        virtual int setPIDFilter(unsigned short program, int pidCount, unsigned short *pidList)
+        {
+            filterPids = 0;
+            for (int i = 0; i < pidCount && i < MAX_PID_NUM; i++)
+                if (pidList[i]) pidFilter[filterPids++] = pidList[i];
+            return 0;
+        }
+        virtual const char* getTunerType() { return "ATSC"; }
+
+        // packets of a datagram the filter passes, PAT always goes through
+        int filter(const unsigned char *in, int size, unsigned char *out)
+        {
+            int bytes = 0;
+            for (int pos = 0; pos+TS_PACKET_LENGTH <= size; pos += TS_PACKET_LENGTH)
+            {
+                int pid = ((in[pos+1]&0x1f)<<8) | in[pos+2];
+                bool pass = filterPids == 0 || pid == 0;
+                for (int i = 0; i < filterPids && !pass; i++)
+                    pass = pidFilter[i] == pid;
+                if (pass)
+                {
+                    memcpy(out+bytes, in+pos, TS_PACKET_LENGTH);
+                    bytes += TS_PACKET_LENGTH;
+                }
+            }
+            return bytes;
+        }
+
+        int filterPids;
+        unsigned short pidFilter[MAX_PID_NUM];
+};
+
+typedef struct
+{
+    unsigned short program;
+    int channel;                // order in PAT, TUNE.channel of the reference remuxer
+    char file[512];
+    char nextFile[512];
+    unsigned long long refBytes;
+} TestProgram;
+
+static unsigned char *loadFile(const char *name, long *size)
+{
+    FILE *fp = fopen(name, "rb");
+    unsigned char *data;
+    if (fp == NULL) return NULL;
+    fseek(fp, 0, SEEK_END);
+    *size = ftell(fp);
+    fseek(fp, 0, SEEK_SET);
+    data = (unsigned char *)malloc(*size);
+    if (fread(data, 1, *size, fp) != (size_t)*size)
+    {
+        free(data);
+        data = NULL;
+    }
+    fclose(fp);
+    return data;
+}
+
+// programs of the first PAT section in the mux
+static int findPrograms(const unsigned char *data, long size, TestProgram *programs)
+{
+    int num = 0;
+    for (long pos = 0; pos+TS_PACKET_LENGTH <= size; pos += TS_PACKET_LENGTH)
+    {
+        const unsigned char *p = data+pos;
+        if (p[0] != 0x47 || !(p[1]&0x40) || ((p[1]&0x1f)<<8 | p[2]) != 0)
+            continue;
+        p += 4;
+        if (data[pos+3]&0x20) p += 1+p[0];
+        p += 1+p[0];            // pointer field
+        int sectionLength = ((p[1]&0x0f)<<8) | p[2];
+        const unsigned char *entry = p+8, *end = p+3+sectionLength-4;
+        for (; entry+4 <= end && num < MAX_PROGRAMS; entry += 4)
+        {
+            unsigned short program = (entry[0]<<8) | entry[1];
+            if (program == 0) continue;
+            programs[num].program = program;
+            programs[num].channel = num+1;
+            num++;
+        }
+        break;
+    }
+    return num;
+}
+
+static int countDump(void *context, void *data, int size)
+{
+    *(unsigned long long *)context += ((OUTPUT_DATA *)data)->bytes;
+    return ((OUTPUT_DATA *)data)->bytes;
+}
+
+// a remuxer of its own fed from the offset the program output started at, flushed as a stopped output is
+static unsigned long long referenceBytes(const unsigned char *data, long size, int channel)
+{
+    unsigned long long bytes = 0, flushed;
+    TUNE tune;
+    int expected;
+    memset(&tune, 0, sizeof(tune));
+    tune.channel = channel;
+    void *remuxer = OpenRemuxStream(REMUX_STREAM, &tune, MPEG_TS, MPEG_PS, NULL, NULL, countDump, &bytes);
+    for (long pos = 0; pos < size; )
+    {
+        int used = PushRemuxStreamData(remuxer, (unsigned char *)data+pos, size-pos, &expected);
+        if (used <= 0) break;
+        pos += used;
+    }
+    FlushRemuxStream(remuxer);
+    flushed = bytes;
+    CloseRemuxStream(remuxer);
+    return flushed;
+}
+
+static long fileSize(const char *name, bool *isPS)
+{
+    struct stat st;
+    unsigned char head[4] = {0};
+    FILE *fp = fopen(name, "rb");
+    if (fp == NULL || stat(name, &st)) return -1;
+    fread(head, 1, 4, fp);
+    fclose(fp);
+    *isPS = head[0] == 0 && head[1] == 0 && head[2] == 1 && head[3] == 0xba;
+    return st.st_size;
+}
+
+// the stand-in tuner filters each datagram, DTVChannel gets the result in pushSize slices
+static void play(DTVChannel *chan, StandInTuner *tuner, const unsigned char *data, long from, long to, int pushSize)
+{
+    unsigned char datagram[DATAGRAM_SIZE];
+    static unsigned char pending[DATAGRAM_SIZE*64];
+    static int pendingBytes = 0;
+
+    for (long pos = from; pos < to; pos += DATAGRAM_SIZE)
+    {
+        int size = to-pos < DATAGRAM_SIZE ? (int)(to-pos) : DATAGRAM_SIZE;
+        memcpy(datagram, data+pos, size);
+        pendingBytes += tuner->filter(datagram, size, pending+pendingBytes);
+        if (pendingBytes >= pushSize)
+        {
+            int off = 0;
+            for (; pendingBytes-off >= pushSize; off += pushSize)
+                chan->pushData(pending+off, pushSize);
+            memmove(pending, pending+off, pendingBytes-off);
+            pendingBytes -= off;
+        }
+        chan->idle();
+    }
+    if (pendingBytes)
+        chan->pushData(pending, pendingBytes);
+    pendingBytes = 0;
+}
+
+int main(int argc, char **argv)
+{
+    TestProgram programs[MAX_PROGRAMS];
+    StandInTuner tuner;
+    TUNE tune;
+    long size, start, switchAt, stopAt;
+    int num, pushSize = 1000, errors = 0, i;
+    unsigned char *data;
+
+    if (argc < 3)
+    {
+        fprintf(stderr, "usage: dtvprogramtest <mux.ts> <output dir> [-c<push bytes>]\n");
+        return 1;
+    }
+    for (i = 3; i < argc; i++)
+        if (!strncmp(argv[i], "-c", 2)) pushSize = atoi(argv[i]+2);
+    if (pushSize < TS_PACKET_LENGTH || pushSize > DATAGRAM_SIZE*32) pushSize = 1000;
+    if ((data = loadFile(argv[1], &size)) == NULL)
+    {
+        fprintf(stderr, "can't read %s\n", argv[1]);
+        return 1;
+    }
+    size -= size % TS_PACKET_LENGTH;
+    if ((num = findPrograms(data, size, programs)) < 3)
+    {
+        fprintf(stderr, "%s has %d programs, 3 are needed\n", argv[1], num);
+        return 1;
+    }
+    // main output locks channel 1 as the Channel library tunes an ATSC channel
+    memset(&tune, 0, sizeof(tune));
+    tune.stream_format = ATSC_STREAM;
+    tune.channel = 1;
+
+    // program outputs start once the main remuxer has set the PID filter, the first switches file and
+    // the last stops midway
+    start    = (size/10)  / DATAGRAM_SIZE * DATAGRAM_SIZE;
+    switchAt = (size*4/10) / DATAGRAM_SIZE * DATAGRAM_SIZE;
+    stopAt   = (size*6/10) / DATAGRAM_SIZE * DATAGRAM_SIZE;
+
+    DTVChannel *chan = new DTVChannel(&tuner, "StandIn Tuner 0", NULL, 0);
+    chan->lockTSChannel(&tune);
+    chan->startTSParser();
+    play(chan, &tuner, data, 0, start, pushSize);
+    printf("%d programs, %ld MB mux, main output PID filter %d pids\n", num, size>>20, tuner.filterPids);
+    if (tuner.filterPids == 0)
+    {
+        printf("FAIL: main remuxer didn't set the PID filter\n");
+        errors++;
+    }
+
+    for (i = 0; i < num; i++)
+    {
+        TestProgram *p = &programs[i];
+        snprintf(p->file, sizeof(p->file), "%s/program-%d.mpg", argv[2], p->program);
+        p->nextFile[0] = 0;
+        if (!chan->startProgramOutput(p->program, p->file))
+        {
+            printf("FAIL: program %d output can't be started\n", p->program);
+            return 1;
+        }
+    }
+    if (chan->startProgramOutput(programs[0].program, "/dev/null"))
+    {
+        printf("FAIL: program %d started twice\n", programs[0].program);
+        errors++;
+    }
+    if (tuner.filterPids != 0)
+    {
+        printf("FAIL: PID filter is on while program outputs run\n");
+        errors++;
+    }
+
+    play(chan, &tuner, data, start, switchAt, pushSize);
+    snprintf(programs[0].nextFile, sizeof(programs[0].nextFile), "%s/program-%d-2.mpg", argv[2], programs[0].program);
+    chan->setNextProgramOutputFile(programs[0].program, programs[0].nextFile);
+    play(chan, &tuner, data, switchAt, stopAt, pushSize);
+    if (chan->hasNextProgramOutputFile(programs[0].program))
+    {
+        printf("FAIL: program %d didn't switch file\n", programs[0].program);
+        errors++;
+    }
+    chan->stopProgramOutput(programs[num-1].program);
+    play(chan, &tuner, data, stopAt, size, pushSize);
+
+    for (i = 0; i < num-1; i++)
+        chan->stopProgramOutput(programs[i].program);
+    if (tuner.filterPids == 0)
+    {
+        printf("FAIL: PID filter isn't restored after the last program output\n");
+        errors++;
+    }
+    delete chan;
+
+    for (i = 0; i < num; i++)
+    {
+        TestProgram *p = &programs[i];
+        bool isPS = false, nextPS = false;
+        long bytes = fileSize(p->file, &isPS), nextBytes = 0;
+        long end = i == num-1 ? stopAt : size;
+        p->refBytes = referenceBytes(data+start, end-start, p->channel);
+        if (p->nextFile[0])
+            nextBytes = fileSize(p->nextFile, &nextPS);
+        printf("  program %5d %10ld bytes", p->program, bytes);
+        if (p->nextFile[0]) printf(" + %10ld bytes", nextBytes);
+        printf(", remuxer/program %10llu bytes%s\n", p->refBytes, i == num-1 ? " (stopped)" : p->nextFile[0] ? " (switched)" : "");
+
+        if (bytes <= 0 || !isPS || (p->nextFile[0] && (nextBytes <= 0 || !nextPS)))
+        {
+            printf("FAIL: program %d output isn't PS\n", p->program);
+            errors++;
+        } else
+        if ((unsigned long long)(bytes+nextBytes) != p->refBytes)
+        {
+            printf("FAIL: program %d output size differs from remuxer/program\n", p->program);
+            errors++;
+        }
+    }
+    free(data);
+    printf("%s\n", errors ? "FAILED" : "PASSED");
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,302 @@
+/*
+ * Copyright 2015 The SageTV Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+// HDHomeRun receive path latency and CPU per stream. A sender thread plays the tuner, it paces
+// 1316 byte datagrams to one libhdhomerun video socket per stream over loopback, stamping each with
+// its send time. A consumer thread per stream takes the data off the video socket as
+// HDHRDevice::captureThread does and records how old each datagram is when it gets there.
+// modes: poll   - 64ms sleep, one recv per datagram (the old capture loop)
+//        notify - hdhomerun_video_wait on the watermark, one recv per datagram
+//        batch  - hdhomerun_video_wait on the watermark, recvmmsg batches (default)
+// usage: hdhrbench [-m<poll|notify|batch>] [-t<streams>] [-s<seconds>] [-b<Mbps per stream>] [-w<watermark packets>] [-p<send tick us>]
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <pthread.h>
+#include "hdhomerun.h"
+
+#define MAX_STREAMS 64
+#define SEND_TICK_US 1000               // default send pacing, -p sends bursts
+#define POLL_US 64000
+#define WAIT_MS 32
+#define LATENCY_BUCKET_US 10
+#define LATENCY_BUCKETS 100000          // 1 second
+
+enum { MODE_POLL, MODE_NOTIFY, MODE_BATCH };
+
+typedef struct
+{
+    struct hdhomerun_video_sock_t *vs;
+    struct sockaddr_in addr;
+    pthread_t consumer;
+    unsigned long long sent;            // datagrams
+    unsigned long long got;
+    unsigned long long wakeups;         // consumer loop iterations
+    unsigned int latency[LATENCY_BUCKETS+1];
+} BenchStream;
+
+typedef struct
+{
+    BenchStream stream[MAX_STREAMS];
+    int streams;
+    int seconds;
+    int mode;
+    double mbps;
+    int tickUs;
+    size_t watermark;
+    volatile int stop;
+    struct rusage senderUsage;
+} Bench;
+
+static const char *modeName[] = { "poll", "notify", "batch" };
+
+static unsigned long long nowUs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec*1000000 + ts.tv_nsec/1000;
+}
+
+static double cpuSec(struct rusage *ru)
+{
+    return ru->ru_utime.tv_sec + ru->ru_utime.tv_usec/1e6 + ru->ru_stime.tv_sec + ru->ru_stime.tv_usec/1e6;
+}
+
+// 7 null packets, the send time in the payload of the first one
+static void fillDatagram(unsigned char *pkt, unsigned long long stamp)
+{
+    int i;
+    for (i = 0; i < 7; i++)
+    {
+        unsigned char *p = pkt + i*TS_PACKET_SIZE;
+        p[0] = 0x47; p[1] = 0x1f; p[2] = 0xff; p[3] = 0x10;
+    }
+    memcpy(pkt+4, &stamp, sizeof(stamp));
+}
+
+static void *SenderThread(void *data)
+{
+    Bench *b=(Bench *)data;
+    unsigned char pkt[VIDEO_DATA_PACKET_SIZE];
+    double owed[MAX_STREAMS];
+    double perTick = b->mbps*1e6/8/VIDEO_DATA_PACKET_SIZE*b->tickUs/1e6;
+    unsigned long long start, next;
+    int sock, i;
+
+    memset(pkt, 0xff, sizeof(pkt));
+    memset(owed, 0, sizeof(owed));
+    sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sock < 0)
+    {
+        perror("socket");
+        b->stop = 1;
+        return NULL;
+    }
+
+    start = next = nowUs();
+    while (!b->stop && nowUs()-start < (unsigned long long)b->seconds*1000000)
+    {
+        for (i = 0; i < b->streams; i++)
+        {
+            BenchStream *s = &b->stream[i];
+            owed[i] += perTick;
+            while (owed[i] >= 1.0)
+            {
+                fillDatagram(pkt, nowUs());
+                if (sendto(sock, pkt, sizeof(pkt), 0, (struct sockaddr *)&s->addr, sizeof(s->addr)) == sizeof(pkt))
+                    s->sent++;
+                owed[i] -= 1.0;
+            }
+        }
+        next += b->tickUs;
+        {
+            unsigned long long now = nowUs();
+            if (next > now) usleep(next-now);
+        }
+    }
+    close(sock);
+    getrusage(RUSAGE_THREAD, &b->senderUsage);
+    return NULL;
+}
+
+static void takeData(BenchStream *s)
+{
+    unsigned char *buf;
+    size_t size;
+
+    while ((buf = hdhomerun_video_recv(s->vs, VIDEO_DATA_BUFFER_SIZE_1S, &size)) != NULL)
+    {
+        unsigned long long now = nowUs();
+        size_t pos;
+        for (pos = 0; pos+VIDEO_DATA_PACKET_SIZE <= size; pos += VIDEO_DATA_PACKET_SIZE)
+        {
+            unsigned long long stamp, age;
+            memcpy(&stamp, buf+pos+4, sizeof(stamp));
+            age = (now > stamp ? now-stamp : 0)/LATENCY_BUCKET_US;
+            s->latency[age < LATENCY_BUCKETS ? age : LATENCY_BUCKETS]++;
+            s->got++;
+        }
+    }
+}
+
+typedef struct
+{
+    Bench *b;
+    BenchStream *s;
+} ConsumerArg;
+
+static void *ConsumerThread(void *data)
+{
+    ConsumerArg *arg=(ConsumerArg *)data;
+    Bench *b=arg->b;
+    BenchStream *s=arg->s;
+
+    while (!b->stop)
+    {
+        if (b->mode == MODE_POLL)
+            usleep(POLL_US);
+        else
+            hdhomerun_video_wait(s->vs, WAIT_MS);
+        s->wakeups++;
+        takeData(s);
+    }
+    takeData(s);
+    free(arg);
+    return NULL;
+}
+
+static double percentile(unsigned long long *hist, unsigned long long total, double p)
+{
+    unsigned long long want = (unsigned long long)(total*p), seen = 0;
+    int i;
+    for (i = 0; i <= LATENCY_BUCKETS; i++)
+    {
+        seen += hist[i];
+        if (seen > want) return i*LATENCY_BUCKET_US/1000.0;
+    }
+    return LATENCY_BUCKETS*LATENCY_BUCKET_US/1000.0;
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: hdhrbench [-m<poll|notify|batch>] [-t<streams>] [-s<seconds>] [-b<Mbps per stream>] [-w<watermark packets>] [-p<send tick us>]\n");
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    static Bench bench;
+    static unsigned long long hist[LATENCY_BUCKETS+1];
+    Bench *b=&bench;
+    struct rusage startUsage, endUsage;
+    struct hdhomerun_video_stats_t stats;
+    unsigned long long sent = 0, got = 0, wakeups = 0, overflow = 0, maxUs = 0;
+    pthread_t sender;
+    double cpu;
+    int i, j;
+
+    b->streams = 4;
+    b->seconds = 10;
+    b->mbps = 19.4;
+    b->mode = MODE_BATCH;
+    b->watermark = 32;
+    b->tickUs = SEND_TICK_US;
+    for (i = 1; i < argc; i++)
+    {
+        if (argv[i][0] != '-' || !argv[i][1]) usage();
+        switch (argv[i][1])
+        {
+        case 'm':
+            for (j = 0; j < 3 && strcmp(argv[i]+2, modeName[j]); j++);
+            if (j == 3) usage();
+            b->mode = j;
+            break;
+        case 't': b->streams = atoi(argv[i]+2); break;
+        case 's': b->seconds = atoi(argv[i]+2); break;
+        case 'b': b->mbps = atof(argv[i]+2); break;
+        case 'w': b->watermark = atoi(argv[i]+2); break;
+        case 'p': b->tickUs = atoi(argv[i]+2); break;
+        default: usage();
+        }
+    }
+    if (b->streams < 1 || b->streams > MAX_STREAMS || b->seconds < 1 || b->mbps <= 0 || b->tickUs < 1) usage();
+
+    for (i = 0; i < b->streams; i++)
+    {
+        BenchStream *s = &b->stream[i];
+        s->vs = hdhomerun_video_create(0, VIDEO_DATA_BUFFER_SIZE_1S, NULL);
+        if (!s->vs)
+        {
+            fprintf(stderr, "hdhomerun_video_create failed\n");
+            return 1;
+        }
+        hdhomerun_video_set_recv_batch(s->vs, b->mode == MODE_BATCH ? VIDEO_RECV_BATCH_MAX : 1);
+        hdhomerun_video_set_notify(s->vs, b->watermark*VIDEO_DATA_PACKET_SIZE);
+        s->addr.sin_family = AF_INET;
+        s->addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        s->addr.sin_port = htons(hdhomerun_video_get_local_port(s->vs));
+    }
+
+    getrusage(RUSAGE_SELF, &startUsage);
+    for (i = 0; i < b->streams; i++)
+    {
+        ConsumerArg *arg = (ConsumerArg *)malloc(sizeof(ConsumerArg));
+        arg->b = b;
+        arg->s = &b->stream[i];
+        pthread_create(&b->stream[i].consumer, NULL, ConsumerThread, arg);
+    }
+    pthread_create(&sender, NULL, SenderThread, b);
+    pthread_join(sender, NULL);
+
+    usleep(2*POLL_US);                 // let the consumers drain
+    b->stop = 1;
+    for (i = 0; i < b->streams; i++)
+        pthread_join(b->stream[i].consumer, NULL);
+    getrusage(RUSAGE_SELF, &endUsage);
+
+    for (i = 0; i < b->streams; i++)
+    {
+        BenchStream *s = &b->stream[i];
+        hdhomerun_video_get_stats(s->vs, &stats);
+        overflow += stats.overflow_error_count;
+        sent += s->sent;
+        got += s->got;
+        wakeups += s->wakeups;
+        for (j = 0; j <= LATENCY_BUCKETS; j++)
+        {
+            hist[j] += s->latency[j];
+            if (s->latency[j]) maxUs = j*LATENCY_BUCKET_US > maxUs ? j*LATENCY_BUCKET_US : maxUs;
+        }
+        hdhomerun_video_destroy(s->vs);
+    }
+
+    // receive threads and consumers, the sender is the tuner
+    cpu = cpuSec(&endUsage) - cpuSec(&startUsage) - cpuSec(&b->senderUsage);
+    printf("mode %s, %d streams at %.1f Mbps, watermark %lu packets, send tick %d us, %d s\n", modeName[b->mode], b->streams,
+        b->mbps, (unsigned long)b->watermark, b->tickUs, b->seconds);
+    printf("datagrams sent %llu, received %llu, lost %llu (ring overflow %llu)\n", sent, got, sent-got, overflow);
+    printf("latency ms: p50 %.2f p99 %.2f max %.2f\n", percentile(hist, got, 0.5), percentile(hist, got, 0.99),
+        maxUs/1000.0);
+    printf("consumer wakeups/s per stream %.1f, receive cpu per stream %.2f%%\n", (double)wakeups/b->streams/b->seconds,
+        cpu*100/b->seconds/b->streams);
+    return 0;
+}
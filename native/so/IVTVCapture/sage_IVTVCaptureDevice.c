@@ -40,7 +40,10 @@
 #include "sage_LinuxIVTVCaptureManager.h"
 #include "videodev2.h"
 #include "thread_util.h"
-#include "circbuffer.h"
+#include "spscring.h"
+#include "NativeCore.h"
+#include "TimeShiftFile.h"
+#include "capreplay.h"
 
 // Enable transation on good point between files
 
@@ -123,26 +126,22 @@ typedef struct MyDevFDs
 {
 	int configFd; // for configuring the device
 	int capFd; // for getting captured data from the device
-	FILE* fd; // file to write the captured data to
+	void* outFile; // TimeShiftFile to write the captured data to, switches to the next file by itself
 	long circFileSize;
 	char devName[256];
 	int cardType; // 0: mpeg 2 ivtv 1: hdpvr
 	BOOL dropNextSeq;
 	unsigned char *buf;
 	unsigned char *buf2;
-	long circWritePos;
 	struct bcast *freqarray; // must be set when the input is set
 	int videoFormatCode;
 	SageTVMPEG2EncodingParameters encodeParams;
-	circBuffer capBuffer;
-	ACL_mutex *capMutex;
-	int capState; // 0: normal 1: discarding 2: exit
+	spscRing capBuffer; // capture thread -> eatEncoderData, keeps discard mode and drop counters
+	volatile int capState; // 0: normal 2: exit
 	ACL_Thread *capThread;
-	int discardCount;
-#ifdef FILETRANSITION
-    FILE* newfd; // File that should be written to as soon as we have a good transition point
-    int bytesTested; // We want to give up after some fixed amount of bytes if no transition found
-#endif
+	CapReplay* replay; // stand-in device of debugserver.ini feeding capFd, NULL with the real device
+	int replayMode; // CAP_REPLAY_STANDIN or CAP_REPLAY_NO_DEVICE
+	unsigned long long replayDropped; // capBuffer.droppedBytes already reported to replay
 } MyDevFDs;
 
 
@@ -199,17 +198,13 @@ static int CaptureThread(void *data)
     struct timeval tv;
     int maxfd;
     int retval;
-    int state;
     struct sched_param scparam={0,};
     scparam.sched_priority=sched_get_priority_max(SCHED_FIFO);
     sched_setscheduler(0, SCHED_FIFO, &scparam);
     while(1)
     {
-        // Remove locks and merge with the main loop?
-        ACL_LockMutex(x->capMutex);
-        state=x->capState;
-        ACL_UnlockMutex(x->capMutex);
-        if(state==2) break;
+        // capBuffer is lock free, capState is only set to stop the thread
+        if(x->capState==2) break;
 
         FD_ZERO(&rfds);
         FD_SET(x->capFd, &rfds);
@@ -224,32 +219,29 @@ static int CaptureThread(void *data)
         {
             FD_CLR(x->capFd, &rfds);
             int numbytes;
-            numbytes = read(x->capFd, x->buf2, BUFFERSIZE);
-            ACL_LockMutex(x->capMutex);
+            int span=0;
+            unsigned char *ptr;
             // Can we reenter record mode
-            if(state==1 && freespaceCircBuffer(&x->capBuffer)>(CAPCIRCBUFFERSIZE/4))
+            if(x->capBuffer.discarding && freespaceSPSCRing(&x->capBuffer)>(int)x->capBuffer.resume)
             {
-                state=0;
+                x->capBuffer.discarding=0;
             }
-            if(numbytes>0)
+            if(!x->capBuffer.discarding)
+                span=writeSpanSPSCRing(&x->capBuffer, &ptr);
+            if(span>0)
             {
-                if(state==0 && freespaceCircBuffer(&x->capBuffer)>=numbytes)
-                {
-                    // We can add to our capture buffer
-                    addCircBuffer(&x->capBuffer, x->buf2, numbytes);
-                }
-                else
-                {
-                    // Enter discard mode
-                    state=1; 
-                    x->discardCount+=numbytes;
-                }
+                // read straight into the capture buffer
+                numbytes = read(x->capFd, ptr, span>BUFFERSIZE ? BUFFERSIZE : span);
+                if(numbytes>0)
+                    commitWriteSPSCRing(&x->capBuffer, numbytes);
             }
-            if(x->capState!=2)
+            else
             {
-                x->capState=state;
+                // full or discarding, pushSPSCRing counts what is dropped
+                numbytes = read(x->capFd, x->buf2, BUFFERSIZE);
+                if(numbytes>0)
+                    pushSPSCRing(&x->capBuffer, x->buf2, numbytes);
             }
-            ACL_UnlockMutex(x->capMutex);
         }
     }
     return 0;
@@ -268,6 +260,8 @@ JNIEXPORT jlong JNICALL Java_sage_IVTVCaptureDevice_createEncoder0
 	struct v4l2_ext_controls ctrls;
 	struct v4l2_ext_control ctrl;
 	struct v4l2_capability caps;
+	char replayFile[448];
+	int replaySpeed;
 	
 	memset(&rv, 0, sizeof(MyDevFDs));
 	const char* cdevname = (*env)->GetStringUTFChars(env, jdevname, NULL);
@@ -275,13 +269,28 @@ JNIEXPORT jlong JNICALL Java_sage_IVTVCaptureDevice_createEncoder0
 	strcat(rv.devName, cdevname);
 	sysOutPrint(env, "V4L: createEncoder %s\n",rv.devName);
 	(*env)->ReleaseStringUTFChars(env, jdevname, cdevname);
-	rv.configFd = open(rv.devName, O_RDONLY);
-	if (rv.configFd < 0)
+	// A recorded file standing in for the encoder, see capreplay.h
+	rv.replayMode = loadCapReplayCfg("debugserver.ini", replayFile, sizeof(replayFile), &replaySpeed);
+	if (rv.replayMode == CAP_REPLAY_STANDIN || rv.replayMode == CAP_REPLAY_NO_DEVICE)
 	{
+		rv.replay = openCapReplay(replayFile, replaySpeed);
+		if (rv.replay)
+			sysOutPrint(env, "V4L: stand-in device plays %s at %d%% (mode:%d)\n", replayFile, replaySpeed, rv.replayMode);
+		else
+			sysOutPrint(env, "V4L: failed open stand-in device file %s\n", replayFile);
+	}
+	if (rv.replay && rv.replayMode == CAP_REPLAY_NO_DEVICE)
+	{
+		// no hardware, configFd stays 0 and the settings are skipped
+	}
+	else if ((rv.configFd = open(rv.devName, O_RDONLY)) < 0)
+	{
+		closeCapReplay(rv.replay);
 		throwEncodingException(env, __LINE__/*sage_EncodingException_CAPTURE_DEVICE_INSTALL*/);
 		return 0;
 	}
 	// Test if this is a HDPVR
+	if (rv.configFd)
 	{
 		if(ioctl(rv.configFd, VIDIOC_QUERYCAP, &caps) == 0)
 		{
@@ -292,12 +301,12 @@ JNIEXPORT jlong JNICALL Java_sage_IVTVCaptureDevice_createEncoder0
 			}
 		}
 	}
-	if(createCircBuffer(&rv.capBuffer, CAPCIRCBUFFERSIZE)==0)
+	if(createSPSCRing(&rv.capBuffer, CAPCIRCBUFFERSIZE)==0)
 	{
+		closeCapReplay(rv.replay);
 		throwEncodingException(env, __LINE__/*sage_EncodingException_CAPTURE_DEVICE_INSTALL*/);
 		return 0;
 	}
-	rv.capMutex = ACL_CreateMutex();
 	MyDevFDs* realRv = (MyDevFDs*) malloc(sizeof(MyDevFDs));
 	if(realRv!=NULL)
 	{
@@ -308,6 +317,7 @@ JNIEXPORT jlong JNICALL Java_sage_IVTVCaptureDevice_createEncoder0
 		{
 			if(realRv->buf) free(realRv->buf);
 			if(realRv->buf2) free(realRv->buf2);
+			closeCapReplay(realRv->replay);
 			free(realRv);
 			realRv=NULL;
 		}
@@ -315,6 +325,21 @@ JNIEXPORT jlong JNICALL Java_sage_IVTVCaptureDevice_createEncoder0
 	return (jlong) realRv;
 }
 
+// keyframe index sidecar "<recording>.idx" for seeking, HDPVR's TS and circular files aren't indexed
+static void* openOutputFile(MyDevFDs* x, const char* cfilename)
+{
+	return OpenTimeShiftFile(cfilename, x->circFileSize, x->cardType==CARD_IVTV ? TIMESHIFT_INDEX : 0);
+}
+
+static void closeOutputFile(MyDevFDs* x)
+{
+	if (x->outFile)
+	{
+		CloseTimeShiftFile(x->outFile);
+		x->outFile = NULL;
+	}
+}
+
 /*
  * Class:     sage_IVTVCaptureDevice
  * Method:    setupEncoding0
@@ -326,8 +351,11 @@ JNIEXPORT jboolean JNICALL Java_sage_IVTVCaptureDevice_setupEncoding0
 	if (ptr)
 	{
 		MyDevFDs* x = (MyDevFDs*) ptr;
-		// Open the interface to the capture device
-		x->capFd = open(x->devName, O_RDONLY, S_IWUSR);
+		// Open the interface to the capture device, or the pipe of its stand-in
+		if (x->replay)
+			x->capFd = startCapReplayPipe(x->replay, 0);
+		else
+			x->capFd = open(x->devName, O_RDONLY, S_IWUSR);
 		if (x->capFd == -1)
 		{
 			throwEncodingException(env, __LINE__/*sage_EncodingException_CAPTURE_DEVICE_INSTALL*/);
@@ -338,13 +366,13 @@ JNIEXPORT jboolean JNICALL Java_sage_IVTVCaptureDevice_setupEncoding0
 			sysOutPrint(env, "V4L: couldn't set nonblocking mode\n");
 		}
 		x->circFileSize = (long) circSize;
-		x->circWritePos = 0;
 		// Open up the file we're going to write to
 		const char* cfilename = (*env)->GetStringUTFChars(env, jfilename, NULL);
 		sysOutPrint(env, "V4L: setup encoding %s\n",cfilename);
-		x->fd = fopen(cfilename, "wb");
+		closeOutputFile(x);
+		x->outFile = openOutputFile(x, cfilename);
 		(*env)->ReleaseStringUTFChars(env, jfilename, cfilename);
-		if (!x->fd)
+		if (!x->outFile)
 		{
 			if(x->cardType==CARD_HDPVR)
 			{
@@ -359,10 +387,11 @@ JNIEXPORT jboolean JNICALL Java_sage_IVTVCaptureDevice_setupEncoding0
 			return JNI_FALSE;
 		}
 		if(x->cardType==CARD_IVTV) x->dropNextSeq = 1;
-		x->discardCount=0;
 		x->capState=0;
-		resetCircBuffer(&x->capBuffer);
+		resetSPSCRing(&x->capBuffer);
+		x->replayDropped = x->capBuffer.droppedBytes;
 		x->capThread = ACL_CreateThread(CaptureThread, x);
+		playCapReplay(x->replay);
 		return JNI_TRUE;
 	}
 	return JNI_FALSE;
@@ -380,12 +409,9 @@ JNIEXPORT jboolean JNICALL Java_sage_IVTVCaptureDevice_switchEncoding0
 	if (ptr)
 	{
 		MyDevFDs* x = (MyDevFDs*) ptr;
+		int switched;
 #ifndef FILETRANSITION
-		if (x->fd)
-		{
-			fclose(x->fd);
-			x->fd = 0;
-		}
+		closeOutputFile(x);
 #else
 		int loopcount=0;
 #endif
@@ -394,24 +420,18 @@ JNIEXPORT jboolean JNICALL Java_sage_IVTVCaptureDevice_switchEncoding0
 		const char* cfilename = (*env)->GetStringUTFChars(env, jfilename, NULL);
         sysOutPrint(env, "V4L: switch encoding %s\n",cfilename);
 #ifdef FILETRANSITION
-		x->newfd = fopen(cfilename, "wb");
-		x->bytesTested=0;
+		// HDPVR switches on a video AUD packet, ivtv cards on a sequence header, or after 16MB without one
+		switched = x->outFile != NULL && SwitchTimeShiftFile(x->outFile, cfilename,
+			x->cardType==CARD_HDPVR ? TIMESHIFT_TS : TIMESHIFT_PS, 2, 16*1024*1024);
 #else
-		x->fd = fopen(cfilename, "wb");
+		x->outFile = openOutputFile(x, cfilename);
+		switched = x->outFile != NULL;
 #endif
 		(*env)->ReleaseStringUTFChars(env, jfilename, cfilename);
-#ifdef FILETRANSITION
-		if (!x->newfd)
-#else
-		if (!x->fd)
-#endif
+		if (!switched)
 		{
-			// This can be true in FILETRANSITION mode when newfd failed
-			if (x->fd)
-			{
-				fclose(x->fd);
-				x->fd = 0;
-			}
+			// This can be true in FILETRANSITION mode when the next file failed
+			closeOutputFile(x);
 			if(x->cardType==CARD_HDPVR)
 			{
 				struct v4l2_encoder_cmd v4lcmd;
@@ -427,18 +447,14 @@ JNIEXPORT jboolean JNICALL Java_sage_IVTVCaptureDevice_switchEncoding0
 #ifdef FILETRANSITION
 		// We must loop until we have switched file since the core expects no write to the old file after this point.
         sysOutPrint(env, "V4L: going into eatEncoderData0 until file switched\n");
-		while(x->newfd && loopcount<5)
+		while(TimeShiftSwitchPending(x->outFile) && loopcount<5)
 		{
 			// At most this will wait 1 second
 			if(Java_sage_IVTVCaptureDevice_eatEncoderData0(env, jo, ptr)==0)
 				loopcount+=1;
 		}
-		if(x->newfd)
-		{
-			fclose(x->fd);
-			x->fd=x->newfd;
-			x->newfd=0;
-		}
+		if(ForceTimeShiftSwitch(x->outFile))
+			sysOutPrint(env, "V4L: no data for transition, switched fd on %s\n",x->devName);
 #else
 		if(x->cardType==CARD_IVTV) x->dropNextSeq = 1;
 #endif
@@ -458,29 +474,17 @@ JNIEXPORT jboolean JNICALL Java_sage_IVTVCaptureDevice_closeEncoding0
 	if (ptr)
 	{
 		MyDevFDs* x = (MyDevFDs*) ptr;
+		stopCapReplay(x->replay);
 		if(x->capThread)
 		{
-			ACL_LockMutex(x->capMutex);
 			x->capState=2;
-			ACL_UnlockMutex(x->capMutex);
 			sysOutPrint(env, "V4L: join capture thread\n");
 			ACL_ThreadJoin(x->capThread);
 			sysOutPrint(env, "V4L: capture thread stopped\n");
 			ACL_RemoveThread(x->capThread);
 			x->capThread=NULL;
 		}
-		if (x->fd)
-		{
-			fclose(x->fd);
-			x->fd = 0;
-		}
-#ifdef FILETRANSITION
-		if (x->newfd)
-		{
-			fclose(x->newfd);
-			x->newfd = 0;
-		}
-#endif
+		closeOutputFile(x);
 		if (x->capFd)
 		{
 			if(x->cardType==CARD_HDPVR)
@@ -514,9 +518,7 @@ JNIEXPORT void JNICALL Java_sage_IVTVCaptureDevice_destroyEncoder0
 		MyDevFDs* x = (MyDevFDs*) ptr;
 		if(x->capThread)
 		{
-			ACL_LockMutex(x->capMutex);
 			x->capState=2;
-			ACL_UnlockMutex(x->capMutex);
 			sysOutPrint(env, "V4L: join capture thread\n");
 			ACL_ThreadJoin(x->capThread);
 			sysOutPrint(env, "V4L: capture thread stopped\n");
@@ -540,8 +542,16 @@ JNIEXPORT void JNICALL Java_sage_IVTVCaptureDevice_destroyEncoder0
 			close(x->capFd);
 			x->capFd = 0;
 		}
-		free(x->capBuffer.data);
-		ACL_RemoveMutex(x->capMutex);
+		if (x->replay)
+		{
+			CapReplayStats stats;
+			statsCapReplay(x->replay, &stats);
+			sysOutPrint(env, "V4L: stand-in device sent %llu bytes, dropped %llu, %u loops\n",
+				stats.sentBytes, stats.droppedBytes, stats.loops);
+			closeCapReplay(x->replay);
+		}
+		closeOutputFile(x);
+		freeSPSCRing(&x->capBuffer);
 		free(x->buf);
 		free(x->buf2);
 		free(x);
@@ -549,116 +559,6 @@ JNIEXPORT void JNICALL Java_sage_IVTVCaptureDevice_destroyEncoder0
 	sysOutPrint(env, "V4L: done destroyEncoder\n");
 }
 
-// NOTE: This could get bad start codes.
-static int verifyPSBlock(unsigned char *data)
-{
-    unsigned char b;
-    unsigned int pos=0;
-    int cur=0xFFFFFFFF;
-    while(pos<2048)
-    {
-        b=data[pos];
-        pos+=1;
-        cur<<=8;
-        cur|=b;
-        if((cur&0xFFFFFF00)==0x00000100)
-        {
-            /* video */
-            if((b==0xB3))
-            {
-                return 1;
-            }
-        }
-    }
-    return 0;
-}
-
-static int findTransitionPoint(unsigned char* data, int length, int flags)
-{
-    int numbytes=length;
-
-    // HDPVR format
-    if(flags==1)
-    {
-        int i, tsstart=-1, tsvidpacket=-1, seqstart=-1;
-        // For the HDPVR our input is a tranport stream, we must find a valid start point
-        // in the video pid 0x1011 of 00 00 01 09 10 00
-
-        // First we try to locate ts packets
-        for(i=0;i<numbytes;i++)
-        {
-            if(data[i]==0x47 && 
-                (i+188)<numbytes && data[i+188]==0x47 &&
-                (i+188*2)<numbytes && data[i+188*2]==0x47)
-            {
-                tsstart=i;
-                break;
-            }
-        }
-
-        // Second we find a ts packet with section start and pid 0x1011
-        while((i+188)<=numbytes)
-        {
-            if(data[i]==0x47 &&
-                data[i+1]==0x50 &&
-                data[i+2]==0x11)
-            {
-                tsvidpacket=i;
-                // Verify if that packet contains the magic sequence 00 00 00 01 09 10 00
-                // If it does, the data up to the begining of this TS packet go in old file 
-                // and the new data in the new file
-                int j;
-                for(j=4;j<188-7;j++)
-                {
-                    // NOTE: we could implement faster search but the number of
-                    // matched packet that reach this point should be quite small...
-                    if(data[i+j]==0x00 &&
-                        data[i+j+1]==0x00 &&
-                        data[i+j+2]==0x00 &&
-                        data[i+j+3]==0x01 &&
-                        data[i+j+4]==0x09 &&
-                        data[i+j+5]==0x10 &&
-                        data[i+j+6]==0x00)
-                    {
-                        // We have found the vid packet with the magic sequence, write that to old file
-                        return tsvidpacket;
-                    }
-                }
-            }
-            i+=188;
-        }
-    }
-    else
-    {
-        // For the IVTV cards we must find a sequence start inside the video stream
-        // we are looking for 00 00 01 B3
-        int i=0, psstart=-1;
-        // IVTV use 2K blocks
-        // First locate the 00 00 01 BA block
-        while(i<=numbytes-2048)
-        {
-            if(data[i]==0x00 && 
-                data[i+1]==0x00 &&
-                data[i+2]==0x01 &&
-                data[i+3]==0xBA)
-            {
-                psstart=i;
-                if(verifyPSBlock(&data[i]))
-                {
-                    // We have found the sequence start
-                    return psstart;
-                }
-                i+=2048;
-            }
-            else
-            {
-                i++;
-            }
-        }
-    }
-    return -1;
-}
-
 /*
  * Class:     sage_IVTVCaptureDevice
  * Method:    eatEncoderData0
@@ -671,6 +571,8 @@ JNIEXPORT jint JNICALL Java_sage_IVTVCaptureDevice_eatEncoderData0
 	if (ptr)
 	{
 		MyDevFDs* x = (MyDevFDs*) ptr;
+		unsigned long long writeStart = 0;
+		int taken;
 
 		// Read the data from the capture device, then check for seq hdr if we need to,
 		// and then write it to the file; enforcing circularity if needed
@@ -701,18 +603,16 @@ JNIEXPORT jint JNICALL Java_sage_IVTVCaptureDevice_eatEncoderData0
         // 86 ts packets or 7 program stream blocks
         while(readMore)
         {
-            ACL_LockMutex(x->capMutex);
-            numbytes = usedspaceCircBuffer(&x->capBuffer);
+            numbytes = usedspaceSPSCRing(&x->capBuffer);
             numbytes = numbytes > BUFFERSIZE ?  BUFFERSIZE : numbytes;
 #ifdef FILETRANSITION
-            if(x->newfd)
+            if(TimeShiftSwitchPending(x->outFile))
             {
                 // We dont' want less than full buffer so sleep a little if less than full
                 if(numbytes!=BUFFERSIZE) numbytes=0;
             }
 #endif
-            getCircBuffer(&x->capBuffer, x->buf, numbytes);
-            ACL_UnlockMutex(x->capMutex);
+            getSPSCRing(&x->capBuffer, x->buf, numbytes);
             if(numbytes==0)
             {
                 ACL_Delay(10);
@@ -722,43 +622,11 @@ JNIEXPORT jint JNICALL Java_sage_IVTVCaptureDevice_eatEncoderData0
             else
                 readMore = 0;
         }
+        taken = numbytes;
+        if (x->replay)
+            writeStart = capReplayUs();
 
         int bufSkip = 0;
-#ifdef FILETRANSITION
-        // We want to switch to the new fd as soon as we get a good starting point
-        if(x->newfd)
-        {
-            // We need to parse the current data buffer hoping to find a starting point
-            int transitionpos = findTransitionPoint(x->buf, numbytes, 
-                x->cardType==CARD_HDPVR ? 1 : 0);
-            if(transitionpos!=-1)
-            {
-                bufSkip=transitionpos;
-                if (!x->circFileSize)
-                {
-                    // TODO: Do we care if this fails?
-                    fwrite(x->buf, 1, bufSkip, x->fd);
-                }
-                sysOutPrint(env, "V4L: transition found after %d bytes switching fd on %s\n",
-                    x->bytesTested+bufSkip,x->devName);
-                fclose(x->fd);
-                x->fd=x->newfd;
-                x->newfd=0;
-            }
-            else
-            {
-                x->bytesTested+=numbytes;
-                // We might want to have different numbers for IVTV/HDPVR or base it on bitrates
-                if(x->bytesTested>16*1024*1024)
-                {
-                    sysOutPrint(env, "V4L: transition limit reached, switching fd on %s\n",x->devName);
-                    fclose(x->fd);
-                    x->fd=x->newfd;
-                    x->newfd=0;
-                }
-            }
-        }
-#endif
 		if (x->dropNextSeq)
 		{
 			int i = 0;
@@ -795,55 +663,20 @@ JNIEXPORT jint JNICALL Java_sage_IVTVCaptureDevice_eatEncoderData0
 			if(x->dropNextSeq) numbytes=0;
 		}
 
-		if (numbytes)
+		// a pending next file is taken at a transition point, a circular file wraps without seek
+		if (numbytes && WriteTimeShiftData(x->outFile, x->buf + bufSkip, numbytes) < 0)
 		{
-			if (x->circFileSize)
-			{
-				if (x->circWritePos == x->circFileSize)
-				{
-					// Wrap it now
-					fseek(x->fd, 0, 0);
-					x->circWritePos = 0;
-				}
-				if (x->circWritePos + numbytes <= x->circFileSize)
-				{
-					// No wrapping this time
-					if (fwrite(x->buf + bufSkip, 1, numbytes, x->fd) == EOF)
-					{
-						throwEncodingException(env, __LINE__);//sage_EncodingException_HW_VIDEO_COMPRESSION);
-						return 0;
-					}
-					x->circWritePos += numbytes;
-				}
-				else
-				{
-					if (fwrite(x->buf + bufSkip, 1, x->circFileSize - x->circWritePos, x->fd) == EOF)
-					{
-						throwEncodingException(env, __LINE__);//sage_EncodingException_HW_VIDEO_COMPRESSION);
-						return 0;
-					}
-					int remBytes = numbytes - (x->circFileSize - x->circWritePos);
-					// Wrap it now
-					fseek(x->fd, 0, 0);
-					x->circWritePos = remBytes;
-					if (fwrite(x->buf + bufSkip + (numbytes - remBytes), 1, remBytes, x->fd) == EOF)
-					{
-						throwEncodingException(env, __LINE__);//sage_EncodingException_HW_VIDEO_COMPRESSION);
-						return 0;
-					}
-				}
-
-			}
-			else
-			{
-				if (fwrite(x->buf + bufSkip, 1, numbytes, x->fd) == -1)
-				{
-					throwEncodingException(env, __LINE__);//sage_EncodingException_HW_VIDEO_COMPRESSION);
-					return 0;
-				}
-			}
+			throwEncodingException(env, __LINE__);//sage_EncodingException_HW_VIDEO_COMPRESSION);
+			return 0;
+		}
+		FlushTimeShiftFile(x->outFile);
+		if (x->replay)
+		{
+			// what the stand-in device sent that is now written, skipped or was dropped by the capture thread
+			unsigned long long dropped = x->capBuffer.droppedBytes;
+			consumedCapReplay(x->replay, taken + (unsigned long)(dropped - x->replayDropped), capReplayUs() - writeStart);
+			x->replayDropped = dropped;
 		}
-		fflush(x->fd);
 		return numbytes;
 	}
 }
@@ -927,7 +760,11 @@ JNIEXPORT jboolean JNICALL Java_sage_IVTVCaptureDevice_setChannel0
 			}
 			return setFrequencyNew(env, x, freq);
 		}
+		// the stand-in device without hardware plays one channel
+		if (!x->configFd && x->replay)
+			return JNI_TRUE;
 	}
+	return JNI_FALSE;
 }
 
 /*
@@ -1260,7 +1097,7 @@ JNIEXPORT jboolean JNICALL Java_sage_IVTVCaptureDevice_setEncoding0
 {
 	if (!ptr) return JNI_FALSE;
 	MyDevFDs* x = (MyDevFDs*) ptr;
-	if (!x->configFd) return JNI_FALSE;
+	if (!x->configFd) return x->replay ? JNI_TRUE : JNI_FALSE;
 	const char* tempStr = (*env)->GetStringUTFChars(env, jencName, NULL);
 	sysOutPrint(env, "V4L: setEncodingProperties0 %s\n", tempStr);
 	(*env)->ReleaseStringUTFChars(env, jencName, tempStr);
@@ -29,7 +29,7 @@ ACL_mutex * ACL_CreateMutex()
     if(NULL!=mutex)
     {
         pthread_mutexattr_init(&attr);
-        pthread_mutexattr_setkind_np(&attr, PTHREAD_MUTEX_RECURSIVE_NP);
+        pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
         if(pthread_mutex_init(&mutex->id, &attr)!=0)
         {
             free(mutex);
@@ -99,9 +99,10 @@ int ACL_RemoveThread(ACL_Thread *t)
 
 int ACL_ThreadJoin(ACL_Thread *thread)
 {
-    int retval;
+    void *retval;
+    // the thread's int return comes back in a pointer
     pthread_join(thread->t, &retval);
-    return retval;
+    return (int)(long)retval;
 }
 
 void ACL_Delay(unsigned int delay)
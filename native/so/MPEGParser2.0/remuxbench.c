@@ -0,0 +1,411 @@
+/*
+ * Copyright 2015 The SageTV Authors. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *  http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+// Remuxer throughput of the two MPEGParser APIs, the JNI functions are called with a stand-in JNIEnv.
+// A TS file is pushed in chunks as MPEGParser.remuxFile does, the output goes over a local socket to a
+// sink thread (the MVP client of RemuxTranscodeEngine).
+// modes: stream - pushRemuxData0, an OutputStream.write upcall for each 8K block. The stand-in copies the
+//                 input array as GetByteArrayElements does and the block again as SocketOutputStream does.
+//        direct - pushRemuxDataDirect0, the output is written into a direct buffer and sent once per push; the
+//                 part of a chunk that isn't taken because the buffer is full is pushed again after the send.
+//        direct16k - direct with a 16K output buffer, smaller than the input chunk.
+// Both direct modes have to give the same output as stream.
+// The cost of the upcall itself into the JVM isn't in this, the counts are printed instead.
+// usage: remuxbench [-m<stream|direct|direct16k>] [-r<ts|ps>] [-c<chunk bytes>] [-o<output buffer bytes>] [-n<passes>] <file>
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <pthread.h>
+#include <jni.h>
+#include "sage_media_format_MPEGParser.h"
+
+#define SOCKET_WRITE_BUF 65536		// SocketOutputStream copies up to this into a native buffer per send
+
+#define SMALL_OUT_SIZE   16384
+
+enum { MODE_STREAM, MODE_DIRECT, MODE_DIRECT_SMALL, MODE_NUM };
+static const char *modeName[] = { "stream", "direct", "direct16k" };
+
+typedef struct
+{
+	int len;
+	unsigned char data[1];
+} FakeArray;
+
+typedef struct
+{
+	void *addr;
+	jlong capacity;
+} FakeDirectBuffer;
+
+typedef struct
+{
+	int fd;
+} FakeStream;
+
+typedef struct
+{
+	unsigned long long upcalls;		// OutputStream.write
+	unsigned long long sends;
+	unsigned long long copied;		// bytes copied by JNI array access and the stream
+} Counters;
+
+static Counters counters;
+
+typedef struct
+{
+	int fd;
+	pthread_t thread;
+	unsigned long long bytes;
+	unsigned long long sum_a, sum_b;	// Fletcher style, the same for any split of the data
+} Sink;
+
+static void* SinkThread( void* arg )
+{
+	Sink *sink = (Sink*)arg;
+	unsigned char buf[65536];
+	unsigned long long a = 0, b = 0;
+	ssize_t n, i;
+	while ( ( n = recv( sink->fd, buf, sizeof(buf), 0 ) ) > 0 )
+	{
+		for ( i = 0; i < n; i++ )
+		{
+			a += buf[i];
+			b += a;
+		}
+		sink->bytes += n;
+	}
+	sink->sum_a = a;
+	sink->sum_b = b;
+	return NULL;
+}
+
+static void SendAll( int fd, const unsigned char *data, int len )
+{
+	while ( len > 0 )
+	{
+		ssize_t n = send( fd, data, len, 0 );
+		if ( n <= 0 )
+		{
+			perror( "send" );
+			exit( 1 );
+		}
+		data += n;
+		len -= n;
+		counters.sends++;
+	}
+}
+
+// stand-in JNIEnv, only what the remuxer functions call
+static jobject JNICALL FakeNewGlobalRef( JNIEnv *env, jobject obj ) { return obj; }
+static void JNICALL FakeDeleteGlobalRef( JNIEnv *env, jobject obj ) { }
+static void JNICALL FakeDeleteLocalRef( JNIEnv *env, jobject obj ) { }
+static jclass JNICALL FakeFindClass( JNIEnv *env, const char *name ) { return (jclass)&counters; }
+static jmethodID JNICALL FakeGetMethodID( JNIEnv *env, jclass clazz, const char *name, const char *sig ) { return (jmethodID)&counters; }
+static jstring JNICALL FakeNewStringUTF( JNIEnv *env, const char *utf ) { return (jstring)strdup( utf ); }
+
+static jint JNICALL FakeThrowNew( JNIEnv *env, jclass clazz, const char *msg )
+{
+	fprintf( stderr, "exception thrown: %s\n", msg );
+	exit( 1 );
+}
+
+static jbyteArray JNICALL FakeNewByteArray( JNIEnv *env, jsize len )
+{
+	FakeArray *array = calloc( 1, sizeof(FakeArray) + len );
+	array->len = len;
+	return (jbyteArray)array;
+}
+
+static void* JNICALL FakeGetPrimitiveArrayCritical( JNIEnv *env, jarray array, jboolean *isCopy )
+{
+	if ( isCopy ) *isCopy = JNI_FALSE;
+	return ((FakeArray*)array)->data;
+}
+
+static void JNICALL FakeReleasePrimitiveArrayCritical( JNIEnv *env, jarray array, void *carray, jint mode ) { }
+static jsize JNICALL FakeGetArrayLength( JNIEnv *env, jarray array ) { return ((FakeArray*)array)->len; }
+
+// HotSpot copies the array out and back (JNI_ABORT drops it)
+static jbyte* JNICALL FakeGetByteArrayElements( JNIEnv *env, jbyteArray array, jboolean *isCopy )
+{
+	FakeArray *a = (FakeArray*)array;
+	jbyte *copy = malloc( a->len );
+	memcpy( copy, a->data, a->len );
+	counters.copied += a->len;
+	if ( isCopy ) *isCopy = JNI_TRUE;
+	return copy;
+}
+
+static void JNICALL FakeReleaseByteArrayElements( JNIEnv *env, jbyteArray array, jbyte *elems, jint mode )
+{
+	free( elems );
+}
+
+// OutputStream.write(byte[], int, int) of a socket stream
+static void JNICALL FakeCallVoidMethod( JNIEnv *env, jobject obj, jmethodID methodID, ... )
+{
+	static unsigned char native_buf[SOCKET_WRITE_BUF];
+	FakeStream *stream = (FakeStream*)obj;
+	FakeArray *array;
+	int offset, len;
+	va_list args;
+	va_start( args, methodID );
+	array = (FakeArray*)va_arg( args, jbyteArray );
+	offset = va_arg( args, jint );
+	len = va_arg( args, jint );
+	va_end( args );
+	counters.upcalls++;
+	while ( len > 0 )
+	{
+		int n = len < SOCKET_WRITE_BUF ? len : SOCKET_WRITE_BUF;
+		memcpy( native_buf, array->data + offset, n );
+		counters.copied += n;
+		SendAll( stream->fd, native_buf, n );
+		offset += n;
+		len -= n;
+	}
+}
+
+static void* JNICALL FakeGetDirectBufferAddress( JNIEnv *env, jobject buf ) { return ((FakeDirectBuffer*)buf)->addr; }
+static jlong JNICALL FakeGetDirectBufferCapacity( JNIEnv *env, jobject buf ) { return ((FakeDirectBuffer*)buf)->capacity; }
+
+static struct JNINativeInterface_ fake_functions;
+
+static JNIEnv* FakeEnv( )
+{
+	static JNIEnv env = &fake_functions;
+	fake_functions.NewGlobalRef = FakeNewGlobalRef;
+	fake_functions.DeleteGlobalRef = FakeDeleteGlobalRef;
+	fake_functions.DeleteLocalRef = FakeDeleteLocalRef;
+	fake_functions.FindClass = FakeFindClass;
+	fake_functions.GetMethodID = FakeGetMethodID;
+	fake_functions.NewStringUTF = FakeNewStringUTF;
+	fake_functions.ThrowNew = FakeThrowNew;
+	fake_functions.NewByteArray = FakeNewByteArray;
+	fake_functions.GetPrimitiveArrayCritical = FakeGetPrimitiveArrayCritical;
+	fake_functions.ReleasePrimitiveArrayCritical = FakeReleasePrimitiveArrayCritical;
+	fake_functions.GetArrayLength = FakeGetArrayLength;
+	fake_functions.GetByteArrayElements = FakeGetByteArrayElements;
+	fake_functions.ReleaseByteArrayElements = FakeReleaseByteArrayElements;
+	fake_functions.CallVoidMethod = FakeCallVoidMethod;
+	fake_functions.GetDirectBufferAddress = FakeGetDirectBufferAddress;
+	fake_functions.GetDirectBufferCapacity = FakeGetDirectBufferCapacity;
+	return &env;
+}
+
+static double Now( )
+{
+	struct timespec ts;
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double CpuSeconds( )
+{
+	struct rusage ru;
+	getrusage( RUSAGE_SELF, &ru );
+	return ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6 + ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6;
+}
+
+// one remux of the file, returns 0 if the format wasn't found
+static int RunRemux( JNIEnv *env, int mode, int remux, FakeArray *file, int chunk, int out_size, int passes, Sink *sink )
+{
+	FakeArray *buf = (FakeArray*)FakeNewByteArray( env, chunk );
+	FakeDirectBuffer out;
+	FakeStream stream;
+	jobject outStream;
+	jlong ptr;
+	jstring format = NULL;
+	int sv[2], offset, pass, n, bytes;
+	double t0, cpu0, wall, cpu;
+
+	if ( mode == MODE_DIRECT_SMALL )
+		out_size = SMALL_OUT_SIZE;
+	if ( socketpair( AF_UNIX, SOCK_STREAM, 0, sv ) < 0 )
+	{
+		perror( "socketpair" );
+		exit( 1 );
+	}
+	memset( sink, 0, sizeof(Sink) );
+	sink->fd = sv[1];
+	pthread_create( &sink->thread, NULL, SinkThread, sink );
+	stream.fd = sv[0];
+	out.capacity = out_size;
+	out.addr = malloc( out_size );
+	outStream = mode == MODE_STREAM ? (jobject)&stream : NULL;
+	memset( &counters, 0, sizeof(counters) );
+
+	ptr = Java_sage_media_format_MPEGParser_openRemuxer0( env, NULL, remux, 0, outStream );
+	for ( offset = 0; ptr && format == NULL && offset < file->len; offset += n )
+	{
+		n = file->len - offset < chunk ? file->len - offset : chunk;
+		memcpy( buf->data, file->data + offset, n );
+		format = Java_sage_media_format_MPEGParser_initRemuxDataDone0( env, NULL, ptr, (jbyteArray)buf, 0, n );
+	}
+	if ( format == NULL )
+	{
+		fprintf( stderr, "no format found in %d bytes\n", offset );
+		if ( ptr ) Java_sage_media_format_MPEGParser_closeRemuxer0( env, NULL, ptr );
+		close( sv[0] );
+		pthread_join( sink->thread, NULL );
+		close( sv[1] );
+		return 0;
+	}
+	Java_sage_media_format_MPEGParser_flushRemuxer0( env, NULL, ptr );
+	memset( &counters, 0, sizeof(counters) );
+
+	t0 = Now( );
+	cpu0 = CpuSeconds( );
+	for ( pass = 0; pass < passes; pass++ )
+	{
+		for ( offset = 0; offset < file->len; offset += n )
+		{
+			n = file->len - offset < chunk ? file->len - offset : chunk;
+			// the pusher reads into its array
+			memcpy( buf->data, file->data + offset, n );
+			if ( mode == MODE_STREAM )
+			{
+				Java_sage_media_format_MPEGParser_pushRemuxData0( env, NULL, ptr, (jbyteArray)buf, 0, n );
+			} else
+			{
+				// input is taken while the buffer has room, the rest is pushed again once the output is sent
+				int taken;
+				for ( taken = 0; taken < n; )
+				{
+					jlong rv = Java_sage_media_format_MPEGParser_pushRemuxDataDirect0( env, NULL, ptr, (jbyteArray)buf,
+									taken, n - taken, (jobject)&out, 0, out_size );
+					taken += (int)( rv >> 32 );
+					SendAll( stream.fd, out.addr, (int)( rv & 0xffffffff ) );
+				}
+			}
+		}
+	}
+	// what the last push kept
+	while ( mode != MODE_STREAM && ( bytes = (int)( Java_sage_media_format_MPEGParser_pushRemuxDataDirect0( env, NULL, ptr,
+								NULL, 0, 0, (jobject)&out, 0, out_size ) & 0xffffffff ) ) > 0 )
+		SendAll( stream.fd, out.addr, bytes );
+	close( sv[0] );
+	pthread_join( sink->thread, NULL );
+	wall = Now( ) - t0;
+	cpu = CpuSeconds( ) - cpu0;
+	close( sv[1] );
+	Java_sage_media_format_MPEGParser_closeRemuxer0( env, NULL, ptr );
+
+	printf( "%-9s %s: %.*s in %.1f MB out %.1f MB, %.1f MB/s, cpu %.1f ms/s of stream (%.1f%%), "
+			"upcalls %.1f/MB sends %.1f/MB copied %.2f MB/MB\n",
+		modeName[mode], remux ? "ps" : "ts", (int)strcspn( (const char*)format + 7, ";" ), (const char*)format + 7,
+		(double)file->len * passes / 1e6, sink->bytes / 1e6,
+		(double)file->len * passes / 1e6 / wall,
+		// a pass is 8*len/20e6 seconds of a 20 Mbps stream
+		cpu * 1000 / ( file->len * 8.0 * passes / 20e6 ), 100 * cpu / wall,
+		counters.upcalls * 1e6 / ( (double)file->len * passes ),
+		counters.sends * 1e6 / ( (double)file->len * passes ),
+		counters.copied / ( (double)file->len * passes ) );
+	free( (void*)format );
+	free( out.addr );
+	free( buf );
+	return 1;
+}
+
+static void Usage( )
+{
+	fprintf( stderr, "usage: remuxbench [-m<stream|direct|direct16k>] [-r<ts|ps>] [-c<chunk bytes>] [-o<output buffer bytes>] [-n<passes>] <file>\n" );
+	exit( 1 );
+}
+
+int main( int argc, char *argv[] )
+{
+	const char *file_name = NULL;
+	int modes[MODE_NUM] = { 1, 1, 1 }, remuxes[2] = { 1, 1 };
+	int chunk = 65536, out_size = 65536, passes = 4;
+	int i, mode, remux, failed = 0;
+	FakeArray *file;
+	FILE *fp;
+	long size;
+	JNIEnv *env = FakeEnv( );
+
+	for ( i = 1; i < argc; i++ )
+	{
+		if ( argv[i][0] != '-' )
+			file_name = argv[i];
+		else if ( argv[i][1] == 'm' )
+		{
+			for ( mode = 0; mode < MODE_NUM; mode++ )
+				modes[mode] = !strcmp( argv[i]+2, modeName[mode] );
+		} else if ( argv[i][1] == 'r' )
+		{
+			remuxes[0] = !strcmp( argv[i]+2, "ts" );
+			remuxes[1] = !strcmp( argv[i]+2, "ps" );
+		} else if ( argv[i][1] == 'c' )
+			chunk = atoi( argv[i]+2 );
+		else if ( argv[i][1] == 'o' )
+			out_size = atoi( argv[i]+2 );
+		else if ( argv[i][1] == 'n' )
+			passes = atoi( argv[i]+2 );
+		else
+			Usage( );
+	}
+	if ( file_name == NULL || chunk <= 0 || out_size < 8192 || passes <= 0 )
+		Usage( );
+
+	if ( ( fp = fopen( file_name, "rb" ) ) == NULL )
+	{
+		perror( file_name );
+		return 1;
+	}
+	fseek( fp, 0, SEEK_END );
+	size = ftell( fp );
+	fseek( fp, 0, SEEK_SET );
+	file = (FakeArray*)FakeNewByteArray( env, (jsize)size );
+	if ( fread( file->data, 1, size, fp ) != (size_t)size )
+	{
+		perror( file_name );
+		return 1;
+	}
+	fclose( fp );
+	printf( "%s %.1f MB, chunk %d, output buffer %d, %d passes\n", file_name, size / 1e6, chunk, out_size, passes );
+
+	for ( remux = 0; remux < 2; remux++ )
+	{
+		Sink sink[MODE_NUM];
+		if ( !remuxes[remux] )
+			continue;
+		for ( mode = 0; mode < MODE_NUM; mode++ )
+		{
+			if ( modes[mode] && !RunRemux( env, mode, remux, file, chunk, out_size, passes, &sink[mode] ) )
+				return 1;
+		}
+		for ( mode = MODE_DIRECT; mode < MODE_NUM; mode++ )
+		{
+			int same;
+			if ( !modes[MODE_STREAM] || !modes[mode] )
+				continue;
+			same = sink[0].bytes == sink[mode].bytes && sink[0].sum_a == sink[mode].sum_a && sink[0].sum_b == sink[mode].sum_b;
+			printf( "%s %s output %s\n", remux ? "ps" : "ts", modeName[mode], same ? "identical" : "DIFFERS" );
+			failed |= !same;
+		}
+	}
+	free( file );
+	return failed;
+}
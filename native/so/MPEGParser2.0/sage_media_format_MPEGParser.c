@@ -21,6 +21,8 @@
 #include "sage_media_format_MPEGParser.h"
 
 #include "TSSplitter.h"
+#include "GetAVInf.h"
+#include "LiveDuration.h"
 #include <time.h>
 //ZQ
 #ifdef __cplusplus
@@ -78,14 +80,26 @@ static void _flog_check()
 	}
 }
 
-#ifdef __cplusplus
-extern "C" {
-#endif
-int  GetAVFormat( char* FileName, unsigned long CheckSize, int bLiveFile, int RequestedTSProgram,
-			   char* FormatBuf, int FormatSize, char* DurationBuf, int DurationSize, int* Program );
-#ifdef __cplusplus
+//AV-INF string of a probe result, ret is the channel as GetMediaAVFormat returns
+static void MediaAVInfString( char* buf, int size, int ret, int TotalProgramNum, char* Format, char* Duration )
+{
+	if ( ret >= 0 ) ret--; //ret is actual channel number; change range is 0..n; in GetAVFormat is 1...n+1
+	if ( strstr(  Format, "ENCRYPTED-TS;" ) ) 
+	{
+		snprintf( buf, size, "Ret:%d Program:%d Format:AV-INF|f=%s", ret, TotalProgramNum, Duration, Format );
+	} else
+	if ( strstr( Format, "UNKNOWN-TS;"  ) || strstr( Format, "UNKNOWN-PS;"  ) || strstr(  Format, "NO-AV-TS;" ) )
+	{
+		buf[0] = 0x0;
+	} else
+	if (  strlen( Format )+strlen( Duration )+64 < size )
+	{
+		snprintf( buf, size, "Ret:%d Program:%d Duration:%s Format:AV-INF|f=%s", ret, TotalProgramNum, Duration, Format );
+	}
+	else
+		buf[0] = 0x0;
 }
-#endif
+
 /*
  * Class:     sage_media_format_MPEGParser
  * Method:    getMediaAVInf0
@@ -97,70 +111,117 @@ JNIEXPORT jstring JNICALL Java_sage_media_format_MPEGParser_getMediaAVInf0
 	const char* szFilename = (*env)->GetStringUTFChars(env, jFilename, NULL);
 	char Format[2048], Duration[32];
 	char buf[2048 + 128]; // bigger than Format + Duration in size
-	int  LiveFile = LiveFile ? 1 : 0;
-	int  TotalProgramNum=0, Channel;
+	int  LiveFile = jLiveFile ? 1 : 0;
+	int  TotalProgramNum=0;
 	int  ret;
 	memset(Format, 0, sizeof(Format));
 	memset(Duration, 0, sizeof(Duration));
 	memset(buf, 0, sizeof(buf));
-	Channel = (int)jChannel;
-
-	//get specified channel MedAVInf
-	if ( Channel >= 0 )
-	{
-		ret = GetAVFormat( (char*)szFilename, (unsigned long)jSearchSize, LiveFile , Channel+1,
-				            Format, sizeof(Format), Duration, sizeof(Duration), &TotalProgramNum  );
-
-	} else
-	{ //Search first one valid channel MedAVInf
 
-		Channel = 0;
-		do {
-			ret = GetAVFormat((char*)szFilename, (unsigned long)jSearchSize, LiveFile, Channel+1,
-				          Format, sizeof(Format), Duration, sizeof(Duration), &TotalProgramNum );
+	//get specified channel MedAVInf, or search first one valid channel if channel is -1
+	//a file in recording is polled for its duration, only data appended since last call are read
+	if ( LiveFile )
+		ret = GetLiveMediaAVFormat( (char*)szFilename, (unsigned long)jSearchSize, (int)jChannel,
+				                    Format, sizeof(Format), Duration, sizeof(Duration), &TotalProgramNum  );
+	else
+		ret = GetMediaAVFormat( (char*)szFilename, (unsigned long)jSearchSize, LiveFile, (int)jChannel,
+				                Format, sizeof(Format), Duration, sizeof(Duration), &TotalProgramNum  );
+	(*env)->ReleaseStringUTFChars(env, jFilename, szFilename);
+	MediaAVInfString( buf, sizeof(buf), ret, TotalProgramNum, Format, Duration );
 
-			if ( Format[0] == 0x0 || strstr(  Format, "ENCRYPTED;" ) || strstr( Format, "NO-DATA;" ) ||
-				  strstr( Format, "UNKNOWN-TS;"  ) || strstr( Format, "UNKNOWN-PS;"  ) || strstr(  Format, "NO-AV-TS;" ) )
-				Channel++;
-			else
-				break;
+	flog(("Native.log", "GetAVFormat:%s\r\n", buf));
+	jstring jstr;
+	jstr = (*env)->NewStringUTF(env, buf);
+	return jstr;
 
-		} while( Channel < TotalProgramNum );
+}
 
-	}
-	(*env)->ReleaseStringUTFChars(env, jFilename, szFilename);
-	if ( ret >= 0 ) ret--; //ret is actual channel number; change range is 0..n; in GetAVFormat is 1...n+1
-	if ( strstr(  Format, "ENCRYPTED-TS;" ) ) 
-	{
-		sprintf( buf, "Ret:%d Program:%d Format:AV-INF|f=%s", ret, TotalProgramNum, Duration, Format );
-	} else
-	if ( strstr( Format, "UNKNOWN-TS;"  ) || strstr( Format, "UNKNOWN-PS;"  ) || strstr(  Format, "NO-AV-TS;" ) )
+/*
+ * Class:     sage_media_format_MPEGParser
+ * Method:    getMediaAVInfBatch0
+ * Signature: ([Ljava/lang/String;[J[ZJI)[Ljava/lang/String;
+ */
+JNIEXPORT jobjectArray JNICALL Java_sage_media_format_MPEGParser_getMediaAVInfBatch0
+  (JNIEnv *env, jclass jo, jobjectArray jFilenames, jlongArray jSearchSizes, jbooleanArray jLiveFiles, jlong jChannel, jint jThreads )
+{
+	static char no_name[1]={0};
+	AVINF_BATCH_ITEM* items;
+	jlong* search_size;
+	jboolean* live_file;
+	jobjectArray jret;
+	jstring jstr;
+	char buf[2048 + 128];
+	int  num, i, threads;
+
+	num = (*env)->GetArrayLength(env, jFilenames);
+	if ( (*env)->GetArrayLength(env, jSearchSizes) < num || (*env)->GetArrayLength(env, jLiveFiles) < num )
+		return NULL;
+	jret = (*env)->NewObjectArray(env, num, (*env)->FindClass(env, "java/lang/String"), NULL);
+	if ( jret == NULL || num == 0 )
+		return jret;
+	items = (AVINF_BATCH_ITEM*)calloc( num, sizeof(AVINF_BATCH_ITEM) );
+	search_size = (jlong*)malloc( num*sizeof(jlong) );
+	live_file = (jboolean*)malloc( num*sizeof(jboolean) );
+	if ( items == NULL || search_size == NULL || live_file == NULL )
 	{
-		buf[0] = 0x0;
-	} else
-	if (  strlen( Format )+strlen( Duration )+64 < sizeof(buf) )
+		free( items );
+		free( search_size );
+		free( live_file );
+		return NULL;
+	}
+	(*env)->GetLongArrayRegion(env, jSearchSizes, 0, num, search_size);
+	(*env)->GetBooleanArrayRegion(env, jLiveFiles, 0, num, live_file);
+
+	//file names are taken out before workers start, JNIEnv can't be used on worker threads
+	for ( i = 0; i<num; i++ )
 	{
-		sprintf( buf, "Ret:%d Program:%d Duration:%s Format:AV-INF|f=%s", ret, TotalProgramNum, Duration, Format );
+		jstr = (jstring)(*env)->GetObjectArrayElement(env, jFilenames, i);
+		items[i].file_name = no_name;
+		if ( jstr != NULL )
+		{
+			const char* name = (*env)->GetStringUTFChars(env, jstr, NULL);
+			if ( name != NULL )
+				items[i].file_name = (char*)name;
+			(*env)->DeleteLocalRef(env, jstr);
+		}
+		items[i].check_size = (unsigned long)search_size[i];
+		items[i].stream_data = live_file[i] ? 1 : 0;
+		items[i].channel = (int)jChannel;
 	}
-	else
-		buf[0] = 0x0;
 
-	flog(("Native.log", "GetAVFormat:%s\r\n", buf));
-	jstring jstr;
-	jstr = (*env)->NewStringUTF(env, buf);
-	return jstr;
+	threads = GetMediaAVFormatBatch( items, num, (int)jThreads );
+	flog(("Native.log", "GetAVFormat batch of %d files, threads:%d\r\n", num, threads));
 
+	for ( i = 0; i<num; i++ )
+	{
+		MediaAVInfString( buf, sizeof(buf), items[i].ret, items[i].total_channel, items[i].format, items[i].duration );
+		jstr = (*env)->NewStringUTF(env, buf);
+		(*env)->SetObjectArrayElement(env, jret, i, jstr);
+		(*env)->DeleteLocalRef(env, jstr);
+		if ( items[i].file_name != no_name )
+		{
+			jstr = (jstring)(*env)->GetObjectArrayElement(env, jFilenames, i);
+			(*env)->ReleaseStringUTFChars(env, jstr, items[i].file_name);
+			(*env)->DeleteLocalRef(env, jstr);
+		}
+	}
+	free( items );
+	free( search_size );
+	free( live_file );
+	return jret;
 }
 
 
 typedef struct
 {
 	TSSPLT *pSplt;
-	jobject outStream;
+	jobject outStream;	//NULL with direct output
 	jbyteArray outBuf;
 	int outBufSize;
 	unsigned long bytes_in, bytes_out;
 	int  rebuiltTSPMT;
+	unsigned char* spill;	//direct output of a parse step that didn't fit, goes out first next call
+	int spill_size, spill_bytes, spill_pos;
 } JavaRemuxer;
 
 #define TS_BUFFER_PACKETS   24
@@ -173,7 +234,18 @@ typedef struct
 	
 } CXT;
 
+//direct output, the remuxer writes into the region of a direct ByteBuffer given with the data
+typedef struct
+{
+	JavaRemuxer* jr;
+	unsigned char* out;
+	int out_size;
+	int out_bytes;
+	int spilling;		//the block handed out is in jr->spill
+} DIRECT_CXT;
+
 #define REMUX_BUFFER_SIZE 8192
+#define REMUX_PARSE_STEP  (188*3)	//PushData2 parses this much before it pops output
 
 
 //following code is used only by  RemuxTranscodeEngine for a Hauppauge MVP, so I have to keep it here
@@ -190,12 +262,15 @@ JNIEXPORT jlong JNICALL Java_sage_media_format_MPEGParser_openRemuxer0
 		return 0;
 	JavaRemuxer* rv = (JavaRemuxer*)malloc(sizeof(JavaRemuxer));
 	rv->pSplt = pSplt;
-	rv->outStream = (*env)->NewGlobalRef(env, outputStreamCallback);
-	rv->outBuf = (jbyteArray) (*env)->NewGlobalRef(env, (*env)->NewByteArray(env, REMUX_BUFFER_SIZE));
+	//no stream opens it for direct output, pushRemuxDataDirect0
+	rv->outStream = outputStreamCallback ? (*env)->NewGlobalRef(env, outputStreamCallback) : NULL;
+	rv->outBuf = outputStreamCallback ? (jbyteArray) (*env)->NewGlobalRef(env, (*env)->NewByteArray(env, REMUX_BUFFER_SIZE)) : NULL;
 	rv->outBufSize = REMUX_BUFFER_SIZE;
 	rv->bytes_in  = 0;
 	rv->bytes_out = 0;
 	rv->rebuiltTSPMT = false;
+	rv->spill = NULL;
+	rv->spill_size = rv->spill_bytes = rv->spill_pos = 0;
 	SelectTSChannel(pSplt, (unsigned short) channel+1, true );
 	return PTR_TO_INT64(jlong,rv);
 }
@@ -211,12 +286,21 @@ JNIEXPORT void JNICALL Java_sage_media_format_MPEGParser_closeRemuxer0
 	if (!ptr) return;
 	JavaRemuxer* jr = INT64_TO_PTR(JavaRemuxer*,ptr);
 	CloseTSSplitter(jr->pSplt);
-	(*env)->DeleteGlobalRef(env, jr->outBuf);
-	(*env)->DeleteGlobalRef(env, jr->outStream);
+	if (jr->outStream)
+	{
+		(*env)->DeleteGlobalRef(env, jr->outBuf);
+		(*env)->DeleteGlobalRef(env, jr->outStream);
+	}
+	free(jr->spill);
 	free(jr);
 }
 
 
+static void ThrowRemuxer( JNIEnv *env, const char* pClass, const char* pMessage )
+{
+	(*env)->ThrowNew(env, (*env)->FindClass(env, pClass), pMessage);
+}
+
 int OutputDump( void* pContext, const unsigned char* pData, int lDataLen )
 {
 	CXT* cxt = (CXT*)pContext;
@@ -261,6 +345,11 @@ JNIEXPORT jlong JNICALL Java_sage_media_format_MPEGParser_pushRemuxData0
 #else
 	if (!ptr) return 0;
 	JavaRemuxer* jr = INT64_TO_PTR(JavaRemuxer*,ptr);
+	if ( jr->outStream == NULL )
+	{
+		ThrowRemuxer( env, "java/lang/IllegalStateException", "direct remuxer, use pushRemuxDataDirect0" );
+		return 0;
+	}
 	// Get the native data. Don't use 'critical' access because we make callbacks into Java
 	// while we're processing this data.
 	jbyte* newData = (*env)->GetByteArrayElements(env, javabuf, NULL);
@@ -296,6 +385,143 @@ JNIEXPORT jlong JNICALL Java_sage_media_format_MPEGParser_pushRemuxData0
 #endif
 }
 
+//hands out the free part of the output region, REMUX_BUFFER_SIZE at a time as the stream output gets it so
+//that the output is the same. It never fails, the splitter would drop packets: once the region is short of
+//a block the rest of the parse step goes into the spill buffer, and no more input is taken.
+static int DirectAllocOutputBuffer( void* pContext, unsigned char** pData, int cmd )
+{
+	DIRECT_CXT* cxt = (DIRECT_CXT*)pContext;
+	JavaRemuxer* jr = cxt->jr;
+	*pData = NULL;
+	if ( cmd != 0 )
+		return 0;
+	if ( jr->spill_bytes == 0 && cxt->out_size - cxt->out_bytes >= REMUX_BUFFER_SIZE )
+	{
+		cxt->spilling = 0;
+		*pData = cxt->out + cxt->out_bytes;
+		return REMUX_BUFFER_SIZE;
+	}
+	if ( jr->spill_bytes + REMUX_BUFFER_SIZE > jr->spill_size )
+	{
+		unsigned char* spill = (unsigned char*)realloc( jr->spill, jr->spill_bytes + REMUX_BUFFER_SIZE );
+		if ( spill == NULL )
+			return 0;
+		jr->spill = spill;
+		jr->spill_size = jr->spill_bytes + REMUX_BUFFER_SIZE;
+	}
+	cxt->spilling = 1;
+	*pData = jr->spill + jr->spill_bytes;
+	return REMUX_BUFFER_SIZE;
+}
+
+static int DirectOutputDump( void* pContext, const unsigned char* pData, int lDataLen )
+{
+	DIRECT_CXT* cxt = (DIRECT_CXT*)pContext;
+	if ( cxt->spilling )
+		cxt->jr->spill_bytes += lDataLen;
+	else
+		cxt->out_bytes += lDataLen;
+	cxt->jr->bytes_out += lDataLen;
+	return lDataLen;
+}
+
+/*
+ * Class:     sage_media_format_MPEGParser
+ * Method:    pushRemuxDataDirect0
+ * Signature: (J[BIILjava/nio/ByteBuffer;II)J
+ */
+JNIEXPORT jlong JNICALL Java_sage_media_format_MPEGParser_pushRemuxDataDirect0
+  (JNIEnv *env, jclass jc, jlong ptr, jbyteArray javabuf, jint offset, jint length, jobject outBuffer, jint outOffset, jint outLength)
+{
+#ifdef NO_MEDIA_MVP
+	return 0;
+#else
+	if (!ptr) return 0;
+	JavaRemuxer* jr = INT64_TO_PTR(JavaRemuxer*,ptr);
+	unsigned char* out;
+	jlong capacity;
+	jbyte* newData = NULL;
+	int consumed = 0, bytes;
+	DIRECT_CXT cxt;
+
+	if ( jr->outStream != NULL )
+	{
+		ThrowRemuxer( env, "java/lang/IllegalStateException", "stream remuxer, use pushRemuxData0" );
+		return 0;
+	}
+	if ( outBuffer == NULL || ( out = (unsigned char*)(*env)->GetDirectBufferAddress(env, outBuffer) ) == NULL )
+	{
+		ThrowRemuxer( env, "java/lang/IllegalArgumentException", "output isn't a direct ByteBuffer" );
+		return 0;
+	}
+	capacity = (*env)->GetDirectBufferCapacity(env, outBuffer);
+	if ( outOffset < 0 || outLength < 0 || (jlong)outOffset + outLength > capacity )
+	{
+		ThrowRemuxer( env, "java/lang/IndexOutOfBoundsException", "output region is out of the ByteBuffer" );
+		return 0;
+	}
+	if ( javabuf != NULL && ( offset < 0 || length < 0 || (jlong)offset + length > (*env)->GetArrayLength(env, javabuf) ) )
+	{
+		ThrowRemuxer( env, "java/lang/IndexOutOfBoundsException", "input region is out of the array" );
+		return 0;
+	}
+	if ( javabuf != NULL && length > 0 && outLength < REMUX_BUFFER_SIZE )
+	{
+		ThrowRemuxer( env, "java/lang/IllegalArgumentException", "output region is less than 8K" );
+		return 0;
+	}
+	cxt.jr = jr; cxt.out = out + outOffset; cxt.out_size = outLength; cxt.out_bytes = 0; cxt.spilling = 0;
+
+	// what was spilled by the last call goes out first
+	bytes = jr->spill_bytes - jr->spill_pos;
+	if ( bytes > outLength ) bytes = outLength;
+	if ( bytes > 0 )
+	{
+		memcpy( cxt.out, jr->spill + jr->spill_pos, bytes );
+		cxt.out_bytes = bytes;
+		jr->spill_pos += bytes;
+	}
+	if ( jr->spill_pos == jr->spill_bytes )
+		jr->spill_bytes = jr->spill_pos = 0;
+
+	// No callbacks into Java while the data are processed, 'critical' access doesn't copy them.
+	// Input is taken a parse step at a time, as PushData2 does, while the region has room for a block;
+	// the caller pushes the rest again once it has sent the output.
+	if ( javabuf != NULL && length > 0 )
+		newData = (jbyte*)(*env)->GetPrimitiveArrayCritical(env, javabuf, NULL);
+	if ( newData != NULL )
+	{
+		while ( consumed < length && jr->spill_bytes == 0 && outLength - cxt.out_bytes >= REMUX_BUFFER_SIZE )
+		{
+			int step = length - consumed < REMUX_PARSE_STEP ? length - consumed : REMUX_PARSE_STEP;
+			PushData2( jr->pSplt, (const unsigned char*)(newData + offset + consumed), step,
+					   DirectAllocOutputBuffer, &cxt, (OUTPUT_DUMP)DirectOutputDump, &cxt );
+			consumed += step;
+		}
+		(*env)->ReleasePrimitiveArrayCritical(env, javabuf, newData, JNI_ABORT);
+		jr->bytes_in += consumed;
+	}
+	// input bytes taken in the high word, output bytes written in the low word
+	return ( (jlong)consumed << 32 ) | (jlong)cxt.out_bytes;
+#endif
+}
+
+/*
+ * Class:     sage_media_format_MPEGParser
+ * Method:    getRemuxLastPTS0
+ * Signature: (J)J
+ */
+JNIEXPORT jlong JNICALL Java_sage_media_format_MPEGParser_getRemuxLastPTS0
+  (JNIEnv *env, jclass jc, jlong ptr)
+{
+#ifdef NO_MEDIA_MVP
+	return 0;
+#else
+	if (!ptr) return 0;
+	return (jlong) GetLastPTS(INT64_TO_PTR(JavaRemuxer*,ptr)->pSplt);
+#endif
+}
+
 /*
  * Class:     sage_media_format_MPEGParser
  * Method:    initRemuxDataDone0
@@ -353,6 +579,7 @@ JNIEXPORT void JNICALL Java_sage_media_format_MPEGParser_flushRemuxer0
 	if (!ptr) return;
 	JavaRemuxer* jr = INT64_TO_PTR(JavaRemuxer*,ptr);
 	FlushPush(jr->pSplt);
+	jr->spill_bytes = jr->spill_pos = 0;
 #endif
 }
 
@@ -19,6 +19,14 @@ extern "C" {
 JNIEXPORT jstring JNICALL Java_sage_media_format_MPEGParser_getMediaAVInf0
   (JNIEnv *, jclass, jstring, jlong, jboolean, jlong);
 
+/*
+ * Class:     sage_media_format_MPEGParser
+ * Method:    getMediaAVInfBatch0
+ * Signature: ([Ljava/lang/String;[J[ZJI)[Ljava/lang/String;
+ */
+JNIEXPORT jobjectArray JNICALL Java_sage_media_format_MPEGParser_getMediaAVInfBatch0
+  (JNIEnv *, jclass, jobjectArray, jlongArray, jbooleanArray, jlong, jint);
+
 /*
  * Class:     sage_media_format_MPEGParser
  * Method:    openRemuxer0
@@ -43,6 +51,22 @@ JNIEXPORT void JNICALL Java_sage_media_format_MPEGParser_closeRemuxer0
 JNIEXPORT jlong JNICALL Java_sage_media_format_MPEGParser_pushRemuxData0
   (JNIEnv *, jclass, jlong, jbyteArray, jint, jint);
 
+/*
+ * Class:     sage_media_format_MPEGParser
+ * Method:    pushRemuxDataDirect0
+ * Signature: (J[BIILjava/nio/ByteBuffer;II)J
+ */
+JNIEXPORT jlong JNICALL Java_sage_media_format_MPEGParser_pushRemuxDataDirect0
+  (JNIEnv *, jclass, jlong, jbyteArray, jint, jint, jobject, jint, jint);
+
+/*
+ * Class:     sage_media_format_MPEGParser
+ * Method:    getRemuxLastPTS0
+ * Signature: (J)J
+ */
+JNIEXPORT jlong JNICALL Java_sage_media_format_MPEGParser_getRemuxLastPTS0
+  (JNIEnv *, jclass, jlong);
+
 /*
  * Class:     sage_media_format_MPEGParser
  * Method:    initRemuxDataDone0
@@ -32,8 +32,23 @@
 
 #include "hdhomerun.h"
 
+#if defined(__linux__) && defined(_GNU_SOURCE) && defined(MSG_WAITFORONE)
+#define HDHOMERUN_VIDEO_RECVMMSG
+#define VIDEO_RECV_BATCH_DEFAULT VIDEO_RECV_BATCH_MAX
+#else
+#define VIDEO_RECV_BATCH_DEFAULT 1
+#endif
+
+#define VIDEO_RTP_HEADER_SIZE (VIDEO_RTP_DATA_PACKET_SIZE - VIDEO_DATA_PACKET_SIZE)
+
 struct hdhomerun_video_sock_t {
 	pthread_mutex_t lock;
+#if !defined(__WINDOWS__)
+	pthread_cond_t cond;
+#endif
+	size_t notify_watermark;
+	uint32_t waiting;
+	volatile int recv_batch;
 	uint8_t *buffer;
 	size_t buffer_size;
 	volatile size_t head;
@@ -65,7 +80,12 @@ struct hdhomerun_video_sock_t *hdhomerun_video_create(uint16_t listen_port, size
 
 	vs->dbg = dbg;
 	vs->sock = -1;
+	vs->notify_watermark = VIDEO_DATA_PACKET_SIZE;
+	vs->recv_batch = VIDEO_RECV_BATCH_DEFAULT;
 	pthread_mutex_init(&vs->lock, NULL);
+#if !defined(__WINDOWS__)
+	pthread_cond_init(&vs->cond, NULL);
+#endif
 
 	/* Reset sequence tracking. */
 	hdhomerun_video_flush(vs);
@@ -127,18 +147,29 @@ error:
 	if (vs->buffer) {
 		free(vs->buffer);
 	}
+#if !defined(__WINDOWS__)
+	pthread_cond_destroy(&vs->cond);
+#endif
 	free(vs);
 	return NULL;
 }
 
 void hdhomerun_video_destroy(struct hdhomerun_video_sock_t *vs)
 {
+	pthread_mutex_lock(&vs->lock);
 	vs->terminate = TRUE;
+#if !defined(__WINDOWS__)
+	pthread_cond_broadcast(&vs->cond);
+#endif
+	pthread_mutex_unlock(&vs->lock);
 	pthread_join(vs->thread, NULL);
 
 	close(vs->sock);
 	free(vs->buffer);
 
+#if !defined(__WINDOWS__)
+	pthread_cond_destroy(&vs->cond);
+#endif
 	free(vs);
 }
 
@@ -187,11 +218,9 @@ static void hdhomerun_video_stats_ts_pkt(struct hdhomerun_video_sock_t *vs, uint
 	vs->sequence[packet_identifier] = continuity_counter;
 }
 
-static void hdhomerun_video_parse_rtp(struct hdhomerun_video_sock_t *vs, struct hdhomerun_pkt_t *pkt)
+static void hdhomerun_video_parse_rtp(struct hdhomerun_video_sock_t *vs, const uint8_t *ptr)
 {
-	pkt->pos += 2;
-	uint32_t rtp_sequence = hdhomerun_pkt_read_u16(pkt);
-	pkt->pos += 8;
+	uint32_t rtp_sequence = ((uint32_t)ptr[2] << 8) | (uint32_t)ptr[3];
 
 	if (rtp_sequence != ((vs->rtp_sequence + 1) & 0xFFFF)) {
 		if (vs->rtp_sequence != 0xFFFFFFFF) {
@@ -205,73 +234,150 @@ static void hdhomerun_video_parse_rtp(struct hdhomerun_video_sock_t *vs, struct
 	vs->rtp_sequence = rtp_sequence;
 }
 
-static THREAD_FUNC_PREFIX hdhomerun_video_thread_execute(void *arg)
+/* Bytes received and not yet returned by hdhomerun_video_recv. Lock must be held. */
+static size_t hdhomerun_video_pending(struct hdhomerun_video_sock_t *vs)
 {
-	struct hdhomerun_video_sock_t *vs = (struct hdhomerun_video_sock_t *)arg;
-	struct hdhomerun_pkt_t pkt_inst;
+	size_t head = vs->head;
+	size_t tail = vs->tail + vs->advance;
+	if (tail >= vs->buffer_size) {
+		tail -= vs->buffer_size;
+	}
 
-	while (!vs->terminate) {
-		struct hdhomerun_pkt_t *pkt = &pkt_inst;
-		hdhomerun_pkt_reset(pkt);
+	if (head >= tail) {
+		return head - tail;
+	}
+	return vs->buffer_size - tail + head;
+}
 
-		/* Receive. */
-		int length = recv(vs->sock, (char *)pkt->end, VIDEO_RTP_DATA_PACKET_SIZE, 0);
-		pkt->end += length;
+/* Store one packet in the ring buffer. Lock must be held. */
+static void hdhomerun_video_store(struct hdhomerun_video_sock_t *vs, const uint8_t *data)
+{
+	size_t head = vs->head;
+	uint8_t *ptr = vs->buffer + head;
+	memcpy(ptr, data, VIDEO_DATA_PACKET_SIZE);
+
+	/* Stats. */
+	vs->packet_count++;
+	hdhomerun_video_stats_ts_pkt(vs, ptr + TS_PACKET_SIZE * 0);
+	hdhomerun_video_stats_ts_pkt(vs, ptr + TS_PACKET_SIZE * 1);
+	hdhomerun_video_stats_ts_pkt(vs, ptr + TS_PACKET_SIZE * 2);
+	hdhomerun_video_stats_ts_pkt(vs, ptr + TS_PACKET_SIZE * 3);
+	hdhomerun_video_stats_ts_pkt(vs, ptr + TS_PACKET_SIZE * 4);
+	hdhomerun_video_stats_ts_pkt(vs, ptr + TS_PACKET_SIZE * 5);
+	hdhomerun_video_stats_ts_pkt(vs, ptr + TS_PACKET_SIZE * 6);
+
+	/* Calculate new head. */
+	head += VIDEO_DATA_PACKET_SIZE;
+	if (head >= vs->buffer_size) {
+		head -= vs->buffer_size;
+	}
+
+	/* Check for buffer overflow. */
+	if (head == vs->tail) {
+		vs->overflow_error_count++;
+		return;
+	}
+
+	/* Atomic update. */
+	vs->head = head;
+}
+
+/* Wake a hdhomerun_video_wait caller once the watermark is reached. Lock must be held. */
+static void hdhomerun_video_notify(struct hdhomerun_video_sock_t *vs)
+{
+#if !defined(__WINDOWS__)
+	if (vs->waiting && (vs->terminate || (hdhomerun_video_pending(vs) >= vs->notify_watermark))) {
+		pthread_cond_signal(&vs->cond);
+	}
+#endif
+}
 
-		if (length == VIDEO_RTP_DATA_PACKET_SIZE) {
-			hdhomerun_video_parse_rtp(vs, pkt);
-			length = (int)(pkt->end - pkt->pos);
+/*
+ * Receive up to count datagrams, count is 1 unless recvmmsg is available.
+ * Returns the number of datagrams received, or -1 on error.
+ */
+static int hdhomerun_video_recv_datagrams(struct hdhomerun_video_sock_t *vs, uint8_t data[][VIDEO_RTP_DATA_PACKET_SIZE], int *lengths, int count)
+{
+#if defined(HDHOMERUN_VIDEO_RECVMMSG)
+	if (count > 1) {
+		struct mmsghdr msgs[VIDEO_RECV_BATCH_MAX];
+		struct iovec iov[VIDEO_RECV_BATCH_MAX];
+		memset(msgs, 0, sizeof(struct mmsghdr) * count);
+
+		int i;
+		for (i = 0; i < count; i++) {
+			iov[i].iov_base = data[i];
+			iov[i].iov_len = VIDEO_RTP_DATA_PACKET_SIZE;
+			msgs[i].msg_hdr.msg_iov = &iov[i];
+			msgs[i].msg_hdr.msg_iovlen = 1;
 		}
 
-		if (length != VIDEO_DATA_PACKET_SIZE) {
-			if (length > 0) {
-				/* Data received but not valid - ignore. */
-				continue;
-			}
+		/* Block for the first datagram, then take what is already queued. */
+		int received = recvmmsg(vs->sock, msgs, count, MSG_WAITFORONE, NULL);
+		for (i = 0; i < received; i++) {
+			lengths[i] = (int)msgs[i].msg_len;
+		}
+		return received;
+	}
+#endif
+
+	int length = recv(vs->sock, (char *)data[0], VIDEO_RTP_DATA_PACKET_SIZE, 0);
+	if (length < 0) {
+		return -1;
+	}
+	lengths[0] = length;
+	return 1;
+}
+
+static THREAD_FUNC_PREFIX hdhomerun_video_thread_execute(void *arg)
+{
+	struct hdhomerun_video_sock_t *vs = (struct hdhomerun_video_sock_t *)arg;
+	uint8_t data[VIDEO_RECV_BATCH_MAX][VIDEO_RTP_DATA_PACKET_SIZE];
+	int lengths[VIDEO_RECV_BATCH_MAX];
+
+	while (!vs->terminate) {
+		/* Receive. */
+		int count = hdhomerun_video_recv_datagrams(vs, data, lengths, vs->recv_batch);
+		if (count < 0) {
 			if (sock_getlasterror_socktimeout) {
 				/* Wait for more data. */
 				continue;
 			}
-			vs->terminate = TRUE;
-			return NULL;
+			break;
 		}
 
 		pthread_mutex_lock(&vs->lock);
 
-		/* Store in ring buffer. */
-		size_t head = vs->head;
-		uint8_t *ptr = vs->buffer + head;
-		memcpy(ptr, pkt->pos, length);
-
-		/* Stats. */
-		vs->packet_count++;
-		hdhomerun_video_stats_ts_pkt(vs, ptr + TS_PACKET_SIZE * 0);
-		hdhomerun_video_stats_ts_pkt(vs, ptr + TS_PACKET_SIZE * 1);
-		hdhomerun_video_stats_ts_pkt(vs, ptr + TS_PACKET_SIZE * 2);
-		hdhomerun_video_stats_ts_pkt(vs, ptr + TS_PACKET_SIZE * 3);
-		hdhomerun_video_stats_ts_pkt(vs, ptr + TS_PACKET_SIZE * 4);
-		hdhomerun_video_stats_ts_pkt(vs, ptr + TS_PACKET_SIZE * 5);
-		hdhomerun_video_stats_ts_pkt(vs, ptr + TS_PACKET_SIZE * 6);
-
-		/* Calculate new head. */
-		head += length;
-		if (head >= vs->buffer_size) {
-			head -= vs->buffer_size;
-		}
+		int i;
+		for (i = 0; i < count; i++) {
+			uint8_t *ptr = data[i];
+			int length = lengths[i];
 
-		/* Check for buffer overflow. */
-		if (head == vs->tail) {
-			vs->overflow_error_count++;
-			pthread_mutex_unlock(&vs->lock);
-			continue;
+			if (length == VIDEO_RTP_DATA_PACKET_SIZE) {
+				hdhomerun_video_parse_rtp(vs, ptr);
+				ptr += VIDEO_RTP_HEADER_SIZE;
+				length -= VIDEO_RTP_HEADER_SIZE;
+			}
+
+			if (length != VIDEO_DATA_PACKET_SIZE) {
+				/* Data received but not valid - ignore. */
+				continue;
+			}
+
+			hdhomerun_video_store(vs, ptr);
 		}
 
-		/* Atomic update. */
-		vs->head = head;
+		/* One wakeup per batch. */
+		hdhomerun_video_notify(vs);
 
 		pthread_mutex_unlock(&vs->lock);
 	}
 
+	pthread_mutex_lock(&vs->lock);
+	vs->terminate = TRUE;
+	hdhomerun_video_notify(vs);
+	pthread_mutex_unlock(&vs->lock);
+
 	return NULL;
 }
 
@@ -324,6 +430,84 @@ uint8_t *hdhomerun_video_recv(struct hdhomerun_video_sock_t *vs, size_t max_size
 	return result;
 }
 
+void hdhomerun_video_set_notify(struct hdhomerun_video_sock_t *vs, size_t watermark)
+{
+	pthread_mutex_lock(&vs->lock);
+
+	if (watermark < VIDEO_DATA_PACKET_SIZE) {
+		watermark = VIDEO_DATA_PACKET_SIZE;
+	}
+	if (watermark > vs->buffer_size - VIDEO_DATA_PACKET_SIZE) {
+		watermark = vs->buffer_size - VIDEO_DATA_PACKET_SIZE;
+	}
+	vs->notify_watermark = watermark;
+
+	/* Waiters re-check against the new watermark. */
+	hdhomerun_video_notify(vs);
+
+	pthread_mutex_unlock(&vs->lock);
+}
+
+void hdhomerun_video_set_recv_batch(struct hdhomerun_video_sock_t *vs, int count)
+{
+	if (count < 1) {
+		count = 1;
+	}
+	if (count > VIDEO_RECV_BATCH_MAX) {
+		count = VIDEO_RECV_BATCH_MAX;
+	}
+	vs->recv_batch = count;
+}
+
+size_t hdhomerun_video_wait(struct hdhomerun_video_sock_t *vs, uint64_t max_wait_ms)
+{
+	pthread_mutex_lock(&vs->lock);
+
+	size_t pending = hdhomerun_video_pending(vs);
+	if ((pending >= vs->notify_watermark) || vs->terminate || (max_wait_ms == 0)) {
+		pthread_mutex_unlock(&vs->lock);
+		return pending;
+	}
+
+#if defined(__WINDOWS__)
+	/* No condition variables, poll. */
+	uint64_t stop_time = getcurrenttime() + max_wait_ms;
+	while ((pending < vs->notify_watermark) && !vs->terminate) {
+		uint64_t current_time = getcurrenttime();
+		if (current_time >= stop_time) {
+			break;
+		}
+
+		uint64_t delay_ms = stop_time - current_time;
+		pthread_mutex_unlock(&vs->lock);
+		msleep((delay_ms < 16) ? (unsigned int)delay_ms : 16);
+		pthread_mutex_lock(&vs->lock);
+
+		pending = hdhomerun_video_pending(vs);
+	}
+#else
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	uint64_t stop_us = ((uint64_t)tv.tv_sec * 1000000) + tv.tv_usec + (max_wait_ms * 1000);
+	struct timespec abstime;
+	abstime.tv_sec = (time_t)(stop_us / 1000000);
+	abstime.tv_nsec = (long)(stop_us % 1000000) * 1000;
+
+	vs->waiting++;
+	while ((pending < vs->notify_watermark) && !vs->terminate) {
+		int ret = pthread_cond_timedwait(&vs->cond, &vs->lock, &abstime);
+		pending = hdhomerun_video_pending(vs);
+		if (ret == ETIMEDOUT) {
+			break;
+		}
+	}
+	vs->waiting--;
+#endif
+
+	pthread_mutex_unlock(&vs->lock);
+	return pending;
+}
+
 void hdhomerun_video_flush(struct hdhomerun_video_sock_t *vs)
 {
 	pthread_mutex_lock(&vs->lock);
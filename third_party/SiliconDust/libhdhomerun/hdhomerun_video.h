@@ -49,6 +49,8 @@ struct hdhomerun_video_stats_t {
 
 #define VIDEO_RTP_DATA_PACKET_SIZE ((188 * 7) + 12)
 
+#define VIDEO_RECV_BATCH_MAX 32
+
 /*
  * Create a video/data socket.
  *
@@ -89,6 +91,37 @@ extern LIBTYPE uint16_t hdhomerun_video_get_local_port(struct hdhomerun_video_so
  */
 extern LIBTYPE uint8_t *hdhomerun_video_recv(struct hdhomerun_video_sock_t *vs, size_t max_size, size_t *pactual_size);
 
+/*
+ * Wait for data.
+ *
+ * uint64_t max_wait_ms: The maximum time to wait. 0 returns at once.
+ *
+ * Returns the number of bytes received and not yet returned by hdhomerun_video_recv. Returns early
+ * when this reaches the notify watermark or the socket terminates, the result may be below the
+ * watermark on a timeout.
+ *
+ * A capture loop calling hdhomerun_video_wait before hdhomerun_video_recv wakes on data rather than
+ * polling at a fixed rate. On Windows the wait polls.
+ */
+extern LIBTYPE size_t hdhomerun_video_wait(struct hdhomerun_video_sock_t *vs, uint64_t max_wait_ms);
+
+/*
+ * Set the notify watermark for hdhomerun_video_wait.
+ *
+ * size_t watermark: The number of bytes to wait for. The default is VIDEO_DATA_PACKET_SIZE (wake on
+ *		any data). Clamped to the buffer size.
+ */
+extern LIBTYPE void hdhomerun_video_set_notify(struct hdhomerun_video_sock_t *vs, size_t watermark);
+
+/*
+ * Set the number of datagrams received per system call.
+ *
+ * int count: 1 to VIDEO_RECV_BATCH_MAX. Datagrams of a batch are stored under one lock and with one
+ *		wakeup. Only used where recvmmsg is available (Linux), the default is VIDEO_RECV_BATCH_MAX
+ *		there and 1 elsewhere.
+ */
+extern LIBTYPE void hdhomerun_video_set_recv_batch(struct hdhomerun_video_sock_t *vs, int count);
+
 /*
  * Flush the buffer.
  */